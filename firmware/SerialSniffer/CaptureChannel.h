@@ -0,0 +1,277 @@
+/*
+ * SerialSniffer - Capture Channels and Time Merge
+ *
+ * One CaptureChannel per monitored UART: its own receive ring (a fast
+ * ring that can spill into a large one, see TieredRing), counters and
+ * timestamp extension. The UART interrupt for a channel is the only
+ * producer of its ring. ChannelMerge is the consumer for all of them and
+ * emits one stream in receive-time order, tagged with the channel id.
+ *
+ * Free of Arduino dependencies so the merge can be benchmarked on the host.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTURECHANNEL_H
+#define CAPTURECHANNEL_H
+
+#include <stdint.h>
+
+#include "CaptureFormat.h"
+#include "CycleClock.h"
+#include "Instrumentation.h"
+#include "RingBuffer.h"
+
+/**
+ * Receive counters of one channel (producer side)
+ */
+struct DrainState {
+  uint32_t bytesReceived = 0;     // Read from the port
+  uint32_t bytesDropped = 0;      // Read from the port but lost (ring full)
+
+  void reset() { *this = DrainState(); }
+};
+
+/**
+ * Receive state for one monitored UART
+ *
+ * @tparam RingSize Fast receive ring slots (power of two)
+ * @tparam SpillSize Spill ring slots (power of two; the ring is attached
+ *                   with ring.attachSpill()), 0 = fast ring only
+ */
+template <uint32_t RingSize, uint32_t SpillSize = 0>
+struct CaptureChannel {
+  typedef TieredRing<RxSample, RingSize, SpillSize> Ring;
+  typedef typename Ring::SpillRing SpillRing;
+
+  uint8_t id = CHANNEL_RX;                // CaptureChannelId written to the log
+  Ring ring;
+  DrainState stats;                       // Bytes received/dropped
+  UartMetrics uart;                       // UART errors and interrupt time
+  CycleExtender clock;                    // Consumer side
+  uint32_t byteCycles = 0;                // One character time
+  volatile uint32_t lastStamp = 0;        // Producer side: keeps stamps monotonic
+  volatile bool overflowPending = false;  // Producer side: bytes lost since last queued
+
+  /**
+   * Prepare for a capture (before the port's interrupt is enabled)
+   * @param originCycles Cycle counter value at capture start (tick 0)
+   * @param characterCycles Cycles per character at the capture baud rate
+   */
+  void reset(uint32_t originCycles, uint32_t characterCycles) {
+    ring.clear();
+    ring.resetStats();
+    stats.reset();
+    uart.reset();
+    clock.reset(originCycles);
+    byteCycles = characterCycles;
+    lastStamp = originCycles;
+    overflowPending = false;
+  }
+
+  /**
+   * Queue one received character (producer, interrupt context)
+   * @param cycles Cycle counter when the interrupt started
+   * @param behind Characters still in the FIFO behind this one; the stamp
+   *               is moved back one character time for each
+   * @param value Received byte
+   * @param status Framing/parity flags from the UART
+   */
+  void receive(uint32_t cycles, uint32_t behind, uint8_t value, uint8_t status) {
+    uint32_t stamp = cycles - behind * byteCycles;
+    if ((int32_t)(stamp - lastStamp) < 0) stamp = lastStamp;
+    lastStamp = stamp;
+
+    RxSample sample;
+    sample.cycles = stamp;
+    sample.value = value;
+    sample.status = status | (overflowPending ? STATUS_OVERFLOW : STATUS_OK);
+    sample.channel = id;
+    sample.reserved = 0;
+
+    stats.bytesReceived++;
+    if (status & STATUS_FRAMING_ERROR) uart.framingErrors++;
+    if (status & STATUS_PARITY_ERROR) uart.parityErrors++;
+    if (ring.push(sample)) {
+      overflowPending = false;
+    } else {
+      stats.bytesDropped++;
+      overflowPending = true;
+    }
+  }
+};
+
+/**
+ * k-way merge of channel rings by receive time
+ *
+ * Each run() builds a min-heap of channel heads, then repeatedly emits the
+ * earliest head and replaces it with that channel's next sample. Only
+ * samples at or before the horizon are emitted: a byte still inside
+ * another channel's interrupt may carry an earlier stamp than anything
+ * queued, so the caller holds back a guard interval (see horizonGuard()).
+ *
+ * @tparam Channel CaptureChannel<N>
+ * @tparam MaxChannels Upper bound on add() calls (at most 8 channel ids)
+ */
+template <typename Channel, uint32_t MaxChannels>
+class ChannelMerge {
+  static_assert(MaxChannels >= 1 && MaxChannels <= MAX_CAPTURE_CHANNELS,
+                "ChannelMerge supports 1-8 channels");
+
+ public:
+  /**
+   * Register a channel (setup only)
+   * @return false if MaxChannels are already registered
+   */
+  bool add(Channel* channel) {
+    if (count_ == MaxChannels) return false;
+    channels_[count_++] = channel;
+    return true;
+  }
+
+  uint32_t channelCount() const { return count_; }
+  Channel& channel(uint32_t index) { return *channels_[index]; }
+
+  /**
+   * Guard interval for live capture: the largest back-dating any channel
+   * applies (FIFO depth of 4 characters) plus interrupt latency slack
+   * @param slackCycles Extra cycles to hold back
+   */
+  uint32_t horizonGuard(uint32_t slackCycles) const {
+    uint32_t guard = 0;
+    for (uint32_t i = 0; i < count_; i++) {
+      uint32_t channelGuard = 4 * channels_[i]->byteCycles;
+      if (channelGuard > guard) guard = channelGuard;
+    }
+    return guard + slackCycles;
+  }
+
+  /**
+   * Keep every channel's timestamp extension current
+   * Call at least every ~3.5 s so idle channels don't miss a counter wrap.
+   * A channel with a backlog follows its oldest queued sample instead: a
+   * deep spill ring behind a slow card can hold samples older than the
+   * extension reaches back from now.
+   * @param nowCycles Current cycle counter
+   */
+  void tick(uint32_t nowCycles) {
+    for (uint32_t i = 0; i < count_; i++) {
+      const RxSample* oldest = nullptr;
+      bool queued = channels_[i]->ring.readSpan(oldest) > 0;
+      channels_[i]->clock.extend(queued ? oldest->cycles : nowCycles);
+    }
+  }
+
+  /**
+   * Emit queued samples in time order
+   * @param horizon Last tick that may be emitted (UINT64_MAX once producers stopped)
+   * @param maxCount Stop after this many samples
+   * @param sink Called as sink(const RxSample&, uint64_t ticks) per sample
+   * @return Number of samples emitted
+   */
+  template <typename Sink>
+  uint32_t run(uint64_t horizon, uint32_t maxCount, Sink&& sink) {
+    heapSize_ = 0;
+    for (uint32_t i = 0; i < count_; i++) {
+      Cursor& cursor = cursors_[i];
+      cursor.consumed = 0;
+      cursor.available = channels_[i]->ring.readSpan(cursor.next);
+      if (cursor.available > 0) {
+        uint64_t ticks = channels_[i]->clock.extend(cursor.next->cycles);
+        if (ticks <= horizon) heapPush(ticks, (uint8_t)i);
+      }
+    }
+
+    uint32_t emitted = 0;
+    while (heapSize_ > 0 && emitted < maxCount) {
+      uint8_t index = heap_[0].index;
+      Cursor& cursor = cursors_[index];
+      sink(*cursor.next, heap_[0].ticks);
+      emitted++;
+
+      cursor.next++;
+      cursor.consumed++;
+      if (--cursor.available == 0) {
+        // End of a contiguous span: release it and look past the wrap
+        channels_[index]->ring.consumeRead(cursor.consumed);
+        cursor.consumed = 0;
+        cursor.available = channels_[index]->ring.readSpan(cursor.next);
+      }
+
+      uint64_t ticks = 0;
+      if (cursor.available > 0) ticks = channels_[index]->clock.extend(cursor.next->cycles);
+      if (cursor.available > 0 && ticks <= horizon) {
+        heap_[0].ticks = ticks;
+        siftDown(0);
+      } else {
+        heap_[0] = heap_[--heapSize_];
+        if (heapSize_ > 0) siftDown(0);
+      }
+    }
+
+    for (uint32_t i = 0; i < count_; i++) {
+      if (cursors_[i].consumed > 0) channels_[i]->ring.consumeRead(cursors_[i].consumed);
+    }
+    return emitted;
+  }
+
+  /**
+   * Total samples queued across all channels
+   */
+  uint32_t pending() const {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count_; i++) total += channels_[i]->ring.size();
+    return total;
+  }
+
+ private:
+  struct Cursor {
+    const RxSample* next;
+    uint32_t available;       // Readable at next in the current span
+    uint32_t consumed;        // Emitted from the current span, not yet released
+  };
+
+  struct Entry {
+    uint64_t ticks;
+    uint8_t index;
+  };
+
+  // Earlier time first; equal times keep channel order
+  static bool before(const Entry& a, const Entry& b) {
+    return a.ticks < b.ticks || (a.ticks == b.ticks && a.index < b.index);
+  }
+
+  void heapPush(uint64_t ticks, uint8_t index) {
+    uint32_t position = heapSize_++;
+    Entry entry = {ticks, index};
+    while (position > 0) {
+      uint32_t parent = (position - 1) / 2;
+      if (!before(entry, heap_[parent])) break;
+      heap_[position] = heap_[parent];
+      position = parent;
+    }
+    heap_[position] = entry;
+  }
+
+  void siftDown(uint32_t position) {
+    Entry entry = heap_[position];
+    for (;;) {
+      uint32_t child = 2 * position + 1;
+      if (child >= heapSize_) break;
+      if (child + 1 < heapSize_ && before(heap_[child + 1], heap_[child])) child++;
+      if (!before(heap_[child], entry)) break;
+      heap_[position] = heap_[child];
+      position = child;
+    }
+    heap_[position] = entry;
+  }
+
+  Channel* channels_[MaxChannels] = {};
+  uint32_t count_ = 0;
+  Cursor cursors_[MaxChannels] = {};
+  Entry heap_[MaxChannels] = {};
+  uint32_t heapSize_ = 0;
+};
+
+#endif // CAPTURECHANNEL_H
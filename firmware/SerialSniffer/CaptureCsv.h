@@ -0,0 +1,115 @@
+/*
+ * SerialSniffer - CSV Log Text
+ *
+ * The Timestamp,Direction,Value_Hex,Value_ASCII,Status lines of the CSV
+ * log mode. Shared by the firmware and the host converters (host/lib), so
+ * a CSV-mode capture and an ss_convert of a binary capture of the same
+ * traffic are the same text: status flags joined with '|', lines ended
+ * with CSV_LINE_END.
+ *
+ * Must not depend on Arduino headers.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTURECSV_H
+#define CAPTURECSV_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CaptureFormat.h"
+
+const char CSV_HEADER[] = "Timestamp,Direction,Value_Hex,Value_ASCII,Status";
+const char CSV_LINE_END[] = "\n";
+const uint32_t CSV_LINE_END_SIZE = sizeof(CSV_LINE_END) - 1;
+
+// Status column with every flag set: "OVERFLOW|FRAMING_ERROR|PARITY_ERROR|CHECKSUM_VALID|CHECKSUM_ERROR"
+const uint32_t MAX_CSV_STATUS_SIZE = 65;
+
+// One captured byte as a CSV line: 20-digit ns timestamp, ",CH7,0x41,A,",
+// the status and the line end
+const uint32_t MAX_CSV_LINE_SIZE = 20 + 12 + MAX_CSV_STATUS_SIZE + CSV_LINE_END_SIZE;
+
+/**
+ * Write an unsigned decimal number (no terminator)
+ * @return Number of characters written (at most 20)
+ */
+inline uint32_t formatCsvDecimal(char* out, uint64_t value) {
+  // Written backwards into a scratch buffer
+  char digits[20];
+  uint32_t digitCount = 0;
+  do {
+    digits[digitCount++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+  for (uint32_t i = 0; i < digitCount; i++) out[i] = digits[digitCount - 1 - i];
+  return digitCount;
+}
+
+/**
+ * Status column text: "OK", or every set flag joined with '|'
+ * @param out At least MAX_CSV_STATUS_SIZE bytes
+ * @return Number of characters written (no terminator)
+ */
+inline uint32_t formatCsvStatus(char* out, uint8_t status) {
+  static const struct {
+    uint8_t flag;
+    const char* name;
+  } FLAGS[] = {
+    {STATUS_OVERFLOW, "OVERFLOW"},
+    {STATUS_FRAMING_ERROR, "FRAMING_ERROR"},
+    {STATUS_PARITY_ERROR, "PARITY_ERROR"},
+    {STATUS_CHECKSUM_VALID, "CHECKSUM_VALID"},
+    {STATUS_CHECKSUM_ERROR, "CHECKSUM_ERROR"},
+  };
+  if (status == STATUS_OK) {
+    memcpy(out, "OK", 2);
+    return 2;
+  }
+  char* start = out;
+  for (const auto& entry : FLAGS) {
+    if (!(status & entry.flag)) continue;
+    if (out != start) *out++ = '|';
+    size_t length = strlen(entry.name);
+    memcpy(out, entry.name, length);
+    out += length;
+  }
+  return out - start;
+}
+
+/**
+ * Format one captured byte as a CSV log line (no heap allocation)
+ * @param line Output buffer, at least MAX_CSV_LINE_SIZE bytes
+ * @param timestamp Nanoseconds since capture start
+ * @param channel CaptureChannelId (Direction column)
+ * @param value Captured byte
+ * @param status RecordStatus flags
+ * @return Number of characters written, line end included (no terminator)
+ */
+inline uint32_t formatCsvLine(char* line, uint64_t timestamp, uint8_t channel,
+                              uint8_t value, uint8_t status) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  char* out = line;
+
+  out += formatCsvDecimal(out, timestamp);
+
+  const char* name = captureChannelName(channel);
+  *out++ = ',';
+  while (*name) *out++ = *name++;
+  memcpy(out, ",0x", 3);
+  out += 3;
+  *out++ = HEX_DIGITS[value >> 4];
+  *out++ = HEX_DIGITS[value & 0x0F];
+  *out++ = ',';
+  *out++ = (value >= 32 && value <= 126) ? (char)value : '.';
+  *out++ = ',';
+  out += formatCsvStatus(out, status);
+  memcpy(out, CSV_LINE_END, CSV_LINE_END_SIZE);
+  out += CSV_LINE_END_SIZE;
+
+  return out - line;
+}
+
+#endif // CAPTURECSV_H
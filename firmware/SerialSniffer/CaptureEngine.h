@@ -0,0 +1,1205 @@
+/*
+ * SerialSniffer - Capture Engine
+ *
+ * Everything between the capture channel rings and the card: time merge,
+ * packet framing and checksums, pattern triggers, record encoding,
+ * optional block compression, the sector-aligned writer and capture file
+ * management (session numbers, pre-allocated part files, rollover, the
+ * .ssi time index beside each part), the live record stream to the
+ * host, and latency probes on each of those stages (Instrumentation.h)
+ * whose snapshots go into the log as METRIC records. Written against
+ * the HAL (Hal.h) so the same code runs on the Teensy and in the host
+ * simulator in host/sim/.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTUREENGINE_H
+#define CAPTUREENGINE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BlockCompressor.h"
+#include "CaptureChannel.h"
+#include "CaptureCsv.h"
+#include "CaptureFormat.h"
+#include "CaptureIndex.h"
+#include "ChecksumEngine.h"
+#include "CycleClock.h"
+#include "Hal.h"
+#include "Instrumentation.h"
+#include "LiveStream.h"
+#include "PacketFramer.h"
+#include "SectorWriter.h"
+#include "TriggerEngine.h"
+
+// Log file format (binary records by default, CSV for legacy tooling)
+enum LogFormat {
+  LOG_FORMAT_BINARY,
+  LOG_FORMAT_CSV
+};
+
+/**
+ * Capture file and timing configuration
+ */
+struct CaptureEngineConfig {
+  uint64_t preallocateBytes = 64ULL * 1024 * 1024;  // Per part file (contiguous extent)
+  uint32_t rotateIntervalMs = 0;                    // Part time limit, 0 = size only
+  uint32_t syncIntervalMs = 1000;                   // Directory/FAT update period
+  uint32_t mergeSlackCycles = 60000;                // Interrupt latency allowance
+  const char* sessionIndexFile = "capture.idx";     // Next session number
+  const char* firmwareVersion = "";                 // Written to binary headers
+  PacketFramerConfig framing;                       // Packet boundaries in the log
+  ChecksumConfig checksums;                         // Packet checksum detection (needs framing)
+  uint32_t liveFlushMs = 5;                         // Longest a live batch waits to be sent
+  uint32_t indexIntervalRecords = 262144;           // Time index entry every this many records
+  uint32_t indexIntervalMs = 1000;                  // ... or this much capture time (both 0 = no index)
+  bool compressBlocks = false;                      // Binary log in LZ4 blocks (RECORD_FORMAT_BLOCKS)
+  TriggerConfig trigger;                            // Log only windows around pattern hits
+  uint32_t metricsIntervalMs = 10000;               // METRIC snapshot in the log this often, 0 = none
+};
+
+/**
+ * Receives status and error messages (one line, no newline)
+ */
+typedef void (*EngineMessageFn)(const char* message);
+
+/**
+ * Capture path from channel rings to capture files
+ *
+ * @tparam Hal HAL bundle (Clock, Storage, File)
+ * @tparam Channel CaptureChannel<N>
+ * @tparam MaxChannels Channels that can be added
+ * @tparam WriterBlocks SectorWriter block count
+ * @tparam Metrics Stage latency probes compiled in (CAPTURE_METRICS)
+ */
+template <typename Hal, typename Channel, uint32_t MaxChannels, uint32_t WriterBlocks,
+          bool Metrics = (CAPTURE_METRICS != 0)>
+class CaptureEngine {
+ public:
+  typedef typename Hal::Clock Clock;
+  typedef typename Hal::Storage Storage;
+  typedef typename Hal::File File;
+  typedef typename Hal::StreamPort StreamPort;
+  typedef ChannelMerge<Channel, MaxChannels> Merge;
+
+  // Worst-case size of one captured byte as a CSV line: MAX_CSV_LINE_SIZE (CaptureCsv.h)
+  static const uint32_t MAX_CSV_EVENT_SIZE = 96;   // "<ns>,CH7,,,PACKET_END=<u64>:MAX_LENGTH:CHECKSUM_ERROR\n"
+  static const uint32_t FILENAME_SIZE = 40;   // capture_<u32>_<u32>.ssb
+  static const uint32_t MAX_PENDING_EVENTS = 4;
+  static const uint32_t LIVE_BATCH_BYTES = 1024;  // Live stream batch, header included
+  static const uint32_t LIVE_BATCHES = 8;         // Batches that can wait for the port
+  static const uint32_t INDEX_ENTRIES = 64;       // Time index entries held in RAM (1 KB)
+  static const uint32_t BLOCK_RAW_BYTES = 4096;   // Records per compressed block
+  static const uint32_t TRIGGER_STATE_BITS = 256; // Pattern bytes of all trigger patterns together
+  static const uint32_t TRIGGER_WINDOWS = 8;      // Trigger windows waiting for the writer
+  static const uint32_t MIN_HISTORY_BYTES = 4096; // Smallest usable pre-trigger history
+  static const uint32_t SNAPSHOT_ENTRIES = 256 * MAX_CAPTURE_CHANNELS;   // Metric id x channel
+
+  /**
+   * Configure the engine (setup only)
+   * @param storage Card to log to, or nullptr to capture without logging
+   * @param config File and timing configuration (copied)
+   * @param message Receives status/error messages, may be nullptr
+   */
+  void begin(Storage* storage, const CaptureEngineConfig& config, EngineMessageFn message) {
+    storage_ = storage;
+    config_ = config;
+    message_ = message;
+    compress_ = config.compressBlocks;
+    framer_.begin(config.framing);
+    checksums_.begin(config.checksums);
+    indexer_.begin(config.indexIntervalRecords, (uint64_t)Clock::cycleHz() * config.indexIntervalMs / 1000);
+    beginTrigger(config.trigger);
+    metrics_.calibrate();
+  }
+
+  /**
+   * Register a capture channel (setup only)
+   * @return false if MaxChannels are already registered
+   */
+  bool addChannel(Channel* channel) { return merge_.add(channel); }
+
+  Merge& merge() { return merge_; }
+
+  // ---------- Sessions ----------
+
+  /**
+   * Select the log format for the next session
+   */
+  void setLogFormat(LogFormat format) {
+    format_ = format;
+    sessionAllocated_ = false;   // Next capture starts a session with the new format
+    filename_[0] = '\0';
+  }
+
+  LogFormat logFormat() const { return format_; }
+  bool sessionAllocated() const { return sessionAllocated_; }
+
+  /**
+   * Compress binary logs from the next part file on (CSV is never
+   * compressed)
+   */
+  void setCompression(bool on) { compress_ = on; }
+  bool compression() const { return compress_; }
+
+  /**
+   * Log only windows around trigger pattern hits from the next start()
+   * (needs patterns and a history buffer, see triggerAvailable()). The
+   * live stream still carries everything.
+   */
+  void setTriggerMode(bool on) { triggerMode_ = on; }
+  bool triggerMode() const { return triggerMode_; }
+  bool triggerAvailable() const { return matcher_.patterns() > 0 && history_.capacity() >= MIN_HISTORY_BYTES; }
+
+  /**
+   * Character format of the monitored lines from the next start()
+   * (recorded in binary headers; sets the character time for framing)
+   */
+  void setLineFormat(const LineFormat& format) { lineFormat_ = format; }
+  const LineFormat& lineFormat() const { return lineFormat_; }
+
+  /**
+   * Part file time limit, counted from when the open part was opened
+   * (0 = size only)
+   */
+  void setRotateInterval(uint32_t ms) { config_.rotateIntervalMs = ms; }
+  uint32_t rotateInterval() const { return config_.rotateIntervalMs; }
+
+  /**
+   * Start a new capture session
+   * Allocates the next session number; if a file is open, finishes it and
+   * continues in part 0 of the new session.
+   */
+  void newSession() {
+    bool reopen = dataFile_->isOpen();
+    if (reopen) {
+      service(true);
+      finishPackets();       // Packets don't span sessions
+      flushHistory();
+      closeFile();
+      discardSpare();
+    }
+    framer_.reset();
+    checksums_.reset();
+
+    sessionNumber_ = storage_ ? allocateSessionNumber() : 0;
+    sessionAllocated_ = true;
+    filePart_ = 0;
+    makeFilename(filename_, sessionNumber_, filePart_);
+    notify("New capture session: ", filename_);
+
+    if (reopen && !openFile()) {
+      notify("ERROR: Could not create file.", "");
+    }
+  }
+
+  // ---------- Capture ----------
+
+  /**
+   * Start logging
+   * Allocates a session if needed and opens the next part file. Usually
+   * called before the capture ports are started; ports already receiving
+   * since originCycles (a capture started at boot, before the card was
+   * ready) have their backlog logged first, as far as the rings held it.
+   * @param baudRate Recorded in binary headers
+   * @param originCycles Cycle counter value that is tick 0 for all channels
+   * @return false if the capture file could not be opened
+   */
+  bool start(uint32_t baudRate, uint32_t originCycles) {
+    baudRate_ = baudRate;
+    firstSampleTicks_ = UINT64_MAX;
+    clock_.reset(originCycles);
+    framer_.setCharacterTicks(characterTicks(baudRate));
+    recordsLogged_ = 0;
+    pumpedRecords_ = 0;
+    startTrigger();
+    metrics_.reset();
+    writeErrors_ = 0;
+    snapshotCursor_ = SNAPSHOT_ENTRIES;
+    snapshotMs_ = Clock::millis();
+    running_ = true;
+    if (liveEnabled_) startLive();
+    if (!sessionAllocated_) newSession();
+    if (storage_ && !openFile()) {
+      notify("ERROR: Could not open capture file for writing.", "");
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Move queued samples to the card (consumer side; call every loop pass)
+   * One drain(), then the live stream, then serviceStorage() until the
+   * writer has no full sectors left. A scheduler runs the three as
+   * separate tasks instead.
+   * @param live Capture ports are running: hold back samples newer than
+   *             the merge guard. false once they are stopped.
+   * @return Samples logged
+   */
+  uint32_t service(bool live) {
+    uint32_t logged = drain(live);
+    serviceLive();
+    while (serviceStorage()) {
+    }
+    return logged;
+  }
+
+  /**
+   * Merge, frame and encode queued samples into the writer, as many as
+   * it has room for (the capture drain; the rest stays in the rings)
+   * @param live As service()
+   * @return Samples logged
+   */
+  uint32_t drain(bool live) {
+    // Keep the 64-bit extensions current even on idle channels
+    uint32_t now = Clock::cycles();
+    uint64_t nowTicks = clock_.extend(now);
+    merge_.tick(now);
+    passMs_ = Clock::millis();
+
+    uint64_t horizon = UINT64_MAX;
+    if (live) {
+      uint64_t guard = merge_.horizonGuard(config_.mergeSlackCycles);
+      horizon = nowTicks > guard ? nowTicks - guard : 0;
+    }
+
+    // Per byte: its wait in the ring, and the framing and encoding time
+    // summed over the pass (all compiled out without Metrics)
+    bool framing = framer_.enabled();
+    bool checksumming = framing && checksums_.enabled();
+    uint32_t framingTicks = 0;
+    uint32_t encodeTicks = 0;
+    auto framerSink = [this](const FramerRecord& record) { logFramerRecord(record); };
+    uint32_t cyclesPerMs = Clock::cycleHz() / 1000;
+    auto sink = [this, framing, checksumming, now, cyclesPerMs, &framingTicks, &encodeTicks,
+                 &framerSink](const RxSample& sample, uint64_t ticks) {
+      metrics_.record(STAGE_QUEUE, now - sample.cycles);
+      if (firstSampleTicks_ == UINT64_MAX) firstSampleTicks_ = ticks;
+      uint32_t begin = metrics_.now();
+      if (framing) framer_.beforeByte(sample.channel, ticks, framerSink);
+      uint32_t framed = metrics_.now();
+      logSample(sample.channel, sample.value, sample.status, ticks, passMs_ - (now - sample.cycles) / cyclesPerMs);
+      uint32_t encoded = metrics_.now();
+      if (checksumming) checksums_.add(sample.channel, sample.value);
+      if (framing) framer_.afterByte(sample.channel, sample.value, ticks, framerSink);
+      framingTicks += (framed - begin) + (metrics_.now() - encoded);
+      encodeTicks += encoded - framed;
+    };
+
+    // Each queued event goes after every sample stamped at or before it
+    uint32_t logged = 0;
+    while (eventCount_ > 0 && events_[0].ticks <= horizon) {
+      const PendingEvent& event = events_[0];
+      uint32_t room = sampleRoom();
+      uint32_t count = merge_.run(event.ticks, room, sink);
+      logged += count;
+      if (count == room || logRoom() < eventRoom()) break;   // Writer full: next pass
+      if (framing) framer_.expire(event.ticks, framerSink);
+      logEvent(event.ticks, event.kind, event.channel, 0, STATUS_OK, event.argument);
+      eventCount_--;
+      for (uint32_t i = 0; i < eventCount_; i++) events_[i] = events_[i + 1];
+    }
+    // Nothing newer than an event that could not be logged yet
+    uint64_t limit = horizon;
+    if (eventCount_ > 0 && events_[0].ticks < limit) limit = events_[0].ticks;
+    uint32_t room = sampleRoom();
+    uint32_t count = merge_.run(limit, room, sink);
+    logged += count;
+    if (count < room) {
+      // Every sample up to limit is logged: idle packets up to then have
+      // ended, and a metrics snapshot can go in
+      uint64_t caughtUp = limit < nowTicks ? limit : nowTicks;
+      if (framing) framer_.expire(caughtUp, framerSink);
+      serviceSnapshot(caughtUp);
+    }
+    recordsLogged_ += logged;
+    if (logged > 0) {
+      metrics_.addProbes(logged);
+      if (framing) metrics_.record(STAGE_FRAMING, framingTicks);
+      metrics_.record(STAGE_ENCODE, encodeTicks);
+    }
+    pumpDue_ = true;
+    return logged;
+  }
+
+  /**
+   * Card side: one unit of writer work per call (the UART interrupts
+   * keep receiving meanwhile)
+   * First after each drain(), with the writer empty, moves trigger window
+   * records and compressed blocks into it; with nothing to write, syncs
+   * metadata when due, writes index entries or prepares the spare part.
+   * Rolls over once the part is full.
+   * @return true while full sectors are still queued (call again)
+   */
+  bool serviceStorage() {
+    passMs_ = Clock::millis();
+    if (writer_.blocksQueued() == 0 && pumpDue_) {
+      // Trigger mode: the open window's records from the history into
+      // the log; compress a full (or old) block
+      uint32_t encodeStart = metrics_.now();
+      if (triggering_) pumpHistory();
+      if (compressing_) pumpBlocks();
+      if ((triggering_ || compressing_) && pumpedRecords_ != recordsLogged_) {
+        metrics_.since(STAGE_ENCODE, encodeStart);
+      }
+      pumpedRecords_ = recordsLogged_;
+      pumpDue_ = false;
+    }
+    if (writer_.blocksQueued() > 0) {
+      serviceWriter();
+    } else if (!serviceWriter()) {
+      // Idle: write index entries, get the next part file ready so
+      // rollover doesn't wait on it
+      if (indexer_.halfFull()) writeIndex();
+      else if (!spareReady_) prepareSpare();
+    }
+    if (writer_.blocksQueued() > 0) return true;
+
+    if (rotationDue()) {
+      rotate();
+    }
+    return false;
+  }
+
+  /**
+   * Finish logging (after the capture ports are stopped)
+   * Logs everything still queued, closes the part file and deletes an
+   * unused spare.
+   */
+  void stop() {
+    while (merge_.pending() > 0) {
+      service(false);
+    }
+    finishPackets();
+    flushHistory();
+    flushSnapshot();
+    live_.end(Clock::millis());
+    closeFile();
+    discardSpare();
+    running_ = false;
+  }
+
+  // ---------- Live stream ----------
+
+  /**
+   * Stream every logged record to the host as well (binary, in batches)
+   * Starts a stream at once while capturing, else at the next start().
+   * @param port Link to the host, or nullptr to stop streaming (what is
+   *             queued, and the END batch, still go out to the old port)
+   */
+  void setLivePort(StreamPort* port) {
+    live_.end(Clock::millis());
+    liveEnabled_ = port != nullptr;
+    if (!port) return;
+    live_.begin(port, config_.liveFlushMs);
+    if (running_) startLive();
+  }
+
+  /**
+   * Send queued live batches, as many as the port takes at once (call
+   * every loop pass, also after a capture)
+   * @return true if a batch went out
+   */
+  bool serviceLive() {
+    uint32_t start = metrics_.now();
+    uint32_t sent = live_.stats().batchesSent;
+    live_.service(Clock::millis());
+    if (running_ && liveEnabled_) metrics_.since(STAGE_STREAM, start);
+    return live_.stats().batchesSent != sent;
+  }
+
+  bool liveStreaming() const { return liveEnabled_; }
+  const LiveStreamStats& liveStats() const { return live_.stats(); }
+  uint32_t liveQueued() const { return live_.queued(); }
+
+  // ---------- Events ----------
+
+  /**
+   * Log that the capture ports were re-locked to a new line rate
+   * The record goes in time order among the data records; part files
+   * opened later carry the new rate in their header.
+   * @param channel Channel whose line was measured
+   * @param baudRate New rate
+   * @param cycles Cycle counter when the ports were re-locked
+   * @return false if MAX_PENDING_EVENTS are already waiting
+   */
+  bool lineRateChanged(uint8_t channel, uint32_t baudRate, uint32_t cycles) {
+    baudRate_ = baudRate;
+    framer_.setCharacterTicks(characterTicks(baudRate));
+    return queueEvent(RECORD_KIND_BAUD_CHANGE, channel, baudRate, cycles);
+  }
+
+  // ---------- Status ----------
+
+  const char* filename() const { return filename_; }
+  bool fileOpen() const { return dataFile_->isOpen(); }
+  uint64_t fileUsage() const { return dataFile_->position() + writer_.pendingBytes() + blocks_.pending(); }
+  uint64_t preallocateBytes() const { return config_.preallocateBytes; }
+  uint64_t recordsLogged() const { return recordsLogged_; }
+
+  /**
+   * Ticks from the origin to the first byte logged since start(), or
+   * UINT64_MAX before there is one
+   */
+  uint64_t firstSampleTicks() const { return firstSampleTicks_; }
+  bool writerOpen() const { return writer_.isOpen(); }
+  uint32_t blocksQueued() const { return writer_.blocksQueued(); }
+  const SectorWriterStats& writerStats() const { return writer_.stats(); }
+  const PacketFramer& framer() const { return framer_; }
+  const ChecksumEngine& checksums() const { return checksums_; }
+  bool compressing() const { return compressing_; }       // Current part file is compressed
+  const BlockCompressorStats& compressionStats() const { return blocks_.stats(); }
+  bool indexOpen() const { return indexFile_.isOpen(); }
+  uint32_t indexEntriesDropped() const { return indexer_.dropped(); }
+  bool triggering() const { return triggering_; }         // Current capture logs trigger windows
+  bool triggerWindowOpen() const { return windowCount_ > 0; }
+  const TriggerStats& triggerStats() const { return triggerStats_; }
+  uint32_t triggerPatterns() const { return matcher_.patterns(); }
+  const char* triggerPattern(uint32_t index) const { return index < matcher_.patterns() ? triggerText_[index] : ""; }
+  uint32_t historyUsed() const { return history_.used(); }
+  uint32_t historyCapacity() const { return history_.capacity(); }
+
+  // ---------- Instrumentation ----------
+
+  static bool metricsEnabled() { return Metrics; }
+
+  /**
+   * Copy the current counters and stage histograms (the channels'
+   * interrupt histograms summed into STAGE_RECEIVE)
+   */
+  void metricsSnapshot(MetricsSnapshot& snapshot) {
+    for (uint8_t stage = 0; stage < PIPELINE_STAGE_COUNT; stage++) snapshot.stages[stage] = metrics_.stage(stage);
+    snapshot.stages[STAGE_RECEIVE].reset();
+    for (uint32_t i = 0; i < MAX_CAPTURE_CHANNELS; i++) {
+      snapshot.bytesReceived[i] = snapshot.bytesDropped[i] = 0;
+      snapshot.framingErrors[i] = snapshot.parityErrors[i] = snapshot.overruns[i] = 0;
+    }
+    for (uint32_t i = 0; i < merge_.channelCount(); i++) {
+      const Channel& channel = merge_.channel(i);
+      uint8_t id = channel.id & (MAX_CAPTURE_CHANNELS - 1);
+      if (Metrics) snapshot.stages[STAGE_RECEIVE].add(channel.uart.interrupts);
+      snapshot.bytesReceived[id] = channel.stats.bytesReceived;
+      snapshot.bytesDropped[id] = channel.stats.bytesDropped;
+      snapshot.framingErrors[id] = channel.uart.framingErrors;
+      snapshot.parityErrors[id] = channel.uart.parityErrors;
+      snapshot.overruns[id] = channel.uart.overruns;
+    }
+    snapshot.streamDropped = live_.stats().recordsDropped;
+    snapshot.writeErrors = writeErrors_ + (writer_.isOpen() ? writer_.stats().writeErrors : 0);
+    snapshot.indexDropped = indexer_.dropped();
+    snapshot.probeTicks = metrics_.probeTicks();
+  }
+
+  /**
+   * Estimated CPU share of the probes since start() (parts per thousand)
+   */
+  uint32_t metricsOverheadPermille() {
+    uint64_t receiveProbes = 0;
+    for (uint32_t i = 0; i < merge_.channelCount(); i++) receiveProbes += merge_.channel(i).uart.interrupts.count;
+    return metrics_.overheadPermille(receiveProbes, clock_.extend(Clock::cycles()));
+  }
+
+ private:
+  // ---------- Encoding ----------
+
+  struct PendingEvent {
+    uint64_t ticks;
+    uint64_t argument;
+    uint8_t kind;
+    uint8_t channel;
+  };
+
+  uint64_t characterTicks(uint32_t baudRate) const {
+    return baudRate ? (uint64_t)Clock::cycleHz() * lineFormat_.characterBits() / baudRate : 0;
+  }
+
+  // One event record in the file / in the log (the history in trigger mode)
+  uint32_t fileEventRoom() const {
+    return (format_ == LOG_FORMAT_BINARY) ? MAX_EVENT_RECORD_SIZE : MAX_CSV_EVENT_SIZE;
+  }
+
+  uint32_t eventRoom() const { return triggering_ ? MAX_EVENT_RECORD_SIZE : fileEventRoom(); }
+
+  // A packet end: its record and a checksum lock change before it
+  uint32_t packetEndRoom() const {
+    return checksums_.enabled() ? 2 * eventRoom() : eventRoom();
+  }
+
+  // Bytes of records the file takes without blocking: the writer's free
+  // space, or the staging block's while compressing
+  uint32_t fileRoom() const { return compressing_ ? blocks_.room() : writer_.freeSpace(); }
+
+  // Bytes of records the log takes without blocking. In trigger mode that
+  // is the history: its free space while a window waits for the writer,
+  // else the headroom keepRecord() keeps clear by dropping old records.
+  uint32_t logRoom() const {
+    if (!triggering_) return fileRoom();
+    return windowCount_ > 0 ? history_.freeSpace() : historyHeadroom_;
+  }
+
+  // One packet end per channel, kept free for finishPackets()
+  uint32_t packetReserve() const { return framer_.enabled() ? MAX_CAPTURE_CHANNELS * packetEndRoom() : 0; }
+
+  // Samples the writer can take without blocking (unlimited when not
+  // logging). With framing a sample may bring a packet start and end, and
+  // idle ends on every channel may come due before it.
+  uint32_t sampleRoom() const {
+    if (!writer_.isOpen()) return UINT32_MAX;
+    uint32_t maxSize = (format_ == LOG_FORMAT_BINARY || triggering_) ? MAX_DELTA_RECORD_SIZE : MAX_CSV_LINE_SIZE;
+    uint32_t freeSpace = logRoom();
+    if (framer_.enabled()) {
+      uint32_t reserve = packetReserve();
+      if (freeSpace <= reserve) return 0;
+      freeSpace -= reserve;
+      maxSize += eventRoom() + packetEndRoom();
+    }
+    return freeSpace / maxSize;
+  }
+
+  // End open packets in the current file (after service(), which leaves
+  // the writer with room for one packet end per channel)
+  void finishPackets() {
+    framer_.finish([this](const FramerRecord& record) { logFramerRecord(record); });
+  }
+
+  // PACKET_START/PACKET_END from the framer; checksums are checked at the
+  // end and a rule locked or dropped there is logged just before it
+  void logFramerRecord(const FramerRecord& record) {
+    uint8_t status = STATUS_OK;
+    if (checksums_.enabled()) {
+      if (record.kind == RECORD_KIND_PACKET_START) {
+        checksums_.packetStart(record.channel);
+      } else {
+        bool complete = record.value == PACKET_END_IDLE || record.value == PACKET_END_DELIMITER;
+        status = checksums_.packetEnd(record.channel, complete,
+                                      [this, &record](uint8_t channel, const ChecksumRule& rule) {
+          logEvent(record.ticks, RECORD_KIND_CHECKSUM, channel, rule.algorithm, STATUS_OK, rule.argument());
+        });
+      }
+    }
+    logEvent(record.ticks, record.kind, record.channel, record.value, status, record.argument);
+  }
+
+  bool queueEvent(uint8_t kind, uint8_t channel, uint64_t argument, uint32_t cycles) {
+    if (eventCount_ == MAX_PENDING_EVENTS) return false;
+    PendingEvent& event = events_[eventCount_++];
+    event.ticks = clock_.extend(cycles);
+    event.argument = argument;
+    event.kind = kind;
+    event.channel = channel;
+    return true;
+  }
+
+  // Caller makes sure the log has eventRoom()
+  void logEvent(uint64_t ticks, uint8_t kind, uint8_t channel, uint8_t value, uint8_t status,
+                uint64_t argument) {
+    live_.append(ticks, kind, channel, value, status, argument, passMs_);
+    if (!writer_.isOpen()) return;     // Not logging: drop it
+
+    if (triggering_) {
+      if (kind == RECORD_KIND_PACKET_START) packetStarting_[channel & (MAX_CAPTURE_CHANNELS - 1)] = true;
+      keepRecord(ticks, kind, channel, value, status, argument);
+    } else {
+      writeEvent(ticks, kind, channel, value, status, argument);
+    }
+  }
+
+  // receivedMs: millis() when the byte arrived (a live batch is due that
+  // long after its first byte arrived, however long it waited to be drained)
+  void logSample(uint8_t channel, uint8_t value, uint8_t status, uint64_t ticks, uint32_t receivedMs) {
+    live_.append(ticks, RECORD_KIND_DATA, channel, value, status, 0, receivedMs);
+    if (!writer_.isOpen()) return;
+
+    if (triggering_) {
+      keepRecord(ticks, RECORD_KIND_DATA, channel, value, status, 0);
+      bool& starting = packetStarting_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+      int32_t pattern = matcher_.step(channel, value, starting);
+      starting = false;
+      if (pattern != TRIGGER_NO_MATCH) trigger(pattern, ticks);
+    } else {
+      writeSample(channel, value, status, ticks);
+    }
+  }
+
+  // An event record into the file (caller makes sure it has fileEventRoom())
+  void writeEvent(uint64_t ticks, uint8_t kind, uint8_t channel, uint8_t value, uint8_t status,
+                  uint64_t argument) {
+    if (format_ == LOG_FORMAT_BINARY) {
+      uint8_t record[MAX_EVENT_RECORD_SIZE];
+      uint64_t delta = ticks > lastRecordTicks_ ? ticks - lastRecordTicks_ : 0;
+      indexRecord(lastRecordTicks_ + delta);
+      uint32_t length = encodeEventRecord(record, delta, kind, channel, value, status, argument);
+      appendRecord(record, length);
+      lastRecordTicks_ += delta;
+    } else {
+      // Timestamp,Direction,,,KIND=argument[:reason|:algorithm|:metric][:checksum status]
+      indexRecord(ticks);
+      char line[MAX_CSV_EVENT_SIZE];
+      char* out = line + formatCsvDecimal(line, ticksToNs(ticks, Clock::cycleHz()));
+      *out++ = ',';
+      for (const char* name = captureChannelName(channel); *name;) *out++ = *name++;
+      *out++ = ',';
+      *out++ = ',';
+      *out++ = ',';
+      for (const char* name = recordKindName(kind); *name;) *out++ = *name++;
+      *out++ = '=';
+      out += formatCsvDecimal(out, argument);
+      const char* detail = nullptr;
+      if (kind == RECORD_KIND_PACKET_END) detail = packetEndReasonName(value);
+      else if (kind == RECORD_KIND_CHECKSUM) detail = checksumAlgorithmName(value);
+      if (detail) {
+        *out++ = ':';
+        while (*detail) *out++ = *detail++;
+      } else if (kind == RECORD_KIND_METRIC) {
+        *out++ = ':';
+        out += formatMetricName(out, value);
+      }
+      const char* check = nullptr;
+      if (status & STATUS_CHECKSUM_VALID) check = ":CHECKSUM_VALID";
+      else if (status & STATUS_CHECKSUM_ERROR) check = ":CHECKSUM_ERROR";
+      if (check) {
+        while (*check) *out++ = *check++;
+      }
+      memcpy(out, CSV_LINE_END, CSV_LINE_END_SIZE);
+      out += CSV_LINE_END_SIZE;
+      writer_.append(line, out - line);
+      if (ticks > lastRecordTicks_) lastRecordTicks_ = ticks;
+    }
+  }
+
+  void writeSample(uint8_t channel, uint8_t value, uint8_t status, uint64_t ticks) {
+    if (format_ == LOG_FORMAT_BINARY) {
+      uint8_t record[MAX_DELTA_RECORD_SIZE];
+      uint64_t delta = ticks > lastRecordTicks_ ? ticks - lastRecordTicks_ : 0;
+      indexRecord(lastRecordTicks_ + delta);
+      uint32_t length = encodeDeltaRecord(record, delta, RECORD_KIND_DATA, channel, value, status);
+      appendRecord(record, length);
+      lastRecordTicks_ += delta;
+    } else {
+      indexRecord(ticks);
+      char line[MAX_CSV_LINE_SIZE];
+      uint32_t length = formatCsvLine(line, ticksToNs(ticks, Clock::cycleHz()), channel, value, status);
+      writer_.append(line, length);
+      if (ticks > lastRecordTicks_) lastRecordTicks_ = ticks;
+    }
+  }
+
+  // Before each record is appended: a time index entry when one is due
+  // (compressed: at the start of the block the record goes in)
+  void indexRecord(uint64_t ticks) {
+    if (indexFile_.isOpen() && indexer_.due(ticks)) {
+      if (compressing_) indexDue_ = true;
+      else indexer_.add(lastRecordTicks_, fileUsage(), ticks);
+    }
+  }
+
+  // A binary record, to the writer or the staging block (before
+  // lastRecordTicks_ moves on: a block's base is the record before it)
+  void appendRecord(const uint8_t* record, uint32_t length) {
+    if (compressing_) blocks_.append(record, length, lastRecordTicks_, passMs_);
+    else writer_.append(record, length);
+  }
+
+  // ---------- Triggers ----------
+
+  struct TriggerWindow {
+    uint64_t startTicks;
+    uint64_t endTicks;
+  };
+
+  // Compile the configured patterns (setup only)
+  void beginTrigger(const TriggerConfig& config) {
+    history_.begin(config.history, config.historyBytes);
+    historyHeadroom_ = history_.capacity() / 8;
+    triggerMode_ = config.enabled;
+    preTicks_ = (uint64_t)Clock::cycleHz() * config.preTriggerMs / 1000;
+    postTicks_ = (uint64_t)Clock::cycleHz() * config.postTriggerMs / 1000;
+    matcher_.clear();
+    for (const char* text : config.patterns) {
+      if (!text) continue;
+      TriggerPattern pattern;
+      int32_t index = parseTriggerPattern(text, pattern) ? matcher_.add(pattern) : TRIGGER_NO_MATCH;
+      if (index == TRIGGER_NO_MATCH) notify("WARNING: Trigger pattern ignored: ", text);
+      else triggerText_[index] = text;
+    }
+  }
+
+  void startTrigger() {
+    triggering_ = triggerMode_ && triggerAvailable() && storage_;
+    history_.clear();
+    matcher_.reset();
+    memset(packetStarting_, 0, sizeof(packetStarting_));
+    windowCount_ = 0;
+    historyShort_ = false;
+    triggerStats_ = TriggerStats();
+  }
+
+  // Every record goes through the history. Without a window only the
+  // pre-trigger interval stays in it, and never more than 7/8 of it: the
+  // rest is the headroom logRoom() hands out, so a window that opens
+  // halfway through a service() pass still has room for the pass.
+  void keepRecord(uint64_t ticks, uint8_t kind, uint8_t channel, uint8_t value, uint8_t status,
+                  uint64_t argument) {
+    if (windowCount_ == 0) {
+      TriggerRecord oldest;
+      while (history_.used() + historyHeadroom_ + MAX_EVENT_RECORD_SIZE > history_.capacity() &&
+             history_.peek(oldest)) {
+        historyShort_ = true;          // Dropped while still inside the pre-trigger interval
+        history_.pop();
+        triggerStats_.recordsDiscarded++;
+      }
+      trimHistory(ticks);
+    }
+    history_.push(ticks, kind, channel, value, status, argument);
+  }
+
+  // Drop records older than the pre-trigger interval before now
+  void trimHistory(uint64_t now) {
+    TriggerRecord oldest;
+    while (history_.peek(oldest) && oldest.ticks + preTicks_ < now) {
+      history_.pop();
+      triggerStats_.recordsDiscarded++;
+      historyShort_ = false;
+    }
+  }
+
+  // A pattern ended at this byte: log [ticks - pre, ticks + post], joined
+  // with the newest window if they touch
+  void trigger(int32_t pattern, uint64_t ticks) {
+    triggerStats_.hits++;
+    triggerStats_.lastPattern = pattern;
+    triggerStats_.lastHitTicks = ticks;
+    uint64_t start = ticks > preTicks_ ? ticks - preTicks_ : 0;
+    uint64_t end = ticks + postTicks_;
+    if (windowCount_ > 0) {
+      TriggerWindow& newest = windows_[(windowFirst_ + windowCount_ - 1) % TRIGGER_WINDOWS];
+      if (start <= newest.endTicks || windowCount_ == TRIGGER_WINDOWS) {
+        if (end > newest.endTicks) newest.endTicks = end;
+        return;
+      }
+    } else {
+      windowFirst_ = 0;
+      if (historyShort_) triggerStats_.shortWindows++;
+      notify("Trigger: ", triggerText_[pattern]);
+    }
+    windows_[(windowFirst_ + windowCount_) % TRIGGER_WINDOWS] = {start, end};
+    windowCount_++;
+    triggerStats_.windows++;
+  }
+
+  // Move history records into the file while they belong to a window and
+  // the file has room; records between windows are dropped. When the
+  // last window is done the history goes back to keeping the pre-trigger
+  // interval.
+  void pumpHistory() {
+    TriggerRecord record;
+    while (windowCount_ > 0 && history_.peek(record)) {
+      const TriggerWindow& window = windows_[windowFirst_];
+      if (record.ticks > window.endTicks) {
+        windowFirst_ = (windowFirst_ + 1) % TRIGGER_WINDOWS;
+        windowCount_--;
+        continue;
+      }
+      if (record.ticks < window.startTicks) {
+        triggerStats_.recordsDiscarded++;
+      } else if (record.kind == RECORD_KIND_DATA) {
+        if (fileRoom() < ((format_ == LOG_FORMAT_BINARY) ? MAX_DELTA_RECORD_SIZE : MAX_CSV_LINE_SIZE)) return;
+        writeSample(record.channel, record.value, record.status, record.ticks);
+        triggerStats_.recordsKept++;
+      } else {
+        if (fileRoom() < fileEventRoom()) return;
+        writeEvent(record.ticks, record.kind, record.channel, record.value, record.status, record.argument);
+        triggerStats_.recordsKept++;
+      }
+      history_.pop();
+    }
+    if (windowCount_ == 0) trimHistory(history_.newestTicks());
+  }
+
+  // Capture or session ending: the rest of the open windows into the file
+  void flushHistory() {
+    if (!triggering_) return;
+    while (windowCount_ > 0 && !history_.empty()) {
+      pumpHistory();
+      if (compressing_) pumpBlocks();
+      while (writer_.blocksQueued() > 0) serviceWriter();
+    }
+    windowCount_ = 0;
+    history_.clear();
+  }
+
+  // ---------- Instrumentation ----------
+
+  // One unit of card work, its write and sync times into the SD stages
+  bool serviceWriter() {
+    const SectorWriterStats& stats = writer_.stats();
+    uint32_t writes = stats.sectorsWritten + stats.partialWrites;
+    uint32_t syncs = stats.syncs;
+    bool busy = writer_.service(Clock::millis());
+    if (Metrics && busy) {
+      if (stats.sectorsWritten + stats.partialWrites != writes) {
+        metrics_.record(STAGE_SD_WRITE, microsToTicks(stats.lastWriteUs));
+      }
+      if (stats.syncs != syncs) metrics_.record(STAGE_SD_FLUSH, microsToTicks(stats.lastSyncUs));
+    }
+    return busy;
+  }
+
+  static uint32_t microsToTicks(uint32_t us) {
+    uint64_t ticks = (uint64_t)us * (Clock::cycleHz() / 1000000);
+    return ticks < UINT32_MAX ? (uint32_t)ticks : UINT32_MAX;
+  }
+
+  // Take a snapshot every metricsIntervalMs and log a slice of it per
+  // pass, as far as the log has room (keeping the packet reserve), at a
+  // time every sample before which is logged
+  void serviceSnapshot(uint64_t ticks) {
+    if (config_.metricsIntervalMs == 0) return;
+    if (snapshotCursor_ == SNAPSHOT_ENTRIES) {
+      if (passMs_ - snapshotMs_ < config_.metricsIntervalMs) return;
+      snapshotMs_ = passMs_;
+      metricsSnapshot(snapshot_);
+      snapshotCursor_ = 0;
+    }
+    uint8_t id;
+    uint8_t channel;
+    uint64_t value;
+    while (nextSnapshotEntry(id, channel, value)) {
+      if (writer_.isOpen() && logRoom() < eventRoom() + packetReserve()) return;
+      logEvent(ticks, RECORD_KIND_METRIC, channel, id, STATUS_OK, value);
+      snapshotCursor_++;
+    }
+  }
+
+  // Capture ending: a last, complete snapshot straight into the file
+  // (after flushHistory(), so trigger mode keeps it too)
+  void flushSnapshot() {
+    if (config_.metricsIntervalMs == 0) return;
+    metricsSnapshot(snapshot_);
+    snapshotCursor_ = 0;
+    uint64_t ticks = clock_.extend(Clock::cycles());
+    uint8_t id;
+    uint8_t channel;
+    uint64_t value;
+    while (nextSnapshotEntry(id, channel, value)) {
+      if (writer_.isOpen() && fileRoom() < fileEventRoom()) {
+        if (compressing_) pumpBlocks();
+        while (writer_.blocksQueued() > 0) serviceWriter();
+        continue;
+      }
+      live_.append(ticks, RECORD_KIND_METRIC, channel, id, STATUS_OK, value, passMs_);
+      if (writer_.isOpen()) writeEvent(ticks, RECORD_KIND_METRIC, channel, id, STATUS_OK, value);
+      snapshotCursor_++;
+    }
+  }
+
+  // Skip to the snapshot's next non-zero entry
+  bool nextSnapshotEntry(uint8_t& id, uint8_t& channel, uint64_t& value) {
+    for (; snapshotCursor_ < SNAPSHOT_ENTRIES; snapshotCursor_++) {
+      id = (uint8_t)(snapshotCursor_ / MAX_CAPTURE_CHANNELS);
+      channel = (uint8_t)(snapshotCursor_ % MAX_CAPTURE_CHANNELS);
+      if (snapshot_.value(id, channel, value) && value != 0) return true;
+    }
+    return false;
+  }
+
+  // ---------- Block compression ----------
+
+  // Move the sealed block into the writer; seal the staging block once the
+  // previous one is in and it is nearly full or as old as the sync interval
+  void pumpBlocks() {
+    blocks_.drain(writer_);
+    if (blocks_.pending() > 0 || blocks_.used() == 0) return;
+    if (blocks_.room() < packetReserve() + SECTOR_SIZE ||
+        passMs_ - blocks_.openedMs() >= config_.syncIntervalMs) {
+      sealBlock();
+      blocks_.drain(writer_);
+    }
+  }
+
+  // The writer has taken every sealed byte, so the block starts at fileUsage()
+  void sealBlock() {
+    if (indexDue_) {
+      indexer_.add(blocks_.baseTicks(), fileUsage(), blocks_.baseTicks());
+      indexDue_ = false;
+    }
+    blocks_.seal(&Clock::micros);
+  }
+
+  // Everything staged and sealed into the writer (closing a part file)
+  void flushBlocks() {
+    while (blocks_.pending() > 0 || blocks_.used() > 0) {
+      if (blocks_.pending() == 0) sealBlock();
+      blocks_.drain(writer_);
+      while (writer_.blocksQueued() > 0) serviceWriter();
+    }
+  }
+
+  // ---------- Capture files ----------
+
+  void makeFilename(char* name, uint32_t session, uint32_t part) const {
+    const char* extension = (format_ == LOG_FORMAT_BINARY) ? "ssb" : "csv";
+    if (part == 0) {
+      snprintf(name, FILENAME_SIZE, "capture_%lu.%s", (unsigned long)session, extension);
+    } else {
+      snprintf(name, FILENAME_SIZE, "capture_%lu_%lu.%s", (unsigned long)session,
+               (unsigned long)part, extension);
+    }
+  }
+
+  // Next session number from the index file; scans only without an index
+  uint32_t allocateSessionNumber() {
+    uint32_t next = 0;
+    char name[FILENAME_SIZE];
+    File index;
+
+    if (storage_->open(index, config_.sessionIndexFile, HAL_FILE_READ)) {
+      char text[12] = {0};
+      index.read(text, sizeof(text) - 1);
+      index.close();
+      next = strtoul(text, nullptr, 10);
+
+      // Index may be stale if files were copied onto the card
+      makeFilename(name, next, 0);
+      while (storage_->exists(name)) {
+        makeFilename(name, ++next, 0);
+      }
+    } else {
+      // Card without an index (first use or older firmware): scan once
+      for (;;) {
+        snprintf(name, sizeof(name), "capture_%lu.ssb", (unsigned long)next);
+        bool used = storage_->exists(name);
+        snprintf(name, sizeof(name), "capture_%lu.csv", (unsigned long)next);
+        if (!used && !storage_->exists(name)) break;
+        next++;
+      }
+    }
+
+    if (storage_->open(index, config_.sessionIndexFile, HAL_FILE_CREATE)) {
+      char text[12];
+      int length = snprintf(text, sizeof(text), "%lu", (unsigned long)(next + 1));
+      index.write((const uint8_t*)text, length);
+      index.close();
+    }
+    return next;
+  }
+
+  // Create and pre-allocate a part file of the current session
+  bool createPart(File& file, uint32_t part) {
+    char name[FILENAME_SIZE];
+    makeFilename(name, sessionNumber_, part);
+    if (!storage_->open(file, name, HAL_FILE_CREATE)) {
+      return false;
+    }
+    if (!file.preAllocate(config_.preallocateBytes)) {
+      // Still usable, but clusters will be allocated while logging
+      notify("WARNING: Could not pre-allocate ", name);
+    }
+    return true;
+  }
+
+  // Open the current part (the spare if ready), write its header, attach the writer
+  bool openFile() {
+    if (spareReady_) {
+      File* next = spareFile_;
+      spareFile_ = dataFile_;
+      dataFile_ = next;
+      spareReady_ = false;
+    } else if (!createPart(*dataFile_, filePart_)) {
+      return false;
+    }
+
+    makeFilename(filename_, sessionNumber_, filePart_);
+    compressing_ = compress_ && format_ == LOG_FORMAT_BINARY;
+    blocks_.reset();
+    indexDue_ = false;
+    writeFileHeader();
+    lastRecordTicks_ = 0;    // First record of each part is relative to capture start
+    writer_.begin(dataFile_, dataFile_->position(), &Clock::micros, config_.syncIntervalMs);
+    openIndex();
+    fileOpenMs_ = Clock::millis();
+    return true;
+  }
+
+  // Flush, give back the unused extent and close; a restart continues in a new part
+  void closeFile() {
+    if (!dataFile_->isOpen()) return;
+
+    if (compressing_) flushBlocks();
+    writer_.flush();
+    writeErrors_ += writer_.stats().writeErrors;
+    writer_.end();
+    dataFile_->truncate();
+    dataFile_->close();
+    closeIndex();
+    filePart_++;
+  }
+
+  // ---------- Time index ----------
+
+  // Sidecar index of the part just opened; logging goes on without one
+  void openIndex() {
+    indexer_.restart();
+    if (!indexer_.enabled()) return;
+    char name[FILENAME_SIZE];
+    makeFilename(name, sessionNumber_, filePart_);
+    strcpy(strrchr(name, '.'), ".ssi");
+    if (!storage_->open(indexFile_, name, HAL_FILE_CREATE)) {
+      notify("WARNING: Could not create ", name);
+      return;
+    }
+    CaptureIndexHeader header;
+    initIndexHeader(header, (format_ == LOG_FORMAT_BINARY) ? INDEX_FILE_BINARY : INDEX_FILE_CSV,
+                    Clock::cycleHz(), config_.indexIntervalRecords, config_.indexIntervalMs);
+    indexFile_.write((const uint8_t*)&header, sizeof(header));
+  }
+
+  // Append the entries waiting in RAM (half the table is one 512-byte write)
+  void writeIndex() {
+    if (indexFile_.isOpen() && indexer_.pending() > 0) {
+      indexFile_.write((const uint8_t*)indexer_.entries(), indexer_.pending() * sizeof(CaptureIndexEntry));
+    }
+    indexer_.clear();
+  }
+
+  void closeIndex() {
+    writeIndex();
+    if (indexFile_.isOpen()) indexFile_.close();
+  }
+
+  void prepareSpare() {
+    if (spareReady_ || !dataFile_->isOpen()) return;
+    spareReady_ = createPart(*spareFile_, filePart_ + 1);
+  }
+
+  void discardSpare() {
+    if (spareFile_->isOpen()) {
+      spareFile_->remove();
+    }
+    spareReady_ = false;
+  }
+
+  // Part file full (within the writer's buffer of its extent) or at its time limit
+  bool rotationDue() const {
+    if (!dataFile_->isOpen()) return false;
+
+    uint64_t buffered = WriterBlocks * SECTOR_SIZE;
+    if (compressing_) buffered += sizeof(CaptureBlockHeader) + lz4CompressBound(BLOCK_RAW_BYTES);
+    if (fileUsage() + buffered >= config_.preallocateBytes) return true;
+    return config_.rotateIntervalMs > 0 && Clock::millis() - fileOpenMs_ >= config_.rotateIntervalMs;
+  }
+
+  void rotate() {
+    closeFile();
+    if (!openFile()) {
+      notify("ERROR: Could not open next capture file.", "");
+      return;
+    }
+    notify("Rolled over to ", filename_);
+  }
+
+  void makeHeader(CaptureFileHeader& header) const {
+    initCaptureHeader(header, baudRate_, Clock::rtcSeconds(), config_.firmwareVersion, Clock::cycleHz());
+    header.dataBits = lineFormat_.dataBits;
+    header.parity = lineFormat_.parity;
+    header.stopBits = lineFormat_.stopBits;
+  }
+
+  // The live stream's START batch carries the header a file would have
+  void startLive() {
+    CaptureFileHeader header;
+    makeHeader(header);
+    live_.start(header, Clock::millis());
+  }
+
+  void writeFileHeader() {
+    if (format_ == LOG_FORMAT_BINARY) {
+      CaptureFileHeader header;
+      makeHeader(header);
+      if (compressing_) header.recordFormat = RECORD_FORMAT_BLOCKS;
+      dataFile_->write((const uint8_t*)&header, sizeof(header));
+    } else {
+      dataFile_->write((const uint8_t*)CSV_HEADER, sizeof(CSV_HEADER) - 1);
+      dataFile_->write((const uint8_t*)CSV_LINE_END, CSV_LINE_END_SIZE);
+    }
+  }
+
+  void notify(const char* text, const char* detail) {
+    if (!message_) return;
+    char line[96];
+    snprintf(line, sizeof(line), "%s%s", text, detail);
+    message_(line);
+  }
+
+  Storage* storage_ = nullptr;
+  CaptureEngineConfig config_;
+  EngineMessageFn message_ = nullptr;
+  Merge merge_;
+  CycleExtender clock_;                 // "Now" for the merge horizon
+  SectorWriter<File, WriterBlocks> writer_;
+  LogFormat format_ = LOG_FORMAT_BINARY;
+  bool compress_ = false;               // setCompression()
+  bool compressing_ = false;            // The current part file is in blocks
+  BlockCompressor<BLOCK_RAW_BYTES> blocks_;
+  bool indexDue_ = false;               // Time index entry at the next block
+
+  // Trigger mode
+  TriggerMatcher<TRIGGER_STATE_BITS> matcher_;
+  const char* triggerText_[TRIGGER_MAX_PATTERNS] = {nullptr};
+  TriggerHistory history_;
+  uint32_t historyHeadroom_ = 0;        // Kept free while no window is open
+  uint64_t preTicks_ = 0;
+  uint64_t postTicks_ = 0;
+  bool triggerMode_ = false;            // setTriggerMode()
+  bool triggering_ = false;             // The current capture logs trigger windows
+  bool historyShort_ = false;           // History full before the pre-trigger interval
+  bool packetStarting_[MAX_CAPTURE_CHANNELS] = {false};   // Next byte starts a packet
+  TriggerWindow windows_[TRIGGER_WINDOWS];                // Oldest first from windowFirst_
+  uint32_t windowFirst_ = 0;
+  uint32_t windowCount_ = 0;
+  TriggerStats triggerStats_;
+
+  // Two part files: the one being written and a pre-allocated spare that
+  // becomes current on rollover (pointers swap; files are never copied)
+  File partFiles_[2];
+  File* dataFile_ = &partFiles_[0];
+  File* spareFile_ = &partFiles_[1];
+  bool spareReady_ = false;
+  File indexFile_;                      // Time index of the current part
+  CaptureIndexer<INDEX_ENTRIES> indexer_;
+
+  char filename_[FILENAME_SIZE] = {0};
+  uint32_t sessionNumber_ = 0;
+  uint32_t filePart_ = 0;
+  bool sessionAllocated_ = false;
+  uint32_t fileOpenMs_ = 0;
+  uint32_t baudRate_ = 0;
+  LineFormat lineFormat_;
+  uint64_t firstSampleTicks_ = UINT64_MAX;    // Since start()
+  uint64_t lastRecordTicks_ = 0;        // Delta base (last record's time) in the current part file
+  uint64_t recordsLogged_ = 0;
+  PacketFramer framer_;
+  ChecksumEngine checksums_;
+  LiveStream<StreamPort, LIVE_BATCH_BYTES, LIVE_BATCHES> live_;
+  bool liveEnabled_ = false;
+  bool running_ = false;                // Between start() and stop()
+  uint32_t passMs_ = 0;                 // millis() at the start of the drain() or serviceStorage() call
+  bool pumpDue_ = false;                // drain() ran since the last trigger/block pump
+  uint64_t pumpedRecords_ = 0;          // recordsLogged_ at that pump
+  PendingEvent events_[MAX_PENDING_EVENTS];   // Oldest first
+  uint32_t eventCount_ = 0;
+
+  // Instrumentation
+  PipelineMetrics<Clock, Metrics> metrics_;
+  MetricsSnapshot snapshot_;            // Being logged, from snapshotCursor_ on
+  uint32_t snapshotCursor_ = SNAPSHOT_ENTRIES;   // Metric id x channel; SNAPSHOT_ENTRIES = done
+  uint32_t snapshotMs_ = 0;             // When the last snapshot was taken
+  uint32_t writeErrors_ = 0;            // Of part files already closed
+};
+
+#endif // CAPTUREENGINE_H
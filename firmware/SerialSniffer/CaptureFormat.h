@@ -0,0 +1,550 @@
+/*
+ * SerialSniffer - Binary Capture File Format
+ *
+ * Shared by the Teensy 4.1 firmware and the host-side tools in host/.
+ * Must not depend on Arduino headers.
+ *
+ * Layout: one CaptureFileHeader followed by a stream of records.
+ * Version 1 files hold fixed 8-byte CaptureRecords with millisecond
+ * timestamps. Version 2 files hold variable-length delta records:
+ *
+ *   varint  ticks since the previous record (first: since capture start)
+ *   uint8   tag: bits 0-2 channel, bits 3-6 RecordKind, bit 7 status follows
+ *   uint8   value
+ *   uint8   status (only if tag bit 7 is set)
+ *   varint  argument (version 3: only for kinds other than RECORD_KIND_DATA)
+ *
+ * Records of other kinds are events (e.g. a baud rate change) placed in
+ * time order among the data records; their meaning is per RecordKind.
+ *
+ * With RECORD_FORMAT_BLOCKS the same delta records are grouped into
+ * blocks, each a CaptureBlockHeader and the block's records, stored as
+ * they are or LZ4-compressed (BlockCompressor.h). A block's first delta
+ * counts from the base ticks in its header, so every block decodes on
+ * its own and a damaged or cut-off block loses only its own records.
+ *
+ * Varints are LEB128 (7 bits per byte, low bits first). Ticks run at
+ * CaptureFileHeader::timestampHz. All fixed fields are little-endian
+ * (native on both the Teensy and x86 hosts).
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTUREFORMAT_H
+#define CAPTUREFORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ==================== Constants ====================
+
+const uint32_t CAPTURE_MAGIC = 0x464E5353;      // "SSNF" as stored on disk
+const uint16_t CAPTURE_FORMAT_VERSION = 3;
+const int CAPTURE_VERSION_STRING_SIZE = 16;
+
+// Record encodings
+enum RecordFormat : uint8_t {
+  RECORD_FORMAT_FIXED = 1,        // Fixed-size CaptureRecord per byte (version 1)
+  RECORD_FORMAT_DELTA = 2,        // Varint tick delta + tag + value (version 2)
+  RECORD_FORMAT_BLOCKS = 3        // Delta records in (compressed) CaptureBlocks (version 3)
+};
+
+// How a block's records are stored (CaptureBlockHeader::method)
+enum BlockMethod : uint8_t {
+  BLOCK_STORED = 0,               // As they are (did not compress)
+  BLOCK_LZ4 = 1                   // LZ4 block format
+};
+
+const uint32_t CAPTURE_BLOCK_MAGIC = 0x4B425353;    // "SSBK" as stored on disk
+const uint32_t MAX_BLOCK_RAW_BYTES = 65535;         // Records per block, decompressed
+
+// Delta record kinds (tag bits 3-6)
+enum RecordKind : uint8_t {
+  RECORD_KIND_DATA = 0,           // One captured byte
+  RECORD_KIND_BAUD_CHANGE = 1,    // Capture ports re-locked; argument = new baud rate
+  RECORD_KIND_PACKET_START = 2,   // Before a packet's first byte; argument = packet number on the channel
+  RECORD_KIND_PACKET_END = 3,     // After its last byte; value = PacketEndReason, argument = length
+  RECORD_KIND_CHECKSUM = 4,       // Checksum rule (un)locked on the channel; value = ChecksumAlgorithm,
+                                  // argument = covered-range offset | trailer bytes << 8
+  RECORD_KIND_METRIC = 5          // Instrumentation snapshot entry; value = metric id, argument = its
+                                  // value since capture start (see Metric ids below)
+};
+
+// Why a packet ended (PACKET_END record value)
+enum PacketEndReason : uint8_t {
+  PACKET_END_IDLE = 0,            // Line idle for the threshold; record is at the idle deadline
+  PACKET_END_DELIMITER = 1,       // Last byte was a delimiter
+  PACKET_END_MAX_LENGTH = 2,      // Reached the maximum packet length
+  PACKET_END_STOP = 3             // Capture stopped or session ended
+};
+
+// Packet checksum algorithms (RECORD_KIND_CHECKSUM value); the checksum
+// trails the covered bytes, CRC-16s in the byte order named
+enum ChecksumAlgorithm : uint8_t {
+  CHECKSUM_NONE = 0,              // No rule (detection lost its lock)
+  CHECKSUM_XOR8 = 1,              // XOR of all bytes
+  CHECKSUM_SUM8 = 2,              // Sum of all bytes, modulo 256
+  CHECKSUM_CRC8 = 3,              // CRC-8/SMBUS: poly 0x07, init 0x00
+  CHECKSUM_CRC16_MODBUS = 4,      // CRC-16/MODBUS: poly 0x8005 reflected, init 0xFFFF, low byte first
+  CHECKSUM_CRC16_CCITT = 5        // CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, high byte first
+};
+const uint8_t CHECKSUM_ALGORITHM_COUNT = 6;
+
+// Pipeline stages with a latency histogram (Instrumentation.h)
+enum PipelineStage : uint8_t {
+  STAGE_RECEIVE = 0,              // UART interrupt, per interrupt
+  STAGE_QUEUE = 1,                // Receive stamp to merge (wait in the channel ring), per byte
+  STAGE_FRAMING = 2,              // Packet framing and checksums, per service pass
+  STAGE_ENCODE = 3,               // Record encoding, trigger matching and compression, per service pass
+  STAGE_SD_WRITE = 4,             // Card write, per write
+  STAGE_SD_FLUSH = 5,             // Card sync (directory/FAT update), per sync
+  STAGE_STREAM = 6                // Live stream batches to the port, per service pass
+};
+const uint8_t PIPELINE_STAGE_COUNT = 7;
+
+// Latency histogram buckets: powers of two of cycle counter ticks. Bucket
+// 0 holds everything below 32 ticks, bucket b [2^(b+4), 2^(b+5)), the last
+// one everything from 2^31 on.
+const uint8_t LATENCY_BUCKETS = 28;
+const uint8_t LATENCY_BUCKET_SHIFT = 4;
+
+// Metric ids (RECORD_KIND_METRIC value). Stage metrics are
+// stage * METRIC_STAGE_IDS + field (channel 0); counters from
+// METRIC_COUNTER_BASE on, per channel or for the whole capture (channel 0).
+const uint8_t METRIC_STAGE_IDS = 32;
+enum MetricField : uint8_t {
+  METRIC_FIELD_COUNT = 0,         // Samples in the histogram
+  METRIC_FIELD_TOTAL = 1,         // Sum of all samples (ticks)
+  METRIC_FIELD_MAX = 2,           // Largest sample (ticks)
+  METRIC_FIELD_BUCKET = 3         // 3 + b: samples in bucket b
+};
+enum MetricCounter : uint8_t {
+  METRIC_BYTES_RECEIVED = 224,    // Per channel: bytes out of the UART FIFO
+  METRIC_BYTES_DROPPED = 225,     // Per channel: bytes lost because the channel ring was full
+  METRIC_FRAMING_ERRORS = 226,    // Per channel: bytes with a framing error
+  METRIC_PARITY_ERRORS = 227,     // Per channel: bytes with a parity error
+  METRIC_OVERRUNS = 228,          // Per channel: UART FIFO overruns (bytes lost in hardware, count unknown)
+  METRIC_STREAM_DROPPED = 232,    // Live stream records dropped (queue full)
+  METRIC_WRITE_ERRORS = 233,      // Card writes that came up short
+  METRIC_INDEX_DROPPED = 234,     // Time index entries dropped
+  METRIC_PROBE_TICKS = 235        // Cost of one instrumentation probe (ticks)
+};
+const uint8_t METRIC_COUNTER_BASE = PIPELINE_STAGE_COUNT * METRIC_STAGE_IDS;
+
+// Delta record tag layout
+const uint8_t RECORD_TAG_CHANNEL_MASK = 0x07;
+const uint8_t RECORD_TAG_KIND_SHIFT = 3;
+const uint8_t RECORD_TAG_KIND_MASK = 0x0F;
+const uint8_t RECORD_TAG_HAS_STATUS = 0x80;
+
+const uint32_t MAX_VARINT_SIZE = 10;                        // 64-bit value
+const uint32_t MAX_DELTA_RECORD_SIZE = MAX_VARINT_SIZE + 3;
+const uint32_t MAX_EVENT_RECORD_SIZE = MAX_DELTA_RECORD_SIZE + MAX_VARINT_SIZE;
+
+// Channel identifiers (CSV "Direction" column); ids 2-7 are extra ports
+enum CaptureChannelId : uint8_t {
+  CHANNEL_RX = 0,
+  CHANNEL_TX = 1
+};
+const uint8_t MAX_CAPTURE_CHANNELS = 8;     // Fits the 3-bit record tag field
+
+// Status flags (CSV "Status" column, OK when no bit is set)
+enum RecordStatus : uint8_t {
+  STATUS_OK            = 0x00,
+  STATUS_OVERFLOW      = 0x01,    // Bytes were dropped before this one
+  STATUS_FRAMING_ERROR = 0x02,
+  STATUS_PARITY_ERROR  = 0x04,
+  STATUS_CHECKSUM_VALID = 0x08,   // PACKET_END: packet checksum matched the locked rule
+  STATUS_CHECKSUM_ERROR = 0x10    // PACKET_END: packet checksum did not match
+};
+
+// Parity codes for CaptureFileHeader::parity
+enum ParityCode : uint8_t {
+  PARITY_NONE = 0,
+  PARITY_EVEN = 1,
+  PARITY_ODD  = 2
+};
+
+/**
+ * Character format on the line (data bits, parity, stop bits)
+ */
+struct LineFormat {
+  uint8_t dataBits = 8;           // 7 or 8
+  uint8_t parity = PARITY_NONE;   // ParityCode
+  uint8_t stopBits = 1;           // 1 or 2
+
+  /**
+   * Bit times per character, start bit included
+   */
+  uint32_t characterBits() const { return 1 + dataBits + (parity != PARITY_NONE ? 1 : 0) + stopBits; }
+};
+
+// ==================== Structures ====================
+
+/**
+ * Self-describing header written once at the start of every binary capture
+ */
+struct __attribute__((packed)) CaptureFileHeader {
+  uint32_t magic;                 // CAPTURE_MAGIC
+  uint16_t version;               // CAPTURE_FORMAT_VERSION
+  uint16_t headerSize;            // sizeof(CaptureFileHeader)
+  uint32_t baudRate;              // Target serial baud rate
+  uint8_t  dataBits;              // 7 or 8
+  uint8_t  parity;                // ParityCode
+  uint8_t  stopBits;              // 1 or 2
+  uint8_t  recordFormat;          // RecordFormat
+  uint32_t startTime;             // RTC seconds since 1970 (0 if RTC unset)
+  uint16_t recordSize;            // sizeof(CaptureRecord) for fixed records, 0 for delta
+  uint16_t reserved0;
+  char     firmwareVersion[CAPTURE_VERSION_STRING_SIZE];  // NUL-padded
+  uint32_t timestampHz;           // Delta record tick rate (version 2)
+  uint8_t  reserved[20];
+};
+
+/**
+ * One captured byte (RECORD_FORMAT_FIXED)
+ */
+struct __attribute__((packed)) CaptureRecord {
+  uint32_t timestamp;             // Milliseconds since capture start
+  uint8_t  channel;               // CaptureChannelId
+  uint8_t  value;                 // Captured byte
+  uint8_t  status;                // RecordStatus flags
+  uint8_t  reserved;
+};
+
+/**
+ * Starts every block of a RECORD_FORMAT_BLOCKS file
+ */
+struct __attribute__((packed)) CaptureBlockHeader {
+  uint32_t magic;                 // CAPTURE_BLOCK_MAGIC
+  uint64_t baseTicks;             // First record's delta counts from here
+  uint16_t rawBytes;              // Records, decompressed
+  uint16_t storedBytes;           // Payload that follows the header
+  uint16_t recordCount;
+  uint8_t  method;                // BlockMethod
+  uint8_t  reserved;
+  uint16_t payloadCrc;            // CRC-16/CCITT-FALSE of the payload
+  uint16_t headerCrc;             // CRC-16/CCITT-FALSE of the header bytes before it
+};
+
+static_assert(sizeof(CaptureFileHeader) == 64, "CaptureFileHeader must be 64 bytes");
+static_assert(sizeof(CaptureRecord) == 8, "CaptureRecord must be 8 bytes");
+static_assert(sizeof(CaptureBlockHeader) == 24, "CaptureBlockHeader must be 24 bytes");
+
+// ==================== Helpers ====================
+
+/**
+ * Fill in a capture file header for delta records
+ * @param header Header to initialize
+ * @param baudRate Target serial baud rate
+ * @param startTime RTC seconds since 1970, or 0 if unknown
+ * @param firmwareVersion Version string, truncated to 15 characters
+ * @param timestampHz Record tick rate (CPU cycle counter frequency)
+ */
+inline void initCaptureHeader(CaptureFileHeader& header, uint32_t baudRate,
+                              uint32_t startTime, const char* firmwareVersion,
+                              uint32_t timestampHz) {
+  memset(&header, 0, sizeof(header));
+  header.magic = CAPTURE_MAGIC;
+  header.version = CAPTURE_FORMAT_VERSION;
+  header.headerSize = sizeof(CaptureFileHeader);
+  header.baudRate = baudRate;
+  header.dataBits = 8;
+  header.parity = PARITY_NONE;
+  header.stopBits = 1;
+  header.recordFormat = RECORD_FORMAT_DELTA;
+  header.startTime = startTime;
+  header.recordSize = 0;
+  strncpy(header.firmwareVersion, firmwareVersion, CAPTURE_VERSION_STRING_SIZE - 1);
+  header.timestampHz = timestampHz;
+}
+
+/**
+ * Check that a header was written by a compatible firmware
+ * @return true if magic, version and sizes are understood
+ */
+inline bool isValidCaptureHeader(const CaptureFileHeader& header) {
+  if (header.magic != CAPTURE_MAGIC ||
+      header.version < 1 || header.version > CAPTURE_FORMAT_VERSION ||
+      header.headerSize < sizeof(CaptureFileHeader)) {
+    return false;
+  }
+  if (header.recordFormat == RECORD_FORMAT_FIXED) {
+    return header.recordSize == sizeof(CaptureRecord);
+  }
+  if (header.recordFormat == RECORD_FORMAT_BLOCKS) {
+    return header.version >= 3 && header.timestampHz > 0;
+  }
+  return header.recordFormat == RECORD_FORMAT_DELTA && header.version >= 2 &&
+         header.timestampHz > 0;
+}
+
+/**
+ * Build a fixed-size record for one captured byte
+ */
+inline CaptureRecord makeCaptureRecord(uint32_t timestamp, uint8_t channel,
+                                       uint8_t value, uint8_t status) {
+  CaptureRecord record;
+  record.timestamp = timestamp;
+  record.channel = channel;
+  record.value = value;
+  record.status = status;
+  record.reserved = 0;
+  return record;
+}
+
+/**
+ * Direction column text for a channel id ("RX", "TX", "CH2".."CH7")
+ */
+inline const char* captureChannelName(uint8_t channel) {
+  static const char* const NAMES[MAX_CAPTURE_CHANNELS] = {
+    "RX", "TX", "CH2", "CH3", "CH4", "CH5", "CH6", "CH7"
+  };
+  return channel < MAX_CAPTURE_CHANNELS ? NAMES[channel] : "CH?";
+}
+
+/**
+ * Name of a record kind (CSV event lines and host tools)
+ */
+inline const char* recordKindName(uint8_t kind) {
+  switch (kind) {
+    case RECORD_KIND_DATA: return "DATA";
+    case RECORD_KIND_BAUD_CHANGE: return "BAUD_CHANGE";
+    case RECORD_KIND_PACKET_START: return "PACKET_START";
+    case RECORD_KIND_PACKET_END: return "PACKET_END";
+    case RECORD_KIND_CHECKSUM: return "CHECKSUM";
+    case RECORD_KIND_METRIC: return "METRIC";
+    default: return "UNKNOWN";
+  }
+}
+
+/**
+ * Name of a PacketEndReason
+ */
+inline const char* packetEndReasonName(uint8_t reason) {
+  switch (reason) {
+    case PACKET_END_IDLE: return "IDLE";
+    case PACKET_END_DELIMITER: return "DELIMITER";
+    case PACKET_END_MAX_LENGTH: return "MAX_LENGTH";
+    case PACKET_END_STOP: return "STOP";
+    default: return "UNKNOWN";
+  }
+}
+
+/**
+ * Name of a ChecksumAlgorithm
+ */
+inline const char* checksumAlgorithmName(uint8_t algorithm) {
+  switch (algorithm) {
+    case CHECKSUM_NONE: return "NONE";
+    case CHECKSUM_XOR8: return "XOR8";
+    case CHECKSUM_SUM8: return "SUM8";
+    case CHECKSUM_CRC8: return "CRC8";
+    case CHECKSUM_CRC16_MODBUS: return "CRC16_MODBUS";
+    case CHECKSUM_CRC16_CCITT: return "CRC16_CCITT";
+    default: return "UNKNOWN";
+  }
+}
+
+/**
+ * Name of a PipelineStage
+ */
+inline const char* pipelineStageName(uint8_t stage) {
+  switch (stage) {
+    case STAGE_RECEIVE: return "RECEIVE";
+    case STAGE_QUEUE: return "QUEUE";
+    case STAGE_FRAMING: return "FRAMING";
+    case STAGE_ENCODE: return "ENCODE";
+    case STAGE_SD_WRITE: return "SD_WRITE";
+    case STAGE_SD_FLUSH: return "SD_FLUSH";
+    case STAGE_STREAM: return "STREAM";
+    default: return "UNKNOWN";
+  }
+}
+
+/**
+ * Histogram bucket of a latency in ticks
+ */
+inline uint8_t latencyBucket(uint32_t ticks) {
+  uint32_t log2 = 31 - __builtin_clz(ticks | 1);
+  if (log2 <= LATENCY_BUCKET_SHIFT) return 0;
+  log2 -= LATENCY_BUCKET_SHIFT;
+  return log2 < LATENCY_BUCKETS ? (uint8_t)log2 : LATENCY_BUCKETS - 1;
+}
+
+/**
+ * Smallest latency (ticks) in a histogram bucket
+ */
+inline uint32_t latencyBucketStart(uint8_t bucket) {
+  return bucket == 0 ? 0 : 1UL << (bucket + LATENCY_BUCKET_SHIFT);
+}
+
+/**
+ * Name of a metric id: "QUEUE_COUNT", "SD_WRITE_BUCKET_12",
+ * "BYTES_DROPPED" (no terminator; empty for unused ids)
+ * @param out Destination, at least 24 bytes
+ * @return Characters written
+ */
+inline uint32_t formatMetricName(char* out, uint8_t id) {
+  const char* name = nullptr;
+  const char* field = nullptr;
+  int32_t bucket = -1;
+  if (id < METRIC_COUNTER_BASE) {
+    name = pipelineStageName(id / METRIC_STAGE_IDS);
+    uint8_t index = id % METRIC_STAGE_IDS;
+    if (index == METRIC_FIELD_COUNT) field = "_COUNT";
+    else if (index == METRIC_FIELD_TOTAL) field = "_TOTAL";
+    else if (index == METRIC_FIELD_MAX) field = "_MAX";
+    else if (index < METRIC_FIELD_BUCKET + LATENCY_BUCKETS) bucket = index - METRIC_FIELD_BUCKET;
+    else return 0;
+  } else {
+    switch (id) {
+      case METRIC_BYTES_RECEIVED: name = "BYTES_RECEIVED"; break;
+      case METRIC_BYTES_DROPPED: name = "BYTES_DROPPED"; break;
+      case METRIC_FRAMING_ERRORS: name = "FRAMING_ERRORS"; break;
+      case METRIC_PARITY_ERRORS: name = "PARITY_ERRORS"; break;
+      case METRIC_OVERRUNS: name = "OVERRUNS"; break;
+      case METRIC_STREAM_DROPPED: name = "STREAM_DROPPED"; break;
+      case METRIC_WRITE_ERRORS: name = "WRITE_ERRORS"; break;
+      case METRIC_INDEX_DROPPED: name = "INDEX_DROPPED"; break;
+      case METRIC_PROBE_TICKS: name = "PROBE_TICKS"; break;
+      default: return 0;
+    }
+  }
+  char* at = out;
+  while (*name) *at++ = *name++;
+  if (field) {
+    while (*field) *at++ = *field++;
+  } else if (bucket >= 0) {
+    memcpy(at, "_BUCKET_", 8);
+    at += 8;
+    if (bucket >= 10) *at++ = (char)('0' + bucket / 10);
+    *at++ = (char)('0' + bucket % 10);
+  }
+  return at - out;
+}
+
+/**
+ * Metric id of a name written by formatMetricName()
+ * @return false if no id has that name
+ */
+inline bool parseMetricName(const char* name, uint32_t length, uint8_t& id) {
+  char text[24];
+  for (uint32_t candidate = 0; candidate < 256; candidate++) {
+    uint32_t size = formatMetricName(text, (uint8_t)candidate);
+    if (size > 0 && size == length && memcmp(text, name, length) == 0) {
+      id = (uint8_t)candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Write an unsigned LEB128 varint
+ * @param out Destination, at least MAX_VARINT_SIZE bytes
+ * @return Bytes written
+ */
+inline uint32_t encodeVarint(uint8_t* out, uint64_t value) {
+  uint32_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length;
+}
+
+/**
+ * Read an unsigned LEB128 varint
+ * @param data Input bytes
+ * @param available Bytes readable at data
+ * @param value Decoded value
+ * @return Bytes consumed, or 0 if the varint is truncated or too long
+ */
+inline uint32_t decodeVarint(const uint8_t* data, uint32_t available, uint64_t& value) {
+  value = 0;
+  for (uint32_t i = 0; i < available && i < MAX_VARINT_SIZE; i++) {
+    value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+    if ((data[i] & 0x80) == 0) return i + 1;
+  }
+  return 0;
+}
+
+/**
+ * Encode one delta record
+ * @param out Destination, at least MAX_DELTA_RECORD_SIZE bytes
+ * @param deltaTicks Ticks since the previous record in the file
+ * @param kind RecordKind
+ * @param channel CaptureChannelId
+ * @param value Captured byte (or kind-specific payload)
+ * @param status RecordStatus flags
+ * @return Bytes written
+ */
+inline uint32_t encodeDeltaRecord(uint8_t* out, uint64_t deltaTicks, uint8_t kind,
+                                  uint8_t channel, uint8_t value, uint8_t status) {
+  uint32_t length = encodeVarint(out, deltaTicks);
+  uint8_t tag = (channel & RECORD_TAG_CHANNEL_MASK) |
+                ((kind & RECORD_TAG_KIND_MASK) << RECORD_TAG_KIND_SHIFT);
+  if (status != STATUS_OK) tag |= RECORD_TAG_HAS_STATUS;
+  out[length++] = tag;
+  out[length++] = value;
+  if (status != STATUS_OK) out[length++] = status;
+  return length;
+}
+
+/**
+ * One decoded delta record
+ */
+struct DeltaRecord {
+  uint64_t deltaTicks;
+  uint64_t argument;              // 0 for data records
+  uint8_t kind;
+  uint8_t channel;
+  uint8_t value;
+  uint8_t status;
+};
+
+/**
+ * Decode one delta or event record (version 3)
+ * @param data Input bytes
+ * @param available Bytes readable at data
+ * @return Bytes consumed, or 0 if the record is truncated
+ */
+inline uint32_t decodeDeltaRecord(const uint8_t* data, uint32_t available, DeltaRecord& record) {
+  uint32_t used = decodeVarint(data, available, record.deltaTicks);
+  if (used == 0 || used + 2 > available) return 0;
+  uint8_t tag = data[used];
+  record.value = data[used + 1];
+  used += 2;
+  record.status = STATUS_OK;
+  if (tag & RECORD_TAG_HAS_STATUS) {
+    if (used >= available) return 0;
+    record.status = data[used++];
+  }
+  record.kind = (tag >> RECORD_TAG_KIND_SHIFT) & RECORD_TAG_KIND_MASK;
+  record.channel = tag & RECORD_TAG_CHANNEL_MASK;
+  record.argument = 0;
+  if (record.kind != RECORD_KIND_DATA) {
+    uint32_t argumentSize = decodeVarint(data + used, available - used, record.argument);
+    if (argumentSize == 0) return 0;
+    used += argumentSize;
+  }
+  return used;
+}
+
+/**
+ * Encode one event record (kind other than RECORD_KIND_DATA)
+ * @param out Destination, at least MAX_EVENT_RECORD_SIZE bytes
+ * @param argument Kind-specific value (e.g. the new baud rate)
+ * @return Bytes written
+ */
+inline uint32_t encodeEventRecord(uint8_t* out, uint64_t deltaTicks, uint8_t kind,
+                                  uint8_t channel, uint8_t value, uint8_t status,
+                                  uint64_t argument) {
+  uint32_t length = encodeDeltaRecord(out, deltaTicks, kind, channel, value, status);
+  return length + encodeVarint(out + length, argument);
+}
+
+#endif // CAPTUREFORMAT_H
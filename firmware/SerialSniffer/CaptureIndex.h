@@ -0,0 +1,196 @@
+/*
+ * SerialSniffer - Capture Time Index
+ *
+ * A sidecar file (.ssi, same name as the capture part) written while
+ * logging: a sparse table of (time, file offset) pairs, one every
+ * intervalRecords records or intervalMs of capture time, whichever comes
+ * first. Host tools binary-search it to jump to any moment of a
+ * multi-GB capture and decode only from there (host/lib/TimeIndex.h,
+ * which also rebuilds it for captures that have none).
+ *
+ * Layout: one CaptureIndexHeader followed by CaptureIndexEntry records in
+ * file order. An entry's offset is a record boundary (CSV: a line start)
+ * in the capture file and its ticks the time of the last record before
+ * it, so every record before the offset is at or before ticks and every
+ * record from it on at or after. For delta records ticks is also exactly
+ * the running tick sum a decoder starting at the offset needs.
+ *
+ * Free of Arduino dependencies.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTUREINDEX_H
+#define CAPTUREINDEX_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ==================== Constants ====================
+
+const uint32_t INDEX_MAGIC = 0x58495353;        // "SSIX" as stored on disk
+const uint16_t INDEX_FORMAT_VERSION = 1;
+
+// Capture file the index belongs to
+enum IndexFileType : uint8_t {
+  INDEX_FILE_BINARY = 0,          // .ssb with delta (or fixed) records
+  INDEX_FILE_CSV = 1              // CSV log; ticks convert to the line timestamps
+};
+
+// ==================== Structures ====================
+
+/**
+ * Written once at the start of every index file
+ */
+struct __attribute__((packed)) CaptureIndexHeader {
+  uint32_t magic;                 // INDEX_MAGIC
+  uint16_t version;               // INDEX_FORMAT_VERSION
+  uint16_t headerSize;            // sizeof(CaptureIndexHeader)
+  uint16_t entrySize;             // sizeof(CaptureIndexEntry)
+  uint8_t  fileType;              // IndexFileType
+  uint8_t  reserved0;
+  uint32_t timestampHz;           // Tick rate of CaptureIndexEntry::ticks
+  uint32_t intervalRecords;       // Entry spacing limits (0 = none)
+  uint32_t intervalMs;
+  uint8_t  reserved[8];
+};
+
+/**
+ * One seek point
+ */
+struct __attribute__((packed)) CaptureIndexEntry {
+  uint64_t ticks;                 // Time of the last record before offset
+  uint64_t offset;                // Byte offset of a record in the capture file
+};
+
+static_assert(sizeof(CaptureIndexHeader) == 32, "CaptureIndexHeader must be 32 bytes");
+static_assert(sizeof(CaptureIndexEntry) == 16, "CaptureIndexEntry must be 16 bytes");
+
+// ==================== Helpers ====================
+
+/**
+ * Fill in an index file header
+ */
+inline void initIndexHeader(CaptureIndexHeader& header, uint8_t fileType, uint32_t timestampHz,
+                            uint32_t intervalRecords, uint32_t intervalMs) {
+  memset(&header, 0, sizeof(header));
+  header.magic = INDEX_MAGIC;
+  header.version = INDEX_FORMAT_VERSION;
+  header.headerSize = sizeof(CaptureIndexHeader);
+  header.entrySize = sizeof(CaptureIndexEntry);
+  header.fileType = fileType;
+  header.timestampHz = timestampHz;
+  header.intervalRecords = intervalRecords;
+  header.intervalMs = intervalMs;
+}
+
+/**
+ * Check that an index header is one this code understands
+ */
+inline bool isValidIndexHeader(const CaptureIndexHeader& header) {
+  return header.magic == INDEX_MAGIC && header.version == INDEX_FORMAT_VERSION &&
+         header.headerSize >= sizeof(CaptureIndexHeader) &&
+         header.entrySize == sizeof(CaptureIndexEntry) && header.timestampHz > 0 &&
+         header.fileType <= INDEX_FILE_CSV;
+}
+
+// ==================== Indexer ====================
+
+/**
+ * Decides where entries go and holds them until they are written
+ *
+ * The caller asks due() before appending each record and, when it says
+ * so, add()s an entry for the current file offset. Entries wait in a
+ * small RAM table that the caller writes to the sidecar file when
+ * convenient (half full, or when the part file closes); if it fills up
+ * first, further entries are dropped and counted - the index gets
+ * coarser, never wrong.
+ *
+ * @tparam Entries RAM table size
+ */
+template <uint32_t Entries>
+class CaptureIndexer {
+ public:
+  /**
+   * @param intervalRecords Records between entries (0 = no record limit)
+   * @param intervalTicks Ticks between entries (0 = no time limit)
+   */
+  void begin(uint32_t intervalRecords, uint64_t intervalTicks) {
+    intervalRecords_ = intervalRecords ? intervalRecords : UINT32_MAX;
+    intervalTicks_ = intervalTicks ? intervalTicks : UINT64_MAX;
+    enabled_ = intervalRecords > 0 || intervalTicks > 0;
+    restart();
+  }
+
+  /**
+   * Start the index of a new part file (pending entries must be written)
+   */
+  void restart() {
+    count_ = 0;
+    records_ = 0;
+    started_ = false;
+  }
+
+  /**
+   * Count a record about to be appended
+   * @param ticks Its time
+   * @return true if an entry belongs just before it
+   */
+  bool due(uint64_t ticks) {
+    if (!enabled_) return false;
+    if (!started_) {
+      // The part's first record needs no entry: the file start is one
+      started_ = true;
+      nextTicks_ = after(ticks);
+      return false;
+    }
+    return ++records_ >= intervalRecords_ || ticks >= nextTicks_;
+  }
+
+  /**
+   * Record an entry (after due() returned true)
+   * @param lastTicks Time of the last record before offset
+   * @param offset Where the next record goes in the capture file
+   * @param ticks Time of that next record
+   */
+  void add(uint64_t lastTicks, uint64_t offset, uint64_t ticks) {
+    records_ = 0;
+    nextTicks_ = after(ticks);
+    if (count_ == Entries) {
+      dropped_++;
+      return;
+    }
+    entries_[count_].ticks = lastTicks;
+    entries_[count_].offset = offset;
+    count_++;
+  }
+
+  bool enabled() const { return enabled_; }
+  uint32_t pending() const { return count_; }
+  bool halfFull() const { return count_ >= Entries / 2; }
+  const CaptureIndexEntry* entries() const { return entries_; }
+  uint32_t dropped() const { return dropped_; }   // Since power-up
+
+  /**
+   * Forget the pending entries (after writing them)
+   */
+  void clear() { count_ = 0; }
+
+ private:
+  uint64_t after(uint64_t ticks) const {
+    return ticks < UINT64_MAX - intervalTicks_ ? ticks + intervalTicks_ : UINT64_MAX;
+  }
+
+  CaptureIndexEntry entries_[Entries];
+  uint32_t count_ = 0;
+  uint32_t records_ = 0;            // Since the last entry
+  uint32_t intervalRecords_ = UINT32_MAX;
+  uint64_t intervalTicks_ = UINT64_MAX;
+  uint64_t nextTicks_ = UINT64_MAX;
+  uint32_t dropped_ = 0;
+  bool started_ = false;
+  bool enabled_ = false;
+};
+
+#endif // CAPTUREINDEX_H
@@ -0,0 +1,142 @@
+/*
+ * SerialSniffer - Persisted Capture Settings
+ *
+ * The capture configuration that survives a power cycle (FR-010): line
+ * rate and character format, which capture ports are enabled, log format,
+ * compression, trigger and part file rotation settings, and whether to
+ * start capturing at power-up without a host. The firmware keeps one
+ * CaptureSettings block in the Teensy's emulated EEPROM; a block with the
+ * wrong magic, version, size or CRC (never saved, or written by another
+ * firmware) is ignored and the compiled-in defaults apply.
+ *
+ * Free of Arduino dependencies.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTURESETTINGS_H
+#define CAPTURESETTINGS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CaptureFormat.h"
+#include "ChecksumEngine.h"
+
+// ==================== Constants ====================
+
+const uint32_t SETTINGS_MAGIC = 0x47435353;     // "SSCG" as stored
+const uint16_t SETTINGS_VERSION = 1;
+const uint32_t SETTINGS_MIN_BAUD = 110;
+const uint32_t SETTINGS_MAX_BAUD = 6000000;     // LPUART clock / 4
+
+// ==================== Structures ====================
+
+/**
+ * One saved configuration
+ */
+struct __attribute__((packed)) CaptureSettings {
+  uint32_t magic;                 // SETTINGS_MAGIC
+  uint16_t version;               // SETTINGS_VERSION
+  uint16_t size;                  // sizeof(CaptureSettings)
+  uint32_t baudRate;
+  uint8_t  dataBits;              // LineFormat fields
+  uint8_t  parity;
+  uint8_t  stopBits;
+  uint8_t  portMask;              // Bit i: capture port i enabled
+  uint8_t  autoCapture;           // Start capturing at power-up
+  uint8_t  logFormat;             // LogFormat (CaptureEngine.h)
+  uint8_t  compress;              // LZ4 blocks in binary logs
+  uint8_t  trigger;               // Log only windows around pattern hits
+  uint8_t  liveStream;            // Live record stream on at power-up
+  uint8_t  reserved[3];
+  uint32_t preTriggerMs;
+  uint32_t postTriggerMs;
+  uint32_t rotateIntervalMs;      // Part time limit, 0 = size only
+  uint32_t partMegabytes;         // Part size (pre-allocated extent)
+  uint16_t crc;                   // CRC-16/CCITT-FALSE of the bytes before it
+};
+
+static_assert(sizeof(CaptureSettings) == 42, "CaptureSettings must be 42 bytes");
+
+// ==================== Helpers ====================
+
+/**
+ * Formats the Teensy 4 LPUARTs receive: 8N1, 8E1, 8O1, 8N2, 7E1, 7O1
+ * (7 data bits only with parity, 2 stop bits only without)
+ */
+inline bool isSupportedLineFormat(const LineFormat& format) {
+  if (format.parity > PARITY_ODD || format.stopBits < 1 || format.stopBits > 2) return false;
+  if (format.dataBits == 7) return format.parity != PARITY_NONE && format.stopBits == 1;
+  return format.dataBits == 8 && (format.stopBits == 1 || format.parity == PARITY_NONE);
+}
+
+/**
+ * Short name of a line format, e.g. "8N1"
+ * @param text At least 4 characters
+ */
+inline void lineFormatName(const LineFormat& format, char* text) {
+  static const char PARITY_LETTERS[] = "NEO";
+  text[0] = (char)('0' + format.dataBits % 10);
+  text[1] = format.parity <= PARITY_ODD ? PARITY_LETTERS[format.parity] : '?';
+  text[2] = (char)('0' + format.stopBits % 10);
+  text[3] = '\0';
+}
+
+/**
+ * The saved line format, and setting it
+ */
+inline LineFormat settingsLineFormat(const CaptureSettings& settings) {
+  LineFormat format;
+  format.dataBits = settings.dataBits;
+  format.parity = settings.parity;
+  format.stopBits = settings.stopBits;
+  return format;
+}
+
+inline void setSettingsLineFormat(CaptureSettings& settings, const LineFormat& format) {
+  settings.dataBits = format.dataBits;
+  settings.parity = format.parity;
+  settings.stopBits = format.stopBits;
+}
+
+/**
+ * Clear settings and fill in the identification fields (the caller sets
+ * the values, then sealCaptureSettings())
+ */
+inline void initCaptureSettings(CaptureSettings& settings) {
+  memset(&settings, 0, sizeof(settings));
+  settings.magic = SETTINGS_MAGIC;
+  settings.version = SETTINGS_VERSION;
+  settings.size = sizeof(CaptureSettings);
+  setSettingsLineFormat(settings, LineFormat());
+}
+
+/**
+ * Compute the CRC (before storing)
+ */
+inline void sealCaptureSettings(CaptureSettings& settings) {
+  settings.crc = crc16Ccitt((const uint8_t*)&settings, sizeof(settings) - sizeof(settings.crc));
+}
+
+/**
+ * Check stored settings before using them
+ * @param portCount Capture ports in this build; portMask must enable at
+ *                  least one of them
+ * @return true if identification, CRC and every value are valid
+ */
+inline bool isValidCaptureSettings(const CaptureSettings& settings, uint32_t portCount) {
+  if (settings.magic != SETTINGS_MAGIC || settings.version != SETTINGS_VERSION ||
+      settings.size != sizeof(CaptureSettings)) {
+    return false;
+  }
+  if (crc16Ccitt((const uint8_t*)&settings, sizeof(settings) - sizeof(settings.crc)) != settings.crc) return false;
+  uint32_t ports = portCount < 8 ? (1u << portCount) - 1 : 0xFF;
+  return settings.baudRate >= SETTINGS_MIN_BAUD && settings.baudRate <= SETTINGS_MAX_BAUD &&
+         isSupportedLineFormat(settingsLineFormat(settings)) && (settings.portMask & ports) != 0 &&
+         settings.autoCapture <= 1 && settings.logFormat <= 1 && settings.compress <= 1 &&
+         settings.trigger <= 1 && settings.liveStream <= 1 && settings.partMegabytes >= 1;
+}
+
+#endif // CAPTURESETTINGS_H
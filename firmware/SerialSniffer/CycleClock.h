@@ -0,0 +1,76 @@
+/*
+ * SerialSniffer - Cycle Counter Timestamps
+ *
+ * Received bytes are stamped in the UART interrupt with the 32-bit ARM
+ * cycle counter (600 MHz on the Teensy 4.1, wrapping every ~7 s). The
+ * logging path extends those stamps to 64-bit tick counts since capture
+ * start. Free of Arduino dependencies so the host tools share it.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CYCLECLOCK_H
+#define CYCLECLOCK_H
+
+#include <stdint.h>
+
+/**
+ * One received byte as queued by the UART interrupt
+ */
+struct RxSample {
+  uint32_t cycles;                // Raw cycle counter at reception
+  uint8_t  value;                 // Received byte
+  uint8_t  status;                // RecordStatus flags
+  uint8_t  channel;               // CaptureChannelId
+  uint8_t  reserved;
+};
+
+static_assert(sizeof(RxSample) == 8, "RxSample must be 8 bytes");
+
+/**
+ * Extends a wrapping 32-bit counter to 64 bits
+ *
+ * Each raw value is taken as the nearest 64-bit value to the latest one
+ * seen, so stamps may arrive slightly out of order (a sample stamped just
+ * before a "now" reading) as long as extend() is called at least once per
+ * half wrap period (~3.5 s at 600 MHz), e.g. with the current counter
+ * from the main loop while the line is idle.
+ */
+class CycleExtender {
+ public:
+  /**
+   * Start counting
+   * @param raw Counter value that becomes tick 0
+   */
+  void reset(uint32_t raw) {
+    origin_ = raw;
+    latest_ = raw;
+  }
+
+  /**
+   * Convert a raw counter value to ticks since reset()
+   * Values before the origin clamp to 0.
+   */
+  uint64_t extend(uint32_t raw) {
+    int32_t delta = (int32_t)(raw - (uint32_t)latest_);
+    uint64_t value = latest_ + (int64_t)delta;
+    if (delta > 0) latest_ = value;
+    return value > origin_ ? value - origin_ : 0;
+  }
+
+ private:
+  uint64_t origin_ = 0;
+  uint64_t latest_ = 0;
+};
+
+/**
+ * Convert ticks to nanoseconds without overflowing 64 bits
+ * @param ticks Tick count
+ * @param hz Tick rate (must be non-zero)
+ */
+inline uint64_t ticksToNs(uint64_t ticks, uint32_t hz) {
+  return (ticks / hz) * 1000000000ULL + (ticks % hz) * 1000000000ULL / hz;
+}
+
+#endif // CYCLECLOCK_H
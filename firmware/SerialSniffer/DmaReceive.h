@@ -0,0 +1,358 @@
+/*
+ * SerialSniffer - Circular DMA Receive
+ *
+ * Consumer side of a UART received by DMA into a circular buffer instead
+ * of one interrupt per character. The DMA engine writes every character
+ * (with its error flags, as a 16-bit data register read) into DmaRxRing
+ * and wraps around at the end; the capture task reads the engine's write
+ * position and turns everything written since its last visit into
+ * CaptureChannel samples (drainDmaRing()).
+ *
+ * Only two interrupts remain per port: the end of each lap of the buffer
+ * (counts laps, so a consumer that fell a whole lap behind notices) and
+ * the idle line (stamps the end of each burst, so bytes from a line that
+ * went quiet long before the capture task came by are not dated to its
+ * visit). Without a lap count the position alone cannot tell one lap
+ * from two.
+ *
+ * Free of Arduino dependencies so the host simulator can drive it with a
+ * simulated DMA write pointer.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef DMARECEIVE_H
+#define DMARECEIVE_H
+
+#include <stdint.h>
+
+#include "CaptureFormat.h"
+#include "RingBuffer.h"
+
+/**
+ * Error flag bits of a received word (above the 8 data bits), and the
+ * data bits themselves (0x7F for 7-bit characters, whose parity bit
+ * reads as bit 7)
+ */
+struct DmaWordFormat {
+  uint16_t framingMask;
+  uint16_t parityMask;
+  uint8_t dataMask;
+};
+
+/**
+ * Where the line went idle (idle line interrupt)
+ */
+struct DmaIdleMark {
+  uint32_t position;              // DMA write position (words into the lap)
+  uint32_t cycles;                // Cycle counter on interrupt entry
+};
+
+/**
+ * Circular DMA receive buffer and its consumer state
+ *
+ * Positions run freely over the uint32_t range, like SpscRing's indexes:
+ * written_ is everything the DMA engine has stored as of the last
+ * update(), read_ everything consumed or skipped. Words more than
+ * Size - GUARD behind the engine are skipped as lost, leaving GUARD words
+ * for the engine to write while a span is still being copied.
+ *
+ * @tparam Size Words in the buffer (power of two)
+ */
+template <uint32_t Size>
+class DmaRxRing {
+  static_assert(Size >= 64 && (Size & (Size - 1)) == 0, "DmaRxRing size must be a power of two >= 64");
+
+ public:
+  static const uint32_t SIZE = Size;
+  static const uint32_t GUARD = Size / 8;
+  static const uint32_t IDLE_MARKS = 256;       // ~4 ms of 1-character bursts at 2 Mbaud
+
+  /**
+   * DMA destination (Size 16-bit words)
+   */
+  volatile uint16_t* buffer() { return words_; }
+
+  /**
+   * Forget everything (before the DMA engine starts; it starts at word 0)
+   */
+  void reset() {
+    laps_ = 0;
+    overruns_ = 0;
+    seenOverruns_ = 0;
+    written_ = 0;
+    read_ = 0;
+    lost_ = 0;
+    lostPending_ = false;
+    marks_.clear();
+    marksDropped_ = 0;
+    seenMarksDropped_ = 0;
+    latestSequence_ = 0;
+  }
+
+  // ---------- Interrupt side ----------
+
+  /**
+   * The DMA engine finished a lap and restarted at word 0
+   */
+  void lapCompleted() { laps_ = laps_ + 1; }
+
+  /**
+   * The line went idle with position words written into the current lap
+   * Queued, unless IDLE_MARKS are pending already; the newest mark is
+   * kept either way, so the words up to it are still dated from it.
+   */
+  void markIdle(uint32_t position, uint32_t cycles) {
+    DmaIdleMark mark = {position, cycles};
+    if (!marks_.push(mark)) marksDropped_ = marksDropped_ + 1;
+    latestSequence_ = latestSequence_ + 1;       // Odd: being written
+    latestPosition_ = position;
+    latestCycles_ = cycles;
+    latestSequence_ = latestSequence_ + 1;
+  }
+
+  /**
+   * The UART's receive FIFO overran: characters were lost before the
+   * DMA engine got to them
+   */
+  void markOverrun() { overruns_ = overruns_ + 1; }
+
+  uint32_t laps() const { return laps_; }
+
+  // ---------- Consumer side ----------
+
+  /**
+   * Catch up with the DMA engine
+   * A position behind the last one means the engine wrapped but its lap
+   * interrupt has not run yet.
+   * @param laps Lap count read before position (laps())
+   * @param position Words written into the current lap (0 to Size - 1)
+   * @return Words readable
+   */
+  uint32_t update(uint32_t laps, uint32_t position) {
+    uint32_t written = laps * Size + position;
+    if ((int32_t)(written - written_) < 0) written += Size;
+    written_ = written;
+
+    uint32_t backlog = written_ - read_;
+    if (backlog > Size - GUARD) {
+      uint32_t skipped = backlog - (Size - GUARD);
+      read_ += skipped;
+      lost_ += skipped;
+      lostPending_ = true;
+      backlog -= skipped;
+    }
+    return backlog;
+  }
+
+  /**
+   * Get the oldest unread words up to the end of the buffer
+   * @param data Set to the first unread word
+   * @return Contiguous words readable (0 if none)
+   */
+  uint32_t readSpan(const volatile uint16_t*& data) const {
+    uint32_t index = read_ & (Size - 1);
+    uint32_t available = written_ - read_;
+    uint32_t toEnd = Size - index;
+    data = &words_[index];
+    return available < toEnd ? available : toEnd;
+  }
+
+  void consume(uint32_t count) { read_ += count; }
+
+  /**
+   * Words skipped since the last call (consumer fell too far behind)
+   */
+  bool takeLost() {
+    bool lost = lostPending_;
+    lostPending_ = false;
+    return lost;
+  }
+
+  /**
+   * FIFO overruns reported since the last call
+   */
+  bool takeOverrun() {
+    uint32_t overruns = overruns_;
+    bool overran = overruns != seenOverruns_;
+    seenOverruns_ = overruns;
+    return overran;
+  }
+
+  /**
+   * Oldest idle mark, as an absolute position (marks at or before the
+   * read position are stale and dropped)
+   * @param position Set to the words written when the line went idle
+   * @param cycles Set to the interrupt's cycle counter
+   * @param limit Only marks taken before the last update() count: the
+   *              number of marks pending when it was read (less the
+   *              stale ones dropped here)
+   * @return false if there is none
+   */
+  bool nextIdleMark(uint32_t& position, uint32_t& cycles, uint32_t& limit) {
+    const DmaIdleMark* mark;
+    while (limit > 0 && marks_.readSpan(mark) > 0) {
+      uint32_t absolute = absolutePosition(mark->position);
+      if ((int32_t)(absolute - read_) > 0) {
+        position = absolute;
+        cycles = mark->cycles;
+        return true;
+      }
+      marks_.consumeRead(1);
+      limit--;
+    }
+    return false;
+  }
+
+  /**
+   * Release the mark nextIdleMark() returned
+   */
+  void dropIdleMark() { marks_.consumeRead(1); }
+
+  /**
+   * Newest idle mark, if marks were dropped since the last call (it is
+   * then newer than that call; otherwise it may be older than a lap and
+   * the last queued mark is the same one anyway)
+   * @return false if no mark was dropped
+   */
+  bool latestIdleMark(DmaIdleMark& mark) {
+    uint32_t dropped = marksDropped_;
+    if (dropped == seenMarksDropped_) return false;
+    seenMarksDropped_ = dropped;
+    uint32_t sequence;
+    do {
+      sequence = latestSequence_;
+      mark.position = latestPosition_;
+      mark.cycles = latestCycles_;
+    } while ((sequence & 1) || sequence != latestSequence_);
+    return true;
+  }
+
+  /**
+   * Absolute position of a mark's write position (taken before the last
+   * update(), less than a lap ago)
+   */
+  uint32_t absolutePosition(uint32_t position) const {
+    return written_ - ((written_ - position) & (Size - 1));
+  }
+
+  uint32_t pendingMarks() { return marks_.size(); }
+  uint32_t written() const { return written_; }
+  uint32_t readPosition() const { return read_; }
+  uint32_t lost() const { return lost_; }
+  uint32_t marksDropped() const { return marksDropped_; }
+
+ private:
+  volatile uint16_t words_[Size];
+  volatile uint32_t laps_ = 0;
+  volatile uint32_t overruns_ = 0;
+  uint32_t seenOverruns_ = 0;
+  uint32_t written_ = 0;
+  uint32_t read_ = 0;
+  uint32_t lost_ = 0;
+  bool lostPending_ = false;
+  SpscRing<DmaIdleMark, IDLE_MARKS> marks_;
+  volatile uint32_t marksDropped_ = 0;
+  uint32_t seenMarksDropped_ = 0;
+  volatile uint32_t latestSequence_ = 0;
+  volatile uint32_t latestPosition_ = 0;
+  volatile uint32_t latestCycles_ = 0;
+};
+
+/**
+ * Move everything the DMA engine wrote since the last call into a channel
+ *
+ * Stamps like lpuartReceive(): each word is dated one character time
+ * before the next. Words up to an idle mark count back from the mark's
+ * interrupt (less the idle characters that raised it), later words from
+ * the moment the write position was read. Skipped words are counted as
+ * dropped; they and FIFO overruns flag the next queued sample with
+ * STATUS_OVERFLOW.
+ *
+ * @tparam Clock HAL clock (cycles())
+ * @tparam Ring DmaRxRing<N>
+ * @tparam Channel CaptureChannel<N, M>
+ * @tparam PositionFn Called as position() for the engine's write position
+ * @param ring DMA buffer (consumer side)
+ * @param channel Destination (its only producer while receiving by DMA)
+ * @param format Error flag bits of a word
+ * @param idleCharacters Idle characters that raise the idle interrupt
+ * @param position Current write position, words into the lap
+ * @return Words moved (skipped ones not counted)
+ */
+template <typename Clock, typename Ring, typename Channel, typename PositionFn>
+uint32_t drainDmaRing(Ring& ring, Channel& channel, const DmaWordFormat& format, uint32_t idleCharacters,
+                      PositionFn&& position) {
+  // Marks first: every one of them is then covered by the position read
+  uint32_t marks = ring.pendingMarks();
+  DmaIdleMark latest = {0, 0};
+  bool haveLatest = ring.latestIdleMark(latest);
+  uint32_t laps;
+  uint32_t where;
+  do {
+    laps = ring.laps();
+    where = position();
+  } while (laps != ring.laps());
+  uint32_t nowCycles = Clock::cycles();
+
+  uint32_t readBefore = ring.readPosition();
+  uint32_t backlog = ring.update(laps, where);
+  uint32_t skipped = ring.readPosition() - readBefore;
+  if (skipped > 0) {
+    channel.stats.bytesReceived += skipped;
+    channel.stats.bytesDropped += skipped;
+  }
+  bool lost = ring.takeLost();
+  if (ring.takeOverrun() || lost) channel.overflowPending = true;
+
+  uint32_t moved = 0;
+  while (backlog > 0) {
+    // Stamp reference for the words up to the next idle mark, or up to
+    // the write position
+    uint32_t end = ring.written();
+    uint32_t reference = nowCycles;
+    uint32_t extra = 0;
+    uint32_t markPosition, markCycles;
+    bool queued = ring.nextIdleMark(markPosition, markCycles, marks);
+    bool marked = queued;
+    if (!queued && haveLatest) {
+      // Past the queued marks (the queue overflowed): the newest one
+      haveLatest = false;
+      markPosition = ring.absolutePosition(latest.position);
+      markCycles = latest.cycles;
+      marked = (int32_t)(markPosition - ring.readPosition()) > 0;
+    }
+    if (marked) {
+      end = markPosition;
+      reference = markCycles;
+      extra = idleCharacters;
+    }
+
+    uint32_t group = end - ring.readPosition();
+    while (group > 0) {
+      const volatile uint16_t* data;
+      uint32_t span = ring.readSpan(data);
+      if (span > group) span = group;
+      uint32_t behind = (end - ring.readPosition()) - 1 + extra;
+      for (uint32_t i = 0; i < span; i++) {
+        uint16_t word = data[i];
+        uint8_t status = STATUS_OK;
+        if (word & format.framingMask) status |= STATUS_FRAMING_ERROR;
+        if (word & format.parityMask) status |= STATUS_PARITY_ERROR;
+        channel.receive(reference, behind - i, (uint8_t)word & format.dataMask, status);
+      }
+      ring.consume(span);
+      group -= span;
+      backlog -= span;
+      moved += span;
+    }
+    if (queued) {
+      ring.dropIdleMark();
+      marks--;
+    }
+  }
+  return moved;
+}
+
+#endif // DMARECEIVE_H
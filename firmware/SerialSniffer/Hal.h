@@ -0,0 +1,96 @@
+/*
+ * SerialSniffer - Hardware Abstraction Layer
+ *
+ * The capture path (CaptureEngine.h) is written against the interfaces
+ * below instead of calling Serial1, SD, millis() or attachInterrupt()
+ * directly. They are compile-time interfaces: an implementation is a set
+ * of classes with the listed members, bundled in a Hal struct and passed
+ * as a template parameter, so nothing is virtual on the Teensy.
+ *
+ * Implementations:
+ *   HalTeensy.h    Teensy 4.1 (Arduino core, SdFat, LPUART registers)
+ *   host/sim/      Simulated clock, UARTs, SD card and edges for Linux
+ *
+ * Free of Arduino dependencies.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hal bundle
+ *
+ *   struct Hal {
+ *     typedef ... Clock;
+ *     typedef ... Storage;
+ *     typedef ... File;
+ *     typedef ... SerialPort;
+ *     typedef ... EdgeInput;
+ *     typedef ... StreamPort;
+ *   };
+ *
+ * Clock (static members)
+ *   uint32_t millis()             Milliseconds since boot
+ *   uint32_t micros()             Microseconds since boot
+ *   uint32_t cycles()             Free-running 32-bit cycle counter
+ *   uint32_t cycleHz()            Cycle counter rate
+ *   uint32_t rtcSeconds()         Wall clock, seconds since 1970 (0 if unset)
+ *
+ * Storage
+ *   bool exists(const char* path)
+ *   bool open(File& file, const char* path, HalFileMode mode)
+ *
+ * File (also the SectorWriter device)
+ *   bool isOpen() const
+ *   int read(void* data, size_t length)           Bytes read, or -1
+ *   size_t write(const uint8_t* data, size_t length)
+ *   void flush()                                  Sync data and metadata
+ *   bool preAllocate(uint64_t length)             Reserve a contiguous extent
+ *   bool truncate()                               Drop everything past position()
+ *   uint64_t position() const
+ *   bool seek(uint64_t position)                  Move to a byte already written
+ *   bool close()
+ *   bool remove()                                 Delete an open file
+ *
+ * SerialPort (a monitored UART feeding one CaptureChannel)
+ *   void begin(uint32_t baud, const LineFormat& format = LineFormat())
+ *                                 Start receiving into the channel
+ *                                 (LineFormat: CaptureFormat.h)
+ *   void end()                    Stop receiving; the channel keeps its samples
+ *   void changeBaud(uint32_t baud, uint32_t& byteCycles, uint32_t characterCycles)
+ *                                 Switch rate while receiving: characters already
+ *                                 received reach the channel at the old rate,
+ *                                 then byteCycles becomes characterCycles
+ *   uint32_t poll()               Move received characters into the channel, for
+ *                                 ports that don't do it in an interrupt (DMA);
+ *                                 returns the number moved
+ *
+ * EdgeInput (level changes on a pin, for baud detection)
+ *   void begin(uint8_t pin, HalEdgeFn onEdge)     onEdge runs in interrupt context
+ *   void end()
+ *
+ * StreamPort (link to the host computer, for the live record stream)
+ *   int availableForWrite()       Bytes write() takes without blocking
+ *   size_t write(const uint8_t* data, size_t length)
+ */
+
+/**
+ * File open modes
+ */
+enum HalFileMode : uint8_t {
+  HAL_FILE_READ = 0,              // Existing file, read only
+  HAL_FILE_CREATE = 1             // Read/write, created or truncated
+};
+
+/**
+ * Edge callback (interrupt context)
+ */
+typedef void (*HalEdgeFn)();
+
+#endif // HAL_H
@@ -0,0 +1,395 @@
+/*
+ * SerialSniffer - Teensy 4.1 HAL
+ *
+ * Hal.h interfaces on the Teensy: Arduino clock and cycle counter, SdFat
+ * files on the built-in SD card, LPUART capture ports (per-character
+ * interrupt or eDMA), pin-change interrupts and a USB serial port for the
+ * live stream. Firmware only.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef HALTEENSY_H
+#define HALTEENSY_H
+
+#include <Arduino.h>
+#include <DMAChannel.h>
+#include <SD.h>
+
+#include "CaptureFormat.h"
+#include "DmaReceive.h"
+#include "Hal.h"
+#include "Instrumentation.h"
+
+// ==================== Clock ====================
+
+struct TeensyClock {
+  static uint32_t millis() { return ::millis(); }
+  static uint32_t micros() { return ::micros(); }
+  static uint32_t cycles() { return ARM_DWT_CYCCNT; }
+  static uint32_t cycleHz() { return F_CPU_ACTUAL; }
+  static uint32_t rtcSeconds() { return rtc_get(); }
+
+  /**
+   * Make sure the cycle counter runs (call once from setup())
+   */
+  static void begin() {
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  }
+};
+
+// ==================== Storage ====================
+
+/**
+ * SdFat file on the built-in card
+ */
+class TeensyFile {
+ public:
+  bool isOpen() const { return file_.isOpen(); }
+  int read(void* data, size_t length) { return file_.read(data, length); }
+  size_t write(const uint8_t* data, size_t length) { return file_.write(data, length); }
+  void flush() { file_.flush(); }
+  bool preAllocate(uint64_t length) { return file_.preAllocate(length); }
+  bool truncate() { return file_.truncate(); }
+  uint64_t position() const { return file_.curPosition(); }
+  bool seek(uint64_t position) { return file_.seekSet(position); }
+  bool close() { return file_.close(); }
+  bool remove() { return file_.remove(); }
+
+  FsFile& raw() { return file_; }
+
+ private:
+  mutable FsFile file_;
+};
+
+/**
+ * Built-in SD card through SdFat (SD.sdfs)
+ */
+class TeensyStorage {
+ public:
+  bool exists(const char* path) { return SD.sdfs.exists(path); }
+
+  bool open(TeensyFile& file, const char* path, HalFileMode mode) {
+    oflag_t flags = (mode == HAL_FILE_CREATE) ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY;
+    file.raw() = SD.sdfs.open(path, flags);
+    return file.isOpen();
+  }
+};
+
+// ==================== Capture Ports ====================
+
+/**
+ * HardwareSerial::begin() format for a line format
+ * Teensy 4 LPUARTs take 7 data bits only with parity, and 2 stop bits
+ * only as 8N2; other combinations fall back to 8N1 (see
+ * isSupportedLineFormat()).
+ */
+inline uint16_t teensySerialFormat(const LineFormat& format) {
+  if (format.dataBits == 7) return format.parity == PARITY_ODD ? SERIAL_7O1 : SERIAL_7E1;
+  if (format.parity == PARITY_EVEN) return SERIAL_8E1;
+  if (format.parity == PARITY_ODD) return SERIAL_8O1;
+  return format.stopBits == 2 ? SERIAL_8N2 : SERIAL_8N1;
+}
+
+/**
+ * Data bits of a DATA register read: with parity in an 8-bit frame (7
+ * data bits) the parity bit reads as bit 7
+ */
+inline uint8_t lpuartDataMask(IMXRT_LPUART_t* lpuart) {
+  return (lpuart->CTRL & (LPUART_CTRL_PE | LPUART_CTRL_M)) == LPUART_CTRL_PE ? 0x7F : 0xFF;
+}
+
+/**
+ * Switch a running LPUART to another rate by rewriting only its BAUD
+ * divider (OSR/SBR/BOTHEDGE, chosen as HardwareSerial::begin() does from
+ * the 24 MHz UART clock); every other BAUD bit (RDMAE) is kept. The
+ * receiver and transmitter are off for the write, as the reference
+ * manual requires; the FIFO keeps its characters.
+ */
+inline void lpuartSetBaud(IMXRT_LPUART_t* lpuart, uint32_t baud) {
+  const float base = 24000000.0f / (float)baud;
+  float bestError = 1e20f;
+  uint32_t bestDivider = 1;
+  uint32_t bestOversampling = 4;
+  for (uint32_t oversampling = 4; oversampling <= 32; oversampling++) {
+    float divider = base / (float)oversampling;
+    int32_t rounded = (int32_t)(divider + 0.5f);
+    if (rounded < 1) rounded = 1;
+    if (rounded > 8191) rounded = 8191;
+    float error = ((float)rounded - divider) / divider;
+    if (error < 0.0f) error = -error;
+    if (error <= bestError) {
+      bestError = error;
+      bestDivider = rounded;
+      bestOversampling = oversampling;
+    }
+  }
+
+  const uint32_t dividerBits = LPUART_BAUD_OSR(31) | LPUART_BAUD_SBR(8191) | LPUART_BAUD_BOTHEDGE;
+  uint32_t ctrl = lpuart->CTRL;
+  lpuart->CTRL = ctrl & ~(LPUART_CTRL_RE | LPUART_CTRL_TE);
+  while (lpuart->CTRL & (LPUART_CTRL_RE | LPUART_CTRL_TE)) {
+  }
+  lpuart->BAUD = (lpuart->BAUD & ~dividerBits) | LPUART_BAUD_OSR(bestOversampling - 1) |
+                 LPUART_BAUD_SBR(bestDivider) | (bestOversampling <= 8 ? LPUART_BAUD_BOTHEDGE : 0);
+  lpuart->CTRL = ctrl;
+}
+
+/**
+ * Drain one LPUART's receive FIFO into a capture channel
+ *
+ * Body of a capture port's interrupt handler: stamps every character with
+ * the cycle counter on entry (back-dated for characters queued behind it)
+ * and records FIFO overruns and framing/parity errors, and its own
+ * duration (STAGE_RECEIVE).
+ */
+template <typename Channel>
+inline void lpuartReceive(IMXRT_LPUART_t* lpuart, Channel& channel) {
+  uint32_t now = ARM_DWT_CYCCNT;
+
+  if (lpuart->STAT & LPUART_STAT_OR) {
+    // Hardware FIFO overrun: characters were lost before these
+    lpuart->STAT = LPUART_STAT_OR;
+    channel.overflowPending = true;
+    channel.uart.overruns++;
+  }
+
+  uint32_t count = (lpuart->WATER >> 24) & 0x7;
+  uint8_t dataMask = lpuartDataMask(lpuart);
+  while (count > 0) {
+    uint32_t data = lpuart->DATA;
+    count--;
+
+    uint8_t status = STATUS_OK;
+    if (data & LPUART_DATA_FRETSC) status |= STATUS_FRAMING_ERROR;
+    if (data & LPUART_DATA_PARITYE) status |= STATUS_PARITY_ERROR;
+    channel.receive(now, count, (uint8_t)data & dataMask, status);
+  }
+
+  if (lpuart->STAT & LPUART_STAT_IDLE) {
+    lpuart->STAT = LPUART_STAT_IDLE;
+  }
+#if CAPTURE_METRICS
+  channel.uart.interrupts.record(ARM_DWT_CYCCNT - now);
+#endif
+}
+
+/**
+ * Monitored HardwareSerial port
+ * While capturing, the port's interrupt vector is replaced by isr (which
+ * calls lpuartReceive() for its channel) and the RX watermark is one
+ * character, so every byte is stamped as it leaves the FIFO.
+ */
+struct TeensySerialPort {
+  HardwareSerial* serial;
+  IMXRT_LPUART_t* lpuart;
+  IRQ_NUMBER_t irq;
+  void (*isr)();
+  uint8_t channelId;
+
+  void begin(uint32_t baud, const LineFormat& format = LineFormat()) const {
+    serial->begin(baud, teensySerialFormat(format));
+    lpuart->WATER &= ~LPUART_WATER_RXWATER(3);
+    attachInterruptVector(irq, isr);
+  }
+
+  void end() const { serial->end(); }
+
+  /**
+   * Switch to another rate while receiving, without begin() (which would
+   * put the core's handler back for a moment): the port interrupt is
+   * masked while the FIFO is drained at the old character time, then
+   * byteCycles and the divider change together
+   */
+  void changeBaud(uint32_t baud, uint32_t& byteCycles, uint32_t characterCycles) const {
+    NVIC_DISABLE_IRQ(irq);
+    isr();
+    byteCycles = characterCycles;
+    lpuartSetBaud(lpuart, baud);
+    NVIC_ENABLE_IRQ(irq);
+  }
+
+  uint32_t poll() const { return 0; }     // Every character arrives through isr
+};
+
+/**
+ * Monitored HardwareSerial port received by eDMA
+ *
+ * While capturing, the LPUART raises a DMA request per character instead
+ * of an interrupt, and the DMA channel copies each 16-bit read of the
+ * data register (the byte and its error flags) into ring, wrapping at its
+ * end. poll() (the capture task) moves what the engine wrote into the
+ * channel. The port's interrupt vector is replaced by isr (which calls
+ * idleInterrupt(): idle line and FIFO overruns), the DMA channel's by
+ * lapIsr (which calls lapInterrupt()).
+ *
+ * ring must be in RAM1: the DMA engine writes it behind the data cache,
+ * which DMAMEM would need invalidated before every read.
+ *
+ * @tparam Channel CaptureChannel<N, M>
+ * @tparam Ring DmaRxRing<N>
+ */
+template <typename Channel, typename Ring>
+struct TeensyDmaSerialPort {
+  static_assert(Ring::SIZE <= 16384, "A DMA major loop counts at most 32767 transfers");
+
+  static const uint32_t IDLE_CHARACTERS = 1;   // IDLECFG 0, counted from the stop bit
+
+  HardwareSerial* serial;
+  IMXRT_LPUART_t* lpuart;
+  IRQ_NUMBER_t irq;
+  void (*isr)();
+  void (*lapIsr)();
+  uint8_t dmaSource;                            // DMAMUX_SOURCE_LPUARTn_RX
+  uint8_t channelId;
+  Channel* channel;
+  Ring* ring;
+  DMAChannel* dma;
+
+  void begin(uint32_t baud, const LineFormat& format = LineFormat()) const {
+    serial->begin(baud, teensySerialFormat(format));
+    ring->reset();
+    dma->disable();
+    dma->source(*(volatile const uint16_t*)&lpuart->DATA);
+    dma->destinationBuffer(ring->buffer(), Ring::SIZE * sizeof(uint16_t));
+    dma->triggerAtHardwareEvent(dmaSource);
+    dma->interruptAtCompletion();
+    dma->attachInterrupt(lapIsr);
+    dma->enable();
+
+    attachInterruptVector(irq, isr);
+    lpuart->WATER &= ~LPUART_WATER_RXWATER(3);
+    lpuart->CTRL = (lpuart->CTRL & ~(LPUART_CTRL_RIE | LPUART_CTRL_IDLECFG(7))) | LPUART_CTRL_ILT |
+                   LPUART_CTRL_ILIE | LPUART_CTRL_ORIE;
+    lpuart->BAUD |= LPUART_BAUD_RDMAE;
+  }
+
+  /**
+   * Stop the requests, then move what was written before they stopped
+   */
+  void end() const {
+    lpuart->BAUD &= ~LPUART_BAUD_RDMAE;
+    dma->disable();
+    poll();
+    serial->end();
+  }
+
+  /**
+   * Switch to another rate while receiving, without begin() (whose ring
+   * reset would drop what the engine has not moved yet): poll() empties
+   * the ring at the old character time, then, with the port interrupt
+   * masked, the few words written since are moved and byteCycles and the
+   * divider change together
+   */
+  void changeBaud(uint32_t baud, uint32_t& byteCycles, uint32_t characterCycles) const {
+    poll();
+    NVIC_DISABLE_IRQ(irq);
+    poll();
+    byteCycles = characterCycles;
+    lpuartSetBaud(lpuart, baud);
+    NVIC_ENABLE_IRQ(irq);
+  }
+
+  /**
+   * Move everything the DMA engine wrote into the channel (capture task),
+   * timing it as STAGE_RECEIVE
+   * @return Characters moved
+   */
+  uint32_t poll() const {
+    const DmaWordFormat format = {(uint16_t)LPUART_DATA_FRETSC, (uint16_t)LPUART_DATA_PARITYE,
+                                  lpuartDataMask(lpuart)};
+#if CAPTURE_METRICS
+    uint32_t start = ARM_DWT_CYCCNT;
+#endif
+    uint32_t moved = drainDmaRing<TeensyClock>(*ring, *channel, format, IDLE_CHARACTERS,
+                                               [this]() { return position(); });
+#if CAPTURE_METRICS
+    if (moved > 0) channel->uart.interrupts.record(ARM_DWT_CYCCNT - start);
+#endif
+    return moved;
+  }
+
+  /**
+   * Words the DMA engine has written into the current lap
+   */
+  uint32_t position() const {
+    const volatile uint16_t* next = (const volatile uint16_t*)dma->TCD->DADDR;
+    return (uint32_t)(next - ring->buffer()) & (Ring::SIZE - 1);
+  }
+
+  /**
+   * Body of isr: the line went idle, or the FIFO overran
+   */
+  void idleInterrupt() const {
+    uint32_t now = ARM_DWT_CYCCNT;
+    uint32_t status = lpuart->STAT;
+    if (status & LPUART_STAT_OR) {
+      lpuart->STAT = LPUART_STAT_OR;
+      ring->markOverrun();
+      channel->uart.overruns++;
+    }
+    if (status & LPUART_STAT_IDLE) {
+      lpuart->STAT = LPUART_STAT_IDLE;
+      ring->markIdle(position(), now);
+    }
+  }
+
+  /**
+   * Body of lapIsr: the DMA channel wrapped to the start of ring
+   */
+  void lapInterrupt() const {
+    dma->clearInterrupt();
+    ring->lapCompleted();
+  }
+};
+
+// ==================== Edge Input ====================
+
+/**
+ * Pin-change interrupt on a digital input
+ */
+class TeensyEdgeInput {
+ public:
+  void begin(uint8_t pin, HalEdgeFn onEdge) {
+    pin_ = pin;
+    pinMode(pin, INPUT_PULLUP);          // Idle-high line; an unwired pin stays quiet
+    attachInterrupt(digitalPinToInterrupt(pin), onEdge, CHANGE);
+  }
+
+  void end() { detachInterrupt(digitalPinToInterrupt(pin_)); }
+
+ private:
+  uint8_t pin_ = 0;
+};
+
+// ==================== Stream Port ====================
+
+/**
+ * USB serial port carrying the live stream (e.g. SerialUSB1 of a
+ * dual-serial build, so commands and messages keep Serial to themselves)
+ */
+class TeensyStreamPort {
+ public:
+  void begin(Print* port) { port_ = port; }
+
+  int availableForWrite() { return port_ ? port_->availableForWrite() : 0; }
+  size_t write(const uint8_t* data, size_t length) { return port_->write(data, length); }
+
+ private:
+  Print* port_ = nullptr;
+};
+
+// ==================== Bundle ====================
+
+struct TeensyHal {
+  typedef TeensyClock Clock;
+  typedef TeensyStorage Storage;
+  typedef TeensyFile File;
+  typedef TeensySerialPort SerialPort;
+  typedef TeensyEdgeInput EdgeInput;
+  typedef TeensyStreamPort StreamPort;
+};
+
+#endif // HALTEENSY_H
@@ -0,0 +1,253 @@
+/*
+ * SerialSniffer - Live Record Stream
+ *
+ * Sends the records being logged to the host over a USB serial port while
+ * the capture runs, alongside SD logging. Records are encoded once,
+ * straight into a batch buffer, in the delta format of the capture file.
+ * Full batches (or partial ones whose oldest record is older than the
+ * flush interval) are queued and written to the port as whole batches
+ * when it has room for them, so the capture path never waits on USB.
+ *
+ * Every batch starts with a LiveBatchHeader:
+ *   - a sequence number (consecutive from the START batch);
+ *   - the ticks its first record's delta counts from, and the ticks of
+ *     its last record;
+ *   - CRC-16/CCITT-FALSE checksums over the header and the payload.
+ * A batch is therefore decodable on its own: after a dropped or corrupted
+ * batch, the receiver resyncs on the next magic and sees the gap in the
+ * sequence numbers. When the queue is full, a completed batch is dropped
+ * and its sequence number is still used up; the END batch is always
+ * queued, and the queue keeps draining after it.
+ *
+ * Stream: START (payload: the CaptureFileHeader), RECORDS..., END.
+ *
+ * Free of Arduino dependencies so it can be tested on the host.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef LIVESTREAM_H
+#define LIVESTREAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CaptureFormat.h"
+#include "ChecksumEngine.h"
+
+// ==================== Format ====================
+
+const uint32_t LIVE_MAGIC = 0x564C5353;         // "SSLV" as sent
+
+enum LiveBatchType : uint8_t {
+  LIVE_BATCH_RECORDS = 0,         // Delta records
+  LIVE_BATCH_START = 1,           // Capture started; payload = CaptureFileHeader
+  LIVE_BATCH_END = 2              // Capture stopped; no payload
+};
+
+/**
+ * Precedes every batch on the link
+ */
+struct __attribute__((packed)) LiveBatchHeader {
+  uint32_t magic;                 // LIVE_MAGIC
+  uint32_t sequence;              // 0 for START, then +1 per batch (dropped ones included)
+  uint64_t baseTicks;             // First record's delta counts from here
+  uint64_t endTicks;              // Last record's ticks (baseTicks if none)
+  uint32_t timestampHz;           // Tick rate
+  uint16_t payloadBytes;
+  uint16_t recordCount;
+  uint8_t  type;                  // LiveBatchType
+  uint8_t  reserved[3];
+  uint16_t payloadCrc;            // CRC-16/CCITT-FALSE of the payload
+  uint16_t headerCrc;             // CRC-16/CCITT-FALSE of the header bytes before it
+};
+
+static_assert(sizeof(LiveBatchHeader) == 40, "LiveBatchHeader must be 40 bytes");
+
+/**
+ * Header CRC as sent (over every field before headerCrc)
+ */
+inline uint16_t liveHeaderCrc(const LiveBatchHeader& header) {
+  return crc16Ccitt((const uint8_t*)&header, sizeof(header) - sizeof(header.headerCrc));
+}
+
+/**
+ * Stream counters
+ */
+struct LiveStreamStats {
+  uint32_t batchesSent = 0;
+  uint32_t batchesDropped = 0;    // Queue full when they were completed
+  uint64_t recordsSent = 0;
+  uint64_t recordsDropped = 0;
+  uint64_t bytesSent = 0;
+  uint32_t queuePeak = 0;         // Most batches waiting at once
+
+  void reset() { *this = LiveStreamStats(); }
+};
+
+// ==================== Stream ====================
+
+/**
+ * Batching and queueing in front of a HAL StreamPort
+ *
+ * @tparam Port HAL StreamPort
+ * @tparam BatchBytes Batch size on the link, header included
+ * @tparam BatchCount Batches that can wait for the port
+ */
+template <typename Port, uint32_t BatchBytes, uint32_t BatchCount>
+class LiveStream {
+ public:
+  static const uint32_t PAYLOAD_BYTES = BatchBytes - sizeof(LiveBatchHeader);
+
+  static_assert(PAYLOAD_BYTES >= sizeof(CaptureFileHeader), "Batch too small for the START payload");
+  static_assert(PAYLOAD_BYTES <= UINT16_MAX, "Batch too large for payloadBytes");
+
+  /**
+   * Port for the next start() (the current stream must have ended)
+   * @param flushIntervalMs Longest a partial batch waits to be sent
+   */
+  void begin(Port* port, uint32_t flushIntervalMs) {
+    port_ = port;
+    flushIntervalMs_ = flushIntervalMs;
+  }
+
+  bool active() const { return active_; }
+
+  /**
+   * Begin a stream: queue the START batch (sequence 0)
+   * @param header Describes the records that follow, as a file header would
+   */
+  void start(const CaptureFileHeader& header, uint32_t nowMs) {
+    if (!port_) return;
+    head_ = count_ = 0;
+    current_ = nullptr;
+    sequence_ = 0;
+    lastTicks_ = 0;
+    timestampHz_ = header.timestampHz;
+    stats_.reset();
+    active_ = true;
+
+    Batch& batch = open(LIVE_BATCH_START, nowMs);
+    memcpy(batch.payload, &header, sizeof(header));
+    batch.header.payloadBytes = sizeof(header);
+    close();
+  }
+
+  /**
+   * Finish a stream: send what is queued, then END
+   */
+  void end(uint32_t nowMs) {
+    if (!active_) return;
+    if (current_) close();
+    open(LIVE_BATCH_END, nowMs);
+    close(true);
+    active_ = false;
+    send();
+  }
+
+  /**
+   * Add one record (any kind) in time order
+   * @param recordMs When the record's data arrived: a batch is due
+   *                 flushIntervalMs after its earliest record's time
+   */
+  void append(uint64_t ticks, uint8_t kind, uint8_t channel, uint8_t value, uint8_t status,
+              uint64_t argument, uint32_t recordMs) {
+    if (!active_) return;
+    if (current_ && current_->header.payloadBytes + MAX_EVENT_RECORD_SIZE > PAYLOAD_BYTES) close();
+    if (!current_) open(LIVE_BATCH_RECORDS, recordMs);
+
+    Batch& batch = *current_;
+    if ((int32_t)(recordMs - batch.openedMs) < 0) batch.openedMs = recordMs;
+    uint64_t delta = ticks > lastTicks_ ? ticks - lastTicks_ : 0;
+    uint8_t* out = batch.payload + batch.header.payloadBytes;
+    uint32_t length = (kind == RECORD_KIND_DATA)
+                          ? encodeDeltaRecord(out, delta, kind, channel, value, status)
+                          : encodeEventRecord(out, delta, kind, channel, value, status, argument);
+    batch.header.payloadBytes += length;
+    batch.header.recordCount++;
+    lastTicks_ += delta;
+    batch.header.endTicks = lastTicks_;
+  }
+
+  /**
+   * Close a partial batch that is due and write queued batches while the
+   * port has room (call every loop pass, also after end())
+   */
+  void service(uint32_t nowMs) {
+    if (!port_) return;
+    if (current_ && nowMs - current_->openedMs >= flushIntervalMs_) close();
+    send();
+  }
+
+  const LiveStreamStats& stats() const { return stats_; }
+  uint32_t queued() const { return count_; }
+
+ private:
+  static const uint32_t SLOTS = BatchCount + 1;    // Queue + the batch being filled
+
+  struct Batch {
+    LiveBatchHeader header;       // Directly followed by the payload, written in one call
+    uint8_t payload[PAYLOAD_BYTES];
+    uint32_t openedMs;
+  };
+
+  // Start filling the slot after the queue (free even when the queue is full)
+  Batch& open(uint8_t type, uint32_t nowMs) {
+    Batch& batch = batches_[(head_ + count_) % SLOTS];
+    memset(&batch.header, 0, sizeof(batch.header));
+    batch.header.magic = LIVE_MAGIC;
+    batch.header.type = type;
+    batch.header.baseTicks = lastTicks_;
+    batch.header.endTicks = lastTicks_;
+    batch.header.timestampHz = timestampHz_;
+    batch.openedMs = nowMs;
+    current_ = &batch;
+    return batch;
+  }
+
+  // Number and seal the current batch, then queue it (or drop it when the
+  // queue is full, unless forced into the spare slot)
+  void close(bool force = false) {
+    Batch& batch = *current_;
+    current_ = nullptr;
+    batch.header.sequence = sequence_++;
+    if (count_ >= BatchCount && !force) {
+      stats_.batchesDropped++;
+      stats_.recordsDropped += batch.header.recordCount;
+      return;
+    }
+    batch.header.payloadCrc = crc16Ccitt(batch.payload, batch.header.payloadBytes);
+    batch.header.headerCrc = liveHeaderCrc(batch.header);
+    count_++;
+    if (count_ > stats_.queuePeak) stats_.queuePeak = count_;
+  }
+
+  void send() {
+    while (port_ && count_ > 0) {
+      Batch& batch = batches_[head_];
+      uint32_t size = sizeof(LiveBatchHeader) + batch.header.payloadBytes;
+      if (port_->availableForWrite() < (int)size) return;
+      port_->write((const uint8_t*)&batch.header, size);
+      stats_.batchesSent++;
+      stats_.recordsSent += batch.header.recordCount;
+      stats_.bytesSent += size;
+      head_ = (head_ + 1) % SLOTS;
+      count_--;
+    }
+  }
+
+  Port* port_ = nullptr;
+  bool active_ = false;
+  uint32_t flushIntervalMs_ = 5;
+  Batch batches_[SLOTS];
+  Batch* current_ = nullptr;      // Being filled; not part of the queue yet
+  uint32_t head_ = 0;             // Oldest queued batch
+  uint32_t count_ = 0;
+  uint32_t sequence_ = 0;
+  uint64_t lastTicks_ = 0;        // Delta base of the next record
+  uint32_t timestampHz_ = 0;
+  LiveStreamStats stats_;
+};
+
+#endif // LIVESTREAM_H
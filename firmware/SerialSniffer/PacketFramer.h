@@ -0,0 +1,216 @@
+/*
+ * SerialSniffer - Idle-Gap Packet Framer
+ *
+ * Segments each channel's byte stream into packets as it is logged. A
+ * packet ends when its line stays idle for a configured number of
+ * character times, when a delimiter byte is received (the delimiter is
+ * the packet's last byte), or when it reaches a maximum length. The
+ * framer turns this into PACKET_START records (before a packet's first
+ * byte) and PACKET_END records (with the length and the reason), so host
+ * tools load packets directly instead of re-scanning the bytes.
+ *
+ * Bytes must be presented in global time order (the merged stream). An
+ * idle packet ends at its deadline, last byte + idle time, which can lie
+ * before bytes of other channels; the framer emits such ends before the
+ * first byte at or after the deadline, and expire() emits them once the
+ * caller knows no earlier byte is still to come. Records therefore stay
+ * in time order. Per-byte cost is O(1): the earliest open deadline is
+ * kept as a lower bound and channels are scanned only when it is reached,
+ * at most once per idle time.
+ *
+ * Free of Arduino dependencies so it can be tested on the host.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef PACKETFRAMER_H
+#define PACKETFRAMER_H
+
+#include <stdint.h>
+
+#include "CaptureFormat.h"
+
+/**
+ * Framing rules
+ */
+struct PacketFramerConfig {
+  float idleCharacters = 3.5f;      // Idle gap that ends a packet, in character times (0 = off)
+  uint32_t maxLength = 0;           // Longest packet in bytes (0 = unlimited)
+  uint32_t delimiters[8] = {0};     // Bitmap of bytes that end a packet
+
+  void addDelimiter(uint8_t value) { delimiters[value >> 5] |= 1u << (value & 31); }
+  bool isDelimiter(uint8_t value) const { return (delimiters[value >> 5] >> (value & 31)) & 1; }
+
+  bool hasDelimiters() const {
+    for (uint32_t word : delimiters) {
+      if (word) return true;
+    }
+    return false;
+  }
+};
+
+/**
+ * A PACKET_START or PACKET_END record for the log
+ */
+struct FramerRecord {
+  uint64_t ticks;
+  uint64_t argument;      // START: packet number on the channel; END: length in bytes
+  uint8_t kind;           // RECORD_KIND_PACKET_START / RECORD_KIND_PACKET_END
+  uint8_t channel;
+  uint8_t value;          // END: PacketEndReason
+};
+
+class PacketFramer {
+ public:
+  /**
+   * Apply framing rules (clears all state)
+   */
+  void begin(const PacketFramerConfig& config) {
+    config_ = config;
+    idleTicks_ = 0;
+    reset();
+  }
+
+  /**
+   * Set the character time the idle threshold is measured in
+   * (capture start and line rate changes)
+   * @param characterTicks Ticks per character at the line rate
+   */
+  void setCharacterTicks(uint64_t characterTicks) {
+    idleTicks_ = (uint64_t)(characterTicks * config_.idleCharacters + 0.5f);
+  }
+
+  /**
+   * Forget open packets and restart packet numbers (new session)
+   */
+  void reset() {
+    for (ChannelState& state : channels_) state = ChannelState();
+    nextDeadline_ = NO_DEADLINE;
+    latestTicks_ = 0;
+    openCount_ = 0;
+  }
+
+  /**
+   * Any rule configured
+   */
+  bool enabled() const {
+    return idleTicks_ > 0 || config_.maxLength > 0 || config_.hasDelimiters();
+  }
+
+  /**
+   * Before logging a byte: end packets whose idle deadline has passed and
+   * start one on the byte's channel if none is open
+   * @param sink Called as sink(const FramerRecord&)
+   */
+  template <typename Sink>
+  void beforeByte(uint8_t channel, uint64_t ticks, Sink&& sink) {
+    if (ticks >= nextDeadline_) expire(ticks, sink);
+    if (ticks > latestTicks_) latestTicks_ = ticks;
+
+    ChannelState& state = channels_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+    if (!state.open) {
+      state.open = true;
+      state.length = 0;
+      openCount_++;
+      sink(FramerRecord{ticks, state.packets, RECORD_KIND_PACKET_START, channel, 0});
+    }
+  }
+
+  /**
+   * After logging a byte: count it and end its packet on a delimiter or
+   * at the maximum length, else move the idle deadline
+   */
+  template <typename Sink>
+  void afterByte(uint8_t channel, uint8_t value, uint64_t ticks, Sink&& sink) {
+    ChannelState& state = channels_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+    state.length++;
+
+    if (config_.isDelimiter(value)) {
+      close(state, channel, ticks, PACKET_END_DELIMITER, sink);
+    } else if (config_.maxLength > 0 && state.length >= config_.maxLength) {
+      close(state, channel, ticks, PACKET_END_MAX_LENGTH, sink);
+    } else if (idleTicks_ > 0) {
+      // Later than before, so nextDeadline_ stays a valid lower bound
+      state.deadline = ticks + idleTicks_;
+      if (state.deadline < nextDeadline_) nextDeadline_ = state.deadline;
+    }
+  }
+
+  /**
+   * End every packet whose idle deadline is at or before a time
+   * Call when no byte stamped at or before ticks is still to be presented.
+   */
+  template <typename Sink>
+  void expire(uint64_t ticks, Sink&& sink) {
+    if (ticks > latestTicks_) latestTicks_ = ticks;
+    if (ticks < nextDeadline_) return;
+
+    // Earliest first, so the END records stay in time order
+    for (;;) {
+      uint32_t earliest = MAX_CAPTURE_CHANNELS;
+      uint64_t deadline = NO_DEADLINE;
+      for (uint32_t i = 0; i < MAX_CAPTURE_CHANNELS; i++) {
+        if (channels_[i].open && channels_[i].deadline < deadline) {
+          deadline = channels_[i].deadline;
+          earliest = i;
+        }
+      }
+      if (earliest == MAX_CAPTURE_CHANNELS || deadline > ticks) {
+        nextDeadline_ = deadline;
+        return;
+      }
+      close(channels_[earliest], (uint8_t)earliest, deadline, PACKET_END_IDLE, sink);
+    }
+  }
+
+  /**
+   * End all open packets at the latest time seen (capture stop or the end
+   * of a session)
+   */
+  template <typename Sink>
+  void finish(Sink&& sink) {
+    expire(latestTicks_, sink);
+    for (uint32_t i = 0; i < MAX_CAPTURE_CHANNELS; i++) {
+      if (channels_[i].open) close(channels_[i], (uint8_t)i, latestTicks_, PACKET_END_STOP, sink);
+    }
+  }
+
+  /**
+   * Packets ended on a channel since reset()
+   */
+  uint64_t packets(uint8_t channel) const {
+    return channels_[channel & (MAX_CAPTURE_CHANNELS - 1)].packets;
+  }
+
+  uint32_t openPackets() const { return openCount_; }
+  uint64_t idleTicks() const { return idleTicks_; }
+
+ private:
+  static const uint64_t NO_DEADLINE = UINT64_MAX;
+
+  struct ChannelState {
+    uint64_t deadline = NO_DEADLINE;    // Idle end of the open packet
+    uint64_t packets = 0;               // Ended so far (next packet's number)
+    uint32_t length = 0;
+    bool open = false;
+  };
+
+  template <typename Sink>
+  void close(ChannelState& state, uint8_t channel, uint64_t ticks, uint8_t reason, Sink&& sink) {
+    sink(FramerRecord{ticks, state.length, RECORD_KIND_PACKET_END, channel, reason});
+    state.open = false;
+    state.deadline = NO_DEADLINE;
+    state.packets++;
+    openCount_--;
+  }
+
+  PacketFramerConfig config_;
+  uint64_t idleTicks_ = 0;
+  ChannelState channels_[MAX_CAPTURE_CHANNELS];
+  uint64_t nextDeadline_ = NO_DEADLINE;   // <= every open packet's deadline
+  uint64_t latestTicks_ = 0;
+  uint32_t openCount_ = 0;
+};
+
+#endif // PACKETFRAMER_H
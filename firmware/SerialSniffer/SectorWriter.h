@@ -0,0 +1,260 @@
+/*
+ * SerialSniffer - Sector-Aligned SD Writer
+ *
+ * Collects the log stream into 512-byte blocks and hands the card whole,
+ * sector-aligned writes, one per service() call, so capture never waits
+ * behind more than one sector. File metadata (directory entry, FAT) is
+ * synced on its own cadence instead of after every few hundred bytes.
+ *
+ * An idle sync pushes out the partly filled block from its sector start;
+ * the file position then goes back there, and the block is written again
+ * whole once it fills, so no write ever starts inside a sector. Under
+ * sustained load a sync is forced once it is overdue.
+ *
+ * Templated over the output device so the buffering and flush policy can
+ * run on the host against a mock device.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef SECTORWRITER_H
+#define SECTORWRITER_H
+
+#include <stdint.h>
+#include <string.h>
+
+const uint32_t SECTOR_SIZE = 512;
+const uint32_t SLOW_WRITE_US = 10000;     // Writes slower than this count as stalls
+
+/**
+ * Writer statistics (latencies in microseconds)
+ */
+struct SectorWriterStats {
+  uint32_t sectorsWritten = 0;    // Full, aligned sector writes
+  uint32_t partialWrites = 0;     // Alignment, idle-sync and final writes
+  uint32_t rewrites = 0;          // Writes of a block already partly on the card
+  uint32_t syncs = 0;
+  uint32_t writeErrors = 0;
+  uint32_t slowWrites = 0;        // Writes taking >= SLOW_WRITE_US
+  uint32_t lastWriteUs = 0;
+  uint32_t maxWriteUs = 0;        // Write latency high-water mark
+  uint32_t lastSyncUs = 0;
+  uint32_t maxSyncUs = 0;         // Sync latency high-water mark
+  uint32_t peakBlocksQueued = 0;  // Full blocks waiting at once
+};
+
+/**
+ * Multi-buffered block writer
+ *
+ * @tparam Device Provides size_t write(const uint8_t*, size_t), flush(),
+ *                uint64_t position() and bool seek(uint64_t)
+ * @tparam BlockCount Number of 512-byte blocks (at least 2)
+ */
+template <typename Device, uint32_t BlockCount = 2>
+class SectorWriter {
+  static_assert(BlockCount >= 2, "SectorWriter needs at least two blocks");
+
+ public:
+  typedef uint32_t (*MicrosFn)();
+
+  SectorWriter() { reset(0); }
+
+  /**
+   * Attach to an open device
+   * @param device Output device, positioned at fileOffset
+   * @param fileOffset Current file size; the first block is shortened so
+   *                   every later write starts on a sector boundary
+   * @param microsFn Microsecond clock used for latency tracking
+   * @param syncIntervalMs Minimum time between metadata syncs; a sync
+   *                       waits for an idle service() call for at most
+   *                       twice this
+   */
+  void begin(Device* device, uint64_t fileOffset, MicrosFn microsFn, uint32_t syncIntervalMs) {
+    device_ = device;
+    micros_ = microsFn;
+    syncIntervalMs_ = syncIntervalMs;
+    stats_ = SectorWriterStats();
+    reset((uint32_t)(fileOffset % SECTOR_SIZE));
+  }
+
+  /**
+   * Detach from the device (call flush() first to keep buffered data)
+   */
+  void end() {
+    device_ = nullptr;
+    reset(0);
+  }
+
+  bool isOpen() const { return device_ != nullptr; }
+
+  /**
+   * Bytes that append() can accept without waiting for a write
+   */
+  uint32_t freeSpace() const {
+    if (queued_ == BlockCount) return 0;
+    const Block& fill = blocks_[fillIndex()];
+    return (fill.capacity - fill.used) + (BlockCount - queued_ - 1) * SECTOR_SIZE;
+  }
+
+  /**
+   * Copy data into the block buffers
+   * @return Bytes accepted (less than length only when every block is full)
+   */
+  uint32_t append(const void* data, uint32_t length) {
+    const uint8_t* src = (const uint8_t*)data;
+    uint32_t accepted = 0;
+
+    while (accepted < length && queued_ < BlockCount) {
+      Block& fill = blocks_[fillIndex()];
+      uint32_t room = fill.capacity - fill.used;
+      uint32_t chunk = (length - accepted) < room ? (length - accepted) : room;
+      memcpy(fill.data + fill.used, src + accepted, chunk);
+      fill.used += chunk;
+      accepted += chunk;
+
+      if (fill.used == fill.capacity) {
+        queued_++;
+        if (queued_ > stats_.peakBlocksQueued) stats_.peakBlocksQueued = queued_;
+      }
+    }
+    return accepted;
+  }
+
+  /**
+   * Do at most one unit of device work
+   * Writes the oldest full block if there is one; otherwise syncs metadata
+   * (first pushing out a partly filled block) once syncIntervalMs has passed.
+   * A sync overdue by another syncIntervalMs goes ahead of the full blocks
+   * (without the partly filled one).
+   * @param nowMs Current time in milliseconds
+   * @return true if the device was touched
+   */
+  bool service(uint32_t nowMs) {
+    if (!device_) return false;
+
+    uint32_t sinceSync = nowMs - lastSyncMs_;
+    if (queued_ > 0 && dirty_ && sinceSync >= 2 * syncIntervalMs_) {
+      sync();
+      lastSyncMs_ = nowMs;
+      return true;
+    }
+
+    if (queued_ > 0) {
+      Block& block = blocks_[writeIndex_];
+      writeBlock(block);
+      block.used = block.flushed = 0;
+      block.capacity = SECTOR_SIZE;
+      writeIndex_ = (writeIndex_ + 1) % BlockCount;
+      queued_--;
+      return true;
+    }
+
+    if (sinceSync >= syncIntervalMs_) {
+      Block& fill = blocks_[fillIndex()];
+      bool pending = fill.used > fill.flushed;
+      if (pending) writeBlock(fill);
+      if (pending || dirty_) {
+        sync();
+        lastSyncMs_ = nowMs;
+        return true;
+      }
+      lastSyncMs_ = nowMs;
+    }
+    return false;
+  }
+
+  /**
+   * Write everything buffered, including a partly filled block, and sync
+   */
+  void flush() {
+    if (!device_) return;
+    while (queued_ > 0) service(lastSyncMs_);
+    Block& fill = blocks_[fillIndex()];
+    if (fill.used > fill.flushed) writeBlock(fill);
+    sync();
+  }
+
+  /**
+   * Bytes accepted but not yet handed to the device
+   */
+  uint32_t pendingBytes() const {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < BlockCount; i++) total += blocks_[i].used - blocks_[i].flushed;
+    return total;
+  }
+
+  uint32_t blocksQueued() const { return queued_; }
+  const SectorWriterStats& stats() const { return stats_; }
+
+ private:
+  struct Block {
+    alignas(32) uint8_t data[SECTOR_SIZE];
+    uint16_t used;        // Bytes filled
+    uint16_t flushed;     // Bytes already written to the device
+    uint16_t capacity;    // SECTOR_SIZE, or less for the alignment block
+  };
+
+  uint32_t fillIndex() const { return (writeIndex_ + queued_) % BlockCount; }
+
+  void reset(uint32_t misalignment) {
+    for (uint32_t i = 0; i < BlockCount; i++) {
+      blocks_[i].used = blocks_[i].flushed = 0;
+      blocks_[i].capacity = SECTOR_SIZE;
+    }
+    blocks_[0].capacity = SECTOR_SIZE - misalignment;
+    writeIndex_ = 0;
+    queued_ = 0;
+    dirty_ = false;
+    lastSyncMs_ = 0;
+  }
+
+  // Write the block from its start; a block partly written by an idle
+  // sync is written again, so the write starts where the block does
+  void writeBlock(Block& block) {
+    uint32_t length = block.used;
+    bool whole = (length == SECTOR_SIZE);
+
+    uint32_t start = micros_ ? micros_() : 0;
+    bool placed = true;
+    if (block.flushed > 0) {
+      placed = device_->seek(device_->position() - block.flushed);
+      stats_.rewrites++;
+    }
+    size_t written = placed ? device_->write(block.data, length) : 0;
+    uint32_t elapsed = micros_ ? micros_() - start : 0;
+
+    if (written != length) stats_.writeErrors++;
+    if (whole) stats_.sectorsWritten++;
+    else stats_.partialWrites++;
+    stats_.lastWriteUs = elapsed;
+    if (elapsed > stats_.maxWriteUs) stats_.maxWriteUs = elapsed;
+    if (elapsed >= SLOW_WRITE_US) stats_.slowWrites++;
+
+    block.flushed = block.used;
+    dirty_ = true;
+  }
+
+  void sync() {
+    uint32_t start = micros_ ? micros_() : 0;
+    device_->flush();
+    uint32_t elapsed = micros_ ? micros_() - start : 0;
+
+    stats_.syncs++;
+    stats_.lastSyncUs = elapsed;
+    if (elapsed > stats_.maxSyncUs) stats_.maxSyncUs = elapsed;
+    dirty_ = false;
+  }
+
+  Block blocks_[BlockCount];
+  Device* device_ = nullptr;
+  MicrosFn micros_ = nullptr;
+  uint32_t syncIntervalMs_ = 1000;
+  uint32_t writeIndex_;           // Oldest full block
+  uint32_t queued_;               // Full blocks waiting to be written
+  bool dirty_;                    // Data written since the last sync
+  uint32_t lastSyncMs_;
+  SectorWriterStats stats_;
+};
+
+#endif // SECTORWRITER_H
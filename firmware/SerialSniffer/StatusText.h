@@ -0,0 +1,68 @@
+/*
+ * SerialSniffer - Status Text Buffer
+ *
+ * 'i' and 'j' print their reports into a StatusText at memory speed; the
+ * status task then sends the text to the USB serial port as fast as the
+ * port's buffer takes it, so a long report never blocks the main loop
+ * the way printing it straight to a slow or busy host would. Text that
+ * does not fit is cut off and counted. Firmware only.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef STATUSTEXT_H
+#define STATUSTEXT_H
+
+#include <Arduino.h>
+
+class StatusText : public Print {
+ public:
+  /**
+   * @param buffer Text storage (e.g. DMAMEM)
+   * @param size Bytes in buffer
+   */
+  StatusText(char* buffer, uint32_t size) : buffer_(buffer), size_(size) {}
+
+  using Print::write;
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  size_t write(const uint8_t* data, size_t length) override {
+    if (sent_ == used_) sent_ = used_ = 0;
+    size_t room = size_ - used_;
+    if (length > room) {
+      truncatedBytes_ += length - room;
+      length = room;
+    }
+    memcpy(buffer_ + used_, data, length);
+    used_ += length;
+    return length;
+  }
+
+  /**
+   * Send as much as the port takes without blocking
+   * @return true if any text went out
+   */
+  bool send(Stream& port) {
+    int room = port.availableForWrite();
+    uint32_t pending = used_ - sent_;
+    if (room <= 0 || pending == 0) return false;
+    uint32_t count = pending < (uint32_t)room ? pending : (uint32_t)room;
+    port.write((const uint8_t*)buffer_ + sent_, count);
+    sent_ += count;
+    return true;
+  }
+
+  bool pending() const { return sent_ < used_; }
+  uint32_t truncatedBytes() const { return truncatedBytes_; }
+
+ private:
+  char* buffer_;
+  uint32_t size_;
+  uint32_t used_ = 0;
+  uint32_t sent_ = 0;
+  uint32_t truncatedBytes_ = 0;
+};
+
+#endif // STATUSTEXT_H
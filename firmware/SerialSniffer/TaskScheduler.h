@@ -0,0 +1,196 @@
+/*
+ * SerialSniffer - Cooperative Task Scheduler
+ *
+ * The main loop's work (capture drain, SD writer, live stream, commands,
+ * status output, LED) as prioritized tasks. A pass runs every due task in
+ * priority order, and runs the first task again before each of the
+ * others, so the capture drain never waits behind more than one other
+ * task. A task reports whether it got work done (a task waiting on a
+ * full port did not); the loop sleeps only after a pass in which none
+ * did, and no longer than until the next periodic task is due.
+ *
+ * Every task has a time budget and a deadline. A run longer than the
+ * budget counts as an overrun; a periodic task started more than its
+ * deadline after it was due, or an every-pass task started more than its
+ * deadline after its last run ended (the loop's sleep not counted),
+ * counts as a missed deadline. Run time is measured with the cycle
+ * counter.
+ *
+ * Templated over the HAL clock so the host simulator runs the same
+ * scheduler in simulated time. Free of Arduino dependencies.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * Task body
+ * @return true if it got work done (and may have more)
+ */
+typedef bool (*SchedulerTaskFn)();
+
+/**
+ * One task (added in priority order, highest first)
+ */
+struct SchedulerTask {
+  const char* name;
+  SchedulerTaskFn run;
+  uint32_t periodUs;              // Run at most this often, 0 = every pass
+  uint32_t budgetUs;              // A longer run is an overrun, 0 = none
+  uint32_t deadlineUs;            // Longest wait (see above), 0 = none
+};
+
+/**
+ * Run time and deadline accounting of one task (cycle counter ticks)
+ */
+struct SchedulerTaskStats {
+  uint32_t runs = 0;
+  uint32_t busyRuns = 0;          // Runs that got work done
+  uint64_t totalTicks = 0;        // Time spent in the task
+  uint32_t maxTicks = 0;          // Longest run
+  uint32_t overruns = 0;          // Runs over budget
+  uint32_t deadlineMisses = 0;
+  uint32_t maxWaitTicks = 0;      // Longest wait counted against the deadline
+};
+
+/**
+ * Fixed-size cooperative scheduler
+ *
+ * @tparam Clock HAL clock (cycles(), cycleHz())
+ * @tparam MaxTasks Tasks that can be added
+ */
+template <typename Clock, uint32_t MaxTasks>
+class TaskScheduler {
+ public:
+  /**
+   * Add the next task, in priority order (setup only)
+   * @return false if MaxTasks are already added
+   */
+  bool add(const SchedulerTask& task) {
+    if (count_ == MaxTasks) return false;
+    Entry& entry = tasks_[count_++];
+    entry.task = task;
+    entry.periodTicks = microsToTicks(task.periodUs);
+    entry.budgetTicks = microsToTicks(task.budgetUs);
+    entry.deadlineTicks = microsToTicks(task.deadlineUs);
+    entry.dueTicks = Clock::cycles();
+    entry.lastEndTicks = entry.dueTicks;
+    entry.stats = SchedulerTaskStats();
+    return true;
+  }
+
+  /**
+   * Run every due task once, highest priority first
+   * @return true if any task got work done (don't sleep)
+   */
+  bool runPass() {
+    if (!lastPassBusy_) {
+      // The loop may have slept: waits start now
+      uint32_t now = Clock::cycles();
+      for (uint32_t i = 0; i < count_; i++) tasks_[i].lastEndTicks = now;
+    }
+    bool busy = false;
+    for (uint32_t i = 0; i < count_; i++) {
+      const Entry& entry = tasks_[i];
+      if (entry.periodTicks > 0 && (int32_t)(Clock::cycles() - entry.dueTicks) < 0) continue;
+      if (i > 0) busy |= runTask(tasks_[0]);
+      busy |= runTask(tasks_[i]);
+    }
+    passes_++;
+    if (!busy) idlePasses_++;
+    lastPassBusy_ = busy;
+    return busy;
+  }
+
+  /**
+   * How long the loop may sleep after an idle pass
+   * @param maxUs Longest sleep (bounds the wait of every-pass tasks)
+   * @return Microseconds until the next periodic task is due, at most maxUs
+   */
+  uint32_t idleMicros(uint32_t maxUs) const {
+    uint32_t now = Clock::cycles();
+    uint32_t sleepTicks = microsToTicks(maxUs);
+    for (uint32_t i = 0; i < count_; i++) {
+      const Entry& entry = tasks_[i];
+      if (entry.periodTicks == 0) continue;
+      int32_t until = (int32_t)(entry.dueTicks - now);
+      if (until <= 0) return 0;
+      if ((uint32_t)until < sleepTicks) sleepTicks = (uint32_t)until;
+    }
+    return (uint32_t)((uint64_t)sleepTicks * 1000000 / Clock::cycleHz());
+  }
+
+  /**
+   * Clear every task's statistics
+   */
+  void resetStats() {
+    for (uint32_t i = 0; i < count_; i++) tasks_[i].stats = SchedulerTaskStats();
+    passes_ = 0;
+    idlePasses_ = 0;
+  }
+
+  uint32_t taskCount() const { return count_; }
+  const SchedulerTask& task(uint32_t index) const { return tasks_[index].task; }
+  const SchedulerTaskStats& stats(uint32_t index) const { return tasks_[index].stats; }
+  uint64_t passes() const { return passes_; }
+  uint64_t idlePasses() const { return idlePasses_; }
+
+ private:
+  struct Entry {
+    SchedulerTask task;
+    uint32_t periodTicks;
+    uint32_t budgetTicks;
+    uint32_t deadlineTicks;
+    uint32_t dueTicks;            // Periodic: next start
+    uint32_t lastEndTicks;        // End of the last run (or of the loop's sleep)
+    SchedulerTaskStats stats;
+  };
+
+  static uint32_t microsToTicks(uint32_t us) {
+    uint64_t ticks = (uint64_t)us * (Clock::cycleHz() / 1000000);
+    return ticks < UINT32_MAX ? (uint32_t)ticks : UINT32_MAX;
+  }
+
+  bool runTask(Entry& entry) {
+    uint32_t start = Clock::cycles();
+    SchedulerTaskStats& stats = entry.stats;
+
+    // Periodic: the wait past the due time; every pass: the wait since
+    // the last run
+    uint32_t wait;
+    if (entry.periodTicks > 0) {
+      wait = start - entry.dueTicks;
+      entry.dueTicks += entry.periodTicks;
+      if ((int32_t)(start - entry.dueTicks) >= 0) entry.dueTicks = start + entry.periodTicks;   // Fell behind
+    } else {
+      wait = start - entry.lastEndTicks;
+    }
+    if (wait > stats.maxWaitTicks) stats.maxWaitTicks = wait;
+    if (entry.deadlineTicks > 0 && wait > entry.deadlineTicks) stats.deadlineMisses++;
+
+    bool worked = entry.task.run();
+
+    uint32_t end = Clock::cycles();
+    uint32_t ticks = end - start;
+    stats.runs++;
+    if (worked) stats.busyRuns++;
+    stats.totalTicks += ticks;
+    if (ticks > stats.maxTicks) stats.maxTicks = ticks;
+    if (entry.budgetTicks > 0 && ticks > entry.budgetTicks) stats.overruns++;
+    entry.lastEndTicks = end;
+    return worked;
+  }
+
+  Entry tasks_[MaxTasks];
+  uint32_t count_ = 0;
+  uint64_t passes_ = 0;
+  uint64_t idlePasses_ = 0;
+  bool lastPassBusy_ = false;
+};
+
+#endif // TASKSCHEDULER_H
@@ -0,0 +1,325 @@
+/*
+ * analysis_bench - Parallel capture analysis correctness and scaling
+ *
+ * Synthesizes four channels of packet traffic at 1 Mbaud (random lengths
+ * up to 300 bytes plus a few longer than the length histogram, bytes 1-2.5
+ * character times apart, packets 4-200 character times apart, sprinkled
+ * errors and baud change events) and writes it three ways:
+ *
+ *   records.ssb   delta records with PACKET_START / PACKET_END around packets
+ *   idle.ssb      the same bytes without packet records (idle-gap framing)
+ *   idle.csv      idle.ssb as ss_convert would write it
+ *
+ * Each file is analyzed with CaptureAnalyzer as one range on one thread,
+ * which must match the generator's own counts exactly (bytes, errors,
+ * packet lengths, durations, gaps, packets per second). Then it is cut
+ * into 4 KB, 64 KB and 2 MB ranges on 1, 2, 4 and 8 threads: every result
+ * must equal the single-range one, so packets stitched across range
+ * boundaries come out the same as packets seen whole. Reports MB/s and the
+ * speedup over one thread (2 MB ranges).
+ *
+ * Usage: analysis_bench [data_bytes] [directory]
+ *        default: 16000000 bytes in /tmp/analysis_bench
+ * Exits non-zero if any result differs.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CaptureAnalysis.h"
+#include "CsvFormat.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CPU_HZ = 600000000;
+const uint32_t BAUD = 1000000;
+const uint64_t CHAR_TICKS = (uint64_t)CPU_HZ * 10 / BAUD;
+const uint64_t IDLE_TICKS = CHAR_TICKS * 7 / 2;          // Firmware PACKET_END: last byte + 3.5 characters
+const uint8_t CHANNELS = 4;
+const uint32_t MAX_PACKET_LENGTH = 300;
+const uint32_t LONG_PACKET_LENGTH = 5000;               // Beyond ANALYSIS_LENGTH_BINS
+const size_t CHUNK_SIZES[] = {4096, 65536, 2 * 1024 * 1024};
+const unsigned THREAD_COUNTS[] = {1, 2, 4, 8};
+const size_t TIMING_CHUNK_BYTES = 2 * 1024 * 1024;
+
+// ==================== Synthetic Source ====================
+
+struct Record {
+  uint64_t ticks;
+  uint8_t kind;
+  uint8_t channel;
+  uint8_t value;
+  uint8_t status;
+  uint64_t argument;
+};
+
+/**
+ * Records of one channel (with packet records) and the expected analysis
+ * for both framings
+ */
+static void generate(uint8_t channel, uint64_t dataBytes, uint32_t seed, std::vector<Record>& records,
+                     ChannelAnalysis& truthRecords, ChannelAnalysis& truthIdle) {
+  std::mt19937 rng(seed);
+  uint64_t t = rng() % (100 * CHAR_TICKS);
+  uint64_t sent = 0;
+  uint64_t number = 0;
+  bool havePrevious = false;
+  uint64_t previousLastNs = 0;
+  while (sent < dataBytes) {
+    uint32_t length = (rng() % 1000 == 0) ? LONG_PACKET_LENGTH : 1 + rng() % MAX_PACKET_LENGTH;
+    uint64_t firstNs = ticksToNs(t, CPU_HZ);
+    if (havePrevious) {
+      truthRecords.addGap(firstNs - previousLastNs);
+      truthIdle.addGap(firstNs - previousLastNs);
+    }
+    records.push_back({t, RECORD_KIND_PACKET_START, channel, 0, STATUS_OK, number++});
+    if (rng() % 5000 == 0) {
+      records.push_back({t, RECORD_KIND_BAUD_CHANGE, channel, 0, STATUS_OK, BAUD});
+    }
+    for (uint32_t i = 0; i < length; i++) {
+      if (i > 0) t += CHAR_TICKS + rng() % (CHAR_TICKS * 3 / 2);
+      uint8_t value = (uint8_t)rng();
+      uint8_t status = STATUS_OK;
+      uint32_t roll = rng() % 20000;
+      if (roll == 0) status = STATUS_FRAMING_ERROR;
+      else if (roll == 1) status = STATUS_PARITY_ERROR;
+      else if (roll == 2) status = STATUS_OVERFLOW;
+      records.push_back({t, RECORD_KIND_DATA, channel, value, status, 0});
+      for (ChannelAnalysis* truth : {&truthRecords, &truthIdle}) {
+        truth->bytes++;
+        truth->valueSum += value;
+        if (status == STATUS_FRAMING_ERROR) truth->framingErrors++;
+        if (status == STATUS_PARITY_ERROR) truth->parityErrors++;
+        if (status == STATUS_OVERFLOW) truth->overflow++;
+      }
+    }
+    uint64_t lastNs = ticksToNs(t, CPU_HZ);
+    uint8_t verdict = (rng() % 10 == 0) ? STATUS_CHECKSUM_ERROR : STATUS_CHECKSUM_VALID;
+    records.push_back({t + IDLE_TICKS, RECORD_KIND_PACKET_END, channel, PACKET_END_IDLE, verdict, length});
+
+    truthRecords.addPacket(length, ticksToNs(t + IDLE_TICKS, CPU_HZ), ANALYSIS_RATE_BIN_NS);
+    truthRecords.addDuration(lastNs - firstNs);
+    truthRecords.endReasons[PACKET_END_IDLE]++;
+    if (verdict == STATUS_CHECKSUM_VALID) truthRecords.checksumValid++;
+    else truthRecords.checksumError++;
+    truthIdle.addPacket(length, lastNs, ANALYSIS_RATE_BIN_NS);
+    truthIdle.addDuration(lastNs - firstNs);
+
+    previousLastNs = lastNs;
+    havePrevious = true;
+    sent += length;
+    t += CHAR_TICKS * (4 + rng() % 197);
+  }
+}
+
+static bool writeSsb(const std::string& path, const std::vector<Record>& records, bool packetRecords) {
+  std::FILE* out = std::fopen(path.c_str(), "wb");
+  if (!out) return false;
+  CaptureFileHeader header;
+  initCaptureHeader(header, BAUD, 0, "analysis_bench", CPU_HZ);
+  std::fwrite(&header, sizeof(header), 1, out);
+  std::vector<uint8_t> buffer(1 << 20);
+  size_t used = 0;
+  uint64_t previous = 0;
+  for (const Record& r : records) {
+    if (!packetRecords && (r.kind == RECORD_KIND_PACKET_START || r.kind == RECORD_KIND_PACKET_END)) continue;
+    if (buffer.size() - used < MAX_EVENT_RECORD_SIZE) {
+      std::fwrite(buffer.data(), 1, used, out);
+      used = 0;
+    }
+    uint64_t delta = r.ticks - previous;
+    previous = r.ticks;
+    used += (r.kind == RECORD_KIND_DATA)
+                ? encodeDeltaRecord(&buffer[used], delta, r.kind, r.channel, r.value, r.status)
+                : encodeEventRecord(&buffer[used], delta, r.kind, r.channel, r.value, r.status, r.argument);
+  }
+  std::fwrite(buffer.data(), 1, used, out);
+  return std::fclose(out) == 0;
+}
+
+static bool writeCsv(const std::string& path, const std::vector<Record>& records) {
+  std::FILE* out = std::fopen(path.c_str(), "w");
+  if (!out) return false;
+  std::fprintf(out, "%s\n", CSV_HEADER);
+  for (const Record& r : records) {
+    if (r.kind != RECORD_KIND_DATA) continue;
+    CaptureEvent event = {ticksToNs(r.ticks, CPU_HZ), r.ticks, r.kind, r.channel, r.value, r.status, 0};
+    writeCsvLine(out, event);
+  }
+  return std::fclose(out) == 0;
+}
+
+// ==================== Comparison ====================
+
+static std::vector<uint64_t> trimmed(const std::vector<uint64_t>& counts) {
+  std::vector<uint64_t> out(counts);
+  while (!out.empty() && out.back() == 0) out.pop_back();
+  return out;
+}
+
+static std::vector<uint64_t> rateFrom(const BinCounts& rate, uint64_t& first) {
+  size_t skip = 0;
+  while (skip < rate.counts.size() && rate.counts[skip] == 0) skip++;
+  first = rate.first + skip;
+  return trimmed(std::vector<uint64_t>(rate.counts.begin() + skip, rate.counts.end()));
+}
+
+/**
+ * First difference between two channel results, or "" if equal
+ */
+static std::string difference(const ChannelAnalysis& a, const ChannelAnalysis& b) {
+  struct Field {
+    const char* name;
+    uint64_t a;
+    uint64_t b;
+  };
+  const Field fields[] = {
+      {"bytes", a.bytes, b.bytes},
+      {"overflow", a.overflow, b.overflow},
+      {"framing errors", a.framingErrors, b.framingErrors},
+      {"parity errors", a.parityErrors, b.parityErrors},
+      {"value sum", a.valueSum, b.valueSum},
+      {"packets", a.packets, b.packets},
+      {"checksum valid", a.checksumValid, b.checksumValid},
+      {"checksum error", a.checksumError, b.checksumError},
+      {"idle ends", a.endReasons[PACKET_END_IDLE], b.endReasons[PACKET_END_IDLE]},
+      {"length min", a.lengthMin, b.lengthMin},
+      {"length max", a.lengthMax, b.lengthMax},
+      {"length sum", a.lengthSum, b.lengthSum},
+      {"durations", a.durations, b.durations},
+      {"duration sum", a.durationSumNs, b.durationSumNs},
+      {"duration max", a.durationMaxNs, b.durationMaxNs},
+      {"gaps", a.gapCount, b.gapCount},
+      {"gap min", a.gapMinNs, b.gapMinNs},
+      {"gap max", a.gapMaxNs, b.gapMaxNs},
+  };
+  for (const Field& field : fields) {
+    if (field.a != field.b) {
+      return std::string(field.name) + " " + std::to_string(field.a) + " vs " + std::to_string(field.b);
+    }
+  }
+  if (trimmed(a.lengths) != trimmed(b.lengths)) return "length histogram";
+  for (uint32_t i = 0; i < ANALYSIS_GAP_BINS; i++) {
+    if (a.gaps[i] != b.gaps[i]) return "gap histogram bin " + std::to_string(i);
+  }
+  uint64_t firstA, firstB;
+  if (rateFrom(a.rate, firstA) != rateFrom(b.rate, firstB) || firstA != firstB) return "packet rate";
+  return "";
+}
+
+static std::string difference(const CaptureAnalysis& a, const CaptureAnalysis& b, bool compareEvents) {
+  if (a.records != b.records && compareEvents) return "record count";
+  if (a.malformedLines != b.malformedLines) return "malformed lines";
+  if (compareEvents && a.baudChanges.size() != b.baudChanges.size()) return "baud changes";
+  for (uint8_t channel = 0; channel < MAX_CAPTURE_CHANNELS; channel++) {
+    std::string why = difference(a.channels[channel], b.channels[channel]);
+    if (!why.empty()) return std::string(captureChannelName(channel)) + ": " + why;
+  }
+  return "";
+}
+
+// ==================== Runs ====================
+
+struct Case {
+  const char* name;
+  std::string path;
+  AnalysisFraming framing;
+  const ChannelAnalysis* truth;
+  bool compareEvents;                 // CSV has no event lines
+};
+
+static bool analyze(const Case& c, unsigned threads, size_t chunkBytes, uint64_t gapNs, CaptureAnalysis& result) {
+  AnalysisOptions options;
+  options.threads = threads;
+  options.chunkBytes = chunkBytes;
+  options.gapNs = gapNs;
+  CaptureAnalyzer analyzer(options);
+  if (!analyzer.run(c.path, result)) {
+    std::printf("  %s: %s\n", c.name, analyzer.error().c_str());
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint64_t dataBytes = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 16000000ULL;
+  std::string directory = (argc > 2) ? argv[2] : "/tmp/analysis_bench";
+  mkdir(directory.c_str(), 0755);
+
+  std::printf("Parallel capture analysis: %llu data bytes on %u channels, %u hardware threads\n\n",
+              (unsigned long long)dataBytes, CHANNELS, std::thread::hardware_concurrency());
+
+  std::vector<Record> records;
+  ChannelAnalysis truthRecords[MAX_CAPTURE_CHANNELS];
+  ChannelAnalysis truthIdle[MAX_CAPTURE_CHANNELS];
+  for (uint8_t channel = 0; channel < CHANNELS; channel++) {
+    generate(channel, dataBytes / CHANNELS, 100 + channel, records, truthRecords[channel], truthIdle[channel]);
+  }
+  std::stable_sort(records.begin(), records.end(),
+                   [](const Record& a, const Record& b) { return a.ticks < b.ticks; });
+
+  Case cases[] = {
+      {"records.ssb", directory + "/records.ssb", ANALYSIS_FRAMING_RECORDS, truthRecords, true},
+      {"idle.ssb", directory + "/idle.ssb", ANALYSIS_FRAMING_IDLE, truthIdle, true},
+      {"idle.csv", directory + "/idle.csv", ANALYSIS_FRAMING_IDLE, truthIdle, false},
+  };
+  if (!writeSsb(cases[0].path, records, true) || !writeSsb(cases[1].path, records, false) ||
+      !writeCsv(cases[2].path, records)) {
+    std::printf("Cannot write the captures in %s\n", directory.c_str());
+    return 1;
+  }
+  records.clear();
+  records.shrink_to_fit();
+
+  int failures = 0;
+  uint64_t idleGapNs = 0;
+  for (const Case& c : cases) {
+    CaptureAnalysis reference;
+    if (!analyze(c, 1, SIZE_MAX, idleGapNs, reference)) return 1;
+    if (c.framing == ANALYSIS_FRAMING_IDLE && idleGapNs == 0) idleGapNs = reference.gapNs;   // CSV: no baud
+
+    CaptureAnalysis truth;
+    for (uint8_t channel = 0; channel < CHANNELS; channel++) truth.channels[channel] = c.truth[channel];
+    std::string why = (reference.framing != c.framing) ? "framing not detected" : difference(truth, reference, false);
+    std::printf("%-12s %7.1f MB, %s framing: %s\n", c.name, reference.inputBytes / 1e6,
+                reference.framing == ANALYSIS_FRAMING_RECORDS ? "record" : "idle-gap",
+                why.empty() ? "matches the generator" : ("MISMATCH " + why).c_str());
+    if (!why.empty()) failures++;
+
+    std::printf("  %-8s %-8s %8s %8s %8s %8s  %s\n", "range", "threads", "chunks", "steals", "MB/s", "speedup",
+                "result");
+    double baseline = 0;
+    for (size_t chunkBytes : CHUNK_SIZES) {
+      for (unsigned threads : THREAD_COUNTS) {
+        CaptureAnalysis result;
+        if (!analyze(c, threads, chunkBytes, idleGapNs, result)) return 1;
+        why = difference(reference, result, c.compareEvents);
+        if (!why.empty()) failures++;
+        double mbps = result.inputBytes / 1e6 / result.seconds;
+        if (chunkBytes == TIMING_CHUNK_BYTES && threads == 1) baseline = mbps;
+        char speedup[16] = "";
+        if (chunkBytes == TIMING_CHUNK_BYTES && baseline > 0) std::snprintf(speedup, sizeof(speedup), "%.2fx", mbps / baseline);
+        std::printf("  %-8zu %-8u %8zu %8llu %8.0f %8s  %s\n", chunkBytes, result.threads, result.chunks,
+                    (unsigned long long)result.steals, mbps, speedup,
+                    why.empty() ? "ok" : ("MISMATCH " + why).c_str());
+      }
+    }
+    std::printf("\n");
+  }
+
+  if (failures) {
+    std::printf("FAILED: %d mismatches\n", failures);
+    return 1;
+  }
+  std::printf("All results match\n");
+  return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * baud_bench - Baud rate estimator accuracy benchmark
+ *
+ * Generates edge trains for 8N1 traffic (random bytes or printable text
+ * in bursts separated by idle gaps) at standard and non-standard rates up
+ * to 4 Mbaud, with transmitter clock error, edge interrupt latency jitter
+ * and injected glitches (a 20-60 ns pulse in 1% of characters), and
+ * feeds the intervals to BaudEstimator as the edge interrupt would. An
+ * estimate is taken every 50 ms of line time; a trial locks on the first
+ * estimate with confidence >= 0.9.
+ *
+ * A trial passes if it locks within 2 s (FR-001) on the right rate: the
+ * standard rate itself, or within 1% for non-standard rates. The legacy
+ * detector (shortest consistent pulse of 50 edges timed with micros(),
+ * snapped to 9600-115200) is run on the same trains for comparison.
+ *
+ * Estimates are solved step by step as BaudDetector does. The mean host
+ * time of a solve and its most steps are reported per rate; for a
+ * worst-case histogram (every bin populated, 40 peaks) the whole solve
+ * and the longest single step (startEstimate() or one stepEstimate(), the
+ * work of one baud task run) are timed, each the fastest of 20 runs so
+ * host scheduling noise drops out.
+ *
+ * Exits non-zero if any rate's pass rate is below 95%.
+ *
+ * Usage: baud_bench [trials_per_rate]
+ *        default: 100
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "BaudEstimator.h"
+#include "SimEdgeTrain.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CPU_HZ = 600000000;
+const double LOCK_CONFIDENCE = 0.9;
+const double DEADLINE_S = 2.0;                   // FR-001 detection time
+const double ESTIMATE_PERIOD_S = 0.05;
+const EdgeTrainModel LINE;                       // 1% clock error, 40-cycle jitter, 1% glitches
+const uint32_t RATES[] = {300, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600,
+                          1000000, 2000000, 3000000, 4000000,
+                          // Non-standard
+                          10400, 62500, 125000, 1234567, 3600000};
+
+// ==================== Reference: Legacy Detector ====================
+
+// findShortestConsistentPulse() + roundToStandardBaud() on 50 edges timed in us
+static uint32_t legacyDetect(const std::vector<uint64_t>& edges) {
+  if (edges.size() < 50) return 0;
+  uint32_t pulses[49];
+  for (int i = 0; i < 49; i++) {
+    pulses[i] = (uint32_t)(edges[i + 1] / (CPU_HZ / 1000000)) - (uint32_t)(edges[i] / (CPU_HZ / 1000000));
+  }
+
+  uint32_t minPulse = pulses[0];
+  for (int i = 1; i < 49; i++) {
+    if (pulses[i] < minPulse && pulses[i] > 5) minPulse = pulses[i];
+  }
+  int matchCount = 0;
+  uint32_t tolerance = minPulse / 10;
+  for (int i = 0; i < 49; i++) {
+    if (pulses[i] >= minPulse - tolerance && pulses[i] <= minPulse + tolerance) matchCount++;
+  }
+  if (matchCount < 3 || minPulse == 0) return 0;
+
+  uint32_t rawBaud = 1000000 / minPulse;
+  const uint32_t rates[] = {9600, 19200, 38400, 57600, 115200};
+  uint32_t closest = rates[0];
+  uint32_t minDiff = std::abs((int32_t)rawBaud - (int32_t)closest);
+  for (uint32_t rate : rates) {
+    uint32_t diff = std::abs((int32_t)rawBaud - (int32_t)rate);
+    if (diff < minDiff) {
+      minDiff = diff;
+      closest = rate;
+    }
+  }
+  return minDiff < closest / 20 ? closest : 0;
+}
+
+// ==================== Solve Timing ====================
+
+struct SolveTiming {
+  uint32_t solves = 0;
+  uint32_t steps = 0;             // Most steps in one solve
+  double totalUs = 0;             // Sum over solves
+};
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One solve, a step at a time, timing each step (into stepUs if given)
+static bool timedEstimate(BaudEstimator& estimator, BaudEstimate& result, SolveTiming& timing,
+                          std::vector<double>* stepUs = nullptr) {
+  double solveUs = 0;
+  uint32_t steps = 0;
+  bool started = false;
+  bool done = false;
+  while (!done) {
+    auto start = std::chrono::steady_clock::now();
+    if (steps == 0) {
+      started = estimator.startEstimate();
+      done = !started;
+    } else {
+      done = estimator.stepEstimate();
+    }
+    double us = elapsedUs(start);
+    if (stepUs) stepUs->push_back(us);
+    solveUs += us;
+    steps++;
+  }
+
+  timing.solves++;
+  timing.totalUs += solveUs;
+  if (steps > timing.steps) timing.steps = steps;
+  return started && estimator.estimateResult(result);
+}
+
+// Every bin populated, and a candidate peak in every 16th (40 peaks of
+// 64 intervals, each over 1/50 of the total)
+static void worstCaseTiming() {
+  BaudEstimator* estimator = new BaudEstimator(CPU_HZ);
+  for (uint32_t octave = 0; octave < BaudEstimator::OCTAVES; octave++) {
+    for (uint32_t step = 0; step < BaudEstimator::BINS_PER_OCTAVE; step++) {
+      uint32_t shift = BaudEstimator::MIN_SHIFT + octave;
+      uint32_t ticks = (1u << shift) + (step << (shift - BaudEstimator::MIN_SHIFT));
+      uint32_t repeats = (step % 16 == 8) ? 64 : 1;
+      for (uint32_t i = 0; i < repeats; i++) estimator->addInterval(ticks);
+    }
+  }
+  // Fastest of 20 runs, per step
+  SolveTiming timing;
+  BaudEstimate estimate;
+  std::vector<double> fastest;
+  for (int run = 0; run < 20; run++) {
+    std::vector<double> stepUs;
+    timedEstimate(*estimator, estimate, timing, &stepUs);
+    if (fastest.empty()) fastest = stepUs;
+    for (size_t i = 0; i < stepUs.size() && i < fastest.size(); i++) {
+      if (stepUs[i] < fastest[i]) fastest[i] = stepUs[i];
+    }
+  }
+  delete estimator;
+
+  double solveUs = 0;
+  double longestUs = 0;
+  for (double us : fastest) {
+    solveUs += us;
+    if (us > longestUs) longestUs = us;
+  }
+  std::printf("\nworst-case histogram (%u bins, %u steps): solve %.1f us, longest step %.1f us (host)\n",
+              BaudEstimator::BIN_COUNT, timing.steps, solveUs, longestUs);
+}
+
+// ==================== Run ====================
+
+static bool correct(uint32_t estimate, uint32_t baud) {
+  if (nearestStandardBaud(baud, 0) == baud) return estimate == baud;
+  return std::fabs((double)estimate - baud) <= baud * 0.01;
+}
+
+struct RateResult {
+  uint32_t passed = 0;
+  uint32_t legacyPassed = 0;
+  double lockSeconds = 0;         // Mean over passed trials
+  double worstLockSeconds = 0;
+  SolveTiming timing;
+};
+
+static RateResult runRate(uint32_t baud, uint32_t trials) {
+  RateResult result;
+  BaudEstimator* estimator = new BaudEstimator(CPU_HZ);
+  std::vector<uint64_t> edges;
+
+  for (uint32_t trial = 0; trial < trials; trial++) {
+    EdgeTrain train(baud, baud * 31 + trial, trial % 2 == 1, LINE);
+    estimator->reset();
+    edges.clear();
+
+    size_t fed = 0;
+    double lockAt = -1;
+    BaudEstimate estimate = {};
+    for (double t = ESTIMATE_PERIOD_S; t <= DEADLINE_S + 1e-9; t += ESTIMATE_PERIOD_S) {
+      train.generate(t * CPU_HZ, edges);
+      for (; fed + 1 < edges.size(); fed++) {
+        // The interrupt stamps with the wrapping 32-bit counter
+        estimator->addInterval((uint32_t)edges[fed + 1] - (uint32_t)edges[fed]);
+      }
+      if (timedEstimate(*estimator, estimate, result.timing) && estimate.confidence >= LOCK_CONFIDENCE) {
+        lockAt = t;
+        break;
+      }
+    }
+
+    if (lockAt >= 0 && correct(estimate.baud, baud)) {
+      result.passed++;
+      result.lockSeconds += lockAt;
+      if (lockAt > result.worstLockSeconds) result.worstLockSeconds = lockAt;
+    }
+    if (legacyDetect(edges) == baud) result.legacyPassed++;
+  }
+
+  if (result.passed > 0) result.lockSeconds /= result.passed;
+  delete estimator;
+  return result;
+}
+
+int main(int argc, char** argv) {
+  uint32_t trials = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100;
+  if (trials == 0) trials = 1;
+
+  std::printf("%u trials per rate: 8N1 bursts, +/-%.0f%% clock, %u-cycle jitter, "
+              "glitch in %.0f%% of characters\n", trials, LINE.clockError * 100, LINE.jitterCycles,
+              LINE.glitchPerChar * 100);
+  std::printf("lock at confidence >= %.2f, deadline %.1f s\n\n", LOCK_CONFIDENCE, DEADLINE_S);
+  std::printf("%9s %9s %10s %10s %9s %9s %6s  %s\n", "baud", "accuracy", "mean_lock", "worst_lock",
+              "legacy", "solve_us", "steps", "result");
+
+  bool allOk = true;
+  for (uint32_t baud : RATES) {
+    RateResult result = runRate(baud, trials);
+    double accuracy = 100.0 * result.passed / trials;
+    bool ok = accuracy >= 95.0;
+    const SolveTiming& timing = result.timing;
+    std::printf("%9u %8.1f%% %9.2fs %9.2fs %8.1f%% %9.1f %6u  %s\n", baud, accuracy,
+                result.lockSeconds, result.worstLockSeconds, 100.0 * result.legacyPassed / trials,
+                timing.solves ? timing.totalUs / timing.solves : 0.0, timing.steps, ok ? "ok" : "FAIL");
+    allOk &= ok;
+  }
+
+  worstCaseTiming();
+  return allOk ? 0 : 1;
+}
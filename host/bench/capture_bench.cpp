@@ -0,0 +1,278 @@
+/*
+ * capture_bench - Receive-path throughput benchmark
+ *
+ * Feeds a simulated UART at a fixed baud rate and runs the capture loop
+ * against it in simulated time. Two loop strategies are compared:
+ *
+ *   legacy - one byte per loop() iteration followed by delay(10)
+ *   burst  - drainPort() into an SpscRing, then log the whole ring
+ *
+ * Logging cost is modelled per byte, per 512-byte SD sector and as
+ * periodic long stalls (card wear levelling). No draining happens while
+ * the logger is busy, so the UART buffer alone must absorb each stall.
+ *
+ * Usage: capture_bench [seconds] [stall_ms] [stall_every_ms]
+ *        defaults: 10 s simulated, 100 ms stall every 5000 ms
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "CaptureChannel.h"
+#include "RingBuffer.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t UART_BUFFER_LEGACY = 64;           // Default HardwareSerial buffer
+const uint32_t UART_BUFFER_BURST = 64 + 32768;    // Plus addMemoryForRead()
+const uint64_t LOG_BYTE_NS = 150;                 // Encode one binary record
+const uint64_t SECTOR_WRITE_NS = 250000;          // One 512-byte SD write
+const uint32_t RECORDS_PER_SECTOR = 512 / 8;
+const uint64_t LOOP_OVERHEAD_NS = 1000;           // Empty loop() + yield()
+
+// ==================== Simulated UART ====================
+
+/**
+ * UART receive buffer filled at line rate (10 bits per byte)
+ * Bytes carry a running sequence so the logger can detect gaps.
+ */
+class SimUart {
+ public:
+  SimUart(uint32_t baud, uint32_t capacity)
+      : byteNs_(10ULL * 1000000000ULL / baud), buffer_(capacity) {}
+
+  // Deliver all bytes that have arrived by simulated time now
+  void advance(uint64_t now) {
+    uint64_t due = now / byteNs_;
+    while (sent_ < due) {
+      if (count_ < buffer_.size()) {
+        buffer_[(head_ + count_) % buffer_.size()] = (uint8_t)sent_;
+        count_++;
+        if (count_ > peak_) peak_ = count_;
+      } else {
+        lost_++;
+      }
+      sent_++;
+    }
+  }
+
+  int available() { return (int)count_; }
+
+  size_t readBytes(char* out, size_t length) {
+    size_t n = length < count_ ? length : count_;
+    for (size_t i = 0; i < n; i++) {
+      out[i] = (char)buffer_[head_];
+      head_ = (head_ + 1) % buffer_.size();
+    }
+    count_ -= n;
+    return n;
+  }
+
+  uint64_t sent() const { return sent_; }
+  uint64_t lost() const { return lost_; }
+  size_t peak() const { return peak_; }
+
+ private:
+  uint64_t byteNs_;
+  std::vector<uint8_t> buffer_;
+  size_t head_ = 0;
+  size_t count_ = 0;
+  size_t peak_ = 0;
+  uint64_t sent_ = 0;
+  uint64_t lost_ = 0;
+};
+
+// ==================== Simulated Logger ====================
+
+/**
+ * Charges simulated time for logging and counts sequence gaps
+ */
+class SimLogger {
+ public:
+  SimLogger(uint64_t stallNs, uint64_t stallEveryNs)
+      : stallNs_(stallNs), stallEveryNs_(stallEveryNs), nextStall_(stallEveryNs) {}
+
+  // Log one byte; returns the simulated time spent
+  uint64_t log(uint8_t value, uint64_t now) {
+    if (logged_ > 0 && value != (uint8_t)(last_ + 1)) gaps_++;
+    last_ = value;
+    logged_++;
+
+    uint64_t cost = LOG_BYTE_NS;
+    if (++recordsInSector_ == RECORDS_PER_SECTOR) {
+      recordsInSector_ = 0;
+      cost += SECTOR_WRITE_NS;
+      if (stallEveryNs_ > 0 && now >= nextStall_) {
+        cost += stallNs_;
+        nextStall_ += stallEveryNs_;
+      }
+    }
+    return cost;
+  }
+
+  uint64_t logged() const { return logged_; }
+  uint64_t gaps() const { return gaps_; }
+
+ private:
+  uint64_t stallNs_;
+  uint64_t stallEveryNs_;
+  uint64_t nextStall_;
+  uint32_t recordsInSector_ = 0;
+  uint64_t logged_ = 0;
+  uint64_t gaps_ = 0;
+  uint8_t last_ = 0;
+};
+
+// ==================== Strategies ====================
+
+/**
+ * Drain all available bytes from a port into a ring (the polled receive
+ * path the firmware used before its UART interrupts fed the rings)
+ *
+ * Reads straight into the ring's contiguous free spans. If the ring fills,
+ * the rest of the burst is still read (so the port's own buffer keeps
+ * room) and counted as dropped.
+ *
+ * @tparam Port Provides int available() and readBytes(char*, size_t)
+ * @tparam Ring SpscRing<uint8_t, N>
+ * @return Number of bytes queued into the ring
+ */
+template <typename Port, typename Ring>
+static uint32_t drainPort(Port& port, Ring& ring, DrainState& state) {
+  uint32_t queued = 0;
+  int available = port.available();
+
+  while (available > 0) {
+    uint8_t* span;
+    uint32_t space = ring.writeSpan(span);
+
+    if (space == 0) {
+      // Ring full: discard the remainder of this burst
+      char scratch[64];
+      uint32_t chunk = (uint32_t)available < sizeof(scratch) ? (uint32_t)available : sizeof(scratch);
+      uint32_t got = port.readBytes(scratch, chunk);
+      if (got == 0) break;
+      state.bytesReceived += got;
+      state.bytesDropped += got;
+      available -= got;
+      continue;
+    }
+
+    uint32_t chunk = (uint32_t)available < space ? (uint32_t)available : space;
+    uint32_t got = port.readBytes((char*)span, chunk);
+    if (got == 0) break;
+
+    ring.commitWrite(got);
+    state.bytesReceived += got;
+    queued += got;
+    available -= got;
+
+    // Pick up anything that arrived during the copy
+    if (available == 0) available = port.available();
+  }
+
+  return queued;
+}
+
+struct BenchResult {
+  uint64_t sent;
+  uint64_t logged;
+  uint64_t lost;
+  uint64_t gaps;
+  size_t uartPeak;
+  uint32_t ringPeak;
+};
+
+static BenchResult runLegacy(uint32_t baud, uint64_t durationNs, uint64_t stallNs, uint64_t stallEveryNs) {
+  SimUart uart(baud, UART_BUFFER_LEGACY);
+  SimLogger logger(stallNs, stallEveryNs);
+  uint64_t now = 0;
+
+  while (now < durationNs) {
+    uart.advance(now);
+    if (uart.available()) {
+      char value;
+      uart.readBytes(&value, 1);
+      now += logger.log((uint8_t)value, now);
+    }
+    now += 10000000ULL;  // delay(10)
+  }
+  uart.advance(now);
+
+  return {uart.sent(), logger.logged(), uart.sent() - logger.logged(), logger.gaps(), uart.peak(), 0};
+}
+
+static SpscRing<uint8_t, 32768> ring;    // Matches RX_RING_SIZE
+
+static BenchResult runBurst(uint32_t baud, uint64_t durationNs, uint64_t stallNs, uint64_t stallEveryNs) {
+  SimUart uart(baud, UART_BUFFER_BURST);
+  SimLogger logger(stallNs, stallEveryNs);
+  DrainState state;
+  uint32_t ringPeak = 0;
+  uint64_t now = 0;
+  ring.clear();
+
+  while (now < durationNs) {
+    uart.advance(now);
+    drainPort(uart, ring, state);
+    if (ring.size() > ringPeak) ringPeak = ring.size();
+
+    uint32_t remaining = ring.size();
+    while (remaining > 0) {
+      const uint8_t* span;
+      uint32_t count = ring.readSpan(span);
+      if (count > remaining) count = remaining;
+      for (uint32_t i = 0; i < count; i++) now += logger.log(span[i], now);
+      ring.consumeRead(count);
+      remaining -= count;
+    }
+    now += LOOP_OVERHEAD_NS;
+  }
+
+  // Stop: flush what is still buffered
+  uart.advance(now);
+  drainPort(uart, ring, state);
+  const uint8_t* span;
+  uint32_t count;
+  while ((count = ring.readSpan(span)) > 0) {
+    for (uint32_t i = 0; i < count; i++) now += logger.log(span[i], now);
+    ring.consumeRead(count);
+  }
+
+  return {uart.sent(), logger.logged(), uart.sent() - logger.logged(), logger.gaps(), uart.peak(), ringPeak};
+}
+
+// ==================== Main ====================
+
+static void report(const char* name, uint32_t baud, const BenchResult& r) {
+  double perMillion = r.sent ? (double)r.lost * 1e6 / (double)r.sent : 0.0;
+  std::printf("%-7s %8lu %10llu %10llu %10llu %12.1f %7llu %9zu %9u\n",
+              name, (unsigned long)baud, (unsigned long long)r.sent,
+              (unsigned long long)r.logged, (unsigned long long)r.lost, perMillion,
+              (unsigned long long)r.gaps, r.uartPeak, r.ringPeak);
+}
+
+int main(int argc, char** argv) {
+  double seconds = (argc > 1) ? std::atof(argv[1]) : 10.0;
+  double stallMs = (argc > 2) ? std::atof(argv[2]) : 100.0;
+  double stallEveryMs = (argc > 3) ? std::atof(argv[3]) : 5000.0;
+
+  uint64_t durationNs = (uint64_t)(seconds * 1e9);
+  uint64_t stallNs = (uint64_t)(stallMs * 1e6);
+  uint64_t stallEveryNs = (uint64_t)(stallEveryMs * 1e6);
+
+  std::printf("Simulated %.1f s, SD stall %.0f ms every %.0f ms\n\n", seconds, stallMs, stallEveryMs);
+  std::printf("%-7s %8s %10s %10s %10s %12s %7s %9s %9s\n",
+              "loop", "baud", "sent", "logged", "lost", "lost/1M", "gaps", "uartPeak", "ringPeak");
+
+  const uint32_t bauds[] = {115200, 1000000, 2000000};
+  for (uint32_t baud : bauds) {
+    report("legacy", baud, runLegacy(baud, durationNs, stallNs, stallEveryNs));
+    report("burst", baud, runBurst(baud, durationNs, stallNs, stallEveryNs));
+  }
+  return 0;
+}
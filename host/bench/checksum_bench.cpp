@@ -0,0 +1,425 @@
+/*
+ * checksum_bench - Checksum kernels and detection engine benchmark
+ *
+ * Known answers: every algorithm against the standard check string
+ * "123456789", the empty input and a Modbus RTU request, and the table
+ * kernels against bit-at-a-time references on random buffers.
+ *
+ * Detection: two channels carry interleaved packets, each channel with
+ * its own rule (every algorithm, offset and trailer combination is used).
+ * Each channel first sends packets without a checksum, which must not
+ * lock, then checksummed packets with 10% single-bit corruption. The
+ * engine must lock the generated rule and then flag exactly the corrupted
+ * packets. The channel then switches to another rule; the engine must
+ * drop the lock and find the new one.
+ *
+ * Throughput: kernel and engine cost per byte (detecting and locked), next
+ * to the budget for two channels at 2 Mbaud.
+ *
+ * Exits non-zero if any check fails.
+ *
+ * Usage: checksum_bench
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ChecksumEngine.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CHANNELS = 2;
+const uint32_t PLAIN_PACKETS = 500;          // Without a checksum, before the first rule
+const uint32_t CHECKED_PACKETS = 400;        // Per rule
+const double CORRUPT_RATE = 0.1;
+const uint32_t DETECT_WITHIN = 40;           // Packets after a rule starts
+const uint32_t LINE_BAUD = 2000000;
+const uint32_t KERNEL_BYTES = 16 * 1024 * 1024;
+
+// ==================== Known Answers ====================
+
+struct KnownAnswer {
+  uint8_t algorithm;
+  const char* name;
+  std::vector<uint8_t> input;
+  uint32_t expected;
+};
+
+static std::vector<uint8_t> bytes(const char* text) {
+  return std::vector<uint8_t>(text, text + std::strlen(text));
+}
+
+static bool knownAnswers() {
+  const std::vector<uint8_t> modbus = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+  const KnownAnswer ANSWERS[] = {
+    {CHECKSUM_XOR8, "\"123456789\"", bytes("123456789"), 0x31},
+    {CHECKSUM_SUM8, "\"123456789\"", bytes("123456789"), 0xDD},
+    {CHECKSUM_CRC8, "\"123456789\"", bytes("123456789"), 0xF4},
+    {CHECKSUM_CRC16_MODBUS, "\"123456789\"", bytes("123456789"), 0x4B37},
+    {CHECKSUM_CRC16_CCITT, "\"123456789\"", bytes("123456789"), 0x29B1},
+    {CHECKSUM_XOR8, "empty", {}, 0x00},
+    {CHECKSUM_SUM8, "empty", {}, 0x00},
+    {CHECKSUM_CRC8, "empty", {}, 0x00},
+    {CHECKSUM_CRC16_MODBUS, "empty", {}, 0xFFFF},
+    {CHECKSUM_CRC16_CCITT, "empty", {}, 0xFFFF},
+    {CHECKSUM_CRC16_MODBUS, "01 03 00 00 00 0A", modbus, 0xCDC5},   // Sent as C5 CD
+  };
+
+  bool ok = true;
+  for (const KnownAnswer& answer : ANSWERS) {
+    uint32_t got = computeChecksum(answer.algorithm, answer.input.data(), answer.input.size());
+    bool pass = got == answer.expected;
+    std::printf("  %-13s %-20s 0x%04X  %s\n", checksumAlgorithmName(answer.algorithm), answer.name,
+                got, pass ? "ok" : "FAIL");
+    ok &= pass;
+  }
+
+  // The Modbus request as sent: the trailing bytes carry the same value
+  uint32_t recent = (0x00u << 24) | (0x0Au << 16) | (0xC5u << 8) | 0xCDu;
+  bool trailing = trailingChecksum(CHECKSUM_CRC16_MODBUS, recent, 0) == 0xCDC5;
+  std::printf("  %-13s %-20s %s\n", "CRC16_MODBUS", "trailing C5 CD", trailing ? "ok" : "FAIL");
+  return ok && trailing;
+}
+
+// ==================== Bitwise References ====================
+
+static uint32_t referenceChecksum(uint8_t algorithm, const uint8_t* data, uint32_t length) {
+  uint32_t crc = 0;
+  switch (algorithm) {
+    case CHECKSUM_XOR8:
+      for (uint32_t i = 0; i < length; i++) crc ^= data[i];
+      return crc;
+    case CHECKSUM_SUM8:
+      for (uint32_t i = 0; i < length; i++) crc += data[i];
+      return crc & 0xFF;
+    case CHECKSUM_CRC8:
+      for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+      }
+      return crc;
+    case CHECKSUM_CRC16_MODBUS:
+      crc = 0xFFFF;
+      for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+      }
+      return crc;
+    case CHECKSUM_CRC16_CCITT:
+      crc = 0xFFFF;
+      for (uint32_t i = 0; i < length; i++) {
+        crc ^= (uint32_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) & 0xFFFF : (crc << 1) & 0xFFFF;
+      }
+      return crc;
+    default:
+      return 0;
+  }
+}
+
+static bool matchReferences() {
+  std::mt19937 rng(1);
+  for (uint32_t trial = 0; trial < 2000; trial++) {
+    std::vector<uint8_t> data(rng() % 300);
+    for (uint8_t& value : data) value = (uint8_t)rng();
+    for (uint8_t algorithm = CHECKSUM_XOR8; algorithm < CHECKSUM_ALGORITHM_COUNT; algorithm++) {
+      if (computeChecksum(algorithm, data.data(), data.size()) !=
+          referenceChecksum(algorithm, data.data(), data.size())) {
+        std::printf("  %s differs from the reference on %zu bytes\n", checksumAlgorithmName(algorithm),
+                    data.size());
+        return false;
+      }
+    }
+  }
+  std::printf("  table kernels match the references on 2000 random buffers\n");
+  return true;
+}
+
+// ==================== Synthetic Traffic ====================
+
+struct Packet {
+  std::vector<uint8_t> data;
+  bool corrupted = false;
+};
+
+static std::string describe(const ChecksumRule& rule) {
+  char text[48];
+  std::snprintf(text, sizeof(text), "%s/%u/%u", checksumAlgorithmName(rule.algorithm), rule.offset,
+                rule.trailer);
+  return text;
+}
+
+static std::vector<ChecksumRule> allRules() {
+  std::vector<ChecksumRule> rules;
+  for (uint8_t algorithm = CHECKSUM_XOR8; algorithm < CHECKSUM_ALGORITHM_COUNT; algorithm++) {
+    for (uint8_t offset = 0; offset < CHECKSUM_MAX_OFFSET; offset++) {
+      for (uint8_t trailer = 0; trailer <= CHECKSUM_MAX_TRAILER; trailer++) {
+        ChecksumRule rule;
+        rule.algorithm = algorithm;
+        rule.offset = offset;
+        rule.trailer = trailer;
+        rules.push_back(rule);
+      }
+    }
+  }
+  return rules;
+}
+
+/**
+ * A packet carrying a checksum by a rule (algorithm NONE: random bytes)
+ */
+static Packet makePacket(const ChecksumRule& rule, std::mt19937& rng, bool corrupt) {
+  Packet packet;
+  uint32_t covered = CHECKSUM_MIN_COVERED + rng() % 60;
+  for (uint32_t i = 0; i < rule.offset + covered; i++) packet.data.push_back((uint8_t)rng());
+  if (rule.algorithm == CHECKSUM_NONE) return packet;
+
+  uint32_t check = computeChecksum(rule.algorithm, packet.data.data() + rule.offset, covered);
+  if (rule.algorithm == CHECKSUM_CRC16_MODBUS) {
+    packet.data.push_back((uint8_t)check);
+    packet.data.push_back((uint8_t)(check >> 8));
+  } else if (rule.algorithm == CHECKSUM_CRC16_CCITT) {
+    packet.data.push_back((uint8_t)(check >> 8));
+    packet.data.push_back((uint8_t)check);
+  } else {
+    packet.data.push_back((uint8_t)check);
+  }
+  for (uint32_t i = 0; i < rule.trailer; i++) packet.data.push_back(0x7E);   // End flag
+
+  if (corrupt) {
+    // One bit in the covered bytes or the checksum
+    uint32_t span = packet.data.size() - rule.offset - rule.trailer;
+    packet.data[rule.offset + rng() % span] ^= (uint8_t)(1u << (rng() % 8));
+    packet.corrupted = true;
+  }
+  return packet;
+}
+
+// ==================== Detection ====================
+
+struct ChannelPlan {
+  std::vector<ChecksumRule> rules;      // One after the other, after the plain packets
+};
+
+struct ChannelTrack {
+  std::vector<Packet> packets;
+  std::vector<uint32_t> ruleOf;         // Index into the plan's rules (-1 plain)
+  size_t next = 0;
+  size_t byte = 0;
+  ChecksumRule lockedRule;              // Last lock event
+  uint32_t locks = 0;
+  uint32_t unlocks = 0;
+  int32_t lockedAt = -1;                // Packet index of the last lock
+  std::string error;
+};
+
+/**
+ * Interleave the channels byte by byte (random order) through one engine
+ * @return Empty on success, else what went wrong
+ */
+static std::string detect(const ChecksumRule& first, const ChecksumRule& second, uint32_t seed) {
+  std::mt19937 rng(seed);
+  ChecksumEngine engine;
+  engine.begin(ChecksumConfig());
+
+  // Channel 0 switches from first to second; channel 1 the other way round
+  ChannelTrack tracks[CHANNELS];
+  const ChecksumRule plans[CHANNELS][2] = {{first, second}, {second, first}};
+  for (uint32_t ch = 0; ch < CHANNELS; ch++) {
+    ChannelTrack& track = tracks[ch];
+    for (uint32_t i = 0; i < PLAIN_PACKETS; i++) {
+      track.packets.push_back(makePacket(ChecksumRule(), rng, false));
+      track.ruleOf.push_back(UINT32_MAX);
+    }
+    for (uint32_t r = 0; r < 2; r++) {
+      for (uint32_t i = 0; i < CHECKED_PACKETS; i++) {
+        bool corrupt = std::uniform_real_distribution<double>(0, 1)(rng) < CORRUPT_RATE;
+        track.packets.push_back(makePacket(plans[ch][r], rng, corrupt));
+        track.ruleOf.push_back(r);
+      }
+    }
+  }
+
+  for (;;) {
+    uint32_t ch = rng() % CHANNELS;
+    ChannelTrack& track = tracks[ch];
+    if (track.next == track.packets.size()) {
+      ch = (ch + 1) % CHANNELS;
+      if (tracks[ch].next == tracks[ch].packets.size()) break;
+    }
+    ChannelTrack& current = tracks[ch];
+    const Packet& packet = current.packets[current.next];
+    if (current.byte == 0) engine.packetStart((uint8_t)ch);
+    engine.add((uint8_t)ch, packet.data[current.byte++]);
+    if (current.byte < packet.data.size()) continue;
+
+    // Packet complete
+    uint32_t index = current.next;
+    auto sink = [&current, index](uint8_t, const ChecksumRule& rule) {
+      if (rule.algorithm == CHECKSUM_NONE) {
+        current.unlocks++;
+      } else {
+        current.locks++;
+        current.lockedRule = rule;
+        current.lockedAt = index;
+      }
+    };
+    uint8_t status = engine.packetEnd((uint8_t)ch, true, sink);
+    current.next++;
+    current.byte = 0;
+    if (!current.error.empty()) continue;
+
+    uint32_t r = current.ruleOf[index];
+    char where[64];
+    std::snprintf(where, sizeof(where), "ch%u packet %u: ", ch, index);
+    if (r == UINT32_MAX) {
+      if (current.locks > 0) current.error = std::string(where) + "locked " + describe(current.lockedRule) + " on plain traffic";
+      continue;
+    }
+    const ChecksumRule& want = plans[ch][r];
+    const ChecksumRule& locked = engine.rule((uint8_t)ch);
+    uint32_t ruleStart = PLAIN_PACKETS + r * CHECKED_PACKETS;
+    bool lockedRight = locked.algorithm == want.algorithm && locked.offset == want.offset &&
+                       locked.trailer == want.trailer;
+    if (locked.algorithm != CHECKSUM_NONE && !lockedRight) {
+      // Still on the previous rule while failures accumulate is fine
+      if (r == 0 || index - ruleStart > DETECT_WITHIN) {
+        current.error = std::string(where) + "locked " + describe(locked) + ", expected " + describe(want);
+      }
+      continue;
+    }
+    if (!lockedRight) {
+      if (index - ruleStart > DETECT_WITHIN) {
+        current.error = std::string(where) + describe(want) + " not detected";
+      }
+      continue;
+    }
+    if (current.lockedAt == (int32_t)index) continue;   // Locking packet: matched by definition
+    uint8_t expected = packet.corrupted ? STATUS_CHECKSUM_ERROR : STATUS_CHECKSUM_VALID;
+    if (status != expected) {
+      current.error = std::string(where) + (packet.corrupted ? "corruption missed" : "false error") +
+                      " under " + describe(want);
+    }
+  }
+
+  for (uint32_t ch = 0; ch < CHANNELS; ch++) {
+    ChannelTrack& track = tracks[ch];
+    if (!track.error.empty()) return track.error;
+    if (track.locks != 2 || track.unlocks != 1) {
+      return "ch" + std::to_string(ch) + ": " + std::to_string(track.locks) + " locks, " +
+             std::to_string(track.unlocks) + " unlocks, expected 2 and 1";
+    }
+  }
+  return "";
+}
+
+// ==================== Throughput ====================
+
+template <typename Fn>
+static double nsPerByte(uint64_t bytes, Fn&& fn) {
+  auto begin = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - begin).count() / bytes;
+}
+
+static volatile uint32_t sinkValue;
+
+static void kernelThroughput() {
+  std::vector<uint8_t> data(KERNEL_BYTES);
+  std::mt19937 rng(3);
+  for (uint8_t& value : data) value = (uint8_t)rng();
+
+  double table = nsPerByte(data.size(), [&] {
+    ChecksumState state;
+    for (uint8_t value : data) state.add(value);
+    sinkValue = state.crc16Ccitt ^ state.crc16Modbus ^ state.crc8 ^ state.xor8 ^ state.sum8;
+  });
+  double bitwise = nsPerByte(data.size(), [&] {
+    sinkValue = referenceChecksum(CHECKSUM_CRC16_MODBUS, data.data(), data.size()) ^
+                referenceChecksum(CHECKSUM_CRC16_CCITT, data.data(), data.size()) ^
+                referenceChecksum(CHECKSUM_CRC8, data.data(), data.size());
+  });
+  std::printf("  all five, table kernels        %6.2f ns/byte\n", table);
+  std::printf("  three CRCs, bitwise reference  %6.2f ns/byte\n", bitwise);
+}
+
+/**
+ * Engine cost with two interleaved channels
+ * @param rule Rule the traffic carries (NONE: detection never locks)
+ */
+static double engineThroughput(const ChecksumRule& rule) {
+  std::mt19937 rng(5);
+  std::vector<Packet> packets;
+  uint64_t total = 0;
+  while (total < KERNEL_BYTES / 4) {
+    packets.push_back(makePacket(rule, rng, false));
+    total += packets.back().data.size();
+  }
+
+  ChecksumEngine engine;
+  engine.begin(ChecksumConfig());
+  uint32_t locks = 0;
+  auto sink = [&locks](uint8_t, const ChecksumRule&) { locks++; };
+  return nsPerByte(2 * total, [&] {
+    // Channel 1 replays channel 0's packets half a packet behind
+    for (size_t p = 0; p < packets.size(); p++) {
+      const std::vector<uint8_t>& a = packets[p].data;
+      const std::vector<uint8_t>& b = packets[p > 0 ? p - 1 : 0].data;
+      engine.packetStart(0);
+      engine.packetStart(1);
+      size_t length = a.size() > b.size() ? a.size() : b.size();
+      for (size_t i = 0; i < length; i++) {
+        if (i < a.size()) engine.add(0, a[i]);
+        if (i < b.size()) engine.add(1, b[i]);
+      }
+      sinkValue = engine.packetEnd(0, true, sink) ^ engine.packetEnd(1, true, sink);
+    }
+  });
+}
+
+// ==================== Run ====================
+
+int main() {
+  bool ok = true;
+
+  std::printf("Known answers\n");
+  ok &= knownAnswers();
+  ok &= matchReferences();
+
+  std::printf("\nDetection (%u plain packets, then %u per rule, %.0f%% corrupted)\n", PLAIN_PACKETS,
+              CHECKED_PACKETS, CORRUPT_RATE * 100);
+  std::vector<ChecksumRule> rules = allRules();
+  uint32_t passed = 0;
+  for (size_t i = 0; i < rules.size(); i++) {
+    const ChecksumRule& first = rules[i];
+    const ChecksumRule& second = rules[(i + 7) % rules.size()];
+    std::string error = detect(first, second, 1000 + i);
+    if (error.empty()) {
+      passed++;
+    } else {
+      std::printf("  %-18s -> %-18s FAIL: %s\n", describe(first).c_str(), describe(second).c_str(),
+                  error.c_str());
+    }
+  }
+  std::printf("  %u/%zu rule switches detected and checked\n", passed, rules.size());
+  ok &= passed == rules.size();
+
+  std::printf("\nThroughput\n");
+  kernelThroughput();
+  ChecksumRule modbus;
+  modbus.algorithm = CHECKSUM_CRC16_MODBUS;
+  std::printf("  engine, detecting              %6.2f ns/byte\n", engineThroughput(ChecksumRule()));
+  std::printf("  engine, locked (CRC16_MODBUS)  %6.2f ns/byte\n", engineThroughput(modbus));
+  std::printf("  budget, 2 channels at %u baud: %.0f ns/byte\n", LINE_BAUD, 1e9 / (2 * LINE_BAUD / 10.0));
+
+  std::printf("\n%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
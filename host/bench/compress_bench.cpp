@@ -0,0 +1,545 @@
+/*
+ * compress_bench - Block compression ratio, cost and damage recovery
+ *
+ * Synthesizes three kinds of traffic as the firmware logs them (delta
+ * records stamped in 600 MHz cycles with a little interrupt jitter, packet
+ * records around every packet):
+ *
+ *   modbus   RTU master polling four slaves at 19200 baud, ten holding
+ *            registers each, values drifting slowly, CRC-16 on every frame
+ *   nmea     GPS receiver at 9600 baud, a burst of six sentences per second
+ *            with the clock and position advancing
+ *   random   continuous random bytes at 115200 baud (the incompressible case)
+ *
+ * For 1, 4 and 16 KB blocks it reports the compression ratio over the
+ * plain delta records, how much smaller the file is than the CSV log of
+ * the same bytes, compress and decompress speed and the time per block.
+ * Then it writes each profile with 4 KB blocks (the firmware's size) and
+ * checks that CaptureReader and CaptureMap return every record unchanged,
+ * that a file cut short anywhere loses only the block that was cut, and
+ * that a corrupted block is skipped with every later record still at its
+ * exact time.
+ *
+ * Usage: compress_bench [data_bytes] [directory]
+ *        default: 2000000 captured bytes per profile in /tmp/compress_bench
+ * Exits non-zero if any check fails.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "CaptureMap.h"
+#include "CsvFormat.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CPU_HZ = 600000000;
+const uint32_t JITTER_TICKS = 64;             // Stamp spread from interrupt latency
+const int CUT_POINTS = 40;                    // Truncations tried per profile
+
+static uint64_t charTicks(uint32_t baud) { return (uint64_t)CPU_HZ * 10 / baud; }
+
+// ==================== Synthetic Traffic ====================
+
+struct Record {
+  uint64_t ticks;
+  uint8_t kind;
+  uint8_t channel;
+  uint8_t value;
+  uint8_t status;
+  uint64_t argument;
+};
+
+struct Traffic {
+  const char* name;
+  uint32_t baud;
+  std::vector<Record> records;
+  uint64_t dataBytes = 0;
+};
+
+/**
+ * Append one packet as the firmware logs it: PACKET_START, the bytes
+ * back to back, PACKET_END with the checksum verdict
+ * @return Time of the line going idle after the packet
+ */
+static uint64_t addPacket(Traffic& traffic, std::mt19937& rng, uint64_t t, uint8_t channel,
+                          const std::vector<uint8_t>& bytes, uint64_t number, uint8_t reason, uint8_t verdict) {
+  uint64_t character = charTicks(traffic.baud);
+  traffic.records.push_back({t, RECORD_KIND_PACKET_START, channel, 0, STATUS_OK, number});
+  for (size_t i = 0; i < bytes.size(); i++) {
+    if (i > 0) t += character;
+    traffic.records.push_back({t + rng() % JITTER_TICKS, RECORD_KIND_DATA, channel, bytes[i], STATUS_OK, 0});
+  }
+  uint64_t end = (reason == PACKET_END_IDLE) ? t + character * 7 / 2 : t + JITTER_TICKS;
+  traffic.records.push_back({end, RECORD_KIND_PACKET_END, channel, reason, verdict, bytes.size()});
+  traffic.dataBytes += bytes.size();
+  return end;
+}
+
+static void appendModbusCrc(std::vector<uint8_t>& frame) {
+  uint16_t crc = 0xFFFF;
+  for (uint8_t value : frame) crc = crc16ModbusUpdate(crc, value);
+  frame.push_back((uint8_t)crc);
+  frame.push_back((uint8_t)(crc >> 8));
+}
+
+/**
+ * Modbus RTU: read ten holding registers from slaves 1-4 in turn; the
+ * master is TX, the slaves RX. One response in a thousand is corrupted.
+ */
+static void generateModbus(Traffic& traffic, uint64_t dataBytes, uint32_t seed) {
+  std::mt19937 rng(seed);
+  uint16_t registers[4][10];
+  for (auto& slave : registers) {
+    for (uint16_t& value : slave) value = (uint16_t)(rng() % 4000);
+  }
+  uint64_t t = 0;
+  uint64_t number[2] = {0, 0};
+  for (uint32_t poll = 0; traffic.dataBytes < dataBytes; poll++) {
+    uint8_t slave = (uint8_t)(poll % 4);
+    std::vector<uint8_t> request = {(uint8_t)(slave + 1), 0x03, 0x00, 0x00, 0x00, 0x0A};
+    appendModbusCrc(request);
+    t = addPacket(traffic, rng, t, CHANNEL_TX, request, number[CHANNEL_TX]++, PACKET_END_IDLE,
+                  STATUS_CHECKSUM_VALID);
+
+    for (uint16_t& value : registers[slave]) {
+      if (rng() % 8 == 0) value = (uint16_t)(value + (int)(rng() % 3) - 1);
+    }
+    std::vector<uint8_t> response = {(uint8_t)(slave + 1), 0x03, 20};
+    for (uint16_t value : registers[slave]) {
+      response.push_back((uint8_t)(value >> 8));
+      response.push_back((uint8_t)value);
+    }
+    appendModbusCrc(response);
+    uint8_t verdict = STATUS_CHECKSUM_VALID;
+    if (rng() % 1000 == 0) {
+      response[3 + rng() % 20] ^= 0x10;
+      verdict = STATUS_CHECKSUM_ERROR;
+    }
+    t += (uint64_t)CPU_HZ / 1000 * (2 + rng() % 3);          // Slave turnaround 2-4 ms
+    t = addPacket(traffic, rng, t, CHANNEL_RX, response, number[CHANNEL_RX]++, PACKET_END_IDLE, verdict);
+    t += (uint64_t)CPU_HZ / 1000 * 20;                        // Next poll 20 ms later
+  }
+}
+
+static void appendNmea(std::vector<std::vector<uint8_t>>& burst, const char* body) {
+  uint8_t sum = 0;
+  for (const char* at = body; *at; at++) sum ^= (uint8_t)*at;
+  char line[128];
+  std::snprintf(line, sizeof(line), "$%s*%02X\r\n", body, sum);
+  burst.push_back(std::vector<uint8_t>(line, line + std::strlen(line)));
+}
+
+/**
+ * NMEA 0183: GGA, RMC, GSA, two GSV and VTG once a second, each sentence
+ * a packet ended by its line feed
+ */
+static void generateNmea(Traffic& traffic, uint64_t dataBytes, uint32_t seed) {
+  std::mt19937 rng(seed);
+  uint64_t number = 0;
+  double latitude = 4807.038;
+  double longitude = 1131.000;
+  for (uint32_t second = 0; traffic.dataBytes < dataBytes; second++) {
+    uint32_t clock = 120000 + second;
+    uint32_t hms = (clock / 3600 % 24) * 10000 + (clock / 60 % 60) * 100 + clock % 60;
+    latitude += ((int)(rng() % 21) - 10) / 10000.0;
+    longitude += ((int)(rng() % 21) - 10) / 10000.0;
+    char body[112];
+    std::vector<std::vector<uint8_t>> burst;
+    std::snprintf(body, sizeof(body), "GPGGA,%06u.00,%09.4f,N,%010.4f,E,1,08,0.9,545.%u,M,46.9,M,,", hms, latitude,
+                  longitude, (unsigned)(rng() % 10));
+    appendNmea(burst, body);
+    std::snprintf(body, sizeof(body), "GPRMC,%06u.00,A,%09.4f,N,%010.4f,E,0.%03u,084.4,230394,003.1,W", hms,
+                  latitude, longitude, (unsigned)(rng() % 1000));
+    appendNmea(burst, body);
+    appendNmea(burst, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+    std::snprintf(body, sizeof(body), "GPGSV,2,1,08,01,40,083,%02u,02,17,308,%02u,12,07,344,39,14,22,228,45",
+                  (unsigned)(40 + rng() % 8), (unsigned)(38 + rng() % 8));
+    appendNmea(burst, body);
+    std::snprintf(body, sizeof(body), "GPGSV,2,2,08,15,35,076,%02u,17,62,311,44,24,34,145,36,25,11,044,38",
+                  (unsigned)(30 + rng() % 8));
+    appendNmea(burst, body);
+    std::snprintf(body, sizeof(body), "GPVTG,084.4,T,087.5,M,0.%03u,N,0.%03u,K", (unsigned)(rng() % 1000),
+                  (unsigned)(rng() % 1000));
+    appendNmea(burst, body);
+
+    uint64_t at = (uint64_t)second * CPU_HZ;
+    for (const std::vector<uint8_t>& sentence : burst) {
+      at = addPacket(traffic, rng, at, CHANNEL_RX, sentence, number++, PACKET_END_DELIMITER, STATUS_CHECKSUM_VALID);
+      at += charTicks(traffic.baud);
+    }
+  }
+}
+
+/**
+ * Random bytes back to back, no framing
+ */
+static void generateRandom(Traffic& traffic, uint64_t dataBytes, uint32_t seed) {
+  std::mt19937 rng(seed);
+  uint64_t character = charTicks(traffic.baud);
+  for (uint64_t i = 0; i < dataBytes; i++) {
+    traffic.records.push_back({i * character + rng() % JITTER_TICKS, RECORD_KIND_DATA, CHANNEL_RX, (uint8_t)rng(),
+                               STATUS_OK, 0});
+  }
+  traffic.dataBytes = dataBytes;
+}
+
+// ==================== Encoding ====================
+
+/**
+ * Delta records of the traffic, and where each record starts
+ */
+static std::vector<uint8_t> encodeRecords(const Traffic& traffic, std::vector<uint32_t>& lengths) {
+  std::vector<uint8_t> bytes;
+  bytes.reserve(traffic.records.size() * 4);
+  lengths.clear();
+  lengths.reserve(traffic.records.size());
+  uint8_t record[MAX_EVENT_RECORD_SIZE];
+  uint64_t previous = 0;
+  for (const Record& r : traffic.records) {
+    uint64_t delta = r.ticks - previous;
+    previous = r.ticks;
+    uint32_t length = (r.kind == RECORD_KIND_DATA)
+                          ? encodeDeltaRecord(record, delta, r.kind, r.channel, r.value, r.status)
+                          : encodeEventRecord(record, delta, r.kind, r.channel, r.value, r.status, r.argument);
+    bytes.insert(bytes.end(), record, record + length);
+    lengths.push_back(length);
+  }
+  return bytes;
+}
+
+static uint64_t csvBytes(const Traffic& traffic) {
+  std::FILE* out = std::tmpfile();
+  if (!out) return 0;
+  std::fprintf(out, "%s\n", CSV_HEADER);
+  for (const Record& r : traffic.records) {
+    if (r.kind != RECORD_KIND_DATA) continue;
+    CaptureEvent event = {ticksToNs(r.ticks, CPU_HZ), r.ticks, r.kind, r.channel, r.value, r.status, 0};
+    writeCsvLine(out, event);
+  }
+  uint64_t size = (uint64_t)std::ftell(out);
+  std::fclose(out);
+  return size;
+}
+
+struct VectorWriter {
+  std::vector<uint8_t>* out;
+  uint32_t append(const void* data, uint32_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    out->insert(out->end(), bytes, bytes + length);
+    return length;
+  }
+};
+
+/**
+ * Where a block landed: its file offset and its first record
+ */
+struct BlockSpan {
+  size_t offset;
+  size_t firstRecord;
+};
+
+struct CompressResult {
+  std::vector<uint8_t> file;        // Blocks only, no capture header
+  std::vector<BlockSpan> blocks;
+  BlockCompressorStats stats;
+  double seconds = 0;
+};
+
+/**
+ * Run the records through a BlockCompressor the way CaptureEngine does:
+ * seal when the next record does not fit, then drain into the file
+ */
+template <uint32_t RawBytes>
+static void compress(const Traffic& traffic, const std::vector<uint8_t>& records,
+                     const std::vector<uint32_t>& lengths, CompressResult& result) {
+  static BlockCompressor<RawBytes> blocks;
+  blocks.reset();
+  blocks.clearStats();
+  result.file.clear();
+  result.file.reserve(records.size() + records.size() / 8);
+  result.blocks.clear();
+  VectorWriter writer = {&result.file};
+
+  auto seal = [&]() {
+    blocks.seal(nullptr);
+    blocks.drain(writer);
+  };
+  auto begin = std::chrono::steady_clock::now();
+  size_t at = 0;
+  uint64_t previous = 0;
+  for (size_t i = 0; i < lengths.size(); i++) {
+    if (blocks.room() < lengths[i]) seal();
+    if (blocks.used() == 0) result.blocks.push_back({result.file.size(), i});
+    blocks.append(&records[at], lengths[i], previous, 0);
+    previous = traffic.records[i].ticks;
+    at += lengths[i];
+  }
+  seal();
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  result.stats = blocks.stats();
+}
+
+/**
+ * Unpack every block; false if one fails
+ */
+static bool decompressAll(const std::vector<uint8_t>& file, double& seconds, uint64_t& rawBytes) {
+  std::vector<uint8_t> raw(MAX_BLOCK_RAW_BYTES);
+  CaptureBlockHeader header;
+  rawBytes = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t at = 0; at < file.size();) {
+    uint32_t used = unpackCaptureBlock(file.data() + at, file.size() - at, header, raw.data());
+    if (used == 0) return false;
+    rawBytes += header.rawBytes;
+    at += used;
+  }
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  return true;
+}
+
+static bool writeCapture(const std::string& path, const Traffic& traffic, const uint8_t* blocks, size_t size) {
+  std::FILE* out = std::fopen(path.c_str(), "wb");
+  if (!out) return false;
+  CaptureFileHeader header;
+  initCaptureHeader(header, traffic.baud, 0, "compress_bench", CPU_HZ);
+  header.recordFormat = RECORD_FORMAT_BLOCKS;
+  bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1 && std::fwrite(blocks, 1, size, out) == size;
+  return std::fclose(out) == 0 && ok;
+}
+
+// ==================== Checks ====================
+
+static bool same(const Record& r, const CaptureEvent& event) {
+  return event.ticks == r.ticks && event.kind == r.kind && event.channel == r.channel && event.value == r.value &&
+         event.status == r.status && event.argument == r.argument;
+}
+
+/**
+ * Read a capture with CaptureReader and compare it with the records it
+ * should hold (in order)
+ * @param expected Indices into traffic.records
+ */
+static bool readMatches(const std::string& path, const Traffic& traffic, const std::vector<size_t>& expected,
+                        uint64_t expectedDamaged, std::string& why) {
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    why = reader.error();
+    return false;
+  }
+  CaptureEvent event;
+  size_t n = 0;
+  while (reader.next(event)) {
+    if (n >= expected.size()) {
+      why = "extra record " + std::to_string(n);
+      return false;
+    }
+    if (!same(traffic.records[expected[n]], event)) {
+      why = "record " + std::to_string(expected[n]) + " differs";
+      return false;
+    }
+    n++;
+  }
+  if (n != expected.size()) {
+    why = std::to_string(n) + " of " + std::to_string(expected.size()) + " records";
+    return false;
+  }
+  if (reader.damagedBlocks() != expectedDamaged) {
+    why = std::to_string(reader.damagedBlocks()) + " damaged blocks, expected " + std::to_string(expectedDamaged);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * The same through CaptureMap's column reader (whole file, one cursor)
+ */
+static bool mapMatches(const std::string& path, const Traffic& traffic, const std::vector<size_t>& expected,
+                       uint64_t expectedDamaged, std::string& why) {
+  CaptureMap map;
+  if (!map.open(path)) {
+    why = map.error();
+    return false;
+  }
+  CaptureColumns columns;
+  columns.allocate(4096);
+  CaptureCursor cursor = map.cursor(map.all());
+  size_t n = 0;
+  while (cursor.read(columns) > 0) {
+    for (size_t i = 0; i < columns.count; i++, n++) {
+      if (n >= expected.size()) {
+        why = "extra record " + std::to_string(n);
+        return false;
+      }
+      const Record& r = traffic.records[expected[n]];
+      if (columns.timestampNs[i] != ticksToNs(r.ticks, CPU_HZ) || columns.kind[i] != r.kind ||
+          columns.channel[i] != r.channel || columns.value[i] != r.value || columns.status[i] != r.status ||
+          columns.argument[i] != r.argument) {
+        why = "record " + std::to_string(expected[n]) + " differs";
+        return false;
+      }
+    }
+  }
+  if (n != expected.size()) {
+    why = std::to_string(n) + " of " + std::to_string(expected.size()) + " records";
+    return false;
+  }
+  if (cursor.damagedBlocks() != expectedDamaged) {
+    why = std::to_string(cursor.damagedBlocks()) + " damaged blocks, expected " + std::to_string(expectedDamaged);
+    return false;
+  }
+  return true;
+}
+
+static bool bothMatch(const std::string& path, const Traffic& traffic, const std::vector<size_t>& expected,
+                      uint64_t expectedDamaged, const char* what) {
+  std::string why;
+  if (!readMatches(path, traffic, expected, expectedDamaged, why)) {
+    std::printf("  %s: CaptureReader: %s\n", what, why.c_str());
+    return false;
+  }
+  if (!mapMatches(path, traffic, expected, expectedDamaged, why)) {
+    std::printf("  %s: CaptureMap: %s\n", what, why.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Round trip, truncation and corruption checks on one profile (4 KB blocks)
+ */
+static bool checkProfile(const Traffic& traffic, const CompressResult& result, const std::string& directory,
+                         uint32_t seed) {
+  std::string path = directory + "/" + traffic.name + ".ssb";
+  const std::vector<uint8_t>& file = result.file;
+  const std::vector<BlockSpan>& blocks = result.blocks;
+  size_t total = traffic.records.size();
+
+  std::vector<size_t> everything(total);
+  for (size_t i = 0; i < total; i++) everything[i] = i;
+  if (!writeCapture(path, traffic, file.data(), file.size()) || !bothMatch(path, traffic, everything, 0, "whole")) {
+    return false;
+  }
+
+  // Cut short: every block before the cut survives, the cut one is lost
+  std::mt19937 rng(seed);
+  std::string cutPath = directory + "/" + traffic.name + "_cut.ssb";
+  for (int i = 0; i < CUT_POINTS; i++) {
+    size_t cut = 1 + rng() % (file.size() - 1);
+    // Blocks that end by the cut survive; one the cut falls inside is damaged
+    size_t kept = 0;
+    while (kept < blocks.size()) {
+      size_t end = (kept + 1 < blocks.size()) ? blocks[kept + 1].offset : file.size();
+      if (end > cut) break;
+      kept++;
+    }
+    uint64_t damaged = (kept < blocks.size() && blocks[kept].offset < cut) ? 1 : 0;
+    size_t records = kept < blocks.size() ? blocks[kept].firstRecord : total;
+    std::vector<size_t> expected(everything.begin(), everything.begin() + records);
+    if (!writeCapture(cutPath, traffic, file.data(), cut) ||
+        !bothMatch(cutPath, traffic, expected, damaged, ("cut at " + std::to_string(cut)).c_str())) {
+      return false;
+    }
+  }
+
+  // One corrupted block in the middle: only its records are lost
+  if (blocks.size() >= 3) {
+    size_t victim = blocks.size() / 2;
+    std::vector<uint8_t> damaged(file);
+    size_t payload = blocks[victim].offset + sizeof(CaptureBlockHeader);
+    damaged[payload + (blocks[victim + 1].offset - payload) / 2] ^= 0x5A;
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < total; i++) {
+      if (i < blocks[victim].firstRecord || i >= blocks[victim + 1].firstRecord) expected.push_back(i);
+    }
+    std::string badPath = directory + "/" + traffic.name + "_bad.ssb";
+    if (!writeCapture(badPath, traffic, damaged.data(), damaged.size()) ||
+        !bothMatch(badPath, traffic, expected, 1, "corrupt payload")) {
+      return false;
+    }
+    // A damaged header is found the same way, by scanning for the next magic
+    damaged = file;
+    damaged[blocks[victim].offset + 9] ^= 0x01;
+    if (!writeCapture(badPath, traffic, damaged.data(), damaged.size()) ||
+        !bothMatch(badPath, traffic, expected, 1, "corrupt header")) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ==================== Runs ====================
+
+int main(int argc, char** argv) {
+  uint64_t dataBytes = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000ULL;
+  std::string directory = (argc > 2) ? argv[2] : "/tmp/compress_bench";
+  mkdir(directory.c_str(), 0755);
+
+  Traffic profiles[3];
+  profiles[0].name = "modbus";
+  profiles[0].baud = 19200;
+  generateModbus(profiles[0], dataBytes, 1);
+  profiles[1].name = "nmea";
+  profiles[1].baud = 9600;
+  generateNmea(profiles[1], dataBytes, 2);
+  profiles[2].name = "random";
+  profiles[2].baud = 115200;
+  generateRandom(profiles[2], dataBytes, 3);
+
+  std::printf("Block compression: %llu captured bytes per profile\n\n", (unsigned long long)dataBytes);
+  std::printf("%-8s %6s %10s %9s %7s %9s %11s %9s %11s\n", "profile", "block", "records", "B/byte", "ratio",
+              "vs CSV", "comp MB/s", "us/block", "decomp MB/s");
+
+  bool ok = true;
+  for (Traffic& traffic : profiles) {
+    std::vector<uint32_t> lengths;
+    std::vector<uint8_t> records = encodeRecords(traffic, lengths);
+    uint64_t csv = csvBytes(traffic);
+    CompressResult checked;
+
+    for (uint32_t blockBytes : {1024u, 4096u, 16384u}) {
+      CompressResult result;
+      if (blockBytes == 1024) compress<1024>(traffic, records, lengths, result);
+      else if (blockBytes == 4096) compress<4096>(traffic, records, lengths, result);
+      else compress<16384>(traffic, records, lengths, result);
+
+      double decompressSeconds = 0;
+      uint64_t rawBytes = 0;
+      if (!decompressAll(result.file, decompressSeconds, rawBytes) || rawBytes != records.size()) {
+        std::printf("%-8s %6u  blocks do not decompress\n", traffic.name, blockBytes);
+        ok = false;
+        continue;
+      }
+      double megabytes = records.size() / 1e6;
+      std::printf("%-8s %5uK %10zu %9.2f %7.2f %8.1fx %11.0f %9.2f %11.0f\n", traffic.name, blockBytes / 1024,
+                  traffic.records.size(), (double)result.file.size() / traffic.dataBytes,
+                  (double)records.size() / result.file.size(), (double)csv / result.file.size(),
+                  megabytes / result.seconds, result.seconds * 1e6 / result.stats.blocks,
+                  megabytes / decompressSeconds);
+      if (blockBytes == 4096) checked = std::move(result);
+    }
+    std::printf("%-8s  delta records %.2f B/byte, CSV %.2f B/byte, %llu of %llu blocks stored\n", "",
+                (double)records.size() / traffic.dataBytes, (double)csv / traffic.dataBytes,
+                (unsigned long long)checked.stats.storedBlocks, (unsigned long long)checked.stats.blocks);
+
+    if (!checkProfile(traffic, checked, directory, 7)) {
+      std::printf("%-8s  FAIL\n", traffic.name);
+      ok = false;
+    }
+  }
+
+  std::printf("\nRound trip, %d truncations and 2 corrupted blocks per profile: %s\n", CUT_POINTS,
+              ok ? "all records as written" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,417 @@
+/*
+ * format_bench - CSV and hex dump export formatter correctness and speed
+ *
+ * Known answers: the CsvExporter output of every kernel this CPU runs
+ * must equal writeCsvLine() (one fprintf() per byte, what ss_convert used
+ * to do) byte for byte, over edge-case timestamps (0, powers of ten
+ * around the 8- and 16-digit vector steps, UINT64_MAX), random 64-bit
+ * timestamps, and every value and status. HexDumper output of a single
+ * stream must equal a printf() reference laid out like hexdump -C -v,
+ * for lengths 0 to 100 and a stream crossing the 4 GiB offset width
+ * change; with four interleaved channels every kernel must equal the
+ * scalar one.
+ *
+ * Throughput: synthetic two-channel traffic (timestamps about an hour
+ * into a capture, text-like and binary bytes, 1% with error flags)
+ * formatted to /dev/null with the fprintf() reference and each kernel;
+ * reports records or bytes per second, output MB/s and the speedup over
+ * the scalar kernel and over fprintf().
+ *
+ * Exits non-zero if any output differs.
+ *
+ * Usage: format_bench [million_records]
+ *        default: 4 million records (the dump formats 16x as many bytes)
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CsvFormat.h"
+#include "HexFormat.h"
+
+// ==================== Model Parameters ====================
+
+const uint64_t START_NS = 3600ULL * 1000000000ULL;   // An hour into the capture
+const uint32_t MIN_GAP_NS = 4000;                    // 2 Mbaud bursts to 115200 baud gaps
+const uint32_t MAX_GAP_NS = 90000;
+const double ERROR_RATE = 0.01;
+const uint32_t DUMP_CHANNELS = 4;
+
+// ==================== Synthetic Traffic ====================
+
+static std::vector<CaptureEvent> makeRecords(size_t count, uint32_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<uint32_t> gap(MIN_GAP_NS, MAX_GAP_NS);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<CaptureEvent> records(count);
+  uint64_t ns = START_NS;
+  for (CaptureEvent& record : records) {
+    ns += gap(rng);
+    record.timestampNs = ns;
+    record.kind = RECORD_KIND_DATA;
+    record.channel = (uint8_t)(rng() & 1);
+    // Half text, half binary
+    record.value = (rng() & 1) ? (uint8_t)(32 + rng() % 95) : (uint8_t)rng();
+    record.status = unit(rng) < ERROR_RATE ? (uint8_t)(1u << (rng() % 5)) : (uint8_t)STATUS_OK;
+  }
+  return records;
+}
+
+/**
+ * Timestamps around every digit count and both vector step limits,
+ * random 64-bit ones, and every value and status
+ */
+static std::vector<CaptureEvent> makeEdgeRecords() {
+  std::vector<uint64_t> stamps = {0, UINT64_MAX, UINT64_MAX - 1};
+  uint64_t power = 1;
+  for (int digits = 1; digits <= 19; digits++) {
+    power *= 10;
+    stamps.push_back(power - 1);
+    stamps.push_back(power);
+    stamps.push_back(power + 1);
+  }
+  std::mt19937_64 rng(7);
+  for (int i = 0; i < 100000; i++) stamps.push_back(rng() >> (rng() % 64));
+
+  std::vector<CaptureEvent> records;
+  for (size_t i = 0; i < stamps.size(); i++) {
+    CaptureEvent record;
+    record.timestampNs = stamps[i];
+    record.kind = RECORD_KIND_DATA;
+    record.channel = (uint8_t)(i % 10);            // Channel ids past the named ones too
+    record.value = (uint8_t)i;
+    record.status = (uint8_t)(i / 256);
+    records.push_back(record);
+  }
+  return records;
+}
+
+// ==================== Formatting ====================
+
+/**
+ * FILE* collecting into a string (open_memstream)
+ */
+class StringFile {
+ public:
+  StringFile() { file_ = open_memstream(&data_, &size_); }
+  ~StringFile() {
+    if (file_) std::fclose(file_);
+    std::free(data_);
+  }
+  std::FILE* file() { return file_; }
+  std::string text() {
+    std::fflush(file_);
+    return std::string(data_, size_);
+  }
+
+ private:
+  std::FILE* file_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+static void csvReference(std::FILE* out, const std::vector<CaptureEvent>& records) {
+  for (const CaptureEvent& record : records) writeCsvLine(out, record);
+}
+
+/**
+ * @return Bytes of text
+ */
+static uint64_t csvKernel(std::FILE* out, const std::vector<CaptureEvent>& records, FormatKernel kernel) {
+  TextOutput output(out);
+  CsvExporter csv(output, kernel);
+  for (const CaptureEvent& record : records) {
+    csv.add(record.timestampNs, record.channel, record.value, record.status);
+  }
+  csv.flush();
+  output.flush();
+  return output.bytesWritten();
+}
+
+/**
+ * hexdump -C -v layout, one printf() per field
+ */
+static void dumpReference(std::FILE* out, const std::vector<uint8_t>& bytes, uint64_t firstOffset) {
+  for (size_t row = 0; row < bytes.size(); row += 16) {
+    std::fprintf(out, "%08llx  ", (unsigned long long)(firstOffset + row));
+    for (size_t i = 0; i < 16; i++) {
+      if (row + i < bytes.size()) std::fprintf(out, "%02x ", bytes[row + i]);
+      else std::fprintf(out, "   ");
+      if (i == 7) std::fprintf(out, " ");
+    }
+    std::fprintf(out, " |");
+    for (size_t i = row; i < row + 16 && i < bytes.size(); i++) std::fputc(asciiOrDot(bytes[i]), out);
+    std::fprintf(out, "|\n");
+  }
+  if (!bytes.empty()) std::fprintf(out, "%08llx\n", (unsigned long long)(firstOffset + bytes.size()));
+}
+
+/**
+ * Dump of bytes spread over channels (byte i on channel i % channels),
+ * added one at a time; one channel's bytes are added as one run
+ * @return Bytes of text
+ */
+static uint64_t dumpKernel(std::FILE* out, const std::vector<uint8_t>& bytes, uint32_t channels,
+                           FormatKernel kernel, bool run = false) {
+  TextOutput output(out);
+  HexDumper dump(output, channels > 1, kernel);
+  if (run) {
+    dump.add(0, bytes.data(), bytes.size());
+  } else {
+    uint8_t channel = 0;
+    for (uint8_t value : bytes) {
+      dump.add(channel, value);
+      if (++channel == channels) channel = 0;
+    }
+  }
+  dump.finish();
+  output.flush();
+  return output.bytesWritten();
+}
+
+// ==================== Known Answers ====================
+
+static std::vector<FormatKernel> supportedKernels() {
+  std::vector<FormatKernel> kernels;
+  for (uint8_t i = 0; i < FORMAT_KERNEL_COUNT; i++) {
+    if (formatKernelSupported((FormatKernel)i)) kernels.push_back((FormatKernel)i);
+  }
+  return kernels;
+}
+
+static bool reportMatch(const char* what, FormatKernel kernel, const std::string& got, const std::string& want) {
+  if (got == want) return true;
+  size_t at = 0;
+  while (at < got.size() && at < want.size() && got[at] == want[at]) at++;
+  size_t line = want.rfind('\n', at);
+  line = line == std::string::npos ? 0 : line + 1;
+  std::printf("  %-8s %-24s FAIL at byte %zu:\n    got  %.100s\n    want %.100s\n", formatKernelName(kernel),
+              what, at, got.c_str() + (line < got.size() ? line : got.size()), want.c_str() + line);
+  return false;
+}
+
+static bool checkCsv(const std::vector<FormatKernel>& kernels) {
+  std::vector<CaptureEvent> records = makeEdgeRecords();
+  std::vector<CaptureEvent> traffic = makeRecords(100000, 11);
+  records.insert(records.end(), traffic.begin(), traffic.end());
+  StringFile reference;
+  csvReference(reference.file(), records);
+  std::string want = reference.text();
+
+  bool ok = true;
+  for (FormatKernel kernel : kernels) {
+    // Every batch remainder: lengths just past multiples of the batch
+    for (size_t cut : {records.size(), records.size() - 1, (size_t)33, (size_t)31, (size_t)1}) {
+      std::vector<CaptureEvent> part(records.begin(), records.begin() + cut);
+      StringFile got;
+      csvKernel(got.file(), part, kernel);
+      StringFile partReference;
+      csvReference(partReference.file(), part);
+      ok &= reportMatch("csv", kernel, got.text(), cut == records.size() ? want : partReference.text());
+    }
+  }
+  std::printf("  csv       %zu records (edge, random 64-bit and synthetic): %s\n", records.size(),
+              ok ? "identical to writeCsvLine()" : "MISMATCH");
+  return ok;
+}
+
+/**
+ * A stream whose offsets cross 4 GiB, where the offset column widens:
+ * a short prefix dumped from an offset just below it
+ */
+static bool checkWideOffsets(const std::vector<FormatKernel>& kernels) {
+  const uint64_t FIRST = 0xFFFFFF00ULL;
+  std::vector<uint8_t> bytes(512);
+  for (size_t i = 0; i < bytes.size(); i++) bytes[i] = (uint8_t)(i * 37);
+  StringFile reference;
+  for (size_t row = 0; row < bytes.size(); row += 16) {
+    std::fprintf(reference.file(), "%08llx  ", (unsigned long long)(FIRST + row));
+    for (size_t i = 0; i < 16; i++) std::fprintf(reference.file(), i == 7 ? "%02x  " : "%02x ", bytes[row + i]);
+    std::fprintf(reference.file(), " |");
+    for (size_t i = row; i < row + 16; i++) std::fputc(asciiOrDot(bytes[i]), reference.file());
+    std::fprintf(reference.file(), "|\n");
+  }
+  std::string want = reference.text();
+
+  bool ok = true;
+  for (FormatKernel kernel : kernels) {
+    StringFile got;
+    {
+      TextOutput output(got.file());
+      DumpBatch batch;
+      std::memset(&batch, 0, sizeof(batch));
+      DumpPrefixes prefixes;
+      std::memset(&prefixes, ' ', sizeof(prefixes));
+      prefixes.length = 0;
+      for (size_t row = 0; row < bytes.size(); row += 16) {
+        std::memcpy(batch.data[batch.count], &bytes[row], 16);
+        batch.offset[batch.count] = FIRST + row;
+        batch.count++;
+        if (batch.count == DumpBatch::SIZE || row + 16 == bytes.size()) {
+          char* p = output.reserve(batch.count * DUMP_ROW_ROOM);
+          switch (kernel) {
+#if HEXFORMAT_X86
+            case FORMAT_AVX2: p = formatDumpAvx2(p, batch, prefixes); break;
+            case FORMAT_SSSE3: p = formatDumpSsse3(p, batch, prefixes); break;
+#endif
+            default: p = formatDumpScalar(p, batch, prefixes); break;
+          }
+          output.commit(p);
+          batch.count = 0;
+        }
+      }
+    }
+    ok &= reportMatch("dump past 4 GiB", kernel, got.text(), want);
+  }
+  return ok;
+}
+
+static bool checkDump(const std::vector<FormatKernel>& kernels) {
+  std::mt19937 rng(13);
+  bool ok = true;
+  for (FormatKernel kernel : kernels) {
+    for (size_t length = 0; length <= 100; length++) {
+      std::vector<uint8_t> bytes(length);
+      for (uint8_t& value : bytes) value = (uint8_t)rng();
+      StringFile reference;
+      dumpReference(reference.file(), bytes, 0);
+      StringFile got;
+      dumpKernel(got.file(), bytes, 1, kernel);
+      ok &= reportMatch("dump", kernel, got.text(), reference.text());
+      StringFile run;
+      dumpKernel(run.file(), bytes, 1, kernel, true);
+      ok &= reportMatch("dump, one run", kernel, run.text(), reference.text());
+    }
+  }
+  std::vector<uint8_t> bytes(1 << 20);
+  for (size_t i = 0; i < bytes.size(); i++) bytes[i] = (uint8_t)(i < 256 ? i : rng());
+  for (FormatKernel kernel : kernels) {
+    StringFile reference;
+    dumpReference(reference.file(), bytes, 0);
+    StringFile got;
+    dumpKernel(got.file(), bytes, 1, kernel);
+    ok &= reportMatch("dump 1 MB", kernel, got.text(), reference.text());
+  }
+  ok &= checkWideOffsets(kernels);
+
+  std::vector<uint8_t> mixed(bytes.begin(), bytes.begin() + 100003);
+  StringFile scalar;
+  dumpKernel(scalar.file(), mixed, DUMP_CHANNELS, FORMAT_SCALAR);
+  std::string want = scalar.text();
+  for (FormatKernel kernel : kernels) {
+    StringFile got;
+    dumpKernel(got.file(), mixed, DUMP_CHANNELS, kernel);
+    ok &= reportMatch("dump 4 channels", kernel, got.text(), want);
+  }
+  std::printf("  hex dump  lengths 0-100, 1 MB, offsets past 4 GiB, %u channels: %s\n", DUMP_CHANNELS,
+              ok ? "identical to the reference" : "MISMATCH");
+  return ok;
+}
+
+// ==================== Throughput ====================
+
+struct Timing {
+  double seconds;
+  uint64_t bytes;                 // Text written
+};
+
+/**
+ * Time fn(), which returns the bytes of text it wrote (0: as many as the
+ * run timed before, the same text)
+ */
+template <typename Fn>
+static Timing timeOutput(std::FILE* sink, uint64_t bytes, Fn&& fn) {
+  auto begin = std::chrono::steady_clock::now();
+  uint64_t written = fn();
+  std::fflush(sink);
+  auto end = std::chrono::steady_clock::now();
+  return {std::chrono::duration<double>(end - begin).count(), written ? written : bytes};
+}
+
+static void printTiming(const char* name, const Timing& timing, uint64_t items, const char* unit,
+                        double scalarSeconds, double referenceSeconds) {
+  std::printf("  %-16s %8.1f M%s/s %8.0f MB/s %8.2fx %8.2fx\n", name, items / timing.seconds / 1e6, unit,
+              timing.bytes / timing.seconds / 1e6, scalarSeconds / timing.seconds,
+              referenceSeconds / timing.seconds);
+}
+
+static void csvThroughput(std::FILE* sink, const std::vector<FormatKernel>& kernels, size_t count) {
+  std::vector<CaptureEvent> records = makeRecords(count, 1);
+  std::printf("\nCSV, %zu records     %14s %13s %9s %9s\n", count, "rate", "output", "/scalar", "/fprintf");
+  Timing scalar = timeOutput(sink, 0, [&] { return csvKernel(sink, records, FORMAT_SCALAR); });
+  Timing reference = timeOutput(sink, scalar.bytes, [&] {
+    csvReference(sink, records);
+    return (uint64_t)0;
+  });
+  printTiming("fprintf()", reference, count, "rec", scalar.seconds, reference.seconds);
+  for (FormatKernel kernel : kernels) {
+    Timing timing = kernel == FORMAT_SCALAR
+                        ? scalar
+                        : timeOutput(sink, 0, [&] { return csvKernel(sink, records, kernel); });
+    printTiming(formatKernelName(kernel), timing, count, "rec", scalar.seconds, reference.seconds);
+  }
+}
+
+static void dumpThroughput(std::FILE* sink, const std::vector<FormatKernel>& kernels, size_t count) {
+  std::vector<CaptureEvent> records = makeRecords(count, 2);
+  std::vector<uint8_t> bytes;
+  bytes.reserve(count);
+  for (const CaptureEvent& record : records) bytes.push_back(record.value);
+  std::printf("\nHex dump, %zu bytes  %14s %13s %9s %9s\n", count, "rate", "output", "/scalar", "/printf");
+  Timing scalar = timeOutput(sink, 0, [&] { return dumpKernel(sink, bytes, 1, FORMAT_SCALAR, true); });
+  Timing reference = timeOutput(sink, scalar.bytes, [&] {
+    dumpReference(sink, bytes, 0);
+    return (uint64_t)0;
+  });
+  printTiming("printf()", reference, count, "B", scalar.seconds, reference.seconds);
+  for (FormatKernel kernel : kernels) {
+    Timing timing = kernel == FORMAT_SCALAR
+                        ? scalar
+                        : timeOutput(sink, 0, [&] { return dumpKernel(sink, bytes, 1, kernel, true); });
+    printTiming(formatKernelName(kernel), timing, count, "B", scalar.seconds, reference.seconds);
+  }
+  // Bytes one at a time, as ss_convert adds them from records
+  for (uint32_t channels : {1u, DUMP_CHANNELS}) {
+    Timing timing = timeOutput(sink, 0, [&] { return dumpKernel(sink, bytes, channels, bestFormatKernel()); });
+    char name[32];
+    std::snprintf(name, sizeof(name), "%s, %u ch/byte", formatKernelName(bestFormatKernel()), channels);
+    printTiming(name, timing, count, "B", scalar.seconds, reference.seconds);
+  }
+}
+
+// ==================== Run ====================
+
+int main(int argc, char** argv) {
+  double millions = argc > 1 ? std::atof(argv[1]) : 4.0;
+  if (millions <= 0) {
+    std::fprintf(stderr, "Usage: %s [million_records]\n", argv[0]);
+    return 2;
+  }
+  size_t count = (size_t)(millions * 1e6);
+  std::vector<FormatKernel> kernels = supportedKernels();
+  std::printf("Kernels on this CPU:");
+  for (FormatKernel kernel : kernels) std::printf(" %s", formatKernelName(kernel));
+  std::printf(" (default %s)\n\nKnown answers\n", formatKernelName(bestFormatKernel()));
+
+  bool ok = checkCsv(kernels);
+  ok &= checkDump(kernels);
+
+  std::FILE* sink = std::fopen("/dev/null", "w");
+  if (!sink) {
+    std::fprintf(stderr, "format_bench: cannot open /dev/null\n");
+    return 1;
+  }
+  csvThroughput(sink, kernels, count);
+  dumpThroughput(sink, kernels, count * 16);
+  std::fclose(sink);
+
+  std::printf("\n%s\n", ok ? "All outputs match" : "MISMATCH");
+  return ok ? 0 : 1;
+}
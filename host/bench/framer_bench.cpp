@@ -0,0 +1,330 @@
+/*
+ * framer_bench - Packet framer correctness and cost benchmark
+ *
+ * Synthetic: 1, 2, 4 and 8 channels carry packets (random lengths, bytes
+ * spaced 1-2.5 character times apart, packets 4-40 character times apart)
+ * at 115200 baud and 2 Mbaud. The merged byte stream goes through
+ * PacketFramer the way CaptureEngine drives it (beforeByte / afterByte
+ * per byte, expire() at each pass's horizon), and the records are read
+ * back with PacketAssembler. Every generated packet must come back whole,
+ * with its start time, an IDLE end at last byte + idle time, and all
+ * records in time order. The same is checked with delimiter framing
+ * ('\n' ends a packet, gaps stay below the idle threshold) and with a
+ * maximum length. Reports framer cost per byte.
+ *
+ * Recorded: given a binary capture, re-frames its data bytes with the
+ * idle threshold at the header's baud rate and prints packet counts and
+ * length statistics per channel.
+ *
+ * Exits non-zero if any synthetic check fails.
+ *
+ * Usage: framer_bench [capture.ssb [idle_characters]]
+ *        default idle threshold: 3.5 character times
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CaptureReader.h"
+#include "PacketAssembler.h"
+#include "PacketFramer.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CPU_HZ = 600000000;
+const uint32_t PACKETS_PER_CHANNEL = 5000;
+const uint32_t MAX_PACKET_LENGTH = 256;
+const uint32_t PASS_BYTES = 300;                 // Bytes merged per engine pass
+const uint32_t CHANNEL_COUNTS[] = {1, 2, 4, 8};
+const uint32_t BAUDS[] = {115200, 2000000};
+const float IDLE_CHARACTERS = 3.5f;
+
+enum FramingMode { MODE_IDLE, MODE_DELIMITER, MODE_MAX_LENGTH };
+
+// ==================== Synthetic Source ====================
+
+struct Byte {
+  uint64_t ticks;
+  uint8_t channel;
+  uint8_t value;
+};
+
+struct Truth {
+  uint64_t startTicks;
+  uint64_t lastTicks;
+  std::vector<uint8_t> data;
+};
+
+/**
+ * Packets for one channel and the bytes that carry them
+ */
+static void generate(uint8_t channel, uint64_t charTicks, FramingMode mode, uint32_t seed,
+                     std::vector<Byte>& bytes, std::vector<Truth>& truth) {
+  std::mt19937 rng(seed);
+  uint64_t t = rng() % (40 * charTicks);
+  for (uint32_t p = 0; p < PACKETS_PER_CHANNEL; p++) {
+    Truth packet;
+    uint32_t length = 1 + rng() % MAX_PACKET_LENGTH;
+    packet.startTicks = t;
+    for (uint32_t i = 0; i < length; i++) {
+      uint8_t value = (uint8_t)(rng() % 250);
+      if (value == '\n') value = 'n';
+      if (mode == MODE_DELIMITER && i == length - 1) value = '\n';
+      packet.data.push_back(value);
+      bytes.push_back({t, channel, value});
+      packet.lastTicks = t;
+      if (i + 1 < length) t += charTicks + rng() % (charTicks * 3 / 2);   // 1-2.5 characters
+    }
+    truth.push_back(packet);
+
+    if (mode == MODE_DELIMITER) {
+      t += charTicks + rng() % (charTicks * 3 / 2);                        // Below the idle threshold
+    } else {
+      t += 4 * charTicks + rng() % (36 * charTicks);                       // 4-40 characters
+    }
+  }
+}
+
+// ==================== Run ====================
+
+struct RunResult {
+  uint64_t bytes = 0;
+  uint64_t packets = 0;
+  double nsPerByte = 0;
+  std::string error;
+};
+
+static RunResult run(uint32_t channelCount, uint32_t baud, FramingMode mode) {
+  RunResult result;
+  uint64_t charTicks = (uint64_t)CPU_HZ * 10 / baud;
+
+  std::vector<Byte> bytes;
+  std::vector<std::vector<Truth>> truth(channelCount);
+  for (uint32_t c = 0; c < channelCount; c++) {
+    generate((uint8_t)c, charTicks, mode, baud + c * 101 + mode, bytes, truth[c]);
+  }
+  std::stable_sort(bytes.begin(), bytes.end(),
+                   [](const Byte& a, const Byte& b) { return a.ticks < b.ticks; });
+
+  PacketFramerConfig config;
+  config.idleCharacters = (mode == MODE_IDLE) ? IDLE_CHARACTERS : 0;
+  if (mode == MODE_DELIMITER) config.addDelimiter('\n');
+  if (mode == MODE_MAX_LENGTH) {
+    config.idleCharacters = IDLE_CHARACTERS;
+    config.maxLength = MAX_PACKET_LENGTH / 2;
+  }
+  PacketFramer framer;
+  framer.begin(config);
+  framer.setCharacterTicks(charTicks);
+
+  // Engine order: framer records around each data record
+  std::vector<CaptureEvent> log;
+  log.reserve(bytes.size() * 2);
+  auto record = [&log](uint64_t ticks, uint8_t kind, uint8_t channel, uint8_t value,
+                       uint64_t argument) {
+    log.push_back({ticksToNs(ticks, CPU_HZ), ticks, kind, channel, value, STATUS_OK, argument});
+  };
+  auto sink = [&record](const FramerRecord& r) {
+    record(r.ticks, r.kind, r.channel, r.value, r.argument);
+  };
+
+  for (size_t pass = 0; pass < bytes.size(); pass += PASS_BYTES) {
+    size_t end = std::min(bytes.size(), pass + PASS_BYTES);
+    for (size_t i = pass; i < end; i++) {
+      const Byte& b = bytes[i];
+      framer.beforeByte(b.channel, b.ticks, sink);
+      record(b.ticks, RECORD_KIND_DATA, b.channel, b.value, 0);
+      framer.afterByte(b.channel, b.value, b.ticks, sink);
+    }
+    // Horizon: just before the next unmerged byte
+    uint64_t horizon = (end < bytes.size()) ? bytes[end].ticks - 1 : bytes.back().ticks + 1000 * charTicks;
+    framer.expire(horizon, sink);
+  }
+  framer.finish(sink);
+
+  // Time order, then packets against the generated ones
+  for (size_t i = 1; i < log.size(); i++) {
+    if (log[i].ticks < log[i - 1].ticks) {
+      result.error = "records out of time order";
+      return result;
+    }
+  }
+  PacketAssembler assembler;
+  std::vector<std::vector<CapturedPacket>> packets(channelCount);
+  CapturedPacket packet;
+  for (const CaptureEvent& event : log) {
+    if (assembler.add(event, packet)) packets[packet.channel].push_back(packet);
+  }
+  if (assembler.orphanBytes() > 0) {
+    result.error = "bytes outside packets";
+    return result;
+  }
+
+  uint64_t idleTicks = framer.idleTicks();
+  for (uint32_t c = 0; c < channelCount; c++) {
+    std::vector<CapturedPacket>& got = packets[c];
+    if (mode == MODE_MAX_LENGTH) {
+      // Truth packets split at maxLength; compare the concatenation
+      size_t index = 0;
+      for (const Truth& want : truth[c]) {
+        for (size_t offset = 0; offset < want.data.size(); offset += config.maxLength) {
+          if (index >= got.size()) {
+            result.error = "missing packets";
+            return result;
+          }
+          const CapturedPacket& p = got[index++];
+          size_t length = std::min<size_t>(config.maxLength, want.data.size() - offset);
+          uint8_t reason = length == config.maxLength ? PACKET_END_MAX_LENGTH : PACKET_END_IDLE;
+          if (!p.intact || p.data.size() != length || p.endReason != reason ||
+              !std::equal(p.data.begin(), p.data.end(), want.data.begin() + offset)) {
+            result.error = "wrong split packet";
+            return result;
+          }
+        }
+      }
+      if (index != got.size()) result.error = "extra packets";
+      result.packets += got.size();
+      continue;
+    }
+
+    if (got.size() != truth[c].size()) {
+      result.error = "channel " + std::to_string(c) + ": " + std::to_string(got.size()) +
+                     " packets, expected " + std::to_string(truth[c].size());
+      return result;
+    }
+    for (size_t i = 0; i < got.size(); i++) {
+      const CapturedPacket& p = got[i];
+      const Truth& want = truth[c][i];
+      // Idle ends are stamped at the deadline, delimiter ends on the delimiter
+      uint8_t reason = mode == MODE_DELIMITER ? PACKET_END_DELIMITER : PACKET_END_IDLE;
+      uint64_t endTicks = mode == MODE_DELIMITER ? want.lastTicks : want.lastTicks + idleTicks;
+      if (!p.intact || p.data != want.data || p.startTicks != want.startTicks || p.number != i ||
+          p.endReason != reason || p.endTicks != endTicks) {
+        result.error = "channel " + std::to_string(c) + " packet " + std::to_string(i) + " differs";
+        return result;
+      }
+    }
+    result.packets += got.size();
+  }
+
+  // Cost: framer calls alone, counting records
+  uint64_t records = 0;
+  auto count = [&records](const FramerRecord&) { records++; };
+  framer.begin(config);
+  framer.setCharacterTicks(charTicks);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t pass = 0; pass < bytes.size(); pass += PASS_BYTES) {
+    size_t end = std::min(bytes.size(), pass + PASS_BYTES);
+    for (size_t i = pass; i < end; i++) {
+      const Byte& b = bytes[i];
+      framer.beforeByte(b.channel, b.ticks, count);
+      framer.afterByte(b.channel, b.value, b.ticks, count);
+    }
+    if (end < bytes.size()) framer.expire(bytes[end].ticks - 1, count);
+  }
+  framer.finish(count);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (records != 2 * result.packets) result.error = "record count differs between runs";
+
+  result.bytes = bytes.size();
+  result.nsPerByte = seconds * 1e9 / bytes.size();
+  return result;
+}
+
+// ==================== Recorded Captures ====================
+
+static int reframe(const char* path, float idleCharacters) {
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    std::fprintf(stderr, "framer_bench: %s\n", reader.error().c_str());
+    return 1;
+  }
+  uint32_t baud = reader.header().baudRate;
+  if (baud == 0) {
+    std::fprintf(stderr, "framer_bench: capture has no baud rate\n");
+    return 1;
+  }
+
+  PacketFramerConfig config;
+  config.idleCharacters = idleCharacters;
+  PacketFramer framer;
+  framer.begin(config);
+  framer.setCharacterTicks((uint64_t)reader.timestampHz() * 10 / baud);
+
+  struct Stats {
+    uint64_t bytes = 0;
+    uint64_t packets = 0;
+    uint32_t shortest = UINT32_MAX;
+    uint32_t longest = 0;
+  } stats[MAX_CAPTURE_CHANNELS];
+  uint64_t firmwarePackets = 0;
+  auto sink = [&stats](const FramerRecord& r) {
+    if (r.kind != RECORD_KIND_PACKET_END) return;
+    Stats& s = stats[r.channel];
+    s.packets++;
+    s.shortest = std::min<uint32_t>(s.shortest, (uint32_t)r.argument);
+    s.longest = std::max<uint32_t>(s.longest, (uint32_t)r.argument);
+  };
+
+  CaptureEvent event;
+  while (reader.next(event)) {
+    if (event.kind == RECORD_KIND_PACKET_END) firmwarePackets++;
+    if (event.kind != RECORD_KIND_DATA) continue;
+    framer.beforeByte(event.channel, event.ticks, sink);
+    stats[event.channel & (MAX_CAPTURE_CHANNELS - 1)].bytes++;
+    framer.afterByte(event.channel, event.value, event.ticks, sink);
+  }
+  framer.finish(sink);
+
+  std::printf("%s: %u baud, idle threshold %.1f characters (%llu ticks)\n", path, baud,
+              idleCharacters, (unsigned long long)framer.idleTicks());
+  std::printf("%8s %12s %10s %10s %10s %10s\n", "channel", "bytes", "packets", "mean_len", "min_len",
+              "max_len");
+  for (uint32_t c = 0; c < MAX_CAPTURE_CHANNELS; c++) {
+    const Stats& s = stats[c];
+    if (s.bytes == 0) continue;
+    std::printf("%8s %12llu %10llu %10.1f %10u %10u\n", captureChannelName((uint8_t)c),
+                (unsigned long long)s.bytes, (unsigned long long)s.packets,
+                s.packets ? (double)s.bytes / s.packets : 0.0, s.packets ? s.shortest : 0, s.longest);
+  }
+  if (firmwarePackets > 0) {
+    std::printf("Packets framed by the firmware: %llu\n", (unsigned long long)firmwarePackets);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    float idle = (argc > 2) ? std::strtof(argv[2], nullptr) : IDLE_CHARACTERS;
+    return reframe(argv[1], idle);
+  }
+
+  std::printf("%u packets of 1-%u bytes per channel; idle threshold %.1f characters\n\n",
+              PACKETS_PER_CHANNEL, MAX_PACKET_LENGTH, IDLE_CHARACTERS);
+  std::printf("%-10s %8s %9s %12s %10s %8s  %s\n", "mode", "channels", "baud", "bytes", "packets",
+              "ns/byte", "result");
+
+  const char* MODE_NAMES[] = {"idle", "delimiter", "max_length"};
+  bool allOk = true;
+  for (int mode = MODE_IDLE; mode <= MODE_MAX_LENGTH; mode++) {
+    for (uint32_t baud : BAUDS) {
+      for (uint32_t channels : CHANNEL_COUNTS) {
+        RunResult result = run(channels, baud, (FramingMode)mode);
+        bool ok = result.error.empty();
+        std::printf("%-10s %8u %9u %12llu %10llu %8.2f  %s\n", MODE_NAMES[mode], channels, baud,
+                    (unsigned long long)result.bytes, (unsigned long long)result.packets,
+                    result.nsPerByte, ok ? "ok" : result.error.c_str());
+        allOk &= ok;
+      }
+    }
+  }
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+/*
+ * index_bench - Time index seeks against full scans
+ *
+ * Synthesizes a capture with bursts of traffic (about 400k records/s)
+ * and long quiet stretches, and writes it as delta records (binary.ssb)
+ * and firmware CSV lines (text.csv), each with the .ssi sidecar built
+ * the way CaptureEngine builds it (CaptureIndexer, one entry per 262144
+ * records or 1 s). Then, for both files:
+ *
+ *   - the sidecar must load and pass TimeIndex::check(), and so must an
+ *     index rebuilt from the capture (timed: a record walk for .ssb, one
+ *     line per entry for CSV)
+ *   - random windows of 1 ms, 100 ms and 10 s are read through the
+ *     index (CaptureMap::select) with the sidecar and the rebuilt index;
+ *     records, value sum and first/last time must match the generator
+ *   - the same windows are read by a full scan for comparison
+ *   - CaptureAnalyzer with a window must count the same records
+ *
+ * Reports the bytes decoded through the index and the time per window
+ * both ways (a scan decodes everything up to the window's end).
+ *
+ * Usage: index_bench [records] [directory]
+ *        default: 16000000 records in /tmp/index_bench
+ * Exits non-zero if any result differs.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CaptureAnalysis.h"
+#include "CaptureIndex.h"
+#include "TimeIndex.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CPU_HZ = 600000000;
+const uint32_t INDEX_INTERVAL_RECORDS = 262144;     // As the firmware defaults
+const uint32_t INDEX_INTERVAL_MS = 1000;
+const uint32_t INDEX_ENTRIES = 64;
+const uint64_t BURST_GAP_TICKS = CPU_HZ / 400000;    // ~400k records/s while busy
+const uint64_t WINDOWS_NS[] = {1000000ULL, 100000000ULL, 10000000000ULL};
+const uint32_t WINDOWS_PER_SIZE = 20;
+const uint32_t SCANS_PER_SIZE = 2;
+
+struct Record {
+  uint64_t ticks;
+  uint8_t channel;
+  uint8_t value;
+  uint8_t status;
+};
+
+// ==================== Synthetic Capture ====================
+
+static void generate(uint64_t count, std::vector<Record>& records) {
+  std::mt19937_64 rng(16);
+  records.reserve(count);
+  uint64_t t = 0;
+  while (records.size() < count) {
+    // A burst of 0.2-3 s, then 0-5 s with a record every ~0.5 s
+    uint64_t burstEnd = t + CPU_HZ / 5 + rng() % (CPU_HZ * 14 / 5);
+    while (t < burstEnd && records.size() < count) {
+      uint8_t status = (rng() % 50000 == 0) ? STATUS_FRAMING_ERROR : STATUS_OK;
+      records.push_back({t, (uint8_t)(rng() % 4), (uint8_t)rng(), status});
+      t += 1 + rng() % (2 * BURST_GAP_TICKS);
+    }
+    uint64_t quietEnd = t + rng() % (5ULL * CPU_HZ);
+    while (t < quietEnd && records.size() < count) {
+      records.push_back({t, (uint8_t)(rng() % 4), (uint8_t)rng(), STATUS_OK});
+      t += CPU_HZ / 4 + rng() % (CPU_HZ / 2);
+    }
+  }
+}
+
+static std::string csvLine(const Record& record) {
+  static const char* const STATUS[] = {"OK", "FRAMING_ERROR"};
+  char line[64];
+  char ascii = (record.value >= 32 && record.value <= 126) ? (char)record.value : '.';
+  int length = std::snprintf(line, sizeof(line), "%llu,%s,0x%02X,%c,%s\r\n",
+                             (unsigned long long)ticksToNs(record.ticks, CPU_HZ), captureChannelName(record.channel),
+                             record.value, ascii, STATUS[record.status == STATUS_FRAMING_ERROR]);
+  return std::string(line, length);
+}
+
+/**
+ * Write a capture and its sidecar as CaptureEngine does: due() before
+ * each record, entries flushed when the table is half full and at the end
+ */
+static bool writeCapture(const std::string& path, bool csv, const std::vector<Record>& records) {
+  std::FILE* out = std::fopen(path.c_str(), "wb");
+  std::FILE* sidecar = std::fopen(TimeIndex::sidecarPath(path).c_str(), "wb");
+  if (!out || !sidecar) return false;
+
+  std::vector<char> data;
+  data.reserve(64 * 1024 * 1024);
+  if (csv) {
+    static const char HEADER[] = "Timestamp,Direction,Value_Hex,Value_ASCII,Status\r\n";
+    data.insert(data.end(), HEADER, HEADER + sizeof(HEADER) - 1);
+  } else {
+    CaptureFileHeader header;
+    initCaptureHeader(header, 1000000, 0, "bench", CPU_HZ);
+    data.insert(data.end(), (const char*)&header, (const char*)&header + sizeof(header));
+  }
+  CaptureIndexHeader indexHeader;
+  initIndexHeader(indexHeader, csv ? INDEX_FILE_CSV : INDEX_FILE_BINARY, CPU_HZ, INDEX_INTERVAL_RECORDS,
+                  INDEX_INTERVAL_MS);
+  std::fwrite(&indexHeader, sizeof(indexHeader), 1, sidecar);
+
+  CaptureIndexer<INDEX_ENTRIES> indexer;
+  indexer.begin(INDEX_INTERVAL_RECORDS, (uint64_t)CPU_HZ * INDEX_INTERVAL_MS / 1000);
+  auto flushEntries = [&]() {
+    std::fwrite(indexer.entries(), sizeof(CaptureIndexEntry), indexer.pending(), sidecar);
+    indexer.clear();
+  };
+
+  uint64_t written = 0;
+  uint64_t last = 0;
+  for (const Record& record : records) {
+    uint64_t offset = written + data.size();
+    if (indexer.due(record.ticks)) indexer.add(last, offset, record.ticks);
+    if (indexer.halfFull()) flushEntries();
+    if (csv) {
+      std::string line = csvLine(record);
+      data.insert(data.end(), line.begin(), line.end());
+    } else {
+      uint8_t encoded[MAX_DELTA_RECORD_SIZE];
+      uint32_t length = encodeDeltaRecord(encoded, record.ticks - last, RECORD_KIND_DATA, record.channel,
+                                          record.value, record.status);
+      data.insert(data.end(), encoded, encoded + length);
+    }
+    last = record.ticks;
+    if (data.size() >= 60 * 1024 * 1024) {
+      std::fwrite(data.data(), 1, data.size(), out);
+      written += data.size();
+      data.clear();
+    }
+  }
+  flushEntries();
+  std::fwrite(data.data(), 1, data.size(), out);
+  bool ok = indexer.dropped() == 0;
+  ok &= std::fclose(out) == 0;
+  ok &= std::fclose(sidecar) == 0;
+  return ok;
+}
+
+// ==================== Windows ====================
+
+struct WindowSummary {
+  uint64_t records = 0;
+  uint64_t valueSum = 0;
+  uint64_t firstNs = 0;
+  uint64_t lastNs = 0;
+
+  bool operator==(const WindowSummary& other) const {
+    return records == other.records && valueSum == other.valueSum && firstNs == other.firstNs &&
+           lastNs == other.lastNs;
+  }
+};
+
+static WindowSummary truth(const std::vector<Record>& records, uint64_t startNs, uint64_t endNs) {
+  WindowSummary summary;
+  auto first = std::lower_bound(records.begin(), records.end(), startNs, [](const Record& r, uint64_t ns) {
+    return ticksToNs(r.ticks, CPU_HZ) < ns;
+  });
+  for (auto it = first; it != records.end(); ++it) {
+    uint64_t ns = ticksToNs(it->ticks, CPU_HZ);
+    if (ns > endNs) break;
+    if (summary.records == 0) summary.firstNs = ns;
+    summary.lastNs = ns;
+    summary.records++;
+    summary.valueSum += it->value;
+  }
+  return summary;
+}
+
+static WindowSummary readWindow(CaptureMap& map, const CaptureRange& range, uint64_t startNs, uint64_t endNs) {
+  WindowSummary summary;
+  CaptureColumns columns;
+  columns.allocate(1 << 16);
+  map.select(range, startNs, endNs);
+  while (map.read(columns) > 0) {
+    if (summary.records == 0) summary.firstNs = columns.timestampNs[0];
+    summary.lastNs = columns.timestampNs[columns.count - 1];
+    summary.records += columns.count;
+    for (size_t i = 0; i < columns.count; i++) summary.valueSum += columns.value[i];
+  }
+  return summary;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// ==================== Main ====================
+
+int main(int argc, char** argv) {
+  uint64_t count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 16000000;
+  std::string directory = (argc > 2) ? argv[2] : "/tmp/index_bench";
+  mkdir(directory.c_str(), 0755);
+
+  std::vector<Record> records;
+  generate(count, records);
+  uint64_t durationNs = ticksToNs(records.back().ticks, CPU_HZ);
+  std::printf("%llu records over %.1f s\n\n", (unsigned long long)records.size(), durationNs / 1e9);
+
+  bool allOk = true;
+  for (bool csv : {false, true}) {
+    std::string path = directory + (csv ? "/text.csv" : "/binary.ssb");
+    if (!writeCapture(path, csv, records)) {
+      std::fprintf(stderr, "cannot write %s\n", path.c_str());
+      return 1;
+    }
+    CaptureMap map;
+    if (!map.open(path)) {
+      std::fprintf(stderr, "%s\n", map.error().c_str());
+      return 1;
+    }
+
+    TimeIndex sidecar;
+    bool ok = sidecar.load(TimeIndex::sidecarPath(path), map) && sidecar.check(map);
+    auto begin = std::chrono::steady_clock::now();
+    TimeIndex rebuilt;
+    rebuilt.build(map);
+    double rebuildSeconds = secondsSince(begin);
+    ok = ok && rebuilt.check(map);
+    std::printf("%s: %.1f MB; sidecar %zu entries (%s); rebuilt %zu entries in %.3f s (%s)\n",
+                csv ? "text.csv" : "binary.ssb", map.size() / 1e6, sidecar.size(),
+                sidecar.size() && sidecar.error().empty() ? "ok" : sidecar.error().c_str(), rebuilt.size(),
+                rebuildSeconds, rebuilt.error().empty() ? "ok" : rebuilt.error().c_str());
+    if (!ok) {
+      allOk = false;
+      continue;
+    }
+
+    std::printf("  %10s %14s %12s %12s %9s  %s\n", "window", "indexed_bytes", "indexed_ms", "scan_ms",
+                "speedup", "check");
+    std::mt19937_64 rng(csv ? 2 : 1);
+    for (uint64_t windowNs : WINDOWS_NS) {
+      double indexedSeconds = 0;
+      double scanSeconds = 0;
+      uint64_t indexedBytes = 0;
+      uint32_t scans = 0;
+      bool windowsOk = true;
+      for (uint32_t i = 0; i < WINDOWS_PER_SIZE; i++) {
+        uint64_t startNs = rng() % (durationNs - std::min(durationNs - 1, windowNs));
+        uint64_t endNs = startNs + windowNs;
+        WindowSummary want = truth(records, startNs, endNs);
+
+        // Through the index: open, binary search, decode the range
+        begin = std::chrono::steady_clock::now();
+        TimeIndex index;
+        index.open(path, map);
+        CaptureRange range = index.range(map, startNs, endNs);
+        WindowSummary got = readWindow(map, range, startNs, endNs);
+        indexedSeconds += secondsSince(begin);
+        indexedBytes += range.end - range.begin;
+        windowsOk &= got == want && index.source() == TimeIndex::SOURCE_SIDECAR;
+        windowsOk &= readWindow(map, rebuilt.range(map, startNs, endNs), startNs, endNs) == want;
+
+        if (scans < SCANS_PER_SIZE) {
+          begin = std::chrono::steady_clock::now();
+          WindowSummary scanned = readWindow(map, map.all(), startNs, endNs);
+          scanSeconds += secondsSince(begin);
+          windowsOk &= scanned == want;
+          scans++;
+        }
+        if (i == 0) {
+          AnalysisOptions options;
+          options.threads = 1;
+          options.startNs = startNs;
+          options.endNs = endNs;
+          CaptureAnalysis analysis;
+          CaptureAnalyzer analyzer(options);
+          windowsOk &= analyzer.run(path, analysis) && analysis.records == want.records &&
+                       (want.records == 0 || (analysis.firstNs == want.firstNs && analysis.lastNs == want.lastNs));
+        }
+      }
+      // The scan decodes from the first record and stops after the window
+      double indexedMs = indexedSeconds * 1e3 / WINDOWS_PER_SIZE;
+      double scanMs = scanSeconds * 1e3 / scans;
+      std::printf("  %8.3f s %14.0f %12.3f %12.1f %8.0fx  %s\n", windowNs / 1e9,
+                  (double)indexedBytes / WINDOWS_PER_SIZE, indexedMs, scanMs,
+                  indexedMs > 0 ? scanMs / indexedMs : 0.0, windowsOk ? "ok" : "MISMATCH");
+      allOk &= windowsOk;
+    }
+    std::printf("\n");
+  }
+  std::printf("%s\n", allOk ? "All windows match" : "MISMATCH");
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+/*
+ * merge_bench - Multi-channel time merge benchmark
+ *
+ * Feeds 2, 4 and 8 synthetic capture channels with bytes at independent
+ * random times (per-channel baud rate, idle gaps, bursts), stamped with a
+ * wrapping 32-bit cycle counter, and merges them with ChannelMerge into one
+ * stream. A linear scan over the channel heads is run on the same input as
+ * a reference.
+ *
+ * Checks that the output is in time order, that every channel's bytes come
+ * out complete and in sequence, and reports merge throughput.
+ *
+ * Usage: merge_bench [samples_per_channel]
+ *        default: 2000000
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "CaptureChannel.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CPU_HZ = 600000000;
+const uint32_t BATCH_CYCLES = CPU_HZ / 1000;     // Merge once per simulated ms
+const uint32_t RING_SIZE = 16384;                // About the firmware's fast + spill rings
+const uint32_t MAX_CHANNELS = 8;
+const uint32_t BAUDS[] = {115200, 230400, 460800, 921600, 1000000, 2000000};
+
+typedef CaptureChannel<RING_SIZE> Channel;
+
+// ==================== Synthetic Source ====================
+
+/**
+ * Byte arrival times for one channel: back-to-back characters in bursts
+ * separated by random idle gaps
+ */
+class SyntheticLine {
+ public:
+  SyntheticLine(uint32_t baud, uint32_t seed)
+      : byteCycles_((uint64_t)CPU_HZ * 10 / baud), rng_(seed) {
+    next_ = rng_() % byteCycles_;
+    burstLeft_ = 1 + rng_() % 64;
+  }
+
+  uint64_t nextTime() const { return next_; }
+  uint32_t byteCycles() const { return (uint32_t)byteCycles_; }
+
+  void advance() {
+    if (--burstLeft_ > 0) {
+      next_ += byteCycles_;
+    } else {
+      next_ += byteCycles_ + rng_() % (CPU_HZ / 500);   // Up to 2 ms idle
+      burstLeft_ = 1 + rng_() % 64;
+    }
+  }
+
+ private:
+  uint64_t byteCycles_;
+  std::mt19937 rng_;
+  uint64_t next_;
+  uint32_t burstLeft_;
+};
+
+// ==================== Reference: Linear Scan ====================
+
+template <typename Sink>
+static uint32_t linearMerge(Channel** channels, uint32_t count, uint64_t horizon, Sink&& sink) {
+  uint32_t emitted = 0;
+  for (;;) {
+    int best = -1;
+    uint64_t bestTicks = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      const RxSample* head;
+      if (channels[i]->ring.readSpan(head) == 0) continue;
+      uint64_t ticks = channels[i]->clock.extend(head->cycles);
+      if (ticks <= horizon && (best < 0 || ticks < bestTicks)) {
+        best = (int)i;
+        bestTicks = ticks;
+      }
+    }
+    if (best < 0) return emitted;
+    const RxSample* head;
+    channels[best]->ring.readSpan(head);
+    sink(*head, bestTicks);
+    channels[best]->ring.consumeRead(1);
+    emitted++;
+  }
+}
+
+// ==================== Run ====================
+
+struct Checker {
+  uint64_t lastTicks = 0;
+  uint64_t total = 0;
+  uint64_t disorder = 0;
+  uint64_t gaps = 0;
+  uint8_t expected[MAX_CHANNELS] = {};
+
+  void operator()(const RxSample& sample, uint64_t ticks) {
+    if (ticks < lastTicks) disorder++;
+    lastTicks = ticks;
+    if (sample.value != expected[sample.channel]) gaps++;
+    expected[sample.channel] = sample.value + 1;
+    total++;
+  }
+};
+
+static std::vector<Channel*> channelStore;
+
+static double run(uint32_t channelCount, uint64_t samplesPerChannel, bool useHeap, bool& ok) {
+  std::vector<SyntheticLine> lines;
+  ChannelMerge<Channel, MAX_CHANNELS> merge;
+  const uint32_t origin = 0xF0000000;   // Wraps within the first few seconds
+  for (uint32_t i = 0; i < channelCount; i++) {
+    lines.emplace_back(BAUDS[i % (sizeof(BAUDS) / sizeof(BAUDS[0]))], 1000 + i);
+    channelStore[i]->id = (uint8_t)i;
+    channelStore[i]->reset(origin, lines[i].byteCycles());
+    merge.add(channelStore[i]);
+  }
+
+  std::vector<uint64_t> produced(channelCount, 0);
+  Checker checker;
+  CycleExtender now;
+  now.reset(origin);
+  uint64_t simCycles = 0;
+  uint64_t target = samplesPerChannel * channelCount;
+  double seconds = 0;
+
+  while (checker.total < target) {
+    // Produce one batch, as the UART interrupts would
+    simCycles += BATCH_CYCLES;
+    for (uint32_t i = 0; i < channelCount; i++) {
+      while (produced[i] < samplesPerChannel && lines[i].nextTime() <= simCycles) {
+        channelStore[i]->receive(origin + (uint32_t)lines[i].nextTime(), 0,
+                                 (uint8_t)produced[i], STATUS_OK);
+        produced[i]++;
+        lines[i].advance();
+      }
+    }
+    uint64_t horizon = now.extend(origin + (uint32_t)simCycles);
+    bool finished = true;
+    for (uint32_t i = 0; i < channelCount; i++) finished &= (produced[i] == samplesPerChannel);
+    if (finished) horizon = UINT64_MAX;
+
+    auto start = std::chrono::steady_clock::now();
+    if (useHeap) {
+      merge.run(horizon, UINT32_MAX, checker);
+    } else {
+      linearMerge(channelStore.data(), channelCount, horizon, checker);
+    }
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  uint64_t dropped = 0;
+  for (uint32_t i = 0; i < channelCount; i++) dropped += channelStore[i]->stats.bytesDropped;
+  ok = checker.disorder == 0 && checker.gaps == 0 && dropped == 0 && checker.total == target;
+  return seconds;
+}
+
+int main(int argc, char** argv) {
+  uint64_t samples = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+  for (uint32_t i = 0; i < MAX_CHANNELS; i++) channelStore.push_back(new Channel());
+
+  std::printf("%llu samples per channel, ring %u, merged once per simulated ms\n\n",
+              (unsigned long long)samples, RING_SIZE);
+  std::printf("%8s %8s %12s %12s %10s  %s\n", "channels", "merge", "samples", "Msamples/s", "ns/sample", "order");
+
+  bool allOk = true;
+  const uint32_t counts[] = {2, 4, 8};
+  for (uint32_t count : counts) {
+    for (int heap = 1; heap >= 0; heap--) {
+      bool ok = false;
+      double seconds = run(count, samples, heap != 0, ok);
+      double total = (double)samples * count;
+      std::printf("%8u %8s %12.0f %12.1f %10.2f  %s\n", count, heap ? "heap" : "linear",
+                  total, total / seconds / 1e6, seconds * 1e9 / total, ok ? "ok" : "FAIL");
+      allOk &= ok;
+    }
+  }
+
+  for (Channel* channel : channelStore) delete channel;
+  return allOk ? 0 : 1;
+}
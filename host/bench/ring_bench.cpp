@@ -0,0 +1,217 @@
+/*
+ * ring_bench - SpscRing / TieredRing multithreaded throughput and integrity benchmark
+ *
+ * A producer thread pushes a numbered sequence using random-sized
+ * writeSpan()/commitWrite() bursts and single push() calls; the consumer
+ * drains with readSpan()/consumeRead() and checks every element arrives
+ * exactly once and in order.
+ *
+ * The second run does the same through a TieredRing with single push()
+ * calls (as the receive interrupt does) while the consumer sleeps now and
+ * then like a stalled SD write, so the fast ring keeps spilling into the
+ * spill ring and refilling from it.
+ *
+ * Before that, single-threaded checks drive a small TieredRing through
+ * fixed interleavings (the producer switching back to the fast ring
+ * between two consumer reads) and random push/read/consume sequences
+ * against an expected count, so ordering faults do not depend on thread
+ * timing to show.
+ *
+ * Usage: ring_bench [elements]   (default 20000000 per run)
+ * Exit status is non-zero if any element is lost, duplicated or reordered.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "RingBuffer.h"
+
+typedef SpscRing<uint32_t, 16384> BenchRing;
+typedef TieredRing<uint32_t, 1024, 65536> BenchTieredRing;
+
+static BenchRing ring;
+static BenchTieredRing tiered;
+static BenchTieredRing::SpillRing spill;
+
+typedef TieredRing<uint32_t, 8, 64> SmallTieredRing;
+
+static SmallTieredRing small;
+static SmallTieredRing::SpillRing smallSpill;
+
+/**
+ * Read up to limit elements, check they continue the sequence at expected
+ * @return false on a gap or reorder
+ */
+static bool readSmall(uint32_t& expected, uint32_t limit) {
+  const uint32_t* span;
+  uint32_t count = small.readSpan(span);
+  if (count > limit) count = limit;
+  for (uint32_t i = 0; i < count; i++) {
+    if (span[i] != expected + i) {
+      std::printf("  read %u, expected %u\n", span[i], expected + i);
+      return false;
+    }
+  }
+  small.consumeRead(count);
+  expected += count;
+  return true;
+}
+
+static bool checkTieredOrder() {
+  bool ok = true;
+
+  // Producer switches back after the consumer emptied the fast ring but
+  // before it asked for the spill ring: 9 must not come before 8
+  small.attachSpill(&smallSpill);
+  uint32_t next = 0;
+  uint32_t expected = 0;
+  while (next <= 8) small.push(next++);
+  ok &= readSmall(expected, 8);
+  small.push(next++);
+  while (ok && !small.empty()) ok &= readSmall(expected, UINT32_MAX);
+  ok &= expected == next;
+  std::printf("TieredRing switch back between reads: %s\n", ok ? "ok" : "FAIL");
+
+  // Random interleavings of pushes and partial reads
+  std::mt19937 rng(4321);
+  small.attachSpill(&smallSpill);
+  next = 0;
+  expected = 0;
+  bool randomOk = true;
+  for (uint32_t step = 0; step < 2000000 && randomOk; step++) {
+    if (rng() % 3 != 0) {
+      if (small.push(next)) next++;
+    } else {
+      randomOk = readSmall(expected, 1 + rng() % 12);
+    }
+  }
+  while (randomOk && !small.empty()) randomOk = readSmall(expected, UINT32_MAX);
+  randomOk &= expected == next && small.spills() > 0;
+  std::printf("TieredRing random interleavings (%u elements, %u spills): %s\n\n", next, small.spills(),
+              randomOk ? "ok" : "FAIL");
+  return ok && randomOk;
+}
+
+static bool runTiered(uint64_t total) {
+  tiered.attachSpill(&spill);
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread producer([total]() {
+    uint64_t next = 0;
+    while (next < total) {
+      if (tiered.push((uint32_t)next)) next++;
+      else std::this_thread::yield();
+    }
+  });
+
+  std::mt19937 rng(5678);
+  uint64_t expected = 0;
+  uint64_t errors = 0;
+  uint64_t stalls = 0;
+  while (expected < total) {
+    if ((rng() & 1023) == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200 + rng() % 1800));
+      stalls++;
+    }
+    const uint32_t* span;
+    uint32_t count = tiered.readSpan(span);
+    if (count == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (count > 512) count = 512;             // Drain in writer-sized pieces
+    for (uint32_t i = 0; i < count; i++) {
+      if (span[i] != (uint32_t)(expected + i)) errors++;
+    }
+    tiered.consumeRead(count);
+    expected += count;
+  }
+  producer.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("\nTieredRing (%u fast + %u spill):\n", tiered.fastCapacity(), tiered.spillCapacity());
+  std::printf("elements:      %llu\n", (unsigned long long)total);
+  std::printf("errors:        %llu\n", (unsigned long long)errors);
+  std::printf("leftover:      %u\n", tiered.size());
+  std::printf("consumer stalls: %llu, spills: %u\n", (unsigned long long)stalls, tiered.spills());
+  std::printf("peak levels:   fast %u/%u, spill %u/%u\n", tiered.fastPeak(), tiered.fastCapacity(),
+              tiered.spillPeak(), tiered.spillCapacity());
+  std::printf("throughput:    %.1f M elements/s\n", total / seconds / 1e6);
+
+  return errors == 0 && tiered.empty() && tiered.spills() > 0;
+}
+
+int main(int argc, char** argv) {
+  uint64_t total = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20000000ULL;
+
+  bool ordered = checkTieredOrder();
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread producer([total]() {
+    std::mt19937 rng(1234);
+    uint64_t next = 0;
+    while (next < total) {
+      if ((rng() & 7) == 0) {
+        // Single-element path
+        if (ring.push((uint32_t)next)) next++;
+        else std::this_thread::yield();
+        continue;
+      }
+      uint32_t* span;
+      uint32_t space = ring.writeSpan(span);
+      if (space == 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      uint32_t burst = 1 + rng() % 4096;
+      if (burst > space) burst = space;
+      if (burst > total - next) burst = (uint32_t)(total - next);
+      for (uint32_t i = 0; i < burst; i++) span[i] = (uint32_t)(next + i);
+      ring.commitWrite(burst);
+      next += burst;
+    }
+  });
+
+  uint64_t expected = 0;
+  uint64_t errors = 0;
+  uint64_t spans = 0;
+  uint32_t peak = 0;
+  while (expected < total) {
+    uint32_t level = ring.size();
+    if (level > peak) peak = level;
+
+    const uint32_t* span;
+    uint32_t count = ring.readSpan(span);
+    if (count == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      if (span[i] != (uint32_t)(expected + i)) errors++;
+    }
+    ring.consumeRead(count);
+    expected += count;
+    spans++;
+  }
+  producer.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("elements:      %llu\n", (unsigned long long)total);
+  std::printf("errors:        %llu\n", (unsigned long long)errors);
+  std::printf("leftover:      %u\n", ring.size());
+  std::printf("read spans:    %llu (avg %.1f elements)\n",
+              (unsigned long long)spans, spans ? (double)total / spans : 0.0);
+  std::printf("peak level:    %u/%u\n", peak, ring.capacity());
+  std::printf("throughput:    %.1f M elements/s\n", total / seconds / 1e6);
+
+  bool ok = ordered && errors == 0 && ring.empty();
+  if (!runTiered(total)) ok = false;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+/*
+ * trigger_bench - Trigger pattern matcher correctness and throughput
+ *
+ * Random pattern sets of 16 to 512 patterns (2-8 bytes; a mix of exact
+ * bytes, ?? wildcards, nibble wildcards and value/mask bytes, some
+ * anchored to packet starts, some watching one channel only) are
+ * compiled into TriggerMatcher and run over a 4-channel byte stream with
+ * random packet starts and planted pattern instances. Every step() result
+ * must equal a naive reference that compares each pattern against each
+ * channel's recent bytes. Reports matcher throughput with 32-bit state
+ * words (as on the Teensy) and 64-bit words, against the reference.
+ * Pattern text parsing is checked against a table of cases first.
+ *
+ * Exits non-zero if parsing or any match result is wrong.
+ *
+ * Usage: trigger_bench [megabytes]
+ *        default: 4 MB of traffic per pattern set
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TriggerEngine.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t PATTERN_COUNTS[] = {16, 64, 256, 512};
+const uint32_t STATE_BITS = 4096;                // 512 patterns of up to 8 bytes
+const uint32_t CHANNELS = 4;
+const uint32_t REFERENCE_BYTES = 256 * 1024;     // Checked against the reference
+const uint32_t PLANT_EVERY = 200;                // Average bytes between planted patterns
+
+typedef TriggerMatcher<STATE_BITS, uint32_t> Matcher32;
+typedef TriggerMatcher<STATE_BITS, uint64_t> Matcher64;
+
+// ==================== Parsing ====================
+
+struct ParseCase {
+  const char* text;
+  bool valid;
+  const char* bytes;            // "VV/MM" per byte, as describe() writes them
+  uint8_t channels;
+  bool packetStart;
+};
+
+static std::string describe(const TriggerPattern& pattern) {
+  std::string text;
+  char pair[8];
+  for (uint32_t i = 0; i < pattern.length; i++) {
+    std::snprintf(pair, sizeof(pair), "%02X/%02X ", pattern.value[i], pattern.mask[i]);
+    text += pair;
+  }
+  if (!text.empty()) text.pop_back();
+  return text;
+}
+
+static bool checkParsing() {
+  static const ParseCase CASES[] = {
+    {"01 03", true, "01/FF 03/FF", TRIGGER_ALL_CHANNELS, false},
+    {"^01 ??", true, "01/FF 00/00", TRIGGER_ALL_CHANNELS, true},
+    {"TX: 4? ?1", true, "40/F0 01/0F", 1u << CHANNEL_TX, false},
+    {"CH2: ^AA 55", true, "AA/FF 55/FF", 1u << 2, true},
+    {"41/DF,0d", true, "41/DF 0D/FF", TRIGGER_ALL_CHANNELS, false},
+    {"80/80", true, "80/80", TRIGGER_ALL_CHANNELS, false},
+    {"'OK\\r\\n'", true, "4F/FF 4B/FF 0D/FF 0A/FF", TRIGGER_ALL_CHANNELS, false},
+    {"'a:b' 00", true, "61/FF 3A/FF 62/FF 00/FF", TRIGGER_ALL_CHANNELS, false},
+    {"'\\x7f\\''", true, "7F/FF 27/FF", TRIGGER_ALL_CHANNELS, false},
+    {"", false, "", 0, false},
+    {"^", false, "", 0, false},
+    {"0", false, "", 0, false},
+    {"0G", false, "", 0, false},
+    {"123", false, "", 0, false},
+    {"XX: 01", false, "", 0, false},
+    {"'open", false, "", 0, false},
+    {"'\\q'", false, "", 0, false},
+    {"01/G0", false, "", 0, false},
+    {"00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F 10 11 12 13 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F 20",
+     false, "", 0, false},
+  };
+  bool ok = true;
+  for (const ParseCase& test : CASES) {
+    TriggerPattern pattern;
+    bool valid = parseTriggerPattern(test.text, pattern);
+    bool right = valid == test.valid;
+    if (right && valid) {
+      right = describe(pattern) == test.bytes && pattern.channels == test.channels &&
+              pattern.packetStart == test.packetStart;
+    }
+    if (!right) {
+      std::printf("parse \"%s\": got %s [%s] channels %02X%s\n", test.text, valid ? "valid" : "invalid",
+                  describe(pattern).c_str(), pattern.channels, pattern.packetStart ? " anchored" : "");
+      ok = false;
+    }
+  }
+  std::printf("Pattern parsing: %zu cases %s\n\n", sizeof(CASES) / sizeof(CASES[0]), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// ==================== Synthetic Source ====================
+
+struct Byte {
+  uint8_t channel;
+  uint8_t value;
+  bool packetStart;
+};
+
+static std::vector<TriggerPattern> makePatterns(uint32_t count, std::mt19937& rng) {
+  std::vector<TriggerPattern> patterns(count);
+  for (TriggerPattern& pattern : patterns) {
+    pattern = TriggerPattern();
+    uint32_t length = 2 + rng() % 7;
+    for (uint32_t i = 0; i < length; i++) {
+      uint8_t value = (uint8_t)rng();
+      switch (rng() % 10) {
+        case 0: pattern.add(0, 0x00); break;                       // ??
+        case 1: pattern.add(value, 0xF0); break;                   // 4?
+        case 2: pattern.add(value, 0x0F); break;                   // ?1
+        case 3: pattern.add(value, (uint8_t)(rng() | 0x81)); break; // value/mask
+        default: pattern.add(value, 0xFF); break;
+      }
+    }
+    // Never all wildcards: that would hit on every byte
+    pattern.mask[0] = 0xFF;
+    pattern.value[0] = (uint8_t)rng();
+    if (rng() % 10 == 0) pattern.packetStart = true;
+    if (rng() % 5 == 0) pattern.channels = (uint8_t)(1u << (rng() % CHANNELS));
+  }
+  return patterns;
+}
+
+// Random traffic with pattern instances planted on random channels
+static std::vector<Byte> makeTraffic(size_t size, const std::vector<TriggerPattern>& patterns,
+                                     std::mt19937& rng) {
+  std::vector<Byte> bytes;
+  bytes.reserve(size + TRIGGER_MAX_PATTERN_BYTES);
+  bool starting[CHANNELS] = {true, true, true, true};
+  while (bytes.size() < size) {
+    uint8_t channel = (uint8_t)(rng() % CHANNELS);
+    if (rng() % PLANT_EVERY == 0) {
+      const TriggerPattern& pattern = patterns[rng() % patterns.size()];
+      if (pattern.packetStart) starting[channel] = true;
+      for (uint32_t i = 0; i < pattern.length; i++) {
+        uint8_t value = (uint8_t)(pattern.value[i] | (rng() & ~pattern.mask[i]));
+        bytes.push_back({channel, value, starting[channel]});
+        starting[channel] = false;
+      }
+      continue;
+    }
+    bytes.push_back({channel, (uint8_t)rng(), starting[channel]});
+    starting[channel] = rng() % 16 == 0;
+  }
+  return bytes;
+}
+
+// ==================== Reference ====================
+
+/**
+ * Checks every pattern against each channel's last bytes
+ */
+class ReferenceMatcher {
+ public:
+  explicit ReferenceMatcher(const std::vector<TriggerPattern>& patterns) : patterns_(patterns) {}
+
+  int32_t step(uint8_t channel, uint8_t value, bool packetStart) {
+    History& history = history_[channel];
+    history.values[history.count % TRIGGER_MAX_PATTERN_BYTES] = value;
+    history.starts[history.count % TRIGGER_MAX_PATTERN_BYTES] = packetStart;
+    history.count++;
+    for (size_t p = 0; p < patterns_.size(); p++) {
+      const TriggerPattern& pattern = patterns_[p];
+      if (!(pattern.channels & (1u << channel)) || history.count < pattern.length) continue;
+      uint64_t first = history.count - pattern.length;
+      bool match = !pattern.packetStart || history.starts[first % TRIGGER_MAX_PATTERN_BYTES];
+      for (uint32_t i = 0; i < pattern.length && match; i++) {
+        match = (history.values[(first + i) % TRIGGER_MAX_PATTERN_BYTES] & pattern.mask[i]) == pattern.value[i];
+      }
+      if (match) return (int32_t)p;
+    }
+    return TRIGGER_NO_MATCH;
+  }
+
+ private:
+  struct History {
+    uint8_t values[TRIGGER_MAX_PATTERN_BYTES];
+    bool starts[TRIGGER_MAX_PATTERN_BYTES];
+    uint64_t count = 0;
+  };
+
+  const std::vector<TriggerPattern>& patterns_;
+  History history_[CHANNELS];
+};
+
+// ==================== Runs ====================
+
+template <typename Matcher>
+static std::unique_ptr<Matcher> compile(const std::vector<TriggerPattern>& patterns) {
+  std::unique_ptr<Matcher> matcher(new Matcher());
+  for (const TriggerPattern& pattern : patterns) matcher->add(pattern);
+  return matcher;
+}
+
+// Results of every byte, and the time it took
+template <typename Matcher>
+static double run(Matcher& matcher, const std::vector<Byte>& bytes, std::vector<int32_t>& results) {
+  matcher.reset();
+  results.resize(bytes.size());
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < bytes.size(); i++) {
+    results[i] = matcher.step(bytes[i].channel, bytes[i].value, bytes[i].packetStart);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t compare(const std::vector<int32_t>& got, const std::vector<int32_t>& want, size_t count) {
+  size_t wrong = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (got[i] != want[i]) {
+      if (wrong == 0) std::printf("  byte %zu: pattern %d, expected %d\n", i, got[i], want[i]);
+      wrong++;
+    }
+  }
+  return wrong;
+}
+
+int main(int argc, char** argv) {
+  double megabytes = (argc > 1) ? std::atof(argv[1]) : 4;
+  if (megabytes <= 0) {
+    std::fprintf(stderr, "Usage: trigger_bench [megabytes]\n");
+    return 2;
+  }
+  size_t size = (size_t)(megabytes * 1024 * 1024);
+  if (size < REFERENCE_BYTES) size = REFERENCE_BYTES;
+
+  bool allOk = checkParsing();
+  std::printf("%u channels, %.1f MB per set (%u KB checked against the reference), a planted pattern "
+              "every ~%u bytes\n\n", CHANNELS, size / 1048576.0, REFERENCE_BYTES / 1024, PLANT_EVERY);
+  std::printf("%8s %6s %7s %8s %10s %10s %10s %8s  %s\n", "patterns", "bits", "words32", "hits",
+              "ref_MB/s", "u32_MB/s", "u64_MB/s", "speedup", "result");
+
+  std::mt19937 rng(20261016);
+  for (uint32_t count : PATTERN_COUNTS) {
+    std::vector<TriggerPattern> patterns = makePatterns(count, rng);
+    std::vector<Byte> bytes = makeTraffic(size, patterns, rng);
+    std::unique_ptr<Matcher32> matcher32 = compile<Matcher32>(patterns);
+    std::unique_ptr<Matcher64> matcher64 = compile<Matcher64>(patterns);
+
+    // Reference over the first part only: it is slow with many patterns
+    std::vector<Byte> head(bytes.begin(), bytes.begin() + REFERENCE_BYTES);
+    ReferenceMatcher reference(patterns);
+    std::vector<int32_t> want(REFERENCE_BYTES);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < head.size(); i++) want[i] = reference.step(head[i].channel, head[i].value, head[i].packetStart);
+    double referenceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<int32_t> got32;
+    std::vector<int32_t> got64;
+    double seconds32 = run(*matcher32, bytes, got32);
+    double seconds64 = run(*matcher64, bytes, got64);
+    size_t wrong = compare(got32, want, REFERENCE_BYTES) + compare(got64, want, REFERENCE_BYTES);
+    for (size_t i = 0; i < bytes.size(); i++) {
+      if (got32[i] != got64[i]) wrong++;
+    }
+    size_t hits = 0;
+    for (int32_t result : got32) hits += result != TRIGGER_NO_MATCH;
+
+    double referenceRate = REFERENCE_BYTES / 1048576.0 / referenceSeconds;
+    double rate32 = bytes.size() / 1048576.0 / seconds32;
+    double rate64 = bytes.size() / 1048576.0 / seconds64;
+    bool ok = wrong == 0 && matcher32->patterns() == count;
+    std::printf("%8u %6u %7u %8zu %10.1f %10.1f %10.1f %7.0fx  %s\n", count, matcher32->bitsUsed(),
+                (matcher32->bitsUsed() + 31) / 32, hits, referenceRate, rate32, rate64, rate32 / referenceRate,
+                ok ? "ok" : "MISMATCH");
+    allOk &= ok;
+  }
+  return allOk ? 0 : 1;
+}
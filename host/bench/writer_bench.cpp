@@ -0,0 +1,267 @@
+/*
+ * writer_bench - SectorWriter flush policy benchmark
+ *
+ * Runs the capture consumer loop against a mock block device in simulated
+ * time. Raw bytes arrive at line rate into a receive ring, are encoded as
+ * 8-byte records into the SectorWriter and written out one sector per
+ * service() call. The mock device charges a base cost per write and per
+ * sync and injects random latency spikes (card wear levelling).
+ *
+ * For each block count the benchmark checks that every device write is a
+ * whole, sector-aligned sector (except alignment/idle/final writes, which
+ * still start on a sector boundary), that metadata is synced at least
+ * every other sync interval, that the file contents are the exact record
+ * sequence, and reports bytes lost upstream along with write/sync latency
+ * high-water marks. Exits non-zero if any run fails these checks.
+ *
+ * Usage: writer_bench [baud] [seconds] [spike_ms] [spikes_per_10000_ops]
+ *        defaults: 2000000 baud, 10 s, 120 ms spikes, 3 per 10000 device ops
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "RingBuffer.h"
+#include "SectorWriter.h"
+
+// ==================== Model Parameters ====================
+
+const uint64_t WRITE_BASE_US = 250;     // One 512-byte sector
+const uint64_t SYNC_BASE_US = 2000;     // Directory entry + FAT update
+const uint64_t LOOP_OVERHEAD_US = 1;
+const uint32_t RECORD_SIZE = 8;
+const uint32_t SYNC_INTERVAL_MS = 1000;
+
+static uint64_t simNowUs = 0;
+
+static uint32_t simMicros() {
+  return (uint32_t)simNowUs;
+}
+
+// ==================== Mock Block Device ====================
+
+/**
+ * Captures everything written and charges simulated latency
+ */
+class MockBlockDevice {
+ public:
+  MockBlockDevice(uint32_t spikeUs, uint32_t spikesPer10k, uint32_t seed)
+      : spikeUs_(spikeUs), spikesPer10k_(spikesPer10k), rng_(seed) {}
+
+  /**
+   * Writes may start inside a sector only at this offset (the end of the
+   * file header, where the writer begins)
+   */
+  void setWriterStart(uint64_t offset) { writerStart_ = offset; }
+
+  size_t write(const uint8_t* data, size_t length) {
+    uint64_t offset = position_ % SECTOR_SIZE;
+    if (!(offset == 0 && length == SECTOR_SIZE)) {
+      partialWrites_++;
+      // A partial write must never straddle a sector boundary, nor start
+      // inside a sector other than where the writer began
+      if (offset + length > SECTOR_SIZE) misalignedWrites_++;
+      else if (offset != 0 && position_ != writerStart_) misalignedWrites_++;
+    }
+    if (position_ + length > data_.size()) data_.resize(position_ + length);
+    memcpy(&data_[position_], data, length);
+    position_ += length;
+    simNowUs += WRITE_BASE_US + spike();
+    writes_++;
+    return length;
+  }
+
+  void flush() {
+    uint64_t gapUs = simNowUs - lastSyncUs_;
+    if (gapUs > maxSyncGapUs_) maxSyncGapUs_ = gapUs;
+    simNowUs += SYNC_BASE_US + spike();
+    lastSyncUs_ = simNowUs;
+    syncs_++;
+  }
+
+  uint64_t position() const { return position_; }
+
+  bool seek(uint64_t position) {
+    if (position > data_.size()) return false;
+    position_ = position;
+    return true;
+  }
+
+  const std::vector<uint8_t>& data() const { return data_; }
+  uint32_t writes() const { return writes_; }
+  uint32_t partialWrites() const { return partialWrites_; }
+  uint32_t misalignedWrites() const { return misalignedWrites_; }
+  uint32_t syncs() const { return syncs_; }
+  uint64_t maxSyncGapUs() const { return maxSyncGapUs_; }
+
+ private:
+  uint64_t spike() {
+    return (rng_() % 10000) < spikesPer10k_ ? spikeUs_ : 0;
+  }
+
+  uint32_t spikeUs_;
+  uint32_t spikesPer10k_;
+  std::mt19937 rng_;
+  std::vector<uint8_t> data_;
+  uint64_t position_ = 0;
+  uint64_t writerStart_ = 0;
+  uint64_t lastSyncUs_ = 0;
+  uint64_t maxSyncGapUs_ = 0;
+  uint32_t writes_ = 0;
+  uint32_t partialWrites_ = 0;
+  uint32_t misalignedWrites_ = 0;
+  uint32_t syncs_ = 0;
+};
+
+// ==================== Line Model ====================
+
+static SpscRing<uint32_t, 32768> rxRing;   // Raw bytes, tagged with their sequence
+
+struct Line {
+  uint64_t byteNs;           // Time for one 10-bit character
+  uint64_t sent = 0;
+  uint64_t dropped = 0;
+
+  void advance() {
+    uint64_t due = simNowUs * 1000 / byteNs;
+    while (sent < due) {
+      if (!rxRing.push((uint32_t)sent)) dropped++;
+      sent++;
+    }
+  }
+};
+
+// ==================== Run ====================
+
+template <uint32_t Blocks>
+static bool run(uint32_t baud, double seconds, uint32_t spikeUs, uint32_t spikesPer10k) {
+  MockBlockDevice device(spikeUs, spikesPer10k, 42);
+  SectorWriter<MockBlockDevice, Blocks> writer;
+  Line line = {10ULL * 1000000000ULL / baud};
+  uint64_t endUs = (uint64_t)(seconds * 1e6);
+  uint32_t ringPeak = 0;
+
+  simNowUs = 0;
+  rxRing.clear();
+  // Start misaligned, as after a 64-byte file header
+  std::vector<uint8_t> header(64, 0xAA);
+  device.write(header.data(), header.size());
+  device.setWriterStart(header.size());
+  writer.begin(&device, header.size(), simMicros, SYNC_INTERVAL_MS);
+
+  while (simNowUs < endUs) {
+    line.advance();
+    if (rxRing.size() > ringPeak) ringPeak = rxRing.size();
+
+    // Encode as far as the writer has room
+    uint32_t room = writer.freeSpace() / RECORD_SIZE;
+    uint32_t value;
+    while (room-- > 0 && rxRing.pop(value)) {
+      uint8_t record[RECORD_SIZE];
+      memcpy(record, &value, sizeof(value));
+      memset(record + sizeof(value), 0, RECORD_SIZE - sizeof(value));
+      writer.append(record, RECORD_SIZE);
+    }
+
+    // One sector per service(), draining the line between writes
+    while (writer.blocksQueued() > 0) {
+      writer.service((uint32_t)(simNowUs / 1000));
+      line.advance();
+    }
+    writer.service((uint32_t)(simNowUs / 1000));
+    simNowUs += LOOP_OVERHEAD_US;
+  }
+
+  // Stop: drain and flush
+  uint32_t value;
+  while (rxRing.pop(value)) {
+    uint8_t record[RECORD_SIZE] = {};
+    memcpy(record, &value, sizeof(value));
+    while (writer.append(record, RECORD_SIZE) == 0) writer.service((uint32_t)(simNowUs / 1000));
+  }
+  writer.flush();
+
+  // Verify file contents: header, then strictly increasing sequence numbers
+  const std::vector<uint8_t>& data = device.data();
+  uint64_t records = (data.size() - header.size()) / RECORD_SIZE;
+  uint64_t gaps = 0;
+  uint64_t reorders = 0;
+  uint32_t previous = 0;
+  for (uint64_t i = 0; i < records; i++) {
+    uint32_t seq;
+    memcpy(&seq, &data[header.size() + i * RECORD_SIZE], sizeof(seq));
+    if (i > 0) {
+      if (seq <= previous) reorders++;
+      else if (seq != previous + 1) gaps++;
+    }
+    previous = seq;
+  }
+  bool intact = (records == line.sent - line.dropped) && reorders == 0 &&
+                (data.size() - header.size()) % RECORD_SIZE == 0 && device.misalignedWrites() == 0;
+
+  // Syncs are at most two intervals apart, give or take one write or sync
+  // (with its latency spike) that was under way at the deadline
+  uint64_t syncGapLimitUs = 2ULL * SYNC_INTERVAL_MS * 1000 + SYNC_BASE_US + spikeUs;
+  bool synced = device.maxSyncGapUs() <= syncGapLimitUs;
+
+  const SectorWriterStats& stats = writer.stats();
+  std::printf("%6u %10llu %9llu %6llu %8u %8u %7u %7u %6u %9llu %9u %9u %6u/%-3u %8u  %s\n",
+              Blocks, (unsigned long long)line.sent, (unsigned long long)line.dropped,
+              (unsigned long long)gaps, stats.sectorsWritten, stats.partialWrites, stats.rewrites,
+              device.misalignedWrites(), stats.syncs,
+              (unsigned long long)(device.maxSyncGapUs() / 1000), stats.maxWriteUs, stats.maxSyncUs,
+              stats.peakBlocksQueued, Blocks, ringPeak,
+              !intact ? "CORRUPT" : (synced ? "ok" : "SYNC LATE"));
+  return intact && synced;
+}
+
+/**
+ * A writer that always has full blocks queued still syncs: every service()
+ * call finds a new sector waiting, so the sync can only come from its
+ * deadline
+ */
+static bool checkSyncDeadline() {
+  MockBlockDevice device(0, 0, 1);
+  SectorWriter<MockBlockDevice, 4> writer;
+  simNowUs = 0;
+  writer.begin(&device, 0, simMicros, SYNC_INTERVAL_MS);
+
+  uint8_t sector[SECTOR_SIZE] = {};
+  uint64_t endUs = 10ULL * SYNC_INTERVAL_MS * 1000;
+  while (simNowUs < endUs) {
+    writer.append(sector, writer.freeSpace() < SECTOR_SIZE ? writer.freeSpace() : SECTOR_SIZE);
+    writer.service((uint32_t)(simNowUs / 1000));
+  }
+  uint64_t limitUs = 2ULL * SYNC_INTERVAL_MS * 1000 + SYNC_BASE_US + WRITE_BASE_US;
+  bool ok = device.syncs() >= 4 && device.maxSyncGapUs() <= limitUs;
+  std::printf("\nsustained load: %u syncs in %llu s, longest gap %llu ms  %s\n", device.syncs(),
+              (unsigned long long)(endUs / 1000000), (unsigned long long)(device.maxSyncGapUs() / 1000),
+              ok ? "ok" : "SYNC STARVED");
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  uint32_t baud = (argc > 1) ? (uint32_t)std::atol(argv[1]) : 2000000;
+  double seconds = (argc > 2) ? std::atof(argv[2]) : 10.0;
+  uint32_t spikeUs = (uint32_t)(((argc > 3) ? std::atof(argv[3]) : 120.0) * 1000);
+  uint32_t spikesPer10k = (argc > 4) ? (uint32_t)std::atol(argv[4]) : 3;
+
+  std::printf("%lu baud, %.1f s, %u us spikes on %u/10000 device ops, sync every %u ms\n\n",
+              (unsigned long)baud, seconds, spikeUs, spikesPer10k, SYNC_INTERVAL_MS);
+  std::printf("%6s %10s %9s %6s %8s %8s %7s %7s %6s %9s %9s %9s %10s %8s  %s\n",
+              "blocks", "sent", "dropped", "gaps", "sectors", "partial", "rewrite", "misalgn",
+              "syncs", "syncGapMs", "maxWrUs", "maxSyncUs", "peakQueued", "ringPeak", "file");
+
+  bool ok = run<2>(baud, seconds, spikeUs, spikesPer10k);
+  ok &= run<4>(baud, seconds, spikeUs, spikesPer10k);
+  ok &= run<8>(baud, seconds, spikeUs, spikesPer10k);
+  ok &= run<16>(baud, seconds, spikeUs, spikesPer10k);
+  ok &= checkSyncDeadline();
+  return ok ? 0 : 1;
+}
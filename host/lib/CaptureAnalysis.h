@@ -0,0 +1,595 @@
+/*
+ * SerialSniffer Host Tools - Parallel Capture Analysis
+ *
+ * One pass over a capture that produces what the Python suite's stats
+ * and packets commands report: byte and error counts, packet lengths and
+ * durations, packets per time bin and the gaps between packets. The
+ * capture is cut into CaptureRanges (CaptureMap.h) that are decoded and
+ * summarized on a WorkStealingPool; the partial results are merged in
+ * file order. A packet that straddles a cut is stitched during the merge
+ * from the few edge facts each range keeps per channel, so the result
+ * does not depend on the chunk size or the number of threads.
+ *
+ * Packets are the firmware's PACKET_START/PACKET_END records when the
+ * capture has them, otherwise runs of bytes split by idle gaps. A time
+ * window limits the pass to the bytes the time index (TimeIndex.h) says
+ * hold it.
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTUREANALYSIS_H
+#define CAPTUREANALYSIS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "CaptureFormat.h"
+#include "CaptureMap.h"
+#include "TimeIndex.h"
+#include "WorkStealingPool.h"
+
+// ==================== Constants ====================
+
+const size_t ANALYSIS_CHUNK_BYTES = 16 * 1024 * 1024;     // Capture bytes per task
+const size_t ANALYSIS_BATCH_RECORDS = 1 << 16;            // Records decoded at a time within a task
+const size_t ANALYSIS_PROBE_RECORDS = 1 << 20;            // Records read to choose the framing
+const uint32_t ANALYSIS_LENGTH_BINS = 4096;               // Exact lengths; longer packets share the last bin
+const uint32_t ANALYSIS_GAP_BINS = 64;                    // Bin i: gaps in [2^i, 2^(i+1)) ns (0 in bin 0)
+const uint64_t ANALYSIS_RATE_BIN_NS = 1000000000ULL;
+
+// Idle-gap framing defaults (as python/SerialSnifferAnalysis.py): this many
+// character times of 10 bits, or this many median byte gaps without a baud rate
+const double ANALYSIS_IDLE_CHARACTERS = 3.5;
+const uint32_t ANALYSIS_IDLE_MEDIAN_GAPS = 10;
+
+enum AnalysisFraming : uint8_t {
+  ANALYSIS_FRAMING_AUTO = 0,      // Records if the start of the capture has PACKET_START, else idle gaps
+  ANALYSIS_FRAMING_RECORDS = 1,   // PACKET_START / PACKET_END records
+  ANALYSIS_FRAMING_IDLE = 2       // Bytes more than gapNs apart start a new packet
+};
+
+struct AnalysisOptions {
+  unsigned threads = 0;                         // 0: one per hardware thread
+  size_t chunkBytes = ANALYSIS_CHUNK_BYTES;
+  AnalysisFraming framing = ANALYSIS_FRAMING_AUTO;
+  uint64_t gapNs = 0;                           // Idle framing threshold; 0: from the capture
+  uint64_t rateBinNs = ANALYSIS_RATE_BIN_NS;
+  uint64_t startNs = 0;                         // Only records stamped in [startNs, endNs]
+  uint64_t endNs = UINT64_MAX;
+};
+
+// ==================== Results ====================
+
+/**
+ * Counts per fixed-width time bin, stored from the first bin used
+ */
+struct BinCounts {
+  uint64_t first = 0;
+  std::vector<uint64_t> counts;
+
+  void add(uint64_t bin, uint64_t n = 1) {
+    if (counts.empty()) first = bin;
+    if (bin < first) {
+      counts.insert(counts.begin(), first - bin, 0);
+      first = bin;
+    }
+    if (bin - first >= counts.size()) counts.resize(bin - first + 1, 0);
+    counts[bin - first] += n;
+  }
+
+  void merge(const BinCounts& other) {
+    for (size_t i = 0; i < other.counts.size(); i++) {
+      if (other.counts[i]) add(other.first + i, other.counts[i]);
+    }
+  }
+};
+
+struct BaudChangeEvent {
+  uint64_t timestampNs;
+  uint8_t channel;
+  uint32_t baudRate;
+};
+
+/**
+ * Everything measured on one channel
+ */
+struct ChannelAnalysis {
+  uint64_t bytes = 0;
+  uint64_t overflow = 0;
+  uint64_t framingErrors = 0;
+  uint64_t parityErrors = 0;
+  uint64_t valueSum = 0;
+
+  uint64_t packets = 0;
+  uint64_t checksumValid = 0;                   // Record framing: PACKET_END verdicts
+  uint64_t checksumError = 0;
+  uint64_t endReasons[4] = {};                  // PacketEndReason (record framing)
+  std::vector<uint64_t> lengths;                // lengths[n]: packets of n bytes (grown as needed)
+  uint64_t lengthMin = UINT64_MAX;
+  uint64_t lengthMax = 0;
+  uint64_t lengthSum = 0;
+
+  uint64_t durations = 0;                       // Packets with a first and last byte
+  uint64_t durationSumNs = 0;                   // First byte to last byte
+  uint64_t durationMaxNs = 0;
+
+  uint64_t gaps[ANALYSIS_GAP_BINS] = {};        // Last byte of a packet to the first of the next
+  uint64_t gapCount = 0;
+  uint64_t gapMinNs = UINT64_MAX;
+  uint64_t gapMaxNs = 0;
+
+  BinCounts rate;                               // Packets ended per rate bin
+
+  void addPacket(uint64_t length, uint64_t endNs, uint64_t rateBinNs) {
+    packets++;
+    uint64_t bin = std::min<uint64_t>(length, ANALYSIS_LENGTH_BINS - 1);
+    if (bin >= lengths.size()) lengths.resize(bin + 1, 0);
+    lengths[bin]++;
+    lengthMin = std::min(lengthMin, length);
+    lengthMax = std::max(lengthMax, length);
+    lengthSum += length;
+    rate.add(endNs / rateBinNs);
+  }
+
+  void addDuration(uint64_t ns) {
+    durations++;
+    durationSumNs += ns;
+    durationMaxNs = std::max(durationMaxNs, ns);
+  }
+
+  void addGap(uint64_t ns) {
+    uint32_t bin = 0;
+    while (bin + 1 < ANALYSIS_GAP_BINS && (ns >> (bin + 1)) != 0) bin++;
+    gaps[bin]++;
+    gapCount++;
+    gapMinNs = std::min(gapMinNs, ns);
+    gapMaxNs = std::max(gapMaxNs, ns);
+  }
+
+  void merge(const ChannelAnalysis& other) {
+    bytes += other.bytes;
+    overflow += other.overflow;
+    framingErrors += other.framingErrors;
+    parityErrors += other.parityErrors;
+    valueSum += other.valueSum;
+    packets += other.packets;
+    checksumValid += other.checksumValid;
+    checksumError += other.checksumError;
+    for (int i = 0; i < 4; i++) endReasons[i] += other.endReasons[i];
+    if (other.lengths.size() > lengths.size()) lengths.resize(other.lengths.size(), 0);
+    for (size_t i = 0; i < other.lengths.size(); i++) lengths[i] += other.lengths[i];
+    lengthMin = std::min(lengthMin, other.lengthMin);
+    lengthMax = std::max(lengthMax, other.lengthMax);
+    lengthSum += other.lengthSum;
+    durations += other.durations;
+    durationSumNs += other.durationSumNs;
+    durationMaxNs = std::max(durationMaxNs, other.durationMaxNs);
+    for (uint32_t i = 0; i < ANALYSIS_GAP_BINS; i++) gaps[i] += other.gaps[i];
+    gapCount += other.gapCount;
+    gapMinNs = std::min(gapMinNs, other.gapMinNs);
+    gapMaxNs = std::max(gapMaxNs, other.gapMaxNs);
+    rate.merge(other.rate);
+  }
+};
+
+/**
+ * Result of CaptureAnalyzer::run()
+ */
+struct CaptureAnalysis {
+  AnalysisFraming framing = ANALYSIS_FRAMING_RECORDS;
+  uint64_t gapNs = 0;                           // Idle framing threshold used
+  uint64_t rateBinNs = ANALYSIS_RATE_BIN_NS;
+
+  uint64_t records = 0;
+  uint64_t firstNs = 0;                         // First and last record (valid if records > 0)
+  uint64_t lastNs = 0;
+  uint64_t malformedLines = 0;                  // CSV lines skipped
+  uint64_t damagedBlocks = 0;                   // Compressed blocks skipped
+  ChannelAnalysis channels[MAX_CAPTURE_CHANNELS];
+  std::vector<BaudChangeEvent> baudChanges;
+
+  // The run itself
+  uint64_t inputBytes = 0;                      // Capture bytes decoded
+  uint64_t fileBytes = 0;
+  TimeIndex::Source index = TimeIndex::SOURCE_NONE;   // Window found with (no window: none)
+  double seconds = 0;
+  unsigned threads = 0;
+  size_t chunks = 0;
+  uint64_t steals = 0;
+};
+
+// ==================== Range Pass ====================
+
+/**
+ * What a range leaves unresolved on one channel: the packet it may
+ * continue from earlier ranges and the packet it leaves open
+ */
+struct PacketEdges {
+  bool hasByte = false;
+  uint64_t lastByteNs = 0;
+
+  // Idle framing: the run of bytes before the range's first gap, and the
+  // run after its last one (split) - without a gap the lead is all of it
+  uint64_t leadStartNs = 0;
+  uint64_t leadLastNs = 0;
+  uint64_t leadLength = 0;
+  bool split = false;
+  uint64_t tailStartNs = 0;
+  uint64_t tailLastNs = 0;
+  uint64_t tailLength = 0;
+
+  // Record framing
+  bool leadEnd = false;                 // PACKET_END before any PACKET_START: closes an earlier packet
+  bool leadEndHasByte = false;          // ... and its last byte is in this range
+  uint64_t leadEndByteNs = 0;
+  bool firstStart = false;              // First PACKET_START; its gap needs the earlier packet
+  uint64_t firstStartNs = 0;
+  bool started = false;                 // Any PACKET_START
+  bool open = false;                    // Last packet not ended in the range
+  uint64_t openStartNs = 0;
+  bool packetByteKnown = false;         // Last byte of the last ended packet (for the next gap)
+  uint64_t packetByteNs = 0;
+};
+
+struct RangeAnalysis {
+  CaptureAnalysis totals;               // Counters and everything local to the range
+  PacketEdges edges[MAX_CAPTURE_CHANNELS];
+};
+
+// ==================== Analyzer ====================
+
+class CaptureAnalyzer {
+ public:
+  explicit CaptureAnalyzer(const AnalysisOptions& options = AnalysisOptions()) : options_(options) {}
+
+  /**
+   * Analyze a capture file (binary or CSV)
+   * @return false if the file cannot be read; error() says why
+   */
+  bool run(const std::string& path, CaptureAnalysis& result) {
+    auto begin = std::chrono::steady_clock::now();
+    result = CaptureAnalysis();
+    CaptureMap map;
+    if (!map.open(path)) {
+      error_ = map.error();
+      return false;
+    }
+    CaptureRange span = map.all();
+    if (windowed()) {
+      TimeIndex index;
+      index.open(path, map);
+      span = index.range(map, options_.startNs, options_.endNs);
+      result.index = index.source();
+    }
+    chooseFraming(map, span, result);
+
+    std::deque<RangeAnalysis> parts;      // Stable addresses while ranges are added
+    WorkStealingPool pool(options_.threads);
+    const AnalysisOptions settings = resolved(result);
+    map.split(span, options_.chunkBytes, [&](const CaptureRange& range) {
+      parts.emplace_back();
+      RangeAnalysis* part = &parts.back();
+      pool.submit([&map, &settings, range, part]() {
+        CaptureCursor cursor = map.cursor(range);
+        cursor.window(settings.startNs, settings.endNs);
+        analyzeRange(cursor, settings, *part);
+        map.file().releaseRange(range.begin, range.end);
+      });
+    });
+    pool.wait();
+
+    Stitcher stitcher(result);
+    for (const RangeAnalysis& part : parts) stitcher.add(part);
+    stitcher.finish();
+
+    result.inputBytes = span.end - span.begin;
+    result.fileBytes = map.size();
+    result.threads = pool.size();
+    result.chunks = parts.size();
+    result.steals = pool.steals();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return true;
+  }
+
+  const std::string& error() const { return error_; }
+
+  /**
+   * Summarize one range on its own (runs on a pool worker)
+   */
+  static void analyzeRange(CaptureCursor cursor, const AnalysisOptions& settings, RangeAnalysis& part) {
+    CaptureAnalysis& totals = part.totals;
+    CaptureColumns columns;
+    columns.allocate(ANALYSIS_BATCH_RECORDS);
+    bool idle = settings.framing == ANALYSIS_FRAMING_IDLE;
+    uint64_t gapNs = settings.gapNs;
+    uint64_t binNs = settings.rateBinNs;
+    // Idle framing: the run in progress per channel; record framing: the
+    // last ended packet's last byte is known inside this range
+    bool inLead[MAX_CAPTURE_CHANNELS] = {};
+    uint64_t runStartNs[MAX_CAPTURE_CHANNELS] = {};
+    uint64_t runLength[MAX_CAPTURE_CHANNELS] = {};
+
+    while (cursor.read(columns) > 0) {
+      if (totals.records == 0) totals.firstNs = columns.timestampNs[0];
+      totals.records += columns.count;
+      totals.lastNs = columns.timestampNs[columns.count - 1];
+
+      for (size_t i = 0; i < columns.count; i++) {
+        uint8_t channel = columns.channel[i] & (MAX_CAPTURE_CHANNELS - 1);
+        uint64_t t = columns.timestampNs[i];
+        uint8_t status = columns.status[i];
+        ChannelAnalysis& stats = totals.channels[channel];
+        PacketEdges& edges = part.edges[channel];
+
+        switch (columns.kind[i]) {
+          case RECORD_KIND_DATA:
+            stats.bytes++;
+            stats.valueSum += columns.value[i];
+            if (status & STATUS_OVERFLOW) stats.overflow++;
+            if (status & STATUS_FRAMING_ERROR) stats.framingErrors++;
+            if (status & STATUS_PARITY_ERROR) stats.parityErrors++;
+            if (idle) {
+              if (!edges.hasByte) {
+                inLead[channel] = true;
+                edges.leadStartNs = t;
+                runStartNs[channel] = t;
+              } else if (t > edges.lastByteNs + gapNs) {
+                if (inLead[channel]) {
+                  edges.leadLastNs = edges.lastByteNs;
+                  edges.leadLength = runLength[channel];
+                  edges.split = true;
+                  inLead[channel] = false;
+                } else {
+                  stats.addPacket(runLength[channel], edges.lastByteNs, binNs);
+                  stats.addDuration(edges.lastByteNs - runStartNs[channel]);
+                }
+                stats.addGap(t - edges.lastByteNs);
+                runStartNs[channel] = t;
+                runLength[channel] = 0;
+              }
+              runLength[channel]++;
+            }
+            edges.hasByte = true;
+            edges.lastByteNs = t;
+            break;
+
+          case RECORD_KIND_PACKET_START:
+            if (idle) break;
+            if (edges.packetByteKnown) {
+              if (t >= edges.packetByteNs) stats.addGap(t - edges.packetByteNs);
+            } else if (!edges.started) {
+              edges.firstStart = true;
+              edges.firstStartNs = t;
+            }
+            edges.started = true;
+            edges.open = true;
+            edges.openStartNs = t;
+            edges.packetByteKnown = false;
+            break;
+
+          case RECORD_KIND_PACKET_END:
+            if (idle) break;
+            stats.addPacket(columns.argument[i], t, binNs);
+            if (columns.value[i] < 4) stats.endReasons[columns.value[i]]++;
+            if (status & STATUS_CHECKSUM_VALID) stats.checksumValid++;
+            if (status & STATUS_CHECKSUM_ERROR) stats.checksumError++;
+            if (edges.open) {
+              if (edges.hasByte && edges.lastByteNs >= edges.openStartNs) {
+                stats.addDuration(edges.lastByteNs - edges.openStartNs);
+              }
+            } else if (!edges.started && !edges.leadEnd) {
+              edges.leadEnd = true;
+              edges.leadEndHasByte = edges.hasByte;
+              edges.leadEndByteNs = edges.lastByteNs;
+            }
+            edges.open = false;
+            edges.packetByteKnown = edges.hasByte;
+            edges.packetByteNs = edges.lastByteNs;
+            break;
+
+          case RECORD_KIND_BAUD_CHANGE:
+            totals.baudChanges.push_back({t, channel, (uint32_t)columns.argument[i]});
+            break;
+
+          default:
+            break;
+        }
+      }
+    }
+
+    for (uint8_t channel = 0; channel < MAX_CAPTURE_CHANNELS; channel++) {
+      PacketEdges& edges = part.edges[channel];
+      if (!idle || !edges.hasByte) continue;
+      if (inLead[channel]) {
+        edges.leadLastNs = edges.lastByteNs;
+        edges.leadLength = runLength[channel];
+      } else {
+        edges.tailStartNs = runStartNs[channel];
+        edges.tailLastNs = edges.lastByteNs;
+        edges.tailLength = runLength[channel];
+      }
+    }
+    totals.malformedLines = cursor.malformedLines();
+    totals.damagedBlocks = cursor.damagedBlocks();
+  }
+
+ private:
+  /**
+   * Merges range results in file order, finishing the packets that cross
+   * range boundaries
+   */
+  class Stitcher {
+   public:
+    explicit Stitcher(CaptureAnalysis& result) : result_(result) {}
+
+    void add(const RangeAnalysis& part) {
+      const CaptureAnalysis& totals = part.totals;
+      if (totals.records > 0) {
+        if (result_.records == 0) result_.firstNs = totals.firstNs;
+        result_.lastNs = totals.lastNs;
+      }
+      result_.records += totals.records;
+      result_.malformedLines += totals.malformedLines;
+      result_.damagedBlocks += totals.damagedBlocks;
+      result_.baudChanges.insert(result_.baudChanges.end(), totals.baudChanges.begin(),
+                                 totals.baudChanges.end());
+      for (uint8_t channel = 0; channel < MAX_CAPTURE_CHANNELS; channel++) {
+        result_.channels[channel].merge(totals.channels[channel]);
+        if (result_.framing == ANALYSIS_FRAMING_IDLE) stitchIdle(channel, part.edges[channel]);
+        else stitchRecords(channel, part.edges[channel]);
+      }
+    }
+
+    // Idle framing: the run still open at the end of the capture
+    void finish() {
+      if (result_.framing != ANALYSIS_FRAMING_IDLE) return;
+      for (uint8_t channel = 0; channel < MAX_CAPTURE_CHANNELS; channel++) {
+        if (state_[channel].open) emitRun(channel);
+      }
+    }
+
+   private:
+    struct Carry {
+      bool hasByte = false;
+      uint64_t lastByteNs = 0;
+      bool open = false;                // Idle: run in progress; records: packet started, not ended
+      uint64_t startNs = 0;
+      uint64_t lastNs = 0;              // Idle: run's last byte
+      uint64_t length = 0;
+      bool packetByteKnown = false;     // Records: last byte of the last ended packet
+      uint64_t packetByteNs = 0;
+    };
+
+    void emitRun(uint8_t channel) {
+      Carry& carry = state_[channel];
+      ChannelAnalysis& stats = result_.channels[channel];
+      stats.addPacket(carry.length, carry.lastNs, result_.rateBinNs);
+      stats.addDuration(carry.lastNs - carry.startNs);
+      carry.open = false;
+    }
+
+    void stitchIdle(uint8_t channel, const PacketEdges& edges) {
+      if (!edges.hasByte) return;
+      Carry& carry = state_[channel];
+      if (carry.open && edges.leadStartNs <= carry.lastNs + result_.gapNs) {
+        carry.length += edges.leadLength;
+        carry.lastNs = edges.leadLastNs;
+      } else {
+        if (carry.open) {
+          emitRun(channel);
+          result_.channels[channel].addGap(edges.leadStartNs - carry.lastNs);
+        }
+        carry.open = true;
+        carry.startNs = edges.leadStartNs;
+        carry.lastNs = edges.leadLastNs;
+        carry.length = edges.leadLength;
+      }
+      if (edges.split) {
+        emitRun(channel);
+        carry.open = true;
+        carry.startNs = edges.tailStartNs;
+        carry.lastNs = edges.tailLastNs;
+        carry.length = edges.tailLength;
+      }
+    }
+
+    void stitchRecords(uint8_t channel, const PacketEdges& edges) {
+      Carry& carry = state_[channel];
+      ChannelAnalysis& stats = result_.channels[channel];
+      if (edges.leadEnd) {
+        bool known = edges.leadEndHasByte || carry.hasByte;
+        uint64_t lastByte = edges.leadEndHasByte ? edges.leadEndByteNs : carry.lastByteNs;
+        if (carry.open && known && lastByte >= carry.startNs) stats.addDuration(lastByte - carry.startNs);
+        carry.open = false;
+        carry.packetByteKnown = known;
+        carry.packetByteNs = lastByte;
+      }
+      if (edges.firstStart && carry.packetByteKnown && edges.firstStartNs >= carry.packetByteNs) {
+        stats.addGap(edges.firstStartNs - carry.packetByteNs);
+      }
+      if (edges.started) {
+        carry.open = edges.open;
+        carry.startNs = edges.openStartNs;
+        carry.packetByteKnown = edges.packetByteKnown;
+        carry.packetByteNs = edges.packetByteNs;
+      }
+      if (edges.hasByte) {
+        carry.hasByte = true;
+        carry.lastByteNs = edges.lastByteNs;
+      }
+    }
+
+    CaptureAnalysis& result_;
+    Carry state_[MAX_CAPTURE_CHANNELS];
+  };
+
+  bool windowed() const { return options_.startNs > 0 || options_.endNs < UINT64_MAX; }
+
+  // Framing and idle threshold from the options, else from the first records
+  void chooseFraming(CaptureMap& map, const CaptureRange& span, CaptureAnalysis& result) {
+    result.rateBinNs = options_.rateBinNs ? options_.rateBinNs : ANALYSIS_RATE_BIN_NS;
+    result.framing = options_.framing;
+    result.gapNs = options_.gapNs;
+    if (result.framing != ANALYSIS_FRAMING_AUTO && (result.framing == ANALYSIS_FRAMING_RECORDS || result.gapNs)) {
+      return;
+    }
+
+    CaptureColumns columns;
+    columns.allocate(ANALYSIS_PROBE_RECORDS);
+    CaptureCursor probe = map.cursor(span);
+    probe.window(options_.startNs, options_.endNs);
+    probe.read(columns);
+    if (result.framing == ANALYSIS_FRAMING_AUTO) {
+      result.framing = ANALYSIS_FRAMING_IDLE;
+      for (size_t i = 0; i < columns.count; i++) {
+        if (columns.kind[i] == RECORD_KIND_PACKET_START) result.framing = ANALYSIS_FRAMING_RECORDS;
+      }
+    }
+    if (result.framing == ANALYSIS_FRAMING_RECORDS || result.gapNs) return;
+
+    uint32_t baud = map.header().baudRate;
+    if (baud > 0) {
+      result.gapNs = (uint64_t)(ANALYSIS_IDLE_CHARACTERS * 10 * 1e9 / baud);
+      return;
+    }
+    std::vector<uint64_t> gaps;
+    bool seen[MAX_CAPTURE_CHANNELS] = {};
+    uint64_t last[MAX_CAPTURE_CHANNELS] = {};
+    for (size_t i = 0; i < columns.count; i++) {
+      if (columns.kind[i] != RECORD_KIND_DATA) continue;
+      uint8_t channel = columns.channel[i] & (MAX_CAPTURE_CHANNELS - 1);
+      uint64_t t = columns.timestampNs[i];
+      if (seen[channel] && t > last[channel]) gaps.push_back(t - last[channel]);
+      seen[channel] = true;
+      last[channel] = t;
+    }
+    double median = 1e6;
+    if (!gaps.empty()) {
+      size_t middle = gaps.size() / 2;
+      std::nth_element(gaps.begin(), gaps.begin() + middle, gaps.end());
+      median = (double)gaps[middle];
+      if (gaps.size() % 2 == 0) {
+        median = (median + (double)*std::max_element(gaps.begin(), gaps.begin() + middle)) / 2;
+      }
+    }
+    result.gapNs = (uint64_t)(ANALYSIS_IDLE_MEDIAN_GAPS * median);
+  }
+
+  AnalysisOptions resolved(const CaptureAnalysis& result) const {
+    AnalysisOptions settings = options_;
+    settings.framing = result.framing;
+    settings.gapNs = result.gapNs;
+    settings.rateBinNs = result.rateBinNs;
+    return settings;
+  }
+
+  AnalysisOptions options_;
+  std::string error_;
+};
+
+#endif // CAPTUREANALYSIS_H
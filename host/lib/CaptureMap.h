@@ -0,0 +1,711 @@
+/*
+ * SerialSniffer Host Tools - Memory-Mapped Capture Reader
+ *
+ * Decodes binary (.ssb, compressed blocks included) and CSV captures
+ * straight out of a read-only memory map into columns (one array per field), a chunk of records at a
+ * time. Files larger than RAM are processed in constant memory: pages
+ * already decoded are released from the map as the reader moves on. The
+ * columns are plain arrays, so the Python module (python/ss_capture.cpp)
+ * hands them to NumPy without copying.
+ *
+ * A capture can also be split into byte ranges that decode independently
+ * (CaptureRange), one CaptureCursor each, for parallel passes
+ * (CaptureAnalysis.h), and narrowed to a time window whose byte range
+ * comes from the time index (TimeIndex.h).
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTUREMAP_H
+#define CAPTUREMAP_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "CaptureFormat.h"
+#include "CycleClock.h"
+
+// ==================== Mapped File ====================
+
+/**
+ * Read-only memory map of a whole file
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    size_ = ok ? (size_t)info.st_size : 0;
+    if (ok && size_ > 0) {
+      void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED) {
+        ok = false;
+        size_ = 0;
+      } else {
+        data_ = (const uint8_t*)map;
+        madvise(map, size_, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(fd);
+    return ok;
+  }
+
+  void close() {
+    if (data_) munmap((void*)data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    released_ = 0;
+  }
+
+  /**
+   * Drop the pages before an offset from the process (they are re-read
+   * from the file if touched again)
+   */
+  void release(size_t upTo) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = upTo / page * page;
+    if (!data_ || end <= released_ + RELEASE_BYTES) return;
+    madvise((void*)(data_ + released_), end - released_, MADV_DONTNEED);
+    released_ = end;
+  }
+
+  /**
+   * Drop the whole pages inside [begin, end) (parallel readers, which
+   * finish ranges out of order)
+   */
+  void releaseRange(size_t begin, size_t end) const {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if (data_ && end > begin) madvise((void*)(data_ + begin), end - begin, MADV_DONTNEED);
+  }
+
+  /**
+   * Start releasing from the beginning again (after a rewind)
+   */
+  void rewind() { released_ = 0; }
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  static const size_t RELEASE_BYTES = 64 * 1024 * 1024;   // Release in large steps
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t released_ = 0;
+};
+
+// ==================== Columns ====================
+
+/**
+ * One chunk of decoded records, a field per array
+ */
+struct CaptureColumns {
+  std::unique_ptr<uint64_t[]> timestampNs;    // Nanoseconds since capture start
+  std::unique_ptr<uint64_t[]> argument;       // Event records: kind-specific value (0 for data)
+  std::unique_ptr<uint8_t[]> kind;            // RecordKind
+  std::unique_ptr<uint8_t[]> channel;         // CaptureChannelId
+  std::unique_ptr<uint8_t[]> value;
+  std::unique_ptr<uint8_t[]> status;          // RecordStatus flags
+  size_t count = 0;
+  size_t capacity = 0;
+
+  // Left uninitialized: every slot up to count is written by the reader
+  void allocate(size_t records) {
+    if (records == capacity) return;
+    timestampNs.reset(new uint64_t[records]);
+    argument.reset(new uint64_t[records]);
+    kind.reset(new uint8_t[records]);
+    channel.reset(new uint8_t[records]);
+    value.reset(new uint8_t[records]);
+    status.reset(new uint8_t[records]);
+    capacity = records;
+    count = 0;
+  }
+};
+
+// ==================== Ranges ====================
+
+enum CaptureFileType : uint8_t {
+  CAPTURE_FILE_BINARY = 0,        // .ssb (any version)
+  CAPTURE_FILE_CSV = 1            // Firmware CSV log or ss_convert output
+};
+
+/**
+ * Records in [begin, end) of a mapped capture; begin is a record (or
+ * line, or block) boundary and ticks the delta sum of every record
+ * before it, so the range decodes without the rest of the file
+ */
+struct CaptureRange {
+  size_t begin = 0;
+  size_t end = 0;
+  uint64_t ticks = 0;
+};
+
+/**
+ * Offset just past the line that contains from (or size)
+ */
+inline size_t csvLineEnd(const uint8_t* data, size_t size, size_t from) {
+  const void* newline = std::memchr(data + from, '\n', size - from);
+  return newline ? (const uint8_t*)newline - data + 1 : size;
+}
+
+// ==================== Cursor ====================
+
+/**
+ * Decodes the records of one CaptureRange into columns
+ */
+class CaptureCursor {
+ public:
+  CaptureCursor() = default;
+  CaptureCursor(const uint8_t* data, CaptureFileType type, const CaptureFileHeader& header,
+                const CaptureRange& range)
+      : data_(data), type_(type), recordFormat_(header.recordFormat), timestampHz_(header.timestampHz),
+        position_(range.begin), end_(range.end), ticks_(range.ticks) {}
+
+  /**
+   * Keep only records stamped in [startNs, endNs]; the range ends at the
+   * first record past endNs (records are in time order)
+   */
+  void window(uint64_t startNs, uint64_t endNs) {
+    startNs_ = startNs;
+    endNs_ = endNs;
+  }
+
+  /**
+   * Decode up to columns.capacity records into columns
+   * @return Records decoded (columns.count); 0 at the end of the range
+   */
+  size_t read(CaptureColumns& columns) {
+    do {
+      columns.count = 0;
+      if (type_ == CAPTURE_FILE_CSV) readCsv(columns);
+      else if (recordFormat_ == RECORD_FORMAT_FIXED) readFixed(columns);
+      else if (recordFormat_ == RECORD_FORMAT_BLOCKS) readBlocks(columns);
+      else readDelta(columns);
+      if (startNs_ > 0 || endNs_ < UINT64_MAX) keepWindow(columns);
+    } while (columns.count == 0 && (position_ < end_ || blockAt_ < blockSize_));   // A whole batch before the window
+    return columns.count;
+  }
+
+  /**
+   * Offset of the next record (compressed: of the block it is in)
+   */
+  size_t position() const { return blockAt_ < blockSize_ ? blockStart_ : position_; }
+  uint64_t malformedLines() const { return malformedLines_; }   // CSV lines skipped
+  uint64_t damagedBlocks() const { return damagedBlocks_; }     // Compressed blocks skipped
+
+ private:
+  // ---------- Binary ----------
+
+  void readFixed(CaptureColumns& columns) {
+    const uint8_t* data = data_;
+    size_t end = end_;
+    size_t n = 0;
+    while (n < columns.capacity && end - position_ >= sizeof(CaptureRecord)) {
+      CaptureRecord record;
+      std::memcpy(&record, data + position_, sizeof(record));
+      position_ += sizeof(record);
+      columns.timestampNs[n] = (uint64_t)record.timestamp * 1000000ULL;
+      columns.argument[n] = 0;
+      columns.kind[n] = RECORD_KIND_DATA;
+      columns.channel[n] = record.channel;
+      columns.value[n] = record.value;
+      columns.status[n] = record.status;
+      n++;
+    }
+    columns.count = n;
+  }
+
+  void readDelta(CaptureColumns& columns) {
+    const uint8_t* data = data_;
+    size_t end = end_;
+    uint32_t hz = timestampHz_;
+    size_t n = 0;
+    while (n < columns.capacity && position_ < end) {
+      size_t left = end - position_;
+      DeltaRecord record;
+      uint32_t used = decodeDeltaRecord(data + position_, left > UINT32_MAX ? UINT32_MAX : (uint32_t)left,
+                                        record);
+      if (used == 0) {
+        position_ = end;          // Trailing partial record
+        break;
+      }
+      position_ += used;
+      ticks_ += record.deltaTicks;
+      columns.timestampNs[n] = ticksToNs(ticks_, hz);
+      columns.argument[n] = record.argument;
+      columns.kind[n] = record.kind;
+      columns.channel[n] = record.channel;
+      columns.value[n] = record.value;
+      columns.status[n] = record.status;
+      n++;
+    }
+    columns.count = n;
+  }
+
+  // Records from the blocks in the range, each block unpacked in turn
+  void readBlocks(CaptureColumns& columns) {
+    uint32_t hz = timestampHz_;
+    size_t n = 0;
+    while (n < columns.capacity) {
+      if (blockAt_ == blockSize_ && !loadBlock()) break;
+      DeltaRecord record;
+      uint32_t used = decodeDeltaRecord(block_.data() + blockAt_, blockSize_ - blockAt_, record);
+      if (used == 0) {
+        blockAt_ = blockSize_;    // Cannot happen in an intact block
+        continue;
+      }
+      blockAt_ += used;
+      ticks_ += record.deltaTicks;
+      columns.timestampNs[n] = ticksToNs(ticks_, hz);
+      columns.argument[n] = record.argument;
+      columns.kind[n] = record.kind;
+      columns.channel[n] = record.channel;
+      columns.value[n] = record.value;
+      columns.status[n] = record.status;
+      n++;
+    }
+    columns.count = n;
+  }
+
+  // Unpack the block at position_; a damaged one is skipped up to the next
+  // block header (a cut-off last block up to the end)
+  bool loadBlock() {
+    blockAt_ = blockSize_ = 0;
+    if (block_.empty()) block_.resize(MAX_BLOCK_RAW_BYTES);
+    while (position_ < end_) {
+      CaptureBlockHeader header;
+      uint32_t used = unpackCaptureBlock(data_ + position_, end_ - position_, header, block_.data());
+      if (used > 0) {
+        blockStart_ = position_;
+        position_ += used;
+        blockSize_ = header.rawBytes;
+        ticks_ = header.baseTicks;
+        return true;
+      }
+      damagedBlocks_++;
+      position_ = findCaptureBlock(data_, position_ + 1, end_);
+    }
+    return false;
+  }
+
+  void keepWindow(CaptureColumns& columns) {
+    size_t kept = 0;
+    for (size_t i = 0; i < columns.count; i++) {
+      uint64_t t = columns.timestampNs[i];
+      if (t < startNs_) continue;
+      if (t > endNs_) {
+        position_ = end_;
+        blockAt_ = blockSize_;
+        break;
+      }
+      if (kept != i) {
+        columns.timestampNs[kept] = t;
+        columns.argument[kept] = columns.argument[i];
+        columns.kind[kept] = columns.kind[i];
+        columns.channel[kept] = columns.channel[i];
+        columns.value[kept] = columns.value[i];
+        columns.status[kept] = columns.status[i];
+      }
+      kept++;
+    }
+    columns.count = kept;
+  }
+
+  // ---------- CSV ----------
+
+  void readCsv(CaptureColumns& columns) {
+    const char* data = (const char*)data_;
+    size_t end = end_;
+    size_t n = 0;
+    while (n < columns.capacity && position_ < end) {
+      size_t next = csvLineEnd(data_, end, position_);
+      const char* at = data + position_;
+      const char* stop = data + next;
+      while (stop > at && (stop[-1] == '\n' || stop[-1] == '\r')) stop--;
+      position_ = next;
+      if (at == stop) continue;
+      if (parseCsvLine(at, stop, columns, n)) n++;
+      else malformedLines_++;
+    }
+    columns.count = n;
+  }
+
+  static bool parseDecimal(const char*& at, const char* stop, uint64_t& value) {
+    const char* first = at;
+    value = 0;
+    while (at < stop && *at >= '0' && *at <= '9') value = value * 10 + (uint64_t)(*at++ - '0');
+    return at > first;
+  }
+
+  static bool expect(const char*& at, const char* stop, char c) {
+    if (at >= stop || *at != c) return false;
+    at++;
+    return true;
+  }
+
+  // Token up to (not including) any of the terminators
+  static size_t token(const char* at, const char* stop, const char* terminators) {
+    const char* end = at;
+    while (end < stop && !std::strchr(terminators, *end)) end++;
+    return end - at;
+  }
+
+  static bool matches(const char* at, size_t length, const char* name) {
+    return std::strlen(name) == length && std::memcmp(at, name, length) == 0;
+  }
+
+  static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+  }
+
+  // OK, or flag names joined with '|'
+  static bool parseStatus(const char* at, size_t length, uint8_t& status) {
+    status = STATUS_OK;
+    const char* stop = at + length;
+    while (at < stop) {
+      size_t part = token(at, stop, "|:");
+      if (matches(at, part, "OK")) {
+      } else if (matches(at, part, "OVERFLOW")) {
+        status |= STATUS_OVERFLOW;
+      } else if (matches(at, part, "FRAMING_ERROR")) {
+        status |= STATUS_FRAMING_ERROR;
+      } else if (matches(at, part, "PARITY_ERROR")) {
+        status |= STATUS_PARITY_ERROR;
+      } else if (matches(at, part, "CHECKSUM_VALID")) {
+        status |= STATUS_CHECKSUM_VALID;
+      } else if (matches(at, part, "CHECKSUM_ERROR")) {
+        status |= STATUS_CHECKSUM_ERROR;
+      } else {
+        return false;
+      }
+      at += part;
+      if (at < stop) at++;
+    }
+    return true;
+  }
+
+  // Timestamp,Direction,0xHH,c,Status  or  Timestamp,Direction,,,KIND=argument[:detail][:checksum status]
+  bool parseCsvLine(const char* at, const char* stop, CaptureColumns& columns, size_t n) {
+    uint64_t timestamp;
+    if (!parseDecimal(at, stop, timestamp) || !expect(at, stop, ',')) return false;
+
+    size_t nameLength = token(at, stop, ",");
+    int channel = -1;
+    for (uint8_t i = 0; i < MAX_CAPTURE_CHANNELS; i++) {
+      if (matches(at, nameLength, captureChannelName(i))) channel = i;
+    }
+    at += nameLength;
+    if (channel < 0 || !expect(at, stop, ',')) return false;
+
+    columns.timestampNs[n] = timestamp;
+    columns.channel[n] = (uint8_t)channel;
+
+    if (at < stop && *at == ',') {
+      // Event line
+      if (!expect(at, stop, ',') || !expect(at, stop, ',')) return false;
+      size_t kindLength = token(at, stop, "=");
+      int kind = -1;
+      for (uint8_t i = RECORD_KIND_DATA + 1; i <= RECORD_KIND_METRIC; i++) {
+        if (matches(at, kindLength, recordKindName(i))) kind = i;
+      }
+      at += kindLength;
+      uint64_t argument;
+      if (kind < 0 || !expect(at, stop, '=') || !parseDecimal(at, stop, argument)) return false;
+
+      uint8_t value = 0;
+      if (at < stop && (kind == RECORD_KIND_PACKET_END || kind == RECORD_KIND_CHECKSUM) &&
+          expect(at, stop, ':')) {
+        size_t detailLength = token(at, stop, ":");
+        bool found = false;
+        for (uint8_t i = 0; i < CHECKSUM_ALGORITHM_COUNT && !found; i++) {
+          const char* name = (kind == RECORD_KIND_PACKET_END) ? packetEndReasonName(i)
+                                                              : checksumAlgorithmName(i);
+          if (matches(at, detailLength, name)) {
+            value = i;
+            found = true;
+          }
+        }
+        if (!found) return false;
+        at += detailLength;
+      } else if (at < stop && kind == RECORD_KIND_METRIC && expect(at, stop, ':')) {
+        size_t nameLength = token(at, stop, ":");
+        if (!parseMetricName(at, (uint32_t)nameLength, value)) return false;
+        at += nameLength;
+      }
+      uint8_t status = STATUS_OK;
+      if (at < stop && (!expect(at, stop, ':') || !parseStatus(at, stop - at, status))) return false;
+
+      columns.kind[n] = (uint8_t)kind;
+      columns.value[n] = value;
+      columns.status[n] = status;
+      columns.argument[n] = argument;
+      return true;
+    }
+
+    // Data line
+    if (stop - at < 7 || at[0] != '0' || at[1] != 'x') return false;
+    int high = hexDigit(at[2]);
+    int low = hexDigit(at[3]);
+    if (high < 0 || low < 0 || at[4] != ',') return false;
+    at += 5;
+
+    // ASCII column: one character, which may itself be ',' or '"' (the
+    // firmware does not quote), or "," and """" from tools that do quote
+    size_t ascii = 1;
+    if (stop - at >= 5 && at[0] == '"' && at[1] == '"' && at[2] == '"' && at[3] == '"') ascii = 4;
+    else if (stop - at >= 4 && at[0] == '"' && at[2] == '"' && at[3] == ',') ascii = 3;
+    at += ascii;
+    uint8_t status;
+    if (!expect(at, stop, ',')) return false;
+    if (!parseStatus(at, stop - at, status)) return false;
+
+    columns.kind[n] = RECORD_KIND_DATA;
+    columns.value[n] = (uint8_t)(high << 4 | low);
+    columns.status[n] = status;
+    columns.argument[n] = 0;
+    return true;
+  }
+
+
+  const uint8_t* data_ = nullptr;
+  CaptureFileType type_ = CAPTURE_FILE_BINARY;
+  uint8_t recordFormat_ = RECORD_FORMAT_DELTA;
+  uint32_t timestampHz_ = 0;
+  size_t position_ = 0;
+  size_t end_ = 0;
+  uint64_t ticks_ = 0;            // Running delta sum
+  uint64_t malformedLines_ = 0;
+  uint64_t startNs_ = 0;          // window()
+  uint64_t endNs_ = UINT64_MAX;
+  std::vector<uint8_t> block_;    // Unpacked records of the current block
+  size_t blockStart_ = 0;         // Its file offset
+  uint32_t blockAt_ = 0;
+  uint32_t blockSize_ = 0;
+  uint64_t damagedBlocks_ = 0;
+};
+
+// ==================== Reader ====================
+
+/**
+ * Chunked columnar reader over a mapped capture file
+ */
+class CaptureMap {
+ public:
+  /**
+   * Map a capture and identify its type (binary header, else CSV)
+   * @return true on success; error() describes the failure otherwise
+   */
+  bool open(const std::string& path) {
+    error_.clear();
+    header_ = CaptureFileHeader();
+    if (!file_.open(path)) {
+      error_ = "cannot open " + path;
+      return false;
+    }
+    if (file_.size() >= sizeof(CaptureFileHeader)) {
+      std::memcpy(&header_, file_.data(), sizeof(header_));
+    }
+    if (header_.magic == CAPTURE_MAGIC) {
+      if (!isValidCaptureHeader(header_)) {
+        error_ = "unsupported capture version or record format";
+        return false;
+      }
+      type_ = CAPTURE_FILE_BINARY;
+      start_ = header_.headerSize > sizeof(header_) ? header_.headerSize : sizeof(header_);
+      if (start_ > file_.size()) start_ = file_.size();
+    } else {
+      type_ = CAPTURE_FILE_CSV;
+      header_ = CaptureFileHeader();
+      header_.timestampHz = 1000000000;
+      start_ = 0;
+      if (file_.size() > 0 && !std::isdigit(file_.data()[0])) {
+        start_ = csvLineEnd(file_.data(), file_.size(), 0);   // Column names
+      }
+    }
+    selection_ = all();
+    startNs_ = 0;
+    endNs_ = UINT64_MAX;
+    rewind();
+    return true;
+  }
+
+  /**
+   * Start over from the first record (of the selection)
+   */
+  void rewind() {
+    cursor_ = cursor(selection_);
+    cursor_.window(startNs_, endNs_);
+    file_.rewind();
+  }
+
+  /**
+   * Read only the records in [startNs, endNs] from now on; range holds
+   * them all (TimeIndex::range()), everything outside it is not touched
+   */
+  void select(const CaptureRange& range, uint64_t startNs, uint64_t endNs) {
+    selection_ = range;
+    if (selection_.end > file_.size()) selection_.end = file_.size();
+    startNs_ = startNs;
+    endNs_ = endNs;
+    rewind();
+  }
+
+  /**
+   * Decode up to columns.capacity records into columns
+   * @return Records decoded (columns.count); 0 at the end of the file
+   */
+  size_t read(CaptureColumns& columns) {
+    cursor_.read(columns);
+    file_.release(cursor_.position());
+    return columns.count;
+  }
+
+  /**
+   * Every record of the file as one range
+   */
+  CaptureRange all() const {
+    CaptureRange range;
+    range.begin = start_;
+    range.end = file_.size();
+    return range;
+  }
+
+  /**
+   * Cut the records into consecutive ranges of about chunkBytes each and
+   * pass them to emit(const CaptureRange&) in file order. CSV and fixed
+   * records are cut directly and compressed captures between blocks
+   * (walked by their headers); delta records carry no sync points, so
+   * their boundaries (and tick sums) come from a walk over the record
+   * lengths, which emits each range as soon as it is found.
+   */
+  template <typename Emit>
+  void split(size_t chunkBytes, Emit&& emit) const {
+    split(all(), chunkBytes, emit);
+  }
+
+  /**
+   * split() over the records of one range only
+   */
+  template <typename Emit>
+  void split(const CaptureRange& within, size_t chunkBytes, Emit&& emit) const {
+    const uint8_t* data = file_.data();
+    size_t end = within.end < file_.size() ? within.end : file_.size();
+    if (chunkBytes == 0) chunkBytes = 1;
+    CaptureRange range = within;
+    while (range.begin < end) {
+      size_t target = (end - range.begin > chunkBytes) ? range.begin + chunkBytes : end;
+      if (type_ == CAPTURE_FILE_CSV) {
+        range.end = (target < end) ? csvLineEnd(data, end, target) : end;
+      } else if (header_.recordFormat == RECORD_FORMAT_FIXED) {
+        size_t records = (target - range.begin + sizeof(CaptureRecord) - 1) / sizeof(CaptureRecord);
+        range.end = range.begin + records * sizeof(CaptureRecord);
+        if (range.end > end) range.end = end;
+      } else if (header_.recordFormat == RECORD_FORMAT_BLOCKS) {
+        size_t at = range.begin;
+        while (at < target) at = nextBlock(at, end);
+        range.end = at;
+        emit((const CaptureRange&)range);
+        range.begin = at;
+        range.ticks = blockTicks(at, end);
+        continue;
+      } else {
+        size_t at = range.begin;
+        uint64_t ticks = range.ticks;
+        while (at < target) {
+          size_t left = end - at;
+          DeltaRecord record;
+          uint32_t used = decodeDeltaRecord(data + at, left > UINT32_MAX ? UINT32_MAX : (uint32_t)left, record);
+          if (used == 0) {
+            at = end;             // Trailing partial record
+            break;
+          }
+          at += used;
+          ticks += record.deltaTicks;
+        }
+        range.end = at;
+        emit((const CaptureRange&)range);
+        range.begin = at;
+        range.ticks = ticks;
+        continue;
+      }
+      emit((const CaptureRange&)range);
+      range.begin = range.end;
+    }
+  }
+
+  /**
+   * Independent decoder over one range (ranges from split() or all())
+   */
+  CaptureCursor cursor(const CaptureRange& range) const {
+    return CaptureCursor(file_.data(), type_, header_, range);
+  }
+
+  const MappedFile& file() const { return file_; }
+  CaptureFileType type() const { return type_; }
+  const CaptureFileHeader& header() const { return header_; }   // CSV: zero but timestampHz
+  size_t size() const { return file_.size(); }
+  size_t position() const { return cursor_.position(); }         // Offset reached by read()
+  const CaptureRange& selection() const { return selection_; }
+  uint64_t malformedLines() const { return cursor_.malformedLines(); }   // CSV lines skipped
+  uint64_t damagedBlocks() const { return cursor_.damagedBlocks(); }     // Compressed blocks skipped
+  const std::string& error() const { return error_; }
+
+ private:
+  // Offset after the block at (its header's sizes), or the next block
+  // header if it is damaged
+  size_t nextBlock(size_t at, size_t end) const {
+    CaptureBlockHeader header;
+    if (end - at >= sizeof(header)) {
+      std::memcpy(&header, file_.data() + at, sizeof(header));
+      if (isCaptureBlockHeader(header) && end - at - sizeof(header) >= header.storedBytes) {
+        return at + sizeof(header) + header.storedBytes;
+      }
+    }
+    return findCaptureBlock(file_.data(), at + 1, end);
+  }
+
+  // Base ticks of the block at (0 if there is none)
+  uint64_t blockTicks(size_t at, size_t end) const {
+    CaptureBlockHeader header;
+    if (end - at < sizeof(header)) return 0;
+    std::memcpy(&header, file_.data() + at, sizeof(header));
+    return isCaptureBlockHeader(header) ? header.baseTicks : 0;
+  }
+
+  MappedFile file_;
+  CaptureFileType type_ = CAPTURE_FILE_BINARY;
+  CaptureFileHeader header_ = {};
+  size_t start_ = 0;              // First record
+  CaptureRange selection_;        // select(), else all()
+  uint64_t startNs_ = 0;
+  uint64_t endNs_ = UINT64_MAX;
+  CaptureCursor cursor_;
+  std::string error_;
+};
+
+#endif // CAPTUREMAP_H
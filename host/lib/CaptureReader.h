@@ -0,0 +1,247 @@
+/*
+ * SerialSniffer Host Tools - Binary Capture Reader
+ *
+ * Streams records out of a binary capture file (.ssb), expanding the
+ * fixed (version 1), delta (version 2+) and compressed block encodings to
+ * absolute times
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CAPTUREREADER_H
+#define CAPTUREREADER_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "CaptureFormat.h"
+#include "CycleClock.h"
+
+/**
+ * One decoded record
+ */
+struct CaptureEvent {
+  uint64_t timestampNs;   // Nanoseconds since capture start
+  uint64_t ticks;         // Raw time in header().timestampHz units (ms for version 1)
+  uint8_t kind;           // RecordKind
+  uint8_t channel;        // CaptureChannelId
+  uint8_t value;
+  uint8_t status;         // RecordStatus flags
+  uint64_t argument;      // Event records: kind-specific value (0 for data)
+};
+
+/**
+ * Sequential reader for binary capture files
+ * Reads in large blocks so multi-GB captures stream in constant memory.
+ */
+class CaptureReader {
+ public:
+  CaptureReader() = default;
+  ~CaptureReader() { close(); }
+
+  CaptureReader(const CaptureReader&) = delete;
+  CaptureReader& operator=(const CaptureReader&) = delete;
+
+  /**
+   * Open a capture file and validate its header
+   * @return true on success; error() describes the failure otherwise
+   */
+  bool open(const std::string& path) {
+    close();
+    error_.clear();
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_) {
+      error_ = "cannot open " + path;
+      return false;
+    }
+    if (std::fread(&header_, sizeof(header_), 1, file_) != 1) {
+      error_ = "file too short for capture header";
+      return false;
+    }
+    if (!isValidCaptureHeader(header_)) {
+      error_ = "not a SerialSniffer binary capture (bad magic or version)";
+      return false;
+    }
+    // Skip any header extension written by newer firmware
+    if (header_.headerSize > sizeof(header_)) {
+      std::fseek(file_, header_.headerSize, SEEK_SET);
+    }
+    buffer_.resize(kBlockBytes);
+    count_ = position_ = 0;
+    ticks_ = 0;
+    blockAt_ = blockSize_ = 0;
+    damagedBlocks_ = 0;
+    if (header_.recordFormat == RECORD_FORMAT_BLOCKS) block_.resize(MAX_BLOCK_RAW_BYTES);
+    return true;
+  }
+
+  void close() {
+    if (file_) {
+      std::fclose(file_);
+      file_ = nullptr;
+    }
+  }
+
+  /**
+   * Fetch the next record
+   * @return false at end of file (a trailing partial record is ignored)
+   */
+  bool next(CaptureEvent& event) {
+    if (header_.recordFormat == RECORD_FORMAT_FIXED) return nextFixed(event);
+    if (header_.recordFormat == RECORD_FORMAT_BLOCKS) return nextInBlock(event);
+    return nextDelta(event);
+  }
+
+  /**
+   * Continue reading at a record boundary (a time index entry)
+   * @param offset Byte offset of a record (or block) in the file
+   * @param ticks Delta sum of every record before it (TimeIndex)
+   */
+  bool seek(uint64_t offset, uint64_t ticks) {
+    if (!file_ || std::fseek(file_, (long)offset, SEEK_SET) != 0) return false;
+    count_ = position_ = 0;
+    ticks_ = ticks;
+    blockAt_ = blockSize_ = 0;
+    return true;
+  }
+
+  /**
+   * Tick rate of CaptureEvent::ticks
+   */
+  uint32_t timestampHz() const {
+    return header_.recordFormat == RECORD_FORMAT_FIXED ? 1000 : header_.timestampHz;
+  }
+
+  const CaptureFileHeader& header() const { return header_; }
+  uint64_t damagedBlocks() const { return damagedBlocks_; }     // Compressed blocks skipped
+  const std::string& error() const { return error_; }
+
+ private:
+  static const size_t kBlockBytes = 512 * 1024;
+
+  // Make at least `needed` bytes readable at position_, keeping unread bytes
+  bool fill(size_t needed) {
+    if (count_ - position_ >= needed) return true;
+    if (!file_) return false;
+    size_t left = count_ - position_;
+    std::memmove(buffer_.data(), buffer_.data() + position_, left);
+    count_ = left + std::fread(buffer_.data() + left, 1, buffer_.size() - left, file_);
+    position_ = 0;
+    return count_ >= needed;
+  }
+
+  bool nextFixed(CaptureEvent& event) {
+    if (!fill(sizeof(CaptureRecord))) return false;
+    CaptureRecord record;
+    std::memcpy(&record, buffer_.data() + position_, sizeof(record));
+    position_ += sizeof(record);
+
+    event.ticks = record.timestamp;
+    event.timestampNs = (uint64_t)record.timestamp * 1000000ULL;
+    event.kind = RECORD_KIND_DATA;
+    event.argument = 0;
+    event.channel = record.channel;
+    event.value = record.value;
+    event.status = record.status;
+    return true;
+  }
+
+  bool nextDelta(CaptureEvent& event) {
+    // Refill when a whole record might not be buffered
+    fill(MAX_EVENT_RECORD_SIZE);
+    const uint8_t* data = buffer_.data() + position_;
+    uint32_t available = (uint32_t)(count_ - position_);
+
+    DeltaRecord record;
+    uint32_t used = decodeDeltaRecord(data, available, record);
+    if (used == 0) return false;
+    position_ += used;
+
+    setDelta(record, event);
+    return true;
+  }
+
+  bool nextInBlock(CaptureEvent& event) {
+    DeltaRecord record;
+    uint32_t used = 0;
+    while (used == 0) {
+      if (blockAt_ == blockSize_ && !loadBlock()) return false;
+      used = decodeDeltaRecord(block_.data() + blockAt_, blockSize_ - blockAt_, record);
+      blockAt_ = used ? blockAt_ + used : blockSize_;
+    }
+    setDelta(record, event);
+    return true;
+  }
+
+  // Unpack the next block; a damaged one is skipped up to the next block
+  // header (a cut-off last block up to the end of the file)
+  bool loadBlock() {
+    blockAt_ = blockSize_ = 0;
+    for (;;) {
+      fill(sizeof(CaptureBlockHeader));
+      size_t available = count_ - position_;
+      if (available < sizeof(CaptureBlockHeader)) {
+        if (available > 0) damagedBlocks_++;        // Cut off inside a header
+        position_ = count_;
+        return false;
+      }
+      CaptureBlockHeader header;
+      std::memcpy(&header, buffer_.data() + position_, sizeof(header));
+      if (isCaptureBlockHeader(header)) {
+        fill(sizeof(header) + header.storedBytes);
+        uint32_t used = unpackCaptureBlock(buffer_.data() + position_, count_ - position_, header, block_.data());
+        if (used > 0) {
+          position_ += used;
+          blockSize_ = header.rawBytes;
+          ticks_ = header.baseTicks;
+          return true;
+        }
+      }
+      damagedBlocks_++;
+      for (;;) {
+        // Resync: next header in the buffer, else keep the bytes not yet
+        // searched and read on
+        size_t next = findCaptureBlock(buffer_.data(), position_ + 1, count_);
+        if (next < count_) {
+          position_ = next;
+          break;
+        }
+        position_ = count_ - sizeof(CaptureBlockHeader);
+        size_t before = count_ - position_;
+        fill(buffer_.size() / 2);
+        if (count_ - position_ == before) {           // End of file
+          position_ = count_;
+          return false;
+        }
+      }
+    }
+  }
+
+  void setDelta(const DeltaRecord& record, CaptureEvent& event) {
+    ticks_ += record.deltaTicks;
+    event.ticks = ticks_;
+    event.timestampNs = ticksToNs(ticks_, header_.timestampHz);
+    event.kind = record.kind;
+    event.channel = record.channel;
+    event.value = record.value;
+    event.status = record.status;
+    event.argument = record.argument;
+  }
+
+  std::FILE* file_ = nullptr;
+  CaptureFileHeader header_ = {};
+  std::vector<uint8_t> buffer_;
+  size_t count_ = 0;
+  size_t position_ = 0;
+  uint64_t ticks_ = 0;      // Running delta sum
+  std::vector<uint8_t> block_;    // Unpacked records of the current block
+  uint32_t blockAt_ = 0;
+  uint32_t blockSize_ = 0;
+  uint64_t damagedBlocks_ = 0;
+  std::string error_;
+};
+
+#endif // CAPTUREREADER_H
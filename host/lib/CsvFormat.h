@@ -0,0 +1,68 @@
+/*
+ * SerialSniffer Host Tools - CSV Formatting
+ *
+ * Produces the same Timestamp,Direction,Value_Hex,Value_ASCII,Status lines
+ * the firmware writes in CSV log mode (status text and line end come from
+ * the shared CaptureCsv.h).
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CSVFORMAT_H
+#define CSVFORMAT_H
+
+#include <cstdio>
+#include <string>
+
+#include "CaptureCsv.h"
+#include "CaptureFormat.h"
+#include "CaptureReader.h"
+#include "PacketAssembler.h"
+
+const char* const PACKET_CSV_HEADER =
+    "Start_Timestamp,End_Timestamp,Direction,Packet,Length,End_Reason,Status,Data_Hex";
+
+/**
+ * Direction column text for a channel id
+ */
+inline const char* channelName(uint8_t channel) {
+  return captureChannelName(channel);
+}
+
+/**
+ * Status column text; flags are joined with '|'
+ */
+inline std::string statusToString(uint8_t status) {
+  char text[MAX_CSV_STATUS_SIZE];
+  return std::string(text, formatCsvStatus(text, status));
+}
+
+/**
+ * Write one captured byte as a CSV line (Timestamp in ns since capture start)
+ */
+inline void writeCsvLine(std::FILE* out, const CaptureEvent& event) {
+  char ascii = (event.value >= 32 && event.value <= 126) ? (char)event.value : '.';
+  std::fprintf(out, "%llu,%s,0x%02X,%c,%s%s",
+               (unsigned long long)event.timestampNs, channelName(event.channel),
+               event.value, ascii, statusToString(event.status).c_str(), CSV_LINE_END);
+}
+
+/**
+ * Write one framed packet as a CSV line (timestamps in ns, data as hex)
+ */
+inline void writePacketCsvLine(std::FILE* out, const CapturedPacket& packet) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  std::string hex;
+  hex.reserve(packet.data.size() * 2);
+  for (uint8_t value : packet.data) {
+    hex += HEX_DIGITS[value >> 4];
+    hex += HEX_DIGITS[value & 0x0F];
+  }
+  std::fprintf(out, "%llu,%llu,%s,%llu,%zu,%s,%s,%s%s", (unsigned long long)packet.startNs,
+               (unsigned long long)packet.endNs, channelName(packet.channel),
+               (unsigned long long)packet.number, packet.data.size(),
+               packetEndReasonName(packet.endReason), statusToString(packet.status).c_str(),
+               hex.c_str(), CSV_LINE_END);
+}
+
+#endif // CSVFORMAT_H
@@ -0,0 +1,869 @@
+/*
+ * SerialSniffer Host Tools - Vectorized Hex/ASCII Export Formatting
+ *
+ * Turns decoded records into text fast enough for multi-GB conversions
+ * (FR-008):
+ *   - CsvExporter: the Timestamp,Direction,Value_Hex,Value_ASCII,Status
+ *     lines of writeCsvLine() (CsvFormat.h), byte for byte
+ *   - HexDumper: a classic hex dump of each channel's byte stream, 16
+ *     bytes per row in two groups of 8 after a hex offset, with an |ASCII|
+ *     gutter (the layout of hexdump -C, every row shown as with -v)
+ *
+ * Records are formatted in batches instead of one fprintf() per byte.
+ * CSV: 32 records at a time, whose hex digits and ASCII characters come
+ * out of one or two vector steps; timestamps are converted to decimal
+ * eight digits per vector step (16-bit lanes divided by powers of ten
+ * with multiply-high), leading zeros dropped with one shuffle. Dump: one
+ * row (SSSE3) or two rows (AVX2) per step. Each kernel has a portable
+ * scalar twin producing identical text, and the kernel is chosen at run
+ * time from the CPU's features (bestFormatKernel()), so one binary runs
+ * on any x86-64 and non-x86 hosts use the scalar code.
+ *
+ * Text goes through a fixed-size buffer (TextOutput) that is written out
+ * whenever it fills: memory use does not grow with the capture.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef HEXFORMAT_H
+#define HEXFORMAT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "CaptureFormat.h"
+#include "CsvFormat.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HEXFORMAT_X86 1
+#include <immintrin.h>
+#define HEXFORMAT_SSSE3 __attribute__((target("ssse3")))
+#define HEXFORMAT_AVX2 __attribute__((target("avx2")))
+#else
+#define HEXFORMAT_X86 0
+#endif
+
+// ==================== Kernels ====================
+
+enum FormatKernel : uint8_t {
+  FORMAT_SCALAR = 0,
+  FORMAT_SSSE3 = 1,               // 16 bytes per vector (x86 SSSE3 shuffles)
+  FORMAT_AVX2 = 2,                // 32 bytes per vector
+  FORMAT_KERNEL_COUNT = 3
+};
+
+inline const char* formatKernelName(FormatKernel kernel) {
+  switch (kernel) {
+    case FORMAT_SCALAR: return "scalar";
+    case FORMAT_SSSE3: return "ssse3";
+    case FORMAT_AVX2: return "avx2";
+    default: return "?";
+  }
+}
+
+/**
+ * Kernel from its name
+ * @return false for an unknown name
+ */
+inline bool parseFormatKernel(const char* name, FormatKernel& kernel) {
+  for (uint8_t i = 0; i < FORMAT_KERNEL_COUNT; i++) {
+    if (std::strcmp(name, formatKernelName((FormatKernel)i)) == 0) {
+      kernel = (FormatKernel)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Whether this CPU runs a kernel
+ */
+inline bool formatKernelSupported(FormatKernel kernel) {
+  if (kernel == FORMAT_SCALAR) return true;
+#if HEXFORMAT_X86
+  if (kernel == FORMAT_SSSE3) return __builtin_cpu_supports("ssse3");
+  if (kernel == FORMAT_AVX2) return __builtin_cpu_supports("avx2");
+#endif
+  return false;
+}
+
+/**
+ * Fastest kernel this CPU runs
+ */
+inline FormatKernel bestFormatKernel() {
+  if (formatKernelSupported(FORMAT_AVX2)) return FORMAT_AVX2;
+  if (formatKernelSupported(FORMAT_SSSE3)) return FORMAT_SSSE3;
+  return FORMAT_SCALAR;
+}
+
+// ==================== Output Buffer ====================
+
+/**
+ * Fixed-size text buffer in front of a FILE*
+ *
+ * Formatters reserve() room for a whole batch, write straight into the
+ * buffer (vector stores may run past the text they keep, never past the
+ * reserved room) and commit() where the text ends.
+ */
+class TextOutput {
+ public:
+  static const size_t CAPACITY = 1 << 20;
+
+  explicit TextOutput(std::FILE* out) : out_(out), buffer_(new char[CAPACITY]) {}
+  ~TextOutput() { flush(); }
+
+  TextOutput(const TextOutput&) = delete;
+  TextOutput& operator=(const TextOutput&) = delete;
+
+  /**
+   * Room for bytes more (at most CAPACITY), writing out the buffer first
+   * if needed
+   * @return Where to write
+   */
+  char* reserve(size_t bytes) {
+    if (used_ + bytes > CAPACITY) flush();
+    return buffer_.get() + used_;
+  }
+
+  /**
+   * Keep the text up to end (inside the last reserve())
+   */
+  void commit(char* end) { used_ = (size_t)(end - buffer_.get()); }
+
+  void write(const char* text, size_t length) {
+    while (length > 0) {
+      size_t room = CAPACITY - used_;
+      if (room == 0) {
+        flush();
+        room = CAPACITY;
+      }
+      size_t part = length < room ? length : room;
+      std::memcpy(buffer_.get() + used_, text, part);
+      used_ += part;
+      text += part;
+      length -= part;
+    }
+  }
+
+  void write(const char* text) { write(text, std::strlen(text)); }
+
+  /**
+   * Write out the buffered text
+   * @return false if this or an earlier write failed
+   */
+  bool flush() {
+    if (used_ > 0 && !failed_) {
+      failed_ = std::fwrite(buffer_.get(), 1, used_, out_) != used_;
+      written_ += used_;
+    }
+    used_ = 0;
+    return !failed_;
+  }
+
+  bool failed() const { return failed_; }
+  uint64_t bytesWritten() const { return written_ + used_; }
+
+ private:
+  std::FILE* out_;
+  std::unique_ptr<char[]> buffer_;
+  size_t used_ = 0;
+  uint64_t written_ = 0;
+  bool failed_ = false;
+};
+
+// ==================== Scalar Helpers ====================
+
+struct DigitPairTable {
+  char text[200];                 // "00" "01" ... "99"
+};
+
+constexpr DigitPairTable makeDigitPairs() {
+  DigitPairTable table = {};
+  for (uint32_t i = 0; i < 100; i++) {
+    table.text[2 * i] = (char)('0' + i / 10);
+    table.text[2 * i + 1] = (char)('0' + i % 10);
+  }
+  return table;
+}
+
+constexpr DigitPairTable DIGIT_PAIRS = makeDigitPairs();
+
+const char HEX_UPPER[] = "0123456789ABCDEF";
+const char HEX_LOWER[] = "0123456789abcdef";
+
+/**
+ * Decimal text of value, two digits per step
+ * @return End of the text
+ */
+inline char* writeDecimal(char* out, uint64_t value) {
+  char digits[20];
+  char* p = digits + sizeof(digits);
+  while (value >= 100) {
+    uint64_t quotient = value / 100;
+    uint32_t pair = (uint32_t)(value - quotient * 100);
+    p -= 2;
+    std::memcpy(p, DIGIT_PAIRS.text + 2 * pair, 2);
+    value = quotient;
+  }
+  if (value >= 10) {
+    p -= 2;
+    std::memcpy(p, DIGIT_PAIRS.text + 2 * value, 2);
+  } else {
+    *--p = (char)('0' + value);
+  }
+  size_t length = (size_t)(digits + sizeof(digits) - p);
+  std::memcpy(out, p, length);
+  return out + length;
+}
+
+/**
+ * Lowercase hex dump offset: 8 digits, more once it passes 4 GiB
+ */
+inline char* writeHexOffset(char* out, uint64_t offset) {
+  int digits = 8;
+  while (digits < 16 && (offset >> (4 * digits)) != 0) digits++;
+  for (int i = digits - 1; i >= 0; i--) *out++ = HEX_LOWER[(offset >> (4 * i)) & 0x0F];
+  return out;
+}
+
+inline char asciiOrDot(uint8_t value) {
+  return (value >= 32 && value <= 126) ? (char)value : '.';
+}
+
+// ==================== Vector Helpers ====================
+
+#if HEXFORMAT_X86
+
+/**
+ * Eight decimal digits (one per 16-bit lane, most significant first) of
+ * a value below 10^8: divmod 10^4 with a multiply-shift, then each half
+ * divided by 10^3, 10^2, 10^1, 10^0 in parallel with multiply-high (the
+ * first step by 4 * 2^16 / 10^k, rounded up, the second step finishing
+ * the shift), and the tens taken out of every lane
+ */
+HEXFORMAT_SSSE3 inline __m128i decimal8Ssse3(uint32_t value) {
+  const __m128i abcdefgh = _mm_cvtsi32_si128((int)value);
+  const __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, _mm_set1_epi32((int)0xD1B71759)), 45);
+  const __m128i efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+  const __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+  const __m128i v2a = _mm_unpacklo_epi16(v1, v1);
+  const __m128i v2 = _mm_unpacklo_epi32(v2a, v2a);
+  const __m128i v3 = _mm_mulhi_epu16(v2, _mm_setr_epi16(8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+  const __m128i v4 = _mm_mulhi_epu16(v3, _mm_setr_epi16(128, 2048, 8192, -32768, 128, 2048, 8192, -32768));
+  const __m128i v5 = _mm_slli_epi64(_mm_mullo_epi16(v4, _mm_set1_epi16(10)), 16);
+  return _mm_sub_epi16(v4, v5);
+}
+
+/**
+ * decimal8Ssse3() of two values at once, a in the low lane, b in the high
+ */
+HEXFORMAT_AVX2 inline __m256i decimal8x2Avx2(uint32_t a, uint32_t b) {
+  const __m256i abcdefgh = _mm256_set_epi64x(0, b, 0, a);
+  const __m256i abcd = _mm256_srli_epi64(_mm256_mul_epu32(abcdefgh, _mm256_set1_epi32((int)0xD1B71759)), 45);
+  const __m256i efgh = _mm256_sub_epi32(abcdefgh, _mm256_mul_epu32(abcd, _mm256_set1_epi32(10000)));
+  const __m256i v1 = _mm256_slli_epi64(_mm256_unpacklo_epi16(abcd, efgh), 2);
+  const __m256i v2a = _mm256_unpacklo_epi16(v1, v1);
+  const __m256i v2 = _mm256_unpacklo_epi32(v2a, v2a);
+  const __m256i v3 = _mm256_mulhi_epu16(v2, _mm256_setr_epi16(8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768,
+                                                              8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+  const __m256i v4 = _mm256_mulhi_epu16(v3, _mm256_setr_epi16(128, 2048, 8192, -32768, 128, 2048, 8192, -32768,
+                                                              128, 2048, 8192, -32768, 128, 2048, 8192, -32768));
+  const __m256i v5 = _mm256_slli_epi64(_mm256_mullo_epi16(v4, _mm256_set1_epi16(10)), 16);
+  return _mm256_sub_epi16(v4, v5);
+}
+
+// Shuffle that moves bytes down by n: load 16 bytes at SHIFT_DOWN + n
+alignas(32) const int8_t SHIFT_DOWN[32] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+  -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128
+};
+
+/**
+ * Store 16 ASCII digits with their leading zeros dropped (one digit kept)
+ * @return End of the text (16 bytes are stored)
+ */
+HEXFORMAT_SSSE3 inline char* storeDigitsSsse3(char* out, __m128i digits) {
+  uint32_t zeros = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(digits, _mm_set1_epi8('0')));
+  uint32_t skip = (uint32_t)__builtin_ctz(~zeros | 0x8000);
+  digits = _mm_shuffle_epi8(digits, _mm_loadu_si128((const __m128i*)(SHIFT_DOWN + skip)));
+  _mm_storeu_si128((__m128i*)out, digits);
+  return out + 16 - skip;
+}
+
+/**
+ * Decimal text of value (stores up to 20 bytes)
+ */
+HEXFORMAT_SSSE3 inline char* writeDecimalSsse3(char* out, uint64_t value) {
+  uint64_t high = value / 100000000;
+  uint32_t low = (uint32_t)(value - high * 100000000);
+  bool full = high >= 100000000;
+  if (full) {
+    out = writeDecimal(out, high / 100000000);
+    high %= 100000000;
+  }
+  __m128i digits = _mm_add_epi8(_mm_packus_epi16(decimal8Ssse3((uint32_t)high), decimal8Ssse3(low)),
+                                _mm_set1_epi8('0'));
+  if (!full) return storeDigitsSsse3(out, digits);
+  _mm_storeu_si128((__m128i*)out, digits);
+  return out + 16;
+}
+
+/**
+ * Hex digit characters of each byte's high and low nibble
+ */
+HEXFORMAT_SSSE3 inline void hexNibblesSsse3(__m128i bytes, __m128i table, __m128i& high, __m128i& low) {
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+  low = _mm_shuffle_epi8(table, _mm_and_si128(bytes, mask));
+}
+
+HEXFORMAT_AVX2 inline void hexNibblesAvx2(__m256i bytes, __m256i table, __m256i& high, __m256i& low) {
+  const __m256i mask = _mm256_set1_epi8(0x0F);
+  high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+  low = _mm256_shuffle_epi8(table, _mm256_and_si256(bytes, mask));
+}
+
+/**
+ * Printable bytes (32-126) as they are, others as '.'
+ */
+HEXFORMAT_SSSE3 inline __m128i asciiSsse3(__m128i bytes) {
+  __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(31)),
+                                    _mm_cmplt_epi8(bytes, _mm_set1_epi8(127)));
+  return _mm_or_si128(_mm_and_si128(printable, bytes), _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+}
+
+HEXFORMAT_AVX2 inline __m256i asciiAvx2(__m256i bytes) {
+  __m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(31)),
+                                       _mm256_cmpgt_epi8(_mm256_set1_epi8(127), bytes));
+  return _mm256_blendv_epi8(_mm256_set1_epi8('.'), bytes, printable);
+}
+
+#endif // HEXFORMAT_X86
+
+// ==================== CSV ====================
+
+/**
+ * Records waiting to be formatted, one array per field
+ */
+struct CsvBatch {
+  static const uint32_t SIZE = 32;
+
+  uint64_t timestampNs[SIZE];
+  uint8_t channel[SIZE];
+  uint8_t value[SIZE];
+  uint8_t status[SIZE];
+  uint32_t count;
+};
+
+/**
+ * Precomputed Direction and Status columns
+ */
+struct CsvTables {
+  static const uint32_t STATUS_SLOT = 80;
+
+  char direction[256][8];         // ",RX"
+  uint8_t directionLength[256];
+  char status[256][STATUS_SLOT];  // "OK\n"
+  uint8_t statusLength[256];
+
+  void build() {
+    std::memset(this, 0, sizeof(*this));
+    for (uint32_t i = 0; i < 256; i++) {
+      int length = std::snprintf(direction[i], sizeof(direction[i]), ",%s", channelName((uint8_t)i));
+      directionLength[i] = (uint8_t)length;
+      length = std::snprintf(status[i], STATUS_SLOT, "%s%s", statusToString((uint8_t)i).c_str(), CSV_LINE_END);
+      statusLength[i] = (uint8_t)length;
+    }
+  }
+};
+
+/**
+ * Longest line, plus what vector stores may write past it
+ */
+const size_t CSV_LINE_ROOM = 128;
+
+/**
+ * Everything after the timestamp: direction, the ",0xHH,c," value field
+ * (8 bytes), status and newline
+ */
+inline char* writeCsvTail(char* p, const CsvTables& tables, uint8_t channel, const char* field, uint8_t status) {
+  std::memcpy(p, tables.direction[channel], 8);
+  p += tables.directionLength[channel];
+  std::memcpy(p, field, 8);
+  p += 8;
+  if (tables.statusLength[status] <= 16) {
+    std::memcpy(p, tables.status[status], 16);
+  } else {
+    std::memcpy(p, tables.status[status], CsvTables::STATUS_SLOT);
+  }
+  return p + tables.statusLength[status];
+}
+
+inline char* formatCsvScalar(char* p, const CsvBatch& batch, const CsvTables& tables) {
+  for (uint32_t i = 0; i < batch.count; i++) {
+    uint8_t value = batch.value[i];
+    char field[8] = {',', '0', 'x', HEX_UPPER[value >> 4], HEX_UPPER[value & 0x0F], ',', asciiOrDot(value), ','};
+    p = writeDecimal(p, batch.timestampNs[i]);
+    p = writeCsvTail(p, tables, batch.channel[i], field, batch.status[i]);
+  }
+  return p;
+}
+
+#if HEXFORMAT_X86
+
+// ",0x" below the hex digits, "," above the ASCII character
+const uint64_t CSV_FIELD_FRAME = 0x2C0000000078302CULL;
+
+/**
+ * [H, L, ',', c] of 16 values, 4 per vector, in order
+ */
+HEXFORMAT_SSSE3 inline void csvFieldsSsse3(const uint8_t* values, uint32_t* fields) {
+  const __m128i table = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+  const __m128i commas = _mm_set1_epi8(',');
+  __m128i bytes = _mm_loadu_si128((const __m128i*)values);
+  __m128i high, low;
+  hexNibblesSsse3(bytes, table, high, low);
+  __m128i ascii = asciiSsse3(bytes);
+  __m128i pairsLow = _mm_unpacklo_epi8(high, low);
+  __m128i pairsHigh = _mm_unpackhi_epi8(high, low);
+  __m128i charsLow = _mm_unpacklo_epi8(commas, ascii);
+  __m128i charsHigh = _mm_unpackhi_epi8(commas, ascii);
+  _mm_storeu_si128((__m128i*)fields, _mm_unpacklo_epi16(pairsLow, charsLow));
+  _mm_storeu_si128((__m128i*)(fields + 4), _mm_unpackhi_epi16(pairsLow, charsLow));
+  _mm_storeu_si128((__m128i*)(fields + 8), _mm_unpacklo_epi16(pairsHigh, charsHigh));
+  _mm_storeu_si128((__m128i*)(fields + 12), _mm_unpackhi_epi16(pairsHigh, charsHigh));
+}
+
+HEXFORMAT_SSSE3 inline char* writeCsvLineSsse3(char* p, const CsvTables& tables, uint64_t timestampNs,
+                                               uint8_t channel, uint32_t fields, uint8_t status) {
+  uint64_t field = CSV_FIELD_FRAME | ((uint64_t)fields << 24);
+  p = writeDecimalSsse3(p, timestampNs);
+  return writeCsvTail(p, tables, channel, (const char*)&field, status);
+}
+
+HEXFORMAT_SSSE3 inline char* formatCsvSsse3(char* p, const CsvBatch& batch, const CsvTables& tables) {
+  uint32_t fields[CsvBatch::SIZE];
+  csvFieldsSsse3(batch.value, fields);
+  if (batch.count > 16) csvFieldsSsse3(batch.value + 16, fields + 16);
+  for (uint32_t i = 0; i < batch.count; i++) {
+    p = writeCsvLineSsse3(p, tables, batch.timestampNs[i], batch.channel[i], fields[i], batch.status[i]);
+  }
+  return p;
+}
+
+/**
+ * [H, L, ',', c] of 32 values; the in-lane unpacks leave values 0-3 and
+ * 16-19 in one vector, so lanes are swapped back into order
+ */
+HEXFORMAT_AVX2 inline void csvFieldsAvx2(const uint8_t* values, uint32_t* fields) {
+  const __m256i table = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+                                         '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+  const __m256i commas = _mm256_set1_epi8(',');
+  __m256i bytes = _mm256_loadu_si256((const __m256i*)values);
+  __m256i high, low;
+  hexNibblesAvx2(bytes, table, high, low);
+  __m256i ascii = asciiAvx2(bytes);
+  __m256i pairsLow = _mm256_unpacklo_epi8(high, low);
+  __m256i pairsHigh = _mm256_unpackhi_epi8(high, low);
+  __m256i charsLow = _mm256_unpacklo_epi8(commas, ascii);
+  __m256i charsHigh = _mm256_unpackhi_epi8(commas, ascii);
+  __m256i f0 = _mm256_unpacklo_epi16(pairsLow, charsLow);     // 0-3, 16-19
+  __m256i f1 = _mm256_unpackhi_epi16(pairsLow, charsLow);     // 4-7, 20-23
+  __m256i f2 = _mm256_unpacklo_epi16(pairsHigh, charsHigh);   // 8-11, 24-27
+  __m256i f3 = _mm256_unpackhi_epi16(pairsHigh, charsHigh);   // 12-15, 28-31
+  _mm256_storeu_si256((__m256i*)fields, _mm256_permute2x128_si256(f0, f1, 0x20));
+  _mm256_storeu_si256((__m256i*)(fields + 8), _mm256_permute2x128_si256(f2, f3, 0x20));
+  _mm256_storeu_si256((__m256i*)(fields + 16), _mm256_permute2x128_si256(f0, f1, 0x31));
+  _mm256_storeu_si256((__m256i*)(fields + 24), _mm256_permute2x128_si256(f2, f3, 0x31));
+}
+
+/**
+ * Two timestamps per decimal step while both are below 10^16
+ */
+HEXFORMAT_AVX2 inline char* formatCsvAvx2(char* p, const CsvBatch& batch, const CsvTables& tables) {
+  const uint64_t LIMIT = 10000000000000000ULL;
+  uint32_t fields[CsvBatch::SIZE];
+  csvFieldsAvx2(batch.value, fields);
+  uint32_t i = 0;
+  for (; i + 1 < batch.count; i += 2) {
+    uint64_t a = batch.timestampNs[i];
+    uint64_t b = batch.timestampNs[i + 1];
+    if (a >= LIMIT || b >= LIMIT) {
+      p = writeCsvLineSsse3(p, tables, a, batch.channel[i], fields[i], batch.status[i]);
+      p = writeCsvLineSsse3(p, tables, b, batch.channel[i + 1], fields[i + 1], batch.status[i + 1]);
+      continue;
+    }
+    uint64_t aHigh = a / 100000000;
+    uint64_t bHigh = b / 100000000;
+    __m256i highs = decimal8x2Avx2((uint32_t)aHigh, (uint32_t)bHigh);
+    __m256i lows = decimal8x2Avx2((uint32_t)(a - aHigh * 100000000), (uint32_t)(b - bHigh * 100000000));
+    __m256i digits = _mm256_add_epi8(_mm256_packus_epi16(highs, lows), _mm256_set1_epi8('0'));
+
+    uint64_t field = CSV_FIELD_FRAME | ((uint64_t)fields[i] << 24);
+    p = storeDigitsSsse3(p, _mm256_castsi256_si128(digits));
+    p = writeCsvTail(p, tables, batch.channel[i], (const char*)&field, batch.status[i]);
+    field = CSV_FIELD_FRAME | ((uint64_t)fields[i + 1] << 24);
+    p = storeDigitsSsse3(p, _mm256_extracti128_si256(digits, 1));
+    p = writeCsvTail(p, tables, batch.channel[i + 1], (const char*)&field, batch.status[i + 1]);
+  }
+  if (i < batch.count) {
+    p = writeCsvLineSsse3(p, tables, batch.timestampNs[i], batch.channel[i], fields[i], batch.status[i]);
+  }
+  return p;
+}
+
+#endif // HEXFORMAT_X86
+
+/**
+ * Streams DATA records as CSV lines (writeCsvLine() format)
+ */
+class CsvExporter {
+ public:
+  explicit CsvExporter(TextOutput& output, FormatKernel kernel = bestFormatKernel())
+      : output_(output), kernel_(formatKernelSupported(kernel) ? kernel : FORMAT_SCALAR),
+        tables_(new CsvTables()) {
+    tables_->build();
+    std::memset(&batch_, 0, sizeof(batch_));
+  }
+
+  void writeHeader() {
+    output_.write(CSV_HEADER);
+    output_.write(CSV_LINE_END);
+  }
+
+  void add(uint64_t timestampNs, uint8_t channel, uint8_t value, uint8_t status) {
+    uint32_t i = batch_.count;
+    batch_.timestampNs[i] = timestampNs;
+    batch_.channel[i] = channel;
+    batch_.value[i] = value;
+    batch_.status[i] = status;
+    batch_.count = i + 1;
+    if (batch_.count == CsvBatch::SIZE) formatBatch();
+  }
+
+  /**
+   * Format the records still batched (before TextOutput::flush())
+   */
+  void flush() {
+    if (batch_.count > 0) formatBatch();
+  }
+
+  FormatKernel kernel() const { return kernel_; }
+  uint64_t lines() const { return lines_ + batch_.count; }
+
+ private:
+  void formatBatch() {
+    char* p = output_.reserve(batch_.count * CSV_LINE_ROOM);
+    switch (kernel_) {
+#if HEXFORMAT_X86
+      case FORMAT_AVX2: p = formatCsvAvx2(p, batch_, *tables_); break;
+      case FORMAT_SSSE3: p = formatCsvSsse3(p, batch_, *tables_); break;
+#endif
+      default: p = formatCsvScalar(p, batch_, *tables_); break;
+    }
+    output_.commit(p);
+    lines_ += batch_.count;
+    batch_.count = 0;
+  }
+
+  TextOutput& output_;
+  FormatKernel kernel_;
+  std::unique_ptr<CsvTables> tables_;
+  CsvBatch batch_;
+  uint64_t lines_ = 0;
+};
+
+// ==================== Hex Dump ====================
+
+const uint32_t DUMP_ROW_BYTES = 16;
+
+/**
+ * Full rows waiting to be formatted, in the order they filled
+ */
+struct DumpBatch {
+  static const uint32_t SIZE = 8;
+
+  uint8_t data[SIZE][DUMP_ROW_BYTES];
+  uint64_t offset[SIZE];
+  uint8_t channel[SIZE];
+  uint32_t count;
+};
+
+/**
+ * Row prefixes: the channel name padded to 4 characters ("RX  "), or
+ * none when one channel is dumped
+ */
+struct DumpPrefixes {
+  char text[256][4];
+  uint32_t length;
+};
+
+/**
+ * Longest row, plus what vector stores may write past it
+ */
+const size_t DUMP_ROW_ROOM = 128;
+
+/**
+ * Prefix, offset and the two spaces after it
+ */
+inline char* writeDumpRowStart(char* p, const DumpPrefixes& prefixes, uint8_t channel, uint64_t offset) {
+  std::memcpy(p, prefixes.text[channel], 4);
+  p = writeHexOffset(p + prefixes.length, offset);
+  p[0] = ' ';
+  p[1] = ' ';
+  return p + 2;
+}
+
+/**
+ * One row of 1 to 16 bytes; a short row is padded so its gutter lines up
+ */
+inline char* writeDumpRowScalar(char* p, const DumpPrefixes& prefixes, uint8_t channel, uint64_t offset,
+                                const uint8_t* data, uint32_t count) {
+  p = writeDumpRowStart(p, prefixes, channel, offset);
+  for (uint32_t i = 0; i < DUMP_ROW_BYTES; i++) {
+    if (i < count) {
+      p[0] = HEX_LOWER[data[i] >> 4];
+      p[1] = HEX_LOWER[data[i] & 0x0F];
+    } else {
+      p[0] = ' ';
+      p[1] = ' ';
+    }
+    p[2] = ' ';
+    p += 3;
+    if (i == 7) *p++ = ' ';
+  }
+  *p++ = ' ';
+  *p++ = '|';
+  for (uint32_t i = 0; i < count; i++) *p++ = asciiOrDot(data[i]);
+  p[0] = '|';
+  p[1] = '\n';
+  return p + 2;
+}
+
+inline char* formatDumpScalar(char* p, const DumpBatch& batch, const DumpPrefixes& prefixes) {
+  for (uint32_t r = 0; r < batch.count; r++) {
+    p = writeDumpRowScalar(p, prefixes, batch.channel[r], batch.offset[r], batch.data[r], DUMP_ROW_BYTES);
+  }
+  return p;
+}
+
+#if HEXFORMAT_X86
+
+/**
+ * Spreading 8 hex pairs into "hh hh hh hh hh hh hh hh  " (25 characters):
+ * characters 0-15 and 16-24 (the rest of the second store is
+ * overwritten); -128 lanes come out zero and get the space
+ */
+#define DUMP_GROUP_SHUFFLE_A 0, 1, -128, 2, 3, -128, 4, 5, -128, 6, 7, -128, 8, 9, -128, 10
+#define DUMP_GROUP_SPACES_A 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0
+#define DUMP_GROUP_SHUFFLE_B 11, -128, 12, 13, -128, 14, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128
+#define DUMP_GROUP_SPACES_B 0, ' ', 0, 0, ' ', 0, 0, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '
+
+/**
+ * Row start with the offset's 8 hex digits from one shuffle (offsets
+ * below 4 GiB)
+ */
+HEXFORMAT_SSSE3 inline char* writeDumpRowStartSsse3(char* p, const DumpPrefixes& prefixes, uint8_t channel,
+                                                    uint64_t offset, __m128i table) {
+  if (offset >> 32) return writeDumpRowStart(p, prefixes, channel, offset);
+  std::memcpy(p, prefixes.text[channel], 4);
+  p += prefixes.length;
+  __m128i high, low;
+  hexNibblesSsse3(_mm_cvtsi32_si128((int)__builtin_bswap32((uint32_t)offset)), table, high, low);
+  _mm_storel_epi64((__m128i*)p, _mm_unpacklo_epi8(high, low));
+  p[8] = ' ';
+  p[9] = ' ';
+  return p + 10;
+}
+
+/**
+ * The hex columns and gutter of one row from its hex pairs (bytes 0-7
+ * in pairsLow, 8-15 in pairsHigh) and ASCII characters
+ */
+HEXFORMAT_SSSE3 inline char* writeDumpColumnsSsse3(char* p, __m128i pairsLow, __m128i pairsHigh, __m128i ascii) {
+  const __m128i shuffleA = _mm_setr_epi8(DUMP_GROUP_SHUFFLE_A);
+  const __m128i spacesA = _mm_setr_epi8(DUMP_GROUP_SPACES_A);
+  const __m128i shuffleB = _mm_setr_epi8(DUMP_GROUP_SHUFFLE_B);
+  const __m128i spacesB = _mm_setr_epi8(DUMP_GROUP_SPACES_B);
+  _mm_storeu_si128((__m128i*)p, _mm_or_si128(_mm_shuffle_epi8(pairsLow, shuffleA), spacesA));
+  _mm_storeu_si128((__m128i*)(p + 16), _mm_or_si128(_mm_shuffle_epi8(pairsLow, shuffleB), spacesB));
+  _mm_storeu_si128((__m128i*)(p + 25), _mm_or_si128(_mm_shuffle_epi8(pairsHigh, shuffleA), spacesA));
+  _mm_storeu_si128((__m128i*)(p + 41), _mm_or_si128(_mm_shuffle_epi8(pairsHigh, shuffleB), spacesB));
+  p[50] = '|';
+  _mm_storeu_si128((__m128i*)(p + 51), ascii);
+  p[67] = '|';
+  p[68] = '\n';
+  return p + 69;
+}
+
+HEXFORMAT_SSSE3 inline char* formatDumpSsse3(char* p, const DumpBatch& batch, const DumpPrefixes& prefixes) {
+  const __m128i table = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  for (uint32_t r = 0; r < batch.count; r++) {
+    __m128i bytes = _mm_loadu_si128((const __m128i*)batch.data[r]);
+    __m128i high, low;
+    hexNibblesSsse3(bytes, table, high, low);
+    p = writeDumpRowStartSsse3(p, prefixes, batch.channel[r], batch.offset[r], table);
+    p = writeDumpColumnsSsse3(p, _mm_unpacklo_epi8(high, low), _mm_unpackhi_epi8(high, low), asciiSsse3(bytes));
+  }
+  return p;
+}
+
+/**
+ * Two rows per step, one in each 128-bit lane
+ */
+HEXFORMAT_AVX2 inline char* formatDumpAvx2(char* p, const DumpBatch& batch, const DumpPrefixes& prefixes) {
+  const __m256i table = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                         '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m128i table128 = _mm256_castsi256_si128(table);
+  uint32_t r = 0;
+  for (; r + 1 < batch.count; r += 2) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)batch.data[r]);
+    __m256i high, low;
+    hexNibblesAvx2(bytes, table, high, low);
+    __m256i pairsLow = _mm256_unpacklo_epi8(high, low);
+    __m256i pairsHigh = _mm256_unpackhi_epi8(high, low);
+    __m256i ascii = asciiAvx2(bytes);
+    p = writeDumpRowStartSsse3(p, prefixes, batch.channel[r], batch.offset[r], table128);
+    p = writeDumpColumnsSsse3(p, _mm256_castsi256_si128(pairsLow), _mm256_castsi256_si128(pairsHigh),
+                              _mm256_castsi256_si128(ascii));
+    p = writeDumpRowStartSsse3(p, prefixes, batch.channel[r + 1], batch.offset[r + 1], table128);
+    p = writeDumpColumnsSsse3(p, _mm256_extracti128_si256(pairsLow, 1), _mm256_extracti128_si256(pairsHigh, 1),
+                              _mm256_extracti128_si256(ascii, 1));
+  }
+  if (r < batch.count) {
+    __m128i bytes = _mm_loadu_si128((const __m128i*)batch.data[r]);
+    __m128i high, low;
+    hexNibblesSsse3(bytes, table128, high, low);
+    p = writeDumpRowStartSsse3(p, prefixes, batch.channel[r], batch.offset[r], table128);
+    p = writeDumpColumnsSsse3(p, _mm_unpacklo_epi8(high, low), _mm_unpackhi_epi8(high, low), asciiSsse3(bytes));
+  }
+  return p;
+}
+
+#endif // HEXFORMAT_X86
+
+/**
+ * Streams bytes as a hex dump per channel
+ *
+ * Each channel's bytes make their own dump, with offsets counted from its
+ * first byte. Rows are written in the order they fill, so with several
+ * channels the dumps interleave, each row prefixed with its channel name.
+ * finish() writes each channel's last, short row and its end offset line.
+ */
+class HexDumper {
+ public:
+  /**
+   * @param prefixed Prefix rows with the channel name (when several
+   *                 channels are dumped)
+   */
+  HexDumper(TextOutput& output, bool prefixed, FormatKernel kernel = bestFormatKernel())
+      : output_(output), kernel_(formatKernelSupported(kernel) ? kernel : FORMAT_SCALAR),
+        streams_(new Stream[256]()), prefixes_(new DumpPrefixes()) {
+    for (uint32_t i = 0; i < 256; i++) {
+      std::memset(prefixes_->text[i], ' ', 4);
+      const char* name = channelName((uint8_t)i);
+      std::memcpy(prefixes_->text[i], name, std::strlen(name) < 3 ? std::strlen(name) : 3);
+    }
+    prefixes_->length = prefixed ? 4 : 0;
+    std::memset(&batch_, 0, sizeof(batch_));
+  }
+
+  void add(uint8_t channel, uint8_t value) {
+    Stream& stream = streams_[channel];
+    stream.row[stream.count++] = value;
+    if (stream.count == DUMP_ROW_BYTES) queueRow(channel, stream.row);
+  }
+
+  /**
+   * A run of bytes from one channel: whole rows are queued straight from
+   * data
+   */
+  void add(uint8_t channel, const uint8_t* data, size_t length) {
+    Stream& stream = streams_[channel];
+    while (length > 0 && stream.count > 0) {
+      add(channel, *data++);
+      length--;
+    }
+    for (; length >= DUMP_ROW_BYTES; data += DUMP_ROW_BYTES, length -= DUMP_ROW_BYTES) queueRow(channel, data);
+    while (length > 0) {
+      add(channel, *data++);
+      length--;
+    }
+  }
+
+  /**
+   * Write the rows still batched, then every channel's short last row
+   * and end offset (before TextOutput::flush())
+   */
+  void finish() {
+    if (batch_.count > 0) formatBatch();
+    for (uint32_t channel = 0; channel < 256; channel++) {
+      Stream& stream = streams_[channel];
+      if (stream.count == 0) continue;
+      char* p = output_.reserve(DUMP_ROW_ROOM);
+      p = writeDumpRowScalar(p, *prefixes_, (uint8_t)channel, stream.offset, stream.row, stream.count);
+      output_.commit(p);
+      stream.offset += stream.count;
+      stream.count = 0;
+    }
+    for (uint32_t channel = 0; channel < 256; channel++) {
+      if (streams_[channel].offset == 0) continue;
+      char* p = output_.reserve(DUMP_ROW_ROOM);
+      std::memcpy(p, prefixes_->text[channel], 4);
+      p = writeHexOffset(p + prefixes_->length, streams_[channel].offset);
+      *p++ = '\n';
+      output_.commit(p);
+    }
+  }
+
+  FormatKernel kernel() const { return kernel_; }
+
+  /**
+   * Bytes dumped from a channel so far
+   */
+  uint64_t bytes(uint8_t channel) const { return streams_[channel].offset + streams_[channel].count; }
+
+ private:
+  struct Stream {
+    uint8_t row[DUMP_ROW_BYTES];
+    uint32_t count;
+    uint64_t offset;              // Of row[0]
+  };
+
+  void queueRow(uint8_t channel, const uint8_t* row) {
+    Stream& stream = streams_[channel];
+    uint32_t i = batch_.count;
+    std::memcpy(batch_.data[i], row, DUMP_ROW_BYTES);
+    batch_.offset[i] = stream.offset;
+    batch_.channel[i] = channel;
+    batch_.count = i + 1;
+    stream.offset += DUMP_ROW_BYTES;
+    stream.count = 0;
+    if (batch_.count == DumpBatch::SIZE) formatBatch();
+  }
+
+  void formatBatch() {
+    char* p = output_.reserve(batch_.count * DUMP_ROW_ROOM);
+    switch (kernel_) {
+#if HEXFORMAT_X86
+      case FORMAT_AVX2: p = formatDumpAvx2(p, batch_, *prefixes_); break;
+      case FORMAT_SSSE3: p = formatDumpSsse3(p, batch_, *prefixes_); break;
+#endif
+      default: p = formatDumpScalar(p, batch_, *prefixes_); break;
+    }
+    output_.commit(p);
+    batch_.count = 0;
+  }
+
+  TextOutput& output_;
+  FormatKernel kernel_;
+  std::unique_ptr<Stream[]> streams_;
+  std::unique_ptr<DumpPrefixes> prefixes_;
+  DumpBatch batch_;
+};
+
+#endif // HEXFORMAT_H
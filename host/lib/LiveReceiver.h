@@ -0,0 +1,202 @@
+/*
+ * SerialSniffer Host Tools - Live Stream Receiver
+ *
+ * Parses the firmware's live record stream (LiveStream.h) from a byte
+ * stream of any chunking: finds batches by their magic, checks both CRCs
+ * (resyncing byte by byte past anything that fails) and reports gaps in
+ * the sequence numbers. LiveCaptureWriter turns the batches back into a
+ * binary capture file that CaptureReader and ss_convert read.
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef LIVERECEIVER_H
+#define LIVERECEIVER_H
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "CaptureFormat.h"
+#include "LiveStream.h"
+
+/**
+ * One verified batch
+ */
+struct LiveBatch {
+  LiveBatchHeader header;
+  const uint8_t* payload;         // header.payloadBytes bytes, valid during the callback
+  uint32_t missingBefore;         // Batches lost just before this one (sequence gap)
+};
+
+/**
+ * Receiver counters
+ */
+struct LiveReceiverStats {
+  uint64_t batches = 0;
+  uint64_t records = 0;
+  uint64_t payloadBytes = 0;
+  uint64_t missingBatches = 0;    // Sequence numbers never received
+  uint64_t gaps = 0;              // Places where batches were missing
+  uint64_t crcErrors = 0;         // Headers or payloads that failed their CRC
+  uint64_t skippedBytes = 0;      // Bytes outside verified batches
+  uint64_t starts = 0;
+  uint64_t ends = 0;
+};
+
+class LiveReceiver {
+ public:
+  static const uint32_t MAX_PAYLOAD_BYTES = 65535;
+
+  /**
+   * Parse the next chunk of the stream
+   * @param onBatch Called as onBatch(const LiveBatch&) for every verified batch
+   */
+  template <typename Fn>
+  void feed(const uint8_t* data, size_t length, Fn&& onBatch) {
+    buffer_.insert(buffer_.end(), data, data + length);
+
+    while (buffer_.size() - position_ >= sizeof(LiveBatchHeader)) {
+      const uint8_t* at = buffer_.data() + position_;
+      LiveBatchHeader header;
+      std::memcpy(&header, at, sizeof(header));
+      if (header.magic != LIVE_MAGIC) {
+        skip();
+        continue;
+      }
+      if (liveHeaderCrc(header) != header.headerCrc) {
+        stats_.crcErrors++;
+        skip();
+        continue;
+      }
+      size_t size = sizeof(header) + header.payloadBytes;
+      if (buffer_.size() - position_ < size) break;           // Wait for the payload
+      const uint8_t* payload = at + sizeof(header);
+      if (crc16Ccitt(payload, header.payloadBytes) != header.payloadCrc) {
+        stats_.crcErrors++;
+        skip();
+        continue;
+      }
+
+      LiveBatch batch;
+      batch.header = header;
+      batch.payload = payload;
+      batch.missingBefore = 0;
+      if (header.type == LIVE_BATCH_START) {
+        stats_.starts++;
+      } else if (haveSequence_ && header.sequence != nextSequence_) {
+        batch.missingBefore = header.sequence - nextSequence_;
+        stats_.missingBatches += batch.missingBefore;
+        stats_.gaps++;
+      }
+      if (header.type == LIVE_BATCH_END) stats_.ends++;
+      nextSequence_ = header.sequence + 1;
+      haveSequence_ = true;
+      stats_.batches++;
+      stats_.records += header.recordCount;
+      stats_.payloadBytes += header.payloadBytes;
+      position_ += size;
+
+      onBatch(batch);
+    }
+
+    // Keep the buffer from growing: drop what has been parsed
+    if (position_ > 0 && position_ * 2 >= buffer_.size()) {
+      buffer_.erase(buffer_.begin(), buffer_.begin() + position_);
+      position_ = 0;
+    }
+  }
+
+  const LiveReceiverStats& stats() const { return stats_; }
+
+ private:
+  void skip() {
+    position_++;
+    stats_.skippedBytes++;
+  }
+
+  std::vector<uint8_t> buffer_;
+  size_t position_ = 0;
+  uint32_t nextSequence_ = 0;
+  bool haveSequence_ = false;
+  LiveReceiverStats stats_;
+};
+
+/**
+ * Decode a RECORDS batch
+ * @param onRecord Called as onRecord(const DeltaRecord&, uint64_t ticks)
+ * @return false if the payload ends inside a record
+ */
+template <typename Fn>
+inline bool forEachLiveRecord(const LiveBatch& batch, Fn&& onRecord) {
+  uint64_t ticks = batch.header.baseTicks;
+  const uint8_t* data = batch.payload;
+  uint32_t left = batch.header.payloadBytes;
+  while (left > 0) {
+    DeltaRecord record;
+    uint32_t used = decodeDeltaRecord(data, left, record);
+    if (used == 0) return false;
+    ticks += record.deltaTicks;
+    onRecord(record, ticks);
+    data += used;
+    left -= used;
+  }
+  return true;
+}
+
+/**
+ * Writes a live stream as a binary capture file
+ * The START batch's payload becomes the file header. Only the first
+ * record of each batch is re-encoded (its delta now counts from the
+ * previous batch's last record, across any gap); the rest of the payload
+ * is written as received.
+ */
+class LiveCaptureWriter {
+ public:
+  explicit LiveCaptureWriter(std::FILE* out) : out_(out) {}
+
+  /**
+   * Write a batch's records (START: the header)
+   * @return false if the payload is malformed
+   */
+  bool write(const LiveBatch& batch) {
+    if (batch.header.type == LIVE_BATCH_START) {
+      if (headerWritten_ || batch.header.payloadBytes < sizeof(CaptureFileHeader)) return false;
+      std::fwrite(batch.payload, 1, batch.header.payloadBytes, out_);
+      headerWritten_ = true;
+      return true;
+    }
+    if (batch.header.type != LIVE_BATCH_RECORDS || batch.header.payloadBytes == 0) return true;
+
+    if (!headerWritten_) {
+      // Joined mid-stream: the rate is in every batch, the rest is unknown
+      CaptureFileHeader header;
+      initCaptureHeader(header, 0, 0, "live", batch.header.timestampHz);
+      std::fwrite(&header, sizeof(header), 1, out_);
+      headerWritten_ = true;
+    }
+
+    DeltaRecord first;
+    uint32_t used = decodeDeltaRecord(batch.payload, batch.header.payloadBytes, first);
+    if (used == 0) return false;
+    uint64_t ticks = batch.header.baseTicks + first.deltaTicks;
+    uint64_t delta = ticks > lastTicks_ ? ticks - lastTicks_ : 0;
+
+    uint8_t record[MAX_EVENT_RECORD_SIZE];
+    uint32_t length = (first.kind == RECORD_KIND_DATA)
+        ? encodeDeltaRecord(record, delta, first.kind, first.channel, first.value, first.status)
+        : encodeEventRecord(record, delta, first.kind, first.channel, first.value, first.status,
+                            first.argument);
+    std::fwrite(record, 1, length, out_);
+    std::fwrite(batch.payload + used, 1, batch.header.payloadBytes - used, out_);
+    lastTicks_ = batch.header.endTicks;
+    return true;
+  }
+
+ private:
+  std::FILE* out_;
+  bool headerWritten_ = false;
+  uint64_t lastTicks_ = 0;
+};
+
+#endif // LIVERECEIVER_H
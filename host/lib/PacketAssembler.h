@@ -0,0 +1,99 @@
+/*
+ * SerialSniffer Host Tools - Packet Assembly
+ *
+ * Rebuilds the packets the firmware framed (PACKET_START / PACKET_END
+ * records around the data records) from a CaptureReader stream, per
+ * channel, without looking at timing.
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef PACKETASSEMBLER_H
+#define PACKETASSEMBLER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CaptureFormat.h"
+#include "CaptureReader.h"
+
+/**
+ * One framed packet
+ */
+struct CapturedPacket {
+  uint64_t startNs = 0;         // First byte
+  uint64_t endNs = 0;           // PACKET_END record (idle deadline for PACKET_END_IDLE)
+  uint64_t startTicks = 0;
+  uint64_t endTicks = 0;
+  uint64_t number = 0;          // Per-channel packet number from PACKET_START
+  uint8_t channel = 0;
+  uint8_t endReason = 0;        // PacketEndReason
+  uint8_t status = 0;           // RecordStatus flags of all bytes and the PACKET_END checksum verdict
+  bool intact = false;          // PACKET_END length matches the bytes seen
+  std::vector<uint8_t> data;
+};
+
+/**
+ * Collects data records between PACKET_START and PACKET_END per channel
+ */
+class PacketAssembler {
+ public:
+  /**
+   * Feed the next record
+   * @param packet Receives a packet when one ends
+   * @return true if packet was filled
+   */
+  bool add(const CaptureEvent& event, CapturedPacket& packet) {
+    Open& open = open_[event.channel & (MAX_CAPTURE_CHANNELS - 1)];
+    switch (event.kind) {
+      case RECORD_KIND_PACKET_START:
+        if (open.active) orphanBytes_ += open.packet.data.size();   // START without END
+        open.active = true;
+        open.packet = CapturedPacket();
+        open.packet.channel = event.channel;
+        open.packet.number = event.argument;
+        open.packet.startNs = event.timestampNs;
+        open.packet.startTicks = event.ticks;
+        return false;
+
+      case RECORD_KIND_DATA:
+        if (!open.active) {
+          orphanBytes_++;          // Framing off, or the file begins mid-packet
+          return false;
+        }
+        open.packet.data.push_back(event.value);
+        open.packet.status |= event.status;
+        return false;
+
+      case RECORD_KIND_PACKET_END:
+        if (!open.active) return false;
+        open.packet.endNs = event.timestampNs;
+        open.packet.endTicks = event.ticks;
+        open.packet.endReason = event.value;
+        open.packet.status |= event.status;
+        open.packet.intact = event.argument == open.packet.data.size();
+        packet = std::move(open.packet);
+        open.active = false;
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+  /**
+   * Data bytes seen outside any packet
+   */
+  uint64_t orphanBytes() const { return orphanBytes_; }
+
+ private:
+  struct Open {
+    bool active = false;
+    CapturedPacket packet;
+  };
+
+  Open open_[MAX_CAPTURE_CHANNELS];
+  uint64_t orphanBytes_ = 0;
+};
+
+#endif // PACKETASSEMBLER_H
@@ -0,0 +1,281 @@
+/*
+ * SerialSniffer Host Tools - Capture Time Index
+ *
+ * Loads the .ssi sidecar the firmware writes beside each capture part
+ * (CaptureIndex.h) and turns a time window into the byte range that holds
+ * it with a binary search, so tools decode a few MB of a multi-GB capture
+ * instead of everything before the window. Captures without a sidecar
+ * (older firmware, ss_convert output, copies) get one built on the spot:
+ * CSV lines carry absolute times, so that only reads one line per entry;
+ * delta records are walked by length without being decoded, compressed
+ * blocks by their headers.
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CaptureIndex.h"
+#include "CaptureMap.h"
+
+const size_t INDEX_REBUILD_BYTES = 4 * 1024 * 1024;   // Capture bytes per rebuilt entry
+
+/**
+ * Parse a time since capture start: seconds ("90", "12.5") or
+ * [[H:]M:]S[.fraction] ("1:02:03.25")
+ * @return false if the text is not a time
+ */
+inline bool parseElapsedNs(const char* text, uint64_t& ns) {
+  uint64_t seconds = 0;
+  uint64_t field = 0;
+  bool digits = false;
+  int colons = 0;
+  const char* at = text;
+  for (; *at && *at != '.'; at++) {
+    if (*at == ':') {
+      if (!digits || ++colons > 2) return false;
+      seconds = (seconds + field) * 60;
+      field = 0;
+      digits = false;
+    } else if (*at >= '0' && *at <= '9') {
+      field = field * 10 + (uint64_t)(*at - '0');
+      digits = true;
+    } else {
+      return false;
+    }
+  }
+  if (!digits && *at != '.') return false;
+  ns = (seconds + field) * 1000000000ULL;
+  if (*at == '.') {
+    uint64_t scale = 100000000ULL;
+    for (at++; *at; at++) {
+      if (*at < '0' || *at > '9') return false;
+      ns += (uint64_t)(*at - '0') * scale;
+      scale /= 10;
+    }
+  }
+  return true;
+}
+
+class TimeIndex {
+ public:
+  enum Source : uint8_t {
+    SOURCE_NONE = 0,
+    SOURCE_SIDECAR = 1,           // Read from the .ssi file
+    SOURCE_REBUILT = 2            // Built from the capture itself
+  };
+
+  /**
+   * Sidecar name of a capture: the same name with the extension .ssi
+   */
+  static std::string sidecarPath(const std::string& capturePath) {
+    size_t slash = capturePath.find_last_of('/');
+    size_t dot = capturePath.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return capturePath + ".ssi";
+    return capturePath.substr(0, dot) + ".ssi";
+  }
+
+  /**
+   * Use the capture's sidecar if it belongs to it, else build the index
+   * @param capturePath Path the map was opened from
+   */
+  void open(const std::string& capturePath, const CaptureMap& map) {
+    if (!load(sidecarPath(capturePath), map)) build(map);
+  }
+
+  /**
+   * Read a sidecar and check it against the capture
+   * Entries past the end of the capture (a sidecar written ahead of a
+   * capture that was cut short) are dropped.
+   * @return false if it is missing or does not match; error() says why
+   */
+  bool load(const std::string& path, const CaptureMap& map) {
+    clear();
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+      error_ = "no index " + path;
+      return false;
+    }
+    bool ok = std::fread(&header_, sizeof(header_), 1, file) == 1 && isValidIndexHeader(header_);
+    if (ok) {
+      std::fseek(file, header_.headerSize, SEEK_SET);
+      CaptureIndexEntry entry;
+      while (std::fread(&entry, sizeof(entry), 1, file) == 1) entries_.push_back(entry);
+    }
+    std::fclose(file);
+    if (!ok) {
+      clear();
+      error_ = "not a SerialSniffer index: " + path;
+      return false;
+    }
+    if (!matches(map)) {
+      clear();
+      error_ = "index " + path + " belongs to another capture";
+      return false;
+    }
+    while (!entries_.empty() && entries_.back().offset >= map.size()) entries_.pop_back();
+    for (size_t i = 1; i < entries_.size(); i++) {
+      if (entries_[i].offset <= entries_[i - 1].offset || entries_[i].ticks < entries_[i - 1].ticks) {
+        clear();
+        error_ = "index " + path + " is out of order";
+        return false;
+      }
+    }
+    source_ = SOURCE_SIDECAR;
+    return true;
+  }
+
+  /**
+   * Build the index from the capture, one entry per intervalBytes
+   */
+  void build(const CaptureMap& map, size_t intervalBytes = INDEX_REBUILD_BYTES) {
+    clear();
+    bool csv = map.type() == CAPTURE_FILE_CSV;
+    bool fixed = !csv && map.header().recordFormat == RECORD_FORMAT_FIXED;
+    initIndexHeader(header_, csv ? INDEX_FILE_CSV : INDEX_FILE_BINARY, fixed ? 1000 : map.header().timestampHz,
+                    0, 0);
+    const uint8_t* data = map.file().data();
+    size_t start = map.all().begin;
+    map.split(intervalBytes, [&](const CaptureRange& range) {
+      if (range.begin == start) return;           // The first record needs no entry
+      CaptureIndexEntry entry;
+      entry.offset = range.begin;
+      if (csv) {
+        // A line's own time: records before are no later, from it on no earlier
+        uint64_t ns = 0;
+        const uint8_t* at = data + range.begin;
+        const uint8_t* stop = data + range.end;
+        if (at == stop || *at < '0' || *at > '9') return;      // Malformed line: no entry here
+        while (at < stop && *at >= '0' && *at <= '9') ns = ns * 10 + (uint64_t)(*at++ - '0');
+        entry.ticks = ns;
+      } else if (fixed) {
+        CaptureRecord record;
+        std::memcpy(&record, data + range.begin, sizeof(record));
+        entry.ticks = record.timestamp;
+      } else {
+        entry.ticks = range.ticks;
+      }
+      if (!entries_.empty() && entry.ticks < entries_.back().ticks) return;   // Keep it sorted
+      entries_.push_back(entry);
+    });
+    source_ = SOURCE_REBUILT;
+  }
+
+  /**
+   * Write the index as a sidecar file
+   */
+  bool save(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    bool ok = file && std::fwrite(&header_, sizeof(header_), 1, file) == 1 &&
+              std::fwrite(entries_.data(), sizeof(CaptureIndexEntry), entries_.size(), file) == entries_.size();
+    if (file && std::fclose(file) != 0) ok = false;
+    if (!ok) error_ = "cannot write " + path;
+    return ok;
+  }
+
+  /**
+   * Smallest indexed range of a capture that holds every record stamped
+   * in [startNs, endNs]: from the last entry before startNs to the first
+   * entry after endNs (binary searches over the entries)
+   */
+  CaptureRange range(const CaptureMap& map, uint64_t startNs, uint64_t endNs) const {
+    CaptureRange range = map.all();
+    auto before = std::lower_bound(entries_.begin(), entries_.end(), startNs,
+                                   [this](const CaptureIndexEntry& entry, uint64_t ns) {
+      return entryNs(entry) < ns;
+    });
+    if (before != entries_.begin()) {
+      --before;
+      range.begin = before->offset;
+      range.ticks = before->ticks;
+    }
+    auto after = std::upper_bound(entries_.begin(), entries_.end(), endNs,
+                                  [this](uint64_t ns, const CaptureIndexEntry& entry) {
+      return ns < entryNs(entry);
+    });
+    if (after != entries_.end()) range.end = after->offset;
+    if (range.end < range.begin) range.end = range.begin;
+    return range;
+  }
+
+  /**
+   * Check every entry against the capture: its offset is a record
+   * boundary and its time lies between the records either side (delta
+   * records: equals the tick sum there). Reads the whole capture.
+   * @return false at the first bad entry; error() says which
+   */
+  bool check(const CaptureMap& map) {
+    CaptureColumns columns;
+    columns.allocate(1);
+    CaptureCursor cursor = map.cursor(map.all());
+    uint64_t lastNs = 0;
+    size_t next = 0;
+    bool delta = map.type() == CAPTURE_FILE_BINARY && map.header().recordFormat != RECORD_FORMAT_FIXED;
+    for (;;) {
+      size_t at = cursor.position();
+      bool more = cursor.read(columns) > 0;
+      while (next < entries_.size() && entries_[next].offset <= at) {
+        const CaptureIndexEntry& entry = entries_[next];
+        uint64_t ns = entryNs(entry);
+        bool ok = entry.offset == at && ns >= lastNs && (!more || columns.timestampNs[0] >= ns);
+        if (delta && ns != lastNs) ok = false;
+        if (!ok) {
+          char text[96];
+          std::snprintf(text, sizeof(text), "entry %zu (offset %llu) does not match the capture", next,
+                        (unsigned long long)entry.offset);
+          error_ = text;
+          return false;
+        }
+        next++;
+      }
+      if (!more) break;
+      lastNs = columns.timestampNs[0];
+    }
+    if (next < entries_.size()) {
+      error_ = "entries past the end of the capture";
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Entry time in nanoseconds since capture start
+   */
+  uint64_t entryNs(const CaptureIndexEntry& entry) const { return ticksToNs(entry.ticks, header_.timestampHz); }
+
+  const CaptureIndexHeader& header() const { return header_; }
+  const std::vector<CaptureIndexEntry>& entries() const { return entries_; }
+  size_t size() const { return entries_.size(); }
+  Source source() const { return source_; }
+  const std::string& error() const { return error_; }
+
+ private:
+  void clear() {
+    header_ = CaptureIndexHeader();
+    entries_.clear();
+    source_ = SOURCE_NONE;
+    error_.clear();
+  }
+
+  // Same file type, and binary entries in the header's tick rate
+  bool matches(const CaptureMap& map) const {
+    if (map.type() == CAPTURE_FILE_CSV) return header_.fileType == INDEX_FILE_CSV;
+    if (header_.fileType != INDEX_FILE_BINARY) return false;
+    uint32_t hz = map.header().recordFormat == RECORD_FORMAT_FIXED ? 1000 : map.header().timestampHz;
+    return header_.timestampHz == hz;
+  }
+
+  CaptureIndexHeader header_ = {};
+  std::vector<CaptureIndexEntry> entries_;
+  Source source_ = SOURCE_NONE;
+  std::string error_;
+};
+
+#endif // TIMEINDEX_H
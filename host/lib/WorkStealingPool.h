@@ -0,0 +1,155 @@
+/*
+ * SerialSniffer Host Tools - Work-Stealing Thread Pool
+ *
+ * Fixed set of worker threads, one task deque each. A worker takes its
+ * own newest task first and, when its deque is empty, steals the oldest
+ * task of another worker, so uneven tasks (dense and idle stretches of a
+ * capture) still keep every core busy. Tasks submitted from outside the
+ * pool are dealt round-robin.
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+ public:
+  typedef std::function<void()> Task;
+
+  /**
+   * @param threads Workers; 0 for one per hardware thread
+   */
+  explicit WorkStealingPool(unsigned threads = 0) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; i++) queues_.emplace_back(new Queue());
+    for (unsigned i = 0; i < threads; i++) workers_.emplace_back(&WorkStealingPool::run, this, i);
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  /**
+   * Queue a task; from a worker it goes on that worker's own deque
+   */
+  void submit(Task task) {
+    const WorkerSlot& slot = currentWorker();
+    unsigned index = (slot.pool == this) ? slot.index : next_.fetch_add(1, std::memory_order_relaxed) % size();
+    outstanding_.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+      queues_[index]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      queued_++;
+    }
+    wake_.notify_one();
+  }
+
+  /**
+   * Block until every submitted task has finished
+   */
+  void wait() {
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    idle_.wait(lock, [this] { return outstanding_.load(std::memory_order_acquire) == 0; });
+  }
+
+  unsigned size() const { return (unsigned)workers_.size(); }
+  uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }   // Tasks run by a non-owner
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  struct WorkerSlot {
+    const WorkStealingPool* pool = nullptr;
+    unsigned index = 0;
+  };
+
+  // Which pool (if any) the calling thread works for
+  static WorkerSlot& currentWorker() {
+    static thread_local WorkerSlot slot;
+    return slot;
+  }
+
+  // Own deque from the back, else the front of another's
+  bool take(unsigned self, Task& task) {
+    {
+      Queue& own = *queues_[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+    for (unsigned i = 1; i < size(); i++) {
+      Queue& victim = *queues_[(self + i) % size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(unsigned self) {
+    currentWorker().pool = this;
+    currentWorker().index = self;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+        if (queued_ == 0) return;         // Stopping with nothing left
+        queued_--;                        // Claimed: one task is ours to find
+      }
+      Task task;
+      while (!take(self, task)) std::this_thread::yield();
+      task();
+      task = nullptr;
+      if (outstanding_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        idle_.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  size_t queued_ = 0;                     // Tasks not yet claimed (guarded by sleepMutex_)
+  bool stopping_ = false;
+  std::atomic<size_t> outstanding_{0};    // Submitted, not finished
+  std::atomic<unsigned> next_{0};
+  std::atomic<uint64_t> steals_{0};
+};
+
+#endif // WORKSTEALINGPOOL_H
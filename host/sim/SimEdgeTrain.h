@@ -0,0 +1,116 @@
+/*
+ * SerialSniffer Host Simulator - Serial Line Edge Train
+ *
+ * Edge times of an RX line carrying 8N1 traffic (random bytes or
+ * printable text in bursts separated by idle gaps), as the edge interrupt
+ * would stamp them: with transmitter clock error, interrupt entry jitter
+ * and occasional short noise pulses. Shared by the baud estimator
+ * benchmark and the detection simulation.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef SIMEDGETRAIN_H
+#define SIMEDGETRAIN_H
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/**
+ * Line and interrupt imperfections
+ */
+struct EdgeTrainModel {
+  uint32_t cycleHz = 600000000;
+  double clockError = 0.01;          // Transmitter clock error, +/-
+  uint32_t jitterCycles = 40;        // Edge interrupt entry latency spread
+  double glitchPerChar = 0.01;       // Chance of a 20-60 ns pulse per character
+};
+
+/**
+ * Edge times (cycles, unwrapped) of a line carrying 8N1 traffic
+ */
+class EdgeTrain {
+ public:
+  EdgeTrain(uint32_t baud, uint32_t seed, bool text, const EdgeTrainModel& model = EdgeTrainModel())
+      : model_(model), rng_(seed), text_(text) {
+    setBaud(baud);
+    time_ = bitCycles_ * (rng_() % 100);
+  }
+
+  /**
+   * Change the transmitter's rate from the next character on
+   * (a new clock error is drawn)
+   */
+  void setBaud(uint32_t baud) {
+    std::uniform_real_distribution<double> error(-model_.clockError, model_.clockError);
+    bitCycles_ = (double)model_.cycleHz / (baud * (1.0 + error(rng_)));
+  }
+
+  /**
+   * Line stays idle (high) up to a time
+   */
+  void idle(double untilCycles) {
+    if (time_ < untilCycles) time_ = untilCycles;
+    burstLeft_ = 0;
+  }
+
+  /**
+   * Edges up to a time, as the interrupt would stamp them
+   */
+  void generate(double untilCycles, std::vector<uint64_t>& edges) {
+    while (time_ < untilCycles) {
+      if (burstLeft_ == 0) {
+        // Idle (high) for up to 5 ms or 20 characters, whichever is longer
+        double maxIdle = std::fmax(model_.cycleHz / 200.0, 200 * bitCycles_);
+        time_ += std::uniform_real_distribution<double>(0, maxIdle)(rng_);
+        burstLeft_ = 1 + rng_() % 64;
+      }
+      uint8_t value = text_ ? (uint8_t)(32 + rng_() % 95) : (uint8_t)rng_();
+      burstLeft_--;
+      if (std::uniform_real_distribution<double>(0, 1)(rng_) < model_.glitchPerChar) {
+        glitchAt_ = time_ + bitCycles_ * (rng_() % 10);
+      }
+
+      // Start bit, data LSB first, stop bit
+      uint32_t frame = ((uint32_t)value << 1) | (1u << 9);
+      for (int bit = 0; bit < 10; bit++) {
+        int level = (frame >> bit) & 1;
+        if (level != level_) {
+          emit(time_, edges);
+          level_ = level;
+        }
+        time_ += bitCycles_;
+      }
+    }
+  }
+
+  double bitCycles() const { return bitCycles_; }
+
+ private:
+  void emit(double at, std::vector<uint64_t>& edges) {
+    if (glitchAt_ >= 0 && glitchAt_ < at) {
+      // 20-60 ns pulse: two edges close together
+      uint64_t start = (uint64_t)glitchAt_;
+      edges.push_back(start + jitter());
+      edges.push_back(start + 12 + rng_() % 24 + jitter());
+      glitchAt_ = -1;
+    }
+    edges.push_back((uint64_t)at + jitter());
+  }
+
+  uint32_t jitter() { return model_.jitterCycles ? rng_() % model_.jitterCycles : 0; }
+
+  EdgeTrainModel model_;
+  std::mt19937 rng_;
+  bool text_;
+  double bitCycles_;
+  double time_;
+  double glitchAt_ = -1;         // Pending noise pulse
+  uint32_t burstLeft_ = 0;
+  int level_ = 1;
+};
+
+#endif // SIMEDGETRAIN_H
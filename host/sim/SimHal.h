@@ -0,0 +1,485 @@
+/*
+ * SerialSniffer Host Simulator - Simulated HAL
+ *
+ * Hal.h interfaces for running the capture engine on Linux in simulated
+ * time:
+ *   SimClock         Nanosecond clock and 600 MHz cycle counter; advancing
+ *                    it delivers the UART bytes that arrive meanwhile
+ *   SimStorage/File  Capture files in a host directory, with an SD card
+ *                    latency model (per-sector writes, syncs, file
+ *                    creation and periodic long stalls)
+ *   SimSerialPort    UART line feeding a CaptureChannel, saturated or
+ *                    shaped by a gap hook
+ *   SimEdgeInput     Edge callback driven by the simulation
+ *   SimStreamPort    USB link with a bandwidth limit, written to a file
+ *                    descriptor (e.g. a pseudo-terminal)
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef SIMHAL_H
+#define SIMHAL_H
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <functional>
+#include <string>
+
+#include "CaptureFormat.h"
+#include "Hal.h"
+
+// ==================== Clock ====================
+
+/**
+ * Simulated time
+ * The capture engine only sees time move while it "waits" on the card
+ * (SimFile) and when the simulation loop charges CPU time; both go
+ * through advance(), which first lets the UARTs deliver everything they
+ * receive in that interval.
+ */
+struct SimClock {
+  static const uint32_t CYCLE_HZ = 600000000;   // Teensy 4.1 F_CPU_ACTUAL
+
+  static uint64_t nowNs() { return nowNs_; }
+  static uint32_t millis() { return (uint32_t)(nowNs_ / 1000000); }
+  static uint32_t micros() { return (uint32_t)(nowNs_ / 1000); }
+  static uint32_t cycles() { return cyclesAt(nowNs_); }
+  static uint32_t cycleHz() { return CYCLE_HZ; }
+  static uint32_t rtcSeconds() { return 1700000000; }
+
+  /**
+   * Raw (wrapping) cycle counter value at a simulated time
+   */
+  static uint32_t cyclesAt(uint64_t ns) { return cycleOffset_ + (uint32_t)cycles64(ns); }
+
+  /**
+   * Unwrapped cycles since simulation start
+   */
+  static uint64_t cycles64(uint64_t ns) { return ns * (CYCLE_HZ / 1000000) / 1000; }
+
+  /**
+   * Restart at time 0
+   * @param cycleOffset Counter value at time 0 (start near 2^32 to cover the wrap)
+   * @param onAdvance Called with the new time before it is reached
+   */
+  static void reset(uint32_t cycleOffset, std::function<void(uint64_t)> onAdvance) {
+    nowNs_ = 0;
+    cycleOffset_ = cycleOffset;
+    onAdvance_ = onAdvance;
+  }
+
+  static void advance(uint64_t ns) {
+    uint64_t until = nowNs_ + ns;
+    if (onAdvance_) onAdvance_(until);
+    nowNs_ = until;
+  }
+
+ private:
+  static inline uint64_t nowNs_ = 0;
+  static inline uint32_t cycleOffset_ = 0;
+  static inline std::function<void(uint64_t)> onAdvance_;
+};
+
+// ==================== Storage ====================
+
+/**
+ * SD card latency model (microseconds)
+ */
+struct SimCardModel {
+  uint32_t writeUs = 250;           // One write() call (up to a sector)
+  uint32_t syncUs = 2000;           // flush(): directory entry + FAT
+  uint32_t createUs = 5000;         // Create/truncate a file
+  uint32_t preAllocateUs = 3000;    // Reserve the extent
+  uint32_t stallUs = 0;             // Extra latency of a stalled write
+  uint32_t stallEveryMs = 1000;     // One stalled write per period
+};
+
+/**
+ * Card activity counters
+ */
+struct SimCardStats {
+  uint64_t writes = 0;
+  uint64_t bytesWritten = 0;
+  uint64_t syncs = 0;
+  uint64_t stalls = 0;
+  uint64_t filesCreated = 0;
+  uint64_t extentOverruns = 0;      // Writes past the pre-allocated extent
+  uint64_t busyNs = 0;              // Simulated time spent in card operations
+};
+
+class SimFile;
+
+/**
+ * Capture files in a host directory
+ */
+class SimStorage {
+ public:
+  /**
+   * @param root Existing directory that stands in for the card
+   */
+  SimStorage(const std::string& root, const SimCardModel& model) : root_(root), model_(model) {}
+
+  bool exists(const char* path) {
+    struct stat info;
+    return stat(fullPath(path).c_str(), &info) == 0;
+  }
+
+  inline bool open(SimFile& file, const char* path, HalFileMode mode);
+
+  std::string fullPath(const char* path) const { return root_ + "/" + path; }
+  const SimCardStats& stats() const { return stats_; }
+
+  // Charge a card operation: simulated time passes, UART bytes keep arriving
+  void charge(uint32_t us) {
+    stats_.busyNs += (uint64_t)us * 1000;
+    SimClock::advance((uint64_t)us * 1000);
+  }
+
+  // Latency of the next write, including a stall when one is due
+  uint32_t writeCost() {
+    uint32_t cost = model_.writeUs;
+    if (model_.stallUs > 0 && SimClock::nowNs() >= nextStallNs_) {
+      cost += model_.stallUs;
+      stats_.stalls++;
+      nextStallNs_ = SimClock::nowNs() + (uint64_t)model_.stallEveryMs * 1000000;
+    }
+    return cost;
+  }
+
+  const SimCardModel& model() const { return model_; }
+  SimCardStats& mutableStats() { return stats_; }
+
+ private:
+  std::string root_;
+  SimCardModel model_;
+  SimCardStats stats_;
+  uint64_t nextStallNs_ = 0;
+};
+
+/**
+ * One open file (also the SectorWriter device)
+ */
+class SimFile {
+ public:
+  SimFile() = default;
+  ~SimFile() { close(); }
+
+  SimFile(const SimFile&) = delete;
+  SimFile& operator=(const SimFile&) = delete;
+
+  bool isOpen() const { return file_ != nullptr; }
+
+  int read(void* data, size_t length) {
+    if (!file_) return -1;
+    size_t count = std::fread(data, 1, length, file_);
+    position_ += count;
+    return (int)count;
+  }
+
+  size_t write(const uint8_t* data, size_t length) {
+    if (!file_) return 0;
+    storage_->charge(storage_->writeCost());
+    SimCardStats& stats = storage_->mutableStats();
+    stats.writes++;
+    stats.bytesWritten += length;
+    if (extent_ > 0 && position_ + length > extent_) stats.extentOverruns++;
+
+    size_t written = std::fwrite(data, 1, length, file_);
+    position_ += written;
+    return written;
+  }
+
+  void flush() {
+    if (!file_) return;
+    storage_->charge(storage_->model().syncUs);
+    storage_->mutableStats().syncs++;
+    std::fflush(file_);
+  }
+
+  bool preAllocate(uint64_t length) {
+    if (!file_) return false;
+    storage_->charge(storage_->model().preAllocateUs);
+    extent_ = length;
+    return true;
+  }
+
+  bool truncate() {
+    if (!file_) return false;
+    std::fflush(file_);
+    return ftruncate(fileno(file_), (off_t)position_) == 0;
+  }
+
+  uint64_t position() const { return position_; }
+
+  bool seek(uint64_t position) {
+    if (!file_ || std::fseek(file_, (long)position, SEEK_SET) != 0) return false;
+    position_ = position;
+    return true;
+  }
+
+  bool close() {
+    if (!file_) return false;
+    std::fclose(file_);
+    file_ = nullptr;
+    return true;
+  }
+
+  bool remove() {
+    if (!file_) return false;
+    close();
+    return unlink(path_.c_str()) == 0;
+  }
+
+ private:
+  friend class SimStorage;
+
+  SimStorage* storage_ = nullptr;
+  std::FILE* file_ = nullptr;
+  std::string path_;
+  uint64_t position_ = 0;
+  uint64_t extent_ = 0;
+};
+
+inline bool SimStorage::open(SimFile& file, const char* path, HalFileMode mode) {
+  file.close();
+  file.storage_ = this;
+  file.path_ = fullPath(path);
+  file.position_ = 0;
+  file.extent_ = 0;
+  if (mode == HAL_FILE_CREATE) {
+    charge(model_.createUs);
+    stats_.filesCreated++;
+    file.file_ = std::fopen(file.path_.c_str(), "w+b");
+  } else {
+    file.file_ = std::fopen(file.path_.c_str(), "rb");
+  }
+  return file.file_ != nullptr;
+}
+
+// ==================== Capture Ports ====================
+
+/**
+ * UART line feeding one capture channel
+ * Characters arrive back to back (10 bits each), or with the idle time the
+ * gap hook puts before each, carrying an incrementing sequence byte (or
+ * what the value hook makes of it); each is stamped at the moment its stop bit ends, as
+ * lpuartReceive() would with a one-character RX watermark.
+ *
+ * @tparam Channel CaptureChannel<N>
+ */
+template <typename Channel>
+class SimSerialPort {
+ public:
+  /**
+   * Called as accepted(cycles, value, status) for every character that
+   * fit in the channel ring: its receive time (SimClock::cycles64()) and
+   * what the log should contain
+   */
+  typedef std::function<void(uint64_t, uint8_t, uint8_t)> AcceptFn;
+
+  /**
+   * Called as value(sequence) for the byte of the sequence-th character
+   */
+  typedef std::function<uint8_t(uint32_t)> ValueFn;
+
+  /**
+   * Called as gap(sequence) for the idle time (ns) before the start bit
+   * of the sequence-th character; a gap past the end of the run ends the
+   * traffic
+   */
+  typedef std::function<uint64_t(uint32_t)> GapFn;
+
+  SimSerialPort(Channel* channel, uint64_t phaseNs) : channel_(channel), phaseNs_(phaseNs) {}
+
+  void setAcceptHook(AcceptFn accepted) { accepted_ = accepted; }
+  void setValueHook(ValueFn value) { value_ = value; }
+  void setGapHook(GapFn gap) { gap_ = gap; }
+
+  void begin(uint32_t baud, const LineFormat& format = LineFormat()) {
+    characterBits_ = format.characterBits();
+    byteNs_ = (uint64_t)characterBits_ * 1000000000 / baud;
+    nextNs_ = SimClock::nowNs() + phaseNs_ + gapBefore(0) + byteNs_;
+    running_ = true;
+  }
+
+  void end() { running_ = false; }
+
+  /**
+   * Characters completed so far arrive at the old rate, the rest at baud
+   */
+  void changeBaud(uint32_t baud, uint32_t& byteCycles, uint32_t characterCycles) {
+    deliver(SimClock::nowNs());
+    byteCycles = characterCycles;
+    uint64_t newByteNs = (uint64_t)characterBits_ * 1000000000 / baud;
+    nextNs_ = nextNs_ - byteNs_ + newByteNs;
+    byteNs_ = newByteNs;
+  }
+
+  uint32_t poll() { return 0; }           // Characters arrive through deliver()
+
+  /**
+   * Deliver every character that completes up to a time
+   */
+  void deliver(uint64_t untilNs) {
+    while (running_ && nextNs_ <= untilNs) {
+      uint8_t value = value_ ? value_(sequence_) : (uint8_t)sequence_;
+      sequence_++;
+      uint64_t droppedBefore = channel_->stats.bytesDropped;
+      bool overflowBefore = channel_->overflowPending;
+      channel_->receive(SimClock::cyclesAt(nextNs_), 0, value, STATUS_OK);
+
+      if (channel_->stats.bytesDropped == droppedBefore && accepted_) {
+        accepted_(SimClock::cycles64(nextNs_), value, overflowBefore ? STATUS_OVERFLOW : STATUS_OK);
+      }
+      uint32_t used = channel_->ring.size();
+      if (used > peakUsed_) peakUsed_ = used;
+      nextNs_ += gapBefore(sequence_) + byteNs_;
+    }
+  }
+
+  uint32_t peakUsed() const { return peakUsed_; }
+  uint32_t sent() const { return sequence_; }
+
+ private:
+  uint64_t gapBefore(uint32_t sequence) {
+    if (!gap_) return 0;
+    uint64_t gap = gap_(sequence);
+    return gap < UINT64_MAX / 4 ? gap : UINT64_MAX / 4;
+  }
+
+  Channel* channel_;
+  uint64_t phaseNs_;
+  uint32_t characterBits_ = 10;
+  uint64_t byteNs_ = 0;
+  uint64_t nextNs_ = 0;
+  uint32_t sequence_ = 0;
+  bool running_ = false;
+  uint32_t peakUsed_ = 0;
+  AcceptFn accepted_;
+  ValueFn value_;
+  GapFn gap_;
+};
+
+// ==================== Edge Input ====================
+
+/**
+ * Edge interrupt whose edges are injected by the simulation
+ */
+class SimEdgeInput {
+ public:
+  void begin(uint8_t pin, HalEdgeFn onEdge) {
+    pin_ = pin;
+    onEdge_ = onEdge;
+  }
+
+  void end() { onEdge_ = nullptr; }
+
+  /**
+   * Simulate one level change on the pin
+   */
+  void edge() {
+    if (onEdge_) onEdge_();
+  }
+
+  uint8_t pin() const { return pin_; }
+
+ private:
+  uint8_t pin_ = 0;
+  HalEdgeFn onEdge_ = nullptr;
+};
+
+// ==================== Stream Port ====================
+
+/**
+ * Link to the host for the live stream
+ * Takes bytes at a fixed rate in simulated time (the host draining the
+ * USB endpoint) with a bounded backlog, and writes them to a file
+ * descriptor. Optionally corrupts one byte every corruptEvery writes.
+ */
+class SimStreamPort {
+ public:
+  /**
+   * Called as written(data, length, hostNs) for every write: the bytes
+   * and the time the host has taken the last of them
+   */
+  typedef std::function<void(const uint8_t*, size_t, uint64_t)> WriteFn;
+
+  /**
+   * @param fd Where the bytes go (-1: discard)
+   * @param bytesPerSecond Link rate
+   * @param backlogBytes Bytes the port buffers (USB transmit buffers)
+   */
+  SimStreamPort(int fd, uint64_t bytesPerSecond, uint32_t backlogBytes)
+      : fd_(fd), bytesPerSecond_(bytesPerSecond), backlogBytes_(backlogBytes) {}
+
+  void setCorruptEvery(uint32_t writes) { corruptEvery_ = writes; }
+  void setWriteHook(WriteFn written) { written_ = written; }
+
+  int availableForWrite() {
+    drain();
+    return (int)(backlogBytes_ - backlog_);
+  }
+
+  size_t write(const uint8_t* data, size_t length) {
+    drain();
+    backlog_ += length;
+    writes_++;
+    if (written_) written_(data, length, SimClock::nowNs() + backlog_ * 1000000000ULL / bytesPerSecond_);
+    if (corruptEvery_ > 0 && writes_ % corruptEvery_ == 0) {
+      std::string copy((const char*)data, length);
+      copy[writes_ % length] ^= 0x20;
+      corrupted_++;
+      return put((const uint8_t*)copy.data(), length);
+    }
+    return put(data, length);
+  }
+
+  uint64_t writes() const { return writes_; }
+  uint64_t corrupted() const { return corrupted_; }
+
+ private:
+  // Bytes the host has taken since the last call
+  void drain() {
+    uint64_t now = SimClock::nowNs();
+    uint64_t taken = (now - drainedNs_) * bytesPerSecond_ / 1000000000;
+    if (taken == 0) return;
+    drainedNs_ = now;
+    backlog_ = taken >= backlog_ ? 0 : backlog_ - taken;
+  }
+
+  size_t put(const uint8_t* data, size_t length) {
+    for (size_t done = 0; fd_ >= 0 && done < length;) {
+      ssize_t written = ::write(fd_, data + done, length - done);
+      if (written <= 0) return done;
+      done += written;
+    }
+    return length;
+  }
+
+  int fd_;
+  uint64_t bytesPerSecond_;
+  uint32_t backlogBytes_;
+  uint32_t backlog_ = 0;
+  uint64_t drainedNs_ = 0;
+  uint32_t corruptEvery_ = 0;
+  uint64_t writes_ = 0;
+  uint64_t corrupted_ = 0;
+  WriteFn written_;
+};
+
+// ==================== Bundle ====================
+
+template <typename Channel>
+struct SimHal {
+  typedef SimClock Clock;
+  typedef SimStorage Storage;
+  typedef SimFile File;
+  typedef SimSerialPort<Channel> SerialPort;
+  typedef SimEdgeInput EdgeInput;
+  typedef SimStreamPort StreamPort;
+};
+
+#endif // SIMHAL_H
@@ -0,0 +1,568 @@
+/*
+ * capture_sim - Capture engine simulation on the host
+ *
+ * Runs the firmware's CaptureEngine (merge, delta record encoding,
+ * SectorWriter, pre-allocated part files and rollover) against the
+ * simulated HAL in SimHal.h: saturated UART lines at the capture baud
+ * rate feed the channel rings while the engine writes to a directory
+ * standing in for the SD card, whose writes cost simulated time.
+ *
+ * Sweeps the length of a periodic SD write stall and, per stall length,
+ * reports bytes dropped, the high-water mark of each buffer tier (fast
+ * ring and spill ring, as in the firmware) and how often the fast ring
+ * spilled, host CPU time per logged byte and the part files written. Every run's files are read back with
+ * CaptureReader and must hold exactly the bytes that fit in the rings,
+ * per channel in order, with their receive times, overflow marks after
+ * drops and globally non-decreasing timestamps. Halfway through each run
+ * the line rate is reported changed (as relockCapture() does), and the
+ * BAUD_CHANGE event must appear exactly once, in time order. Packet
+ * framing is on: every byte must lie in exactly one packet whose
+ * PACKET_END length matches. Each part's .ssi time index must load and
+ * every entry must point at a record boundary with the right tick sum.
+ * With --compress the engine logs LZ4 blocks and the same checks run on
+ * the decompressed records; the ratio column is record bytes per file
+ * byte.
+ *
+ * With --trigger the engine runs in trigger mode: the lines carry marker
+ * byte pairs every TRIGGER_PERIOD_MS, some on channels a pattern does not
+ * watch, and the log must hold exactly the accepted records within
+ * TRIGGER_PRE_MS before to TRIGGER_POST_MS after each marker the
+ * patterns should hit (overlapping windows joined), BAUD_CHANGE only if
+ * it falls in one. Windows cut packets, so the packet checks are off.
+ *
+ * Metric snapshots are logged every METRICS_INTERVAL_MS: every METRIC
+ * value must only grow, and the last snapshot (written at stop) must hold
+ * each channel's received and dropped counts and one QUEUE sample per
+ * accepted byte. The queue_p99 column is the 99th percentile of the time
+ * bytes waited in the rings. --no-metrics runs the engine with the
+ * latency probes compiled out (CAPTURE_METRICS=0), for comparing host
+ * ns per byte.
+ *
+ * The channel buffers match the firmware's default build: a 4096-sample
+ * fast ring spilling into a 16384-sample ring. --psram uses the
+ * CAPTURE_SPILL_PSRAM sizes (262144-sample spill ring, longer stalls
+ * swept), --single one 16384-sample ring without a spill tier.
+ *
+ * Exits non-zero if any run's output is wrong, or if the run without
+ * stalls drops a byte.
+ *
+ * Usage: capture_sim [--compress] [--trigger] [--psram | --single] [--no-metrics] [channels] [baud] [seconds]
+ *                    [out_dir]
+ *        defaults: 2 channels, 2000000 baud, 5 s, /tmp/capture_sim
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CaptureEngine.h"
+#include "CaptureReader.h"
+#include "PacketAssembler.h"
+#include "SimHal.h"
+#include "TimeIndex.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t RING_SIZE = 4096;                  // Matches CHANNEL_RING_SIZE
+const uint32_t SPILL_SIZE = 16384;                // Matches CHANNEL_SPILL_SIZE
+const uint32_t PSRAM_SPILL_SIZE = 262144;         // ... with CAPTURE_SPILL_PSRAM
+const uint32_t SINGLE_RING_SIZE = 16384;          // --single
+const uint32_t MAX_CHANNELS = 8;
+const uint32_t WRITER_BLOCKS = 8;                 // Matches SD_WRITER_BLOCKS
+const uint64_t PREALLOCATE_BYTES = 4ULL * 1024 * 1024;   // Small, to exercise rollover
+const uint32_t INDEX_INTERVAL_RECORDS = 16384;    // Dense, to exercise the index table
+const uint64_t LOOP_NS = 2000;                    // loop() overhead per pass
+const uint64_t CPU_NS_PER_RECORD = 150;           // Merge + encode on the Teensy
+const uint32_t CYCLE_OFFSET = 0xFFF00000;         // Counter wraps ~1.7 ms in
+const uint32_t STALL_EVERY_MS = 1000;
+const uint32_t STALLS_MS[] = {0, 10, 25, 50, 75, 100, 150, 250};
+const uint32_t PSRAM_STALLS_MS[] = {0, 25, 50, 100, 250, 500, 750, 900};
+const uint32_t TRIGGER_PERIOD_MS = 200;           // Marker spacing per channel
+const uint32_t TRIGGER_PRE_MS = 20;
+const uint32_t TRIGGER_POST_MS = 30;
+const uint32_t TRIGGER_HISTORY_BYTES = 128 * 1024;
+const uint32_t METRICS_INTERVAL_MS = 1000;
+const char* const TRIGGER_PATTERNS[] = {"F0 0D", "TX: F1 3?"};   // Markers F0 0D (any), F1 3C (TX only)
+
+typedef CaptureChannel<RING_SIZE, SPILL_SIZE> TieredChannel;
+typedef CaptureChannel<RING_SIZE, PSRAM_SPILL_SIZE> PsramChannel;
+typedef CaptureChannel<SINGLE_RING_SIZE> SingleChannel;
+
+// ==================== Run ====================
+
+struct Expected {
+  uint64_t ticks;
+  uint8_t value;
+  uint8_t status;
+};
+
+struct ExpectedEvent {
+  uint64_t ticks;
+  uint32_t baud;
+};
+
+struct Window {
+  uint64_t startTicks;
+  uint64_t endTicks;
+};
+
+struct RunResult {
+  uint64_t received = 0;
+  uint64_t dropped = 0;
+  uint32_t fastPeak = 0;          // Samples, highest channel
+  uint32_t spillPeak = 0;
+  uint32_t spills = 0;            // All channels
+  uint32_t parts = 0;
+  uint64_t packets = 0;
+  uint64_t indexEntries = 0;
+  uint32_t windows = 0;           // Trigger windows logged
+  double ratio = 1;               // Record bytes per file byte (compressed runs)
+  double hostNsPerByte = 0;
+  double cardBusy = 0;            // Fraction of simulated time in card operations
+  double queueP99Ms = 0;          // Ring wait, 99th percentile (with metrics)
+  std::string error;              // Empty if the log verified
+};
+
+static uint32_t engineErrors = 0;
+
+static void onEngineMessage(const char* message) {
+  if (std::strncmp(message, "ERROR", 5) == 0) {
+    std::fprintf(stderr, "%s\n", message);
+    engineErrors++;
+  }
+}
+
+static void clearDirectory(const std::string& dir) {
+  std::string command = "rm -f '" + dir + "'/capture_*.ssb '" + dir + "'/capture_*.ssi '" + dir + "'/capture.idx";
+  if (std::system(command.c_str()) != 0) {
+    std::fprintf(stderr, "cannot clear %s\n", dir.c_str());
+  }
+}
+
+// Read the session back and compare with what the ports delivered
+static std::string verify(const std::string& dir, const char* firstName, uint32_t channelCount,
+                          std::vector<std::deque<Expected>>& expected, const ExpectedEvent& rateChange,
+                          bool triggered, const MetricsSnapshot& metrics, bool probes, uint32_t& parts,
+                          uint64_t& packets, uint64_t& indexEntries) {
+  std::string base(firstName);
+  std::map<uint32_t, uint64_t> metricValues;    // id << 8 | channel: last logged value
+  base = base.substr(0, base.rfind('.'));
+  uint64_t lastTicks = 0;
+  uint32_t rateChanges = 0;
+  PacketAssembler assembler;
+  uint32_t openPackets = 0;
+  parts = 0;
+  packets = 0;
+  indexEntries = 0;
+
+  for (;;) {
+    std::string name = dir + "/" + base;
+    if (parts > 0) name += "_" + std::to_string(parts);
+    name += ".ssb";
+    struct stat info;
+    if (stat(name.c_str(), &info) != 0) break;
+
+    CaptureMap map;
+    TimeIndex index;
+    if (!map.open(name)) return map.error();
+    if (!index.load(TimeIndex::sidecarPath(name), map)) return index.error();
+    if (!index.check(map)) return index.error() + " in " + TimeIndex::sidecarPath(name);
+    indexEntries += index.size();
+
+    CaptureReader reader;
+    if (!reader.open(name)) return reader.error();
+    if (reader.timestampHz() != SimClock::CYCLE_HZ) return "wrong timestampHz in " + name;
+
+    CaptureEvent event;
+    while (reader.next(event)) {
+      if (event.ticks < lastTicks) return "records out of time order in " + name;
+      lastTicks = event.ticks;
+
+      if (event.kind == RECORD_KIND_METRIC) {
+        uint64_t& last = metricValues[(uint32_t)event.value << 8 | event.channel];
+        if (event.argument < last) return "METRIC value went down in " + name;
+        last = event.argument;
+        continue;
+      }
+
+      if (event.kind == RECORD_KIND_BAUD_CHANGE) {
+        if (event.ticks != rateChange.ticks || event.argument != rateChange.baud || event.channel != 0) {
+          return "wrong BAUD_CHANGE event in " + name;
+        }
+        rateChanges++;
+        continue;
+      }
+
+      // Packets may continue across part files
+      CapturedPacket packet;
+      if (event.kind == RECORD_KIND_PACKET_START) openPackets++;
+      if (assembler.add(event, packet)) {
+        if (!packet.intact && !triggered) return "PACKET_END length mismatch in " + name;
+        openPackets--;
+        packets++;
+      }
+      if (event.kind == RECORD_KIND_PACKET_START || event.kind == RECORD_KIND_PACKET_END ||
+          event.kind == RECORD_KIND_CHECKSUM) {
+        continue;
+      }
+      if (event.kind != RECORD_KIND_DATA || event.channel >= channelCount) {
+        return "unexpected record in " + name;
+      }
+
+      std::deque<Expected>& queue = expected[event.channel];
+      if (queue.empty()) return "extra record in " + name;
+      const Expected& want = queue.front();
+      if (event.value != want.value || event.ticks != want.ticks || event.status != want.status) {
+        char text[160];
+        std::snprintf(text, sizeof(text),
+                      "%s ch%u: got 0x%02X @%llu st%u, expected 0x%02X @%llu st%u", name.c_str(),
+                      event.channel, event.value, (unsigned long long)event.ticks, event.status,
+                      want.value, (unsigned long long)want.ticks, want.status);
+        return text;
+      }
+      queue.pop_front();
+    }
+    parts++;
+  }
+
+  // The snapshot at stop holds the final counts
+  uint64_t accepted = 0;
+  for (uint32_t i = 0; i < channelCount; i++) {
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+    metrics.value(METRIC_BYTES_RECEIVED, (uint8_t)i, received);
+    metrics.value(METRIC_BYTES_DROPPED, (uint8_t)i, dropped);
+    if (metricValues[METRIC_BYTES_RECEIVED << 8 | i] != received ||
+        metricValues[METRIC_BYTES_DROPPED << 8 | i] != dropped) {
+      return "wrong BYTES_RECEIVED/BYTES_DROPPED metrics for ch" + std::to_string(i);
+    }
+    accepted += received - dropped;
+  }
+  uint64_t queued = metricValues[(STAGE_QUEUE * METRIC_STAGE_IDS + METRIC_FIELD_COUNT) << 8];
+  if (queued != (probes ? accepted : 0)) {
+    return "QUEUE_COUNT metric " + std::to_string(queued) + ", expected " + std::to_string(probes ? accepted : 0);
+  }
+
+  if (parts == 0) return "no capture file written";
+  if (!triggered && assembler.orphanBytes() > 0) return "bytes outside packets";
+  if (!triggered && openPackets > 0) return "packets without PACKET_END";
+  uint32_t wantChanges = rateChange.ticks != UINT64_MAX ? 1 : 0;
+  if (rateChanges != wantChanges) {
+    return std::to_string(rateChanges) + " BAUD_CHANGE events, expected " + std::to_string(wantChanges);
+  }
+  for (uint32_t i = 0; i < channelCount; i++) {
+    if (!expected[i].empty()) return "records missing on channel " + std::to_string(i);
+  }
+  return "";
+}
+
+// Marker bytes at fixed points of each channel's sequence; other bytes
+// stay below 0x80 so they never look like one
+static uint8_t markedValue(uint32_t channel, uint32_t period, uint32_t sequence) {
+  uint32_t at = sequence % period;
+  uint32_t hit = period * channel / 3;                // F0 0D: every channel
+  uint32_t other = period * 2 / 3;                    // F1 3C: only a TX pattern
+  if (at == hit) return 0xF0;
+  if (at == hit + 1) return 0x0D;
+  if (at == other) return 0xF1;
+  if (at == other + 1) return 0x3C;
+  return (uint8_t)(sequence & 0x7F);
+}
+
+// Keep only what lies in the windows around the hits (joined where they touch)
+static std::vector<Window> windowsAround(std::vector<uint64_t> hits, uint64_t preTicks, uint64_t postTicks) {
+  std::sort(hits.begin(), hits.end());
+  std::vector<Window> windows;
+  for (uint64_t ticks : hits) {
+    uint64_t start = ticks > preTicks ? ticks - preTicks : 0;
+    if (!windows.empty() && start <= windows.back().endTicks) {
+      windows.back().endTicks = std::max(windows.back().endTicks, ticks + postTicks);
+    } else {
+      windows.push_back({start, ticks + postTicks});
+    }
+  }
+  return windows;
+}
+
+static bool inWindows(const std::vector<Window>& windows, uint64_t ticks) {
+  for (const Window& window : windows) {
+    if (ticks >= window.startTicks && ticks <= window.endTicks) return true;
+  }
+  return false;
+}
+
+// Give a channel its spill ring, as setup() does (none without a spill tier)
+template <uint32_t Fast>
+static typename CaptureChannel<Fast>::SpillRing* attachSpill(CaptureChannel<Fast>*) {
+  return nullptr;
+}
+
+template <uint32_t Fast, uint32_t Spill>
+static typename CaptureChannel<Fast, Spill>::SpillRing* attachSpill(CaptureChannel<Fast, Spill>* channel) {
+  typename CaptureChannel<Fast, Spill>::SpillRing* spill = new typename CaptureChannel<Fast, Spill>::SpillRing();
+  channel->ring.attachSpill(spill);
+  return spill;
+}
+
+template <typename Channel, bool Metrics>
+static RunResult simulate(uint32_t channelCount, uint32_t baud, uint32_t seconds, uint32_t stallMs,
+                          bool compress, bool triggered, const std::string& dir) {
+  typedef SimHal<Channel> Hal;
+  typedef CaptureEngine<Hal, Channel, MAX_CHANNELS, WRITER_BLOCKS, Metrics> Engine;
+  RunResult result;
+  clearDirectory(dir);
+  engineErrors = 0;
+
+  SimCardModel card;
+  card.stallUs = stallMs * 1000;
+  card.stallEveryMs = STALL_EVERY_MS;
+  SimStorage storage(dir, card);
+
+  std::vector<Channel*> channels;
+  std::vector<typename Channel::SpillRing*> spills;
+  std::vector<SimSerialPort<Channel>*> ports;
+  std::vector<std::deque<Expected>> expected(channelCount);
+  uint64_t originCycles = 0;
+  double hookSeconds = 0;
+
+  SimClock::reset(CYCLE_OFFSET, [&](uint64_t untilNs) {
+    auto start = std::chrono::steady_clock::now();
+    for (SimSerialPort<Channel>* port : ports) port->deliver(untilNs);
+    hookSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+
+  Engine* engine = new Engine();
+  CaptureEngineConfig config;
+  config.preallocateBytes = PREALLOCATE_BYTES;
+  config.firmwareVersion = "sim";
+  config.indexIntervalRecords = INDEX_INTERVAL_RECORDS;
+  config.compressBlocks = compress;
+  config.metricsIntervalMs = METRICS_INTERVAL_MS;
+  std::vector<uint8_t> history(TRIGGER_HISTORY_BYTES);
+  if (triggered) {
+    for (const char* pattern : TRIGGER_PATTERNS) config.trigger.addPattern(pattern);
+    config.trigger.preTriggerMs = TRIGGER_PRE_MS;
+    config.trigger.postTriggerMs = TRIGGER_POST_MS;
+    config.trigger.history = history.data();
+    config.trigger.historyBytes = TRIGGER_HISTORY_BYTES;
+    config.trigger.enabled = true;
+  }
+  engine->begin(&storage, config, onEngineMessage);
+
+  // Marker pairs the patterns hit: the last byte's time, in accepted order
+  // (drops between the two bytes still make a pair for the matcher)
+  uint32_t period = (uint32_t)((uint64_t)baud / 10 * TRIGGER_PERIOD_MS / 1000);
+  std::vector<uint64_t> hits;
+  std::vector<uint8_t> previous(channelCount, 0);
+
+  for (uint32_t i = 0; i < channelCount; i++) {
+    Channel* channel = new Channel();
+    channel->id = (uint8_t)i;
+    spills.push_back(attachSpill(channel));
+    channels.push_back(channel);
+    engine->addChannel(channel);
+
+    // Lines are offset by a fraction of a character so stamps interleave
+    SimSerialPort<Channel>* port = new SimSerialPort<Channel>(channel, 1300ULL * i);
+    port->setAcceptHook([&expected, &originCycles, &hits, &previous, i](uint64_t cycles, uint8_t value,
+                                                                      uint8_t status) {
+      expected[i].push_back({cycles - originCycles, value, status});
+      if ((previous[i] == 0xF0 && value == 0x0D) || (previous[i] == 0xF1 && value == 0x3C && i == CHANNEL_TX)) {
+        hits.push_back(cycles - originCycles);
+      }
+      previous[i] = value;
+    });
+    if (triggered) {
+      port->setValueHook([i, period](uint32_t sequence) { return markedValue(i, period, sequence); });
+    }
+    ports.push_back(port);
+  }
+
+  // As startCapture(): origin first, then open the file, then start the ports
+  uint32_t origin = SimClock::cycles();
+  originCycles = SimClock::cycles64(SimClock::nowNs());
+  if (!engine->start(baud, origin)) {
+    result.error = "could not start";
+    return result;
+  }
+  std::string firstName = engine->filename();
+  uint32_t characterCycles = (uint32_t)((uint64_t)SimClock::CYCLE_HZ * 10 / baud);
+  for (uint32_t i = 0; i < channelCount; i++) {
+    channels[i]->reset(origin, characterCycles);
+    ports[i]->begin(baud);
+  }
+
+  // loop(): one service pass, then the CPU time it took on the Teensy
+  double serviceSeconds = 0;
+  uint64_t logged = 0;
+  uint64_t endNs = (uint64_t)seconds * 1000000000;
+  ExpectedEvent rateChange = {0, baud};
+  bool rateChanged = false;
+  while (SimClock::nowNs() < endNs) {
+    if (!rateChanged && SimClock::nowNs() >= endNs / 2) {
+      // Marker only: the lines keep their rate
+      engine->lineRateChanged(0, baud, SimClock::cycles());
+      rateChange.ticks = SimClock::cycles64(SimClock::nowNs()) - originCycles;
+      rateChanged = true;
+    }
+
+    double hookBefore = hookSeconds;
+    auto start = std::chrono::steady_clock::now();
+    uint32_t count = engine->service(true);
+    serviceSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    serviceSeconds -= hookSeconds - hookBefore;
+    logged += count;
+    SimClock::advance(LOOP_NS + count * CPU_NS_PER_RECORD);
+  }
+
+  for (SimSerialPort<Channel>* port : ports) port->end();
+  engine->stop();
+
+  for (uint32_t i = 0; i < channelCount; i++) {
+    result.received += channels[i]->stats.bytesReceived;
+    result.dropped += channels[i]->stats.bytesDropped;
+    result.fastPeak = std::max(result.fastPeak, channels[i]->ring.fastPeak());
+    result.spillPeak = std::max(result.spillPeak, channels[i]->ring.spillPeak());
+    result.spills += channels[i]->ring.spills();
+  }
+  if (triggered) {
+    uint64_t preTicks = (uint64_t)SimClock::CYCLE_HZ * TRIGGER_PRE_MS / 1000;
+    uint64_t postTicks = (uint64_t)SimClock::CYCLE_HZ * TRIGGER_POST_MS / 1000;
+    std::vector<Window> windows = windowsAround(hits, preTicks, postTicks);
+    for (std::deque<Expected>& queue : expected) {
+      std::deque<Expected> kept;
+      for (const Expected& want : queue) {
+        if (inWindows(windows, want.ticks)) kept.push_back(want);
+      }
+      queue.swap(kept);
+    }
+    if (!inWindows(windows, rateChange.ticks)) rateChange.ticks = UINT64_MAX;
+    result.windows = engine->triggerStats().windows;
+    if (result.windows != windows.size()) {
+      result.error = std::to_string(result.windows) + " trigger windows, expected " + std::to_string(windows.size());
+    }
+  }
+  MetricsSnapshot metrics;
+  engine->metricsSnapshot(metrics);
+  uint32_t queueP99 = metrics.stages[STAGE_QUEUE].percentile(990);
+  result.queueP99Ms = queueP99 * 1000.0 / SimClock::CYCLE_HZ;
+  result.hostNsPerByte = logged > 0 ? serviceSeconds * 1e9 / logged : 0;
+  result.cardBusy = (double)storage.stats().busyNs / SimClock::nowNs();
+  const BlockCompressorStats& blocks = engine->compressionStats();
+  if (blocks.fileBytes > 0) result.ratio = (double)blocks.rawBytes / blocks.fileBytes;
+
+  if (!result.error.empty()) {
+    // Already failed
+  } else if (engineErrors > 0) {
+    result.error = "engine reported errors";
+  } else if (storage.stats().extentOverruns > 0) {
+    result.error = "wrote past the pre-allocated extent";
+  } else {
+    result.error = verify(dir, firstName.c_str(), channelCount, expected, rateChange, triggered, metrics, Metrics,
+                          result.parts, result.packets, result.indexEntries);
+  }
+
+  delete engine;
+  for (SimSerialPort<Channel>* port : ports) delete port;
+  for (Channel* channel : channels) delete channel;
+  for (typename Channel::SpillRing* spill : spills) delete spill;
+  return result;
+}
+
+// One run per stall length; false if any run failed
+template <typename Channel, bool Metrics, size_t StallCount>
+static bool sweep(uint32_t channelCount, uint32_t baud, uint32_t seconds, const uint32_t (&stalls)[StallCount],
+                  bool compress, bool triggered, const std::string& dir) {
+  Channel probe;
+  typename Channel::SpillRing* spill = attachSpill(&probe);
+  uint32_t fastSize = probe.ring.fastCapacity();
+  uint32_t spillSize = probe.ring.spillCapacity();
+  delete spill;
+
+  std::printf("%u channel(s) at %u baud, %u s each, %u x 512 B writer%s%s%s\n", channelCount, baud, seconds,
+              WRITER_BLOCKS, compress ? ", LZ4 blocks" : "", triggered ? ", trigger windows" : "",
+              Metrics ? "" : ", no latency probes");
+  std::printf("Buffers: %u-sample fast ring + %u-sample spill ring per channel (%.1f ms)\n", fastSize, spillSize,
+              (fastSize + spillSize) * 10.0 * 1000 / baud);
+  std::printf("SD model: %u us/write, one stall per %u ms; output in %s\n\n",
+              SimCardModel().writeUs, STALL_EVERY_MS, dir.c_str());
+  std::printf("%8s %12s %10s %9s %10s %6s %7s %6s %8s %6s %7s %6s %9s %10s  %s\n", "stall_ms", "bytes",
+              "dropped", "fast_peak", "spill_peak", "spills", "card", "parts", "packets", "index", "windows", "ratio",
+              "queue_p99", "host_ns/B", "log");
+
+  bool allOk = true;
+  uint32_t tolerated = 0;
+  bool dropsSeen = false;
+  for (uint32_t stallMs : stalls) {
+    RunResult result = simulate<Channel, Metrics>(channelCount, baud, seconds, stallMs, compress, triggered, dir);
+    bool ok = result.error.empty();
+    char queue[16] = "-";
+    if (Metrics) std::snprintf(queue, sizeof(queue), "%.1fms", result.queueP99Ms);
+    std::printf("%8u %12llu %10llu %8.1f%% %9.1f%% %6u %6.1f%% %6u %8llu %6llu %7u %6.2f %9s %10.1f  %s\n", stallMs,
+                (unsigned long long)result.received, (unsigned long long)result.dropped,
+                100.0 * result.fastPeak / fastSize, spillSize ? 100.0 * result.spillPeak / spillSize : 0.0,
+                result.spills, 100.0 * result.cardBusy, result.parts, (unsigned long long)result.packets,
+                (unsigned long long)result.indexEntries, result.windows, result.ratio, queue, result.hostNsPerByte,
+                ok ? "ok" : result.error.c_str());
+    allOk &= ok;
+    if (stallMs == 0 && result.dropped > 0) allOk = false;
+    if (result.dropped == 0 && !dropsSeen) tolerated = stallMs;
+    if (result.dropped > 0) dropsSeen = true;
+  }
+
+  std::printf("\nLongest stall without loss: %u ms\n", tolerated);
+  return allOk;
+}
+
+int main(int argc, char** argv) {
+  bool compress = false;
+  bool triggered = false;
+  bool psram = false;
+  bool single = false;
+  bool metrics = true;
+  while (argc > 1 && std::strncmp(argv[1], "--", 2) == 0) {
+    if (std::strcmp(argv[1], "--compress") == 0) compress = true;
+    else if (std::strcmp(argv[1], "--trigger") == 0) triggered = true;
+    else if (std::strcmp(argv[1], "--psram") == 0) psram = true;
+    else if (std::strcmp(argv[1], "--single") == 0) single = true;
+    else if (std::strcmp(argv[1], "--no-metrics") == 0) metrics = false;
+    else argc = 0;                // Unknown option: usage
+    argv++;
+    argc--;
+  }
+  uint32_t channelCount = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2;
+  uint32_t baud = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 2000000;
+  uint32_t seconds = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 5;
+  std::string dir = (argc > 4) ? argv[4] : "/tmp/capture_sim";
+
+  if (argc < 1 || channelCount < 1 || channelCount > MAX_CHANNELS || baud == 0 || seconds == 0) {
+    std::fprintf(stderr, "Usage: capture_sim [--compress] [--trigger] [--psram | --single] [--no-metrics] "
+                 "[channels 1-8] [baud] [seconds] [out_dir]\n");
+    return 2;
+  }
+  mkdir(dir.c_str(), 0755);
+
+  bool ok;
+  if (!metrics) {
+    if (psram) ok = sweep<PsramChannel, false>(channelCount, baud, seconds, PSRAM_STALLS_MS, compress, triggered, dir);
+    else if (single) ok = sweep<SingleChannel, false>(channelCount, baud, seconds, STALLS_MS, compress, triggered, dir);
+    else ok = sweep<TieredChannel, false>(channelCount, baud, seconds, STALLS_MS, compress, triggered, dir);
+  } else if (psram) {
+    ok = sweep<PsramChannel, true>(channelCount, baud, seconds, PSRAM_STALLS_MS, compress, triggered, dir);
+  } else if (single) {
+    ok = sweep<SingleChannel, true>(channelCount, baud, seconds, STALLS_MS, compress, triggered, dir);
+  } else {
+    ok = sweep<TieredChannel, true>(channelCount, baud, seconds, STALLS_MS, compress, triggered, dir);
+  }
+  return ok ? 0 : 1;
+}
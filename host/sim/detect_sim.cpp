@@ -0,0 +1,262 @@
+/*
+ * detect_sim - Background baud detection simulation
+ *
+ * Drives the firmware's BaudDetector the way loop() and the edge
+ * interrupt do: edges from SimEdgeTrain are delivered as they occur and
+ * poll() runs every millisecond of simulated time. Each scenario checks
+ * the events poll() reports and when:
+ *
+ *   lock           LISTENING locks on the right rate within 2 s (FR-001)
+ *   timeout        A silent line fails after the timeout, never locks
+ *   change         A monitored line that switches rate re-locks once,
+ *                  within 1 s, and reports nothing before the switch
+ *   idle           A monitored line that goes quiet reports nothing
+ *   unverified     A monitored pin that never shows the given rate (not
+ *                  wired to the line) reports nothing
+ *   noise          Heavy glitching and jitter on a steady line report
+ *                  nothing
+ *   stop           Edges and polls after stop() do nothing
+ *
+ * Exits non-zero if any scenario fails.
+ *
+ * Usage: detect_sim [seeds]
+ *        default: 20 seeds per scenario
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "BaudDetector.h"
+#include "SimEdgeTrain.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CYCLE_HZ = 600000000;
+const uint32_t CYCLES_PER_MS = CYCLE_HZ / 1000;
+const uint32_t LOCK_DEADLINE_MS = 2000;           // FR-001
+const uint32_t RELOCK_DEADLINE_MS = 1000;
+
+// ==================== Harness ====================
+
+struct Observed {
+  BaudDetectEvent event;
+  uint32_t atMs;
+  uint32_t baud;
+};
+
+/**
+ * Simulated line + loop() around one detector
+ */
+class Bench {
+ public:
+  Bench(uint32_t baud, uint32_t seed, const EdgeTrainModel& model = EdgeTrainModel())
+      : train_(baud, seed, seed % 2 == 1, model) {
+    detector_.begin(CYCLE_HZ, BaudDetectConfig());
+  }
+
+  BaudDetector& detector() { return detector_; }
+  EdgeTrain& train() { return train_; }
+  uint32_t nowMs() const { return nowMs_; }
+
+  /**
+   * Run loop() for a while
+   * @param ms Duration
+   * @param traffic false: the line is idle
+   */
+  void run(uint32_t ms, bool traffic = true) {
+    for (uint32_t end = nowMs_ + ms; nowMs_ < end;) {
+      nowMs_++;
+      double until = (double)nowMs_ * CYCLES_PER_MS;
+      if (traffic) {
+        train_.generate(until, edges_);
+      } else {
+        train_.idle(until);
+      }
+      // The interrupt sees the wrapping 32-bit counter
+      for (uint64_t edge : edges_) detector_.edge((uint32_t)edge);
+      edges_.clear();
+
+      BaudDetectEvent event = detector_.poll(nowMs_);
+      if (event != BAUD_EVENT_NONE) observed_.push_back({event, nowMs_, detector_.baud()});
+    }
+  }
+
+  const std::vector<Observed>& observed() const { return observed_; }
+
+ private:
+  BaudDetector detector_;
+  EdgeTrain train_;
+  std::vector<uint64_t> edges_;
+  std::vector<Observed> observed_;
+  uint32_t nowMs_ = 0;
+};
+
+static bool near(uint32_t estimate, uint32_t baud) {
+  if (nearestStandardBaud(baud, 0) == baud) return estimate == baud;
+  uint32_t diff = estimate > baud ? estimate - baud : baud - estimate;
+  return diff * 100.0 <= baud;
+}
+
+static const char* eventName(BaudDetectEvent event) {
+  switch (event) {
+    case BAUD_EVENT_LOCKED: return "LOCKED";
+    case BAUD_EVENT_RATE_CHANGED: return "RATE_CHANGED";
+    case BAUD_EVENT_TIMED_OUT: return "TIMED_OUT";
+    default: return "NONE";
+  }
+}
+
+static std::string describe(const std::vector<Observed>& observed) {
+  std::string text;
+  for (const Observed& o : observed) {
+    char item[64];
+    std::snprintf(item, sizeof(item), "%s%s@%ums(%u)", text.empty() ? "" : " ", eventName(o.event),
+                  o.atMs, o.baud);
+    text += item;
+  }
+  return text.empty() ? "no events" : text;
+}
+
+// ==================== Scenarios ====================
+
+// Each returns an empty string on success, else what went wrong
+
+static std::string lock(uint32_t baud, uint32_t seed) {
+  Bench bench(baud, seed);
+  bench.detector().start(0);
+  bench.run(LOCK_DEADLINE_MS + 500);
+  const std::vector<Observed>& o = bench.observed();
+  if (o.size() != 1 || o[0].event != BAUD_EVENT_LOCKED || o[0].atMs > LOCK_DEADLINE_MS ||
+      !near(o[0].baud, baud)) {
+    return describe(o);
+  }
+  return "";
+}
+
+static std::string timeout(uint32_t seed) {
+  Bench bench(115200, seed);
+  bench.detector().start(0);
+  bench.run(12000, false);
+  const std::vector<Observed>& o = bench.observed();
+  BaudDetectConfig config;
+  if (o.size() != 1 || o[0].event != BAUD_EVENT_TIMED_OUT || o[0].atMs < config.timeoutMs ||
+      bench.detector().state() != BAUD_DETECT_FAILED) {
+    return describe(o);
+  }
+  return "";
+}
+
+static std::string change(uint32_t from, uint32_t to, uint32_t seed) {
+  Bench bench(from, seed);
+  bench.detector().monitor(from, 0);
+  bench.run(2000);
+  if (!bench.observed().empty()) return "before switch: " + describe(bench.observed());
+
+  uint32_t switchMs = bench.nowMs();
+  bench.train().setBaud(to);
+  bench.run(3000);
+  const std::vector<Observed>& o = bench.observed();
+  if (o.size() != 1 || o[0].event != BAUD_EVENT_RATE_CHANGED ||
+      o[0].atMs - switchMs > RELOCK_DEADLINE_MS || !near(o[0].baud, to) ||
+      bench.detector().state() != BAUD_DETECT_LOCKED) {
+    return describe(o);
+  }
+  return "";
+}
+
+static std::string idle(uint32_t seed) {
+  Bench bench(115200, seed);
+  bench.detector().monitor(115200, 0);
+  bench.run(500);
+  bench.run(5000, false);
+  bench.run(500);
+  if (!bench.observed().empty() || bench.detector().baud() != 115200) return describe(bench.observed());
+  return "";
+}
+
+static std::string unverified(uint32_t seed) {
+  Bench bench(57600, seed);
+  bench.detector().monitor(115200, 0);
+  bench.run(5000);
+  if (!bench.observed().empty() || bench.detector().verified()) return describe(bench.observed());
+  return "";
+}
+
+static std::string noise(uint32_t seed) {
+  EdgeTrainModel model;
+  model.jitterCycles = 400;           // Interrupt latency spread of ~0.7 us
+  model.glitchPerChar = 0.2;
+  Bench bench(115200, seed, model);
+  bench.detector().monitor(115200, 0);
+  bench.run(10000);
+  if (!bench.observed().empty()) return describe(bench.observed());
+  return "";
+}
+
+static std::string stop(uint32_t seed) {
+  Bench bench(57600, seed);
+  bench.detector().start(0);
+  bench.run(50);
+  bench.detector().stop();
+  bench.run(12000);
+  if (!bench.observed().empty() || bench.detector().state() != BAUD_DETECT_OFF) {
+    return describe(bench.observed());
+  }
+  return "";
+}
+
+// ==================== Run ====================
+
+struct Scenario {
+  const char* name;
+  std::string (*run)(uint32_t seed);
+};
+
+static const Scenario SCENARIOS[] = {
+  {"lock 9600", [](uint32_t seed) { return lock(9600, seed); }},
+  {"lock 115200", [](uint32_t seed) { return lock(115200, seed); }},
+  {"lock 2000000", [](uint32_t seed) { return lock(2000000, seed); }},
+  {"lock 1234567", [](uint32_t seed) { return lock(1234567, seed); }},
+  {"timeout", timeout},
+  {"change 115200->57600", [](uint32_t seed) { return change(115200, 57600, seed); }},
+  {"change 9600->921600", [](uint32_t seed) { return change(9600, 921600, seed); }},
+  {"change 1000000->1234567", [](uint32_t seed) { return change(1000000, 1234567, seed); }},
+  {"idle", idle},
+  {"unverified", unverified},
+  {"noise", noise},
+  {"stop", stop},
+};
+
+int main(int argc, char** argv) {
+  uint32_t seeds = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 20;
+  if (seeds == 0) seeds = 1;
+
+  BaudDetectConfig config;
+  std::printf("%u seeds per scenario; solve every %u ms, timeout %u ms, %u ms monitor windows, "
+              "%u to re-lock\n\n", seeds, config.solveIntervalMs, config.timeoutMs,
+              config.monitorWindowMs, config.confirmWindows);
+  std::printf("%-26s %7s  %s\n", "scenario", "passed", "result");
+
+  bool allOk = true;
+  for (const Scenario& scenario : SCENARIOS) {
+    uint32_t passed = 0;
+    std::string firstError;
+    for (uint32_t seed = 1; seed <= seeds; seed++) {
+      std::string error = scenario.run(seed * 7919);
+      if (error.empty()) {
+        passed++;
+      } else if (firstError.empty()) {
+        firstError = "seed " + std::to_string(seed * 7919) + ": " + error;
+      }
+    }
+    bool ok = passed == seeds;
+    std::printf("%-26s %3u/%-3u  %s\n", scenario.name, passed, seeds, ok ? "ok" : firstError.c_str());
+    allOk &= ok;
+  }
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,391 @@
+/*
+ * dma_sim - Circular DMA receive simulation
+ *
+ * Drives the firmware's DmaRxRing and drainDmaRing() (DmaReceive.h) the
+ * way a capture port with CAPTURE_UART_DMA does: a simulated DMA engine
+ * writes each character of a simulated line into the ring and wraps, its
+ * lap interrupt and the UART's idle line interrupt run after their
+ * latency, and the capture task polls the write position at random
+ * intervals. Every character the consumer moves into the CaptureChannel
+ * is checked against what was sent. Scenarios:
+ *
+ *   continuous     Back-to-back characters, polled every 5-500 us
+ *   bursts         Bursts with idle gaps, stamped through idle marks
+ *   bursts no idle The same without the idle interrupt: stamps count back
+ *                  from the poll instead (only checked not to be early)
+ *   short bursts   Many short bursts between polls
+ *   mark overflow  Short bursts and stalls: more idle marks than the queue
+ *                  holds; words past the queued marks are dated from the
+ *                  newest mark (only checked not to be early)
+ *   stall          The capture task stalls longer than the ring holds;
+ *                  the oldest words are skipped as lost
+ *   late lap       The lap interrupt runs long after the wrap, so polls
+ *                  see the position wrap before the lap count does
+ *   errors         Framing/parity flagged characters and FIFO overrun
+ *                  reports
+ *
+ * Exits non-zero if any character is lost (outside the stall scenario),
+ * repeated, reordered, changed or flagged wrongly, if a skip is not
+ * exactly what the ring reports as lost or the next character lacks
+ * STATUS_OVERFLOW, or if a stamp is earlier than the character arrived
+ * or (where checked) later than two character times plus the interrupt
+ * latency.
+ *
+ * Usage: dma_sim [seeds] [seconds]
+ *        defaults: 10 seeds per scenario, 1 simulated second each
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CaptureChannel.h"
+#include "DmaReceive.h"
+#include "SimHal.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t DMA_WORDS = 8192;                  // Matches DMA_RX_WORDS
+const uint32_t IDLE_CHARACTERS = 1;               // Matches TeensyDmaSerialPort
+const uint64_t DMA_NS = 100;                      // Stop bit to word in memory
+const uint64_t ISR_NS = 500;                      // Idle interrupt entry latency
+const uint32_t CYCLE_OFFSET = 0xFFF00000;
+const uint16_t FRAMING_BIT = 1 << 13;             // LPUART DATA FRETSC
+const uint16_t PARITY_BIT = 1 << 14;              // LPUART DATA PARITYE
+const DmaWordFormat FORMAT = {FRAMING_BIT, PARITY_BIT, 0xFF};
+
+typedef DmaRxRing<DMA_WORDS> Ring;
+typedef CaptureChannel<65536> Channel;
+
+/**
+ * Simulated line
+ */
+struct LineModel {
+  uint32_t baud;
+  uint32_t burstMin = 0;          // Characters per burst, 0 = continuous
+  uint32_t burstMax = 0;
+  uint32_t gapMin = 0;            // Idle characters between bursts
+  uint32_t gapMax = 0;
+  uint32_t errorEvery = 0;        // 1 in N characters flagged, 0 = none
+};
+
+/**
+ * Simulated capture task and interrupts
+ */
+struct ConsumerModel {
+  uint32_t pollMinUs;
+  uint32_t pollMaxUs;
+  uint32_t stallEveryMs = 0;      // 0 = no stalls
+  uint32_t stallMs = 0;
+  uint64_t lapIsrNs = 500;
+  bool idleInterrupt = true;
+  uint32_t overrunEveryMs = 0;    // FIFO overrun reports, 0 = none
+};
+
+struct Scenario {
+  const char* name;
+  LineModel line;
+  ConsumerModel consumer;
+  bool expectLoss;
+  bool boundedStamps;             // false: only checked not to be early
+  bool expectMarkDrops;
+};
+
+struct Result {
+  std::string error;
+  uint64_t words = 0;
+  uint64_t lost = 0;
+  uint64_t marksDropped = 0;
+  int64_t maxErrorNs = 0;
+  double consumerSeconds = 0;
+};
+
+// ==================== Harness ====================
+
+/**
+ * One port: line, DMA engine, interrupts and the polling consumer
+ */
+class DmaBench {
+ public:
+  DmaBench(const Scenario& scenario, uint32_t seed)
+      : line_(scenario.line), consumer_(scenario.consumer), boundedStamps_(scenario.boundedStamps), random_(seed) {
+    SimClock::reset(CYCLE_OFFSET, nullptr);
+    byteNs_ = 10ULL * 1000000000 / line_.baud;
+    channel_.reset(SimClock::cycles(), (uint32_t)(10ULL * SimClock::CYCLE_HZ / line_.baud));
+    ring_.reset();
+    burstLeft_ = startBurst();
+    nextEndNs_ = byteNs_;
+  }
+
+  Result run(uint64_t durationNs) {
+    uint64_t nextStallNs = consumer_.stallEveryMs ? consumer_.stallEveryMs * 1000000ULL : UINT64_MAX;
+    nextOverrunNs_ = consumer_.overrunEveryMs ? consumer_.overrunEveryMs * 1000000ULL : UINT64_MAX;
+    endNs_ = durationNs;
+    uint64_t now = 0;
+    while (now < durationNs && result_.error.empty()) {
+      now += between(consumer_.pollMinUs, consumer_.pollMaxUs) * 1000ULL;
+      if (now >= nextStallNs) {
+        now += consumer_.stallMs * 1000000ULL;
+        nextStallNs += consumer_.stallEveryMs * 1000000ULL;
+      }
+      poll(now);
+    }
+    // The line stops; the last poll picks up the rest
+    poll(durationNs + 1000000);
+
+    if (result_.error.empty() && expectIndex_ != sent_.size()) {
+      result_.error = std::to_string(sent_.size() - expectIndex_) + " characters never delivered";
+    }
+    if (result_.error.empty() && channel_.stats.bytesDropped != ring_.lost()) {
+      result_.error = "bytesDropped " + std::to_string(channel_.stats.bytesDropped) + " != lost " +
+                      std::to_string(ring_.lost());
+    }
+    if (result_.error.empty() && channel_.stats.bytesReceived != sent_.size()) {
+      result_.error = "bytesReceived " + std::to_string(channel_.stats.bytesReceived) + " != sent " +
+                      std::to_string(sent_.size());
+    }
+    result_.words = sent_.size();
+    result_.lost = ring_.lost();
+    result_.marksDropped = ring_.marksDropped();
+    return result_;
+  }
+
+ private:
+  struct Sent {
+    uint64_t endNs;               // Stop bit end
+    uint16_t word;
+  };
+
+  uint32_t between(uint32_t low, uint32_t high) {
+    return low + (uint32_t)(random_() % (high - low + 1));
+  }
+
+  uint32_t startBurst() { return line_.burstMax ? between(line_.burstMin, line_.burstMax) : UINT32_MAX; }
+
+  /**
+   * Run the line, the DMA engine and the interrupts up to a time
+   */
+  void advanceTo(uint64_t untilNs) {
+    for (;;) {
+      uint64_t writeNs = nextEndNs_ <= endNs_ ? nextEndNs_ + DMA_NS : UINT64_MAX;
+      uint64_t lapNs = laps_.empty() ? UINT64_MAX : laps_.front();
+      uint64_t at = std::min(std::min(writeNs, lapNs), std::min(idleNs_, nextOverrunNs_));
+      if (at > untilNs) break;
+      SimClock::advance(at - SimClock::nowNs());
+
+      if (at == lapNs) {
+        laps_.pop_front();
+        ring_.lapCompleted();
+      } else if (at == idleNs_) {
+        idleNs_ = UINT64_MAX;
+        ring_.markIdle(position_, SimClock::cycles());
+      } else if (at == nextOverrunNs_) {
+        // The interrupt's part: count it, report it to the consumer
+        ring_.markOverrun();
+        channel_.uart.overruns++;
+        overrunPending_ = true;
+        nextOverrunNs_ += consumer_.overrunEveryMs * 1000000ULL;
+      } else {
+        write();
+      }
+    }
+    SimClock::advance(untilNs - SimClock::nowNs());
+  }
+
+  void write() {
+    uint32_t index = (uint32_t)sent_.size();
+    uint16_t word = (uint8_t)(index * 131 + (index >> 8));
+    if (line_.errorEvery && random_() % line_.errorEvery == 0) word |= (random_() & 1) ? FRAMING_BIT : PARITY_BIT;
+    sent_.push_back({nextEndNs_, word});
+
+    ring_.buffer()[position_] = word;
+    position_ = (position_ + 1) & (DMA_WORDS - 1);
+    if (position_ == 0) laps_.push_back(SimClock::nowNs() + consumer_.lapIsrNs);
+
+    uint64_t endNs = nextEndNs_;
+    if (--burstLeft_ > 0) {
+      nextEndNs_ = endNs + byteNs_;
+      if (nextEndNs_ > endNs_ && consumer_.idleInterrupt) idleNs_ = endNs + IDLE_CHARACTERS * byteNs_ + ISR_NS;
+      return;
+    }
+    uint32_t gap = between(line_.gapMin, line_.gapMax);
+    nextEndNs_ = endNs + (gap + 1) * byteNs_;
+    burstLeft_ = startBurst();
+    if (consumer_.idleInterrupt && gap >= IDLE_CHARACTERS) idleNs_ = endNs + IDLE_CHARACTERS * byteNs_ + ISR_NS;
+  }
+
+  /**
+   * The capture task's visit: drain, then check what reached the channel
+   */
+  void poll(uint64_t atNs) {
+    advanceTo(atNs);
+    uint32_t lostBefore = ring_.lost();
+    auto start = std::chrono::steady_clock::now();
+    drainDmaRing<SimClock>(ring_, channel_, FORMAT, IDLE_CHARACTERS, [this]() { return position_; });
+    result_.consumerSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t skipped = ring_.lost() - lostBefore;
+    if (skipped > 0) {
+      expectIndex_ += skipped;
+      overflowExpected_ = true;
+    }
+    if (overrunPending_) {
+      overrunPending_ = false;
+      overflowExpected_ = true;
+    }
+
+    const RxSample* sample;
+    while (result_.error.empty() && channel_.ring.readSpan(sample) > 0) {
+      check(*sample);
+      channel_.ring.consumeRead(1);
+    }
+  }
+
+  void check(const RxSample& sample) {
+    if (expectIndex_ >= sent_.size()) {
+      result_.error = "more characters delivered than sent";
+      return;
+    }
+    const Sent& sent = sent_[expectIndex_];
+    std::string where = "character " + std::to_string(expectIndex_) + ": ";
+    uint8_t flags = STATUS_OK;
+    if (sent.word & FRAMING_BIT) flags |= STATUS_FRAMING_ERROR;
+    if (sent.word & PARITY_BIT) flags |= STATUS_PARITY_ERROR;
+    if (overflowExpected_) flags |= STATUS_OVERFLOW;
+    if (sample.value != (uint8_t)sent.word) {
+      result_.error = where + "value " + std::to_string(sample.value) + ", sent " + std::to_string((uint8_t)sent.word);
+      return;
+    }
+    if (sample.status != flags) {
+      result_.error = where + "status " + std::to_string(sample.status) + ", expected " + std::to_string(flags);
+      return;
+    }
+    overflowExpected_ = false;
+
+    int64_t errorNs = (int64_t)(int32_t)(sample.cycles - SimClock::cyclesAt(sent.endNs)) * 1000 /
+                      (int64_t)(SimClock::CYCLE_HZ / 1000000);
+    if (errorNs > result_.maxErrorNs) result_.maxErrorNs = errorNs;
+    int64_t boundNs = (int64_t)(2 * byteNs_ + ISR_NS + DMA_NS);
+    if (errorNs < 0 || (boundedStamps_ && errorNs > boundNs)) {
+      result_.error = where + "stamp off by " + std::to_string(errorNs) + " ns (bound 0-" + std::to_string(boundNs) +
+                      ")";
+      return;
+    }
+    expectIndex_++;
+  }
+
+  LineModel line_;
+  ConsumerModel consumer_;
+  bool boundedStamps_;
+  std::mt19937 random_;
+  Ring ring_;
+  Channel channel_;
+  uint64_t byteNs_ = 0;
+  uint64_t endNs_ = 0;
+
+  // Line and DMA engine
+  uint64_t nextEndNs_ = 0;
+  uint32_t burstLeft_ = 0;
+  uint32_t position_ = 0;
+  std::deque<uint64_t> laps_;                 // Pending lap interrupts
+  uint64_t idleNs_ = UINT64_MAX;              // Pending idle interrupt
+  uint64_t nextOverrunNs_ = UINT64_MAX;
+  std::vector<Sent> sent_;
+
+  // Checker
+  size_t expectIndex_ = 0;
+  bool overflowExpected_ = false;
+  bool overrunPending_ = false;
+  Result result_;
+};
+
+// ==================== Scenarios ====================
+
+static Scenario makeScenario(const char* name, LineModel line, ConsumerModel consumer, bool expectLoss = false,
+                             bool boundedStamps = true, bool expectMarkDrops = false) {
+  return {name, line, consumer, expectLoss, boundedStamps, expectMarkDrops};
+}
+
+static std::vector<Scenario> scenarios() {
+  std::vector<Scenario> list;
+  LineModel continuous = {4000000};
+  LineModel bursts = {2000000, 1, 256, 2, 2000};
+  LineModel chatter = {2000000, 1, 8, 2, 20};
+  LineModel errors = {1000000, 1, 64, 2, 200, 50};
+
+  ConsumerModel steady = {5, 500};
+  ConsumerModel slow = {10, 3000};
+  ConsumerModel noIdle = slow;
+  noIdle.idleInterrupt = false;
+  ConsumerModel stall = {5, 200, 300, 25};
+  ConsumerModel shortStall = {10, 3000, 100, 30};
+  ConsumerModel lateLap = {1, 20};
+  lateLap.lapIsrNs = 40000;
+  ConsumerModel overruns = {5, 500};
+  overruns.overrunEveryMs = 100;
+
+  list.push_back(makeScenario("continuous 4 Mbaud", continuous, steady));
+  list.push_back(makeScenario("bursts 2 Mbaud", bursts, slow));
+  list.push_back(makeScenario("bursts 2 Mbaud no idle", bursts, noIdle, false, false));
+  list.push_back(makeScenario("short bursts 2 Mbaud", chatter, slow));
+  list.push_back(makeScenario("mark overflow", chatter, shortStall, false, false, true));
+  list.push_back(makeScenario("stall 25 ms at 4 Mbaud", continuous, stall, true));
+  list.push_back(makeScenario("late lap interrupt", continuous, lateLap));
+  list.push_back(makeScenario("errors and overruns", errors, overruns));
+  return list;
+}
+
+int main(int argc, char** argv) {
+  uint32_t seeds = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 10;
+  double seconds = (argc > 2) ? std::atof(argv[2]) : 1.0;
+  if (seeds == 0) seeds = 1;
+  if (seconds <= 0) seconds = 1.0;
+  uint64_t durationNs = (uint64_t)(seconds * 1e9);
+
+  std::printf("%u seeds per scenario, %.1f s each; %u-word ring (%u guard), idle interrupt after %u character\n\n",
+              seeds, seconds, DMA_WORDS, Ring::GUARD, IDLE_CHARACTERS);
+  std::printf("%-26s %7s %10s %9s %11s %9s  %s\n", "scenario", "passed", "words", "lost", "max_err_us",
+              "ns/word", "result");
+
+  bool allOk = true;
+  for (const Scenario& scenario : scenarios()) {
+    uint32_t passed = 0;
+    std::string firstError;
+    Result total;
+    for (uint32_t seed = 1; seed <= seeds; seed++) {
+      std::unique_ptr<DmaBench> bench(new DmaBench(scenario, seed * 7919));
+      Result result = bench->run(durationNs);
+      if (result.error.empty() && scenario.expectLoss != (result.lost > 0)) {
+        result.error = scenario.expectLoss ? "stalls lost nothing" : std::to_string(result.lost) + " words lost";
+      }
+      if (result.error.empty() && scenario.expectMarkDrops != (result.marksDropped > 0)) {
+        result.error = scenario.expectMarkDrops ? "the mark queue never overflowed"
+                                                : std::to_string(result.marksDropped) + " idle marks dropped";
+      }
+      if (result.error.empty()) {
+        passed++;
+      } else if (firstError.empty()) {
+        firstError = "seed " + std::to_string(seed * 7919) + ": " + result.error;
+      }
+      total.words += result.words;
+      total.lost += result.lost;
+      total.consumerSeconds += result.consumerSeconds;
+      if (result.maxErrorNs > total.maxErrorNs) total.maxErrorNs = result.maxErrorNs;
+    }
+    bool ok = passed == seeds;
+    double nsPerWord = total.words ? total.consumerSeconds * 1e9 / (double)(total.words - total.lost) : 0;
+    std::printf("%-26s %3u/%-3u %10llu %9llu %11.2f %9.1f  %s\n", scenario.name, passed, seeds,
+                (unsigned long long)total.words, (unsigned long long)total.lost, total.maxErrorNs / 1000.0,
+                nsPerWord, ok ? "ok" : firstError.c_str());
+    allOk &= ok;
+  }
+  return allOk ? 0 : 1;
+}
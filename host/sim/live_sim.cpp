@@ -0,0 +1,332 @@
+/*
+ * live_sim - Live stream simulation over a pseudo-terminal loopback
+ *
+ * Runs the firmware's CaptureEngine on the simulated HAL (as capture_sim
+ * does) with live streaming on: the engine's StreamPort writes into the
+ * master side of a pty, standing in for the USB serial link, and a
+ * receiver reads the slave side as ss_live reads /dev/ttyACM1. The link
+ * has a rate and a transmit backlog in simulated time, so a slow host
+ * makes the firmware drop batches.
+ *
+ * Scenarios:
+ *   - fast link: the received capture must equal the SD file record for
+ *     record;
+ *   - slow link: the batches the firmware dropped must be exactly the
+ *     gaps the receiver reports, and the received records must be the
+ *     SD records minus the dropped ones, in order;
+ *   - corrupted link (one byte flipped in every 50th batch): the receiver
+ *     must reject each corrupted batch by CRC, resync on the next one and
+ *     report it missing.
+ *
+ * By default the receiver is LiveReceiver on a thread; with --ss-live the
+ * given ss_live binary is run on the pty instead, checking the tool end
+ * to end. Exits non-zero if any scenario's output is wrong.
+ *
+ * Usage: live_sim [seconds] [out_dir] [--ss-live path]
+ *        defaults: 2 s, /tmp/live_sim
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CaptureEngine.h"
+#include "CaptureReader.h"
+#include "LiveReceiver.h"
+#include "SimHal.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t RING_SIZE = 16384;                 // About the firmware's fast + spill rings
+const uint32_t MAX_CHANNELS = 8;
+const uint32_t WRITER_BLOCKS = 8;                 // Matches SD_WRITER_BLOCKS
+const uint32_t CHANNELS = 2;
+const uint32_t BAUD = 2000000;
+const uint64_t LOOP_NS = 2000;                    // loop() overhead per pass
+const uint64_t CPU_NS_PER_RECORD = 150;           // Merge + encode on the Teensy
+const uint32_t USB_BACKLOG_BYTES = 8192;          // USB serial transmit buffers
+const uint64_t DRAIN_LIMIT_NS = 1000000000;       // Time allowed to send the rest after stop
+const uint32_t RECEIVER_WAIT_MS = 2000;           // Wall time for the receiver to reach END
+
+struct Scenario {
+  const char* name;
+  uint64_t bytesPerSecond;        // Host read rate
+  uint32_t corruptEvery;          // Flip a byte in every nth batch (0: never)
+  bool expectDrops;
+};
+
+const Scenario SCENARIOS[] = {
+  {"fast",    20000000, 0,  false},
+  {"slow",      400000, 0,  true},
+  {"corrupt", 20000000, 50, false},
+};
+
+typedef CaptureChannel<RING_SIZE> Channel;
+typedef SimHal<Channel> Hal;
+typedef CaptureEngine<Hal, Channel, MAX_CHANNELS, WRITER_BLOCKS> Engine;
+
+// ==================== Receiver ====================
+
+struct ReceiverResult {
+  LiveReceiverStats stats;
+  std::atomic<bool> ended{false};
+  bool malformed = false;
+  int exitCode = 0;               // ss_live only
+};
+
+// In-process receiver: the pty slave into a capture file, until END or hangup
+static void receive(int fd, const std::string& path, ReceiverResult& result) {
+  std::FILE* out = std::fopen(path.c_str(), "wb");
+  if (!out) return;
+  LiveReceiver receiver;
+  LiveCaptureWriter writer(out);
+  std::vector<uint8_t> chunk(1 << 16);
+  while (!result.ended) {
+    ssize_t got = read(fd, chunk.data(), chunk.size());
+    if (got <= 0) break;
+    receiver.feed(chunk.data(), (size_t)got, [&](const LiveBatch& batch) {
+      if (batch.header.type == LIVE_BATCH_END) result.ended = true;
+      result.malformed |= !writer.write(batch);
+    });
+  }
+  std::fclose(out);
+  result.stats = receiver.stats();
+}
+
+static bool openLoopback(int& master, int& slave, std::string& slavePath) {
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return false;
+  slavePath = ptsname(master);
+  slave = open(slavePath.c_str(), O_RDWR | O_NOCTTY);
+  if (slave < 0) return false;
+  struct termios tio;
+  if (tcgetattr(slave, &tio) != 0) return false;
+  cfmakeraw(&tio);
+  return tcsetattr(slave, TCSANOW, &tio) == 0;
+}
+
+// ==================== Run ====================
+
+static uint32_t engineErrors = 0;
+
+static void onEngineMessage(const char* message) {
+  if (std::strncmp(message, "ERROR", 5) == 0) {
+    std::fprintf(stderr, "%s\n", message);
+    engineErrors++;
+  }
+}
+
+static bool readCapture(const std::string& path, std::vector<CaptureEvent>& events, std::string& error) {
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    error = reader.error();
+    return false;
+  }
+  CaptureEvent event;
+  while (reader.next(event)) events.push_back(event);
+  return true;
+}
+
+static bool sameRecord(const CaptureEvent& a, const CaptureEvent& b) {
+  return a.ticks == b.ticks && a.kind == b.kind && a.channel == b.channel && a.value == b.value &&
+         a.status == b.status && a.argument == b.argument;
+}
+
+static std::string runScenario(const Scenario& scenario, uint32_t seconds, const std::string& dir,
+                               const std::string& ssLive) {
+  std::string command = "rm -f '" + dir + "'/capture_*.ssb '" + dir + "'/capture_*.ssi '" + dir + "'/capture.idx '" + dir + "'/live.ssb";
+  if (std::system(command.c_str()) != 0) return "cannot clear " + dir;
+  std::string livePath = dir + "/live.ssb";
+  engineErrors = 0;
+
+  int master = -1;
+  int slave = -1;
+  std::string slavePath;
+  if (!openLoopback(master, slave, slavePath)) return "cannot open a pty";
+
+  // Receiver on the slave side
+  ReceiverResult received;
+  std::thread thread;
+  pid_t child = -1;
+  if (ssLive.empty()) {
+    thread = std::thread(receive, slave, livePath, std::ref(received));
+  } else {
+    child = fork();
+    if (child == 0) {
+      int devNull = open("/dev/null", O_WRONLY);
+      dup2(devNull, STDERR_FILENO);
+      execl(ssLive.c_str(), ssLive.c_str(), slavePath.c_str(), "-o", livePath.c_str(), (char*)nullptr);
+      _exit(127);
+    }
+  }
+
+  SimStorage storage(dir, SimCardModel());
+  SimStreamPort port(master, scenario.bytesPerSecond, USB_BACKLOG_BYTES);
+  port.setCorruptEvery(scenario.corruptEvery);
+  std::vector<Channel*> channels;
+  std::vector<SimSerialPort<Channel>*> ports;
+
+  SimClock::reset(0, [&](uint64_t untilNs) {
+    for (SimSerialPort<Channel>* line : ports) line->deliver(untilNs);
+  });
+
+  Engine* engine = new Engine();
+  CaptureEngineConfig config;
+  config.firmwareVersion = "sim";
+  engine->begin(&storage, config, onEngineMessage);
+  engine->setLivePort(&port);
+  for (uint32_t i = 0; i < CHANNELS; i++) {
+    Channel* channel = new Channel();
+    channel->id = (uint8_t)i;
+    channels.push_back(channel);
+    engine->addChannel(channel);
+    ports.push_back(new SimSerialPort<Channel>(channel, 1300ULL * i));
+  }
+
+  uint32_t origin = SimClock::cycles();
+  std::string error;
+  if (!engine->start(BAUD, origin)) error = "could not start";
+  std::string sdPath = dir + "/" + engine->filename();
+  uint32_t characterCycles = (uint32_t)((uint64_t)SimClock::CYCLE_HZ * 10 / BAUD);
+  for (uint32_t i = 0; i < CHANNELS; i++) {
+    channels[i]->reset(origin, characterCycles);
+    ports[i]->begin(BAUD);
+  }
+
+  uint64_t endNs = (uint64_t)seconds * 1000000000;
+  while (error.empty() && SimClock::nowNs() < endNs) {
+    uint32_t count = engine->service(true);
+    SimClock::advance(LOOP_NS + count * CPU_NS_PER_RECORD);
+  }
+  for (SimSerialPort<Channel>* line : ports) line->end();
+  engine->stop();
+
+  // loop() goes on sending what is queued after the capture
+  uint64_t drainUntil = SimClock::nowNs() + DRAIN_LIMIT_NS;
+  while (engine->liveQueued() > 0 && SimClock::nowNs() < drainUntil) {
+    engine->serviceLive();
+    SimClock::advance(LOOP_NS);
+  }
+  LiveStreamStats sent = engine->liveStats();
+  uint32_t leftQueued = engine->liveQueued();
+  bool endCorrupted = scenario.corruptEvery > 0 && port.writes() % scenario.corruptEvery == 0;
+
+  // Let the receiver read to END (a hangup may discard unread pty input),
+  // then hang up so it stops even without END
+  int status = -1;
+  for (uint32_t waitedMs = 0; waitedMs < RECEIVER_WAIT_MS; waitedMs++) {
+    if (child > 0 ? waitpid(child, &status, WNOHANG) == child : received.ended.load()) break;
+    usleep(1000);
+  }
+  close(master);
+  if (thread.joinable()) thread.join();
+  if (child > 0) {
+    if (status == -1) waitpid(child, &status, 0);
+    received.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  }
+  close(slave);
+
+  uint64_t dropped = 0;
+  for (Channel* channel : channels) dropped += channel->stats.bytesDropped;
+  delete engine;
+  for (SimSerialPort<Channel>* line : ports) delete line;
+  for (Channel* channel : channels) delete channel;
+
+  std::vector<CaptureEvent> sdRecords;
+  std::vector<CaptureEvent> liveRecords;
+  if (!error.empty()) return error;
+  if (engineErrors > 0) return "engine reported errors";
+  if (dropped > 0) return "capture dropped bytes";
+  if (leftQueued > 0) return "batches still queued after the drain time";
+  if (!readCapture(sdPath, sdRecords, error)) return "SD file: " + error;
+  if (!readCapture(livePath, liveRecords, error)) return "live file: " + error;
+
+  // Received capture: SD records minus the batches that never arrived
+  uint64_t expectedMissing = sent.batchesDropped + port.corrupted() - (endCorrupted ? 1 : 0);
+  if (ssLive.empty()) {
+    if (received.malformed) return "malformed batch payload";
+    if (received.stats.missingBatches != expectedMissing) {
+      return "receiver missed " + std::to_string(received.stats.missingBatches) + " batches, expected " +
+             std::to_string(expectedMissing);
+    }
+    if (!received.ended && !endCorrupted) return "no END received";
+    if (scenario.corruptEvery > 0 && received.stats.crcErrors == 0) return "no CRC errors seen";
+  } else if (received.exitCode != (expectedMissing > 0 ? 3 : 0)) {
+    return "ss_live exited with " + std::to_string(received.exitCode);
+  }
+  if (scenario.expectDrops != (sent.batchesDropped > 0)) {
+    return scenario.expectDrops ? "link never fell behind" : "firmware dropped batches";
+  }
+
+  size_t at = 0;
+  for (const CaptureEvent& record : liveRecords) {
+    while (at < sdRecords.size() && !sameRecord(sdRecords[at], record)) at++;
+    if (at == sdRecords.size()) return "live record not in the SD file, or out of order";
+    at++;
+  }
+  uint64_t lost = sdRecords.size() - liveRecords.size();
+  if (scenario.corruptEvery == 0 && lost != sent.recordsDropped) {
+    return std::to_string(lost) + " records lost, firmware dropped " + std::to_string(sent.recordsDropped);
+  }
+
+  std::printf("%-8s %10.2f %10llu %10llu %8u %8llu %8llu %8llu %6u  ok\n", scenario.name,
+              scenario.bytesPerSecond / 1e6, (unsigned long long)sdRecords.size(),
+              (unsigned long long)liveRecords.size(), sent.batchesSent,
+              (unsigned long long)sent.batchesDropped, (unsigned long long)port.corrupted(),
+              (unsigned long long)received.stats.crcErrors, sent.queuePeak);
+  return "";
+}
+
+int main(int argc, char** argv) {
+  uint32_t seconds = 2;
+  std::string dir = "/tmp/live_sim";
+  std::string ssLive;
+  int positional = 0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--ss-live") == 0 && i + 1 < argc) {
+      ssLive = argv[++i];
+    } else if (positional == 0) {
+      seconds = std::strtoul(argv[i], nullptr, 10);
+      positional++;
+    } else if (positional == 1) {
+      dir = argv[i];
+      positional++;
+    } else {
+      seconds = 0;
+    }
+  }
+  if (seconds == 0) {
+    std::fprintf(stderr, "Usage: live_sim [seconds] [out_dir] [--ss-live path]\n");
+    return 2;
+  }
+  mkdir(dir.c_str(), 0755);
+
+  std::printf("%u channels at %u baud, %u s per scenario, %u B batches x %u queued, receiver: %s\n\n",
+              CHANNELS, BAUD, seconds, Engine::LIVE_BATCH_BYTES, Engine::LIVE_BATCHES,
+              ssLive.empty() ? "LiveReceiver" : ssLive.c_str());
+  std::printf("%-8s %10s %10s %10s %8s %8s %8s %8s %6s\n", "link", "MB/s", "sd_recs", "live_recs",
+              "sent", "dropped", "corrupt", "crc_err", "q_peak");
+
+  bool allOk = true;
+  for (const Scenario& scenario : SCENARIOS) {
+    std::string error = runScenario(scenario, seconds, dir, ssLive);
+    if (!error.empty()) {
+      std::printf("%-8s FAILED: %s\n", scenario.name, error.c_str());
+      allOk = false;
+    }
+  }
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,502 @@
+/*
+ * scheduler_sim - Main loop scheduling simulation
+ *
+ * Runs the firmware's main loop work on the simulated HAL in SimHal.h
+ * two ways and compares them:
+ *
+ *   legacy     The old loop(): a command, then one CaptureEngine::service()
+ *              pass, then the LED, every pass; a status report is printed
+ *              straight to the USB port, waiting whenever its buffer is full
+ *   scheduler  TaskScheduler with the firmware's task table (capture
+ *              drain, SD writer, live stream, commands, baud detector,
+ *              status output, LED); reports are rendered into a buffer
+ *              and sent by the status task as the port takes them, and
+ *              the loop sleeps after idle passes as loop() does
+ *
+ * Two saturated UARTs feed the engine at 2 Mbaud; the card stalls for
+ * STALL_MS every second, and a status report of REPORT_BYTES is requested
+ * every second over a USB link the host drains at USB_BYTES_PER_SECOND.
+ * The simulation idles for IDLE_MS before the capture starts and after
+ * it stops. Each run reports drops, ring wait (p99 and worst, from the
+ * QUEUE stage histogram) and the longest gap between capture drains.
+ * The scheduler run also prints each task's runs, average and longest
+ * run time, budget overruns and missed deadlines.
+ *
+ * Exits non-zero if either run loses or misorders logged bytes or status
+ * text, if the scheduler run drops a byte, runs a task without a capture
+ * drain right before it, sleeps too little while idle, waits longer in
+ * the rings than the legacy loop, misses more capture deadlines than the
+ * card stalled, or gives different statistics when repeated (the
+ * simulation is deterministic).
+ *
+ * Usage: scheduler_sim [seconds] [out_dir]
+ *        defaults: 5 s, /tmp/scheduler_sim
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CaptureEngine.h"
+#include "CaptureReader.h"
+#include "SimHal.h"
+#include "TaskScheduler.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t CHANNELS = 2;
+const uint32_t BAUD = 2000000;
+const uint32_t RING_SIZE = 4096;                  // Matches CHANNEL_RING_SIZE
+const uint32_t SPILL_SIZE = 16384;                // Matches CHANNEL_SPILL_SIZE
+const uint32_t WRITER_BLOCKS = 8;                 // Matches SD_WRITER_BLOCKS
+const uint32_t STALL_MS = 10;
+const uint32_t STALL_EVERY_MS = 1000;
+const uint32_t REPORT_BYTES = 4096;               // One 'j' report, roughly
+const uint32_t REPORT_EVERY_MS = 1000;
+const uint64_t USB_BYTES_PER_SECOND = 100000;     // A busy host terminal
+const uint32_t USB_BUFFER_BYTES = 512;            // Teensy USB serial transmit buffers
+const uint32_t IDLE_MS = 500;
+const uint32_t IDLE_SLEEP_US = 10000;             // As the firmware
+const uint32_t CAPTURE_IDLE_SLEEP_US = 500;
+const uint32_t CYCLE_OFFSET = 0xFFF00000;
+
+// Simulated Teensy CPU time of each piece of work
+const uint64_t LOOP_NS = 2000;                    // legacy loop() overhead per pass
+const uint64_t TASK_NS = 300;                     // A task that finds nothing to do
+const uint64_t CPU_NS_PER_RECORD = 150;           // Merge + encode
+const uint64_t RENDER_NS = 50000;                 // Rendering a report into the buffer
+const uint64_t SPIN_NS = 10000;                   // Print() polling a full USB buffer
+
+typedef CaptureChannel<RING_SIZE, SPILL_SIZE> Channel;
+typedef SimHal<Channel> Hal;
+typedef CaptureEngine<Hal, Channel, CHANNELS, WRITER_BLOCKS> Engine;
+
+// ==================== Simulated Firmware ====================
+
+/**
+ * Globals of the simulated firmware (task bodies are plain functions, as
+ * in SerialSniffer.ino)
+ */
+struct Firmware {
+  Engine* engine = nullptr;
+  SimStreamPort* usb = nullptr;
+  bool capturing = false;
+  uint64_t nextReportNs = 0;
+  std::string statusText;         // Rendered, not yet sent
+  std::string reports;            // Everything rendered, in order
+  uint64_t reportsRendered = 0;
+  uint64_t maxDrainGapNs = 0;     // Longest time between capture drains
+  uint64_t lastDrainNs = 0;
+  int32_t lastTask = -1;          // Task that ran last (scheduler run)
+  bool orderError = false;
+};
+
+static Firmware fw;
+
+static void charge(uint64_t ns) { SimClock::advance(ns); }
+
+// A command is waiting at each report time
+static bool commandArrived() { return SimClock::nowNs() >= fw.nextReportNs; }
+
+// 'j': the report into the status buffer
+static void renderReport() {
+  char line[64];
+  std::string report;
+  while (report.size() < REPORT_BYTES) {
+    std::snprintf(line, sizeof(line), "report %llu line %zu\n", (unsigned long long)fw.reportsRendered,
+                  report.size() / 32);
+    report += line;
+  }
+  fw.statusText += report;
+  fw.reports += report;
+  fw.reportsRendered++;
+  fw.nextReportNs += (uint64_t)REPORT_EVERY_MS * 1000000;
+  charge(RENDER_NS);
+}
+
+// Send what the USB port takes without waiting; true if any went out
+static bool sendStatus() {
+  int room = fw.usb->availableForWrite();
+  if (room <= 0 || fw.statusText.empty()) {
+    charge(TASK_NS);
+    return false;
+  }
+  size_t count = std::min(fw.statusText.size(), (size_t)room);
+  fw.usb->write((const uint8_t*)fw.statusText.data(), count);
+  fw.statusText.erase(0, count);
+  charge(TASK_NS + count * 2);
+  return true;
+}
+
+static void noteDrain() {
+  uint64_t now = SimClock::nowNs();
+  if (fw.capturing && fw.lastDrainNs > 0 && now - fw.lastDrainNs > fw.maxDrainGapNs) {
+    fw.maxDrainGapNs = now - fw.lastDrainNs;
+  }
+  fw.lastDrainNs = now;
+}
+
+// Every task but the first must follow a capture drain
+static void noteTask(int32_t index) {
+  if (index > 0 && fw.lastTask != 0) fw.orderError = true;
+  fw.lastTask = index;
+}
+
+// Task bodies, as in SerialSniffer.ino
+
+static bool captureTask() {
+  noteTask(0);
+  noteDrain();
+  if (!fw.capturing) {
+    charge(TASK_NS);
+    return false;
+  }
+  uint32_t count = fw.engine->drain(true);
+  charge(TASK_NS + count * CPU_NS_PER_RECORD);
+  return count > 0;
+}
+
+static bool storageTask() {
+  noteTask(1);
+  charge(TASK_NS);
+  if (!fw.capturing) return false;
+  return fw.engine->serviceStorage();
+}
+
+static bool liveTask() {
+  noteTask(2);
+  charge(TASK_NS);
+  return fw.engine->serviceLive();
+}
+
+static bool commandTask() {
+  noteTask(3);
+  charge(TASK_NS);
+  if (!fw.statusText.empty() || !commandArrived()) return false;
+  renderReport();
+  return true;
+}
+
+static bool baudTask() {
+  noteTask(4);
+  charge(TASK_NS);
+  return false;
+}
+
+static bool statusTask() {
+  noteTask(5);
+  return sendStatus();
+}
+
+static bool ledTask() {
+  noteTask(6);
+  charge(TASK_NS);
+  return false;
+}
+
+// The firmware's task table (SerialSniffer.ino)
+const SchedulerTask LOOP_TASKS[] = {
+  {"capture",  captureTask,       0,    500,    10000},
+  {"storage",  storageTask,       0,   2000,        0},
+  {"live",     liveTask,          0,    200,        0},
+  {"commands", commandTask,       0,   1000,        0},
+  {"baud",     baudTask,          0,    200,        0},
+  {"status",   statusTask,        0,    200,        0},
+  {"led",      ledTask,      500000,     50,   100000},
+};
+const uint32_t LOOP_TASK_COUNT = sizeof(LOOP_TASKS) / sizeof(LOOP_TASKS[0]);
+typedef TaskScheduler<SimClock, LOOP_TASK_COUNT> Scheduler;
+
+// ==================== Run ====================
+
+struct RunResult {
+  uint64_t received = 0;
+  uint64_t dropped = 0;
+  uint64_t logged = 0;            // DATA records read back
+  uint32_t fastPeak = 0;
+  uint32_t spillPeak = 0;
+  double waitP99Ms = 0;
+  double waitMaxMs = 0;
+  double drainGapMs = 0;
+  uint64_t cardStalls = 0;
+  uint64_t passes = 0;
+  uint64_t idlePasses = 0;
+  uint64_t idlePassesWhileIdle = 0;   // Passes before start and after stop
+  std::vector<SchedulerTaskStats> tasks;
+  std::string error;
+};
+
+static void clearDirectory(const std::string& dir) {
+  std::string command = "rm -f '" + dir + "'/capture_*.ssb '" + dir + "'/capture_*.ssi '" + dir + "'/capture.idx";
+  if (std::system(command.c_str()) != 0) std::fprintf(stderr, "scheduler_sim: could not clear %s\n", dir.c_str());
+}
+
+static void onEngineMessage(const char* message) {
+  if (std::strncmp(message, "ERROR", 5) == 0) std::fprintf(stderr, "%s\n", message);
+}
+
+static bool readFile(const std::string& path, std::string& data) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+  char buffer[65536];
+  size_t count;
+  data.clear();
+  while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, count);
+  std::fclose(file);
+  return true;
+}
+
+/**
+ * One simulated session: idle, capture, idle
+ * @param useScheduler TaskScheduler loop, else the legacy loop
+ */
+static RunResult simulate(bool useScheduler, uint32_t seconds, const std::string& dir) {
+  RunResult result;
+  clearDirectory(dir);
+  fw = Firmware();
+
+  SimCardModel card;
+  card.stallUs = STALL_MS * 1000;
+  card.stallEveryMs = STALL_EVERY_MS;
+  SimStorage storage(dir, card);
+
+  std::string usbPath = dir + "/status.txt";
+  int usbFd = open(usbPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  SimStreamPort usb(usbFd, USB_BYTES_PER_SECOND, USB_BUFFER_BYTES);
+  fw.usb = &usb;
+
+  std::vector<Channel*> channels;
+  std::vector<Channel::SpillRing*> spills;
+  std::vector<SimSerialPort<Channel>*> ports;
+  SimClock::reset(CYCLE_OFFSET, [&](uint64_t untilNs) {
+    for (SimSerialPort<Channel>* port : ports) port->deliver(untilNs);
+  });
+
+  Engine* engine = new Engine();
+  fw.engine = engine;
+  CaptureEngineConfig config;
+  config.preallocateBytes = 16ULL * 1024 * 1024;
+  config.firmwareVersion = "sim";
+  engine->begin(&storage, config, onEngineMessage);
+  for (uint32_t i = 0; i < CHANNELS; i++) {
+    Channel* channel = new Channel();
+    channel->id = (uint8_t)i;
+    Channel::SpillRing* spill = new Channel::SpillRing();
+    channel->ring.attachSpill(spill);
+    spills.push_back(spill);
+    channels.push_back(channel);
+    engine->addChannel(channel);
+    ports.push_back(new SimSerialPort<Channel>(channel, 1300ULL * i));
+  }
+
+  Scheduler* scheduler = new Scheduler();
+  for (const SchedulerTask& task : LOOP_TASKS) scheduler->add(task);
+  fw.nextReportNs = (uint64_t)IDLE_MS * 1000000 + 500000000;
+
+  // loop() until the given time
+  auto runUntil = [&](uint64_t endNs) {
+    while (SimClock::nowNs() < endNs) {
+      if (useScheduler) {
+        if (!scheduler->runPass()) {
+          uint32_t us = scheduler->idleMicros(fw.capturing ? CAPTURE_IDLE_SLEEP_US : IDLE_SLEEP_US);
+          SimClock::advance(std::max<uint64_t>((uint64_t)us * 1000, 1000));
+        }
+        continue;
+      }
+      // Legacy: print the whole report, then one service pass
+      if (commandArrived()) {
+        renderReport();
+        while (!fw.statusText.empty()) {
+          if (!sendStatus()) charge(SPIN_NS);
+        }
+      }
+      noteDrain();
+      uint32_t count = fw.capturing ? engine->service(true) : 0;
+      if (!fw.capturing) engine->serviceLive();
+      charge(LOOP_NS + count * CPU_NS_PER_RECORD);
+      if (!fw.capturing) SimClock::advance((uint64_t)IDLE_SLEEP_US * 1000);   // delay(10)
+    }
+  };
+
+  uint64_t idleNs = (uint64_t)IDLE_MS * 1000000;
+  runUntil(idleNs);
+  uint64_t idlePasses = scheduler->passes();
+
+  // As startCapture()
+  uint32_t origin = SimClock::cycles();
+  if (!engine->start(BAUD, origin)) {
+    result.error = "could not start";
+    return result;
+  }
+  std::string path = dir + "/" + engine->filename();
+  uint32_t characterCycles = (uint32_t)((uint64_t)SimClock::CYCLE_HZ * 10 / BAUD);
+  for (uint32_t i = 0; i < CHANNELS; i++) {
+    channels[i]->reset(origin, characterCycles);
+    ports[i]->begin(BAUD);
+  }
+  fw.capturing = true;
+  fw.lastDrainNs = 0;
+  runUntil(idleNs + (uint64_t)seconds * 1000000000);
+
+  // As stopCapture()
+  for (SimSerialPort<Channel>* port : ports) port->end();
+  fw.capturing = false;
+  engine->stop();
+  uint64_t passesBefore = scheduler->passes();
+  runUntil(SimClock::nowNs() + idleNs);
+  uint64_t idleAfter = scheduler->passes() - passesBefore;
+
+  // Let the last report out
+  while (!fw.statusText.empty()) {
+    sendStatus();
+    charge(SPIN_NS);
+  }
+  close(usbFd);
+
+  MetricsSnapshot metrics;
+  engine->metricsSnapshot(metrics);
+  const LatencyHistogram& queue = metrics.stages[STAGE_QUEUE];
+  result.waitP99Ms = queue.percentile(990) * 1000.0 / SimClock::CYCLE_HZ;
+  result.waitMaxMs = queue.max * 1000.0 / SimClock::CYCLE_HZ;
+  result.drainGapMs = fw.maxDrainGapNs / 1e6;
+  result.cardStalls = storage.stats().stalls;
+  result.passes = scheduler->passes();
+  result.idlePasses = scheduler->idlePasses();
+  result.idlePassesWhileIdle = idlePasses + idleAfter;
+  for (uint32_t i = 0; i < scheduler->taskCount(); i++) result.tasks.push_back(scheduler->stats(i));
+  for (Channel* channel : channels) {
+    result.received += channel->stats.bytesReceived;
+    result.dropped += channel->stats.bytesDropped;
+    result.fastPeak = std::max(result.fastPeak, channel->ring.fastPeak());
+    result.spillPeak = std::max(result.spillPeak, channel->ring.spillPeak());
+  }
+
+  delete scheduler;
+  delete engine;
+  for (SimSerialPort<Channel>* port : ports) delete port;
+  for (Channel* channel : channels) delete channel;
+  for (Channel::SpillRing* spill : spills) delete spill;
+
+  // Every accepted byte logged once, in time order; the host got every
+  // report byte in order
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    result.error = "cannot read " + path;
+    return result;
+  }
+  CaptureEvent event;
+  uint64_t lastNs = 0;
+  while (reader.next(event)) {
+    if (event.timestampNs < lastNs) {
+      result.error = "timestamps out of order";
+      return result;
+    }
+    lastNs = event.timestampNs;
+    if (event.kind == RECORD_KIND_DATA) result.logged++;
+  }
+  std::string sent;
+  if (result.logged != result.received - result.dropped) {
+    result.error = "logged " + std::to_string(result.logged) + " of " +
+                   std::to_string(result.received - result.dropped) + " accepted bytes";
+  } else if (!readFile(usbPath, sent) || sent != fw.reports) {
+    result.error = "status text lost or reordered";
+  } else if (fw.orderError && useScheduler) {
+    result.error = "a task ran without a capture drain before it";
+  }
+  return result;
+}
+
+static void printRun(const char* name, const RunResult& result) {
+  std::printf("%-10s %10llu %8llu %8.1f%% %9.1f%% %9.2f %9.2f %10.2f %9llu %6.1f%%  %s\n", name,
+              (unsigned long long)result.received, (unsigned long long)result.dropped,
+              100.0 * result.fastPeak / RING_SIZE, 100.0 * result.spillPeak / SPILL_SIZE, result.waitP99Ms,
+              result.waitMaxMs, result.drainGapMs, (unsigned long long)result.passes,
+              result.passes ? 100.0 * result.idlePasses / result.passes : 0.0,
+              result.error.empty() ? "ok" : result.error.c_str());
+}
+
+static bool sameStats(const RunResult& a, const RunResult& b) {
+  if (a.received != b.received || a.dropped != b.dropped || a.passes != b.passes ||
+      a.idlePasses != b.idlePasses || a.tasks.size() != b.tasks.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.tasks.size(); i++) {
+    const SchedulerTaskStats& x = a.tasks[i];
+    const SchedulerTaskStats& y = b.tasks[i];
+    if (x.runs != y.runs || x.busyRuns != y.busyRuns || x.totalTicks != y.totalTicks || x.maxTicks != y.maxTicks ||
+        x.overruns != y.overruns || x.deadlineMisses != y.deadlineMisses || x.maxWaitTicks != y.maxWaitTicks) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t seconds = argc > 1 ? (uint32_t)std::atoi(argv[1]) : 5;
+  std::string dir = argc > 2 ? argv[2] : "/tmp/scheduler_sim";
+  if (seconds == 0) {
+    std::fprintf(stderr, "Usage: scheduler_sim [seconds] [out_dir]\n");
+    return 2;
+  }
+  mkdir(dir.c_str(), 0755);
+
+  std::printf("%u channels at %u baud for %u s, %u ms card stall every %u ms, %u-byte status report every %u ms"
+              " at %llu B/s\n\n", CHANNELS, BAUD, seconds, STALL_MS, STALL_EVERY_MS, REPORT_BYTES, REPORT_EVERY_MS,
+              (unsigned long long)USB_BYTES_PER_SECOND);
+  std::printf("%-10s %10s %8s %9s %10s %9s %9s %10s %9s %7s  %s\n", "loop", "bytes", "dropped", "fast_peak",
+              "spill_peak", "wait_p99", "wait_max", "drain_gap", "passes", "idle", "log");
+
+  RunResult legacy = simulate(false, seconds, dir);
+  printRun("legacy", legacy);
+  RunResult scheduled = simulate(true, seconds, dir);
+  printRun("scheduler", scheduled);
+  RunResult repeat = simulate(true, seconds, dir);
+
+  const double cycleUs = SimClock::CYCLE_HZ / 1e6;
+  std::printf("\n%-10s %9s %9s %10s %10s %9s %9s %10s\n", "task", "runs", "busy", "avg_us", "max_us", "overruns",
+              "missed", "max_wait");
+  for (uint32_t i = 0; i < scheduled.tasks.size(); i++) {
+    const SchedulerTaskStats& stats = scheduled.tasks[i];
+    std::printf("%-10s %9u %9u %10.2f %10.1f %9u %9u %8.1fms\n", LOOP_TASKS[i].name, stats.runs, stats.busyRuns,
+                stats.runs ? stats.totalTicks / cycleUs / stats.runs : 0.0, stats.maxTicks / cycleUs, stats.overruns,
+                stats.deadlineMisses, stats.maxWaitTicks / cycleUs / 1000);
+  }
+  std::printf("\ncard stalls %llu, idle passes outside the capture %llu\n",
+              (unsigned long long)scheduled.cardStalls, (unsigned long long)scheduled.idlePassesWhileIdle);
+
+  bool ok = legacy.error.empty() && scheduled.error.empty() && repeat.error.empty();
+  // Before and after the capture the loop sleeps up to IDLE_SLEEP_US per pass
+  uint64_t idleLimit = 2ULL * IDLE_MS * 1000 / IDLE_SLEEP_US * 2 + 10;
+  if (scheduled.dropped > 0) {
+    std::printf("FAIL: the scheduler run dropped bytes\n");
+    ok = false;
+  }
+  if (scheduled.idlePassesWhileIdle > idleLimit) {
+    std::printf("FAIL: %llu loop passes while idle (sleeps too little)\n",
+                (unsigned long long)scheduled.idlePassesWhileIdle);
+    ok = false;
+  }
+  if (scheduled.waitMaxMs >= legacy.waitMaxMs) {
+    std::printf("FAIL: bytes wait longer in the rings than with the legacy loop\n");
+    ok = false;
+  }
+  if (scheduled.tasks[0].deadlineMisses > scheduled.cardStalls) {
+    std::printf("FAIL: %u capture deadlines missed with %llu card stalls\n", scheduled.tasks[0].deadlineMisses,
+                (unsigned long long)scheduled.cardStalls);
+    ok = false;
+  }
+  if (!sameStats(scheduled, repeat)) {
+    std::printf("FAIL: the repeated scheduler run differs\n");
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,671 @@
+/*
+ * soak_sim - Synthetic traffic soak benchmark (NFR-001, NFR-002)
+ *
+ * Runs the firmware's main loop (TaskScheduler with the task table of
+ * SerialSniffer.ino) on the simulated HAL in SimHal.h, logging to the
+ * simulated card and streaming live to a simulated USB host, while a
+ * load generator drives the capture lines with one traffic profile at a
+ * time:
+ *
+ *   sustained    Both lines saturated at 115200 baud (NFR-001's rate)
+ *   full-rate    Both lines saturated at 2 Mbaud
+ *   polling      A master polls every 10 ms at 115200 baud; the slave
+ *                answers after a 1-3 ms turnaround with 16-256 bytes
+ *   bursty       Bursts of up to 4 KB at 1 Mbaud between 5-50 ms gaps,
+ *                independently on both lines
+ *   multi        Four lines at 921600 baud, 64-1024 byte bursts between
+ *                gaps of up to 2 ms
+ *   sd-stall     Sustained 115200 traffic while the card stalls for
+ *                250 ms every 2 s
+ *   stall-2M     Full rate while the card stalls for 10 ms every second
+ *   boot         Both lines saturated at 115200 8E1 from power-up, as
+ *                setup() does with auto-capture: the ports start 500 ms
+ *                before the engine (a slow SD card initialization) and
+ *                the rings hold what arrives meanwhile
+ *   replay       With --replay: the DATA records of a capture file, with
+ *                their channels, values and spacing, at its baud rate
+ *
+ * Every run is verified byte for byte: the SD log must hold exactly the
+ * characters the lines delivered into the channel rings, with their
+ * stamps and in time order, and every record of the live stream (decoded
+ * by LiveReceiver, as ss_live does) must be one of them. Loss counts the
+ * characters sent on the wire that are not in the log. Latency is the
+ * forwarding delay of every live record: from the end of its stop bit to
+ * the moment the host has taken its batch off the USB link. Each run also
+ * reports the high-water marks of the channel rings (fast RAM and spill),
+ * of the card writer's blocks and of the live batch queue.
+ *
+ * With --json, every run is also written as one JSON object per line
+ * (profile, limits, counts, latency percentiles in microseconds, peaks,
+ * pass/fail) for regression tracking.
+ *
+ * Exits non-zero if any run's log differs from what was accepted, a live
+ * record does not match, loss exceeds 0.1% (NFR-001), or the maximum
+ * forwarding latency exceeds 10 ms (NFR-002) - plus the stall itself in
+ * the stall profiles, where the loop waits on the card, and in the boot
+ * profile the wait from the ports' start until the engine has its file
+ * open.
+ *
+ * Usage: soak_sim [seconds] [out_dir] [--json file] [--replay capture.ssb]
+ *        defaults: 10 s per profile, /tmp/soak_sim
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CaptureEngine.h"
+#include "CaptureReader.h"
+#include "LiveReceiver.h"
+#include "SimHal.h"
+#include "TaskScheduler.h"
+
+// ==================== Model Parameters ====================
+
+const uint32_t MAX_CHANNELS = 8;
+const uint32_t RING_SIZE = 4096;                  // Matches CHANNEL_RING_SIZE
+const uint32_t SPILL_SIZE = 16384;                // Matches CHANNEL_SPILL_SIZE
+const uint32_t WRITER_BLOCKS = 8;                 // Matches SD_WRITER_BLOCKS
+const uint64_t USB_BYTES_PER_SECOND = 4000000;    // Host reading the live port
+const uint32_t USB_BUFFER_BYTES = 8192;           // USB serial transmit buffers
+const uint32_t IDLE_MS = 500;                     // After the capture stops
+const uint32_t IDLE_SLEEP_US = 10000;             // As the firmware
+const uint32_t CAPTURE_IDLE_SLEEP_US = 500;
+const uint32_t CYCLE_OFFSET = 0xFFF00000;
+const uint64_t TASK_NS = 300;                     // A task that finds nothing to do
+const uint64_t CPU_NS_PER_RECORD = 150;           // Merge + encode
+
+const double LOSS_LIMIT_PERCENT = 0.1;            // NFR-001
+const double LATENCY_LIMIT_MS = 10.0;             // NFR-002
+
+typedef CaptureChannel<RING_SIZE, SPILL_SIZE> Channel;
+typedef SimHal<Channel> Hal;
+typedef CaptureEngine<Hal, Channel, MAX_CHANNELS, WRITER_BLOCKS> Engine;
+
+// ==================== Traffic ====================
+
+/**
+ * What one line sends: the idle time before each character and its value
+ * (no gaps: saturated, for as long as the run lasts)
+ */
+struct LineScript {
+  std::vector<uint64_t> gapsNs;
+  std::vector<uint8_t> values;
+  bool saturated = true;
+};
+
+/**
+ * Builds a line's script burst by burst
+ */
+class ScriptBuilder {
+ public:
+  ScriptBuilder(LineScript& script, uint32_t baud, std::mt19937& random)
+      : script_(script), byteNs_(10ULL * 1000000000 / baud), random_(random) {
+    script_.saturated = false;
+  }
+
+  /**
+   * Queue a burst of random bytes starting no earlier than startNs (right
+   * after the previous one if that is still going)
+   */
+  void burst(uint64_t startNs, uint32_t bytes) {
+    for (uint32_t i = 0; i < bytes; i++) {
+      uint64_t gap = (i == 0 && startNs > endNs_) ? startNs - endNs_ : 0;
+      script_.gapsNs.push_back(gap);
+      script_.values.push_back((uint8_t)random_());
+      endNs_ += gap + byteNs_;
+    }
+  }
+
+  uint64_t endNs() const { return endNs_; }
+  uint64_t byteNs() const { return byteNs_; }
+
+ private:
+  LineScript& script_;
+  uint64_t byteNs_;
+  std::mt19937& random_;
+  uint64_t endNs_ = 0;
+};
+
+static uint32_t between(std::mt19937& random, uint32_t low, uint32_t high) {
+  return low + (uint32_t)(random() % (high - low + 1));
+}
+
+/**
+ * One soak run
+ */
+struct Profile {
+  std::string name;
+  uint32_t baud = 115200;
+  uint32_t stallMs = 0;
+  uint32_t stallEveryMs = 1000;
+  uint32_t bootMs = 0;            // Ports started this long before the engine
+  LineFormat format;
+  std::vector<LineScript> lines;
+};
+
+static Profile saturated(const char* name, uint32_t channels, uint32_t baud) {
+  Profile profile;
+  profile.name = name;
+  profile.baud = baud;
+  profile.lines.resize(channels);
+  return profile;
+}
+
+// Master (TX) polls, slave (RX) answers
+static Profile polling(uint32_t seconds, uint32_t seed) {
+  Profile profile;
+  profile.name = "polling";
+  profile.lines.resize(2);
+  std::mt19937 random(seed);
+  ScriptBuilder slave(profile.lines[CHANNEL_RX], profile.baud, random);
+  ScriptBuilder master(profile.lines[CHANNEL_TX], profile.baud, random);
+  for (uint64_t pollNs = 0; pollNs < (uint64_t)seconds * 1000000000; pollNs += 10000000) {
+    master.burst(pollNs, 8);
+    slave.burst(master.endNs() + between(random, 1000, 3000) * 1000ULL, between(random, 16, 256));
+  }
+  return profile;
+}
+
+static Profile bursts(const char* name, uint32_t channels, uint32_t baud, uint32_t minBytes, uint32_t maxBytes,
+                      uint32_t minGapUs, uint32_t maxGapUs, uint32_t seconds, uint32_t seed) {
+  Profile profile;
+  profile.name = name;
+  profile.baud = baud;
+  profile.lines.resize(channels);
+  std::mt19937 random(seed);
+  for (LineScript& line : profile.lines) {
+    ScriptBuilder builder(line, baud, random);
+    while (builder.endNs() < (uint64_t)seconds * 1000000000) {
+      builder.burst(builder.endNs() + between(random, minGapUs, maxGapUs) * 1000ULL,
+                    between(random, minBytes, maxBytes));
+    }
+  }
+  return profile;
+}
+
+static Profile stalled(const char* name, uint32_t baud, uint32_t stallMs, uint32_t everyMs) {
+  Profile profile = saturated(name, 2, baud);
+  profile.stallMs = stallMs;
+  profile.stallEveryMs = everyMs;
+  return profile;
+}
+
+static Profile boot(uint32_t bootMs) {
+  Profile profile = saturated("boot", 2, 115200);
+  profile.bootMs = bootMs;
+  profile.format.parity = PARITY_EVEN;
+  return profile;
+}
+
+/**
+ * The DATA records of a capture file, each character ending where the
+ * record's stamp says (or right after the previous one), counted from
+ * the start of the run as from the start of the capture
+ */
+static bool replay(const std::string& path, Profile& profile, std::string& error) {
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    error = reader.error();
+    return false;
+  }
+  profile.name = "replay";
+  profile.baud = reader.header().baudRate ? reader.header().baudRate : 115200;
+  uint64_t byteNs = 10ULL * 1000000000 / profile.baud;
+  std::vector<uint64_t> endNs;
+  CaptureEvent event;
+  while (reader.next(event)) {
+    if (event.kind != RECORD_KIND_DATA || event.channel >= MAX_CHANNELS) continue;
+    if (event.channel >= profile.lines.size()) {
+      profile.lines.resize(event.channel + 1);
+      endNs.resize(event.channel + 1, 0);
+    }
+    LineScript& line = profile.lines[event.channel];
+    uint64_t& end = endNs[event.channel];
+    uint64_t gap = event.timestampNs > end + byteNs ? event.timestampNs - end - byteNs : 0;
+    line.gapsNs.push_back(gap);
+    line.values.push_back(event.value);
+    end += gap + byteNs;
+  }
+  if (profile.lines.empty()) {
+    error = "no DATA records in " + path;
+    return false;
+  }
+  for (LineScript& line : profile.lines) line.saturated = false;   // Silent channels stay silent
+  return true;
+}
+
+// ==================== Simulated Firmware ====================
+
+struct Firmware {
+  Engine* engine = nullptr;
+  bool capturing = false;
+};
+
+static Firmware fw;
+
+static void charge(uint64_t ns) { SimClock::advance(ns); }
+
+// Task bodies, as in SerialSniffer.ino (nothing to do for the others)
+
+static bool captureTask() {
+  if (!fw.capturing) {
+    charge(TASK_NS);
+    return false;
+  }
+  uint32_t count = fw.engine->drain(true);
+  charge(TASK_NS + count * CPU_NS_PER_RECORD);
+  return count > 0;
+}
+
+static bool storageTask() {
+  charge(TASK_NS);
+  if (!fw.capturing) return false;
+  return fw.engine->serviceStorage();
+}
+
+static bool liveTask() {
+  charge(TASK_NS);
+  return fw.engine->serviceLive();
+}
+
+static bool idleTask() {
+  charge(TASK_NS);
+  return false;
+}
+
+// The firmware's task table (SerialSniffer.ino)
+const SchedulerTask LOOP_TASKS[] = {
+  {"capture",  captureTask,       0,    500,    10000},
+  {"storage",  storageTask,       0,   2000,        0},
+  {"live",     liveTask,          0,    200,        0},
+  {"commands", idleTask,          0,   1000,        0},
+  {"baud",     idleTask,          0,    200,        0},
+  {"status",   idleTask,          0,    200,        0},
+  {"led",      idleTask,     500000,     50,   100000},
+};
+const uint32_t LOOP_TASK_COUNT = sizeof(LOOP_TASKS) / sizeof(LOOP_TASKS[0]);
+typedef TaskScheduler<SimClock, LOOP_TASK_COUNT> Scheduler;
+
+// ==================== Run ====================
+
+struct Expected {
+  uint64_t ticks;
+  uint8_t value;
+  uint8_t status;
+};
+
+struct RunResult {
+  uint32_t channels = 0;
+  uint64_t sent = 0;              // Characters on the wire
+  uint64_t dropped = 0;           // Channel rings full
+  uint64_t logged = 0;            // DATA records in the log
+  uint64_t liveRecords = 0;
+  uint64_t liveDropped = 0;       // Records in live batches dropped at the queue
+  double lossPercent = 0;
+  double p50Ms = 0;
+  double p99Ms = 0;
+  double p999Ms = 0;
+  double maxMs = 0;
+  double latencyLimitMs = LATENCY_LIMIT_MS;
+  double bootWaitMs = 0;          // From the ports' start to the engine's (boot profile)
+  uint32_t fastPeak = 0;
+  uint32_t spillPeak = 0;
+  uint32_t writerPeak = 0;
+  uint32_t livePeak = 0;
+  uint64_t cardStalls = 0;
+  uint32_t deadlineMisses = 0;    // Capture task
+  std::string error;
+
+  bool passed() const {
+    return error.empty() && lossPercent <= LOSS_LIMIT_PERCENT && maxMs <= latencyLimitMs;
+  }
+};
+
+static void clearDirectory(const std::string& dir) {
+  std::string command = "rm -f '" + dir + "'/capture_*.ssb '" + dir + "'/capture_*.ssi '" + dir + "'/capture.idx";
+  if (std::system(command.c_str()) != 0) std::fprintf(stderr, "soak_sim: could not clear %s\n", dir.c_str());
+}
+
+static void onEngineMessage(const char* message) {
+  if (std::strncmp(message, "ERROR", 5) == 0) std::fprintf(stderr, "%s\n", message);
+}
+
+static double percentileMs(const std::vector<uint32_t>& sorted, uint32_t permille) {
+  if (sorted.empty()) return 0;
+  size_t index = ((uint64_t)sorted.size() * permille + 999) / 1000;
+  return sorted[index > 0 ? index - 1 : 0] / 1e6;
+}
+
+/**
+ * One profile: capture for the given time, stop, idle while the live
+ * stream empties, then read the log back
+ */
+static RunResult simulate(const Profile& profile, uint32_t seconds, const std::string& dir) {
+  RunResult result;
+  result.channels = (uint32_t)profile.lines.size();
+  clearDirectory(dir);
+  fw = Firmware();
+
+  SimCardModel card;
+  card.stallUs = profile.stallMs * 1000;
+  card.stallEveryMs = profile.stallEveryMs;
+  SimStorage storage(dir, card);
+
+  // The host end of the live stream, fed as the bytes come off the link
+  std::vector<std::vector<Expected>> expected(result.channels);
+  std::vector<size_t> liveNext(result.channels, 0);
+  std::vector<uint32_t> latencies;
+  uint64_t originNs = 0;
+  uint64_t originCycles = 0;
+  LiveReceiver receiver;
+  uint64_t hostNs = 0;
+  auto onBatch = [&](const LiveBatch& batch) {
+    if (batch.header.type != LIVE_BATCH_RECORDS || !result.error.empty()) return;
+    bool complete = forEachLiveRecord(batch, [&](const DeltaRecord& record, uint64_t ticks) {
+      if (record.kind != RECORD_KIND_DATA || !result.error.empty()) return;
+      if (record.channel >= result.channels) {
+        result.error = "live record on an unknown channel";
+        return;
+      }
+      // Batches may have been dropped: skip to the record's stamp
+      const std::vector<Expected>& line = expected[record.channel];
+      size_t& next = liveNext[record.channel];
+      while (next < line.size() && line[next].ticks < ticks) next++;
+      if (next == line.size() || line[next].ticks != ticks || line[next].value != record.value ||
+          line[next].status != record.status) {
+        result.error = "live record differs from the line on channel " + std::to_string(record.channel);
+        return;
+      }
+      next++;
+      uint64_t arrivalNs = (ticks + originCycles) * 1000 / (SimClock::CYCLE_HZ / 1000000);
+      latencies.push_back((uint32_t)std::min<uint64_t>(hostNs - arrivalNs, UINT32_MAX));
+      result.liveRecords++;
+    });
+    if (!complete) result.error = "malformed live batch";
+  };
+  SimStreamPort usb(-1, USB_BYTES_PER_SECOND, USB_BUFFER_BYTES);
+  usb.setWriteHook([&](const uint8_t* data, size_t length, uint64_t takenNs) {
+    hostNs = takenNs;
+    receiver.feed(data, length, onBatch);
+  });
+
+  std::vector<Channel*> channels;
+  std::vector<Channel::SpillRing*> spills;
+  std::vector<SimSerialPort<Channel>*> ports;
+  SimClock::reset(CYCLE_OFFSET, [&](uint64_t untilNs) {
+    for (SimSerialPort<Channel>* port : ports) port->deliver(untilNs);
+  });
+
+  Engine* engine = new Engine();
+  fw.engine = engine;
+  CaptureEngineConfig config;
+  config.preallocateBytes = 64ULL * 1024 * 1024;
+  config.firmwareVersion = "sim";
+  engine->begin(&storage, config, onEngineMessage);
+  engine->setLivePort(&usb);
+  for (uint32_t i = 0; i < result.channels; i++) {
+    Channel* channel = new Channel();
+    channel->id = (uint8_t)i;
+    Channel::SpillRing* spill = new Channel::SpillRing();
+    channel->ring.attachSpill(spill);
+    spills.push_back(spill);
+    channels.push_back(channel);
+    engine->addChannel(channel);
+
+    const LineScript& script = profile.lines[i];
+    SimSerialPort<Channel>* port = new SimSerialPort<Channel>(channel, 1300ULL * i);
+    port->setAcceptHook([&expected, &originCycles, i](uint64_t cycles, uint8_t value, uint8_t status) {
+      expected[i].push_back({cycles - originCycles, value, status});
+    });
+    if (!script.saturated) {
+      port->setGapHook([&script](uint32_t sequence) {
+        return sequence < script.gapsNs.size() ? script.gapsNs[sequence] : UINT64_MAX;
+      });
+      port->setValueHook([&script](uint32_t sequence) {
+        return sequence < script.values.size() ? script.values[sequence] : (uint8_t)0;
+      });
+    }
+    ports.push_back(port);
+  }
+
+  Scheduler* scheduler = new Scheduler();
+  for (const SchedulerTask& task : LOOP_TASKS) scheduler->add(task);
+
+  // loop() until the given time
+  auto runUntil = [&](uint64_t endNs) {
+    while (SimClock::nowNs() < endNs) {
+      if (!scheduler->runPass()) {
+        uint32_t us = scheduler->idleMicros(fw.capturing ? CAPTURE_IDLE_SLEEP_US : IDLE_SLEEP_US);
+        SimClock::advance(std::max<uint64_t>((uint64_t)us * 1000, 1000));
+      }
+    }
+  };
+
+  // As startCapture(); at boot as setup() with auto-capture: the ports
+  // first, the engine once the card is up
+  uint32_t origin = SimClock::cycles();
+  originNs = SimClock::nowNs();
+  originCycles = SimClock::cycles64(originNs);
+  engine->setLineFormat(profile.format);
+  if (profile.bootMs == 0 && !engine->start(profile.baud, origin)) {
+    result.error = "could not start";
+    return result;
+  }
+  uint32_t characterCycles =
+      (uint32_t)((uint64_t)SimClock::CYCLE_HZ * profile.format.characterBits() / profile.baud);
+  for (uint32_t i = 0; i < result.channels; i++) {
+    channels[i]->reset(origin, characterCycles);
+    ports[i]->begin(profile.baud, profile.format);
+  }
+  if (profile.bootMs > 0) {
+    SimClock::advance((uint64_t)profile.bootMs * 1000000);
+    if (!engine->start(profile.baud, origin)) {
+      result.error = "could not start";
+      return result;
+    }
+    result.bootWaitMs = (SimClock::nowNs() - originNs) / 1e6;
+  }
+  std::string path = dir + "/" + engine->filename();
+  fw.capturing = true;
+  runUntil(originNs + (uint64_t)seconds * 1000000000);
+
+  // As stopCapture(), then idle while the live stream empties
+  for (SimSerialPort<Channel>* port : ports) port->end();
+  fw.capturing = false;
+  engine->stop();
+  runUntil(SimClock::nowNs() + (uint64_t)IDLE_MS * 1000000);
+
+  for (uint32_t i = 0; i < result.channels; i++) {
+    result.sent += ports[i]->sent();
+    result.dropped += channels[i]->stats.bytesDropped;
+    result.fastPeak = std::max(result.fastPeak, channels[i]->ring.fastPeak());
+    result.spillPeak = std::max(result.spillPeak, channels[i]->ring.spillPeak());
+  }
+  result.writerPeak = engine->writerStats().peakBlocksQueued;
+  result.livePeak = engine->liveStats().queuePeak;
+  result.liveDropped = engine->liveStats().recordsDropped;
+  result.cardStalls = storage.stats().stalls;
+  result.deadlineMisses = scheduler->stats(0).deadlineMisses;
+  uint64_t firstTicks = UINT64_MAX;
+  for (const std::vector<Expected>& line : expected) {
+    if (!line.empty()) firstTicks = std::min(firstTicks, line[0].ticks);
+  }
+  if (engine->firstSampleTicks() != firstTicks) result.error = "first sample ticks differ from the first byte";
+
+  delete scheduler;
+  delete engine;
+  for (SimSerialPort<Channel>* port : ports) delete port;
+  for (Channel* channel : channels) delete channel;
+  for (Channel::SpillRing* spill : spills) delete spill;
+
+  std::sort(latencies.begin(), latencies.end());
+  result.p50Ms = percentileMs(latencies, 500);
+  result.p99Ms = percentileMs(latencies, 990);
+  result.p999Ms = percentileMs(latencies, 999);
+  result.maxMs = latencies.empty() ? 0 : latencies.back() / 1e6;
+  if (!result.error.empty()) return result;
+
+  // The log: every accepted character once, byte for byte, in time order
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    result.error = "cannot read " + path;
+    return result;
+  }
+  const CaptureFileHeader& header = reader.header();
+  if (header.dataBits != profile.format.dataBits || header.parity != profile.format.parity ||
+      header.stopBits != profile.format.stopBits) {
+    result.error = "line format differs in the header";
+    return result;
+  }
+  std::vector<size_t> logNext(result.channels, 0);
+  uint64_t lastTicks = 0;
+  CaptureEvent event;
+  while (reader.next(event)) {
+    if (event.ticks < lastTicks) {
+      result.error = "records out of time order";
+      return result;
+    }
+    lastTicks = event.ticks;
+    if (event.kind != RECORD_KIND_DATA) continue;
+    if (event.channel >= result.channels) {
+      result.error = "record on an unknown channel";
+      return result;
+    }
+    size_t& next = logNext[event.channel];
+    const std::vector<Expected>& line = expected[event.channel];
+    if (next == line.size()) {
+      result.error = "extra record on channel " + std::to_string(event.channel);
+      return result;
+    }
+    const Expected& want = line[next];
+    if (event.ticks != want.ticks || event.value != want.value || event.status != want.status) {
+      char text[128];
+      std::snprintf(text, sizeof(text), "ch%u record %zu: got 0x%02X @%llu st%u, expected 0x%02X @%llu st%u",
+                    event.channel, next, event.value, (unsigned long long)event.ticks, event.status, want.value,
+                    (unsigned long long)want.ticks, want.status);
+      result.error = text;
+      return result;
+    }
+    next++;
+    result.logged++;
+  }
+  for (uint32_t i = 0; i < result.channels; i++) {
+    if (logNext[i] != expected[i].size()) {
+      result.error = "records missing on channel " + std::to_string(i);
+      return result;
+    }
+  }
+  result.lossPercent = result.sent ? 100.0 * (result.sent - result.logged) / result.sent : 0;
+  return result;
+}
+
+// ==================== Report ====================
+
+static void printRun(const Profile& profile, const RunResult& result) {
+  std::printf("%-10s %2u %8u %10llu %8.3f%% %8llu %7.2f %7.2f %7.2f %7.2f %8.1f%% %8.1f%% %5u/%-2u %4u/%-2u  %s\n",
+              profile.name.c_str(), result.channels, profile.baud, (unsigned long long)result.sent,
+              result.lossPercent, (unsigned long long)result.liveDropped, result.p50Ms, result.p99Ms, result.p999Ms,
+              result.maxMs, 100.0 * result.fastPeak / RING_SIZE, 100.0 * result.spillPeak / SPILL_SIZE,
+              result.writerPeak, WRITER_BLOCKS, result.livePeak, Engine::LIVE_BATCHES,
+              !result.error.empty() ? result.error.c_str() : result.passed() ? "ok" : "FAIL");
+}
+
+static void writeJson(std::FILE* out, const Profile& profile, uint32_t seconds, const RunResult& result) {
+  std::fprintf(out,
+               "{\"profile\":\"%s\",\"channels\":%u,\"baud\":%u,\"seconds\":%u,\"stall_ms\":%u,\"boot_ms\":%u,\"boot_wait_ms\":%.1f,"
+               "\"sent\":%llu,\"dropped\":%llu,\"logged\":%llu,\"loss_percent\":%.6f,\"loss_limit_percent\":%.3f,"
+               "\"live_records\":%llu,\"live_dropped\":%llu,"
+               "\"latency_us\":{\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},\"latency_limit_us\":%.1f,"
+               "\"peaks\":{\"fast\":%u,\"fast_size\":%u,\"spill\":%u,\"spill_size\":%u,\"writer_blocks\":%u,"
+               "\"writer_size\":%u,\"live_batches\":%u,\"live_size\":%u},"
+               "\"card_stalls\":%llu,\"capture_deadline_misses\":%u,\"error\":\"%s\",\"pass\":%s}\n",
+               profile.name.c_str(), result.channels, profile.baud, seconds, profile.stallMs, profile.bootMs,
+               result.bootWaitMs, (unsigned long long)result.sent, (unsigned long long)result.dropped, (unsigned long long)result.logged,
+               result.lossPercent, LOSS_LIMIT_PERCENT, (unsigned long long)result.liveRecords,
+               (unsigned long long)result.liveDropped, result.p50Ms * 1000, result.p99Ms * 1000,
+               result.p999Ms * 1000, result.maxMs * 1000, result.latencyLimitMs * 1000, result.fastPeak, RING_SIZE,
+               result.spillPeak, SPILL_SIZE, result.writerPeak, WRITER_BLOCKS, result.livePeak, Engine::LIVE_BATCHES,
+               (unsigned long long)result.cardStalls, result.deadlineMisses, result.error.c_str(),
+               result.passed() ? "true" : "false");
+}
+
+int main(int argc, char** argv) {
+  uint32_t seconds = 10;
+  std::string dir = "/tmp/soak_sim";
+  std::string jsonPath;
+  std::string replayPath;
+  uint32_t positional = 0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      jsonPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = argv[++i];
+    } else if (argv[i][0] == '-' || positional == 2) {
+      seconds = 0;
+      break;
+    } else if (positional++ == 0) {
+      seconds = (uint32_t)std::atoi(argv[i]);
+    } else {
+      dir = argv[i];
+    }
+  }
+  if (seconds == 0) {
+    std::fprintf(stderr, "Usage: soak_sim [seconds] [out_dir] [--json file] [--replay capture.ssb]\n");
+    return 2;
+  }
+  mkdir(dir.c_str(), 0755);
+
+  std::vector<Profile> profiles;
+  profiles.push_back(saturated("sustained", 2, 115200));
+  profiles.push_back(saturated("full-rate", 2, 2000000));
+  profiles.push_back(polling(seconds, 1));
+  profiles.push_back(bursts("bursty", 2, 1000000, 1, 4096, 5000, 50000, seconds, 2));
+  profiles.push_back(bursts("multi", 4, 921600, 64, 1024, 0, 2000, seconds, 3));
+  profiles.push_back(stalled("sd-stall", 115200, 250, 2000));
+  profiles.push_back(stalled("stall-2M", 2000000, 10, 1000));
+  profiles.push_back(boot(500));
+  if (!replayPath.empty()) {
+    Profile profile;
+    std::string error;
+    if (!replay(replayPath, profile, error)) {
+      std::fprintf(stderr, "soak_sim: %s\n", error.c_str());
+      return 2;
+    }
+    profiles.push_back(profile);
+  }
+
+  std::FILE* json = nullptr;
+  if (!jsonPath.empty() && !(json = std::fopen(jsonPath.c_str(), "w"))) {
+    std::fprintf(stderr, "soak_sim: cannot create %s\n", jsonPath.c_str());
+    return 2;
+  }
+
+  std::printf("%u s per profile; limits: loss %.1f%% (NFR-001), latency %.0f ms (NFR-002, plus the card stall "
+              "or boot wait)\n",
+              seconds, LOSS_LIMIT_PERCENT, LATENCY_LIMIT_MS);
+  std::printf("live link %llu B/s; latency is stop bit to host, in ms\n\n", (unsigned long long)USB_BYTES_PER_SECOND);
+  std::printf("%-10s %2s %8s %10s %9s %8s %7s %7s %7s %7s %9s %9s %8s %7s  %s\n", "profile", "ch", "baud", "sent",
+              "loss", "live_drop", "p50", "p99", "p99.9", "max", "fast_peak", "spill_peak", "sd_blks", "live_q",
+              "result");
+
+  bool allOk = true;
+  for (const Profile& profile : profiles) {
+    RunResult result = simulate(profile, seconds, dir);
+    result.latencyLimitMs = LATENCY_LIMIT_MS + profile.stallMs + result.bootWaitMs;
+    printRun(profile, result);
+    if (json) writeJson(json, profile, seconds, result);
+    allOk &= result.passed();
+  }
+  if (json) std::fclose(json);
+  return allOk ? 0 : 1;
+}
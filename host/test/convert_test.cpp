@@ -0,0 +1,366 @@
+/*
+ * convert_test - Binary capture to CSV round trip (ss_convert path)
+ *
+ * Writes known records with the CaptureFormat encoders in every record
+ * format a capture can have:
+ *
+ *   fixed    version 1 CaptureRecords with millisecond timestamps
+ *   delta    varint delta records stamped in 600 MHz cycles
+ *   blocks   the same delta records in LZ4 CaptureBlocks (BlockCompressor)
+ *
+ * covering every value, every status flag combination, all eight channels,
+ * zero and multi-byte deltas, and event records between the data records.
+ * Each file is read back through CaptureReader and turned into CSV with
+ * writeCsvLine() and with the CsvExporter kernel ss_convert uses on this
+ * CPU; every line is parsed again and each field (timestamp in ns,
+ * direction, hex value, ASCII column, status flags) must equal the record
+ * that was written. The firmware's CSV log lines (formatCsvLine() in
+ * CaptureCsv.h) for the same records must be the same text. Event records
+ * must come back with their kind, time and argument.
+ *
+ * Usage: convert_test [directory]   (default: the current directory)
+ * Exits non-zero if any field differs.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "CaptureReader.h"
+#include "CsvFormat.h"
+#include "HexFormat.h"
+
+// ==================== Test Records ====================
+
+const uint32_t CPU_HZ = 600000000;
+const uint32_t RECORDS = 20000;
+const uint32_t BLOCK_BYTES = 4096;              // The firmware's block size
+
+struct Record {
+  uint64_t ticks;             // Ticks since capture start (ms for fixed records)
+  uint8_t kind;
+  uint8_t channel;
+  uint8_t value;
+  uint8_t status;
+  uint64_t argument;
+};
+
+/**
+ * Every value, status combination and channel; zero, small and large
+ * deltas; an event record now and then (delta formats only)
+ */
+static std::vector<Record> makeRecords(bool fixed, uint32_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<Record> records;
+  uint64_t ticks = 0;
+  for (uint32_t i = 0; i < RECORDS; i++) {
+    Record record;
+    uint32_t pick = (uint32_t)(rng() % 16);
+    uint64_t delta = pick == 0 ? 0 : pick == 1 ? rng() >> (24 + rng() % 40) : rng() % 20000;
+    if (fixed) delta %= 1000;                   // Keep within 32-bit milliseconds
+    ticks += delta;
+    record.ticks = ticks;
+    record.kind = RECORD_KIND_DATA;
+    record.channel = (uint8_t)(i % MAX_CAPTURE_CHANNELS);
+    record.value = (uint8_t)i;
+    record.status = (uint8_t)((i / 256) % 32);  // STATUS_OK and every flag combination
+    record.argument = 0;
+    if (!fixed && rng() % 50 == 0) {
+      record.kind = (uint8_t)(RECORD_KIND_BAUD_CHANGE + rng() % RECORD_KIND_METRIC);
+      record.value = (uint8_t)rng();
+      record.status = STATUS_OK;
+      record.argument = rng() >> (rng() % 64);
+    }
+    records.push_back(record);
+  }
+  return records;
+}
+
+static uint64_t expectedNs(const Record& record, bool fixed) {
+  if (fixed) return record.ticks * 1000000ULL;
+  return (uint64_t)((unsigned __int128)record.ticks * 1000000000ULL / CPU_HZ);
+}
+
+// ==================== Writing ====================
+
+struct FileWriter {
+  std::FILE* file;
+  uint32_t append(const void* data, uint32_t length) {
+    return (uint32_t)std::fwrite(data, 1, length, file);
+  }
+};
+
+static uint32_t encodeRecord(uint8_t* out, const Record& record, uint64_t previous) {
+  uint64_t delta = record.ticks - previous;
+  if (record.kind == RECORD_KIND_DATA) {
+    return encodeDeltaRecord(out, delta, record.kind, record.channel, record.value, record.status);
+  }
+  return encodeEventRecord(out, delta, record.kind, record.channel, record.value, record.status,
+                           record.argument);
+}
+
+static bool writeCapture(const std::string& path, RecordFormat format, const std::vector<Record>& records) {
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file) return false;
+
+  CaptureFileHeader header;
+  initCaptureHeader(header, 115200, 0, "convert_test", CPU_HZ);
+  header.recordFormat = format;
+  if (format == RECORD_FORMAT_FIXED) {
+    header.version = 1;
+    header.recordSize = sizeof(CaptureRecord);
+  }
+  std::fwrite(&header, sizeof(header), 1, file);
+
+  static BlockCompressor<BLOCK_BYTES> blocks;
+  blocks.reset();
+  FileWriter writer = {file};
+  uint64_t previous = 0;
+  for (const Record& record : records) {
+    if (format == RECORD_FORMAT_FIXED) {
+      CaptureRecord fixed = makeCaptureRecord((uint32_t)record.ticks, record.channel, record.value, record.status);
+      std::fwrite(&fixed, sizeof(fixed), 1, file);
+      continue;
+    }
+    uint8_t encoded[MAX_EVENT_RECORD_SIZE];
+    uint32_t length = encodeRecord(encoded, record, previous);
+    if (format == RECORD_FORMAT_BLOCKS) {
+      if (blocks.room() < length) {
+        blocks.seal(nullptr);
+        blocks.drain(writer);
+      }
+      blocks.append(encoded, length, previous, 0);
+    } else {
+      std::fwrite(encoded, 1, length, file);
+    }
+    previous = record.ticks;
+  }
+  if (format == RECORD_FORMAT_BLOCKS) {
+    blocks.seal(nullptr);
+    blocks.drain(writer);
+  }
+  return std::fclose(file) == 0;
+}
+
+// ==================== Reading Back ====================
+
+/**
+ * FILE* collecting into a string (open_memstream)
+ */
+class StringFile {
+ public:
+  StringFile() { file_ = open_memstream(&data_, &size_); }
+  ~StringFile() {
+    if (file_) std::fclose(file_);
+    std::free(data_);
+  }
+  std::FILE* file() { return file_; }
+  std::string text() {
+    std::fflush(file_);
+    return std::string(data_, size_);
+  }
+
+ private:
+  std::FILE* file_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+struct CsvRow {
+  uint64_t timestampNs;
+  uint8_t channel;
+  uint8_t value;
+  char ascii;
+  uint8_t status;
+};
+
+/**
+ * Status column back to flags
+ * @return false for an unknown flag name
+ */
+static bool parseStatus(const std::string& text, uint8_t& status) {
+  static const struct {
+    const char* name;
+    uint8_t flag;
+  } FLAGS[] = {
+    {"OVERFLOW", STATUS_OVERFLOW},
+    {"FRAMING_ERROR", STATUS_FRAMING_ERROR},
+    {"PARITY_ERROR", STATUS_PARITY_ERROR},
+    {"CHECKSUM_VALID", STATUS_CHECKSUM_VALID},
+    {"CHECKSUM_ERROR", STATUS_CHECKSUM_ERROR},
+  };
+  status = STATUS_OK;
+  if (text == "OK") return true;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find('|', start);
+    if (end == std::string::npos) end = text.size();
+    std::string name = text.substr(start, end - start);
+    bool known = false;
+    for (const auto& flag : FLAGS) {
+      if (name == flag.name) {
+        status |= flag.flag;
+        known = true;
+      }
+    }
+    if (!known) return false;
+    start = end + 1;
+  }
+  return true;
+}
+
+/**
+ * One Timestamp,Direction,Value_Hex,Value_ASCII,Status line (the ASCII
+ * column may itself be a comma)
+ */
+static bool parseCsvLine(const std::string& line, CsvRow& row) {
+  static const char* const DIRECTIONS[MAX_CAPTURE_CHANNELS] = {
+    "RX", "TX", "CH2", "CH3", "CH4", "CH5", "CH6", "CH7"
+  };
+  size_t timeEnd = line.find(',');
+  if (timeEnd == std::string::npos || timeEnd == 0) return false;
+  char* end;
+  row.timestampNs = std::strtoull(line.c_str(), &end, 10);
+  if (end != line.c_str() + timeEnd) return false;
+
+  size_t directionEnd = line.find(',', timeEnd + 1);
+  if (directionEnd == std::string::npos) return false;
+  std::string direction = line.substr(timeEnd + 1, directionEnd - timeEnd - 1);
+  row.channel = MAX_CAPTURE_CHANNELS;
+  for (uint8_t i = 0; i < MAX_CAPTURE_CHANNELS; i++) {
+    if (direction == DIRECTIONS[i]) row.channel = i;
+  }
+  if (row.channel == MAX_CAPTURE_CHANNELS) return false;
+
+  size_t hex = directionEnd + 1;
+  if (line.size() < hex + 8 || line.compare(hex, 2, "0x") != 0 || line[hex + 4] != ',') return false;
+  unsigned value;
+  if (std::sscanf(line.c_str() + hex + 2, "%2X", &value) != 1) return false;
+  if (line.compare(hex + 2, 2, std::string(1, HEX_UPPER[value >> 4]) + HEX_UPPER[value & 0x0F]) != 0) {
+    return false;                                   // Two uppercase digits
+  }
+  row.value = (uint8_t)value;
+  row.ascii = line[hex + 5];
+  if (line[hex + 6] != ',') return false;
+  return parseStatus(line.substr(hex + 7), row.status);
+}
+
+/**
+ * Check CSV text against the data records
+ */
+static bool checkCsv(const char* what, const std::string& text, const std::vector<Record>& records, bool fixed) {
+  size_t at = 0;
+  size_t lineNumber = 0;
+  for (const Record& record : records) {
+    if (record.kind != RECORD_KIND_DATA) continue;
+    lineNumber++;
+    size_t end = text.find('\n', at);
+    if (end == std::string::npos) {
+      std::printf("  %s: ends after %zu lines\n", what, lineNumber - 1);
+      return false;
+    }
+    std::string line = text.substr(at, end - at);
+    at = end + 1;
+
+    CsvRow row;
+    char ascii = (record.value >= 32 && record.value <= 126) ? (char)record.value : '.';
+    if (!parseCsvLine(line, row) || row.timestampNs != expectedNs(record, fixed) ||
+        row.channel != record.channel || row.value != record.value || row.ascii != ascii ||
+        row.status != record.status) {
+      std::printf("  %s: line %zu \"%s\" does not match ns %llu channel %u value 0x%02X status 0x%02X\n",
+                  what, lineNumber, line.c_str(), (unsigned long long)expectedNs(record, fixed),
+                  record.channel, record.value, record.status);
+      return false;
+    }
+  }
+  if (at != text.size()) {
+    std::printf("  %s: %zu bytes after the last record\n", what, text.size() - at);
+    return false;
+  }
+  return true;
+}
+
+static bool roundTrip(const char* name, RecordFormat format, const std::string& directory, uint32_t seed) {
+  bool fixed = format == RECORD_FORMAT_FIXED;
+  std::vector<Record> records = makeRecords(fixed, seed);
+  std::string path = directory + "/convert_test_" + name + ".ssb";
+  if (!writeCapture(path, format, records)) {
+    std::printf("%-7s cannot write %s\n", name, path.c_str());
+    return false;
+  }
+
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    std::printf("%-7s %s\n", name, reader.error().c_str());
+    return false;
+  }
+  bool ok = true;
+  uint32_t events = 0;
+  StringFile reference;
+  StringFile exported;
+  std::string firmware;
+  {
+    TextOutput output(exported.file());
+    CsvExporter csv(output, bestFormatKernel());
+    CaptureEvent event;
+    size_t index = 0;
+    while (reader.next(event)) {
+      if (index >= records.size()) {
+        std::printf("  %s: more records than written\n", name);
+        ok = false;
+        break;
+      }
+      const Record& record = records[index++];
+      if (event.kind != record.kind || event.timestampNs != expectedNs(record, fixed) ||
+          event.argument != record.argument) {
+        std::printf("  %s: record %zu read back as %s at %llu ns, argument %llu\n", name, index - 1,
+                    recordKindName(event.kind), (unsigned long long)event.timestampNs,
+                    (unsigned long long)event.argument);
+        ok = false;
+        break;
+      }
+      if (event.kind != RECORD_KIND_DATA) {
+        events++;
+        continue;
+      }
+      // As ss_convert writes it, and with the kernel it uses
+      writeCsvLine(reference.file(), event);
+      csv.add(event.timestampNs, event.channel, event.value, event.status);
+      // As the firmware's CSV log mode writes it
+      char line[MAX_CSV_LINE_SIZE];
+      firmware.append(line, formatCsvLine(line, event.timestampNs, event.channel, event.value, event.status));
+    }
+    csv.flush();
+    if (ok && index != records.size()) {
+      std::printf("  %s: read %zu of %zu records\n", name, index, records.size());
+      ok = false;
+    }
+  }
+  reader.close();
+  std::remove(path.c_str());
+
+  ok = ok && checkCsv("writeCsvLine", reference.text(), records, fixed);
+  ok = ok && checkCsv(formatKernelName(bestFormatKernel()), exported.text(), records, fixed);
+  if (ok && firmware != reference.text()) {
+    std::printf("  %s: firmware CSV log text differs from ss_convert\n", name);
+    ok = false;
+  }
+  std::printf("%-7s %zu records (%u events): %s\n", name, records.size(), events, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  std::string directory = argc > 1 ? argv[1] : ".";
+  bool ok = true;
+  ok &= roundTrip("fixed", RECORD_FORMAT_FIXED, directory, 1);
+  ok &= roundTrip("delta", RECORD_FORMAT_DELTA, directory, 2);
+  ok &= roundTrip("blocks", RECORD_FORMAT_BLOCKS, directory, 3);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+/*
+ * ss_convert - Convert a SerialSniffer binary capture to CSV or a hex dump
+ *
+ * Usage: ss_convert <capture.ssb> [-o output.csv] [--packets | --hexdump]
+ *                   [--channel NAME] [--start TIME] [--end TIME]
+ *                   [--kernel scalar|ssse3|avx2]
+ * Writes to stdout when no output file is given. Timestamps are expanded
+ * to absolute nanoseconds since capture start. With --packets, writes one
+ * line per packet framed by the firmware (PACKET_START/PACKET_END
+ * records) instead of one line per byte. With --hexdump, writes each
+ * channel's bytes as a classic 16-byte-per-row hex dump with an ASCII
+ * gutter, rows prefixed with the channel name; --channel (RX, TX, CH2...
+ * or a number) keeps one channel, and its dump is laid out exactly like
+ * hexdump -C -v of those bytes. Byte lines and dumps are formatted by the
+ * vectorized kernels of HexFormat.h (the fastest this CPU runs, or the
+ * one --kernel names). --start/--end (seconds, or
+ * H:MM:SS.fff, since capture start) convert only that window: the time
+ * index (.ssi sidecar, or one built on the spot) says where in the file
+ * to start and stop reading. Compressed captures are decompressed on the
+ * fly; a damaged block is reported and skipped.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <strings.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "CaptureReader.h"
+#include "CsvFormat.h"
+#include "HexFormat.h"
+#include "TimeIndex.h"
+
+static void printUsage(const char* program) {
+  std::fprintf(stderr,
+               "Usage: %s <capture.ssb> [-o output.csv] [--packets | --hexdump] [--channel NAME]\n"
+               "          [--start TIME] [--end TIME] [--kernel scalar|ssse3|avx2]\n",
+               program);
+}
+
+/**
+ * Channel id from its name (RX, TX, CH2...) or number
+ */
+static bool parseChannel(const char* text, int& channel) {
+  for (uint8_t i = 0; i < MAX_CAPTURE_CHANNELS; i++) {
+    if (strcasecmp(text, captureChannelName(i)) == 0) {
+      channel = i;
+      return true;
+    }
+  }
+  char* end;
+  long number = std::strtol(text, &end, 10);
+  if (*text == '\0' || *end != '\0' || number < 0 || number > 255) return false;
+  channel = (int)number;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  std::string inputPath;
+  std::string outputPath;
+  bool packets = false;
+  bool hexdump = false;
+  int channel = -1;
+  FormatKernel kernel = bestFormatKernel();
+  uint64_t startNs = 0;
+  uint64_t endNs = UINT64_MAX;
+
+  for (int i = 1; i < argc; i++) {
+    if ((std::strcmp(argv[i], "-o") == 0 || std::strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
+      outputPath = argv[++i];
+    } else if (std::strcmp(argv[i], "-p") == 0 || std::strcmp(argv[i], "--packets") == 0) {
+      packets = true;
+    } else if (std::strcmp(argv[i], "-x") == 0 || std::strcmp(argv[i], "--hexdump") == 0) {
+      hexdump = true;
+    } else if ((std::strcmp(argv[i], "-c") == 0 || std::strcmp(argv[i], "--channel") == 0) && i + 1 < argc) {
+      if (!parseChannel(argv[++i], channel)) {
+        std::fprintf(stderr, "ss_convert: unknown channel '%s'\n", argv[i]);
+        return 2;
+      }
+    } else if (std::strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+      if (!parseFormatKernel(argv[++i], kernel) || !formatKernelSupported(kernel)) {
+        std::fprintf(stderr, "ss_convert: kernel '%s' is unknown or not supported by this CPU\n", argv[i]);
+        return 2;
+      }
+    } else if ((std::strcmp(argv[i], "--start") == 0 || std::strcmp(argv[i], "--end") == 0) && i + 1 < argc) {
+      uint64_t& bound = (argv[i][2] == 's') ? startNs : endNs;
+      if (!parseElapsedNs(argv[++i], bound)) {
+        std::fprintf(stderr, "ss_convert: bad time '%s'\n", argv[i]);
+        return 2;
+      }
+    } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+      printUsage(argv[0]);
+      return 0;
+    } else if (inputPath.empty()) {
+      inputPath = argv[i];
+    } else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (inputPath.empty() || (packets && hexdump)) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  CaptureReader reader;
+  if (!reader.open(inputPath)) {
+    std::fprintf(stderr, "ss_convert: %s\n", reader.error().c_str());
+    return 1;
+  }
+  bool windowed = startNs > 0 || endNs < UINT64_MAX;
+  if (windowed) {
+    CaptureMap map;
+    TimeIndex index;
+    if (map.open(inputPath)) index.open(inputPath, map);
+    CaptureRange range = index.range(map, startNs, endNs);
+    reader.seek(range.begin, range.ticks);
+    std::fprintf(stderr, "ss_convert: reading bytes %zu-%zu of %zu (%s index, %zu entries)\n", range.begin,
+                 range.end, map.size(), index.source() == TimeIndex::SOURCE_SIDECAR ? "sidecar" : "rebuilt",
+                 index.size());
+  }
+
+  std::FILE* out = stdout;
+  if (!outputPath.empty()) {
+    out = std::fopen(outputPath.c_str(), "w");
+    if (!out) {
+      std::fprintf(stderr, "ss_convert: cannot create %s\n", outputPath.c_str());
+      return 1;
+    }
+  }
+
+  TextOutput output(out);
+  CsvExporter csv(output, kernel);
+  HexDumper dump(output, channel < 0, kernel);
+  if (packets) {
+    std::fprintf(out, "%s%s", PACKET_CSV_HEADER, CSV_LINE_END);
+  } else if (!hexdump) {
+    csv.writeHeader();
+  }
+  CaptureEvent event;
+  PacketAssembler assembler;
+  CapturedPacket packet;
+  unsigned long long count = 0;
+  while (reader.next(event)) {
+    if (event.timestampNs < startNs) continue;
+    if (event.timestampNs > endNs) break;
+    if (channel >= 0 && event.channel != channel) continue;
+    if (event.kind == RECORD_KIND_BAUD_CHANGE) {
+      std::fprintf(stderr, "ss_convert: %s re-locked to %llu baud at %llu ns\n",
+                   channelName(event.channel), (unsigned long long)event.argument,
+                   (unsigned long long)event.timestampNs);
+    } else if (event.kind == RECORD_KIND_CHECKSUM) {
+      std::fprintf(stderr, "ss_convert: %s checksum %s (offset %u, trailer %u) at %llu ns\n",
+                   channelName(event.channel), checksumAlgorithmName(event.value),
+                   (unsigned)(event.argument & 0xFF), (unsigned)(event.argument >> 8),
+                   (unsigned long long)event.timestampNs);
+    }
+    if (packets) {
+      if (assembler.add(event, packet)) {
+        writePacketCsvLine(out, packet);
+        count++;
+      }
+    } else if (event.kind == RECORD_KIND_DATA) {
+      if (hexdump) {
+        dump.add(event.channel, event.value);
+      } else {
+        csv.add(event.timestampNs, event.channel, event.value, event.status);
+      }
+      count++;
+    }
+  }
+  if (hexdump) dump.finish();
+  csv.flush();
+  bool written = output.flush() && std::fflush(out) == 0;
+  if (reader.damagedBlocks() > 0) {
+    std::fprintf(stderr, "ss_convert: skipped %llu damaged or cut-off block(s)\n",
+                 (unsigned long long)reader.damagedBlocks());
+  }
+  if (packets && assembler.orphanBytes() > 0) {
+    std::fprintf(stderr, "ss_convert: %llu bytes outside framed packets\n",
+                 (unsigned long long)assembler.orphanBytes());
+  }
+
+  if (out != stdout) written &= std::fclose(out) == 0;
+  if (!written) {
+    std::fprintf(stderr, "ss_convert: write error on %s\n", outputPath.empty() ? "stdout" : outputPath.c_str());
+    return 1;
+  }
+  std::fprintf(stderr, "ss_convert: %llu %s (baud %lu, firmware %.16s, v%u%s, %lu Hz timestamps%s%s)\n",
+               count, packets ? "packets" : "records", (unsigned long)reader.header().baudRate,
+               reader.header().firmwareVersion, (unsigned)reader.header().version,
+               reader.header().recordFormat == RECORD_FORMAT_BLOCKS ? " compressed" : "",
+               (unsigned long)reader.timestampHz(), packets ? "" : ", formatted by ",
+               packets ? "" : formatKernelName(kernel));
+  return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * ss_index - Show, rebuild or check a capture's time index
+ *
+ * Usage: ss_index <capture> [--rebuild] [--check] [--start TIME] [--end TIME]
+ *
+ * Prints what the time index of a capture (binary or CSV) holds: where it
+ * came from (the .ssi sidecar the firmware wrote, or built from the
+ * capture because there is none), its entry count and spacing. With
+ * --rebuild, builds it from the capture and writes the sidecar, for
+ * captures from older firmware or converted with ss_convert. With
+ * --check, reads the whole capture and verifies every entry. With
+ * --start/--end (seconds, or H:MM:SS.fff, since capture start), prints
+ * the byte range a tool reads for that window.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "TimeIndex.h"
+
+static void printUsage(const char* program) {
+  std::fprintf(stderr, "Usage: %s <capture> [--rebuild] [--check] [--start TIME] [--end TIME]\n", program);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char** argv) {
+  std::string inputPath;
+  bool rebuild = false;
+  bool check = false;
+  uint64_t startNs = 0;
+  uint64_t endNs = UINT64_MAX;
+
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--rebuild") == 0) {
+      rebuild = true;
+    } else if (std::strcmp(argv[i], "--check") == 0) {
+      check = true;
+    } else if ((std::strcmp(argv[i], "--start") == 0 || std::strcmp(argv[i], "--end") == 0) && i + 1 < argc) {
+      uint64_t& bound = (argv[i][2] == 's') ? startNs : endNs;
+      if (!parseElapsedNs(argv[++i], bound)) {
+        std::fprintf(stderr, "ss_index: bad time '%s'\n", argv[i]);
+        return 2;
+      }
+    } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+      printUsage(argv[0]);
+      return 0;
+    } else if (inputPath.empty()) {
+      inputPath = argv[i];
+    } else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (inputPath.empty()) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  CaptureMap map;
+  if (!map.open(inputPath)) {
+    std::fprintf(stderr, "ss_index: %s\n", map.error().c_str());
+    return 1;
+  }
+
+  TimeIndex index;
+  std::string sidecar = TimeIndex::sidecarPath(inputPath);
+  auto begin = std::chrono::steady_clock::now();
+  if (rebuild) {
+    index.build(map);
+    if (!index.save(sidecar)) {
+      std::fprintf(stderr, "ss_index: %s\n", index.error().c_str());
+      return 1;
+    }
+    std::printf("Rebuilt %s in %.3f s\n", sidecar.c_str(), secondsSince(begin));
+  } else {
+    if (!index.load(sidecar, map)) {
+      std::fprintf(stderr, "ss_index: %s; building one\n", index.error().c_str());
+      index.build(map);
+    }
+  }
+
+  const CaptureIndexHeader& header = index.header();
+  std::printf("Capture:   %s (%zu bytes, %s)\n", inputPath.c_str(), map.size(),
+              map.type() == CAPTURE_FILE_CSV ? "csv" : "binary");
+  std::printf("Index:     %s, %zu entries, %lu Hz ticks\n",
+              index.source() == TimeIndex::SOURCE_SIDECAR ? "sidecar" : "rebuilt", index.size(),
+              (unsigned long)header.timestampHz);
+  if (header.intervalRecords || header.intervalMs) {
+    std::printf("Interval:  %lu records or %lu ms\n", (unsigned long)header.intervalRecords,
+                (unsigned long)header.intervalMs);
+  }
+  if (index.size() > 0) {
+    std::printf("Span:      %.6f s to %.6f s\n", index.entryNs(index.entries().front()) / 1e9,
+                index.entryNs(index.entries().back()) / 1e9);
+  }
+
+  if (startNs > 0 || endNs < UINT64_MAX) {
+    begin = std::chrono::steady_clock::now();
+    CaptureRange range = index.range(map, startNs, endNs);
+    double seconds = secondsSince(begin);
+    std::printf("Window:    bytes %zu-%zu (%.1f%% of the file, found in %.1f us)\n", range.begin, range.end,
+                map.size() ? 100.0 * (range.end - range.begin) / map.size() : 0.0, seconds * 1e6);
+  }
+
+  if (check) {
+    begin = std::chrono::steady_clock::now();
+    if (!index.check(map)) {
+      std::fprintf(stderr, "ss_index: %s\n", index.error().c_str());
+      return 1;
+    }
+    std::printf("Check:     all %zu entries match (%.3f s)\n", index.size(), secondsSince(begin));
+  }
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * ss_live - Receive the SerialSniffer live stream
+ *
+ * Usage: ss_live <device> [-o output] [--csv]
+ *
+ * Reads the live record stream from the firmware's streaming USB serial
+ * port (e.g. /dev/ttyACM1) and writes it as a binary capture (.ssb, the
+ * same format as the SD card files) or, with --csv, as CSV lines. The
+ * output goes to stdout if no file is given. The device is put in raw
+ * mode; a regular file or FIFO holding a recorded stream works as well.
+ *
+ * Gaps in the batch sequence (the firmware dropped batches because the
+ * host did not keep up, or bytes were corrupted) are reported on stderr
+ * as they happen, with a summary at the end. Stops at the END of the
+ * capture, end of file or Ctrl-C.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CsvFormat.h"
+#include "CycleClock.h"
+#include "LiveReceiver.h"
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int) { interrupted = 1; }
+
+static void printUsage(const char* program) {
+  std::fprintf(stderr, "Usage: %s <device> [-o output] [--csv]\n", program);
+}
+
+// Raw 8-bit input without echo or line editing (no-op for non-terminals)
+static bool makeRaw(int fd) {
+  if (!isatty(fd)) return true;
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) return false;
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+int main(int argc, char** argv) {
+  std::string devicePath;
+  std::string outputPath;
+  bool csv = false;
+
+  for (int i = 1; i < argc; i++) {
+    if ((std::strcmp(argv[i], "-o") == 0 || std::strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
+      outputPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--csv") == 0) {
+      csv = true;
+    } else if (std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+      printUsage(argv[0]);
+      return 0;
+    } else if (devicePath.empty()) {
+      devicePath = argv[i];
+    } else {
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (devicePath.empty()) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  int fd = open(devicePath.c_str(), O_RDONLY | O_NOCTTY);
+  if (fd < 0 || !makeRaw(fd)) {
+    std::fprintf(stderr, "ss_live: cannot open %s: %s\n", devicePath.c_str(), std::strerror(errno));
+    return 1;
+  }
+
+  std::FILE* out = stdout;
+  if (!outputPath.empty()) {
+    out = std::fopen(outputPath.c_str(), csv ? "w" : "wb");
+    if (!out) {
+      std::fprintf(stderr, "ss_live: cannot create %s\n", outputPath.c_str());
+      return 1;
+    }
+  }
+  static char outputBuffer[1 << 20];
+  std::setvbuf(out, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = onSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  LiveReceiver receiver;
+  LiveCaptureWriter writer(out);
+  uint32_t timestampHz = 0;
+  bool ended = false;
+  bool malformed = false;
+  if (csv) std::fprintf(out, "%s%s", CSV_HEADER, CSV_LINE_END);
+
+  auto onBatch = [&](const LiveBatch& batch) {
+    if (batch.missingBefore > 0) {
+      std::fprintf(stderr, "ss_live: %u batch(es) missing before #%u (at %.6f s)\n",
+                   batch.missingBefore, batch.header.sequence,
+                   batch.header.timestampHz ? (double)batch.header.baseTicks / batch.header.timestampHz : 0.0);
+    }
+    if (batch.header.type == LIVE_BATCH_START && receiver.stats().starts > 1) {
+      ended = true;              // Next capture: this output is complete
+      return;
+    }
+    if (batch.header.type == LIVE_BATCH_END) ended = true;
+    timestampHz = batch.header.timestampHz;
+
+    if (!csv) {
+      malformed |= !writer.write(batch);
+    } else if (batch.header.type == LIVE_BATCH_RECORDS) {
+      malformed |= !forEachLiveRecord(batch, [&](const DeltaRecord& record, uint64_t ticks) {
+        if (record.kind != RECORD_KIND_DATA) return;
+        CaptureEvent event;
+        event.ticks = ticks;
+        event.timestampNs = ticksToNs(ticks, timestampHz);
+        event.kind = record.kind;
+        event.channel = record.channel;
+        event.value = record.value;
+        event.status = record.status;
+        event.argument = 0;
+        writeCsvLine(out, event);
+      });
+    }
+  };
+
+  std::vector<uint8_t> chunk(1 << 16);
+  auto begin = std::chrono::steady_clock::now();
+  while (!interrupted && !ended) {
+    ssize_t got = read(fd, chunk.data(), chunk.size());
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) break;
+    receiver.feed(chunk.data(), (size_t)got, onBatch);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  close(fd);
+  if (out != stdout) std::fclose(out);
+  else std::fflush(out);
+
+  const LiveReceiverStats& stats = receiver.stats();
+  std::fprintf(stderr,
+               "ss_live: %llu records in %llu batches (%.2f MB/s), %llu missing in %llu gap(s), "
+               "%llu CRC errors, %llu bytes skipped%s\n",
+               (unsigned long long)stats.records, (unsigned long long)stats.batches,
+               seconds > 0 ? stats.payloadBytes / seconds / 1e6 : 0.0,
+               (unsigned long long)stats.missingBatches, (unsigned long long)stats.gaps,
+               (unsigned long long)stats.crcErrors, (unsigned long long)stats.skippedBytes,
+               ended ? "" : " (no END: capture still running or link lost)");
+  if (malformed) std::fprintf(stderr, "ss_live: malformed batch payloads were skipped\n");
+  return stats.missingBatches > 0 || malformed ? 3 : 0;
+}
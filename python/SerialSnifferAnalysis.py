@@ -2,20 +2,407 @@
 """
 SerialSniffer Analysis Suite
 Main analysis tool for processing captured serial data
+
+Captures (binary .ssb or CSV) are read through the ss_capture extension
+(ss_capture.cpp): the file is memory-mapped and decoded a chunk at a time
+into NumPy arrays, so every command runs in constant memory however large
+the capture is. With --start/--end, a command seeks through the capture's
+time index (the .ssi sidecar, or one built on the spot) and decodes only
+the bytes around that window.
 """
 
+from collections import namedtuple
+from datetime import datetime
+from pathlib import Path
+
 import click
-import pandas as pd
 import numpy as np
+import pandas as pd
 import matplotlib.pyplot as plt
-from pathlib import Path
 from rich.console import Console
 from rich.table import Table
 
+try:
+    import ss_capture
+except ImportError:  # Extension not built
+    ss_capture = None
+
 console = Console()
 
 __version__ = "0.1.0"
 
+# Records per chunk: ~20 bytes each once decoded
+CHUNK_RECORDS = 1 << 22
+
+# Packet boundaries when the capture has no packet records: an idle gap of
+# this many character times (10 bits), or this many median byte gaps when
+# the baud rate is unknown
+IDLE_CHARACTERS = 3.5
+IDLE_MEDIAN_GAPS = 10
+
+# One chunk of records, a NumPy array per field (views of the decoded chunk)
+Columns = namedtuple("Columns", "timestamp_ns kind channel value status argument")
+
+
+# ==================== Reading ====================
+
+def open_capture(path):
+    """Open a capture file with the memory-mapped reader"""
+    if ss_capture is None:
+        raise click.ClickException(
+            "the ss_capture extension is not built; run 'pip install -e .' in python/")
+    try:
+        return ss_capture.CaptureFile(str(path))
+    except OSError as error:
+        raise click.ClickException(str(error))
+
+
+def parse_time(text, capture):
+    """
+    Nanoseconds since capture start for a --start/--end value: seconds
+    ("90", "12.5") or [H:]M:S[.fff] since capture start, or a date and
+    time ("2026-10-16 03:14:07") on the capture's clock, which needs the
+    RTC start time of a binary capture header
+    """
+    if "-" in text[1:]:
+        try:
+            when = datetime.fromisoformat(text)
+        except ValueError:
+            raise click.BadParameter(f"'{text}' is not a date and time")
+        if not capture.start_time:
+            raise click.BadParameter("the capture has no start time; give seconds since capture start")
+        offset = (when - datetime(1970, 1, 1)).total_seconds() - capture.start_time
+        if offset < 0:
+            raise click.BadParameter(f"{text} is before the capture started")
+        return int(round(offset * 1e9))
+    try:
+        seconds = 0.0
+        for field in text.split(":"):
+            seconds = seconds * 60 + float(field)
+    except ValueError:
+        raise click.BadParameter(f"'{text}' is not a time")
+    if seconds < 0 or text.count(":") > 2:
+        raise click.BadParameter(f"'{text}' is not a time")
+    return int(round(seconds * 1e9))
+
+
+def time_window(capture, start, end):
+    """(start_ns, end_ns) from --start/--end, or None for the whole capture"""
+    if start is None and end is None:
+        return None
+    start_ns = parse_time(start, capture) if start is not None else 0
+    end_ns = parse_time(end, capture) if end is not None else None
+    if end_ns is not None and end_ns < start_ns:
+        raise click.BadParameter("--end is before --start")
+    return start_ns, end_ns
+
+
+def select_window(capture, window):
+    """Limit reading to a time window (None: the whole capture)"""
+    if window is None:
+        return
+    begin, end = capture.select(*window)
+    console.print(f"Window {format_window(window)}: reading {(end - begin) / 1e6:.1f} of "
+                  f"{capture.size / 1e6:.1f} MB ({capture.index} time index)")
+
+
+def format_window(window):
+    start_ns, end_ns = window
+    return f"{start_ns / 1e9:.3f} s to " + ("end" if end_ns is None else f"{end_ns / 1e9:.3f} s")
+
+
+def time_range_options(command):
+    """--start/--end: limit a command to a time window"""
+    command = click.option('--end', help='Window end: seconds or H:MM:SS since capture start, '
+                                         'or a date and time')(command)
+    command = click.option('--start', help='Window start (same forms as --end)')(command)
+    return command
+
+
+def iter_chunks(capture, records=CHUNK_RECORDS):
+    """Yield Columns for consecutive chunks of a CaptureFile (from the start of its selection)"""
+    capture.rewind()
+    while True:
+        chunk = capture.read(records)
+        if chunk is None:
+            return
+        yield Columns(
+            np.frombuffer(chunk.timestamp_ns, dtype=np.uint64),
+            np.frombuffer(chunk.kind, dtype=np.uint8),
+            np.frombuffer(chunk.channel, dtype=np.uint8),
+            np.frombuffer(chunk.value, dtype=np.uint8),
+            np.frombuffer(chunk.status, dtype=np.uint8),
+            np.frombuffer(chunk.argument, dtype=np.uint64),
+        )
+
+
+def channel_name(channel):
+    return ss_capture.CHANNEL_NAMES[channel] if channel < len(ss_capture.CHANNEL_NAMES) else "CH?"
+
+
+def parse_channel(text):
+    """Channel id from its name (RX, TX, CH2...) or number"""
+    names = [name.upper() for name in ss_capture.CHANNEL_NAMES]
+    if text.upper() in names:
+        return names.index(text.upper())
+    if text.isdigit() and int(text) <= 255:
+        return int(text)
+    raise click.BadParameter(f"'{text}' is not a channel name or number")
+
+
+def status_text(status):
+    """Status column text; flags are joined with '|'"""
+    if status == 0:
+        return "OK"
+    names = [
+        (ss_capture.STATUS_OVERFLOW, "OVERFLOW"),
+        (ss_capture.STATUS_FRAMING_ERROR, "FRAMING_ERROR"),
+        (ss_capture.STATUS_PARITY_ERROR, "PARITY_ERROR"),
+        (ss_capture.STATUS_CHECKSUM_VALID, "CHECKSUM_VALID"),
+        (ss_capture.STATUS_CHECKSUM_ERROR, "CHECKSUM_ERROR"),
+    ]
+    return "|".join(name for flag, name in names if status & flag)
+
+
+def gap_percentile(histogram, fraction):
+    """Upper bound of the power-of-two bin (bin i: [2^i, 2^(i+1)) ns) holding a percentile"""
+    histogram = np.asarray(histogram)
+    if histogram.sum() == 0:
+        return 0
+    index = int(np.searchsorted(np.cumsum(histogram), fraction * histogram.sum()))
+    return 2 ** (index + 1)
+
+
+def format_duration(ns):
+    seconds = ns / 1e9
+    if seconds < 1:
+        return f"{seconds * 1e3:.3f} ms"
+    if seconds < 3600:
+        return f"{seconds:.3f} s"
+    return f"{seconds / 3600:.2f} h"
+
+
+# ==================== Summary ====================
+
+def summarize(capture):
+    """Counts over the whole capture (one pass)"""
+    channels = ss_capture.MAX_CHANNELS
+    summary = {
+        "records": 0,
+        "bytes": np.zeros(channels, dtype=np.int64),
+        "overflow": np.zeros(channels, dtype=np.int64),
+        "framing": np.zeros(channels, dtype=np.int64),
+        "parity": np.zeros(channels, dtype=np.int64),
+        "packets": np.zeros(channels, dtype=np.int64),
+        "checksum_valid": np.zeros(channels, dtype=np.int64),
+        "checksum_error": np.zeros(channels, dtype=np.int64),
+        "value_sum": 0,
+        "baud_changes": [],
+        "first_ns": None,
+        "last_ns": 0,
+    }
+
+    def per_channel(mask, channel):
+        return np.bincount(channel[mask], minlength=channels)
+
+    for columns in iter_chunks(capture):
+        summary["records"] += len(columns.kind)
+        data = columns.kind == ss_capture.RECORD_KIND_DATA
+        ends = columns.kind == ss_capture.RECORD_KIND_PACKET_END
+        summary["bytes"] += per_channel(data, columns.channel)
+        summary["value_sum"] += int(columns.value[data].sum(dtype=np.uint64))
+        summary["overflow"] += per_channel(data & (columns.status & ss_capture.STATUS_OVERFLOW > 0),
+                                           columns.channel)
+        summary["framing"] += per_channel(
+            data & (columns.status & ss_capture.STATUS_FRAMING_ERROR > 0), columns.channel)
+        summary["parity"] += per_channel(data & (columns.status & ss_capture.STATUS_PARITY_ERROR > 0),
+                                         columns.channel)
+        summary["packets"] += per_channel(ends, columns.channel)
+        summary["checksum_valid"] += per_channel(
+            ends & (columns.status & ss_capture.STATUS_CHECKSUM_VALID > 0), columns.channel)
+        summary["checksum_error"] += per_channel(
+            ends & (columns.status & ss_capture.STATUS_CHECKSUM_ERROR > 0), columns.channel)
+        for index in np.flatnonzero(columns.kind == ss_capture.RECORD_KIND_BAUD_CHANGE):
+            summary["baud_changes"].append((int(columns.timestamp_ns[index]),
+                                            channel_name(columns.channel[index]),
+                                            int(columns.argument[index])))
+        if len(columns.timestamp_ns) > 0:
+            if summary["first_ns"] is None:
+                summary["first_ns"] = int(columns.timestamp_ns[0])
+            summary["last_ns"] = int(columns.timestamp_ns[-1])
+    return summary
+
+
+def analyze_capture(path, threads=0, window=None):
+    """
+    Whole-capture (or window) statistics and packets from the native
+    multithreaded pass (CaptureAnalysis.h): the file is split into ranges
+    analyzed on a work-stealing pool, with packets stitched across range
+    boundaries
+    """
+    open_capture(path)      # Same error if the extension is missing
+    start_ns, end_ns = window or (0, None)
+    try:
+        return ss_capture.analyze(str(path), threads=threads, start_ns=start_ns, end_ns=end_ns)
+    except OSError as error:
+        raise click.ClickException(str(error))
+
+
+def format_throughput(analysis):
+    seconds = max(analysis["seconds"], 1e-9)
+    text = (f"{analysis['input_bytes'] / 1e6:.1f} MB in {seconds:.2f} s "
+            f"({analysis['input_bytes'] / 1e6 / seconds:.0f} MB/s, {analysis['threads']} threads)")
+    if analysis["index"]:
+        text += f" of {analysis['file_bytes'] / 1e6:.1f} MB ({analysis['index']} time index)"
+    return text
+
+
+# ==================== Packets ====================
+
+# Packets of one channel: packet i is values[offset[i]:offset[i] + length[i]]
+PacketBatch = namedtuple("PacketBatch", "channel start_ns end_ns offset length values")
+
+
+class PacketSplitter:
+    """
+    Groups each channel's bytes into packets across chunks
+
+    Uses the firmware's PACKET_START records when the capture has them,
+    otherwise splits on idle gaps longer than gap_ns.
+    """
+
+    def __init__(self, gap_ns=None):
+        self.gap_ns = gap_ns
+        self.numbers = {}    # Channel -> packets started so far
+        self.last_ns = {}    # Channel -> time of the last byte (gap framing)
+        self.pending = {}    # Channel -> (number, start_ns, end_ns, [values])
+
+    def feed(self, columns):
+        """Packets completed by this chunk, as PacketBatch per channel"""
+        batches = []
+        data = columns.kind == ss_capture.RECORD_KIND_DATA
+        for channel in np.unique(columns.channel):
+            channel = int(channel)
+            on_channel = columns.channel == channel
+            mask = data & on_channel
+            if self.gap_ns is None:
+                starts = np.cumsum((columns.kind == ss_capture.RECORD_KIND_PACKET_START) & on_channel)
+                numbers = self.numbers.get(channel, 0) + starts[mask]
+                self.numbers[channel] = self.numbers.get(channel, 0) + int(starts[-1])
+            else:
+                times = columns.timestamp_ns[mask].astype(np.int64)
+                if len(times) == 0:
+                    continue
+                previous = np.concatenate(([self.last_ns.get(channel, -(1 << 62))], times[:-1]))
+                numbers = self.numbers.get(channel, 0) + np.cumsum(times - previous > self.gap_ns)
+                self.numbers[channel] = int(numbers[-1])
+                self.last_ns[channel] = int(times[-1])
+            if len(numbers) == 0:
+                continue
+            batches.extend(self._group(channel, numbers, columns.timestamp_ns[mask], columns.value[mask]))
+        return batches
+
+    def finish(self):
+        """Packets still open at the end of the capture"""
+        batches = [self._single(channel, packet) for channel, packet in self.pending.items()]
+        self.pending = {}
+        return batches
+
+    def _group(self, channel, numbers, times, values):
+        bounds = np.flatnonzero(numbers[1:] != numbers[:-1]) + 1
+        starts = np.concatenate(([0], bounds))
+        ends = np.concatenate((bounds, [len(numbers)]))
+
+        batches = []
+        pending = self.pending.pop(channel, None)
+        first = 0
+        if pending is not None:
+            if numbers[0] == pending[0]:
+                # The first group continues the packet from the last chunk
+                pending[2] = times[ends[0] - 1]
+                pending[3].append(values[:ends[0]].copy())
+                first = 1
+                if len(starts) > 1:
+                    batches.append(self._single(channel, pending))
+                    pending = None
+            else:
+                batches.append(self._single(channel, pending))
+                pending = None
+        if pending is not None:
+            self.pending[channel] = pending
+            return batches
+
+        # All groups but the last are complete; the last may go on
+        last = len(starts) - 1
+        if last > first:
+            index = np.arange(first, last)
+            batches.append(PacketBatch(channel, times[starts[index]], times[ends[index] - 1],
+                                       starts[index], ends[index] - starts[index], values))
+        if last >= first:
+            self.pending[channel] = [numbers[starts[last]], times[starts[last]], times[ends[last] - 1],
+                                     [values[starts[last]:].copy()]]
+        return batches
+
+    @staticmethod
+    def _single(channel, packet):
+        values = np.concatenate(packet[3])
+        return PacketBatch(channel, np.array([packet[1]], dtype=np.uint64),
+                           np.array([packet[2]], dtype=np.uint64), np.array([0]),
+                           np.array([len(values)]), values)
+
+
+def packet_splitter(capture):
+    """Splitter for a capture: firmware packet records, else idle gaps"""
+    first = next(iter_chunks(capture), None)
+    if first is None or np.any(first.kind == ss_capture.RECORD_KIND_PACKET_START):
+        return PacketSplitter()
+    if capture.baud > 0:
+        return PacketSplitter(gap_ns=int(IDLE_CHARACTERS * 10 * 1e9 / capture.baud))
+    gaps = []
+    data = first.kind == ss_capture.RECORD_KIND_DATA
+    for channel in np.unique(first.channel[data]):
+        times = first.timestamp_ns[data & (first.channel == channel)].astype(np.int64)
+        gaps.append(np.diff(times))
+    gaps = np.concatenate(gaps) if gaps else np.array([])
+    median = float(np.median(gaps[gaps > 0])) if np.any(gaps > 0) else 1e6
+    return PacketSplitter(gap_ns=int(IDLE_MEDIAN_GAPS * median))
+
+
+def iter_packets(capture):
+    """Yield PacketBatch for every packet of the capture"""
+    splitter = packet_splitter(capture)
+    for columns in iter_chunks(capture):
+        yield from splitter.feed(columns)
+    yield from splitter.finish()
+
+
+# ==================== Checksums ====================
+
+def trailing_checksum(algorithm, field):
+    """Checksum value as sent in its trailing bytes (CRC-16/MODBUS low byte first)"""
+    if algorithm == ss_capture.CHECKSUM_CRC16_MODBUS:
+        return int(field[0]) | int(field[1]) << 8
+    if algorithm == ss_capture.CHECKSUM_CRC16_CCITT:
+        return int(field[0]) << 8 | int(field[1])
+    return int(field[0])
+
+
+def check_packet(algorithm, packet, offset, trailer):
+    """True if the packet's checksum field matches, None if it is too short"""
+    width = ss_capture.checksum_width(algorithm)
+    covered_end = len(packet) - trailer - width
+    if covered_end <= offset:
+        return None
+    value = ss_capture.checksum(algorithm, packet[offset:covered_end])
+    return value == trailing_checksum(algorithm, packet[covered_end:covered_end + width])
+
+
+def packet_bytes(batch, index):
+    start = int(batch.offset[index])
+    return batch.values[start:start + int(batch.length[index])]
+
+
+# ==================== Commands ====================
 
 @click.group()
 @click.version_option(version=__version__)
@@ -27,31 +414,193 @@ def cli():
 @cli.command()
 @click.argument('input_file', type=click.Path(exists=True))
 @click.option('--output', '-o', help='Output file path')
-@click.option('--format', '-f', type=click.Choice(['csv', 'json', 'xlsx']), default='csv', help='Output format')
-def convert(input_file, output, format):
+@click.option('--format', '-f', type=click.Choice(['csv', 'hexdump', 'json', 'xlsx']), default='csv',
+              help='Output format')
+@click.option('--channel', '-c', help='Only this channel (RX, TX, CH2... or a number)')
+@time_range_options
+def convert(input_file, output, format, channel, start, end):
     """Convert captured data to different formats"""
     console.print(f"[bold green]Converting {input_file}...[/bold green]")
-    # TODO: Implement conversion logic
-    pass
+    capture = open_capture(input_file)
+    select_window(capture, time_window(capture, start, end))
+    suffix = ".txt" if format == 'hexdump' else "." + format
+    output = Path(output) if output else Path(input_file).with_suffix(suffix)
+    if output.resolve() == Path(input_file).resolve():
+        raise click.ClickException("output would overwrite the input")
+    selected = parse_channel(channel) if channel else -1
+
+    if format in ('csv', 'hexdump'):
+        # Formatted by the extension's vectorized kernels (HexFormat.h),
+        # streamed to the file a chunk at a time, the same text as ss_convert
+        try:
+            rows = capture.export(str(output), format, selected)
+        except OSError as error:
+            raise click.ClickException(str(error))
+        console.print(f"Wrote {rows} bytes to {output} ({ss_capture.FORMAT_KERNEL} formatter)")
+        return
+
+    hex_text = np.array([f"0x{v:02X}" for v in range(256)], dtype=object)
+    ascii_text = np.array([chr(v) if 32 <= v <= 126 else "." for v in range(256)], dtype=object)
+    statuses = np.array([status_text(s) for s in range(256)], dtype=object)
+    names = np.array([channel_name(c) for c in range(256)], dtype=object)
+
+    def frame(columns):
+        data = columns.kind == ss_capture.RECORD_KIND_DATA
+        if selected >= 0:
+            data &= columns.channel == selected
+        return pd.DataFrame({
+            "Timestamp": columns.timestamp_ns[data],
+            "Direction": names[columns.channel[data]],
+            "Value_Hex": hex_text[columns.value[data]],
+            "Value_ASCII": ascii_text[columns.value[data]],
+            "Status": statuses[columns.status[data]],
+        })
+
+    rows = 0
+    if format == 'xlsx':
+        limit = 1048575                       # Excel rows, less the header
+        frames = []
+        for columns in iter_chunks(capture):
+            frames.append(frame(columns))
+            rows += len(frames[-1])
+            if rows > limit:
+                raise click.ClickException(
+                    f"more than {limit} bytes do not fit in a worksheet; use csv or json")
+        table = pd.concat(frames) if frames else frame(Columns(*([np.array([], dtype=np.uint8)] * 6)))
+        table.to_excel(output, index=False)
+    else:
+        with open(output, "w", newline="") as out:
+            for columns in iter_chunks(capture):
+                table = frame(columns)
+                table.to_json(out, orient="records", lines=True)
+                rows += len(table)
+    console.print(f"Wrote {rows} bytes to {output}")
 
 
 @cli.command()
 @click.argument('input_file', type=click.Path(exists=True))
-def analyze(input_file):
+@time_range_options
+def analyze(input_file, start, end):
     """Perform comprehensive analysis on captured data"""
     console.print(f"[bold blue]Analyzing {input_file}...[/bold blue]")
-    # TODO: Implement analysis logic
-    pass
+    capture = open_capture(input_file)
+    select_window(capture, time_window(capture, start, end))
+    channels = ss_capture.MAX_CHANNELS
+
+    # Per channel: value histogram and a log2 histogram of inter-byte gaps
+    values = np.zeros((channels, 256), dtype=np.int64)
+    gap_bins = np.arange(0, 41)
+    gaps = np.zeros((channels, len(gap_bins) - 1), dtype=np.int64)
+    gap_max = np.zeros(channels, dtype=np.int64)
+    last_ns = {}
+    for columns in iter_chunks(capture):
+        data = columns.kind == ss_capture.RECORD_KIND_DATA
+        for channel in map(int, np.unique(columns.channel[data])):
+            mask = data & (columns.channel == channel)
+            values[channel] += np.bincount(columns.value[mask], minlength=256)
+            times = columns.timestamp_ns[mask].astype(np.int64)
+            if channel in last_ns:
+                times = np.concatenate(([last_ns[channel]], times))
+            last_ns[channel] = int(times[-1])
+            diffs = np.diff(times)
+            if len(diffs) > 0:
+                gaps[channel] += np.histogram(np.log2(np.maximum(diffs, 1)), bins=gap_bins)[0]
+                gap_max[channel] = max(gap_max[channel], int(diffs.max()))
+
+    table = Table(title="Channel Analysis")
+    for column in ("Channel", "Bytes", "Distinct", "Printable", "Most Common", "Gap p50", "Gap p99",
+                   "Gap Max"):
+        table.add_column(column, style="cyan" if column == "Channel" else "green")
+    printable = np.zeros(256, dtype=bool)
+    printable[32:127] = True
+    printable[[9, 10, 13]] = True
+    for channel in range(channels):
+        total = int(values[channel].sum())
+        if total == 0:
+            continue
+        top = np.argsort(values[channel])[::-1][:3]
+        common = " ".join(f"{v:02X}:{values[channel][v] * 100 / total:.1f}%"
+                          for v in top if values[channel][v] > 0)
+        table.add_row(channel_name(channel), str(total), str(int(np.count_nonzero(values[channel]))),
+                      f"{values[channel][printable].sum() * 100 / total:.1f}%", common,
+                      format_duration(gap_percentile(gaps[channel], 0.5)),
+                      format_duration(gap_percentile(gaps[channel], 0.99)),
+                      format_duration(int(gap_max[channel])))
+    console.print(table)
+    console.print("Gap percentiles are upper bounds of power-of-two bins.")
+
+    lengths = {}
+    for batch in iter_packets(capture):
+        lengths.setdefault(batch.channel, []).append(batch.length)
+    for channel, parts in sorted(lengths.items()):
+        counts = np.concatenate(parts)
+        console.print(f"{channel_name(channel)}: {len(counts)} packets, length "
+                      f"{counts.min()}-{counts.max()} (mean {counts.mean():.1f})")
 
 
 @cli.command()
 @click.argument('input_file', type=click.Path(exists=True))
 @click.option('--algorithm', '-a', type=click.Choice(['crc8', 'crc16', 'xor', 'sum']), help='Checksum algorithm')
-def checksum(input_file, algorithm):
+@time_range_options
+def checksum(input_file, algorithm, start, end):
     """Detect and validate checksums in captured data"""
     console.print(f"[bold yellow]Detecting checksums in {input_file}...[/bold yellow]")
-    # TODO: Implement checksum detection logic
-    pass
+    capture = open_capture(input_file)
+    select_window(capture, time_window(capture, start, end))
+    names = ss_capture.CHECKSUM_ALGORITHMS
+    choices = {
+        'crc8': [ss_capture.CHECKSUM_CRC8],
+        'crc16': [ss_capture.CHECKSUM_CRC16_MODBUS, ss_capture.CHECKSUM_CRC16_CCITT],
+        'xor': [ss_capture.CHECKSUM_XOR8],
+        'sum': [ss_capture.CHECKSUM_SUM8],
+    }
+    candidates = choices[algorithm] if algorithm else list(range(1, len(names)))
+
+    # The firmware's verdicts, when it detected a rule while logging
+    summary = summarize(capture)
+    locked = {}
+    for columns in iter_chunks(capture):
+        for index in np.flatnonzero(columns.kind == ss_capture.RECORD_KIND_CHECKSUM):
+            argument = int(columns.argument[index])
+            locked[int(columns.channel[index])] = (int(columns.value[index]), argument & 0xFF, argument >> 8)
+    if locked and not algorithm:
+        table = Table(title="Firmware Checksum Detection")
+        for column in ("Channel", "Rule", "Valid", "Errors"):
+            table.add_column(column, style="cyan" if column == "Channel" else "green")
+        for channel, (found, offset, trailer) in sorted(locked.items()):
+            table.add_row(channel_name(channel), f"{names[found]} offset {offset} trailer {trailer}",
+                          str(summary["checksum_valid"][channel]), str(summary["checksum_error"][channel]))
+        console.print(table)
+        return
+
+    # Score every candidate rule on each channel's packets
+    rules = [(a, offset, trailer) for a in candidates for offset in range(3) for trailer in range(2)]
+    scores = {}
+    sample = None if algorithm else 2000      # Detection looks at the first packets only
+    for batch in iter_packets(capture):
+        for index in range(len(batch.length)):
+            seen = scores.setdefault(batch.channel, {"packets": 0, "rules": {rule: [0, 0] for rule in rules}})
+            if sample is not None and seen["packets"] >= sample:
+                continue
+            seen["packets"] += 1
+            packet = packet_bytes(batch, index)
+            for rule in rules:
+                verdict = check_packet(rule[0], packet, rule[1], rule[2])
+                if verdict is not None:
+                    seen["rules"][rule][0 if verdict else 1] += 1
+
+    table = Table(title="Checksum Validation" if algorithm else "Checksum Detection")
+    for column in ("Channel", "Packets", "Best Rule", "Valid", "Errors", "Match Rate"):
+        table.add_column(column, style="cyan" if column == "Channel" else "green")
+    for channel, seen in sorted(scores.items()):
+        rule, (valid, errors) = max(seen["rules"].items(), key=lambda item: item[1][0])
+        rate = valid / (valid + errors) if valid + errors else 0
+        text = f"{names[rule[0]]} offset {rule[1]} trailer {rule[2]}"
+        if not algorithm and rate < 0.9:
+            text = "none found"
+        table.add_row(channel_name(channel), str(seen["packets"]), text, str(valid), str(errors),
+                      f"{rate * 100:.1f}%")
+    console.print(table)
 
 
 @cli.command()
@@ -66,30 +615,129 @@ def visualize(input_file, output):
 
 @cli.command()
 @click.argument('input_file', type=click.Path(exists=True))
-def packets(input_file):
+@click.option('--threads', '-j', type=int, default=0, help='Analysis threads (default: all cores)')
+@time_range_options
+def packets(input_file, threads, start, end):
     """Analyze packet structure and boundaries"""
     console.print(f"[bold cyan]Analyzing packet structure in {input_file}...[/bold cyan]")
-    # TODO: Implement packet analysis logic
-    pass
+    window = time_window(open_capture(input_file), start, end)
+    analysis = analyze_capture(input_file, threads, window)
+    channels = {c: stats for c, stats in analysis["channels"].items() if stats["packets"] > 0}
+    if not channels:
+        console.print("No packets found.")
+        return
+    console.print("Framing: " + ("firmware packet records" if analysis["framing"] == "records"
+                                 else f"idle gaps over {format_duration(analysis['gap_ns'])}"))
+
+    table = Table(title="Packet Structure")
+    for column in ("Channel", "Packets", "Length", "Common Lengths", "Mean Duration", "Gap p50/p99",
+                   "Peak Rate", "End Reasons"):
+        table.add_column(column, style="cyan" if column == "Channel" else "green")
+    last_length = ss_capture.ANALYSIS_LENGTH_BINS - 1   # Longer packets share this bin
+    rate_seconds = analysis["rate_bin_ns"] / 1e9
+    for channel, stats in sorted(channels.items()):
+        histogram = np.array(stats["lengths"])
+        common = ", ".join(f"{'%d+' % n if n == last_length else n} ({histogram[n]})"
+                           for n in np.argsort(histogram, kind="stable")[::-1][:3] if histogram[n])
+        mean_duration = stats["duration_sum_ns"] / stats["durations"] if stats["durations"] else 0
+        ended = stats["end_reasons"]
+        ended_text = ", ".join(f"{ss_capture.PACKET_END_REASONS[r]} {ended[r]}"
+                               for r in range(len(ended)) if ended[r]) if analysis["framing"] == "records" else "-"
+        gaps = "-"
+        if stats["gap_count"]:
+            gaps = " / ".join(format_duration(min(gap_percentile(stats["gaps"], fraction), stats["gap_max_ns"]))
+                              for fraction in (0.5, 0.99))
+        table.add_row(channel_name(channel), str(stats["packets"]),
+                      f"{stats['length_min']}-{stats['length_max']} (mean {stats['length_sum'] / stats['packets']:.1f})",
+                      common, format_duration(mean_duration), gaps,
+                      f"{max(stats['rate'], default=0) / rate_seconds:.0f}/s", ended_text)
+    console.print(table)
+    console.print("Gap percentiles are upper bounds of power-of-two bins.")
+    console.print(f"Analyzed {format_throughput(analysis)}")
 
 
 @cli.command()
 @click.argument('input_file', type=click.Path(exists=True))
-def stats(input_file):
+@click.option('--threads', '-j', type=int, default=0, help='Analysis threads (default: all cores)')
+@time_range_options
+def stats(input_file, threads, start, end):
     """Display statistical summary of captured data"""
     console.print(f"[bold white]Computing statistics for {input_file}...[/bold white]")
-    # TODO: Implement statistics calculation
+    capture = open_capture(input_file)
+    window = time_window(capture, start, end)
+    analysis = analyze_capture(input_file, threads, window)
+    channels = analysis["channels"]
 
-    # Example output format
     table = Table(title="Capture Statistics")
     table.add_column("Metric", style="cyan")
     table.add_column("Value", style="green")
 
-    table.add_row("Total Bytes", "0")
-    table.add_row("Total Packets", "0")
-    table.add_row("Baud Rate", "Unknown")
-    table.add_row("Duration", "0s")
+    duration = analysis["last_ns"] - (analysis["first_ns"] or 0)
+    total_packets = sum(c["packets"] for c in channels.values())
+    table.add_row("Format", capture.type if capture.type == "csv"
+                  else f"binary v{capture.version}{', compressed' if capture.compressed else ''} "
+                       f"(firmware {capture.firmware or '?'})")
+    table.add_row("Total Bytes", str(sum(c["bytes"] for c in channels.values())))
+    table.add_row("Total Packets", f"{total_packets} ("
+                  + ("firmware packet records" if analysis["framing"] == "records"
+                     else f"idle gaps over {format_duration(analysis['gap_ns'])}") + ")")
+    table.add_row("Baud Rate", str(capture.baud) if capture.baud else "Unknown")
+    if window is not None:
+        table.add_row("Window", format_window(window))
+    table.add_row("Duration", format_duration(duration))
+    if duration > 0 and total_packets:
+        table.add_row("Packet Rate", f"{total_packets * 1e9 / duration:.1f}/s mean")
+    for channel, stats in sorted(channels.items()):
+        name = channel_name(channel)
+        table.add_row(f"{name} Bytes", str(stats["bytes"]))
+        if stats["overflow"] + stats["framing"] + stats["parity"]:
+            table.add_row(f"{name} Errors",
+                          f"overflow {stats['overflow']}, framing {stats['framing']}, parity {stats['parity']}")
+        if stats["packets"]:
+            text = (f"{stats['packets']}, {stats['length_min']}-{stats['length_max']} bytes "
+                    f"(mean {stats['length_sum'] / stats['packets']:.1f})")
+            if stats["checksum_valid"] or stats["checksum_error"]:
+                text += f", checksum valid {stats['checksum_valid']}, errors {stats['checksum_error']}"
+            table.add_row(f"{name} Packets", text)
+        if stats["gap_count"]:
+            p50 = min(gap_percentile(stats["gaps"], 0.5), stats["gap_max_ns"])
+            table.add_row(f"{name} Packet Gap", f"p50 {format_duration(p50)}, "
+                          f"max {format_duration(stats['gap_max_ns'])}")
+    for when, channel, baud in analysis["baud_changes"]:
+        table.add_row("Baud Change", f"{channel_name(channel)} -> {baud} at {format_duration(when)}")
+    if analysis["malformed_lines"]:
+        table.add_row("Malformed Lines", str(analysis["malformed_lines"]))
+    if analysis["damaged_blocks"]:
+        table.add_row("Damaged Blocks", f"{analysis['damaged_blocks']} (records in them skipped)")
+    table.add_row("Throughput", format_throughput(analysis))
+
+    console.print(table)
 
+
+@cli.command('index')
+@click.argument('input_file', type=click.Path(exists=True))
+@click.option('--rebuild', is_flag=True, help='Build the index from the capture and write its .ssi sidecar')
+def show_index(input_file, rebuild):
+    """Show or rebuild the time index that --start/--end seek with"""
+    open_capture(input_file)
+    try:
+        index = ss_capture.time_index(str(input_file), rebuild=rebuild)
+    except OSError as error:
+        raise click.ClickException(str(error))
+
+    table = Table(title="Time Index")
+    table.add_column("Metric", style="cyan")
+    table.add_column("Value", style="green")
+    source = {"sidecar": f"{index['sidecar']}", "rebuilt": "built from the capture (no usable sidecar)"}
+    table.add_row("Source", source[index["source"]] if not rebuild else f"rebuilt into {index['sidecar']}")
+    table.add_row("Entries", str(index["entries"]))
+    if index["interval_records"] or index["interval_ms"]:
+        table.add_row("Interval", f"{index['interval_records']} records or {index['interval_ms']} ms")
+    elif index["entries"]:
+        table.add_row("Interval", f"~{index['file_bytes'] / (index['entries'] + 1) / 1e6:.1f} MB")
+    if index["entries"]:
+        table.add_row("Span", f"{format_duration(index['first_ns'])} to {format_duration(index['last_ns'])}")
+    table.add_row("Time", f"{index['seconds']:.3f} s")
     console.print(table)
 
 
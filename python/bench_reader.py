@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+"""
+bench_reader - ss_capture versus pandas.read_csv on a synthetic capture
+
+Writes a synthetic two-channel capture (1 Mbaud packets with CRC-16/MODBUS
+checksums, idle gaps, a few framing errors) as a binary .ssb file and the
+same records as CSV, then runs the same summary three ways, each in a
+fresh process so peak memory is its own:
+
+  pandas-csv   pandas.read_csv of the whole CSV, then column arithmetic
+  ss-csv       SerialSnifferAnalysis.summarize() on the CSV (memory-mapped, chunked)
+  ss-ssb       SerialSnifferAnalysis.summarize() on the .ssb
+
+Reports seconds, MB/s of input, records/s and peak RSS, and exits
+non-zero if the three summaries differ. The default is about 0.6 GB of
+CSV; --records 100000000 gives ~3 GB (pandas then needs several GB of
+RAM, the chunked reader does not).
+
+Usage: bench_reader.py [--records N] [--dir DIR] [--ss-convert PATH] [--keep]
+
+Author: SerialSniffer Team
+License: TBD
+"""
+
+import argparse
+import csv
+import json
+import resource
+import shutil
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+import numpy as np
+
+HERE = Path(__file__).resolve().parent
+sys.path.insert(0, str(HERE))
+
+TIMESTAMP_HZ = 600000000
+CHARACTER_TICKS = 6000            # 1 Mbaud, 10 bits
+IDLE_TICKS = 60000                # Between packets
+PACKET_LENGTH = 8                 # 6 data bytes + CRC-16
+TEMPLATES = 256                   # Distinct packets, tiled at random
+FRAMING_ERROR_RATE = 1e-4
+HEADER_SIZE = 64
+
+
+# ==================== Synthetic Capture ====================
+
+def make_records(count, seed=1):
+    """Timestamps (ticks), channels, values and statuses of a synthetic capture"""
+    import ss_capture
+    rng = np.random.default_rng(seed)
+    templates = np.zeros((TEMPLATES, PACKET_LENGTH), dtype=np.uint8)
+    for row in templates:
+        row[:-2] = rng.integers(0, 256, PACKET_LENGTH - 2)
+        crc = ss_capture.checksum(ss_capture.CHECKSUM_CRC16_MODBUS, row[:-2].tobytes())
+        row[-2:] = (crc & 0xFF, crc >> 8)
+
+    packets = count // PACKET_LENGTH
+    count = packets * PACKET_LENGTH
+    values = templates[rng.integers(0, TEMPLATES, packets)].reshape(-1)
+
+    # Packets alternate between the channels; each is sent as a burst
+    channels = np.repeat((np.arange(packets) % 2).astype(np.uint8), PACKET_LENGTH)
+    deltas = np.full(count, CHARACTER_TICKS, dtype=np.uint64)
+    deltas[::PACKET_LENGTH] = IDLE_TICKS
+    deltas[0] = 0
+    ticks = np.cumsum(deltas, dtype=np.uint64)
+    statuses = np.where(rng.random(count) < FRAMING_ERROR_RATE, 0x02, 0).astype(np.uint8)
+    return ticks, deltas, channels, values, statuses
+
+
+def encode_ssb(path, deltas, channels, values, statuses):
+    """Binary capture: header, then varint delta + tag + value [+ status] per record"""
+    import ss_capture  # noqa: F401 (format constants come from CaptureFormat.h)
+    header = bytearray(HEADER_SIZE)
+    header[0:4] = (0x464E5353).to_bytes(4, "little")          # "SSNF"
+    header[4:6] = (3).to_bytes(2, "little")                   # Version
+    header[6:8] = HEADER_SIZE.to_bytes(2, "little")
+    header[8:12] = (1000000).to_bytes(4, "little")            # Baud
+    header[12:15] = bytes((8, 0, 1))                          # 8N1
+    header[15] = 2                                            # Delta records
+    header[24:33] = b"synthetic"
+    header[40:44] = TIMESTAMP_HZ.to_bytes(4, "little")
+
+    varint_bytes = np.ones(len(deltas), dtype=np.int64)
+    limit = np.uint64(128)
+    while True:
+        longer = deltas >= limit
+        if not longer.any():
+            break
+        varint_bytes += longer
+        limit = limit << np.uint64(7)
+    has_status = statuses != 0
+    sizes = varint_bytes + 2 + has_status
+    offsets = np.concatenate(([0], np.cumsum(sizes)[:-1]))
+    out = np.zeros(int(sizes.sum()), dtype=np.uint8)
+
+    remaining = deltas.copy()
+    for i in range(int(varint_bytes.max())):
+        present = varint_bytes > i
+        more = varint_bytes > i + 1
+        byte = (remaining & np.uint64(0x7F)).astype(np.uint8) | np.where(more, 0x80, 0).astype(np.uint8)
+        out[offsets[present] + i] = byte[present]
+        remaining >>= np.uint64(7)
+    tag = channels | np.where(has_status, 0x80, 0).astype(np.uint8)
+    out[offsets + varint_bytes] = tag
+    out[offsets + varint_bytes + 1] = values
+    out[(offsets + varint_bytes + 2)[has_status]] = statuses[has_status]
+
+    with open(path, "wb") as f:
+        f.write(bytes(header))
+        f.write(out.tobytes())
+
+
+def write_csv(ssb_path, csv_path, ss_convert):
+    if ss_convert:
+        subprocess.run([ss_convert, str(ssb_path), "-o", str(csv_path)], check=True,
+                       stderr=subprocess.DEVNULL)
+    else:
+        from click.testing import CliRunner
+        import SerialSnifferAnalysis
+        result = CliRunner().invoke(SerialSnifferAnalysis.cli, ["convert", str(ssb_path), "-o", str(csv_path)])
+        if result.exit_code != 0:
+            raise RuntimeError(result.output)
+
+
+# ==================== Measured Runs ====================
+
+def summary_pandas(path):
+    import pandas as pd
+    # The ASCII column is unquoted: 0x22 must not start a quoted field, and
+    # 0x2C adds a field (read a spare column, the status is then in it)
+    table = pd.read_csv(path, header=None, skiprows=1, quoting=csv.QUOTE_NONE,
+                        names=["Timestamp", "Direction", "Value_Hex", "Value_ASCII", "Status", "Spare"],
+                        dtype={"Direction": "category", "Value_Hex": "category", "Value_ASCII": "category",
+                               "Status": "category", "Spare": "category"})
+    status = table["Spare"].astype(object).where(table["Spare"].notna(), table["Status"].astype(object))
+    codes = table["Value_Hex"].cat.codes.to_numpy()
+    lookup = np.array([int(text, 16) for text in table["Value_Hex"].cat.categories], dtype=np.uint64)
+    values = lookup[codes]
+    bytes_per_channel = table["Direction"].value_counts()
+    return {
+        "bytes": {name: int(bytes_per_channel.get(name, 0)) for name in ("RX", "TX")},
+        "value_sum": int(values.sum()),
+        "framing": int((status == "FRAMING_ERROR").sum()),
+        "last_ns": int(table["Timestamp"].iloc[-1]),
+    }
+
+
+def summary_ss(path):
+    import SerialSnifferAnalysis as analysis
+    summary = analysis.summarize(analysis.open_capture(path))
+    return {
+        "bytes": {"RX": int(summary["bytes"][0]), "TX": int(summary["bytes"][1])},
+        "value_sum": summary["value_sum"],
+        "framing": int(summary["framing"].sum()),
+        "last_ns": summary["last_ns"],
+    }
+
+
+def peak_rss_mb():
+    # VmHWM starts over at exec (ru_maxrss would include the parent's peak)
+    with open("/proc/self/status") as status:
+        for line in status:
+            if line.startswith("VmHWM:"):
+                return int(line.split()[1]) / 1024
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+
+
+def measure(mode, path):
+    import pandas  # noqa: F401 (imports are not timed)
+    import SerialSnifferAnalysis  # noqa: F401
+    start = time.perf_counter()
+    result = summary_pandas(path) if mode == "pandas-csv" else summary_ss(path)
+    result["seconds"] = time.perf_counter() - start
+    result["peak_rss_mb"] = peak_rss_mb()
+    print(json.dumps(result))
+
+
+def run(mode, path):
+    completed = subprocess.run([sys.executable, __file__, "--measure", mode, str(path)],
+                               capture_output=True, text=True)
+    if completed.returncode != 0:
+        if completed.returncode < 0:
+            return None, "killed (out of memory?)"
+        return None, "failed: " + completed.stderr.strip().splitlines()[-1]
+    return json.loads(completed.stdout.strip().splitlines()[-1]), ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ss_capture versus pandas.read_csv")
+    parser.add_argument("--records", type=int, default=20000000)
+    parser.add_argument("--dir", default="/tmp/bench_reader")
+    parser.add_argument("--ss-convert", help="ss_convert binary (faster CSV generation)")
+    parser.add_argument("--keep", action="store_true", help="keep the generated files")
+    parser.add_argument("--measure", nargs=2, metavar=("MODE", "FILE"), help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    if args.measure:
+        measure(*args.measure)
+        return 0
+
+    ss_convert = args.ss_convert
+    if not ss_convert:
+        built = HERE.parent / "host" / "build" / "ss_convert"
+        ss_convert = str(built) if built.exists() else shutil.which("ss_convert")
+
+    directory = Path(args.dir)
+    directory.mkdir(parents=True, exist_ok=True)
+    ssb = directory / "synthetic.ssb"
+    csv = directory / "synthetic.csv"
+    start = time.perf_counter()
+    ticks, deltas, channels, values, statuses = make_records(args.records)
+    encode_ssb(ssb, deltas, channels, values, statuses)
+    del ticks, deltas, channels, values, statuses
+    write_csv(ssb, csv, ss_convert)
+    print(f"Generated {args.records} records in {time.perf_counter() - start:.1f} s: "
+          f"{ssb.stat().st_size / 1e6:.0f} MB .ssb, {csv.stat().st_size / 1e6:.0f} MB CSV\n")
+
+    print(f"{'mode':<12} {'input_MB':>9} {'seconds':>9} {'MB/s':>8} {'Mrec/s':>8} {'peak_MB':>9}  result")
+    results = {}
+    failed = []
+    for mode, path in (("pandas-csv", csv), ("ss-csv", csv), ("ss-ssb", ssb)):
+        result, reason = run(mode, path)
+        size = path.stat().st_size / 1e6
+        if result is None:
+            print(f"{mode:<12} {size:>9.0f} {'-':>9} {'-':>8} {'-':>8} {'-':>9}  {reason}")
+            if not reason.startswith("killed"):
+                failed.append(mode)
+            continue
+        records = sum(result["bytes"].values())
+        print(f"{mode:<12} {size:>9.0f} {result['seconds']:>9.2f} {size / result['seconds']:>8.1f} "
+              f"{records / result['seconds'] / 1e6:>8.2f} {result['peak_rss_mb']:>9.0f}  "
+              f"{records} bytes, {result['framing']} framing errors")
+        results[mode] = {key: result[key] for key in ("bytes", "value_sum", "framing", "last_ns")}
+
+    if not args.keep:
+        ssb.unlink()
+        csv.unlink()
+
+    reference = results.get("ss-ssb")
+    mismatched = [mode for mode, result in results.items() if result != reference]
+    if failed or mismatched:
+        print(f"\nFAILED: {', '.join(failed + mismatched)}")
+        return 1
+    print("\nAll summaries match")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
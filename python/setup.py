@@ -2,13 +2,31 @@
 SerialSniffer Analysis Suite Setup
 """
 
-from setuptools import setup, find_packages
+from setuptools import setup, find_packages, Extension
 from pathlib import Path
 
 # Read the README file
 readme_file = Path(__file__).parent.parent / "README.md"
 long_description = readme_file.read_text() if readme_file.exists() else ""
 
+# Capture reader extension: shares the capture format headers with the
+# firmware and the host tools
+repo_root = Path(__file__).resolve().parent.parent
+capture_module = Extension(
+    "ss_capture",
+    sources=["ss_capture.cpp"],
+    depends=[str(repo_root / "host" / "lib" / name)
+             for name in ("CaptureMap.h", "CaptureAnalysis.h", "TimeIndex.h", "WorkStealingPool.h",
+                          "HexFormat.h", "CsvFormat.h", "CaptureReader.h", "PacketAssembler.h")] +
+            [str(repo_root / "firmware" / "SerialSniffer" / name)
+             for name in ("CaptureFormat.h", "CaptureCsv.h", "CaptureIndex.h", "BlockCompressor.h",
+                          "ChecksumEngine.h")],
+    include_dirs=[str(repo_root / "firmware" / "SerialSniffer"), str(repo_root / "host" / "lib")],
+    extra_compile_args=["-std=c++17", "-O2", "-pthread"],
+    extra_link_args=["-pthread"],
+    language="c++",
+)
+
 setup(
     name="serialsniffer-analysis",
     version="0.1.0",
@@ -19,6 +37,7 @@ setup(
     url="https://github.com/nicholasHespe/SerialSniffer",
     packages=find_packages(),
     py_modules=["SerialSnifferAnalysis"],
+    ext_modules=[capture_module],
     install_requires=[
         "pandas>=2.0.0",
         "numpy>=1.24.0",
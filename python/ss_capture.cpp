@@ -0,0 +1,746 @@
+/*
+ * ss_capture - Python extension for reading SerialSniffer captures
+ *
+ * Wraps CaptureMap (host/lib/CaptureMap.h): a capture file, binary or
+ * CSV, is memory-mapped and decoded a chunk at a time into columns. Each
+ * column supports the buffer protocol, so numpy.frombuffer() views it
+ * without a copy; the chunk's memory lives as long as any view of it.
+ *
+ *   capture = ss_capture.CaptureFile("capture_0.ssb")
+ *   while (chunk := capture.read(1 << 20)) is not None:
+ *       values = numpy.frombuffer(chunk.value, dtype=numpy.uint8)
+ *
+ * Decoding runs without the GIL. CaptureFile.select() narrows reading to
+ * a time window through the time index (TimeIndex.h), so only the bytes
+ * around the window are decoded. analyze() runs the multithreaded
+ * whole-capture (or window) pass of CaptureAnalysis.h and returns its
+ * results as a dict; time_index() reports on or rebuilds the index.
+ * CaptureFile.export() streams the records (of the selection) straight to
+ * a CSV or hex dump file through the vectorized formatters of
+ * HexFormat.h. Also exposes the firmware's checksum kernels
+ * (ChecksumEngine.h) and the format constants.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "CaptureAnalysis.h"
+#include "CaptureMap.h"
+#include "ChecksumEngine.h"
+#include "HexFormat.h"
+#include "TimeIndex.h"
+
+// Records decoded per step of CaptureFile.export()
+const size_t EXPORT_CHUNK_RECORDS = 1 << 16;
+
+// ==================== Column ====================
+
+/**
+ * One field of a chunk, exported through the buffer protocol
+ */
+struct ColumnObject {
+  PyObject_HEAD
+  PyObject* owner;                // Chunk holding the memory
+  void* data;
+  Py_ssize_t count;
+  Py_ssize_t itemSize;
+  const char* format;             // struct module code ("Q", "B")
+};
+
+static void columnDealloc(ColumnObject* self) {
+  Py_XDECREF(self->owner);
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int columnGetBuffer(ColumnObject* self, Py_buffer* view, int flags) {
+  if (flags & PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "capture columns are read-only");
+    return -1;
+  }
+  view->obj = (PyObject*)self;
+  Py_INCREF(self);
+  view->buf = self->data;
+  view->len = self->count * self->itemSize;
+  view->readonly = 1;
+  view->itemsize = self->itemSize;
+  view->format = (flags & PyBUF_FORMAT) ? (char*)self->format : nullptr;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) ? &self->count : nullptr;
+  view->strides = (flags & PyBUF_STRIDES) ? &self->itemSize : nullptr;
+  view->suboffsets = nullptr;
+  view->internal = nullptr;
+  return 0;
+}
+
+static Py_ssize_t columnLength(ColumnObject* self) { return self->count; }
+
+static PyBufferProcs columnBuffer = {(getbufferproc)columnGetBuffer, nullptr};
+
+static PySequenceMethods columnSequence = {(lenfunc)columnLength};
+
+static PyTypeObject ColumnType = {PyVarObject_HEAD_INIT(nullptr, 0) "ss_capture.Column"};
+
+// ==================== Chunk ====================
+
+struct ChunkObject {
+  PyObject_HEAD
+  CaptureColumns* columns;
+};
+
+static void chunkDealloc(ChunkObject* self) {
+  delete self->columns;
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static Py_ssize_t chunkLength(ChunkObject* self) { return (Py_ssize_t)self->columns->count; }
+
+static PyObject* makeColumn(ChunkObject* chunk, void* data, Py_ssize_t itemSize, const char* format) {
+  ColumnObject* column = PyObject_New(ColumnObject, &ColumnType);
+  if (!column) return nullptr;
+  Py_INCREF(chunk);
+  column->owner = (PyObject*)chunk;
+  column->data = data;
+  column->count = (Py_ssize_t)chunk->columns->count;
+  column->itemSize = itemSize;
+  column->format = format;
+  return (PyObject*)column;
+}
+
+static PyObject* chunkTimestamps(ChunkObject* self, void*) {
+  return makeColumn(self, self->columns->timestampNs.get(), 8, "Q");
+}
+static PyObject* chunkArguments(ChunkObject* self, void*) {
+  return makeColumn(self, self->columns->argument.get(), 8, "Q");
+}
+static PyObject* chunkKinds(ChunkObject* self, void*) {
+  return makeColumn(self, self->columns->kind.get(), 1, "B");
+}
+static PyObject* chunkChannels(ChunkObject* self, void*) {
+  return makeColumn(self, self->columns->channel.get(), 1, "B");
+}
+static PyObject* chunkValues(ChunkObject* self, void*) {
+  return makeColumn(self, self->columns->value.get(), 1, "B");
+}
+static PyObject* chunkStatuses(ChunkObject* self, void*) {
+  return makeColumn(self, self->columns->status.get(), 1, "B");
+}
+
+static PyGetSetDef chunkGetSet[] = {
+  {"timestamp_ns", (getter)chunkTimestamps, nullptr, "Nanoseconds since capture start (uint64)", nullptr},
+  {"argument", (getter)chunkArguments, nullptr, "Event argument, 0 for data (uint64)", nullptr},
+  {"kind", (getter)chunkKinds, nullptr, "Record kind (uint8)", nullptr},
+  {"channel", (getter)chunkChannels, nullptr, "Channel id (uint8)", nullptr},
+  {"value", (getter)chunkValues, nullptr, "Byte value, or the event's value (uint8)", nullptr},
+  {"status", (getter)chunkStatuses, nullptr, "Status flags (uint8)", nullptr},
+  {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+static PySequenceMethods chunkSequence = {(lenfunc)chunkLength};
+
+static PyTypeObject ChunkType = {PyVarObject_HEAD_INIT(nullptr, 0) "ss_capture.Chunk"};
+
+// ==================== Capture File ====================
+
+struct CaptureFileObject {
+  PyObject_HEAD
+  CaptureMap* map;
+  TimeIndex* index;               // Loaded or built by the first select()
+  std::string* path;
+};
+
+static void captureFileDealloc(CaptureFileObject* self) {
+  delete self->map;
+  delete self->index;
+  delete self->path;
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int captureFileInit(CaptureFileObject* self, PyObject* args, PyObject*) {
+  PyObject* pathObject;
+  if (!PyArg_ParseTuple(args, "O&", PyUnicode_FSConverter, &pathObject)) return -1;
+  std::string path(PyBytes_AS_STRING(pathObject));
+  Py_DECREF(pathObject);
+
+  delete self->map;
+  delete self->index;
+  delete self->path;
+  self->map = new CaptureMap();
+  self->index = nullptr;
+  self->path = new std::string(path);
+  bool ok;
+  Py_BEGIN_ALLOW_THREADS
+  ok = self->map->open(path);
+  Py_END_ALLOW_THREADS
+  if (!ok) {
+    PyErr_SetString(PyExc_OSError, self->map->error().c_str());
+    return -1;
+  }
+  return 0;
+}
+
+static PyObject* captureFileRead(CaptureFileObject* self, PyObject* args) {
+  Py_ssize_t records = 1 << 20;
+  if (!PyArg_ParseTuple(args, "|n", &records)) return nullptr;
+  if (records <= 0) {
+    PyErr_SetString(PyExc_ValueError, "records must be positive");
+    return nullptr;
+  }
+  if (!self->map) {
+    PyErr_SetString(PyExc_ValueError, "capture file not open");
+    return nullptr;
+  }
+
+  ChunkObject* chunk = PyObject_New(ChunkObject, &ChunkType);
+  if (!chunk) return nullptr;
+  chunk->columns = nullptr;
+  size_t count = 0;
+  try {
+    chunk->columns = new CaptureColumns();
+    chunk->columns->allocate((size_t)records);
+  } catch (const std::bad_alloc&) {
+    Py_DECREF(chunk);
+    return PyErr_NoMemory();
+  }
+  Py_BEGIN_ALLOW_THREADS
+  count = self->map->read(*chunk->columns);
+  Py_END_ALLOW_THREADS
+  if (count == 0) {
+    Py_DECREF(chunk);
+    Py_RETURN_NONE;
+  }
+  return (PyObject*)chunk;
+}
+
+static PyObject* captureFileRewind(CaptureFileObject* self, PyObject*) {
+  if (self->map) self->map->rewind();
+  Py_RETURN_NONE;
+}
+
+static PyObject* captureFileSelect(CaptureFileObject* self, PyObject* args, PyObject* keywords) {
+  static const char* names[] = {"start_ns", "end_ns", nullptr};
+  unsigned long long startNs = 0;
+  PyObject* endObject = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, keywords, "|KO", (char**)names, &startNs, &endObject)) return nullptr;
+  unsigned long long endNs = UINT64_MAX;
+  if (endObject != Py_None) {
+    endNs = PyLong_AsUnsignedLongLong(endObject);
+    if (PyErr_Occurred()) return nullptr;
+  }
+  if (!self->map) {
+    PyErr_SetString(PyExc_ValueError, "capture file not open");
+    return nullptr;
+  }
+  CaptureRange range;
+  Py_BEGIN_ALLOW_THREADS
+  if (!self->index) {
+    self->index = new TimeIndex();
+    self->index->open(*self->path, *self->map);
+  }
+  range = self->index->range(*self->map, startNs, endNs);
+  self->map->select(range, startNs, endNs);
+  Py_END_ALLOW_THREADS
+  return Py_BuildValue("(nn)", (Py_ssize_t)self->map->selection().begin, (Py_ssize_t)self->map->selection().end);
+}
+
+static PyObject* captureFileExport(CaptureFileObject* self, PyObject* args, PyObject* keywords) {
+  static const char* names[] = {"path", "format", "channel", "kernel", nullptr};
+  PyObject* pathObject;
+  const char* format = "csv";
+  int channel = -1;
+  const char* kernelName = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(args, keywords, "O&|siz", (char**)names, PyUnicode_FSConverter, &pathObject,
+                                   &format, &channel, &kernelName)) {
+    return nullptr;
+  }
+  std::string path(PyBytes_AS_STRING(pathObject));
+  Py_DECREF(pathObject);
+  bool hexdump = std::strcmp(format, "hexdump") == 0;
+  if (!hexdump && std::strcmp(format, "csv") != 0) {
+    PyErr_SetString(PyExc_ValueError, "format must be 'csv' or 'hexdump'");
+    return nullptr;
+  }
+  if (channel > 255) {
+    PyErr_SetString(PyExc_ValueError, "channel must be 0-255, or negative for all");
+    return nullptr;
+  }
+  FormatKernel kernel = bestFormatKernel();
+  if (kernelName && (!parseFormatKernel(kernelName, kernel) || !formatKernelSupported(kernel))) {
+    PyErr_Format(PyExc_ValueError, "kernel '%s' is unknown or not supported by this CPU", kernelName);
+    return nullptr;
+  }
+  if (!self->map) {
+    PyErr_SetString(PyExc_ValueError, "capture file not open");
+    return nullptr;
+  }
+
+  std::FILE* out = std::fopen(path.c_str(), "wb");
+  if (!out) return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path.c_str());
+  uint64_t records = 0;
+  bool written;
+  try {
+    CaptureColumns columns;
+    columns.allocate(EXPORT_CHUNK_RECORDS);
+    TextOutput output(out);
+    CsvExporter csv(output, kernel);
+    HexDumper dump(output, channel < 0, kernel);
+    Py_BEGIN_ALLOW_THREADS
+    if (!hexdump) csv.writeHeader();
+    self->map->rewind();
+    size_t count;
+    while ((count = self->map->read(columns)) > 0) {
+      const uint8_t* kinds = columns.kind.get();
+      const uint8_t* channels = columns.channel.get();
+      const uint8_t* values = columns.value.get();
+      for (size_t i = 0; i < count; i++) {
+        if (kinds[i] != RECORD_KIND_DATA || (channel >= 0 && channels[i] != channel)) continue;
+        if (hexdump) {
+          // Runs of one channel's bytes go in whole
+          size_t end = i + 1;
+          while (end < count && kinds[end] == RECORD_KIND_DATA && channels[end] == channels[i]) end++;
+          dump.add(channels[i], values + i, end - i);
+          records += end - i;
+          i = end - 1;
+        } else {
+          csv.add(columns.timestampNs[i], channels[i], values[i], columns.status[i]);
+          records++;
+        }
+      }
+    }
+    if (hexdump) dump.finish();
+    csv.flush();
+    written = output.flush();
+    Py_END_ALLOW_THREADS
+  } catch (const std::bad_alloc&) {
+    std::fclose(out);
+    return PyErr_NoMemory();
+  }
+  written &= std::fclose(out) == 0;
+  if (!written) return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path.c_str());
+  return PyLong_FromUnsignedLongLong(records);
+}
+
+static const char* indexSourceName(TimeIndex::Source source) {
+  switch (source) {
+    case TimeIndex::SOURCE_SIDECAR: return "sidecar";
+    case TimeIndex::SOURCE_REBUILT: return "rebuilt";
+    default: return nullptr;
+  }
+}
+
+static PyObject* captureFileIndex(CaptureFileObject* self, void*) {
+  const char* name = self->index ? indexSourceName(self->index->source()) : nullptr;
+  if (!name) Py_RETURN_NONE;
+  return PyUnicode_FromString(name);
+}
+
+static PyObject* captureFileType(CaptureFileObject* self, void*) {
+  return PyUnicode_FromString(self->map->type() == CAPTURE_FILE_CSV ? "csv" : "binary");
+}
+static PyObject* captureFileBaud(CaptureFileObject* self, void*) {
+  return PyLong_FromUnsignedLong(self->map->header().baudRate);
+}
+static PyObject* captureFileTimestampHz(CaptureFileObject* self, void*) {
+  return PyLong_FromUnsignedLong(self->map->header().timestampHz);
+}
+static PyObject* captureFileStartTime(CaptureFileObject* self, void*) {
+  return PyLong_FromUnsignedLong(self->map->header().startTime);
+}
+static PyObject* captureFileVersion(CaptureFileObject* self, void*) {
+  return PyLong_FromUnsignedLong(self->map->header().version);
+}
+static PyObject* captureFileFirmware(CaptureFileObject* self, void*) {
+  const char* text = self->map->header().firmwareVersion;
+  return PyUnicode_DecodeLatin1(text, strnlen(text, CAPTURE_VERSION_STRING_SIZE), nullptr);
+}
+static PyObject* captureFileSize(CaptureFileObject* self, void*) {
+  return PyLong_FromSize_t(self->map->size());
+}
+static PyObject* captureFilePosition(CaptureFileObject* self, void*) {
+  return PyLong_FromSize_t(self->map->position());
+}
+static PyObject* captureFileMalformed(CaptureFileObject* self, void*) {
+  return PyLong_FromUnsignedLongLong(self->map->malformedLines());
+}
+static PyObject* captureFileCompressed(CaptureFileObject* self, void*) {
+  return PyBool_FromLong(self->map->type() == CAPTURE_FILE_BINARY &&
+                         self->map->header().recordFormat == RECORD_FORMAT_BLOCKS);
+}
+static PyObject* captureFileDamaged(CaptureFileObject* self, void*) {
+  return PyLong_FromUnsignedLongLong(self->map->damagedBlocks());
+}
+
+static PyMethodDef captureFileMethods[] = {
+  {"read", (PyCFunction)captureFileRead, METH_VARARGS,
+   "read(records=1048576) -> Chunk of up to `records` records, or None at the end"},
+  {"rewind", (PyCFunction)captureFileRewind, METH_NOARGS, "Start over from the first record (of the selection)"},
+  {"select", (PyCFunction)(void (*)(void))captureFileSelect, METH_VARARGS | METH_KEYWORDS,
+   "select(start_ns=0, end_ns=None) -> (begin, end) byte range\n"
+   "Read only records stamped in [start_ns, end_ns] from now on, seeking with the time index"},
+  {"export", (PyCFunction)(void (*)(void))captureFileExport, METH_VARARGS | METH_KEYWORDS,
+   "export(path, format='csv', channel=-1, kernel=None) -> data bytes written\n"
+   "Write the data bytes (of the selection, from its start) as ss_convert does: CSV lines, or with\n"
+   "format='hexdump' a hex dump per channel (channel >= 0: that channel only, laid out like hexdump -C).\n"
+   "kernel ('scalar', 'ssse3', 'avx2') overrides the fastest formatter this CPU runs"},
+  {nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef captureFileGetSet[] = {
+  {"type", (getter)captureFileType, nullptr, "'binary' or 'csv'", nullptr},
+  {"baud", (getter)captureFileBaud, nullptr, "Baud rate from the header (0 for CSV)", nullptr},
+  {"timestamp_hz", (getter)captureFileTimestampHz, nullptr, "Tick rate of the recorded times", nullptr},
+  {"start_time", (getter)captureFileStartTime, nullptr, "RTC start time, seconds since 1970 (0 if unset)", nullptr},
+  {"version", (getter)captureFileVersion, nullptr, "Binary format version (0 for CSV)", nullptr},
+  {"firmware", (getter)captureFileFirmware, nullptr, "Firmware version string", nullptr},
+  {"size", (getter)captureFileSize, nullptr, "File size in bytes", nullptr},
+  {"position", (getter)captureFilePosition, nullptr, "Bytes decoded so far", nullptr},
+  {"malformed_lines", (getter)captureFileMalformed, nullptr, "CSV lines that could not be parsed", nullptr},
+  {"compressed", (getter)captureFileCompressed, nullptr, "Records are in LZ4-compressed blocks", nullptr},
+  {"damaged_blocks", (getter)captureFileDamaged, nullptr, "Compressed blocks skipped as damaged or cut off", nullptr},
+  {"index", (getter)captureFileIndex, nullptr, "Time index used by select(): 'sidecar', 'rebuilt' or None", nullptr},
+  {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+static PyTypeObject CaptureFileType = {PyVarObject_HEAD_INIT(nullptr, 0) "ss_capture.CaptureFile"};
+
+// ==================== Module ====================
+
+static PyObject* moduleChecksum(PyObject*, PyObject* args) {
+  int algorithm;
+  Py_buffer data;
+  if (!PyArg_ParseTuple(args, "iy*", &algorithm, &data)) return nullptr;
+  if (algorithm <= CHECKSUM_NONE || algorithm >= CHECKSUM_ALGORITHM_COUNT) {
+    PyBuffer_Release(&data);
+    PyErr_SetString(PyExc_ValueError, "unknown checksum algorithm");
+    return nullptr;
+  }
+  uint32_t value = computeChecksum((uint8_t)algorithm, (const uint8_t*)data.buf, (uint32_t)data.len);
+  PyBuffer_Release(&data);
+  return PyLong_FromUnsignedLong(value);
+}
+
+static PyObject* moduleChecksumWidth(PyObject*, PyObject* args) {
+  int algorithm;
+  if (!PyArg_ParseTuple(args, "i", &algorithm)) return nullptr;
+  return PyLong_FromUnsignedLong(checksumWidth((uint8_t)algorithm));
+}
+
+// Steals value; false (with the exception set) if value is null or insertion fails
+static bool setItem(PyObject* dict, const char* key, PyObject* value) {
+  if (!value) return false;
+  int failed = PyDict_SetItemString(dict, key, value);
+  Py_DECREF(value);
+  return failed == 0;
+}
+
+static PyObject* countList(const uint64_t* counts, size_t count) {
+  PyObject* list = PyList_New((Py_ssize_t)count);
+  if (!list) return nullptr;
+  for (size_t i = 0; i < count; i++) PyList_SET_ITEM(list, i, PyLong_FromUnsignedLongLong(counts[i]));
+  return list;
+}
+
+static PyObject* channelDict(const ChannelAnalysis& c) {
+  PyObject* dict = PyDict_New();
+  if (!dict) return nullptr;
+  bool ok = setItem(dict, "bytes", PyLong_FromUnsignedLongLong(c.bytes)) &&
+            setItem(dict, "overflow", PyLong_FromUnsignedLongLong(c.overflow)) &&
+            setItem(dict, "framing", PyLong_FromUnsignedLongLong(c.framingErrors)) &&
+            setItem(dict, "parity", PyLong_FromUnsignedLongLong(c.parityErrors)) &&
+            setItem(dict, "value_sum", PyLong_FromUnsignedLongLong(c.valueSum)) &&
+            setItem(dict, "packets", PyLong_FromUnsignedLongLong(c.packets)) &&
+            setItem(dict, "checksum_valid", PyLong_FromUnsignedLongLong(c.checksumValid)) &&
+            setItem(dict, "checksum_error", PyLong_FromUnsignedLongLong(c.checksumError)) &&
+            setItem(dict, "end_reasons", countList(c.endReasons, 4)) &&
+            setItem(dict, "lengths", countList(c.lengths.data(), c.lengths.size())) &&
+            setItem(dict, "length_min", PyLong_FromUnsignedLongLong(c.packets ? c.lengthMin : 0)) &&
+            setItem(dict, "length_max", PyLong_FromUnsignedLongLong(c.lengthMax)) &&
+            setItem(dict, "length_sum", PyLong_FromUnsignedLongLong(c.lengthSum)) &&
+            setItem(dict, "durations", PyLong_FromUnsignedLongLong(c.durations)) &&
+            setItem(dict, "duration_sum_ns", PyLong_FromUnsignedLongLong(c.durationSumNs)) &&
+            setItem(dict, "duration_max_ns", PyLong_FromUnsignedLongLong(c.durationMaxNs)) &&
+            setItem(dict, "gaps", countList(c.gaps, ANALYSIS_GAP_BINS)) &&
+            setItem(dict, "gap_count", PyLong_FromUnsignedLongLong(c.gapCount)) &&
+            setItem(dict, "gap_min_ns", PyLong_FromUnsignedLongLong(c.gapCount ? c.gapMinNs : 0)) &&
+            setItem(dict, "gap_max_ns", PyLong_FromUnsignedLongLong(c.gapMaxNs)) &&
+            setItem(dict, "rate_first_bin", PyLong_FromUnsignedLongLong(c.rate.first)) &&
+            setItem(dict, "rate", countList(c.rate.counts.data(), c.rate.counts.size()));
+  if (!ok) {
+    Py_DECREF(dict);
+    return nullptr;
+  }
+  return dict;
+}
+
+static PyObject* moduleAnalyze(PyObject*, PyObject* args, PyObject* keywords) {
+  static const char* names[] = {"path", "threads", "chunk_bytes", "framing", "gap_ns", "rate_bin_ns",
+                                "start_ns", "end_ns", nullptr};
+  const char* path;
+  unsigned threads = 0;
+  unsigned long long chunkBytes = 0;
+  const char* framing = nullptr;
+  unsigned long long gapNs = 0;
+  unsigned long long rateBinNs = 0;
+  unsigned long long startNs = 0;
+  PyObject* endObject = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, keywords, "s|IKzKKKO", (char**)names, &path, &threads, &chunkBytes,
+                                   &framing, &gapNs, &rateBinNs, &startNs, &endObject)) {
+    return nullptr;
+  }
+  AnalysisOptions options;
+  options.startNs = startNs;
+  if (endObject != Py_None) {
+    options.endNs = PyLong_AsUnsignedLongLong(endObject);
+    if (PyErr_Occurred()) return nullptr;
+  }
+  options.threads = threads;
+  if (chunkBytes) options.chunkBytes = (size_t)chunkBytes;
+  options.gapNs = gapNs;
+  if (rateBinNs) options.rateBinNs = rateBinNs;
+  if (framing && std::strcmp(framing, "records") == 0) {
+    options.framing = ANALYSIS_FRAMING_RECORDS;
+  } else if (framing && std::strcmp(framing, "idle") == 0) {
+    options.framing = ANALYSIS_FRAMING_IDLE;
+  } else if (framing) {
+    PyErr_SetString(PyExc_ValueError, "framing must be 'records', 'idle' or None");
+    return nullptr;
+  }
+
+  CaptureAnalyzer analyzer(options);
+  CaptureAnalysis result;
+  bool ok;
+  Py_BEGIN_ALLOW_THREADS
+  ok = analyzer.run(path, result);
+  Py_END_ALLOW_THREADS
+  if (!ok) {
+    PyErr_SetString(PyExc_OSError, analyzer.error().c_str());
+    return nullptr;
+  }
+
+  PyObject* channels = PyDict_New();
+  if (!channels) return nullptr;
+  for (uint8_t channel = 0; channel < MAX_CAPTURE_CHANNELS; channel++) {
+    const ChannelAnalysis& c = result.channels[channel];
+    if (c.bytes == 0 && c.packets == 0) continue;
+    PyObject* key = PyLong_FromLong(channel);
+    PyObject* value = channelDict(c);
+    if (!key || !value || PyDict_SetItem(channels, key, value) != 0) {
+      Py_XDECREF(key);
+      Py_XDECREF(value);
+      Py_DECREF(channels);
+      return nullptr;
+    }
+    Py_DECREF(key);
+    Py_DECREF(value);
+  }
+  PyObject* changes = PyList_New((Py_ssize_t)result.baudChanges.size());
+  if (!changes) {
+    Py_DECREF(channels);
+    return nullptr;
+  }
+  for (size_t i = 0; i < result.baudChanges.size(); i++) {
+    const BaudChangeEvent& change = result.baudChanges[i];
+    PyList_SET_ITEM(changes, i, Py_BuildValue("(KiI)", (unsigned long long)change.timestampNs,
+                                              (int)change.channel, (unsigned)change.baudRate));
+  }
+
+  PyObject* dict = PyDict_New();
+  if (!dict || !setItem(dict, "channels", channels)) {
+    Py_XDECREF(dict);
+    Py_DECREF(changes);
+    return nullptr;
+  }
+  PyObject* firstNs = Py_None;
+  if (result.records) firstNs = PyLong_FromUnsignedLongLong(result.firstNs);
+  else Py_INCREF(Py_None);
+  const char* indexName = indexSourceName(result.index);
+  PyObject* index = indexName ? PyUnicode_FromString(indexName) : Py_None;
+  if (!indexName) Py_INCREF(Py_None);
+  ok = setItem(dict, "baud_changes", changes) &&
+       setItem(dict, "framing", PyUnicode_FromString(result.framing == ANALYSIS_FRAMING_IDLE ? "idle" : "records")) &&
+       setItem(dict, "gap_ns", PyLong_FromUnsignedLongLong(result.gapNs)) &&
+       setItem(dict, "rate_bin_ns", PyLong_FromUnsignedLongLong(result.rateBinNs)) &&
+       setItem(dict, "records", PyLong_FromUnsignedLongLong(result.records)) &&
+       setItem(dict, "first_ns", firstNs) &&
+       setItem(dict, "last_ns", PyLong_FromUnsignedLongLong(result.lastNs)) &&
+       setItem(dict, "malformed_lines", PyLong_FromUnsignedLongLong(result.malformedLines)) &&
+       setItem(dict, "damaged_blocks", PyLong_FromUnsignedLongLong(result.damagedBlocks)) &&
+       setItem(dict, "input_bytes", PyLong_FromUnsignedLongLong(result.inputBytes)) &&
+       setItem(dict, "file_bytes", PyLong_FromUnsignedLongLong(result.fileBytes)) &&
+       setItem(dict, "index", index) &&
+       setItem(dict, "seconds", PyFloat_FromDouble(result.seconds)) &&
+       setItem(dict, "threads", PyLong_FromUnsignedLong(result.threads)) &&
+       setItem(dict, "chunks", PyLong_FromSize_t(result.chunks)) &&
+       setItem(dict, "steals", PyLong_FromUnsignedLongLong(result.steals));
+  if (!ok) {
+    Py_DECREF(dict);
+    return nullptr;
+  }
+  return dict;
+}
+
+static PyObject* moduleTimeIndex(PyObject*, PyObject* args, PyObject* keywords) {
+  static const char* names[] = {"path", "rebuild", nullptr};
+  const char* path;
+  int rebuild = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, keywords, "s|p", (char**)names, &path, &rebuild)) return nullptr;
+
+  CaptureMap map;
+  TimeIndex index;
+  std::string sidecar = TimeIndex::sidecarPath(path);
+  bool ok;
+  bool saved = true;
+  auto begin = std::chrono::steady_clock::now();
+  Py_BEGIN_ALLOW_THREADS
+  ok = map.open(path);
+  if (ok && rebuild) {
+    index.build(map);
+    saved = index.save(sidecar);
+  } else if (ok) {
+    index.open(path, map);
+  }
+  Py_END_ALLOW_THREADS
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  if (!ok || !saved) {
+    PyErr_SetString(PyExc_OSError, ok ? index.error().c_str() : map.error().c_str());
+    return nullptr;
+  }
+
+  const CaptureIndexHeader& header = index.header();
+  PyObject* firstNs = Py_None;
+  PyObject* lastNs = Py_None;
+  if (index.size() > 0) {
+    firstNs = PyLong_FromUnsignedLongLong(index.entryNs(index.entries().front()));
+    lastNs = PyLong_FromUnsignedLongLong(index.entryNs(index.entries().back()));
+  } else {
+    Py_INCREF(Py_None);
+    Py_INCREF(Py_None);
+  }
+  PyObject* dict = PyDict_New();
+  if (!dict) {
+    Py_DECREF(firstNs);
+    Py_DECREF(lastNs);
+    return nullptr;
+  }
+  ok = setItem(dict, "source", PyUnicode_FromString(indexSourceName(index.source()))) &&
+       setItem(dict, "sidecar", PyUnicode_DecodeFSDefault(sidecar.c_str())) &&
+       setItem(dict, "entries", PyLong_FromSize_t(index.size())) &&
+       setItem(dict, "timestamp_hz", PyLong_FromUnsignedLong(header.timestampHz)) &&
+       setItem(dict, "interval_records", PyLong_FromUnsignedLong(header.intervalRecords)) &&
+       setItem(dict, "interval_ms", PyLong_FromUnsignedLong(header.intervalMs)) &&
+       setItem(dict, "first_ns", firstNs) &&
+       setItem(dict, "last_ns", lastNs) &&
+       setItem(dict, "file_bytes", PyLong_FromSize_t(map.size())) &&
+       setItem(dict, "seconds", PyFloat_FromDouble(seconds));
+  if (!ok) {
+    Py_DECREF(dict);
+    return nullptr;
+  }
+  return dict;
+}
+
+static PyMethodDef moduleMethods[] = {
+  {"checksum", moduleChecksum, METH_VARARGS,
+   "checksum(algorithm, data) -> value of a CHECKSUM_* algorithm over a bytes-like object"},
+  {"checksum_width", moduleChecksumWidth, METH_VARARGS, "checksum_width(algorithm) -> bytes"},
+  {"analyze", (PyCFunction)(void (*)(void))moduleAnalyze, METH_VARARGS | METH_KEYWORDS,
+   "analyze(path, threads=0, chunk_bytes=0, framing=None, gap_ns=0, rate_bin_ns=0, start_ns=0, end_ns=None)"
+   " -> dict\nWhole-capture (or time window) statistics and packet analysis on a thread pool (0: defaults)"},
+  {"time_index", (PyCFunction)(void (*)(void))moduleTimeIndex, METH_VARARGS | METH_KEYWORDS,
+   "time_index(path, rebuild=False) -> dict\n"
+   "The capture's time index (its .ssi sidecar, else built in memory); rebuild writes a new sidecar"},
+  {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef moduleDef = {PyModuleDef_HEAD_INIT, "ss_capture",
+                                "Memory-mapped SerialSniffer capture reader", -1, moduleMethods};
+
+static bool addNames(PyObject* module, const char* attribute, uint32_t count, const char* (*name)(uint8_t)) {
+  PyObject* names = PyTuple_New(count);
+  if (!names) return false;
+  for (uint32_t i = 0; i < count; i++) PyTuple_SET_ITEM(names, i, PyUnicode_FromString(name((uint8_t)i)));
+  return PyModule_AddObject(module, attribute, names) == 0;
+}
+
+/**
+ * METRIC_NAMES: name of each metric id (the value of METRIC records),
+ * empty for unused ids
+ */
+static bool addMetricNames(PyObject* module) {
+  PyObject* names = PyTuple_New(256);
+  if (!names) return false;
+  char name[24];
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t length = formatMetricName(name, (uint8_t)i);
+    PyTuple_SET_ITEM(names, i, PyUnicode_FromStringAndSize(name, length));
+  }
+  return PyModule_AddObject(module, "METRIC_NAMES", names) == 0;
+}
+
+PyMODINIT_FUNC PyInit_ss_capture(void) {
+  ColumnType.tp_basicsize = sizeof(ColumnObject);
+  ColumnType.tp_dealloc = (destructor)columnDealloc;
+  ColumnType.tp_flags = Py_TPFLAGS_DEFAULT;
+  ColumnType.tp_doc = "One column of a chunk (buffer protocol; use numpy.frombuffer)";
+  ColumnType.tp_as_buffer = &columnBuffer;
+  ColumnType.tp_as_sequence = &columnSequence;
+
+  ChunkType.tp_basicsize = sizeof(ChunkObject);
+  ChunkType.tp_dealloc = (destructor)chunkDealloc;
+  ChunkType.tp_flags = Py_TPFLAGS_DEFAULT;
+  ChunkType.tp_doc = "Decoded records, one Column per field";
+  ChunkType.tp_getset = chunkGetSet;
+  ChunkType.tp_as_sequence = &chunkSequence;
+
+  CaptureFileType.tp_basicsize = sizeof(CaptureFileObject);
+  CaptureFileType.tp_dealloc = (destructor)captureFileDealloc;
+  CaptureFileType.tp_flags = Py_TPFLAGS_DEFAULT;
+  CaptureFileType.tp_doc = "CaptureFile(path): memory-mapped binary (.ssb) or CSV capture";
+  CaptureFileType.tp_init = (initproc)captureFileInit;
+  CaptureFileType.tp_new = PyType_GenericNew;
+  CaptureFileType.tp_methods = captureFileMethods;
+  CaptureFileType.tp_getset = captureFileGetSet;
+
+  if (PyType_Ready(&ColumnType) < 0 || PyType_Ready(&ChunkType) < 0 ||
+      PyType_Ready(&CaptureFileType) < 0) {
+    return nullptr;
+  }
+
+  PyObject* module = PyModule_Create(&moduleDef);
+  if (!module) return nullptr;
+  Py_INCREF(&CaptureFileType);
+  PyModule_AddObject(module, "CaptureFile", (PyObject*)&CaptureFileType);
+
+  PyModule_AddIntConstant(module, "RECORD_KIND_DATA", RECORD_KIND_DATA);
+  PyModule_AddIntConstant(module, "RECORD_KIND_BAUD_CHANGE", RECORD_KIND_BAUD_CHANGE);
+  PyModule_AddIntConstant(module, "RECORD_KIND_PACKET_START", RECORD_KIND_PACKET_START);
+  PyModule_AddIntConstant(module, "RECORD_KIND_PACKET_END", RECORD_KIND_PACKET_END);
+  PyModule_AddIntConstant(module, "RECORD_KIND_CHECKSUM", RECORD_KIND_CHECKSUM);
+  PyModule_AddIntConstant(module, "RECORD_KIND_METRIC", RECORD_KIND_METRIC);
+  PyModule_AddIntConstant(module, "STATUS_OVERFLOW", STATUS_OVERFLOW);
+  PyModule_AddIntConstant(module, "STATUS_FRAMING_ERROR", STATUS_FRAMING_ERROR);
+  PyModule_AddIntConstant(module, "STATUS_PARITY_ERROR", STATUS_PARITY_ERROR);
+  PyModule_AddIntConstant(module, "STATUS_CHECKSUM_VALID", STATUS_CHECKSUM_VALID);
+  PyModule_AddIntConstant(module, "STATUS_CHECKSUM_ERROR", STATUS_CHECKSUM_ERROR);
+  PyModule_AddIntConstant(module, "CHECKSUM_XOR8", CHECKSUM_XOR8);
+  PyModule_AddIntConstant(module, "CHECKSUM_SUM8", CHECKSUM_SUM8);
+  PyModule_AddIntConstant(module, "CHECKSUM_CRC8", CHECKSUM_CRC8);
+  PyModule_AddIntConstant(module, "CHECKSUM_CRC16_MODBUS", CHECKSUM_CRC16_MODBUS);
+  PyModule_AddIntConstant(module, "CHECKSUM_CRC16_CCITT", CHECKSUM_CRC16_CCITT);
+  PyModule_AddIntConstant(module, "MAX_CHANNELS", MAX_CAPTURE_CHANNELS);
+  PyModule_AddIntConstant(module, "ANALYSIS_LENGTH_BINS", ANALYSIS_LENGTH_BINS);
+  PyModule_AddStringConstant(module, "FORMAT_KERNEL", formatKernelName(bestFormatKernel()));
+
+  if (!addNames(module, "CHANNEL_NAMES", MAX_CAPTURE_CHANNELS, captureChannelName) ||
+      !addNames(module, "KIND_NAMES", RECORD_KIND_METRIC + 1, recordKindName) ||
+      !addNames(module, "PACKET_END_REASONS", PACKET_END_STOP + 1, packetEndReasonName) ||
+      !addNames(module, "CHECKSUM_ALGORITHMS", CHECKSUM_ALGORITHM_COUNT, checksumAlgorithmName) ||
+      !addNames(module, "PIPELINE_STAGES", PIPELINE_STAGE_COUNT, pipelineStageName) ||
+      !addMetricNames(module)) {
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
@@ -0,0 +1,241 @@
+/*
+ * SerialSniffer - Background Baud Detection
+ *
+ * Incremental state machine around BaudEstimator. Edges arrive from the
+ * edge interrupt (edge()); the main loop calls poll() every pass, which
+ * returns at once unless a solve is due or under way, and then does one
+ * solve step (one candidate period). Nothing waits, so commands and
+ * capture keep running while a rate is found, and the same detector keeps
+ * watching the line during a capture to report rate changes.
+ *
+ *   OFF --start()--> LISTENING --confident estimate--> LOCKED
+ *                        |                               |  ^
+ *                    timeout                 new rate in |  | re-lock
+ *                        v                  N windows    v  |
+ *                     FAILED                         (RATE_CHANGED)
+ *
+ *   monitor(baud) enters LOCKED directly (rate set by hand or detected
+ *   earlier); stop() returns to OFF from any state.
+ *
+ * While LISTENING the histogram accumulates until the estimate is
+ * confident. While LOCKED it restarts every monitor window so each
+ * window reflects only recent traffic; idle windows decide nothing.
+ * After monitor() no change is reported until a window has confirmed the
+ * given rate, so a pin that is not on the line (unwired, floating or
+ * carrying another signal) cannot re-lock the capture.
+ *
+ * Free of Arduino dependencies so transitions can be tested on the host.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef BAUDDETECTOR_H
+#define BAUDDETECTOR_H
+
+#include <stdint.h>
+
+#include "BaudEstimator.h"
+
+enum BaudDetectState : uint8_t {
+  BAUD_DETECT_OFF,
+  BAUD_DETECT_LISTENING,          // Looking for a first lock
+  BAUD_DETECT_LOCKED,             // Rate known; watching for changes
+  BAUD_DETECT_FAILED              // No lock before the timeout
+};
+
+// What poll() observed
+enum BaudDetectEvent : uint8_t {
+  BAUD_EVENT_NONE,
+  BAUD_EVENT_LOCKED,              // LISTENING -> LOCKED; baud() is the rate
+  BAUD_EVENT_RATE_CHANGED,        // Still LOCKED, at the new baud()
+  BAUD_EVENT_TIMED_OUT            // LISTENING -> FAILED
+};
+
+/**
+ * Detection timing and thresholds
+ */
+struct BaudDetectConfig {
+  uint32_t solveIntervalMs = 100;       // LISTENING: solve this often
+  uint32_t timeoutMs = 10000;           // LISTENING: give up after
+  uint32_t monitorWindowMs = 250;       // LOCKED: histogram restarts each window
+  uint32_t confirmWindows = 2;          // LOCKED: consecutive windows at a new rate to re-lock
+  uint32_t changePermille = 30;         // LOCKED: smallest rate difference that counts
+  float lockConfidence = 0.9f;          // Minimum BaudEstimate::confidence
+};
+
+class BaudDetector {
+ public:
+  /**
+   * @param cycleHz Tick rate of the edge timestamps
+   */
+  void begin(uint32_t cycleHz, const BaudDetectConfig& config) {
+    estimator_.begin(cycleHz);
+    config_ = config;
+    stop();
+  }
+
+  /**
+   * Look for the line rate from scratch
+   */
+  void start(uint32_t nowMs) {
+    enter(BAUD_DETECT_LISTENING, nowMs);
+    baud_ = 0;
+    last_ = BaudEstimate();
+  }
+
+  /**
+   * Watch a line whose rate is already known
+   */
+  void monitor(uint32_t baud, uint32_t nowMs) {
+    enter(BAUD_DETECT_LOCKED, nowMs);
+    baud_ = baud;
+    verified_ = false;
+  }
+
+  void stop() {
+    state_ = BAUD_DETECT_OFF;
+    mismatches_ = 0;
+    stepping_ = false;
+  }
+
+  /**
+   * One edge on the line (interrupt context)
+   * @param cycles Cycle counter at the edge
+   */
+  void edge(uint32_t cycles) {
+    if (state_ == BAUD_DETECT_OFF || state_ == BAUD_DETECT_FAILED) return;
+    if (solving_ || restart_) {
+      // Histogram is being read or was just cleared: start a new interval
+      restart_ = solving_;
+    } else {
+      estimator_.addInterval(cycles - lastEdge_);
+    }
+    lastEdge_ = cycles;
+    edges_++;
+  }
+
+  /**
+   * Advance the state machine (main loop, every pass): start a solve when
+   * one is due, or do one step of the solve under way
+   * @param nowMs Current time in milliseconds
+   * @return What changed, if anything
+   */
+  BaudDetectEvent poll(uint32_t nowMs) {
+    if (state_ != BAUD_DETECT_LISTENING && state_ != BAUD_DETECT_LOCKED) return BAUD_EVENT_NONE;
+
+    if (!stepping_) {
+      if (state_ == BAUD_DETECT_LISTENING) {
+        if (nowMs - lastSolveMs_ < config_.solveIntervalMs) return BAUD_EVENT_NONE;
+        lastSolveMs_ = nowMs;
+        stepping_ = startSolve();
+      } else {
+        if (nowMs - phaseStartMs_ < config_.monitorWindowMs) return BAUD_EVENT_NONE;
+        stepping_ = startSolve();
+        restartWindow(nowMs);   // The solve works on a copy; the next window starts now
+      }
+      if (!stepping_) return solved(false, nowMs);
+      return BAUD_EVENT_NONE;
+    }
+
+    if (!estimator_.stepEstimate()) return BAUD_EVENT_NONE;
+    stepping_ = false;
+    BaudEstimate estimate;
+    bool found = estimator_.estimateResult(estimate);
+    if (found) last_ = estimate;
+    return solved(found, nowMs);
+  }
+
+  BaudDetectState state() const { return state_; }
+  uint32_t baud() const { return baud_; }                   // Locked rate (0 before a lock)
+  const BaudEstimate& lastEstimate() const { return last_; }
+  uint32_t edgeCount() const { return edges_; }
+  uint32_t pendingWindows() const { return mismatches_; }   // Windows seen at a new rate
+  bool verified() const { return verified_; }               // LOCKED: line seen at baud()
+  bool solving() const { return stepping_; }                // poll() has solve steps left
+
+ private:
+  // A solve finished (found: last_ holds its estimate)
+  BaudDetectEvent solved(bool found, uint32_t nowMs) {
+    bool confident = found && last_.confidence >= config_.lockConfidence;
+
+    if (state_ == BAUD_DETECT_LISTENING) {
+      if (confident) {
+        baud_ = last_.baud;
+        enter(BAUD_DETECT_LOCKED, nowMs);
+        verified_ = true;
+        return BAUD_EVENT_LOCKED;
+      }
+      if (nowMs - phaseStartMs_ >= config_.timeoutMs) {
+        state_ = BAUD_DETECT_FAILED;
+        return BAUD_EVENT_TIMED_OUT;
+      }
+      return BAUD_EVENT_NONE;
+    }
+
+    if (state_ == BAUD_DETECT_LOCKED) {
+      if (!confident) return BAUD_EVENT_NONE;    // Idle or noisy window: no evidence either way
+
+      if (!sameRate(last_.baud, baud_)) {
+        if (!verified_) return BAUD_EVENT_NONE;   // Not yet seen the line at baud_
+        if (++mismatches_ >= config_.confirmWindows) {
+          baud_ = last_.baud;
+          mismatches_ = 0;
+          return BAUD_EVENT_RATE_CHANGED;
+        }
+      } else {
+        mismatches_ = 0;
+        verified_ = true;
+      }
+    }
+    return BAUD_EVENT_NONE;
+  }
+
+  void enter(BaudDetectState state, uint32_t nowMs) {
+    state_ = state;
+    mismatches_ = 0;
+    stepping_ = false;
+    edges_ = 0;
+    lastSolveMs_ = nowMs;
+    restartWindow(nowMs);
+  }
+
+  void restartWindow(uint32_t nowMs) {
+    solving_ = true;
+    estimator_.reset();
+    restart_ = true;
+    solving_ = false;
+    phaseStartMs_ = nowMs;
+  }
+
+  // Copy the histogram for a solve with the edge interrupt kept off it;
+  // false if there is nothing to solve
+  bool startSolve() {
+    solving_ = true;
+    bool started = estimator_.startEstimate();
+    solving_ = false;
+    return started;
+  }
+
+  bool sameRate(uint32_t a, uint32_t b) const {
+    uint32_t diff = a > b ? a - b : b - a;
+    return (uint64_t)diff * 1000 < (uint64_t)b * config_.changePermille;
+  }
+
+  BaudEstimator estimator_;
+  BaudDetectConfig config_;
+  volatile BaudDetectState state_ = BAUD_DETECT_OFF;
+  volatile bool solving_ = false;       // Main loop is copying the histogram
+  volatile bool restart_ = true;        // Next edge only starts an interval
+  volatile uint32_t lastEdge_ = 0;
+  volatile uint32_t edges_ = 0;
+  uint32_t baud_ = 0;
+  BaudEstimate last_ = BaudEstimate();
+  uint32_t phaseStartMs_ = 0;           // LISTENING start / current monitor window start
+  uint32_t lastSolveMs_ = 0;
+  uint32_t mismatches_ = 0;
+  bool stepping_ = false;               // A solve is under way (one step per poll())
+  bool verified_ = false;               // A window confirmed baud_ (changes may be reported)
+};
+
+#endif // BAUDDETECTOR_H
@@ -0,0 +1,309 @@
+/*
+ * SerialSniffer - Streaming Baud Rate Estimator
+ *
+ * Estimates the bit period of an asynchronous serial line from the time
+ * between level changes on its RX pin. Every interval between two edges
+ * is a whole number of bit periods (plus timing jitter), so the estimator
+ * keeps a log-spaced histogram of intervals and solves for the largest
+ * period that explains them as multiples, then refines it by least
+ * squares over all intervals. A glitch or idle gap only adds an interval
+ * that no candidate explains; it cannot shift the result the way taking
+ * the minimum pulse width does.
+ *
+ * Intervals are in cycle counter ticks, so rates of several Mbaud are
+ * resolved and non-standard rates are reported as measured.
+ *
+ * Free of Arduino dependencies so it can be tested on the host.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef BAUDESTIMATOR_H
+#define BAUDESTIMATOR_H
+
+#include <stdint.h>
+
+/**
+ * Result of BaudEstimator::estimate()
+ */
+struct BaudEstimate {
+  uint32_t baud;              // Nearest standard rate if within tolerance, else measuredBaud
+  uint32_t measuredBaud;      // Rate implied by bitCycles
+  float bitCycles;            // Estimated bit period in counter ticks
+  float confidence;           // 0-1: share of intervals explained, scaled down for few samples
+  uint32_t intervals;         // Intervals explained by bitCycles
+};
+
+/**
+ * Standard rates that estimates snap to (ascending)
+ */
+static const uint32_t STANDARD_BAUD_RATES[] = {
+  300, 600, 1200, 2400, 4800, 9600, 14400, 19200, 28800, 31250, 38400, 57600,
+  76800, 115200, 230400, 250000, 460800, 500000, 921600, 1000000, 1500000,
+  2000000, 3000000, 4000000
+};
+
+/**
+ * Nearest standard rate
+ * @param baud Measured rate
+ * @param tolerancePermille Largest accepted deviation (per mille of the standard rate)
+ * @return Standard rate, or 0 if none is within tolerance
+ */
+inline uint32_t nearestStandardBaud(uint32_t baud, uint32_t tolerancePermille) {
+  uint32_t best = 0;
+  uint32_t bestDiff = UINT32_MAX;
+  for (uint32_t rate : STANDARD_BAUD_RATES) {
+    uint32_t diff = baud > rate ? baud - rate : rate - baud;
+    if (diff < bestDiff) {
+      bestDiff = diff;
+      best = rate;
+    }
+  }
+  return (uint64_t)bestDiff * 1000 <= (uint64_t)best * tolerancePermille ? best : 0;
+}
+
+/**
+ * Edge interval histogram and bit period solver
+ *
+ * addInterval() is a few integer operations and may be called from the
+ * edge interrupt. A solve runs in the main loop in short steps:
+ * startEstimate() copies the populated bins and the candidate peaks
+ * (with the edge interrupt paused, or accepting that a bin may be read
+ * mid-update), then each stepEstimate() tries one candidate period
+ * against the copy, so the histogram may keep filling or be reset
+ * meanwhile. estimate() does all of it at once.
+ */
+class BaudEstimator {
+ public:
+  static const uint32_t BINS_PER_OCTAVE = 32;       // ~2.2% wide bins
+  static const uint32_t MIN_SHIFT = 5;              // Shortest interval: 32 ticks
+  static const uint32_t OCTAVES = 20;               // Longest: ~33.5M ticks
+  static const uint32_t BIN_COUNT = OCTAVES * BINS_PER_OCTAVE;
+  static const uint32_t MAX_BIT_RUN = 10;           // Longest constant level within 8N1/8E2 frames
+  static const uint32_t MIN_INTERVALS = 32;         // Before estimate() answers
+  static const uint32_t FULL_CONFIDENCE_INTERVALS = 128;
+  static const uint32_t MAX_PEAKS = 64;             // Candidate peaks per solve (~50 bins hold 1/50)
+  static const uint32_t MAX_DIVISOR = 4;            // A peak is read as 1-4 bit periods
+
+  /**
+   * @param cycleHz Tick rate of the intervals
+   * @param snapPermille Tolerance for snapping to a standard rate (0 = never)
+   */
+  explicit BaudEstimator(uint32_t cycleHz = 600000000, uint32_t snapPermille = 25)
+      : cycleHz_(cycleHz), snapPermille_(snapPermille) {
+    reset();
+  }
+
+  /**
+   * Set the tick rate (clears the histogram)
+   */
+  void begin(uint32_t cycleHz) {
+    cycleHz_ = cycleHz;
+    reset();
+  }
+
+  void reset() {
+    for (uint32_t i = 0; i < BIN_COUNT; i++) {
+      count_[i] = 0;
+      sum_[i] = 0;
+    }
+    total_ = 0;
+  }
+
+  /**
+   * Record the time between two consecutive edges
+   * Intervals outside the histogram range (glitches shorter than 32 ticks,
+   * idle periods longer than ~56 ms at 600 MHz) are ignored.
+   */
+  void addInterval(uint32_t ticks) {
+    int32_t bin = binOf(ticks);
+    if (bin < 0) return;
+    count_[bin]++;
+    sum_[bin] += ticks;
+    total_++;
+  }
+
+  /**
+   * Intervals recorded since reset()
+   */
+  uint32_t intervalCount() const { return total_; }
+
+  /**
+   * Solve for the bit period in one go
+   * @param result Estimate (valid when returning true)
+   * @return false if there are too few intervals or none fit a common period
+   */
+  bool estimate(BaudEstimate& result) {
+    if (!startEstimate()) return false;
+    while (!stepEstimate()) {
+    }
+    return estimateResult(result);
+  }
+
+  /**
+   * Start a solve: copy the populated bins and the candidate peaks
+   * (every well-populated local peak)
+   * @return false if there are too few intervals (nothing to step)
+   */
+  bool startEstimate() {
+    solveStep_ = SOLVE_DONE;
+    solveFit_ = 0;
+    if (total_ < MIN_INTERVALS) return false;
+
+    uint32_t threshold = total_ / 50 > 2 ? total_ / 50 : 2;
+    binsUsed_ = 0;
+    peaks_ = 0;
+    for (uint32_t i = 0; i < BIN_COUNT; i++) {
+      if (count_[i] == 0) continue;
+      Bin& bin = bins_[binsUsed_++];
+      bin.count = count_[i];
+      bin.sum = sum_[i];
+      bin.mean = (float)bin.sum / bin.count;
+
+      if (bin.count < threshold || peaks_ == MAX_PEAKS) continue;
+      if (i > 0 && count_[i - 1] > bin.count) continue;
+      if (i + 1 < BIN_COUNT && count_[i + 1] > bin.count) continue;
+      peak_[peaks_++] = bin.mean;
+    }
+    solveTotal_ = total_;
+    solveStep_ = 0;
+    bestFit_ = 0;
+    bestPeriod_ = 0;
+    return true;
+  }
+
+  /**
+   * One step of the solve: one candidate period (a peak read as 1-4 bit
+   * periods) fitted to every copied bin, or the final refinement.
+   * Pass 0 finds the best fit; pass 1 takes the longest period within 2%
+   * of it, since any fraction of the true period fits nearly as well.
+   * @return true once the solve is finished (estimateResult())
+   */
+  bool stepEstimate() {
+    const uint32_t candidates = peaks_ * MAX_DIVISOR;
+    if (solveStep_ == SOLVE_DONE) return true;
+
+    if (solveStep_ == 2 * candidates) {
+      if (bestFit_ > 0) {
+        solvePeriod_ = refine(refine(bestPeriod_));
+        solveFit_ = fitCount(solvePeriod_);
+      }
+      solveStep_ = SOLVE_DONE;
+      return true;
+    }
+
+    uint32_t pass = solveStep_ / candidates;
+    uint32_t candidate = solveStep_ % candidates;
+    uint32_t divisor = candidate % MAX_DIVISOR + 1;
+    solveStep_++;
+
+    float period = refine(peak_[candidate / MAX_DIVISOR] / divisor);
+    if (period < (1u << MIN_SHIFT)) {
+      // Shorter still for the larger divisors: on to the next peak
+      solveStep_ += MAX_DIVISOR - divisor;
+    } else {
+      uint32_t fit = fitCount(period);
+      if (pass == 0) {
+        if (fit > bestFit_) bestFit_ = fit;
+      } else if (fit > 0 && fit + fit / 50 >= bestFit_ && period > bestPeriod_) {
+        bestPeriod_ = period;
+      }
+    }
+
+    if (solveStep_ == candidates && bestFit_ == 0) solveStep_ = SOLVE_DONE;   // Nothing fits
+    return false;
+  }
+
+  /**
+   * Outcome of a finished solve
+   * @param result Estimate (valid when returning true)
+   * @return false if there were too few intervals or none fit a common period
+   */
+  bool estimateResult(BaudEstimate& result) const {
+    if (solveStep_ != SOLVE_DONE || solveFit_ == 0) return false;
+
+    float share = (float)solveFit_ / solveTotal_;
+    float coverage = solveFit_ >= FULL_CONFIDENCE_INTERVALS ? 1.0f
+                                                            : (float)solveFit_ / FULL_CONFIDENCE_INTERVALS;
+    result.bitCycles = solvePeriod_;
+    result.measuredBaud = (uint32_t)(cycleHz_ / solvePeriod_ + 0.5f);
+    uint32_t standard = snapPermille_ ? nearestStandardBaud(result.measuredBaud, snapPermille_) : 0;
+    result.baud = standard ? standard : result.measuredBaud;
+    result.confidence = share * coverage;
+    result.intervals = solveFit_;
+    return true;
+  }
+
+ private:
+  // Histogram bin of an interval: octave from the leading one, then the
+  // next five bits as the position within the octave; -1 if out of range
+  static int32_t binOf(uint32_t ticks) {
+    if (ticks < (1u << MIN_SHIFT)) return -1;
+    uint32_t octave = 31 - __builtin_clz(ticks);
+    if (octave >= MIN_SHIFT + OCTAVES) return -1;
+    uint32_t fraction = (ticks >> (octave - MIN_SHIFT)) & (BINS_PER_OCTAVE - 1);
+    return (int32_t)((octave - MIN_SHIFT) * BINS_PER_OCTAVE + fraction);
+  }
+
+  // Multiple of period that a bin's mean interval is, or 0 if it is not
+  // within a quarter period of one (noise, glitch or idle gap)
+  static uint32_t multipleOf(float mean, float period) {
+    float ratio = mean / period;
+    uint32_t k = (uint32_t)(ratio + 0.5f);
+    if (k == 0 || k > MAX_BIT_RUN) return 0;
+    float error = ratio - k;
+    return (error > -0.25f && error < 0.25f) ? k : 0;
+  }
+
+  // Intervals explained by a period (copied bins)
+  uint32_t fitCount(float period) const {
+    uint32_t fit = 0;
+    for (uint32_t i = 0; i < binsUsed_; i++) {
+      if (multipleOf(bins_[i].mean, period)) fit += bins_[i].count;
+    }
+    return fit;
+  }
+
+  // Least-squares period: total explained time over total bit periods
+  float refine(float period) const {
+    double time = 0;
+    double bits = 0;
+    for (uint32_t i = 0; i < binsUsed_; i++) {
+      uint32_t k = multipleOf(bins_[i].mean, period);
+      if (k == 0) continue;
+      time += (double)bins_[i].sum;
+      bits += (double)k * bins_[i].count;
+    }
+    return bits > 0 ? (float)(time / bits) : period;
+  }
+
+  // A populated bin, as copied by startEstimate()
+  struct Bin {
+    float mean;
+    uint32_t count;
+    uint64_t sum;
+  };
+
+  static const uint32_t SOLVE_DONE = UINT32_MAX;
+
+  uint32_t cycleHz_;
+  uint32_t snapPermille_;
+  uint32_t count_[BIN_COUNT];
+  uint64_t sum_[BIN_COUNT];
+  uint32_t total_;
+
+  // Solve in progress (startEstimate() .. stepEstimate() returning true)
+  Bin bins_[BIN_COUNT];
+  uint32_t binsUsed_ = 0;
+  float peak_[MAX_PEAKS];
+  uint32_t peaks_ = 0;
+  uint32_t solveTotal_ = 0;
+  uint32_t solveStep_ = SOLVE_DONE;     // Next candidate (pass * candidates + index)
+  uint32_t bestFit_ = 0;
+  float bestPeriod_ = 0;
+  float solvePeriod_ = 0;
+  uint32_t solveFit_ = 0;               // 0: no result
+};
+
+#endif // BAUDESTIMATOR_H
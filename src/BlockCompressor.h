@@ -0,0 +1,361 @@
+/*
+ * SerialSniffer - Capture Block Compression
+ *
+ * Optional stage between record encoding and the SD writer: delta
+ * records collect in a staging block of up to RawBytes, which is then
+ * LZ4-compressed (the standard LZ4 block format, greedy with one hash
+ * probe) into a CaptureBlock (CaptureFormat.h) and handed to the writer
+ * as room allows. Poll/response traffic and idle lines repeat the same
+ * record bytes over and over, which LZ4 removes at a few cycles per
+ * byte; a block that does not shrink is stored as it is.
+ *
+ * Every block carries the base ticks of its first record and CRCs over
+ * its header and payload, so readers decode blocks independently and
+ * skip a damaged one by scanning for the next block magic. The
+ * decompressor and block check here are shared with the host readers.
+ *
+ * Free of Arduino dependencies.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef BLOCKCOMPRESSOR_H
+#define BLOCKCOMPRESSOR_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CaptureFormat.h"
+#include "ChecksumEngine.h"
+
+// ==================== LZ4 Block Format ====================
+
+const uint32_t LZ4_MIN_MATCH = 4;
+const uint32_t LZ4_LAST_LITERALS = 5;       // A block ends with at least this many literals
+const uint32_t LZ4_MATCH_LIMIT = 12;        // No match starts in the last 12 bytes
+const uint32_t LZ4_HASH_LOG = 12;
+const uint32_t LZ4_HASH_ENTRIES = 1 << LZ4_HASH_LOG;
+
+/**
+ * Largest compressed size of size input bytes
+ */
+constexpr uint32_t lz4CompressBound(uint32_t size) { return size + size / 255 + 16; }
+
+inline uint32_t lz4Read32(const uint8_t* data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline uint32_t lz4Hash(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG); }
+
+// Length bytes after a token nibble of 15
+inline uint8_t* lz4PutLength(uint8_t* out, uint32_t length) {
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = (uint8_t)length;
+  return out;
+}
+
+// One sequence: literals, then a match (none for the last sequence)
+inline uint8_t* lz4PutSequence(uint8_t* out, const uint8_t* literals, uint32_t literalLength,
+                               uint32_t offset, uint32_t matchLength) {
+  uint8_t* token = out++;
+  *token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+  if (literalLength >= 15) out = lz4PutLength(out, literalLength - 15);
+  memcpy(out, literals, literalLength);
+  out += literalLength;
+  if (matchLength == 0) return out;
+
+  *out++ = (uint8_t)offset;
+  *out++ = (uint8_t)(offset >> 8);
+  uint32_t extra = matchLength - LZ4_MIN_MATCH;
+  *token |= (uint8_t)(extra >= 15 ? 15 : extra);
+  if (extra >= 15) out = lz4PutLength(out, extra - 15);
+  return out;
+}
+
+/**
+ * Compress one block in the LZ4 block format
+ * @param in Input, at most 65535 bytes (offsets stay in a uint16_t table)
+ * @param out Destination, at least lz4CompressBound(size) bytes
+ * @param table Scratch hash table of LZ4_HASH_ENTRIES (overwritten)
+ * @return Compressed size
+ */
+inline uint32_t lz4Compress(const uint8_t* in, uint32_t size, uint8_t* out, uint16_t* table) {
+  uint8_t* op = out;
+  uint32_t anchor = 0;
+  if (size > LZ4_MATCH_LIMIT) {
+    memset(table, 0, LZ4_HASH_ENTRIES * sizeof(uint16_t));
+    uint32_t matchLimit = size - LZ4_MATCH_LIMIT;
+    uint32_t extendLimit = size - LZ4_LAST_LITERALS;
+    uint32_t misses = 0;
+    uint32_t ip = 1;
+    while (ip < matchLimit) {
+      uint32_t sequence = lz4Read32(in + ip);
+      uint16_t& slot = table[lz4Hash(sequence)];
+      uint32_t ref = slot;
+      slot = (uint16_t)ip;
+      if (lz4Read32(in + ref) != sequence) {
+        ip += 1 + (misses++ >> 6);      // Step faster through data that does not repeat
+        continue;
+      }
+      misses = 0;
+      while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+        ip--;
+        ref--;
+      }
+      uint32_t length = LZ4_MIN_MATCH;
+      while (ip + length < extendLimit && in[ip + length] == in[ref + length]) length++;
+      op = lz4PutSequence(op, in + anchor, ip - anchor, ip - ref, length);
+      ip += length;
+      anchor = ip;
+      if (ip < matchLimit) table[lz4Hash(lz4Read32(in + ip - 2))] = (uint16_t)(ip - 2);
+    }
+  }
+  return lz4PutSequence(op, in + anchor, size - anchor, 0, 0) - out;
+}
+
+// Length bytes after a token nibble of 15; false if the input ends
+inline bool lz4GetLength(const uint8_t*& in, const uint8_t* end, uint32_t& length) {
+  uint8_t byte;
+  do {
+    if (in >= end || length > MAX_BLOCK_RAW_BYTES) return false;
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Decompress one LZ4 block, checking every length and offset
+ * @param outSize Exact decompressed size
+ * @return false if the input is malformed or does not decompress to outSize
+ */
+inline bool lz4Decompress(const uint8_t* in, uint32_t size, uint8_t* out, uint32_t outSize) {
+  const uint8_t* end = in + size;
+  uint32_t op = 0;
+  for (;;) {
+    if (in >= end) return false;
+    uint8_t token = *in++;
+    uint32_t literals = token >> 4;
+    if (literals == 15 && !lz4GetLength(in, end, literals)) return false;
+    if ((uint32_t)(end - in) < literals || outSize - op < literals) return false;
+    memcpy(out + op, in, literals);
+    in += literals;
+    op += literals;
+    if (in == end) return op == outSize;      // Last sequence
+
+    if (end - in < 2) return false;
+    uint32_t offset = in[0] | (uint32_t)in[1] << 8;
+    in += 2;
+    uint32_t length = token & 15;
+    if (length == 15 && !lz4GetLength(in, end, length)) return false;
+    length += LZ4_MIN_MATCH;
+    if (offset == 0 || offset > op || outSize - op < length) return false;
+    const uint8_t* from = out + op - offset;
+    if (offset >= length) {
+      memcpy(out + op, from, length);
+    } else {
+      for (uint32_t i = 0; i < length; i++) out[op + i] = from[i];   // Overlapping run
+    }
+    op += length;
+  }
+}
+
+// ==================== Capture Blocks ====================
+
+/**
+ * Header CRC as stored (over every field before headerCrc)
+ */
+inline uint16_t blockHeaderCrc(const CaptureBlockHeader& header) {
+  return crc16Ccitt((const uint8_t*)&header, sizeof(header) - sizeof(header.headerCrc));
+}
+
+/**
+ * Check a block header on its own (not its payload)
+ */
+inline bool isCaptureBlockHeader(const CaptureBlockHeader& header) {
+  return header.magic == CAPTURE_BLOCK_MAGIC && header.headerCrc == blockHeaderCrc(header) &&
+         header.method <= BLOCK_LZ4 && (header.method == BLOCK_LZ4 || header.storedBytes == header.rawBytes);
+}
+
+/**
+ * Check and unpack the block at data
+ * @param available Bytes readable at data
+ * @param header Receives the block header
+ * @param raw Receives the records, at least MAX_BLOCK_RAW_BYTES
+ * @return Bytes the block takes in the file, or 0 if it is damaged or cut short
+ */
+inline uint32_t unpackCaptureBlock(const uint8_t* data, size_t available, CaptureBlockHeader& header,
+                                   uint8_t* raw) {
+  if (available < sizeof(header)) return 0;
+  memcpy(&header, data, sizeof(header));
+  if (!isCaptureBlockHeader(header) || available - sizeof(header) < header.storedBytes) return 0;
+  const uint8_t* payload = data + sizeof(header);
+  if (crc16Ccitt(payload, header.storedBytes) != header.payloadCrc) return 0;
+  if (header.method == BLOCK_STORED) {
+    memcpy(raw, payload, header.rawBytes);
+  } else if (!lz4Decompress(payload, header.storedBytes, raw, header.rawBytes)) {
+    return 0;
+  }
+  return sizeof(header) + header.storedBytes;
+}
+
+/**
+ * Offset of the next intact-looking block header in [from, size), or size
+ * (resync after a damaged block)
+ */
+inline size_t findCaptureBlock(const uint8_t* data, size_t from, size_t size) {
+  size_t at = from;
+  while (at < size && size - at >= sizeof(CaptureBlockHeader)) {
+    const void* found = memchr(data + at, (uint8_t)CAPTURE_BLOCK_MAGIC, size - at - sizeof(CaptureBlockHeader) + 1);
+    if (!found) break;
+    at = (const uint8_t*)found - data;
+    CaptureBlockHeader header;
+    memcpy(&header, data + at, sizeof(header));
+    if (isCaptureBlockHeader(header)) return at;
+    at++;
+  }
+  return size;
+}
+
+// ==================== Compressor ====================
+
+/**
+ * Compression counters (times in microseconds)
+ */
+struct BlockCompressorStats {
+  uint32_t blocks = 0;
+  uint32_t storedBlocks = 0;      // Did not shrink; written as they are
+  uint64_t rawBytes = 0;          // Records in
+  uint64_t fileBytes = 0;         // Blocks out, headers included
+  uint64_t totalUs = 0;           // Compression and CRC time
+  uint32_t lastUs = 0;
+  uint32_t maxUs = 0;
+};
+
+/**
+ * Staging block and output buffer between record encoding and the writer
+ *
+ * The caller append()s encoded records while room() allows, seal()s the
+ * block when it is full enough or old enough, and drain()s the sealed
+ * block into the writer; a new block can be sealed once pending() is 0.
+ * Records stay whole within a block.
+ *
+ * @tparam RawBytes Staging block size (records per block, decompressed)
+ */
+template <uint32_t RawBytes>
+class BlockCompressor {
+  static_assert(RawBytes <= MAX_BLOCK_RAW_BYTES, "Block too large for CaptureBlockHeader");
+
+ public:
+  typedef uint32_t (*MicrosFn)();
+
+  /**
+   * Forget staged and sealed data (after a drain, or a new file)
+   */
+  void reset() {
+    used_ = 0;
+    records_ = 0;
+    outUsed_ = outSent_ = 0;
+  }
+
+  /**
+   * Bytes append() can take before seal()
+   */
+  uint32_t room() const { return RawBytes - used_; }
+  uint32_t used() const { return used_; }
+  uint64_t baseTicks() const { return baseTicks_; }     // Of the staged block
+  uint32_t openedMs() const { return openedMs_; }
+
+  /**
+   * Add one encoded record (caller checks room())
+   * @param baseTicks Ticks its delta counts from (kept if it opens the block)
+   * @param nowMs Time the block was opened, for flushing it when it gets old
+   */
+  void append(const uint8_t* record, uint32_t length, uint64_t baseTicks, uint32_t nowMs) {
+    if (used_ == 0) {
+      baseTicks_ = baseTicks;
+      openedMs_ = nowMs;
+    }
+    memcpy(staging_ + used_, record, length);
+    used_ += length;
+    records_++;
+  }
+
+  /**
+   * Compress the staged records into the output (when pending() is 0)
+   * @param micros Microsecond clock for the cost statistics, may be nullptr
+   */
+  void seal(MicrosFn micros) {
+    if (used_ == 0 || outSent_ < outUsed_) return;
+    uint32_t start = micros ? micros() : 0;
+
+    CaptureBlockHeader header;
+    header.magic = CAPTURE_BLOCK_MAGIC;
+    header.baseTicks = baseTicks_;
+    header.rawBytes = (uint16_t)used_;
+    header.recordCount = (uint16_t)records_;
+    header.reserved = 0;
+    uint8_t* payload = output_ + sizeof(header);
+    uint32_t stored = lz4Compress(staging_, used_, payload, table_);
+    header.method = BLOCK_LZ4;
+    if (stored >= used_) {
+      memcpy(payload, staging_, used_);
+      stored = used_;
+      header.method = BLOCK_STORED;
+      stats_.storedBlocks++;
+    }
+    header.storedBytes = (uint16_t)stored;
+    header.payloadCrc = crc16Ccitt(payload, stored);
+    header.headerCrc = blockHeaderCrc(header);
+    memcpy(output_, &header, sizeof(header));
+    outUsed_ = sizeof(header) + stored;
+    outSent_ = 0;
+
+    uint32_t elapsed = micros ? micros() - start : 0;
+    stats_.blocks++;
+    stats_.rawBytes += used_;
+    stats_.fileBytes += outUsed_;
+    stats_.totalUs += elapsed;
+    stats_.lastUs = elapsed;
+    if (elapsed > stats_.maxUs) stats_.maxUs = elapsed;
+    used_ = 0;
+    records_ = 0;
+  }
+
+  /**
+   * Sealed bytes not yet taken by the writer
+   */
+  uint32_t pending() const { return outUsed_ - outSent_; }
+
+  /**
+   * Hand the sealed block to the writer, as much as it takes
+   * @tparam Writer Provides uint32_t append(const void*, uint32_t)
+   */
+  template <typename Writer>
+  void drain(Writer& writer) {
+    if (outSent_ < outUsed_) outSent_ += writer.append(output_ + outSent_, outUsed_ - outSent_);
+  }
+
+  const BlockCompressorStats& stats() const { return stats_; }
+  void clearStats() { stats_ = BlockCompressorStats(); }
+
+ private:
+  uint8_t staging_[RawBytes];
+  uint8_t output_[sizeof(CaptureBlockHeader) + lz4CompressBound(RawBytes)];
+  uint16_t table_[LZ4_HASH_ENTRIES];
+  uint32_t used_ = 0;
+  uint32_t records_ = 0;
+  uint32_t outUsed_ = 0;
+  uint32_t outSent_ = 0;
+  uint64_t baseTicks_ = 0;
+  uint32_t openedMs_ = 0;
+  BlockCompressorStats stats_;
+};
+
+#endif // BLOCKCOMPRESSOR_H
@@ -0,0 +1,375 @@
+/*
+ * SerialSniffer - Streaming Packet Checksum Engine
+ *
+ * Detects and checks packet checksums while bytes are logged (FR-004).
+ * For every open packet it keeps running XOR, sum, CRC-8 and CRC-16
+ * states for each covered-range offset (0 to CHECKSUM_MAX_OFFSET - 1
+ * leading header or sync bytes left out), and the states at the last few
+ * positions. When PacketFramer ends a packet, every rule (algorithm,
+ * offset, 0 or 1 trailer bytes such as an end delimiter after the
+ * checksum) is scored against the packet's trailing bytes in O(1).
+ *
+ * A rule that matches lockPackets packets in a row, with changing
+ * checksum values, is locked for the channel. From then on only that
+ * rule is computed and each packet's PACKET_END record gets
+ * STATUS_CHECKSUM_VALID or STATUS_CHECKSUM_ERROR; unlockFailures
+ * mismatches in a row drop the lock and detection starts over. A rule
+ * can also be configured instead of detected.
+ *
+ * CRCs use 256-entry tables built at compile time, one lookup per byte.
+ * Bytes come one at a time from the merge, interleaved across channels,
+ * so slicing-by-N (several bytes of one stream per step) does not apply.
+ *
+ * Free of Arduino dependencies so it can be tested on the host.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef CHECKSUMENGINE_H
+#define CHECKSUMENGINE_H
+
+#include <stdint.h>
+
+#include "CaptureFormat.h"
+
+const uint8_t CHECKSUM_MAX_OFFSET = 3;        // Covered range starts at byte 0, 1 or 2
+const uint8_t CHECKSUM_MAX_TRAILER = 1;       // Bytes after the checksum
+const uint32_t CHECKSUM_MIN_COVERED = 2;      // Shorter covered ranges are not scored
+
+// ==================== Kernels ====================
+
+struct Crc8Table {
+  uint8_t entries[256];
+};
+
+struct Crc16Table {
+  uint16_t entries[256];
+};
+
+constexpr Crc8Table makeCrc8Table(uint8_t poly) {
+  Crc8Table table = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint8_t crc = (uint8_t)i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ poly) : (uint8_t)(crc << 1);
+    }
+    table.entries[i] = crc;
+  }
+  return table;
+}
+
+// Most significant bit first
+constexpr Crc16Table makeCrc16Table(uint16_t poly) {
+  Crc16Table table = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint16_t crc = (uint16_t)(i << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ poly) : (uint16_t)(crc << 1);
+    }
+    table.entries[i] = crc;
+  }
+  return table;
+}
+
+// Least significant bit first (poly given bit-reversed)
+constexpr Crc16Table makeCrc16ReflectedTable(uint16_t reflectedPoly) {
+  Crc16Table table = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint16_t crc = (uint16_t)i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ reflectedPoly) : (uint16_t)(crc >> 1);
+    }
+    table.entries[i] = crc;
+  }
+  return table;
+}
+
+constexpr Crc8Table CRC8_TABLE = makeCrc8Table(0x07);
+constexpr Crc16Table CRC16_MODBUS_TABLE = makeCrc16ReflectedTable(0xA001);
+constexpr Crc16Table CRC16_CCITT_TABLE = makeCrc16Table(0x1021);
+
+inline uint8_t crc8Update(uint8_t crc, uint8_t value) {
+  return CRC8_TABLE.entries[crc ^ value];
+}
+
+inline uint16_t crc16ModbusUpdate(uint16_t crc, uint8_t value) {
+  return (crc >> 8) ^ CRC16_MODBUS_TABLE.entries[(crc ^ value) & 0xFF];
+}
+
+inline uint16_t crc16CcittUpdate(uint16_t crc, uint8_t value) {
+  return (uint16_t)(crc << 8) ^ CRC16_CCITT_TABLE.entries[(crc >> 8) ^ value];
+}
+
+/**
+ * CRC-16/CCITT-FALSE of a buffer, or continued from a previous crc
+ */
+inline uint16_t crc16Ccitt(const uint8_t* data, uint32_t length, uint16_t crc = 0xFFFF) {
+  for (uint32_t i = 0; i < length; i++) crc = crc16CcittUpdate(crc, data[i]);
+  return crc;
+}
+
+/**
+ * Running state of every algorithm over the same bytes
+ */
+struct ChecksumState {
+  uint16_t crc16Modbus = 0xFFFF;
+  uint16_t crc16Ccitt = 0xFFFF;
+  uint8_t xor8 = 0;
+  uint8_t sum8 = 0;
+  uint8_t crc8 = 0;
+
+  void add(uint8_t value) {
+    xor8 ^= value;
+    sum8 += value;
+    crc8 = crc8Update(crc8, value);
+    crc16Modbus = crc16ModbusUpdate(crc16Modbus, value);
+    crc16Ccitt = crc16CcittUpdate(crc16Ccitt, value);
+  }
+
+  uint32_t value(uint8_t algorithm) const {
+    switch (algorithm) {
+      case CHECKSUM_XOR8: return xor8;
+      case CHECKSUM_SUM8: return sum8;
+      case CHECKSUM_CRC8: return crc8;
+      case CHECKSUM_CRC16_MODBUS: return crc16Modbus;
+      case CHECKSUM_CRC16_CCITT: return crc16Ccitt;
+      default: return 0;
+    }
+  }
+};
+
+/**
+ * Bytes a checksum occupies in the packet
+ */
+inline uint32_t checksumWidth(uint8_t algorithm) {
+  return algorithm >= CHECKSUM_CRC16_MODBUS ? 2 : 1;
+}
+
+/**
+ * Checksum of a buffer (host tools and known-answer tests)
+ */
+inline uint32_t computeChecksum(uint8_t algorithm, const uint8_t* data, uint32_t length) {
+  ChecksumState state;
+  for (uint32_t i = 0; i < length; i++) state.add(data[i]);
+  return state.value(algorithm);
+}
+
+/**
+ * Checksum value as transmitted at the end of a packet
+ * @param recent Last four bytes of the packet, the last one in bits 0-7
+ * @param trailer Bytes after the checksum
+ */
+inline uint32_t trailingChecksum(uint8_t algorithm, uint32_t recent, uint8_t trailer) {
+  uint32_t field = recent >> (8 * trailer);
+  if (algorithm == CHECKSUM_CRC16_MODBUS) return ((field >> 8) & 0xFF) | ((field & 0xFF) << 8);
+  if (algorithm == CHECKSUM_CRC16_CCITT) return field & 0xFFFF;
+  return field & 0xFF;
+}
+
+// ==================== Engine ====================
+
+/**
+ * Where a packet's checksum is and what it covers
+ */
+struct ChecksumRule {
+  uint8_t algorithm = CHECKSUM_NONE;
+  uint8_t offset = 0;             // Bytes before the covered range
+  uint8_t trailer = 0;            // Bytes after the checksum
+
+  // RECORD_KIND_CHECKSUM argument
+  uint64_t argument() const { return offset | ((uint64_t)trailer << 8); }
+};
+
+/**
+ * Detection and checking settings
+ */
+struct ChecksumConfig {
+  bool detect = true;             // Find each channel's rule from its packets
+  ChecksumRule fixed;             // Used instead of detection if its algorithm is set
+  uint8_t lockPackets = 4;        // Matches in a row that lock a detected rule
+  uint8_t unlockFailures = 8;     // Mismatches in a row that drop it
+};
+
+class ChecksumEngine {
+ public:
+  /**
+   * Apply settings (clears all state)
+   */
+  void begin(const ChecksumConfig& config) {
+    config_ = config;
+    reset();
+  }
+
+  /**
+   * Forget detected rules and counters (new session)
+   */
+  void reset() {
+    for (ChannelState& state : channels_) {
+      state = ChannelState();
+      state.rule = config_.fixed;
+    }
+  }
+
+  bool enabled() const {
+    return config_.detect || config_.fixed.algorithm != CHECKSUM_NONE;
+  }
+
+  /**
+   * A packet starts on a channel (before its first byte)
+   */
+  void packetStart(uint8_t channel) {
+    ChannelState& state = channels_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+    state.length = 0;
+    state.recent = 0;
+    for (uint32_t offset = 0; offset < CHECKSUM_MAX_OFFSET; offset++) {
+      state.history[offset][0] = ChecksumState();
+    }
+  }
+
+  /**
+   * Next byte of the channel's open packet
+   */
+  void add(uint8_t channel, uint8_t value) {
+    ChannelState& state = channels_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+    uint32_t position = state.length++;
+    state.recent = (state.recent << 8) | value;
+    if (state.rule.algorithm != CHECKSUM_NONE) {
+      advance(state, state.rule.offset, position, value);
+    } else {
+      for (uint32_t offset = 0; offset < CHECKSUM_MAX_OFFSET; offset++) {
+        advance(state, offset, position, value);
+      }
+    }
+  }
+
+  /**
+   * The channel's packet ended: check it, or score it while detecting
+   * @param complete Ended by the framing rules (idle gap or delimiter),
+   *                 not cut off by the length limit or a stop
+   * @param sink Called as sink(channel, const ChecksumRule&) when a rule
+   *             is locked or dropped (CHECKSUM_NONE)
+   * @return RecordStatus flags for the PACKET_END record
+   */
+  template <typename Sink>
+  uint8_t packetEnd(uint8_t channel, bool complete, Sink&& sink) {
+    ChannelState& state = channels_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+    if (!complete) return STATUS_OK;
+
+    if (state.rule.algorithm != CHECKSUM_NONE) {
+      if (!covers(state, state.rule)) return STATUS_OK;
+      if (matches(state, state.rule)) {
+        state.failures = 0;
+        state.validPackets++;
+        return STATUS_CHECKSUM_VALID;
+      }
+      state.errorPackets++;
+      bool detected = config_.fixed.algorithm == CHECKSUM_NONE;
+      if (detected && ++state.failures >= config_.unlockFailures) {
+        state.rule = ChecksumRule();
+        for (Score& score : state.scores) score = Score();
+        sink(channel, state.rule);
+      }
+      return STATUS_CHECKSUM_ERROR;
+    }
+    if (!config_.detect) return STATUS_OK;
+
+    // Strongest algorithm first, so it wins when several lock together
+    bool locked = false;
+    for (uint8_t algorithm = CHECKSUM_ALGORITHM_COUNT - 1; algorithm > CHECKSUM_NONE; algorithm--) {
+      for (uint8_t offset = 0; offset < CHECKSUM_MAX_OFFSET; offset++) {
+        for (uint8_t trailer = 0; trailer <= CHECKSUM_MAX_TRAILER; trailer++) {
+          ChecksumRule rule;
+          rule.algorithm = algorithm;
+          rule.offset = offset;
+          rule.trailer = trailer;
+          Score& score = state.scores[scoreIndex(rule)];
+          if (!covers(state, rule)) continue;        // Too short to tell: keep the score
+          if (!matches(state, rule)) {
+            score = Score();
+            continue;
+          }
+          uint16_t check = (uint16_t)trailingChecksum(algorithm, state.recent, trailer);
+          if (score.run > 0 && check != score.lastCheck) score.varied = true;
+          score.lastCheck = check;
+          if (score.run < 255) score.run++;
+          if (!locked && score.run >= config_.lockPackets && score.varied) {
+            state.rule = rule;
+            locked = true;
+          }
+        }
+      }
+    }
+    if (!locked) return STATUS_OK;
+
+    for (Score& score : state.scores) score = Score();
+    state.failures = 0;
+    state.validPackets++;
+    sink(channel, state.rule);
+    return STATUS_CHECKSUM_VALID;
+  }
+
+  /**
+   * Rule in use on a channel (CHECKSUM_NONE while detecting)
+   */
+  const ChecksumRule& rule(uint8_t channel) const {
+    return channels_[channel & (MAX_CAPTURE_CHANNELS - 1)].rule;
+  }
+
+  uint64_t validPackets(uint8_t channel) const {
+    return channels_[channel & (MAX_CAPTURE_CHANNELS - 1)].validPackets;
+  }
+
+  uint64_t errorPackets(uint8_t channel) const {
+    return channels_[channel & (MAX_CAPTURE_CHANNELS - 1)].errorPackets;
+  }
+
+ private:
+  static const uint32_t HISTORY = 4;      // States after the last HISTORY - 1 bytes, and now
+  static const uint32_t RULE_COUNT =
+      CHECKSUM_ALGORITHM_COUNT * CHECKSUM_MAX_OFFSET * (CHECKSUM_MAX_TRAILER + 1);
+
+  struct Score {
+    uint16_t lastCheck = 0;
+    uint8_t run = 0;              // Matching packets in a row
+    bool varied = false;          // Their checksum values were not all the same
+  };
+
+  struct ChannelState {
+    // history[offset][n % HISTORY]: checksum of bytes offset..n-1 of the packet
+    ChecksumState history[CHECKSUM_MAX_OFFSET][HISTORY];
+    uint32_t length = 0;
+    uint32_t recent = 0;          // Last four bytes, the newest in bits 0-7
+    ChecksumRule rule;
+    uint8_t failures = 0;
+    uint64_t validPackets = 0;
+    uint64_t errorPackets = 0;
+    Score scores[RULE_COUNT];
+  };
+
+  static uint32_t scoreIndex(const ChecksumRule& rule) {
+    return (rule.algorithm * CHECKSUM_MAX_OFFSET + rule.offset) * (CHECKSUM_MAX_TRAILER + 1) + rule.trailer;
+  }
+
+  static void advance(ChannelState& state, uint32_t offset, uint32_t position, uint8_t value) {
+    ChecksumState& next = state.history[offset][(position + 1) % HISTORY];
+    next = state.history[offset][position % HISTORY];
+    if (position >= offset) next.add(value);
+  }
+
+  // At least CHECKSUM_MIN_COVERED bytes between the offset and the checksum
+  static bool covers(const ChannelState& state, const ChecksumRule& rule) {
+    return state.length >= rule.offset + CHECKSUM_MIN_COVERED + checksumWidth(rule.algorithm) + rule.trailer;
+  }
+
+  static bool matches(const ChannelState& state, const ChecksumRule& rule) {
+    uint32_t end = state.length - checksumWidth(rule.algorithm) - rule.trailer;
+    uint32_t computed = state.history[rule.offset][end % HISTORY].value(rule.algorithm);
+    return computed == trailingChecksum(rule.algorithm, state.recent, rule.trailer);
+  }
+
+  ChecksumConfig config_;
+  ChannelState channels_[MAX_CAPTURE_CHANNELS];
+};
+
+#endif // CHECKSUMENGINE_H
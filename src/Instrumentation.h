@@ -0,0 +1,233 @@
+/*
+ * SerialSniffer - Pipeline Instrumentation
+ *
+ * Counters and fixed-bucket latency histograms for every stage of the
+ * capture path (PipelineStage in CaptureFormat.h), from the UART
+ * interrupt to the card and the live stream. Latencies are cycle counter
+ * ticks binned by powers of two, so a probe is two counter reads, a
+ * count-leading-zeros and a few adds. CaptureEngine copies them into a
+ * MetricsSnapshot for the status command and the RECORD_KIND_METRIC
+ * records it logs.
+ *
+ * CAPTURE_METRICS=0 compiles the probes out (CaptureEngine's Metrics
+ * parameter defaults to it). The byte and error counters stay: they cost
+ * no more than the received byte count next to them.
+ *
+ * Free of Arduino dependencies so the host simulator runs the same code.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CaptureFormat.h"
+
+#ifndef CAPTURE_METRICS
+#define CAPTURE_METRICS 1
+#endif
+
+/**
+ * Latency histogram of one stage (ticks)
+ * Single writer; a reader on the other side of an interrupt may see a
+ * sample half-counted, which only skews that snapshot.
+ */
+struct LatencyHistogram {
+  uint32_t count = 0;
+  uint64_t total = 0;
+  uint32_t max = 0;
+  uint32_t buckets[LATENCY_BUCKETS] = {0};
+
+  void record(uint32_t ticks) {
+    count++;
+    total += ticks;
+    if (ticks > max) max = ticks;
+    buckets[latencyBucket(ticks)]++;
+  }
+
+  void add(const LatencyHistogram& other) {
+    count += other.count;
+    total += other.total;
+    if (other.max > max) max = other.max;
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) buckets[i] += other.buckets[i];
+  }
+
+  void reset() { *this = LatencyHistogram(); }
+
+  /**
+   * Upper bound of the bucket holding the given fraction of samples
+   * @param permille 0-1000 (e.g. 990 for the 99th percentile)
+   * @return Ticks (the maximum for the last bucket), 0 if empty
+   */
+  uint32_t percentile(uint32_t permille) const {
+    if (count == 0) return 0;
+    uint64_t wanted = ((uint64_t)count * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+      seen += buckets[i];
+      if (seen >= wanted && seen > 0) {
+        uint32_t end = latencyBucketStart(i + 1) - 1;
+        return end < max ? end : max;
+      }
+    }
+    return max;
+  }
+};
+
+/**
+ * Receive-side counters of one UART (producer: its interrupt)
+ */
+struct UartMetrics {
+  volatile uint32_t framingErrors = 0;
+  volatile uint32_t parityErrors = 0;
+  volatile uint32_t overruns = 0;         // FIFO overruns seen by the interrupt
+  LatencyHistogram interrupts;            // Interrupt duration (STAGE_RECEIVE)
+
+  void reset() {
+    framingErrors = 0;
+    parityErrors = 0;
+    overruns = 0;
+    interrupts.reset();
+  }
+};
+
+/**
+ * Everything a status report or a logged snapshot shows, copied at one
+ * moment (counters indexed by channel id)
+ */
+struct MetricsSnapshot {
+  LatencyHistogram stages[PIPELINE_STAGE_COUNT];
+  uint32_t bytesReceived[MAX_CAPTURE_CHANNELS] = {0};
+  uint32_t bytesDropped[MAX_CAPTURE_CHANNELS] = {0};
+  uint32_t framingErrors[MAX_CAPTURE_CHANNELS] = {0};
+  uint32_t parityErrors[MAX_CAPTURE_CHANNELS] = {0};
+  uint32_t overruns[MAX_CAPTURE_CHANNELS] = {0};
+  uint64_t streamDropped = 0;
+  uint32_t writeErrors = 0;
+  uint32_t indexDropped = 0;
+  uint32_t probeTicks = 0;
+
+  /**
+   * Value of a metric id on a channel (global ids only on channel 0)
+   * @return false if the id is unused or has no value on that channel
+   */
+  bool value(uint8_t id, uint8_t channel, uint64_t& out) const {
+    channel &= MAX_CAPTURE_CHANNELS - 1;
+    if (id < METRIC_COUNTER_BASE) {
+      if (channel != 0) return false;
+      const LatencyHistogram& stage = stages[id / METRIC_STAGE_IDS];
+      uint8_t field = id % METRIC_STAGE_IDS;
+      if (field == METRIC_FIELD_COUNT) out = stage.count;
+      else if (field == METRIC_FIELD_TOTAL) out = stage.total;
+      else if (field == METRIC_FIELD_MAX) out = stage.max;
+      else if (field < METRIC_FIELD_BUCKET + LATENCY_BUCKETS) out = stage.buckets[field - METRIC_FIELD_BUCKET];
+      else return false;
+      return true;
+    }
+    switch (id) {
+      case METRIC_BYTES_RECEIVED: out = bytesReceived[channel]; return true;
+      case METRIC_BYTES_DROPPED: out = bytesDropped[channel]; return true;
+      case METRIC_FRAMING_ERRORS: out = framingErrors[channel]; return true;
+      case METRIC_PARITY_ERRORS: out = parityErrors[channel]; return true;
+      case METRIC_OVERRUNS: out = overruns[channel]; return true;
+      default: break;
+    }
+    if (channel != 0) return false;
+    switch (id) {
+      case METRIC_STREAM_DROPPED: out = streamDropped; return true;
+      case METRIC_WRITE_ERRORS: out = writeErrors; return true;
+      case METRIC_INDEX_DROPPED: out = indexDropped; return true;
+      case METRIC_PROBE_TICKS: out = probeTicks; return true;
+      default: return false;
+    }
+  }
+};
+
+/**
+ * Latency probes of the consumer-side stages
+ *
+ * With Enabled false every call is empty and the compiler drops the
+ * counter reads around it.
+ *
+ * @tparam Clock HAL clock (cycles())
+ * @tparam Enabled Probes compiled in
+ */
+template <typename Clock, bool Enabled>
+class PipelineMetrics {
+ public:
+  static const bool ENABLED = Enabled;
+
+  /**
+   * Counter reading to time a stage from (0 when disabled)
+   */
+  uint32_t now() const { return Enabled ? Clock::cycles() : 0; }
+
+  void record(uint8_t stage, uint32_t ticks) {
+    if (!Enabled) return;
+    stages_[stage].record(ticks);
+  }
+
+  /**
+   * Record the time since a now() reading
+   */
+  void since(uint8_t stage, uint32_t start) {
+    if (!Enabled) return;
+    stages_[stage].record(Clock::cycles() - start);
+  }
+
+  /**
+   * Count probes that time something without recording a sample (the
+   * per-byte framing and encoding timers)
+   */
+  void addProbes(uint32_t count) {
+    if (Enabled) extraProbes_ += count;
+  }
+
+  /**
+   * Measure what one probe costs (setup; the counter must be running)
+   */
+  void calibrate() {
+    if (!Enabled) return;
+    const uint32_t ROUNDS = 64;
+    LatencyHistogram scratch;
+    uint32_t start = Clock::cycles();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+      uint32_t begin = now();
+      scratch.record(Clock::cycles() - begin);
+    }
+    probeTicks_ = (Clock::cycles() - start) / ROUNDS;
+  }
+
+  void reset() {
+    for (LatencyHistogram& stage : stages_) stage.reset();
+    extraProbes_ = 0;
+  }
+
+  /**
+   * Estimated share of the CPU the probes took (calibrated cost times
+   * probes taken, the interrupt's included)
+   * @param receiveProbes Samples in the channels' interrupt histograms
+   * @param elapsedTicks Time the probes were taken over
+   * @return Parts per thousand
+   */
+  uint32_t overheadPermille(uint64_t receiveProbes, uint64_t elapsedTicks) const {
+    if (!Enabled || elapsedTicks == 0) return 0;
+    uint64_t probes = extraProbes_ + receiveProbes;
+    for (const LatencyHistogram& stage : stages_) probes += stage.count;
+    return (uint32_t)(probes * probeTicks_ * 1000 / elapsedTicks);
+  }
+
+  const LatencyHistogram& stage(uint8_t stage) const { return stages_[stage]; }
+  uint32_t probeTicks() const { return probeTicks_; }
+
+ private:
+  LatencyHistogram stages_[PIPELINE_STAGE_COUNT];   // STAGE_RECEIVE lives in the channels
+  uint64_t extraProbes_ = 0;
+  uint32_t probeTicks_ = 0;
+};
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,314 @@
+/*
+ * SerialSniffer - Lock-Free SPSC Ring Buffer
+ *
+ * Single-producer/single-consumer ring between the UART receive context
+ * and the logging path, and a two-tier version of it that spills from a
+ * small ring in fast RAM into a large one in slower RAM. Header-only and
+ * free of Arduino dependencies so it builds for the Teensy and for the
+ * host tools in host/.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Fixed-capacity SPSC ring
+ *
+ * head_ is only written by the producer and tail_ only by the consumer.
+ * Both run freely over the full uint32_t range and are masked on access,
+ * so size() is always head_ - tail_ and no slot is wasted. The release
+ * store of an index publishes the slots it covers; the matching acquire
+ * load on the other side makes them visible.
+ *
+ * @tparam T Element type (trivially copyable)
+ * @tparam Capacity Number of slots, must be a power of two
+ */
+template <typename T, uint32_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+ public:
+  static const uint32_t kCapacity = Capacity;
+  static const uint32_t kMask = Capacity - 1;
+
+  SpscRing() : head_(0), tail_(0) {}
+
+  // ---------- Producer side ----------
+
+  /**
+   * Append one element
+   * @return false if the ring is full (element not stored)
+   */
+  bool push(const T& value) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= Capacity) return false;
+    buffer_[head & kMask] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Get the largest contiguous free region
+   * Fill up to the returned count at ptr, then call commitWrite().
+   * @param ptr Set to the first free slot
+   * @return Number of contiguous free slots (0 if full)
+   */
+  uint32_t writeSpan(T*& ptr) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t space = Capacity - (head - tail_.load(std::memory_order_acquire));
+    uint32_t index = head & kMask;
+    uint32_t toEnd = Capacity - index;
+    ptr = &buffer_[index];
+    return space < toEnd ? space : toEnd;
+  }
+
+  /**
+   * Publish count slots previously filled through writeSpan()
+   */
+  void commitWrite(uint32_t count) {
+    head_.store(head_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+  }
+
+  // ---------- Consumer side ----------
+
+  /**
+   * Remove one element
+   * @return false if the ring is empty
+   */
+  bool pop(T& value) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail) return false;
+    value = buffer_[tail & kMask];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Get the largest contiguous readable region
+   * Process up to the returned count at ptr, then call consumeRead().
+   * @param ptr Set to the oldest unread element
+   * @return Number of contiguous readable elements (0 if empty)
+   */
+  uint32_t readSpan(const T*& ptr) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t available = head_.load(std::memory_order_acquire) - tail;
+    uint32_t index = tail & kMask;
+    uint32_t toEnd = Capacity - index;
+    ptr = &buffer_[index];
+    return available < toEnd ? available : toEnd;
+  }
+
+  /**
+   * Release count elements previously obtained through readSpan()
+   */
+  void consumeRead(uint32_t count) {
+    tail_.store(tail_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+  }
+
+  /**
+   * Discard everything currently readable (consumer side only)
+   */
+  void clear() {
+    tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  // ---------- Either side ----------
+
+  /**
+   * Number of readable elements (a snapshot; may change immediately)
+   */
+  uint32_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Free-running stream positions (not masked)
+   * writePosition() is the position the next pushed element will get;
+   * readPosition() is the position of the oldest unread element.
+   */
+  uint32_t writePosition() const { return head_.load(std::memory_order_acquire); }
+  uint32_t readPosition() const { return tail_.load(std::memory_order_acquire); }
+
+  uint32_t freeSpace() const { return Capacity - size(); }
+  bool empty() const { return size() == 0; }
+  uint32_t capacity() const { return Capacity; }
+
+ private:
+  // Indices on separate cache lines so producer and consumer don't contend
+  alignas(64) std::atomic<uint32_t> head_;
+  alignas(64) std::atomic<uint32_t> tail_;
+  alignas(64) T buffer_[Capacity];
+};
+
+/**
+ * Two-tier SPSC ring: a small fast ring with a large spill ring behind it
+ *
+ * The producer fills the fast ring (tightly coupled RAM, next to the
+ * receive path). When it is full the producer switches to the spill ring
+ * (DMAMEM or PSRAM, attached at setup), and it switches back once the
+ * consumer has emptied the fast ring and is within REFILL_LEVEL elements
+ * of the spill ring's end, so the slow tier only carries the backlog of a
+ * stall. While the producer spills, the fast ring holds the oldest
+ * elements; when it switches back it leaves a mark at the spill ring's
+ * end, and everything before the mark is older than anything it pushes
+ * into the fast ring after. So the consumer reads the fast ring until it
+ * is empty, then the spill ring, and whenever a mark is pending it reads
+ * the spill ring up to the mark before the fast ring again, even if the
+ * fast ring refilled between two reads. The producer only switches back
+ * with the fast ring empty, so at most one mark is pending. Without a
+ * spill ring this is just the fast ring.
+ *
+ * Keeps the high-water mark of each tier and the number of spills.
+ *
+ * @tparam T Element type (trivially copyable)
+ * @tparam FastCapacity Fast ring slots (power of two)
+ * @tparam SpillCapacity Spill ring slots (power of two), 0 = fast ring only
+ */
+template <typename T, uint32_t FastCapacity, uint32_t SpillCapacity = 0>
+class TieredRing {
+ public:
+  typedef SpscRing<T, (SpillCapacity > 0) ? SpillCapacity : 2> SpillRing;
+  static const uint32_t REFILL_LEVEL = FastCapacity / 4;
+
+  /**
+   * Use a spill ring (setup only, before the producer starts)
+   */
+  void attachSpill(SpillRing* spill) {
+    static_assert(SpillCapacity > 0, "TieredRing without a spill tier");
+    spill_ = spill;
+    clear();
+    resetStats();
+  }
+
+  // ---------- Producer side ----------
+
+  /**
+   * Append one element
+   * @return false if both tiers are full (element not stored)
+   */
+  bool push(const T& value) {
+    if (spilling_) {
+      if (!fast_.empty() || spill_->size() > REFILL_LEVEL) return pushSpill(value);
+      // Back to the fast ring: the consumer finishes the spill ring up to here first
+      spillMark_.store(spill_->writePosition(), std::memory_order_relaxed);
+      marksSet_.store(marksSet_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      spilling_ = false;
+    }
+    if (fast_.push(value)) {
+      uint32_t used = fast_.size();
+      if (used > fastPeak_) fastPeak_ = used;
+      return true;
+    }
+    if (!spill_) return false;
+    spilling_ = true;
+    spills_ = spills_ + 1;
+    return pushSpill(value);
+  }
+
+  // ---------- Consumer side ----------
+
+  /**
+   * Largest contiguous readable region, from whichever tier holds the
+   * oldest elements
+   */
+  uint32_t readSpan(const T*& ptr) {
+    spanInSpill_ = false;
+    if (!readingSpill_) {
+      uint32_t available = fast_.readSpan(ptr);
+      if (!spill_) return available;
+      // Checked after the fast ring: if what it holds was pushed after a
+      // switch back, the mark is visible here and the spill ring goes first
+      bool markPending = marksSet_.load(std::memory_order_acquire) != marksPassed_;
+      if (!markPending && (available > 0 || spill_->empty())) return available;
+      readingSpill_ = true;             // The spill ring holds the older elements
+    }
+    uint32_t available = spill_->readSpan(ptr);
+    if (marksSet_.load(std::memory_order_acquire) != marksPassed_) {
+      uint32_t left = spillMark_.load(std::memory_order_relaxed) - spill_->readPosition();
+      if (left == 0) {
+        // Spilled elements done: back to the fast ring
+        marksPassed_++;
+        readingSpill_ = false;
+        return fast_.readSpan(ptr);
+      }
+      if (available > left) available = left;
+    }
+    spanInSpill_ = true;
+    return available;
+  }
+
+  /**
+   * Release count elements of the last readSpan()
+   */
+  void consumeRead(uint32_t count) {
+    if (spanInSpill_) spill_->consumeRead(count);
+    else fast_.consumeRead(count);
+  }
+
+  /**
+   * Discard everything currently readable (consumer side only)
+   */
+  void clear() {
+    fast_.clear();
+    if (spill_) spill_->clear();
+    marksPassed_ = marksSet_.load(std::memory_order_acquire);
+    readingSpill_ = false;
+  }
+
+  /**
+   * Forget high-water marks and spill count (while the producer is stopped)
+   */
+  void resetStats() {
+    fastPeak_ = 0;
+    spillPeak_ = 0;
+    spills_ = 0;
+  }
+
+  // ---------- Either side ----------
+
+  uint32_t size() const { return fast_.size() + spillSize(); }
+  uint32_t capacity() const { return FastCapacity + spillCapacity(); }
+  bool empty() const { return size() == 0; }
+
+  uint32_t fastSize() const { return fast_.size(); }
+  uint32_t spillSize() const { return spill_ ? spill_->size() : 0; }
+  uint32_t fastCapacity() const { return FastCapacity; }
+  uint32_t spillCapacity() const { return spill_ ? SpillCapacity : 0; }
+  uint32_t fastPeak() const { return fastPeak_; }
+  uint32_t spillPeak() const { return spillPeak_; }
+  uint32_t spills() const { return spills_; }           // Times the fast ring overflowed into the spill ring
+  bool spilling() const { return spilling_; }
+
+ private:
+  bool pushSpill(const T& value) {
+    if (!spill_->push(value)) return false;
+    uint32_t used = spill_->size();
+    if (used > spillPeak_) spillPeak_ = used;
+    return true;
+  }
+
+  SpscRing<T, FastCapacity> fast_;
+  SpillRing* spill_ = nullptr;
+
+  // Producer side
+  volatile bool spilling_ = false;
+  std::atomic<uint32_t> spillMark_{0};   // Spill ring position where the last spill ended
+  std::atomic<uint32_t> marksSet_{0};    // Spills ended (a mark was left)
+  volatile uint32_t fastPeak_ = 0;
+  volatile uint32_t spillPeak_ = 0;
+  volatile uint32_t spills_ = 0;
+
+  // Consumer side
+  uint32_t marksPassed_ = 0;             // Marks read up to
+  bool readingSpill_ = false;            // Reading the spill ring's older elements
+  bool spanInSpill_ = false;             // Tier of the last readSpan()
+};
+
+#endif // RINGBUFFER_H
@@ -11,6 +11,57 @@
 
 #include <Arduino.h>
 
+#include "CaptureSettings.h"
+
+// ==================== Main Loop Tasks ====================
+// Run by the scheduler in loop(); each returns true if it found work
+
+/**
+ * Capture drain: move what the DMA engine received into the channels'
+ * rings (CAPTURE_UART_DMA), then merge, frame and encode the rings into
+ * the SD writer (CaptureEngine::drain()), holding back samples newer
+ * than the merge guard
+ */
+bool captureTask();
+
+/**
+ * SD writer: one sector, sync or index write per run while capturing
+ * (CaptureEngine::serviceStorage())
+ */
+bool storageTask();
+
+/**
+ * Live stream: send queued batches the USB port has room for
+ */
+bool liveTask();
+
+/**
+ * Command parser: one command character per run, once any status report
+ * has been sent
+ */
+bool commandTask();
+
+/**
+ * Baud detection and rate tracking (serviceBaudDetector())
+ */
+bool baudTask();
+
+/**
+ * Send the rendered status report as the USB port takes it
+ */
+bool statusTask();
+
+/**
+ * Blink the status LED while capturing (periodic)
+ */
+bool ledTask();
+
+/**
+ * Wait after a pass in which no task found work
+ * @param us Longest wait; ends early when a command arrives
+ */
+void idleWait(uint32_t us);
+
 // ==================== Function Prototypes ====================
 
 /**
@@ -20,67 +71,193 @@ void printMenu();
 
 /**
  * Process incoming commands from the debug serial port
- * Handles: s/S (start), t/T (stop), n/N (new file), c/C (clear), i/I (info), h/H (help)
+ * Handles: s/S (start), t/T (stop), n/N (new file), c/C (clear), f/F (format), i/I (info), h/H (help)
  */
 void handleCommand();
 
 /**
- * Start data capture session
- * Initializes baud rate detection and opens log file
+ * Start data capture session at the current baud rate
+ * Opens the log file, starts the capture ports and, if BAUD_MONITOR_PIN
+ * is wired, tracks line rate changes
  */
 void startCapture();
 
 /**
- * Stop active data capture session
+ * Stop active data capture session (or cancel baud detection)
  * Closes log file and ends target serial communication
  */
 void stopCapture();
 
 /**
- * Create a new capture file on SD card
- * Generates unique filename and writes CSV header
+ * Start a new capture session
+ * Allocates the next session number; if capturing, closes the current
+ * file and continues in part 0 of the new session
  */
 void newCaptureFile();
 
+/**
+ * Switch between binary and CSV log formats
+ * Takes effect on the next capture file; refused while capturing
+ */
+void toggleLogFormat();
+void toggleLiveStream();
+
+/**
+ * Switch LZ4 block compression of binary logs on or off
+ * Takes effect on the next capture file; refused while capturing
+ */
+void toggleCompression();
+
+/**
+ * Switch trigger mode on or off: log only windows around TRIGGER_PATTERNS
+ * Takes effect on the next capture; refused while capturing
+ */
+void toggleTriggerMode();
+
+// ==================== Capture Ports and Settings ====================
+
+/**
+ * Check whether capture port index is enabled in settings.portMask
+ */
+bool portEnabled(uint32_t index);
+
+/**
+ * Start the enabled capture ports at the current baud rate and line format
+ * @param origin Cycle counter value their timestamps count from
+ */
+void startPorts(uint32_t origin);
+
+/**
+ * Stop the enabled capture ports; the channels keep their samples
+ */
+void stopPorts();
+
+/**
+ * Switch to the next of LINE_FORMATS; refused while capturing
+ */
+void nextLineFormat();
+
+/**
+ * Switch to the next non-empty set of enabled capture ports; refused
+ * while capturing
+ */
+void nextPortMask();
+
+/**
+ * Switch to the next of ROTATE_INTERVALS_MS (part file time limit)
+ */
+void nextRotateInterval();
+
+/**
+ * Switch capture at power-up on or off (kept by saveSettings())
+ */
+void toggleAutoCapture();
+
+/**
+ * Fill in the compiled-in default settings
+ * @param defaults Settings to initialize (sealed)
+ */
+void defaultSettings(CaptureSettings& defaults);
+
+/**
+ * Read the settings saved in EEPROM into settings, or use the defaults
+ * if there are none (or they are not valid for this build)
+ */
+void loadSettings();
+
+/**
+ * Save the current configuration to EEPROM
+ */
+void saveSettings();
+
+/**
+ * Invalidate the saved settings; the defaults apply at the next power-up
+ */
+void eraseSettings();
+
+/**
+ * Record bootFirstByteUs once the capture started at boot has logged a byte
+ */
+void noteBootFirstByte();
+
 /**
  * Clear the internal capture buffer
- * Resets buffer index and zeroes buffer memory
+ * Discards everything queued in the receive ring
  */
 void clearBuffer();
 
 /**
- * Display current system status to debug serial
- * Shows: state, baud rate, file, bytes received, buffer usage, SD card status, uptime
+ * Print current system status (into statusText; the status task sends it)
+ * Shows: state, baud rate and line format, file, settings and boot
+ * timing, bytes received, buffer usage, SD card status, stage
+ * latencies, main loop tasks, uptime
+ */
+void printStatus(Print& out);
+
+/**
+ * Print status, counters, stage latency histograms and main loop task
+ * statistics as one JSON line
+ * Names match the METRIC records in the capture file.
+ */
+void printStatusJson(Print& out);
+
+/**
+ * Write ,"name":value into the JSON status line
+ */
+void printJsonCounter(Print& out, const char* name, uint64_t value);
+
+/**
+ * Convert cycle counter ticks to microseconds
+ */
+float ticksToMicros(uint32_t ticks);
+
+/**
+ * Begin background baud rate detection on Serial1's RX pin
+ * Returns at once; serviceBaudDetector() reports the lock or timeout.
+ * Refused while capturing (the rate is tracked instead)
+ */
+void startBaudDetection();
+
+/**
+ * Detach the edge interrupt and stop the baud detector (if running)
+ */
+void stopBaudDetector();
+
+/**
+ * Advance the baud detector (the baud task, every loop pass)
+ * On a lock: adopts the rate. On a timeout: prompts for manual input.
+ * On a rate change during capture: re-locks the capture ports
+ */
+void serviceBaudDetector();
+
+/**
+ * Adopt the rate found by a completed detection and return to IDLE
  */
-void printStatus();
+void finishBaudDetection();
 
 /**
- * Detect baud rate of target serial communication
- * Uses pulse width measurement on RX line to determine baud rate
- * Timeout: 10 seconds, prompts for manual input if fails
+ * Re-lock the capture ports to a new line rate mid-session
+ * Records a BAUD_CHANGE event in the capture log (queued again on later
+ * passes while the engine's event queue is full)
+ * @param baud New line rate
  */
-void detectBaudRate();
+void relockCapture(uint32_t baud);
 
 /**
- * Find the shortest consistent pulse width from captured timings
- * @param pulses Array of pulse width measurements in microseconds
- * @param count Number of pulses in array
- * @return Shortest consistent pulse width, or 0 if none found
+ * Hand the pending BAUD_CHANGE event to the capture engine, stamped when
+ * the ports were re-locked; stays pending if the event queue is full
  */
-uint32_t findShortestConsistentPulse(uint32_t* pulses, int count);
+void queueRateEvent();
 
 /**
- * Round a raw baud rate to nearest standard baud rate
- * @param rawBaud Calculated baud rate from pulse measurement
- * @return Nearest standard baud rate (9600, 19200, 38400, 57600, 115200), or 0 if too far
+ * Give up on the pending BAUD_CHANGE event and report it
  */
-uint32_t roundToStandardBaud(uint32_t rawBaud);
+void dropRateEvent();
 
 /**
- * Validate detected baud rate by attempting to read data
- * @return true if baud rate appears valid, false otherwise
+ * Edge interrupt handler: passes the cycle counter to the baud detector
  */
-bool validateBaudRate();
+void edgeDetectionISR();
 
 /**
  * Prompt user to manually select baud rate
@@ -95,14 +272,13 @@ void promptManualBaudRate();
 void handleManualBaudInput(char input);
 
 /**
- * Capture incoming data from target serial port
- * Stores data in buffer and logs to SD card
+ * Print a CaptureEngine status/error message to debug serial
+ * @param message One line, no newline
  */
-void captureData();
+void printEngineMessage(const char* message);
 
 /**
- * Blink the status LED to indicate activity
- * Non-blocking blink at 500ms intervals
+ * Toggle the status LED (the led task runs it every 500 ms while capturing)
  */
 void blinkLED();
 
@@ -0,0 +1,437 @@
+/*
+ * SerialSniffer - Pattern Triggers
+ *
+ * Trigger mode logs only windows of traffic around byte patterns instead
+ * of everything. Two parts:
+ *
+ * TriggerMatcher checks a set of patterns against every captured byte in
+ * one pass, per channel, with the bit-parallel Shift-And method: all
+ * patterns are laid end to end in one state bit vector, each byte costs a
+ * shift, an OR and an AND per word of it (8 words for 256 pattern bytes)
+ * however many patterns there are, and masks and wildcards are free since
+ * they only change the per-byte-value table. A pattern can be anchored to
+ * the start of a packet (the framer's PACKET_START) to trigger on packet
+ * headers only.
+ *
+ * TriggerHistory is the pre-trigger ring: records in the delta record
+ * encoding, each relative to the one before it in the ring, in a large
+ * buffer the caller provides (DMAMEM or EXTMEM). CaptureEngine keeps the
+ * last pre-trigger interval in it and, on a hit, takes records out of it
+ * into the log until the post-trigger interval has passed.
+ *
+ * Pattern text: hex bytes separated by spaces, with
+ *   ??        any byte
+ *   4? / ?1   a nibble wildcard
+ *   41/DF     value and mask (bits where the mask is 0 are ignored)
+ *   'OK\r\n'  ASCII (escapes \r \n \t \\ \' \xHH)
+ *   ^         first token: the pattern must start a packet
+ *   RX: TX: CH2: ...  prefix: only on that channel
+ * e.g. "^01 03", "TX: 'ERR'", "AA 55 ?? 0?/0F".
+ *
+ * Free of Arduino dependencies so the matcher can be benchmarked on the
+ * host.
+ *
+ * Author: SerialSniffer Team
+ * License: TBD
+ */
+
+#ifndef TRIGGERENGINE_H
+#define TRIGGERENGINE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CaptureFormat.h"
+
+// ==================== Patterns ====================
+
+const uint32_t TRIGGER_MAX_PATTERN_BYTES = 32;
+const uint8_t TRIGGER_ALL_CHANNELS = 0xFF;
+const int32_t TRIGGER_NO_MATCH = -1;
+
+/**
+ * One compiled pattern: a byte matches position i if
+ * (byte & mask[i]) == value[i]
+ */
+struct TriggerPattern {
+  uint8_t value[TRIGGER_MAX_PATTERN_BYTES];
+  uint8_t mask[TRIGGER_MAX_PATTERN_BYTES];
+  uint8_t length = 0;
+  uint8_t channels = TRIGGER_ALL_CHANNELS;    // Bit per CaptureChannelId
+  bool packetStart = false;                   // Only at the start of a packet
+
+  void add(uint8_t byteValue, uint8_t byteMask) {
+    value[length] = byteValue & byteMask;
+    mask[length] = byteMask;
+    length++;
+  }
+};
+
+inline int triggerHexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/**
+ * Parse pattern text (see the file comment)
+ * @return false on a syntax error, an empty pattern or one longer than
+ *         TRIGGER_MAX_PATTERN_BYTES
+ */
+inline bool parseTriggerPattern(const char* text, TriggerPattern& pattern) {
+  pattern = TriggerPattern();
+  const char* at = text;
+  while (*at == ' ') at++;
+
+  // Channel prefix ("RX:", "CH3:")
+  size_t prefix = 0;
+  while ((at[prefix] >= 'A' && at[prefix] <= 'Z') || (at[prefix] >= '0' && at[prefix] <= '9')) prefix++;
+  if (at[prefix] == ':') {
+    bool found = false;
+    for (uint8_t channel = 0; channel < MAX_CAPTURE_CHANNELS && !found; channel++) {
+      const char* name = captureChannelName(channel);
+      if (strlen(name) == prefix && strncmp(name, at, prefix) == 0) {
+        pattern.channels = (uint8_t)(1u << channel);
+        found = true;
+      }
+    }
+    if (!found) return false;
+    at += prefix + 1;
+  }
+
+  while (*at == ' ') at++;
+  if (*at == '^') {
+    pattern.packetStart = true;
+    at++;
+  }
+
+  for (;;) {
+    while (*at == ' ' || *at == ',') at++;
+    if (*at == '\0') break;
+    if (pattern.length == TRIGGER_MAX_PATTERN_BYTES) return false;
+
+    if (*at == '\'') {
+      // ASCII literal
+      for (at++; *at != '\''; at++) {
+        if (*at == '\0' || pattern.length == TRIGGER_MAX_PATTERN_BYTES) return false;
+        uint8_t c = (uint8_t)*at;
+        if (c == '\\') {
+          at++;
+          switch (*at) {
+            case 'r': c = '\r'; break;
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case '\\': c = '\\'; break;
+            case '\'': c = '\''; break;
+            case 'x': {
+              int high = triggerHexDigit(at[1]);
+              int low = high < 0 ? -1 : triggerHexDigit(at[2]);
+              if (low < 0) return false;
+              c = (uint8_t)(high << 4 | low);
+              at += 2;
+              break;
+            }
+            default: return false;
+          }
+        }
+        pattern.add(c, 0xFF);
+      }
+      at++;
+      continue;
+    }
+
+    // Two hex digits or '?' nibbles, then an optional /mask
+    uint8_t value = 0;
+    uint8_t mask = 0;
+    for (int nibble = 0; nibble < 2; nibble++) {
+      int shift = nibble == 0 ? 4 : 0;
+      if (at[nibble] == '?') continue;
+      int digit = triggerHexDigit(at[nibble]);
+      if (digit < 0) return false;
+      value |= (uint8_t)(digit << shift);
+      mask |= (uint8_t)(0x0F << shift);
+    }
+    at += 2;
+    if (*at == '/') {
+      int high = triggerHexDigit(at[1]);
+      int low = high < 0 ? -1 : triggerHexDigit(at[2]);
+      if (low < 0) return false;
+      mask &= (uint8_t)(high << 4 | low);
+      at += 3;
+    }
+    if (*at != '\0' && *at != ' ' && *at != ',') return false;
+    pattern.add(value, mask);
+  }
+  return pattern.length > 0;
+}
+
+/**
+ * Trigger mode configuration (CaptureEngineConfig::trigger)
+ */
+const uint32_t TRIGGER_MAX_PATTERNS = 16;
+
+struct TriggerConfig {
+  const char* patterns[TRIGGER_MAX_PATTERNS] = {nullptr};   // Pattern text, nullptr = unused
+  uint32_t preTriggerMs = 100;        // Logged before the byte that completed a pattern
+  uint32_t postTriggerMs = 1000;      // ... and after it; a hit inside a window extends it
+  uint8_t* history = nullptr;         // Pre-trigger ring (large RAM), nullptr = no trigger mode
+  uint32_t historyBytes = 0;
+  bool enabled = false;               // Trigger mode from the first capture
+
+  bool addPattern(const char* text) {
+    for (const char*& slot : patterns) {
+      if (!slot) {
+        slot = text;
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/**
+ * Trigger mode counters (per capture)
+ */
+struct TriggerStats {
+  uint32_t hits = 0;
+  uint32_t windows = 0;               // Hits outside an open window
+  uint32_t shortWindows = 0;          // Windows whose pre-trigger part did not fit in the history
+  uint64_t recordsKept = 0;           // Taken into the log
+  uint64_t recordsDiscarded = 0;      // Aged out of the history
+  int32_t lastPattern = TRIGGER_NO_MATCH;
+  uint64_t lastHitTicks = 0;
+};
+
+// ==================== Matcher ====================
+
+inline uint32_t triggerLowestBit(uint32_t word) { return (uint32_t)__builtin_ctz(word); }
+inline uint32_t triggerLowestBit(uint64_t word) { return (uint32_t)__builtin_ctzll(word); }
+
+/**
+ * Multi-pattern Shift-And matcher over up to MAX_CAPTURE_CHANNELS channels
+ *
+ * Pattern p owns state bits [offset, offset + length); bit offset + i is
+ * set after a byte when the last i + 1 bytes match its first i + 1
+ * positions. Per byte: D = ((D << 1) & ~starts | starts') & table[byte],
+ * where starts' holds the unanchored start bits (and, at a packet start,
+ * the anchored ones too), and a pattern matched when its last bit is set.
+ * The & ~starts keeps one pattern's end from running into the next.
+ *
+ * @tparam StateBits Total pattern bytes that fit (a multiple of the word size)
+ * @tparam Word uint32_t on the Teensy, uint64_t where it is native
+ */
+template <uint32_t StateBits, typename Word = uint32_t>
+class TriggerMatcher {
+ public:
+  static const uint32_t WORD_BITS = sizeof(Word) * 8;
+  static const uint32_t WORDS = (StateBits + WORD_BITS - 1) / WORD_BITS;
+  static_assert(WORDS * WORD_BITS <= 65536, "Pattern bit index must fit in uint16_t");
+
+  TriggerMatcher() { clear(); }
+
+  /**
+   * Remove every pattern
+   */
+  void clear() {
+    memset(table_, 0, sizeof(table_));
+    memset(starts_, 0, sizeof(starts_));
+    memset(anchored_, 0, sizeof(anchored_));
+    memset(finals_, 0, sizeof(finals_));
+    bits_ = 0;
+    words_ = 0;
+    patterns_ = 0;
+    reset();
+  }
+
+  /**
+   * Add a pattern
+   * @return Its index (returned by step() when it matches), or
+   *         TRIGGER_NO_MATCH if the state bits are used up
+   */
+  int32_t add(const TriggerPattern& pattern) {
+    if (pattern.length == 0 || bits_ + pattern.length > WORDS * WORD_BITS) return TRIGGER_NO_MATCH;
+    uint32_t offset = bits_;
+    for (uint32_t i = 0; i < pattern.length; i++) {
+      uint32_t bit = offset + i;
+      Word flag = (Word)1 << (bit % WORD_BITS);
+      for (uint32_t value = 0; value < 256; value++) {
+        if ((value & pattern.mask[i]) == pattern.value[i]) table_[value][bit / WORD_BITS] |= flag;
+      }
+    }
+    Word first = (Word)1 << (offset % WORD_BITS);
+    if (pattern.packetStart) anchored_[offset / WORD_BITS] |= first;
+    else starts_[offset / WORD_BITS] |= first;
+    uint32_t last = offset + pattern.length - 1;
+    for (uint32_t channel = 0; channel < MAX_CAPTURE_CHANNELS; channel++) {
+      if (pattern.channels & (1u << channel)) finals_[channel][last / WORD_BITS] |= (Word)1 << (last % WORD_BITS);
+    }
+    patternAt_[last] = (uint16_t)patterns_;
+    bits_ += pattern.length;
+    words_ = (bits_ + WORD_BITS - 1) / WORD_BITS;
+    return (int32_t)patterns_++;
+  }
+
+  /**
+   * Forget partial matches (a new capture)
+   */
+  void reset() { memset(state_, 0, sizeof(state_)); }
+
+  /**
+   * Feed one byte of a channel
+   * @param packetStart The byte is the first of a packet
+   * @return Index of a pattern that ends at this byte (the lowest if
+   *         several do), or TRIGGER_NO_MATCH
+   */
+  int32_t step(uint8_t channel, uint8_t value, bool packetStart) {
+    Word* state = state_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+    const Word* accept = table_[value];
+    const Word* finals = finals_[channel & (MAX_CAPTURE_CHANNELS - 1)];
+    Word carry = 0;
+    Word hit = 0;
+    for (uint32_t w = 0; w < words_; w++) {
+      Word starts = starts_[w] | anchored_[w];
+      Word entering = packetStart ? starts : starts_[w];
+      Word next = ((((state[w] << 1) | carry) & ~starts) | entering) & accept[w];
+      carry = state[w] >> (WORD_BITS - 1);
+      state[w] = next;
+      hit |= next & finals[w];
+    }
+    if (!hit) return TRIGGER_NO_MATCH;
+    for (uint32_t w = 0; w < words_; w++) {
+      Word matched = state[w] & finals[w];
+      if (matched) return patternAt_[w * WORD_BITS + triggerLowestBit(matched)];
+    }
+    return TRIGGER_NO_MATCH;
+  }
+
+  uint32_t patterns() const { return patterns_; }
+  uint32_t bitsUsed() const { return bits_; }
+
+ private:
+  Word table_[256][WORDS];                      // Positions each byte value matches
+  Word starts_[WORDS];                          // First bits of unanchored patterns
+  Word anchored_[WORDS];                        // First bits of packet-start patterns
+  Word finals_[MAX_CAPTURE_CHANNELS][WORDS];    // Last bits of patterns watching the channel
+  Word state_[MAX_CAPTURE_CHANNELS][WORDS];
+  uint16_t patternAt_[WORDS * WORD_BITS];       // Pattern index by last bit
+  uint32_t bits_ = 0;
+  uint32_t words_ = 0;
+  uint32_t patterns_ = 0;
+};
+
+// ==================== History ====================
+
+/**
+ * One record taken from the history
+ */
+struct TriggerRecord {
+  uint64_t ticks;
+  uint64_t argument;
+  uint8_t kind;
+  uint8_t channel;
+  uint8_t value;
+  uint8_t status;
+};
+
+/**
+ * Ring of encoded records, oldest out first
+ */
+class TriggerHistory {
+ public:
+  /**
+   * Use a buffer (setup only)
+   */
+  void begin(uint8_t* buffer, uint32_t size) {
+    buffer_ = buffer;
+    size_ = buffer ? size : 0;
+    clear();
+  }
+
+  void clear() {
+    head_ = tail_ = used_ = 0;
+    headTicks_ = tailTicks_ = 0;
+    peekLength_ = 0;
+  }
+
+  uint32_t capacity() const { return size_; }
+  uint32_t used() const { return used_; }
+  uint32_t freeSpace() const { return size_ - used_; }
+  bool empty() const { return used_ == 0; }
+  uint64_t newestTicks() const { return headTicks_; }
+
+  /**
+   * Append a record (caller checks freeSpace() >= MAX_EVENT_RECORD_SIZE)
+   */
+  void push(uint64_t ticks, uint8_t kind, uint8_t channel, uint8_t value, uint8_t status, uint64_t argument) {
+    uint8_t record[MAX_EVENT_RECORD_SIZE];
+    uint64_t delta = ticks > headTicks_ ? ticks - headTicks_ : 0;
+    uint32_t length = (kind == RECORD_KIND_DATA)
+                          ? encodeDeltaRecord(record, delta, kind, channel, value, status)
+                          : encodeEventRecord(record, delta, kind, channel, value, status, argument);
+    copyIn(record, length);
+    headTicks_ += delta;
+  }
+
+  /**
+   * Decode the oldest record without removing it (kept decoded until pop())
+   * @return false if the history is empty
+   */
+  bool peek(TriggerRecord& record) {
+    if (empty()) return false;
+    if (peekLength_ > 0) {
+      record = oldest_;
+      return true;
+    }
+    uint8_t bytes[MAX_EVENT_RECORD_SIZE];
+    uint32_t available = used_ < MAX_EVENT_RECORD_SIZE ? used_ : MAX_EVENT_RECORD_SIZE;
+    copyOut(bytes, available);
+    DeltaRecord decoded = {};
+    peekLength_ = decodeDeltaRecord(bytes, available, decoded);
+    oldest_.ticks = tailTicks_ + decoded.deltaTicks;
+    oldest_.argument = decoded.argument;
+    oldest_.kind = decoded.kind;
+    oldest_.channel = decoded.channel;
+    oldest_.value = decoded.value;
+    oldest_.status = decoded.status;
+    record = oldest_;
+    return true;
+  }
+
+  /**
+   * Remove the record peek() returned
+   */
+  void pop() {
+    tail_ = (tail_ + peekLength_) % size_;
+    used_ -= peekLength_;
+    tailTicks_ = oldest_.ticks;
+    peekLength_ = 0;
+  }
+
+ private:
+  void copyIn(const uint8_t* data, uint32_t length) {
+    uint32_t first = length < size_ - head_ ? length : size_ - head_;
+    memcpy(buffer_ + head_, data, first);
+    memcpy(buffer_, data + first, length - first);
+    head_ = (head_ + length) % size_;
+    used_ += length;
+  }
+
+  void copyOut(uint8_t* data, uint32_t length) const {
+    uint32_t first = length < size_ - tail_ ? length : size_ - tail_;
+    memcpy(data, buffer_ + tail_, first);
+    memcpy(data + first, buffer_, length - first);
+  }
+
+  uint8_t* buffer_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t head_ = 0;             // Next write offset
+  uint32_t tail_ = 0;             // Oldest record's offset
+  uint32_t used_ = 0;
+  uint64_t headTicks_ = 0;        // Newest record's time: next delta base
+  uint64_t tailTicks_ = 0;        // Time before the oldest record: its delta base
+  TriggerRecord oldest_;          // Decoded by peek() while peekLength_ > 0
+  uint32_t peekLength_ = 0;
+};
+
+#endif // TRIGGERENGINE_H
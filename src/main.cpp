@@ -4,10 +4,15 @@
  * Hardware: Teensy 4.1
  * Features:
  *   - Automatic baud rate detection
- *   - Checksum detection and validation
- *   - Packet analysis
+ *   - Checksum detection and validation (XOR, sum, CRC-8, CRC-16)
+ *   - Packet framing (idle gap, delimiters, maximum length)
+ *   - Pattern triggers: log only windows around byte patterns
  *   - SD card data logging
- *   - Real-time serial monitoring
+ *   - Live binary record stream to the host over a second USB serial port
+ *   - Per-stage counters and latency histograms (status, JSON status, log)
+ *   - Cooperative prioritized main loop tasks with run time accounting
+ *   - Optional eDMA circular receive instead of per-character interrupts
+ *   - Settings saved in EEPROM; headless capture from power-up
  *
  * Author: SerialSniffer Team
  * License: TBD
@@ -15,36 +20,272 @@
 
 #include <SD.h>
 #include <SPI.h>
+#include <EEPROM.h>
 #include "SerialSniffer.h"
+#include "CaptureFormat.h"
+#include "CaptureSettings.h"
+#include "RingBuffer.h"
+#include "CaptureChannel.h"
+#include "DmaReceive.h"
+#include "ChecksumEngine.h"
+#include "LiveStream.h"
+#include "BaudDetector.h"
+#include "CaptureEngine.h"
+#include "HalTeensy.h"
+#include "Instrumentation.h"
+#include "StatusText.h"
+#include "TaskScheduler.h"
 
 // ==================== Configuration ====================
 
+const char* FIRMWARE_VERSION = "0.1.0";
+
 // Pin definitions
 const int LED_PIN = 13;           // Built-in LED for status indication
 const int SD_CS_PIN = BUILTIN_SDCARD;  // Teensy 4.1 built-in SD card
 
 // Serial port configuration
-#define TARGET_SERIAL Serial1     // Hardware serial for monitoring
+#define TARGET_SERIAL Serial1     // Hardware serial for baud detection (first capture port)
 #define DEBUG_SERIAL Serial       // USB serial for debugging/configuration
+#if defined(USB_DUAL_SERIAL) || defined(USB_TRIPLE_SERIAL)
+#define LIVE_SERIAL SerialUSB1    // Second USB serial: live record stream (host: ss_live)
+#endif
 
 // Buffer configuration
-const int BUFFER_SIZE = 1024;
-uint8_t rxBuffer[BUFFER_SIZE];
-int bufferIndex = 0;
+// Each capture channel has its own buffer of time-stamped samples between
+// its UART interrupt and the logging path, in two tiers (TieredRing): a
+// fast ring in RAM1 that the interrupt fills, and a large spill ring it
+// switches to while the fast ring is full, e.g. during an SD card stall.
+// 4096 + 16384 samples (32 KB in RAM1 + 128 KB in DMAMEM per channel)
+// hold ~100 ms at 2 Mbaud. With PSRAM fitted, build with
+// CAPTURE_SPILL_PSRAM for a 262144-sample spill ring (2 MB, ~1.3 s at
+// 2 Mbaud) per channel in EXTMEM. Sizes must be powers of two.
+const uint32_t CHANNEL_RING_SIZE = 4096;
+#ifdef CAPTURE_SPILL_PSRAM
+const uint32_t CHANNEL_SPILL_SIZE = 262144;
+#define SPILL_MEMORY EXTMEM
+extern "C" uint8_t external_psram_size;       // MB of PSRAM found at startup
+#else
+const uint32_t CHANNEL_SPILL_SIZE = 16384;
+#define SPILL_MEMORY DMAMEM
+#endif
+typedef CaptureChannel<CHANNEL_RING_SIZE, CHANNEL_SPILL_SIZE> UartChannel;
+
+// Capture channels: one monitored UART each, logged with its channel id
+// (the CSV Direction column). The default pass-through topology listens
+// to Device A's TX line on Serial1 (RX) and Device B's TX line on
+// Serial2 (TX). Up to eight ports can be listed; each entry instantiates
+// captureUartIsr<> for its LPUART so the interrupt handler is resolved at
+// compile time. Serial1-8 are LPUART 6, 4, 2, 3, 8, 1, 7, 5.
+//
+// Build with CAPTURE_UART_DMA to receive by eDMA instead: each LPUART
+// feeds a circular buffer of DMA_RX_WORDS without an interrupt per
+// character, and the capture task moves what arrived into the channel
+// rings (DmaReceive.h). Interrupts remain for the idle line, which dates
+// the end of each burst, and for each lap of the buffer. This is for
+// several ports at multi-Mbaud rates, where per-character interrupts use
+// up the CPU. 8192 words (16 KB in RAM1 per port) hold ~20 ms at 4 Mbaud
+// between capture task runs; each entry also names the port's DMA
+// request source.
+template <uint32_t LpuartAddress, uint32_t Index>
+void captureUartIsr();
+
+#ifdef CAPTURE_UART_DMA
+const uint32_t DMA_RX_WORDS = 8192;
+typedef DmaRxRing<DMA_RX_WORDS> UartDmaRing;
+typedef TeensyDmaSerialPort<UartChannel, UartDmaRing> CapturePort;
+
+template <uint32_t Index>
+void captureLapIsr();
+
+extern UartChannel captureChannels[];
+extern UartDmaRing dmaRings[];
+extern DMAChannel dmaChannels[];
+
+const CapturePort capturePorts[] = {
+  {&Serial1, &IMXRT_LPUART6, IRQ_LPUART6, captureUartIsr<IMXRT_LPUART6_ADDRESS, 0>, captureLapIsr<0>,
+   DMAMUX_SOURCE_LPUART6_RX, CHANNEL_RX, &captureChannels[0], &dmaRings[0], &dmaChannels[0]},
+  {&Serial2, &IMXRT_LPUART4, IRQ_LPUART4, captureUartIsr<IMXRT_LPUART4_ADDRESS, 1>, captureLapIsr<1>,
+   DMAMUX_SOURCE_LPUART4_RX, CHANNEL_TX, &captureChannels[1], &dmaRings[1], &dmaChannels[1]},
+};
+#else
+typedef TeensySerialPort CapturePort;
 
+const CapturePort capturePorts[] = {
+  {&Serial1, &IMXRT_LPUART6, IRQ_LPUART6, captureUartIsr<IMXRT_LPUART6_ADDRESS, 0>, CHANNEL_RX},
+  {&Serial2, &IMXRT_LPUART4, IRQ_LPUART4, captureUartIsr<IMXRT_LPUART4_ADDRESS, 1>, CHANNEL_TX},
+};
+#endif
+const uint32_t CAPTURE_CHANNEL_COUNT = sizeof(capturePorts) / sizeof(capturePorts[0]);
+
+UartChannel captureChannels[CAPTURE_CHANNEL_COUNT];
+SPILL_MEMORY UartChannel::SpillRing spillRings[CAPTURE_CHANNEL_COUNT];
+#ifdef CAPTURE_UART_DMA
+UartDmaRing dmaRings[CAPTURE_CHANNEL_COUNT];
+DMAChannel dmaChannels[CAPTURE_CHANNEL_COUNT];
+#endif
 // Baud rate detection
+// RX line edges are timed by the edge interrupt and solved in the
+// background by BaudDetector, so commands and capture keep running.
+// Before a capture it listens on Serial1's RX pin itself; during a capture
+// that pin belongs to the LPUART, so rate tracking listens on
+// BAUD_MONITOR_PIN, which must be wired to the same line. Off by default:
+// with a jumper from pin 2 to pin 0, set BAUD_MONITOR_PIN to 2.
 const long baudRates[] = {9600, 19200, 38400, 57600, 115200};
+const uint32_t DEFAULT_BAUD_RATE = 9600;
 const int numBaudRates = sizeof(baudRates) / sizeof(baudRates[0]);
+const uint8_t BAUD_MONITOR_NONE = 0xFF;
+const uint8_t BAUD_DETECT_PIN = 0;            // Serial1 RX, while the port is stopped
+const uint8_t BAUD_MONITOR_PIN = BAUD_MONITOR_NONE;  // 2 when jumpered to pin 0
 long detectedBaud = 0;
+TeensyEdgeInput baudEdgeInput;
+BaudDetector baudDetector;
 
 // SD card logging
-File dataFile;
-String currentFilename = "";
+// The capture path from the channel rings to the card (time merge, record
+// encoding, sector-aligned writer, pre-allocated part files and rollover)
+// is CaptureEngine, written against the HAL so host/sim/ runs the same
+// code. Capture files are pre-allocated as one contiguous extent so the
+// FAT is not touched while logging; a session rolls over to the next part
+// file when the extent is full or the time limit is reached.
+const uint32_t SD_WRITER_BLOCKS = 8;                            // 8 x 512 bytes
+const uint32_t SD_SYNC_INTERVAL_MS = 1000;                      // Directory/FAT update period
+const uint64_t FILE_PREALLOCATE_BYTES = 64ULL * 1024 * 1024;    // Per part file
+const uint32_t FILE_ROTATE_INTERVAL_MS = 0;                     // 0 = size only
+const uint32_t INDEX_INTERVAL_RECORDS = 262144;                 // Time index (.ssi) entry spacing
+const uint32_t INDEX_INTERVAL_MS = 1000;                        // ... whichever comes first; 0, 0 = no index
+const bool COMPRESS_AT_BOOT = false;                            // Binary logs in LZ4 blocks ('z' toggles)
+const uint32_t MERGE_SLACK_CYCLES = 60000;                      // 100 us interrupt latency allowance
+
+// Packet framing
+// PacketFramer marks packets in the log with PACKET_START/PACKET_END
+// records. A packet ends after PACKET_IDLE_CHARACTERS character times of
+// silence (3.5 = Modbus RTU), on one of PACKET_DELIMITERS (the delimiter
+// is the last byte of its packet) or at PACKET_MAX_LENGTH bytes.
+const float PACKET_IDLE_CHARACTERS = 3.5f;                      // 0 = no idle framing
+const uint32_t PACKET_MAX_LENGTH = 0;                           // 0 = unlimited
+const int PACKET_DELIMITERS[] = {-1};                           // e.g. {'\n'}; negative = unused
+
+// Checksum detection
+// ChecksumEngine scores XOR, sum, CRC-8 and CRC-16 rules against every
+// framed packet and locks the one that keeps matching, per channel; each
+// packet's PACKET_END record then carries CHECKSUM_VALID or CHECKSUM_ERROR.
+// Set CHECKSUM_ALGORITHM to check one known rule instead of detecting.
+const bool CHECKSUM_DETECT = true;
+const ChecksumAlgorithm CHECKSUM_ALGORITHM = CHECKSUM_NONE;     // e.g. CHECKSUM_CRC16_MODBUS
+const uint8_t CHECKSUM_OFFSET = 0;                              // Leading bytes not covered
+const uint8_t CHECKSUM_TRAILER = 0;                             // Bytes after the checksum
+
+// Pattern triggers
+// In trigger mode ('g') only windows around pattern hits are logged:
+// TRIGGER_PRE_MS before the byte that completed a pattern to
+// TRIGGER_POST_MS after it (a hit inside a window extends it). Meanwhile
+// records wait in the pre-trigger history; it keeps at most 7/8 of
+// TRIGGER_HISTORY_BYTES (about 4 bytes per record), which at high rates
+// limits the pre-trigger part. Pattern syntax: TriggerEngine.h
+// ("^" = packet start, needs framing).
+const bool TRIGGER_AT_BOOT = false;
+const char* const TRIGGER_PATTERNS[] = {
+  "'ERROR'",                      // ASCII error text on any channel
+  "^?? 80/80",                    // Modbus RTU exception response (function code | 0x80)
+};
+const uint32_t TRIGGER_PRE_MS = 100;
+const uint32_t TRIGGER_POST_MS = 1000;
+const uint32_t TRIGGER_HISTORY_BYTES = 128 * 1024;
+DMAMEM uint8_t triggerHistory[TRIGGER_HISTORY_BYTES];
+
+// Live stream
+// With 'l', every logged record is also sent to the host in CRC-checked
+// batches (LiveStream.h) on LIVE_SERIAL, for host/tools/ss_live. Batches
+// that do not fit in the USB buffers wait in a small queue; when it is
+// full they are dropped (the host sees the sequence gap), so a slow or
+// absent host never stalls the capture. Needs a dual-serial USB build.
+const bool LIVE_STREAM_AT_BOOT = false;
+TeensyStreamPort liveStreamPort;
+
+// Instrumentation
+// Every pipeline stage (UART interrupt, ring wait, framing, encoding, SD
+// write and sync, live stream) keeps a latency histogram in cycle counter
+// ticks, and the UARTs count framing, parity and overrun errors. 'i' shows
+// a summary, 'j' everything as one JSON line; a snapshot goes into the
+// capture file as METRIC records every METRICS_INTERVAL_MS and at stop.
+// Build with -DCAPTURE_METRICS=0 to compile the latency probes out; 'i'
+// shows their estimated share of the CPU.
+const uint32_t METRICS_INTERVAL_MS = 10000;                     // 0 = no METRIC records
+
+// Main loop
+// loop() runs the work below as cooperative tasks (TaskScheduler.h),
+// highest priority first; the capture drain also runs before each of the
+// others. A task gets a run time budget and a deadline (microseconds,
+// 0 = none) and counts its overruns and misses; 'i' shows them. The loop
+// sleeps only after a pass in which no task found work, for at most
+// IDLE_SLEEP_US (CAPTURE_IDLE_SLEEP_US while capturing) or until a
+// periodic task is due. Status reports ('i', 'j') are rendered into
+// statusBuffer and sent by the status task as the USB port takes them.
+const uint32_t IDLE_SLEEP_US = 10000;
+const uint32_t CAPTURE_IDLE_SLEEP_US = 500;                     // Fast ring: ~20 ms at 2 Mbaud
+const SchedulerTask LOOP_TASKS[] = {
+  // name      body          period  budget  deadline
+  {"capture",  captureTask,       0,    500,    10000},  // Merge, framing, encoding
+  {"storage",  storageTask,       0,   2000,        0},  // One sector (or sync) per run
+  {"live",     liveTask,          0,    200,        0},  // USB live stream batches
+  {"commands", commandTask,       0,   1000,        0},
+  {"baud",     baudTask,          0,    200,        0},  // Detection and rate tracking, one solve step
+  {"status",   statusTask,        0,    200,        0},
+  {"led",      ledTask,      500000,     50,   100000},
+};
+const uint32_t LOOP_TASK_COUNT = sizeof(LOOP_TASKS) / sizeof(LOOP_TASKS[0]);
+TaskScheduler<TeensyClock, LOOP_TASK_COUNT> scheduler;
+const uint32_t STATUS_BUFFER_SIZE = 8192;
+DMAMEM char statusBuffer[STATUS_BUFFER_SIZE];
+StatusText statusText(statusBuffer, STATUS_BUFFER_SIZE);
+
+TeensyStorage sdStorage;
+CaptureEngine<TeensyHal, UartChannel, CAPTURE_CHANNEL_COUNT, SD_WRITER_BLOCKS> captureEngine;
 bool sdCardReady = false;
 
-// Statistics
-unsigned long bytesReceived = 0;
-unsigned long packetsDetected = 0;
+// Saved settings
+// The capture configuration (line rate and format, enabled ports, log
+// format, compression, trigger and part rotation settings, live stream
+// and auto-capture) is kept in EEPROM as a CaptureSettings block: 'w'
+// saves the current configuration, 'e' erases it. Without a valid block
+// the *_AT_BOOT and other defaults above apply.
+//
+// With auto-capture on ('a'), setup() starts the enabled capture ports
+// before anything else, a few ms after reset and without waiting for the
+// USB serial port; the bytes wait in the channel rings until the SD card
+// and the first part file are ready, and are logged from there. The
+// rings hold ~1.7 s at 115200 baud and ~100 ms at 2 Mbaud (more with
+// CAPTURE_SPILL_PSRAM), the DMA buffers of a CAPTURE_UART_DMA build
+// ~0.7 s at 115200 baud until the main loop runs. 'i' and 'j' show the
+// times from reset to capture, logging and the first byte. platformio.ini
+// also shortens the core's USB start-up delay before setup().
+const uint32_t SETTINGS_EEPROM_ADDRESS = 0;
+const bool AUTO_CAPTURE_AT_BOOT = false;
+const LineFormat LINE_FORMATS[] = {                             // 'p' cycles through
+  {8, PARITY_NONE, 1}, {8, PARITY_EVEN, 1}, {8, PARITY_ODD, 1},
+  {8, PARITY_NONE, 2}, {7, PARITY_EVEN, 1}, {7, PARITY_ODD, 1},
+};
+const uint32_t ROTATE_INTERVALS_MS[] = {0, 60000, 600000, 3600000};   // 'r' cycles through
+CaptureSettings settings;
+bool settingsLoaded = false;
+
+// Boot timing: micros() since reset, 0 = not reached (or no capture at boot)
+uint32_t bootCaptureUs = 0;       // Capture ports started
+uint32_t bootLoggingUs = 0;       // Capture engine started, first part file open
+uint32_t bootFirstByteUs = 0;     // First byte received (its stamp)
+bool bootFirstBytePending = false;
+bool portsRunning = false;        // Capture ports receiving (at boot: ahead of the engine)
+uint32_t portsOrigin = 0;         // Cycle counter value their timestamps count from
+
+// Line rate change the engine's event queue had no room for; queued again
+// every capture pass with its original stamp
+bool rateEventPending = false;
+uint32_t rateEventBaud = 0;
+uint32_t rateEventCycles = 0;
+
+// Statistics (per-channel byte counters live in captureChannels[].stats,
+// packet counts in captureEngine.framer())
 unsigned long startTime = 0;
 
 // State machine
@@ -57,18 +298,40 @@ enum CaptureState {
 };
 CaptureState currentState = IDLE;
 
-// Baud detection state
-volatile uint32_t edgeTimes[50];  // Store edge timestamps
-volatile int edgeCount = 0;       // Number of edges captured
-
 // ==================== Setup ====================
 
 void setup() {
-  // Initialize USB Serial for debugging
+  // Receive timestamps come from the cycle counter
+  TeensyClock::begin();
+  loadSettings();
+  detectedBaud = settings.baudRate;
+  captureEngine.setLineFormat(settingsLineFormat(settings));
+
+  // Capture channels (the engine registers them once it is configured)
+#ifdef CAPTURE_SPILL_PSRAM
+  bool spillMemory = external_psram_size > 0;
+#else
+  bool spillMemory = true;
+#endif
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    captureChannels[i].id = capturePorts[i].channelId;
+    if (spillMemory) captureChannels[i].ring.attachSpill(&spillRings[i]);
+  }
+
+  // Headless capture: receive into the rings from now on; logging starts
+  // once the SD card is up
+  if (settings.autoCapture) {
+    bootCaptureUs = micros();
+    startPorts(TeensyClock::cycles());
+  }
+
+  // Initialize USB Serial for debugging (not waited for when capturing
+  // headless)
   DEBUG_SERIAL.begin(115200);
-  while (!DEBUG_SERIAL && millis() < 3000) {
+  while (!settings.autoCapture && !DEBUG_SERIAL && millis() < 3000) {
     ; // Wait for serial port or timeout
   }
+  baudDetector.begin(TeensyClock::cycleHz(), BaudDetectConfig());
 
   // Initialize LED
   pinMode(LED_PIN, OUTPUT);
@@ -76,7 +339,8 @@ void setup() {
 
   // Welcome message
   DEBUG_SERIAL.println("========================================");
-  DEBUG_SERIAL.println("     SerialSniffer v0.1.0");
+  DEBUG_SERIAL.print("     SerialSniffer v");
+  DEBUG_SERIAL.println(FIRMWARE_VERSION);
   DEBUG_SERIAL.println("     Teensy 4.1 Serial Protocol Analyzer");
   DEBUG_SERIAL.println("========================================");
   DEBUG_SERIAL.println();
@@ -94,53 +358,140 @@ void setup() {
   }
   DEBUG_SERIAL.println();
 
-  // Set default baud rate
-  detectedBaud = 9600;
-  DEBUG_SERIAL.print("Default baud rate: ");
-  DEBUG_SERIAL.println(detectedBaud);
+  DEBUG_SERIAL.println(settingsLoaded ? "Settings: loaded from EEPROM" : "Settings: defaults");
+  DEBUG_SERIAL.println();
+
+  CaptureEngineConfig engineConfig;
+  engineConfig.preallocateBytes = (uint64_t)settings.partMegabytes * 1024 * 1024;
+  engineConfig.rotateIntervalMs = settings.rotateIntervalMs;
+  engineConfig.syncIntervalMs = SD_SYNC_INTERVAL_MS;
+  engineConfig.indexIntervalRecords = INDEX_INTERVAL_RECORDS;
+  engineConfig.indexIntervalMs = INDEX_INTERVAL_MS;
+  engineConfig.compressBlocks = settings.compress;
+  engineConfig.mergeSlackCycles = MERGE_SLACK_CYCLES;
+  engineConfig.firmwareVersion = FIRMWARE_VERSION;
+  engineConfig.framing.idleCharacters = PACKET_IDLE_CHARACTERS;
+  engineConfig.framing.maxLength = PACKET_MAX_LENGTH;
+  for (int delimiter : PACKET_DELIMITERS) {
+    if (delimiter >= 0) engineConfig.framing.addDelimiter((uint8_t)delimiter);
+  }
+  engineConfig.checksums.detect = CHECKSUM_DETECT;
+  engineConfig.checksums.fixed.algorithm = CHECKSUM_ALGORITHM;
+  engineConfig.checksums.fixed.offset = CHECKSUM_OFFSET;
+  engineConfig.checksums.fixed.trailer = CHECKSUM_TRAILER;
+  for (const char* pattern : TRIGGER_PATTERNS) engineConfig.trigger.addPattern(pattern);
+  engineConfig.trigger.preTriggerMs = settings.preTriggerMs;
+  engineConfig.trigger.postTriggerMs = settings.postTriggerMs;
+  engineConfig.trigger.history = triggerHistory;
+  engineConfig.trigger.historyBytes = TRIGGER_HISTORY_BYTES;
+  engineConfig.trigger.enabled = settings.trigger;
+  engineConfig.metricsIntervalMs = METRICS_INTERVAL_MS;
+  captureEngine.begin(sdCardReady ? &sdStorage : nullptr, engineConfig, printEngineMessage);
+  captureEngine.setLogFormat((LogFormat)settings.logFormat);
+  if (!spillMemory) DEBUG_SERIAL.println("WARNING: No PSRAM found; capture buffers have no spill tier.");
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    captureEngine.addChannel(&captureChannels[i]);
+  }
+#ifdef LIVE_SERIAL
+  liveStreamPort.begin(&LIVE_SERIAL);
+  if (settings.liveStream) captureEngine.setLivePort(&liveStreamPort);
+#endif
+
+  char format[4];
+  lineFormatName(settingsLineFormat(settings), format);
+  DEBUG_SERIAL.print("Baud rate: ");
+  DEBUG_SERIAL.print(detectedBaud);
+  DEBUG_SERIAL.print(" ");
+  DEBUG_SERIAL.println(format);
   DEBUG_SERIAL.println("Use 'd' command to auto-detect, or 'b' to set manually.");
   DEBUG_SERIAL.println();
 
   // Display menu
   printMenu();
 
+  for (const SchedulerTask& task : LOOP_TASKS) scheduler.add(task);
   startTime = millis();
+
+  // Log what the ports received since they started
+  if (settings.autoCapture) {
+    startCapture();
+    if (currentState == CAPTURING) {
+      DEBUG_SERIAL.print("Auto-capture: receiving ");
+      DEBUG_SERIAL.print(bootCaptureUs / 1000.0f, 1);
+      DEBUG_SERIAL.print(" ms after reset, logging from ");
+      DEBUG_SERIAL.print(bootLoggingUs / 1000.0f, 1);
+      DEBUG_SERIAL.println(" ms");
+    }
+  }
 }
 
 // ==================== Main Loop ====================
 
 void loop() {
-  // Handle debug commands
-  if (DEBUG_SERIAL.available()) {
-    handleCommand();
+  // Sleep only when no task found work
+  if (!scheduler.runPass()) {
+    idleWait(scheduler.idleMicros(currentState == CAPTURING ? CAPTURE_IDLE_SLEEP_US : IDLE_SLEEP_US));
   }
+}
 
-  // State machine
-  switch (currentState) {
-    case IDLE:
-      // Waiting for command
-      break;
+// Nothing to do: let the core's yield() run, until the time is up or a
+// command arrives
+void idleWait(uint32_t us) {
+  uint32_t start = micros();
+  while (micros() - start < us && !DEBUG_SERIAL.available()) {
+    yield();
+  }
+}
 
-    case DETECTING_BAUD:
-      // Detection runs from handleCommand, not here
-      break;
+// ==================== Tasks ====================
+
+bool captureTask() {
+  // Merge and log what the channels hold, as far as the SD writer has
+  // room; the rest stays in the rings for the next pass
+  // (after moving what the DMA engine received into them, with
+  // CAPTURE_UART_DMA)
+  if (currentState != CAPTURING) return false;
+  uint32_t received = 0;
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    if (portEnabled(i)) received += capturePorts[i].poll();
+  }
+  uint32_t logged = captureEngine.drain(true);
+  if (bootFirstBytePending) noteBootFirstByte();
+  if (rateEventPending) queueRateEvent();
+  return logged + received > 0;
+}
 
-    case AWAITING_MANUAL_BAUD:
-      // Waiting for user input (handled in handleCommand)
-      break;
+bool storageTask() {
+  if (currentState != CAPTURING) return false;
+  return captureEngine.serviceStorage();
+}
 
-    case CAPTURING:
-      // Capture data from target serial port
-      captureData();
-      blinkLED();
-      break;
+bool liveTask() {
+  // Also sends what is still queued after a capture
+  return captureEngine.serviceLive();
+}
 
-    case STOPPED:
-      // Capture stopped
-      break;
-  }
+bool commandTask() {
+  // Commands wait until a status report is out, so their output follows it
+  if (statusText.pending() || !DEBUG_SERIAL.available()) return false;
+  handleCommand();
+  return true;
+}
+
+bool baudTask() {
+  // Returns at once unless a solve is due or under way (one step per run;
+  // the loop doesn't sleep until it is done)
+  serviceBaudDetector();
+  return baudDetector.solving();
+}
+
+bool statusTask() {
+  return statusText.send(DEBUG_SERIAL);
+}
 
-  delay(10);
+bool ledTask() {
+  if (currentState == CAPTURING) blinkLED();
+  return false;
 }
 
 // ==================== Functions ====================
@@ -153,7 +504,18 @@ void printMenu() {
   DEBUG_SERIAL.println("  b - Set baud rate manually");
   DEBUG_SERIAL.println("  n - New capture file");
   DEBUG_SERIAL.println("  c - Clear buffer");
+  DEBUG_SERIAL.println("  f - Toggle log format (binary/CSV)");
+  DEBUG_SERIAL.println("  z - Toggle compression of binary logs");
+  DEBUG_SERIAL.println("  g - Toggle trigger mode (log only windows around patterns)");
+  DEBUG_SERIAL.println("  l - Toggle live stream to the host");
+  DEBUG_SERIAL.println("  p - Next line format (data bits, parity, stop bits)");
+  DEBUG_SERIAL.println("  o - Next set of enabled capture ports");
+  DEBUG_SERIAL.println("  r - Next part file time limit");
+  DEBUG_SERIAL.println("  a - Toggle auto-capture at power-up");
+  DEBUG_SERIAL.println("  w - Save settings to EEPROM");
+  DEBUG_SERIAL.println("  e - Erase saved settings (defaults at next power-up)");
   DEBUG_SERIAL.println("  i - Show status/info");
+  DEBUG_SERIAL.println("  j - Show status as JSON (counters and latency histograms)");
   DEBUG_SERIAL.println("  h - Show this help menu");
   DEBUG_SERIAL.println();
 }
@@ -180,10 +542,8 @@ void handleCommand() {
 
     case 'd':
     case 'D':
-      DEBUG_SERIAL.println("Starting baud rate detection...");
       DEBUG_SERIAL.println("Make sure target device is transmitting data.");
-      currentState = DETECTING_BAUD;
-      detectBaudRate();
+      startBaudDetection();
       break;
 
     case 'b':
@@ -201,9 +561,64 @@ void handleCommand() {
       clearBuffer();
       break;
 
+    case 'f':
+    case 'F':
+      toggleLogFormat();
+      break;
+
+    case 'z':
+    case 'Z':
+      toggleCompression();
+      break;
+
+    case 'g':
+    case 'G':
+      toggleTriggerMode();
+      break;
+
+    case 'l':
+    case 'L':
+      toggleLiveStream();
+      break;
+
+    case 'p':
+    case 'P':
+      nextLineFormat();
+      break;
+
+    case 'o':
+    case 'O':
+      nextPortMask();
+      break;
+
+    case 'r':
+    case 'R':
+      nextRotateInterval();
+      break;
+
+    case 'a':
+    case 'A':
+      toggleAutoCapture();
+      break;
+
+    case 'w':
+    case 'W':
+      saveSettings();
+      break;
+
+    case 'e':
+    case 'E':
+      eraseSettings();
+      break;
+
     case 'i':
     case 'I':
-      printStatus();
+      printStatus(statusText);
+      break;
+
+    case 'j':
+    case 'J':
+      printStatusJson(statusText);
       break;
 
     case 'h':
@@ -223,34 +638,51 @@ void handleCommand() {
 }
 
 void startCapture() {
-  DEBUG_SERIAL.println("Starting capture...");
-
-  // Create new log file if needed
-  if (currentFilename.length() == 0) {
-    newCaptureFile();
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("Already capturing.");
+    return;
+  }
+  if (currentState == DETECTING_BAUD) {
+    DEBUG_SERIAL.println("Baud detection still running; wait for it, or 't' to cancel.");
+    return;
   }
+  DEBUG_SERIAL.println("Starting capture...");
 
-  // Open the capture file for writing (keep it open during capture)
-  if (sdCardReady) {
-    dataFile = SD.open(currentFilename.c_str(), FILE_WRITE);
-    if (!dataFile) {
-      DEBUG_SERIAL.println("ERROR: Could not open capture file for writing.");
-      return;
+  // Allocate a session if needed; each start writes a new part file
+  // (ports receiving since boot keep their counts)
+  if (!captureEngine.sessionAllocated()) {
+    if (portsRunning) {
+      captureEngine.newSession();
+    } else {
+      newCaptureFile();
     }
   }
 
-  // Start baud rate detection
-  currentState = DETECTING_BAUD;
-  DEBUG_SERIAL.println("Detecting baud rate...");
-
-  // For now, use a default baud rate
-  // TODO: Implement auto-detection
-  detectedBaud = 9600;
-  TARGET_SERIAL.begin(detectedBaud);
+  // Timestamps count from here, or from when the ports were started at
+  // boot; each port's ISR takes over after begin()
+  bool boot = portsRunning;
+  uint32_t origin = boot ? portsOrigin : TeensyClock::cycles();
+  if (!captureEngine.start(detectedBaud, origin)) {
+    if (boot) stopPorts();
+    currentState = IDLE;
+    return;
+  }
+  if (boot) {
+    bootLoggingUs = micros();
+    bootFirstBytePending = true;
+  } else {
+    startPorts(origin);
+  }
 
   DEBUG_SERIAL.print("Using baud rate: ");
   DEBUG_SERIAL.println(detectedBaud);
 
+  // Follow the line rate for the rest of the session
+  if (BAUD_MONITOR_PIN != BAUD_MONITOR_NONE) {
+    baudDetector.monitor(detectedBaud, millis());
+    baudEdgeInput.begin(BAUD_MONITOR_PIN, edgeDetectionISR);
+  }
+
   currentState = CAPTURING;
   startTime = millis();
   DEBUG_SERIAL.println("Capture started!");
@@ -258,269 +690,811 @@ void startCapture() {
 
 void stopCapture() {
   if (currentState == CAPTURING) {
+    stopBaudDetector();
+
+    // Release the ports, then log whatever is still queued in the rings
+    // (not capturing: the merge no longer holds samples back)
+    stopPorts();
     currentState = STOPPED;
-    TARGET_SERIAL.end();
 
-    // Close file
-    if (dataFile) {
-      dataFile.close();
-    }
+    // A rate change still waiting for the event queue: last chance
+    if (rateEventPending) queueRateEvent();
+    if (rateEventPending) dropRateEvent();
+
+    // Write out buffered blocks, release unused pre-allocation and close
+    captureEngine.stop();
+    if (bootFirstBytePending) noteBootFirstByte();
+    bootFirstBytePending = false;
 
     DEBUG_SERIAL.println("Capture stopped.");
-    printStatus();
+    printStatus(statusText);
+  } else if (currentState == DETECTING_BAUD) {
+    stopBaudDetector();
+    currentState = IDLE;
+    DEBUG_SERIAL.println("Baud detection cancelled.");
   } else {
     DEBUG_SERIAL.println("Not currently capturing.");
   }
 }
 
 void newCaptureFile() {
-  // Generate unique filename
-  int fileNum = 0;
-  do {
-    currentFilename = "capture_" + String(fileNum) + ".csv";
-    fileNum++;
-  } while (SD.exists(currentFilename.c_str()));
-
-  DEBUG_SERIAL.print("Creating new capture file: ");
-  DEBUG_SERIAL.println(currentFilename);
-
-  // Open file and write header
-  if (sdCardReady) {
-    dataFile = SD.open(currentFilename.c_str(), FILE_WRITE);
-    if (dataFile) {
-      dataFile.println("Timestamp,Direction,Value_Hex,Value_ASCII,Status");
-      dataFile.close();
-      DEBUG_SERIAL.println("File created successfully.");
-    } else {
-      DEBUG_SERIAL.println("ERROR: Could not create file.");
-    }
-  }
+  // While capturing, the engine finishes the current session's file first
+  captureEngine.newSession();
 
-  // Reset statistics
-  bytesReceived = 0;
-  packetsDetected = 0;
+  // Reset statistics, with the port interrupts that count into them held off
+  noInterrupts();
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    captureChannels[i].stats.reset();
+  }
+  interrupts();
 }
 
-void clearBuffer() {
-  bufferIndex = 0;
-  memset(rxBuffer, 0, BUFFER_SIZE);
-  DEBUG_SERIAL.println("Buffer cleared.");
-}
+void toggleLogFormat() {
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("Stop capture before changing log format.");
+    return;
+  }
 
-void printStatus() {
-  unsigned long uptime = (millis() - startTime) / 1000;
+  // Next capture starts a session with the new format
+  bool binary = captureEngine.logFormat() == LOG_FORMAT_BINARY;
+  captureEngine.setLogFormat(binary ? LOG_FORMAT_CSV : LOG_FORMAT_BINARY);
 
-  DEBUG_SERIAL.println("========================================");
-  DEBUG_SERIAL.println("SerialSniffer Status");
-  DEBUG_SERIAL.println("========================================");
-  DEBUG_SERIAL.print("State: ");
-  switch (currentState) {
-    case IDLE: DEBUG_SERIAL.println("IDLE"); break;
-    case DETECTING_BAUD: DEBUG_SERIAL.println("DETECTING BAUD"); break;
-    case AWAITING_MANUAL_BAUD: DEBUG_SERIAL.println("AWAITING MANUAL INPUT"); break;
-    case CAPTURING: DEBUG_SERIAL.println("CAPTURING"); break;
-    case STOPPED: DEBUG_SERIAL.println("STOPPED"); break;
-  }
-  DEBUG_SERIAL.print("Baud Rate: ");
-  DEBUG_SERIAL.println(detectedBaud > 0 ? String(detectedBaud) : "Not detected");
-  DEBUG_SERIAL.print("Capture File: ");
-  DEBUG_SERIAL.println(currentFilename.length() > 0 ? currentFilename : "None");
-  DEBUG_SERIAL.print("Bytes Received: ");
-  DEBUG_SERIAL.println(bytesReceived);
-  DEBUG_SERIAL.print("Buffer Usage: ");
-  DEBUG_SERIAL.print(bufferIndex);
-  DEBUG_SERIAL.print("/");
-  DEBUG_SERIAL.println(BUFFER_SIZE);
-  DEBUG_SERIAL.print("SD Card: ");
-  DEBUG_SERIAL.println(sdCardReady ? "Ready" : "Not available");
-  DEBUG_SERIAL.print("Uptime: ");
-  DEBUG_SERIAL.print(uptime);
-  DEBUG_SERIAL.println(" seconds");
-  DEBUG_SERIAL.println("========================================");
+  DEBUG_SERIAL.print("Log format set to: ");
+  DEBUG_SERIAL.println(binary ? "CSV" : "Binary");
 }
 
-// ISR for edge detection
-void edgeDetectionISR() {
-  if (edgeCount < 50) {
-    edgeTimes[edgeCount++] = micros();
+void toggleCompression() {
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("Stop capture before changing compression.");
+    return;
   }
+
+  bool on = !captureEngine.compression();
+  captureEngine.setCompression(on);
+  DEBUG_SERIAL.print("Compression: ");
+  DEBUG_SERIAL.println(on ? "On (binary logs, LZ4 blocks)" : "Off");
 }
 
-void detectBaudRate() {
-  const int SAMPLE_COUNT = 50;
-  const int TIMEOUT_MS = 10000;  // 10 second timeout
-  const int MIN_SAMPLES_REQUIRED = 10;
+void toggleTriggerMode() {
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("Stop capture before changing trigger mode.");
+    return;
+  }
+  if (!captureEngine.triggerAvailable()) {
+    DEBUG_SERIAL.println("No trigger patterns configured (TRIGGER_PATTERNS).");
+    return;
+  }
 
-  // Reset edge detection
-  edgeCount = 0;
+  bool on = !captureEngine.triggerMode();
+  captureEngine.setTriggerMode(on);
+  DEBUG_SERIAL.print("Trigger mode: ");
+  if (!on) {
+    DEBUG_SERIAL.println("Off");
+    return;
+  }
+  DEBUG_SERIAL.print("On, ");
+  DEBUG_SERIAL.print(settings.preTriggerMs);
+  DEBUG_SERIAL.print(" ms before to ");
+  DEBUG_SERIAL.print(settings.postTriggerMs);
+  DEBUG_SERIAL.println(" ms after a hit of:");
+  for (uint32_t i = 0; i < captureEngine.triggerPatterns(); i++) {
+    DEBUG_SERIAL.print("  ");
+    DEBUG_SERIAL.println(captureEngine.triggerPattern(i));
+  }
+}
 
-  // Detach from UART hardware temporarily
-  TARGET_SERIAL.end();
+void clearBuffer() {
+  // Clearing is for the consumer side only: not while the ports fill the rings
+  if (portsRunning) {
+    DEBUG_SERIAL.println("Stop capture before clearing the buffer.");
+    return;
+  }
 
-  // Configure Pin 0 (Serial1 RX) as input with interrupts
-  pinMode(0, INPUT);
-  attachInterrupt(digitalPinToInterrupt(0), edgeDetectionISR, CHANGE);
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    captureChannels[i].ring.clear();
+  }
+  DEBUG_SERIAL.println("Buffer cleared.");
+}
 
-  DEBUG_SERIAL.println("Listening for serial transitions...");
+void toggleLiveStream() {
+#ifdef LIVE_SERIAL
+  bool on = !captureEngine.liveStreaming();
+  captureEngine.setLivePort(on ? &liveStreamPort : nullptr);
+  DEBUG_SERIAL.println(on ? "Live stream on (second USB serial port)." : "Live stream off.");
+#else
+  DEBUG_SERIAL.println("Live stream needs a dual-serial USB build (USB_DUAL_SERIAL).");
+#endif
+}
 
-  // Wait for samples or timeout
-  unsigned long startTime = millis();
-  while (edgeCount < SAMPLE_COUNT && (millis() - startTime) < TIMEOUT_MS) {
-    delay(10);
+bool portEnabled(uint32_t index) {
+  return settings.portMask & (1u << index);
+}
 
-    // Progress indicator
-    if ((millis() - startTime) % 1000 == 0) {
-      DEBUG_SERIAL.print(".");
-    }
+void startPorts(uint32_t origin) {
+  const LineFormat& format = captureEngine.lineFormat();
+  uint32_t characterCycles = (uint32_t)((uint64_t)TeensyClock::cycleHz() * format.characterBits() / detectedBaud);
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    captureChannels[i].reset(origin, characterCycles);
+    if (portEnabled(i)) capturePorts[i].begin(detectedBaud, format);
   }
-  DEBUG_SERIAL.println();
+  portsRunning = true;
+  portsOrigin = origin;
+}
 
-  // Detach interrupt
-  detachInterrupt(digitalPinToInterrupt(0));
+void stopPorts() {
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    if (portEnabled(i)) capturePorts[i].end();
+  }
+  portsRunning = false;
+}
 
-  // Check if we got enough samples
-  if (edgeCount < MIN_SAMPLES_REQUIRED) {
-    DEBUG_SERIAL.print("Detection failed: Only captured ");
-    DEBUG_SERIAL.print(edgeCount);
-    DEBUG_SERIAL.println(" edge transitions.");
-    promptManualBaudRate();
+void nextLineFormat() {
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("Stop capture before changing the line format.");
     return;
   }
 
-  DEBUG_SERIAL.print("Captured ");
-  DEBUG_SERIAL.print(edgeCount);
-  DEBUG_SERIAL.println(" edge transitions. Analyzing...");
-
-  // Calculate pulse widths between edges
-  uint32_t pulseWidths[SAMPLE_COUNT - 1];
-  for (int i = 0; i < edgeCount - 1; i++) {
-    pulseWidths[i] = edgeTimes[i + 1] - edgeTimes[i];
+  const uint32_t count = sizeof(LINE_FORMATS) / sizeof(LINE_FORMATS[0]);
+  const LineFormat& current = captureEngine.lineFormat();
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const LineFormat& format = LINE_FORMATS[i];
+    if (format.dataBits == current.dataBits && format.parity == current.parity &&
+        format.stopBits == current.stopBits) {
+      next = (i + 1) % count;
+    }
   }
+  captureEngine.setLineFormat(LINE_FORMATS[next]);
 
-  // Find shortest consistent pulse (= 1 bit period)
-  uint32_t bitPeriod = findShortestConsistentPulse(pulseWidths, edgeCount - 1);
+  char name[4];
+  lineFormatName(LINE_FORMATS[next], name);
+  DEBUG_SERIAL.print("Line format: ");
+  DEBUG_SERIAL.println(name);
+}
 
-  if (bitPeriod == 0) {
-    DEBUG_SERIAL.println("Detection failed: No consistent pulse pattern found.");
-    promptManualBaudRate();
+void nextPortMask() {
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("Stop capture before changing the capture ports.");
     return;
   }
 
-  // Calculate raw baud rate
-  uint32_t rawBaud = 1000000 / bitPeriod;
-  DEBUG_SERIAL.print("Calculated baud rate: ");
-  DEBUG_SERIAL.println(rawBaud);
+  // Every non-empty combination in turn
+  uint32_t all = (1u << CAPTURE_CHANNEL_COUNT) - 1;
+  uint32_t mask = (settings.portMask & all) + 1;
+  settings.portMask = (uint8_t)(mask > all ? 1 : mask);
 
-  // Round to standard baud rate
-  uint32_t newBaud = roundToStandardBaud(rawBaud);
+  DEBUG_SERIAL.print("Capture ports:");
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    if (!portEnabled(i)) continue;
+    DEBUG_SERIAL.print(" ");
+    DEBUG_SERIAL.print(captureChannelName(capturePorts[i].channelId));
+  }
+  DEBUG_SERIAL.println();
+}
 
-  if (newBaud == 0) {
-    DEBUG_SERIAL.print("Warning: Calculated baud (");
-    DEBUG_SERIAL.print(rawBaud);
-    DEBUG_SERIAL.println(") doesn't match standard rates.");
-    promptManualBaudRate();
+void nextRotateInterval() {
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("Stop capture before changing the rotation interval.");
     return;
   }
 
-  // Attempt to validate the detected baud rate
-  detectedBaud = newBaud;
-  TARGET_SERIAL.begin(detectedBaud);
+  const uint32_t count = sizeof(ROTATE_INTERVALS_MS) / sizeof(ROTATE_INTERVALS_MS[0]);
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (ROTATE_INTERVALS_MS[i] == captureEngine.rotateInterval()) next = (i + 1) % count;
+  }
+  captureEngine.setRotateInterval(ROTATE_INTERVALS_MS[next]);
 
-  DEBUG_SERIAL.print("Testing baud rate ");
-  DEBUG_SERIAL.print(detectedBaud);
-  DEBUG_SERIAL.println("...");
+  DEBUG_SERIAL.print("Part file limit: ");
+  DEBUG_SERIAL.print(settings.partMegabytes);
+  if (ROTATE_INTERVALS_MS[next] == 0) {
+    DEBUG_SERIAL.println(" MB");
+  } else {
+    DEBUG_SERIAL.print(" MB or ");
+    DEBUG_SERIAL.print(ROTATE_INTERVALS_MS[next] / 60000);
+    DEBUG_SERIAL.println(" min");
+  }
+}
 
-  if (validateBaudRate()) {
-    DEBUG_SERIAL.println();
-    DEBUG_SERIAL.print("SUCCESS! Baud rate detected: ");
-    DEBUG_SERIAL.println(detectedBaud);
-    DEBUG_SERIAL.println();
-    currentState = IDLE;
+void toggleAutoCapture() {
+  settings.autoCapture = !settings.autoCapture;
+  DEBUG_SERIAL.print("Auto-capture at power-up: ");
+  DEBUG_SERIAL.println(settings.autoCapture ? "On ('w' to save)" : "Off ('w' to save)");
+}
+
+void defaultSettings(CaptureSettings& defaults) {
+  initCaptureSettings(defaults);
+  defaults.baudRate = DEFAULT_BAUD_RATE;
+  defaults.portMask = (uint8_t)((1u << CAPTURE_CHANNEL_COUNT) - 1);
+  defaults.autoCapture = AUTO_CAPTURE_AT_BOOT;
+  defaults.logFormat = LOG_FORMAT_BINARY;
+  defaults.compress = COMPRESS_AT_BOOT;
+  defaults.trigger = TRIGGER_AT_BOOT;
+  defaults.liveStream = LIVE_STREAM_AT_BOOT;
+  defaults.preTriggerMs = TRIGGER_PRE_MS;
+  defaults.postTriggerMs = TRIGGER_POST_MS;
+  defaults.rotateIntervalMs = FILE_ROTATE_INTERVAL_MS;
+  defaults.partMegabytes = (uint32_t)(FILE_PREALLOCATE_BYTES / (1024 * 1024));
+  sealCaptureSettings(defaults);
+}
+
+void loadSettings() {
+  CaptureSettings stored;
+  EEPROM.get(SETTINGS_EEPROM_ADDRESS, stored);
+  settingsLoaded = isValidCaptureSettings(stored, CAPTURE_CHANNEL_COUNT);
+  if (settingsLoaded) {
+    settings = stored;
   } else {
-    DEBUG_SERIAL.println("Validation failed. Baud rate may be incorrect.");
-    promptManualBaudRate();
+    defaultSettings(settings);
   }
 }
 
-uint32_t findShortestConsistentPulse(uint32_t* pulses, int count) {
-  if (count < 3) return 0;
+void saveSettings() {
+  // The current configuration, wherever it lives
+  settings.baudRate = detectedBaud;
+  setSettingsLineFormat(settings, captureEngine.lineFormat());
+  settings.logFormat = captureEngine.logFormat();
+  settings.compress = captureEngine.compression();
+  settings.trigger = captureEngine.triggerMode();
+  settings.liveStream = captureEngine.liveStreaming();
+  settings.rotateIntervalMs = captureEngine.rotateInterval();
+  sealCaptureSettings(settings);
+
+  // EEPROM.put() only rewrites the bytes that changed
+  EEPROM.put(SETTINGS_EEPROM_ADDRESS, settings);
+  settingsLoaded = true;
+  DEBUG_SERIAL.print("Settings saved");
+  DEBUG_SERIAL.println(settings.autoCapture ? "; capture starts at power-up." : ".");
+}
+
+void eraseSettings() {
+  // A block with the wrong magic is ignored at the next power-up
+  EEPROM.put(SETTINGS_EEPROM_ADDRESS, (uint32_t)0xFFFFFFFF);
+  settingsLoaded = false;
+  DEBUG_SERIAL.println("Saved settings erased; defaults apply at the next power-up.");
+}
+
+// The boot capture's first byte: its stamp, in micros() since reset
+void noteBootFirstByte() {
+  uint64_t ticks = captureEngine.firstSampleTicks();
+  if (ticks == UINT64_MAX) return;
+  bootFirstByteUs = bootCaptureUs + (uint32_t)(ticks / (TeensyClock::cycleHz() / 1000000));
+  bootFirstBytePending = false;
+}
 
-  // Find minimum pulse width
-  uint32_t minPulse = pulses[0];
-  for (int i = 1; i < count; i++) {
-    if (pulses[i] < minPulse && pulses[i] > 5) {  // Ignore very short (noise)
-      minPulse = pulses[i];
+void printStatus(Print& out) {
+  unsigned long uptime = (millis() - startTime) / 1000;
+
+  out.println("========================================");
+  out.println("SerialSniffer Status");
+  out.println("========================================");
+  out.print("State: ");
+  switch (currentState) {
+    case IDLE: out.println("IDLE"); break;
+    case DETECTING_BAUD: out.println("DETECTING BAUD"); break;
+    case AWAITING_MANUAL_BAUD: out.println("AWAITING MANUAL INPUT"); break;
+    case CAPTURING: out.println("CAPTURING"); break;
+    case STOPPED: out.println("STOPPED"); break;
+  }
+  out.print("Baud Rate: ");
+  out.println(detectedBaud > 0 ? String(detectedBaud) : "Not detected");
+  char format[4];
+  lineFormatName(captureEngine.lineFormat(), format);
+  out.print("Line Format: ");
+  out.println(format);
+  out.print("Capture Ports:");
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    if (!portEnabled(i)) continue;
+    out.print(" ");
+    out.print(captureChannelName(capturePorts[i].channelId));
+  }
+  out.println();
+  out.print("Baud Detector: ");
+  switch (baudDetector.state()) {
+    case BAUD_DETECT_OFF: out.print("Off"); break;
+    case BAUD_DETECT_LISTENING: out.print("Listening"); break;
+    case BAUD_DETECT_LOCKED: out.print(baudDetector.verified() ? "Tracking" : "Tracking, unconfirmed"); break;
+    case BAUD_DETECT_FAILED: out.print("Failed"); break;
+  }
+  out.print(" (");
+  out.print(baudDetector.edgeCount());
+  out.println(" edges)");
+  out.print("Capture File: ");
+  out.println(captureEngine.filename()[0] ? captureEngine.filename() : "None");
+  if (captureEngine.fileOpen()) {
+    out.print("File Usage: ");
+    out.print((uint32_t)(captureEngine.fileUsage() / 1024));
+    out.print("/");
+    out.print((uint32_t)(captureEngine.preallocateBytes() / 1024));
+    out.println(" KB");
+  }
+  out.print("Log Format: ");
+  out.print(captureEngine.logFormat() == LOG_FORMAT_BINARY ? "Binary" : "CSV");
+  out.print(captureEngine.compression() ? ", compressed" : "");
+  out.println(captureEngine.triggerMode() ? ", trigger windows only" : "");
+  out.print("Part Files: ");
+  out.print((uint32_t)(captureEngine.preallocateBytes() / (1024 * 1024)));
+  out.print(" MB");
+  if (captureEngine.rotateInterval() > 0) {
+    out.print(" or ");
+    out.print(captureEngine.rotateInterval() / 60000);
+    out.print(" min");
+  }
+  out.println();
+  out.print("Settings: ");
+  out.print(settingsLoaded ? "saved" : "defaults");
+  out.println(settings.autoCapture ? ", auto-capture at power-up" : "");
+  if (bootCaptureUs > 0) {
+    out.print("Boot Capture: receiving at ");
+    out.print(bootCaptureUs / 1000.0f, 1);
+    out.print(" ms, logging at ");
+    out.print(bootLoggingUs / 1000.0f, 1);
+    out.print(" ms, first byte ");
+    if (bootFirstByteUs > 0) {
+      out.print("at ");
+      out.print(bootFirstByteUs / 1000.0f, 1);
+      out.println(" ms after reset");
+    } else {
+      out.println("not yet");
+    }
+  }
+#ifdef CAPTURE_UART_DMA
+  out.print("Receive: eDMA, ");
+  out.print(DMA_RX_WORDS);
+  out.println(" words per port");
+#else
+  out.println("Receive: interrupt per character");
+#endif
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    const UartChannel& channel = captureChannels[i];
+    out.print("Channel ");
+    out.print(captureChannelName(channel.id));
+    out.print(": Bytes Received ");
+    out.print(channel.stats.bytesReceived);
+    out.print(", Bytes Dropped ");
+    out.print(channel.stats.bytesDropped);
+    out.print(", Packets ");
+    out.print((unsigned long)captureEngine.framer().packets(channel.id));
+    const ChecksumEngine& checksums = captureEngine.checksums();
+    out.print(", Checksum ");
+    out.print(checksumAlgorithmName(checksums.rule(channel.id).algorithm));
+    out.print(" (valid ");
+    out.print((unsigned long)checksums.validPackets(channel.id));
+    out.print(", errors ");
+    out.print((unsigned long)checksums.errorPackets(channel.id));
+    out.print(")");
+    out.print(", Buffer ");
+    out.print(channel.ring.fastSize());
+    out.print("/");
+    out.print(channel.ring.fastCapacity());
+    out.print(" (peak ");
+    out.print(channel.ring.fastPeak());
+    out.print("), Spill ");
+    out.print(channel.ring.spillSize());
+    out.print("/");
+    out.print(channel.ring.spillCapacity());
+    out.print(" (peak ");
+    out.print(channel.ring.spillPeak());
+    out.print(", ");
+    out.print(channel.ring.spills());
+    out.println(" spills)");
+    out.print("  UART Errors: framing ");
+    out.print(channel.uart.framingErrors);
+    out.print(", parity ");
+    out.print(channel.uart.parityErrors);
+    out.print(", overruns ");
+    out.println(channel.uart.overruns);
+  }
+  out.print("SD Card: ");
+  out.println(sdCardReady ? "Ready" : "Not available");
+  if (captureEngine.writerOpen()) {
+    const SectorWriterStats& writerStats = captureEngine.writerStats();
+    out.print("SD Sectors Written: ");
+    out.println(writerStats.sectorsWritten);
+    out.print("SD Write Latency: last ");
+    out.print(writerStats.lastWriteUs);
+    out.print(" us, max ");
+    out.print(writerStats.maxWriteUs);
+    out.print(" us, ");
+    out.print(writerStats.slowWrites);
+    out.println(" slow");
+    out.print("SD Sync Latency Max: ");
+    out.print(writerStats.maxSyncUs);
+    out.println(" us");
+    out.print("SD Blocks Queued: ");
+    out.print(captureEngine.blocksQueued());
+    out.print(" (peak ");
+    out.print(writerStats.peakBlocksQueued);
+    out.print("/");
+    out.print(SD_WRITER_BLOCKS);
+    out.println(")");
+    if (captureEngine.compressing()) {
+      const BlockCompressorStats& blockStats = captureEngine.compressionStats();
+      out.print("Compression: ");
+      out.print(blockStats.fileBytes ? (float)blockStats.rawBytes / blockStats.fileBytes : 0.0f, 2);
+      out.print(":1 over ");
+      out.print(blockStats.blocks);
+      out.print(" blocks (");
+      out.print(blockStats.storedBlocks);
+      out.print(" stored), ");
+      out.print(blockStats.blocks ? (uint32_t)(blockStats.totalUs / blockStats.blocks) : 0);
+      out.print(" us/block, max ");
+      out.print(blockStats.maxUs);
+      out.println(" us");
+    }
+    if (captureEngine.triggering()) {
+      const TriggerStats& triggerStats = captureEngine.triggerStats();
+      out.print("Trigger: ");
+      out.print(triggerStats.hits);
+      out.print(" hits, ");
+      out.print(triggerStats.windows);
+      out.print(" windows (");
+      out.print(triggerStats.shortWindows);
+      out.print(" short), ");
+      out.print((unsigned long)triggerStats.recordsKept);
+      out.print(" records kept, ");
+      out.print((unsigned long)triggerStats.recordsDiscarded);
+      out.print(" discarded, history ");
+      out.print(captureEngine.historyUsed() / 1024);
+      out.print("/");
+      out.print(captureEngine.historyCapacity() / 1024);
+      out.println(captureEngine.triggerWindowOpen() ? " KB, window open" : " KB");
+    }
+    out.print("Time Index: ");
+    out.print(captureEngine.indexOpen() ? "On" : "Off");
+    out.print(" (");
+    out.print(captureEngine.indexEntriesDropped());
+    out.println(" entries dropped)");
+  }
+  out.print("Live Stream: ");
+  if (captureEngine.liveStreaming()) {
+    const LiveStreamStats& liveStats = captureEngine.liveStats();
+    out.print(liveStats.batchesSent);
+    out.print(" batches sent, ");
+    out.print(liveStats.batchesDropped);
+    out.print(" dropped (");
+    out.print((unsigned long)liveStats.recordsDropped);
+    out.print(" records), queue peak ");
+    out.print(liveStats.queuePeak);
+    out.print("/");
+    out.println(captureEngine.LIVE_BATCHES);
+  } else {
+    out.println("Off");
+  }
+  if (captureEngine.metricsEnabled()) {
+    MetricsSnapshot snapshot;
+    captureEngine.metricsSnapshot(snapshot);
+    out.println("Stage Latency (count, p50/p99/max us):");
+    for (uint8_t stage = 0; stage < PIPELINE_STAGE_COUNT; stage++) {
+      const LatencyHistogram& histogram = snapshot.stages[stage];
+      if (histogram.count == 0) continue;
+      out.print("  ");
+      out.print(pipelineStageName(stage));
+      out.print(": ");
+      out.print(histogram.count);
+      out.print(", ");
+      out.print(ticksToMicros(histogram.percentile(500)), 1);
+      out.print("/");
+      out.print(ticksToMicros(histogram.percentile(990)), 1);
+      out.print("/");
+      out.println(ticksToMicros(histogram.max), 1);
     }
+    out.print("Instrumentation: ");
+    out.print(snapshot.probeTicks);
+    out.print(" cycles/probe, ~");
+    out.print(captureEngine.metricsOverheadPermille() / 10.0f, 1);
+    out.println("% CPU");
   }
+  out.println("Tasks (runs, avg/max us, overruns, deadline misses):");
+  for (uint32_t i = 0; i < scheduler.taskCount(); i++) {
+    const SchedulerTaskStats& stats = scheduler.stats(i);
+    out.print("  ");
+    out.print(scheduler.task(i).name);
+    out.print(": ");
+    out.print(stats.runs);
+    out.print(", ");
+    out.print(ticksToMicros(stats.runs ? (uint32_t)(stats.totalTicks / stats.runs) : 0), 1);
+    out.print("/");
+    out.print(ticksToMicros(stats.maxTicks), 1);
+    out.print(", ");
+    out.print(stats.overruns);
+    out.print(", ");
+    out.println(stats.deadlineMisses);
+  }
+  out.print("Main Loop: ");
+  out.print((unsigned long)scheduler.passes());
+  out.print(" passes, ");
+  out.print((unsigned long)scheduler.idlePasses());
+  out.println(" idle");
+  if (statusText.truncatedBytes() > 0) {
+    out.print("Status Output: ");
+    out.print(statusText.truncatedBytes());
+    out.println(" bytes cut off (STATUS_BUFFER_SIZE)");
+  }
+  out.print("Uptime: ");
+  out.print(uptime);
+  out.println(" seconds");
+  out.println("========================================");
+}
 
-  // Count how many pulses are within 10% of minimum
-  int matchCount = 0;
-  uint32_t tolerance = minPulse / 10;  // 10% tolerance
+float ticksToMicros(uint32_t ticks) {
+  return ticks / (TeensyClock::cycleHz() / 1000000.0f);
+}
 
-  for (int i = 0; i < count; i++) {
-    if (pulses[i] >= (minPulse - tolerance) && pulses[i] <= (minPulse + tolerance)) {
-      matchCount++;
+// Machine-readable status: one JSON object on one line. Latencies and
+// task times are cycle counter ticks at "cycle_hz"; "buckets" are the LATENCY_BUCKETS
+// power-of-two bins of CaptureFormat.h (bin b from 2^(b+4) ticks, bin 0
+// from 0). Stage and counter names match the METRIC records in the log.
+void printStatusJson(Print& out) {
+  static const char* const STATE_NAMES[] = {"IDLE", "DETECTING_BAUD", "AWAITING_MANUAL_BAUD", "CAPTURING",
+                                            "STOPPED"};
+  MetricsSnapshot snapshot;
+  captureEngine.metricsSnapshot(snapshot);
+
+  out.print("{\"state\":\"");
+  out.print(STATE_NAMES[currentState]);
+  out.print("\",\"baud\":");
+  out.print(detectedBaud);
+  char format[4];
+  lineFormatName(captureEngine.lineFormat(), format);
+  out.print(",\"line_format\":\"");
+  out.print(format);
+  out.print("\",\"port_mask\":");
+  out.print(settings.portMask);
+  out.print(",\"auto_capture\":");
+  out.print(settings.autoCapture ? "true" : "false");
+  out.print(",\"boot\":");
+  if (bootCaptureUs > 0) {
+    out.print("{\"capture_us\":");
+    out.print(bootCaptureUs);
+    out.print(",\"logging_us\":");
+    out.print(bootLoggingUs);
+    out.print(",\"first_byte_us\":");
+    if (bootFirstByteUs > 0) {
+      out.print(bootFirstByteUs);
+    } else {
+      out.print("null");
+    }
+    out.print("}");
+  } else {
+    out.print("null");
+  }
+  out.print(",\"uptime_ms\":");
+  out.print(millis() - startTime);
+  out.print(",\"file\":\"");
+  out.print(captureEngine.filename());
+  out.print("\",\"records\":");
+  out.print((unsigned long)captureEngine.recordsLogged());
+  out.print(",\"cycle_hz\":");
+  out.print(TeensyClock::cycleHz());
+  out.print(",\"metrics\":");
+  out.print(captureEngine.metricsEnabled() ? "true" : "false");
+  out.print(",\"probe_ticks\":");
+  out.print(snapshot.probeTicks);
+  out.print(",\"overhead_permille\":");
+  out.print(captureEngine.metricsOverheadPermille());
+
+  out.print(",\"channels\":[");
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    const UartChannel& channel = captureChannels[i];
+    uint8_t id = channel.id;
+    if (i > 0) out.print(",");
+    out.print("{\"channel\":\"");
+    out.print(captureChannelName(id));
+    out.print("\"");
+    printJsonCounter(out, "BYTES_RECEIVED", snapshot.bytesReceived[id]);
+    printJsonCounter(out, "BYTES_DROPPED", snapshot.bytesDropped[id]);
+    printJsonCounter(out, "FRAMING_ERRORS", snapshot.framingErrors[id]);
+    printJsonCounter(out, "PARITY_ERRORS", snapshot.parityErrors[id]);
+    printJsonCounter(out, "OVERRUNS", snapshot.overruns[id]);
+    out.print(",\"buffer\":[");
+    out.print(channel.ring.fastSize());
+    out.print(",");
+    out.print(channel.ring.fastPeak());
+    out.print(",");
+    out.print(channel.ring.fastCapacity());
+    out.print("],\"spill\":[");
+    out.print(channel.ring.spillSize());
+    out.print(",");
+    out.print(channel.ring.spillPeak());
+    out.print(",");
+    out.print(channel.ring.spillCapacity());
+    out.print("],\"spills\":");
+    out.print(channel.ring.spills());
+    out.print("}");
+  }
+  out.print("]");
+
+  printJsonCounter(out, "STREAM_DROPPED", snapshot.streamDropped);
+  printJsonCounter(out, "WRITE_ERRORS", snapshot.writeErrors);
+  printJsonCounter(out, "INDEX_DROPPED", snapshot.indexDropped);
+
+  out.print(",\"stages\":{");
+  for (uint8_t stage = 0; stage < PIPELINE_STAGE_COUNT; stage++) {
+    const LatencyHistogram& histogram = snapshot.stages[stage];
+    if (stage > 0) out.print(",");
+    out.print("\"");
+    out.print(pipelineStageName(stage));
+    out.print("\":{\"count\":");
+    out.print(histogram.count);
+    out.print(",\"total\":");
+    out.print((unsigned long long)histogram.total);
+    out.print(",\"max\":");
+    out.print(histogram.max);
+    out.print(",\"buckets\":[");
+    for (uint8_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+      if (bucket > 0) out.print(",");
+      out.print(histogram.buckets[bucket]);
     }
+    out.print("]}");
   }
+  out.print("},\"passes\":");
+  out.print((unsigned long)scheduler.passes());
+  out.print(",\"idle_passes\":");
+  out.print((unsigned long)scheduler.idlePasses());
+  out.print(",\"tasks\":{");
+  for (uint32_t i = 0; i < scheduler.taskCount(); i++) {
+    const SchedulerTaskStats& stats = scheduler.stats(i);
+    if (i > 0) out.print(",");
+    out.print("\"");
+    out.print(scheduler.task(i).name);
+    out.print("\":{\"runs\":");
+    out.print(stats.runs);
+    printJsonCounter(out, "busy", stats.busyRuns);
+    printJsonCounter(out, "total", stats.totalTicks);
+    printJsonCounter(out, "max", stats.maxTicks);
+    printJsonCounter(out, "overruns", stats.overruns);
+    printJsonCounter(out, "deadline_misses", stats.deadlineMisses);
+    printJsonCounter(out, "max_wait", stats.maxWaitTicks);
+    out.print("}");
+  }
+  out.println("}}");
+}
+
+// ,"NAME":value
+void printJsonCounter(Print& out, const char* name, uint64_t value) {
+  out.print(",\"");
+  out.print(name);
+  out.print("\":");
+  out.print((unsigned long long)value);
+}
+
+// ISR for edge detection
+void edgeDetectionISR() {
+  baudDetector.edge(ARM_DWT_CYCCNT);
+}
 
-  // Need at least 3 matching pulses to be "consistent"
-  if (matchCount >= 3) {
-    return minPulse;
+void startBaudDetection() {
+  if (currentState == CAPTURING) {
+    DEBUG_SERIAL.println("The line rate is tracked during capture; stop capture to re-detect.");
+    return;
   }
 
-  return 0;
+  // Pin 0 goes back to a GPIO input for the edge interrupt
+  TARGET_SERIAL.end();
+  stopBaudDetector();
+  baudDetector.start(millis());
+  baudEdgeInput.begin(BAUD_DETECT_PIN, edgeDetectionISR);
+  currentState = DETECTING_BAUD;
+
+  DEBUG_SERIAL.println("Listening for serial transitions (commands stay available)...");
 }
 
-uint32_t roundToStandardBaud(uint32_t rawBaud) {
-  const uint32_t rates[] = {9600, 19200, 38400, 57600, 115200};
-  const int numRates = 5;
+void stopBaudDetector() {
+  if (baudDetector.state() == BAUD_DETECT_OFF) return;
+  baudEdgeInput.end();
+  baudDetector.stop();
+}
 
-  uint32_t closest = rates[0];
-  uint32_t minDiff = abs((int32_t)rawBaud - (int32_t)closest);
+void serviceBaudDetector() {
+  switch (baudDetector.poll(millis())) {
+    case BAUD_EVENT_LOCKED:
+      finishBaudDetection();
+      break;
 
-  for (int i = 1; i < numRates; i++) {
-    uint32_t diff = abs((int32_t)rawBaud - (int32_t)rates[i]);
-    if (diff < minDiff) {
-      minDiff = diff;
-      closest = rates[i];
+    case BAUD_EVENT_TIMED_OUT: {
+      const BaudEstimate& estimate = baudDetector.lastEstimate();
+      DEBUG_SERIAL.print("Detection failed: ");
+      DEBUG_SERIAL.print(baudDetector.edgeCount());
+      DEBUG_SERIAL.print(" edge transitions");
+      if (estimate.measuredBaud > 0) {
+        DEBUG_SERIAL.print(", best fit ");
+        DEBUG_SERIAL.print(estimate.measuredBaud);
+        DEBUG_SERIAL.print(" baud at ");
+        DEBUG_SERIAL.print((int)(estimate.confidence * 100));
+        DEBUG_SERIAL.print("% confidence");
+      }
+      DEBUG_SERIAL.println(".");
+      stopBaudDetector();
+      promptManualBaudRate();
+      break;
     }
+
+    case BAUD_EVENT_RATE_CHANGED:
+      relockCapture(baudDetector.baud());
+      break;
+
+    case BAUD_EVENT_NONE:
+      break;
   }
+}
 
-  // Only accept if within 5% of standard rate
-  uint32_t tolerance = closest / 20;  // 5%
-  if (minDiff < tolerance) {
-    return closest;
+void finishBaudDetection() {
+  const BaudEstimate& estimate = baudDetector.lastEstimate();
+  stopBaudDetector();
+
+  DEBUG_SERIAL.print("Measured baud rate: ");
+  DEBUG_SERIAL.print(estimate.measuredBaud);
+  DEBUG_SERIAL.print(" (");
+  DEBUG_SERIAL.print((int)(estimate.confidence * 100));
+  DEBUG_SERIAL.print("% of ");
+  DEBUG_SERIAL.print(estimate.intervals);
+  DEBUG_SERIAL.println(" edge intervals fit)");
+  if (estimate.baud != estimate.measuredBaud) {
+    DEBUG_SERIAL.print("Nearest standard rate: ");
+    DEBUG_SERIAL.println(estimate.baud);
   }
 
-  return 0;  // Not close enough to any standard rate
+  detectedBaud = estimate.baud;
+  DEBUG_SERIAL.println();
+  DEBUG_SERIAL.print("SUCCESS! Baud rate detected: ");
+  DEBUG_SERIAL.println(detectedBaud);
+  DEBUG_SERIAL.println();
+  currentState = IDLE;
 }
 
-bool validateBaudRate() {
-  delay(100);  // Wait for data
+void relockCapture(uint32_t baud) {
+  if (currentState != CAPTURING) return;
+
+  // Bytes already received keep their old-rate stamps; the log records
+  // the switch between the last old-rate and first new-rate bytes. The
+  // ports keep running (no begin()), so nothing queued is dropped.
+  const LineFormat& format = captureEngine.lineFormat();
+  uint32_t characterCycles = (uint32_t)((uint64_t)TeensyClock::cycleHz() * format.characterBits() / baud);
+  for (uint32_t i = 0; i < CAPTURE_CHANNEL_COUNT; i++) {
+    if (portEnabled(i)) {
+      capturePorts[i].changeBaud(baud, captureChannels[i].byteCycles, characterCycles);
+    } else {
+      captureChannels[i].byteCycles = characterCycles;
+    }
+  }
 
-  int validCount = 0;
-  int totalCount = 0;
-  unsigned long start = millis();
+  // An earlier change still waiting for room goes first; if it cannot,
+  // it is reported lost and this one takes its place
+  if (rateEventPending) queueRateEvent();
+  if (rateEventPending) dropRateEvent();
+  rateEventBaud = baud;
+  rateEventCycles = TeensyClock::cycles();
+  rateEventPending = true;
+  queueRateEvent();
 
-  // Try to read 20 bytes or timeout after 1 second
-  while (totalCount < 20 && (millis() - start) < 1000) {
-    if (TARGET_SERIAL.available()) {
-      uint8_t b = TARGET_SERIAL.read();
-      totalCount++;
+  DEBUG_SERIAL.print("Line rate changed: ");
+  DEBUG_SERIAL.print(detectedBaud);
+  DEBUG_SERIAL.print(" -> ");
+  DEBUG_SERIAL.print(baud);
+  DEBUG_SERIAL.println(" baud; capture ports re-locked");
+  detectedBaud = baud;
+}
 
-      // Consider valid if: printable ASCII, or common control chars
-      if (isPrintable(b) || b == 0x0A || b == 0x0D || b == 0x00) {
-        validCount++;
-      }
-    }
-    delay(10);
+void queueRateEvent() {
+  if (captureEngine.lineRateChanged(CHANNEL_RX, rateEventBaud, rateEventCycles)) {
+    rateEventPending = false;
   }
+}
 
-  // Need at least 5 bytes and 50% validity
-  return (totalCount >= 5 && validCount >= (totalCount / 2));
+void dropRateEvent() {
+  rateEventPending = false;
+  DEBUG_SERIAL.print("WARNING: Event queue full; rate change to ");
+  DEBUG_SERIAL.print(rateEventBaud);
+  DEBUG_SERIAL.println(" baud not logged");
 }
 
 void promptManualBaudRate() {
+  // A manual rate replaces a detection in progress
+  if (currentState == DETECTING_BAUD) {
+    stopBaudDetector();
+  }
+
   DEBUG_SERIAL.println();
   DEBUG_SERIAL.println("========================================");
   DEBUG_SERIAL.println("Manual Baud Rate Selection");
@@ -557,68 +1531,36 @@ void handleManualBaudInput(char input) {
   }
 }
 
-void captureData() {
-  static unsigned long lastFlush = 0;
-  static unsigned int bytesSinceFlush = 0;
-  const unsigned int FLUSH_INTERVAL_MS = 1000;    // Flush every 1 second
-  const unsigned int FLUSH_BYTE_COUNT = 512;      // Or every 512 bytes
-
-  if (TARGET_SERIAL.available()) {
-    uint8_t incomingByte = TARGET_SERIAL.read();
-    bytesReceived++;
+// Replaces HardwareSerial's handler for a capture port while capturing.
+// Runs at UART interrupt priority, so SD writes in the storage task never
+// delay the stamp. With CAPTURE_UART_DMA it only sees the idle line and
+// FIFO overruns.
+template <uint32_t LpuartAddress, uint32_t Index>
+void captureUartIsr() {
+#ifdef CAPTURE_UART_DMA
+  capturePorts[Index].idleInterrupt();
+#else
+  lpuartReceive((IMXRT_LPUART_t*)LpuartAddress, captureChannels[Index]);
+#endif
+}
 
-    // Add to buffer
-    if (bufferIndex < BUFFER_SIZE) {
-      rxBuffer[bufferIndex++] = incomingByte;
-    } else {
-      // Buffer overflow warning
-      DEBUG_SERIAL.println("WARNING: Buffer overflow!");
-    }
+#ifdef CAPTURE_UART_DMA
+// A capture port's DMA channel finished a lap of its buffer
+template <uint32_t Index>
+void captureLapIsr() {
+  capturePorts[Index].lapInterrupt();
+}
+#endif
 
-    // Log to SD card (file already open from startCapture)
-    if (dataFile) {
-      unsigned long timestamp = millis() - startTime;
-      dataFile.print(timestamp);
-      dataFile.print(",RX,0x");
-      if (incomingByte < 0x10) dataFile.print("0"); // Pad single hex digits
-      dataFile.print(incomingByte, HEX);
-      dataFile.print(",");
-      dataFile.print(isPrintable(incomingByte) ? String((char)incomingByte) : ".");
-      dataFile.println(",OK");
-
-      bytesSinceFlush++;
-
-      // Periodic flush to ensure data is written to SD card
-      unsigned long now = millis();
-      if ((now - lastFlush > FLUSH_INTERVAL_MS) || (bytesSinceFlush >= FLUSH_BYTE_COUNT)) {
-        dataFile.flush();
-        lastFlush = now;
-        bytesSinceFlush = 0;
-      }
-    }
 
-    // Optional: Echo to debug serial (comment out for high-speed capture)
-    // Uncomment the lines below for real-time monitoring (will reduce max capture speed)
-    /*
-    DEBUG_SERIAL.print("RX: 0x");
-    if (incomingByte < 0x10) DEBUG_SERIAL.print("0");
-    DEBUG_SERIAL.print(incomingByte, HEX);
-    DEBUG_SERIAL.print(" (");
-    DEBUG_SERIAL.print(isPrintable(incomingByte) ? String((char)incomingByte) : ".");
-    DEBUG_SERIAL.println(")");
-    */
-  }
+void printEngineMessage(const char* message) {
+  DEBUG_SERIAL.println(message);
 }
 
 void blinkLED() {
-  static unsigned long lastBlink = 0;
   static bool ledState = false;
-
-  if (millis() - lastBlink > 500) {
-    ledState = !ledState;
-    digitalWrite(LED_PIN, ledState);
-    lastBlink = millis();
-  }
+  ledState = !ledState;
+  digitalWrite(LED_PIN, ledState);
 }
 
 void printSDCardInfo() {